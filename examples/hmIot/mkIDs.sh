@@ -30,7 +30,7 @@ CertValidator=EdDSA
 make_cert -s $CertValidator -o $RootCert $PubPrefix
 schema_cert -o $SchemaCert $Bschema $RootCert
 
-if [[ $(schema_info -t $Bschema "#wireValidator") =~ AEAD|PPAEAD|PPSIGN ]]; then
+if [[ $(schema_info -t $Bschema "#wireValidator") =~ AEAD|AESGCM|BLAKE2K|PPAEAD|PPSIGN ]]; then
     if [ -z $(schema_info -c $Bschema "KM") ]; then
 	echo
 	echo "- error: AEAD PDU encryption requires entity(s) with a KM (KeyMaker) Capability"
@@ -43,7 +43,7 @@ if [[ $(schema_info -t $Bschema "#wireValidator") =~ AEAD|PPAEAD|PPSIGN ]]; then
     DeviceSigner=$KMCapCert
 fi;
 
-if [[ $(schema_info -t $Bschema "#pubValidator") =~ AEADSGN|PPSIGN ]]; then
+if [[ $(schema_info -t $Bschema "#pubValidator") =~ AEADSGN|AESGCMSGN|PPSIGN ]]; then
     if [ -z $(schema_info -c $Bschema "KMP") ]; then
 	echo
 	echo "- error: AEAD Pub encryption requires entity(s) with a KMP (KeyMaker Pubs) Capability"
@@ -0,0 +1,83 @@
+/*
+ * chk_schema [bschema] - check load_schema.hpp (the header 'schemaCompile -c'
+ * generated from load.rules) against a binary schema compiled from the same
+ * rules (default load.scm from mkIDs.sh) then build & validate a #loadPub name
+ * using only the compiled tables.
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+#include <fstream>
+#include <string>
+
+#include "dct/format.hpp"
+#include "dct/schema/rdschema.hpp"
+#include "load_schema.hpp"
+
+using namespace dct;
+using namespace load_schema;
+using namespace std::literals;
+
+// template selection is constexpr so the compiled tables can be checked when this is built
+static constexpr std::array loadNm{ "load"sv, "t0"sv, "p0"sv, "host"sv, "1"sv, "2"sv, "3"sv };
+static_assert(cschema::select<loadPub>(loadNm) == 0);
+static_assert(cschema::select<loadPub>(loadNm, 0x02) < 0);
+static_assert(cschema::select<loadPub>(std::array{ "lode"sv, "t0"sv, "p0"sv, "host"sv, "1"sv, "2"sv, "3"sv }) < 0);
+
+template<typename... Pub>
+static int check(const bSchema& bs) {
+    int err{};
+    ((err += [&bs] {
+        auto e = cschema::mismatch<Pub>(bs);
+        print("{}: {}\n", Pub::name, e.empty()? "ok" : e);
+        return e.empty()? 0 : 1;
+    }()), ...);
+    return err;
+}
+
+int main(int argc, const char* argv[]) {
+    const char* sfile = argc > 1 ? argv[1] : "load.scm";
+    try {
+        std::ifstream is(sfile, std::ios::binary);
+        if (! is) {
+            print("- can't open {}\n", sfile);
+            exit(1);
+        }
+        rdSchema rs(is);
+        bSchema bs{rs.read()};
+
+        int err = check<loadPub, chainInfo, pubPrefix, pubValidator, wireValidator>(bs);
+
+        loadPub::Params par{};
+        par[loadPub::tag::topic] = "t0"sv;
+        par[loadPub::tag::pubr] = "p0"sv;
+        par[loadPub::tag::msgID] = uint64_t(1);
+        par[loadPub::tag::sCnt] = uint64_t(2);
+        par[loadPub::tag::mts] = std::chrono::system_clock::now();
+        auto nm = cschema::build<loadPub>(par);
+        bool ok = cschema::validate<loadPub>(rName(nm), 0x01);
+        print("built {}: {}\n", rName(nm), ok? "ok" : "doesn't validate");
+        if (! ok) ++err;
+        exit(err != 0);
+    } catch (const std::exception& e) {
+        print("- {}: {}\n", sfile, e.what());
+        exit(1);
+    }
+}
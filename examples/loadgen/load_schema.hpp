@@ -0,0 +1,64 @@
+// load_schema pub builders & validators generated by schemaCompile from load.rules. Do not edit.
+#pragma once
+#include "dct/schema/compiled_schema.hpp"
+
+namespace load_schema {
+
+using dct::cschema::cKind;
+
+struct loadPub {
+    static constexpr std::string_view name{"#loadPub"};
+    struct tag { enum : uint8_t { _domain, topic, pubr, _origin, msgID, sCnt, mts }; };
+    static constexpr std::array<std::string_view,7> tags{ "_domain", "topic", "pubr", "_origin", "msgID", "sCnt", "mts" };
+    using Params = std::array<dct::paramVal,7>;
+    static constexpr dct::cschema::cComp t0_[]{ {cKind::lit, "load"}, {cKind::param}, {cKind::param}, {cKind::call, "sysId"}, {cKind::param}, {cKind::param}, {cKind::param} };
+    static constexpr std::array<dct::cschema::cTmplt,1> tmplts{
+        dct::cschema::cTmplt{t0_, 128, {}, 0x01}
+    };
+};
+
+struct chainInfo {
+    static constexpr std::string_view name{"#chainInfo"};
+    struct tag { enum : uint8_t { _role, _roleId }; };
+    static constexpr std::array<std::string_view,2> tags{ "_role", "_roleId" };
+    using Params = std::array<dct::paramVal,2>;
+    static constexpr dct::cschema::cComp t0_[]{ {cKind::cor}, {cKind::cor} };
+    static constexpr std::array<dct::cschema::cTmplt,1> tmplts{
+        dct::cschema::cTmplt{t0_, 128, {}, 0x01}
+    };
+};
+
+struct pubPrefix {
+    static constexpr std::string_view name{"#pubPrefix"};
+    struct tag { enum : uint8_t { _domain }; };
+    static constexpr std::array<std::string_view,1> tags{ "_domain" };
+    using Params = std::array<dct::paramVal,1>;
+    static constexpr dct::cschema::cComp t0_[]{ {cKind::lit, "load"} };
+    static constexpr std::array<dct::cschema::cTmplt,1> tmplts{
+        dct::cschema::cTmplt{t0_, 128, {}, 0x00}
+    };
+};
+
+struct pubValidator {
+    static constexpr std::string_view name{"#pubValidator"};
+    struct tag { enum : uint8_t { EdDSA }; };
+    static constexpr std::array<std::string_view,1> tags{ "EdDSA" };
+    using Params = std::array<dct::paramVal,1>;
+    static constexpr dct::cschema::cComp t0_[]{ {cKind::lit, "EdDSA"} };
+    static constexpr std::array<dct::cschema::cTmplt,1> tmplts{
+        dct::cschema::cTmplt{t0_, 128, {}, 0x00}
+    };
+};
+
+struct wireValidator {
+    static constexpr std::string_view name{"#wireValidator"};
+    struct tag { enum : uint8_t { EdDSA }; };
+    static constexpr std::array<std::string_view,1> tags{ "EdDSA" };
+    using Params = std::array<dct::paramVal,1>;
+    static constexpr dct::cschema::cComp t0_[]{ {cKind::lit, "EdDSA"} };
+    static constexpr std::array<dct::cschema::cTmplt,1> tmplts{
+        dct::cschema::cTmplt{t0_, 128, {}, 0x00}
+    };
+};
+
+} // namespace load_schema
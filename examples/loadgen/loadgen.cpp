@@ -0,0 +1,215 @@
+/*
+ * loadgen.cpp: mbps load generator for throughput testing
+ *
+ * Runs 'npubr' logical publishers in one process, each publishing 'rate'
+ * messages/sec of 'size' bytes spread round-robin over 'ntopic' topics, and
+ * subscribes to every topic, recording the delivery latency (from the
+ * message's 'mts' timestamp) and the loss (gaps in each publisher's sequence
+ * numbers) of the messages of other processes' publishers. A line of
+ * statistics is printed every second and totals at the end of the run so the
+ * throughput ceiling of a deployment is found by raising the rate (or the
+ * number of publishers/processes) until loss or latency climbs.
+ *
+ * Each message's content starts with its publisher's sequence number so
+ * receivers can count losses. Latencies across machines are only as good as
+ * their clock synchronization.
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+#include <getopt.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <unistd.h>
+
+#include "../util/dct_example.hpp"
+
+using dct::Histogram;
+
+// handles command line
+static struct option opts[] = {
+    {"addr", required_argument, nullptr, 'a'},
+    {"duration", required_argument, nullptr, 'd'},
+    {"help", no_argument, nullptr, 'h'},
+    {"publishers", required_argument, nullptr, 'p'},
+    {"rate", required_argument, nullptr, 'r'},
+    {"size", required_argument, nullptr, 's'},
+    {"topics", required_argument, nullptr, 't'},
+    {"quiet", no_argument, nullptr, 'q'}
+};
+static void usage(const char* cname)
+{
+    std::cerr << "usage: " << cname << " [flags] id.bundle\n";
+}
+static void help(const char* cname)
+{
+    usage(cname);
+    std::cerr << " flags:\n"
+           "  -a addr           transport addr, defaults to multicast\n"
+           "  -d |--duration    seconds to publish (default 10, 0 = forever)\n"
+           "  -h |--help        print help then exit\n"
+           "  -p |--publishers  logical publishers in this process (default 1, 0 = only subscribe)\n"
+           "  -q |--quiet       only print the totals\n"
+           "  -r |--rate        messages/sec per publisher (default 10)\n"
+           "  -s |--size        message bytes (default 100, at least 8)\n"
+           "  -t |--topics      topics to spread messages over (default 1)\n";
+}
+
+using Clock = std::chrono::system_clock;
+
+/* Globals */
+static std::string addr{};
+static std::string myId{};
+static size_t npubr{1}, ntopic{1}, msgSize{100};
+static double rate{10.};
+static std::chrono::seconds duration{10};
+static bool quiet{false};
+
+static std::vector<uint64_t> seq{};     // next sequence number of each local publisher
+static Clock::time_point start{};
+static uint64_t sent{}, nsent{};        // messages published (total, this interval)
+
+// what's been received from each remote publisher
+struct Pubr {
+    uint64_t first{}, last{};
+    uint64_t rcvd{};
+};
+static std::unordered_map<std::string,Pubr> pubrs{};
+static uint64_t nrcvd{};                // messages received this interval
+static Histogram lat{}, latAll{};       // delivery latency (us) this interval & whole run
+
+static uint64_t lost() {
+    uint64_t l{};
+    for (const auto& [_, p] : pubrs) l += (p.last - p.first + 1) - std::min(p.rcvd, p.last - p.first + 1);
+    return l;
+}
+
+/*
+ * Publish the messages that are due, i.e., i/(total rate) seconds after the
+ * start for the i'th message, round-robin over the publishers and topics, then
+ * check again in a millisecond. Catching up with the schedule rather than
+ * timing each message keeps the offered load right at high rates.
+ */
+static void publishDue(mbps& cm) {
+    auto el = std::chrono::duration<double>(Clock::now() - start).count();
+    if (duration.count() && el >= duration.count()) return;
+    auto due = uint64_t(el * rate * npubr) + 1;
+    std::vector<uint8_t> msg(msgSize);
+    for (; sent < due; ++sent, ++nsent) {
+        auto p = sent % npubr;
+        auto s = seq[p]++;
+        std::memcpy(msg.data(), &s, sizeof(s));
+        cm.publish(msgParms{{"topic", format("t{}", (sent / npubr) % ntopic)}, {"pubr", format("{}-{}", myId, p)}}, msg);
+    }
+    cm.oneTime(std::chrono::milliseconds(1), [&cm]{ publishDue(cm); });
+}
+
+static void msgRecv(mbps&, const mbpsMsg& mt, std::vector<uint8_t>& msg)
+{
+    auto pubr = mt["pubr"];
+    if (pubr.starts_with(myId + "-") || msg.size() < sizeof(uint64_t)) return; // ignore our own
+    uint64_t s;
+    std::memcpy(&s, msg.data(), sizeof(s));
+    auto [it, added] = pubrs.try_emplace(std::string(pubr), Pubr{s, s, 0});
+    auto& p = it->second;
+    if (s < p.first) p.first = s;
+    if (s > p.last) p.last = s;
+    ++p.rcvd;
+    ++nrcvd;
+    auto dt = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - mt.time("mts")).count();
+    if (dt < 0) dt = 0;
+    lat.add(dt);
+    latAll.add(dt);
+}
+
+static void report(mbps& cm, std::chrono::seconds interval) {
+    if (! quiet) {
+        print("{:.0f}s sent {} rcvd {} from {} pubrs lost {} | latency us {}\n",
+              std::chrono::duration<double>(Clock::now() - start).count(), nsent, nrcvd, pubrs.size(), lost(), lat.str());
+    }
+    nsent = nrcvd = 0;
+    lat.clear();
+    cm.oneTime(interval, [&cm, interval]{ report(cm, interval); });
+}
+
+int main(int argc, char* argv[])
+{
+    for (int c; (c = getopt_long(argc, argv, ":a:d:hp:qr:s:t:", opts, nullptr)) != -1;) {
+        switch (c) {
+                case 'a':
+                    addr = optarg;
+                    break;
+                case 'd':
+                    duration = std::chrono::seconds(std::stoi(optarg));
+                    break;
+                case 'h':
+                    help(argv[0]);
+                    exit(0);
+                case 'p':
+                    npubr = std::stoul(optarg);
+                    break;
+                case 'q':
+                    quiet = true;
+                    break;
+                case 'r':
+                    rate = std::stod(optarg);
+                    break;
+                case 's':
+                    msgSize = std::max<size_t>(std::stoul(optarg), sizeof(uint64_t));
+                    break;
+                case 't':
+                    ntopic = std::max<size_t>(std::stoul(optarg), 1);
+                    break;
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        exit(1);
+    }
+    readBootstrap(argv[optind]);
+    mbps cm(rootCert, []{return schemaCert();}, []{return identityChain();}, []{return getSigningPair();}, addr);
+    myId = format("{}.{}", cm.attribute("_roleId"), getpid());
+    seq.resize(npubr);
+    cm.subscribe(msgRecv);
+
+    try {
+        cm.connect([&cm]{
+                start = Clock::now();
+                if (npubr) publishDue(cm);
+                report(cm, std::chrono::seconds(1));
+                if (duration.count() == 0) return;
+                // allow two seconds for the last messages to arrive
+                cm.oneTime(duration + std::chrono::seconds(2), []{
+                        print("{}: published {} ({:.0f}/s) | received {} from {} pubrs, lost {} | latency us {}\n",
+                              myId, sent, sent / double(duration.count()), latAll.count(), pubrs.size(), lost(),
+                              latAll.str());
+                        exit(0);
+                    });
+            });
+    } catch (const std::exception& e) {
+        std::cerr << "main encountered exception while trying to connect: " << e.what() << std::endl;
+        exit(1);
+    }
+    cm.run();
+}
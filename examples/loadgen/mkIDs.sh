@@ -0,0 +1,23 @@
+#! /bin/bash
+# mkIDs [n] - script to create the id bundles gen1.bundle ... genN.bundle (default 4)
+#  needed to run loadgen with the load.rules schema
+PATH=../../../tools:$PATH
+
+n=${1:-4}
+Schema=load
+Bschema=$Schema.scm
+RootCert=$Schema.root
+SchemaCert=$Schema.schema
+
+schemaCompile -o $Bschema -c ${Schema}_schema.hpp $Schema.rules
+
+PubPrefix=$(schema_info $Bschema "#pubPrefix");
+CertValidator=EdDSA
+
+make_cert -s $CertValidator -o $RootCert $PubPrefix
+schema_cert -o $SchemaCert $Bschema $RootCert
+
+for i in $(seq 1 $n); do
+    make_cert -s $CertValidator -o gen$i.cert $PubPrefix/gen/gen$i $RootCert
+    make_bundle -v -o gen$i.bundle $RootCert $SchemaCert +gen$i.cert
+done
@@ -45,7 +45,7 @@ make_cert -s $CertValidator -o $RootCert $PubPrefix
 echo "made root cert"
 schema_cert -o $SchemaCert $Bschema $RootCert
 
-if [[ $(schema_info -t $Bschema "#wireValidator") =~ AEAD|PPAEAD|PPSIGN ]]; then
+if [[ $(schema_info -t $Bschema "#wireValidator") =~ AEAD|AESGCM|BLAKE2K|PPAEAD|PPSIGN ]]; then
     if [ -z $(schema_info -c $Bschema "KM") ]; then
     echo
     echo "- error: AEAD PDU encryption requires entity(s) with a KM (KeyMaker) Capability"
@@ -56,7 +56,7 @@ if [[ $(schema_info -t $Bschema "#wireValidator") =~ AEAD|PPAEAD|PPSIGN ]]; then
     KMCap=km
 fi;
 
-if [[ $(schema_info -t $Bschema "#pubValidator") =~ AEADSGN|PPSIGN ]]; then
+if [[ $(schema_info -t $Bschema "#pubValidator") =~ AEADSGN|AESGCMSGN|PPSIGN ]]; then
     if [ -z $(schema_info -c $Bschema "KMP") ]; then
     echo
     echo "- error: AEAD Pub encryption requires entity(s) with a KMP (KeyMaker Pubs) Capability"
@@ -34,7 +34,7 @@ CertValidator=EdDSA
 make_cert -s $CertValidator -o $RootCert $PubPrefix
 schema_cert -o $SchemaCert $Bschema $RootCert
 
-if [[ $(schema_info -t $Bschema "#wireValidator") =~ AEAD ]]; then
+if [[ $(schema_info -t $Bschema "#wireValidator") =~ AEAD|AESGCM|BLAKE2K ]]; then
     if [ -z $(schema_info -c $Bschema "KM") ]; then
         echo
         echo "- error: AEAD PDU encryption requires entity(s) with a KM (KeyMaker) Capability"
@@ -54,6 +54,8 @@
 #include <functional>
 #include <iostream>
 #include <chrono>
+#include <memory>
+#include <thread>
 
 #include "../util/dct_relay.hpp"
 
@@ -65,7 +67,9 @@ using namespace std::literals;
 static struct option opts[] = {
     {"debug", no_argument, nullptr, 'd'},
     {"help", no_argument, nullptr, 'h'},
-    {"listIOnames", required_argument, nullptr, 'l'}
+    {"listIOnames", required_argument, nullptr, 'l'},
+    {"threads", no_argument, nullptr, 't'},
+    {"verifyCache", required_argument, nullptr, 'v'}
 };
 static void usage(const char* cname)
 {
@@ -77,12 +81,16 @@ static void help(const char* cname)
     std::cerr << " flags:\n"
            "  -d |--debug       enable debugging output\n"
            "  -h |--help        print help then exit\n"
-           "  -l listIonames    defaults to ''\n";
+           "  -l listIonames    defaults to ''\n"
+           "  -t |--threads     run each DeftT on its own thread\n"
+           "  -v |--verifyCache n  remember the last ~n signature verifications so pubs\n"
+           "                    arriving on several DeftTs are only verified once\n";
 }
 
 /* Globals */
 
 static std::vector<ptps*> dtList{};
+static dct::relayFilter seenPubs{};  // pubs that have arrived on any DeftT
 bool skipValidatePubs = false;      // if set true, may skip validate on publish if DeftTs have the same trust schema
 uint32_t failThresh = 0;   //defaults to not set
 using ticks = std::chrono::duration<double,std::ratio<1,1000000>>;
@@ -93,7 +101,8 @@ static constexpr bool deliveryConfirmation = false; // get per-publication deliv
 /*
  * pubRecv is the callback passed to subscribe() which is invoked upon arrival of validated (crypto and
  * structural) Publications to DeftT s
- * Publication p is published to all the (other) DeftTs
+ * Publication p is published to all the (other) DeftTs whose schemas allow its topic.
+ * Pubs that were already relayed (copies arriving on other DeftTs in a mesh) are dropped.
  * publish() is used if schema is the same for all DeftTs or if the DeftTs with full schemas only subscribe to publications
  * that are defined in the sub-TSs. Otherwise publishValid() is recommended in order to check structural
  * validation against its schema.
@@ -103,14 +112,18 @@ static void pubRecv(ptps* s, const Publication& p) {
      print("{:%M:%S} {}:{}:{}\tpubRcv {}\n", ticks(now.time_since_epoch()), s->attribute("_role"), s->attribute("_roleId"),
           (s->label().size()? s->label() : "default"), p.name()); */
     try {
+        // a copy of a pub that's already been relayed (it came back via another relay) needs nothing
+        if (! seenPubs.firstSighting(p)) return;
+        // copied once and checked once per distinct trust schema, however many DeftTs it goes to
+        const relayPub rp{p};
         for (auto sp : dtList)  
-            if (sp != s) {
+            if (sp != s && sp->admitsTopic(p)) {
                 if(skipValidatePubs) {
                     // print("\trelayed w/o validate to interFace {}:{}\n", sp->label(), sp->attribute("_roleId"));
-                    sp->publish(Publication(p));
+                    sp->relay(rp, false);
                 } else {
                     // print("\trelayed to validate for interFace {}:{}\n", sp->label(), sp->attribute("_roleId"));
-                    sp->publishValid(Publication(p));
+                    sp->relay(rp, true);
                 }
             }
     } catch (const std::exception& e) {}
@@ -134,7 +147,7 @@ static void chainRecv(ptps* s, const rData c, const certStore& cs) {
         for (auto sp : dtList)
         if (sp != s) {
             //print("\trelaying a signing chain to interFace {}:{}\n", (sp->label().size()? sp->label() : "default"), sp->attribute("_roleId"));
-            sp->addRelayedChain(c, cs);
+            sp->relayChain(c, cs);
         }
     } catch (const std::exception& e) { }
 }
@@ -156,7 +169,7 @@ static void keyPubRecv(ptps* s, const Publication& p) {
     try {
         for (auto sp : dtList)
             if (sp != s) {
-                sp->publishKnown(Publication(p));
+                sp->relayKnown(p);
             }
     } catch (const std::exception& e) {}
 }
@@ -191,13 +204,14 @@ static void pubFailure(ptps* s, const Publication& pub) {
  */
 
 static int debug = 0;
+static bool threaded = false;   // each DeftT gets its own io_context & thread (pubs are handed off via ptps::relay's SPSC queues)
 
 int main(int argc, char* argv[])
 {
     std::string ccList{};
     // parse input line
     for (int c;
-        (c = getopt_long(argc, argv, "l:dh", opts, nullptr)) != -1;) {
+        (c = getopt_long(argc, argv, "l:dhtv:", opts, nullptr)) != -1;) {
         switch (c) {
                 case 'l':
                     ccList = optarg;
@@ -205,6 +219,12 @@ int main(int argc, char* argv[])
                 case 'd':
                     ++debug;
                     break;
+                case 't':
+                    threaded = true;
+                    break;
+                case 'v':
+                    dct::VerifyCache::enable(std::stoul(optarg));
+                    break;
                 case 'h':
                     help(argv[0]);
                     exit(0);
@@ -228,6 +248,9 @@ int main(int argc, char* argv[])
     //for each entry on list, create a ptps
     // (for failovers, might consider only creating a deftt when it is needed, depends on application)
     dtList.reserve(dtLabel.size());
+    using work = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
+    std::vector<std::unique_ptr<boost::asio::io_context>> iocs{};
+    std::vector<work> works{};
     for (const auto& l : dtLabel) {
         size_t m = l.find(" ", 0u);
         if(m == std::string::npos) {
@@ -236,14 +259,16 @@ int main(int argc, char* argv[])
         auto s_id = dtList.size();
         readBootstrap(l.substr(m+1));    // parse the bootstrap file for this DeftT shim
         try {
+            auto& ioc = threaded? *iocs.emplace_back(std::make_unique<boost::asio::io_context>()) : dct::getDefaultIoContext();
+            if (threaded) works.emplace_back(ioc.get_executor());
             if(!deliveryConfirmation) {
-                dtList.push_back( new ptps{rootCert,
+                dtList.push_back( new ptps{ioc, rootCert,
                                            [i=s_id]{return schemaCert(i);},
                                            [i=s_id]{return identityChain(i);},
                                            [i=s_id]{return getSigningPair(i);},
                                            l.substr(0u,m), chainRecv, keyPubRecv} );
             } else {
-                dtList.push_back( new ptps{rootCert,
+                dtList.push_back( new ptps{ioc, rootCert,
                                            [i=s_id]{return schemaCert(i);},
                                            [i=s_id]{return identityChain(i);},
                                            [i=s_id]{return getSigningPair(i);},
@@ -286,5 +311,13 @@ int main(int argc, char* argv[])
     // This test is only done if skipValidatePubs is set true initially. Offered as a non-recommended option.
     if (skipValidatePubs)
         skipValidatePubs = std::all_of(dtList.begin(), dtList.end(), [&tp](const auto i){ return i->schemaTP() == tp;});
+    // when threaded, DeftTs after the first each get a thread and this thread runs the first
+    std::vector<std::thread> threads{};
+    if (threaded) {
+        // relayed pubs, chains and key pubs cross threads via per-pair lock-free queues
+        for (auto s : dtList) s->relayPeers(dtList);
+        for (size_t i = 1; i < dtList.size(); ++i) threads.emplace_back([s=dtList[i]]{ s->run(); });
+    }
     dtList[0]->run();
+    for (auto& t : threads) t.join();
 }
@@ -44,7 +44,7 @@ fi;
 #
 # This part is for the multicast subdomains (that use Bschema)
 #
-if [[ $(schema_info -t $Bschema "#wireValidator") =~ AEAD|PPAEAD|PPSIGN ]]; then
+if [[ $(schema_info -t $Bschema "#wireValidator") =~ AEAD|AESGCM|BLAKE2K|PPAEAD|PPSIGN ]]; then
     if [ -z $(schema_info -c $Bschema "KM") ]; then
 	echo
 	echo "- error: AEAD PDU encryption requires entity(s) with a KM (KeyMaker) Capability"
@@ -57,7 +57,7 @@ if [[ $(schema_info -t $Bschema "#wireValidator") =~ AEAD|PPAEAD|PPSIGN ]]; then
     DeviceSigner=$KMCapCert
 fi;
 
-if [[ $(schema_info -t $Bschema "#pubValidator") =~ AEADSGN|PPSIGN ]]; then
+if [[ $(schema_info -t $Bschema "#pubValidator") =~ AEADSGN|AESGCMSGN|PPSIGN ]]; then
     if [ -z $(schema_info -c $Bschema "KMP") ]; then
 	echo
 	echo "- error: AEAD Pub encryption requires entity(s) with a KMP (KeyMaker Pubs) Capability"
@@ -120,7 +120,7 @@ done
 # keymaker for the wireValidator of that subdomain
 #
 KMCapCert=
-if [[ $(schema_info -t $Eschema "#wireValidator") =~ AEAD|PPAEAD|PPSIGN ]]; then
+if [[ $(schema_info -t $Eschema "#wireValidator") =~ AEAD|AESGCM|BLAKE2K|PPAEAD|PPSIGN ]]; then
     if [ -z $(schema_info -c $Eschema "KM") ]; then
 	echo
 	echo "- error: AEAD PDU encryption requires entity(s) with a KM (KeyMaker) Capability"
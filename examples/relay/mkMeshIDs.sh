@@ -32,8 +32,8 @@ schema_cert -o $SchemaCert $Bschema $RootCert
 schema_cert -o sensor.schema sensor.scm $RootCert
 
 # if main mesh schema uses AEAD must set keymaker
-if [[ $(schema_info -t $Bschema "#wireValidator") =~ AEAD|AEADSGN|PPAEAD|PPSIGN ||
-      $(schema_info -t $Bschema "#pubValidator") =~ AEADSGN|PPSIGN ]]; then
+if [[ $(schema_info -t $Bschema "#wireValidator") =~ AEAD|AESGCM|BLAKE2K|AEADSGN|PPAEAD|PPSIGN ||
+      $(schema_info -t $Bschema "#pubValidator") =~ AEADSGN|AESGCMSGN|PPSIGN ]]; then
     if [ -z $(schema_info -c $Bschema "KM") ]; then
 	echo
 	echo "- error: AEAD encryption requires entity(s) with a KM (KeyMaker) Capability"
@@ -38,6 +38,7 @@ using namespace std::literals;
 using dct::ptps;
 using dct::parItem;
 using dct::Publication;
+using dct::relayPub;
 using dct::rData;
 using dct::certStore;
 
@@ -69,7 +69,8 @@ static inline std::vector<dctCert> identityChain(int i=0) { return idChain[i]; }
 
 static inline void readBootstrap(std::string_view bootstrap) {
     // cb is made up of certItems - pair <dctCert,keyVal> where all keyVals are empty except last
-    auto cb = rdCertBundle(fileToVec(bootstrap));
+    // (loadBundle parses the mapped file once and keeps the result)
+    const auto& cb = loadBundle(bootstrap);
     if(cb.size() < 3) {
         print("readBootstrap for shim {} only has {} certs when at least 3 are needed\n", root.size(), cb.size());
         exit(0);
@@ -84,11 +85,9 @@ static inline void readBootstrap(std::string_view bootstrap) {
     // schema is next
     schema.push_back(cb[1].first);
     // extract the identity chain of certs
-    std::vector<dctCert> ic{};
-    for (size_t c = 2; c < cb.size(); c++) {
-        ic.push_back(cb[c].first);     //add to
-    }
-    idChain.push_back(ic);  // add this identity chain to the vector
+    auto& ic = idChain.emplace_back();  // add this identity chain to the vector
+    ic.reserve(cb.size() - 2);
+    for (size_t c = 2; c < cb.size(); c++) ic.push_back(cb[c].first);
     idSecretKey.push_back(cb.back().second);    // final item in chain has the secret key
 }
 
@@ -0,0 +1,78 @@
+#ifndef DCT_COARSE_CLOCK_HPP
+#define DCT_COARSE_CLOCK_HPP
+#pragma once
+/*
+ * coarseClock: a cheap, low resolution wall clock for expiry & validity checks
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This is not intended as production code.
+ */
+
+#include <chrono>
+#include <time.h>
+
+namespace dct {
+
+/*
+ * Checking whether a pub has expired or a cert is in its validity period is done
+ * for every arriving pub and cert and only needs to be good to a few milliseconds
+ * (pub lifetimes have 'maxClockSkew' slack, cert periods are in seconds). On Linux
+ * CLOCK_REALTIME_COARSE is the time as of the last timer tick, read from the vDSO
+ * without a syscall or reading the clock hardware, so it's much cheaper than
+ * system_clock::now() (it lags that by up to a timer tick, a few ms). Elsewhere it's system_clock.
+ *
+ * coarseClock has system_clock's time_point so it can be used where system_clock
+ * is. It must *not* be used to make the timestamps in pub names: two pubs made
+ * within a tick would get the same name.
+ */
+struct coarseClock {
+    using duration = std::chrono::system_clock::duration;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::system_clock::time_point;
+    static constexpr bool is_steady = false;
+
+    static time_point now() noexcept {
+#ifdef CLOCK_REALTIME_COARSE
+        timespec ts;
+        if (clock_gettime(CLOCK_REALTIME_COARSE, &ts) == 0)
+            return time_point(std::chrono::duration_cast<duration>(std::chrono::seconds(ts.tv_sec) +
+                                                                   std::chrono::nanoseconds(ts.tv_nsec)));
+#endif
+        return std::chrono::system_clock::now();
+    }
+
+    // how far now() can lag the time (a timer tick, from clock_getres). Something
+    // made at system_clock::now() can look up to this far in the future.
+    static duration resolution() noexcept {
+#ifdef CLOCK_REALTIME_COARSE
+        static const duration res = [] {
+            timespec ts;
+            if (clock_getres(CLOCK_REALTIME_COARSE, &ts) != 0) return duration{};
+            return std::chrono::duration_cast<duration>(std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec));
+        }();
+        return res;
+#else
+        return duration{};
+#endif
+    }
+};
+
+} // namespace dct
+
+#endif // DCT_COARSE_CLOCK_HPP
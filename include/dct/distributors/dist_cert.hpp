@@ -10,6 +10,12 @@
  * its signing chain as dctCert Publications.  On receiving a new
  * Publication, callback to addCertCb.
  *
+ * The bootstrap signing chain is published as 'cert bundle' Publications
+ * (named <pubprefix>/CB/<timestamp>) whose content is as many wire format
+ * certs as fit in a Publication. A joining peer then gets a chain as one or
+ * two collection items instead of one per cert. The collection's IBLT
+ * exchange makes sure a peer only gets the bundles it lacks.
+ *
  * Copyright (C) 2020-2 Pollere LLC
  *
  *  This program is free software; you can redistribute it and/or modify
@@ -55,17 +61,23 @@ using connectedCb = std::function<void(bool)>;
 struct DistCert
 {    
     crName m_pubPrefix;  //prefix for subscribe()
+    crName m_cbPrefix;   //prefix for cert bundle pubs
     SigMgrAny m_syncSigMgr{sigMgrByType("RFC7693")}; // to sign/validate SyncData packets
     SigMgrAny m_certSigMgr{sigMgrByType("NULL")};   // to sign/validate Publications
     SyncPS m_sync;
+    boost::asio::io_context& m_ioc;
     connectedCb m_connCb{[](bool){}};   // called when initial cert exchange done
     std::unordered_set<size_t> m_initialPubs{};
+    std::unordered_set<size_t> m_bundled{};     // certs that arrived in a bundle
     bool m_havePeer{false};
     bool m_initDone{false};
+    bool m_bootPending{false};                  // bootstrap certs not bundled yet
+    std::vector<crData> m_batch{};              // relayed certs waiting to be bundled
+    std::chrono::milliseconds m_batchWin{50};   // how long relayed certs are collected
 
     DistCert(DirectFace& face, const Name& pPre, const Name& wPre, addCertCb&& addCb, IsExpiredCb&& eCb) :
-        m_pubPrefix{pPre},
-        m_sync(face, wPre, m_syncSigMgr.ref(), m_certSigMgr.ref())
+        m_pubPrefix{pPre}, m_cbPrefix{pPre/"CB"},
+        m_sync(face, wPre, m_syncSigMgr.ref(), m_certSigMgr.ref()), m_ioc{face.getIoContext()}
         //m_addCertCb{std::move(addCb)}
     {
         m_sync.cStateLifetime(4789ms);
@@ -79,6 +91,17 @@ struct DistCert
                 });
 #endif
 
+        // a bundle's certs are handed to addCb one at a time (so any order works)
+        m_sync.subscribe(m_cbPrefix, [this, addCb](const auto& p) {
+                    try {
+                        auto content = p.content();
+                        for (auto c : content) {
+                            if (c[0] != 6) return;  // bundle pubs only contain Data
+                            m_bundled.emplace(std::hash<tlvParser>{}(c));
+                            addCb(rData(c));
+                        }
+                    } catch (const std::runtime_error&) { }
+                });
         m_sync.subscribe(m_pubPrefix, std::move(addCb));
     }
 
@@ -99,16 +122,48 @@ struct DistCert
         m_connCb(true);
     }
 
+    /*
+     * A cert arrived before its signer. Send our cState soon so any peer that has
+     * certs we lack sends them rather than waiting for the next periodic cState.
+     */
+    void requestMissing() { m_sync.sendCStateSoon(); }
+
     /*
      * Certstore has validated and accepted a peer's cert.
      */
     void publishCert(const rData c) {
         m_havePeer = true;
-        if (! m_initDone && m_initialPubs.empty()) initDone();
-        // ensure publication of relayed (or new local) certs
+        if (! m_initDone && ! m_bootPending && m_initialPubs.empty()) initDone();
+        // ensure publication of relayed (or new local) certs. A cert that came in a bundle
+        // is already in the collection.
+        if (m_bundled.contains(std::hash<tlvParser>{}(c))) return;
         m_sync.publish(c);
     }
 
+    /*
+     * As above for a cert relayed from another DeftT. When devices rotate their
+     * signing keys a relay gets a stream of new chain suffixes so rather than a
+     * pub per cert, the relayed certs that arrive within 'm_batchWin' of the first
+     * are published together in as few cert bundles as possible (in arrival order,
+     * which is signer first for relayed chains). A zero window publishes each cert.
+     */
+    void batchWindow(std::chrono::milliseconds w) { m_batchWin = w; }
+
+    void publishRelayed(const rData c) {
+        if (m_batchWin == 0ms) { publishCert(c); return; }
+        m_havePeer = true;
+        if (! m_initDone && ! m_bootPending && m_initialPubs.empty()) initDone();
+        if (! m_bundled.emplace(std::hash<tlvParser>{}(c)).second) return;
+        if (m_batch.empty()) m_sync.oneTime(m_batchWin, [this] { flushBatch(); });
+        m_batch.emplace_back(c);
+    }
+
+    void flushBatch() {
+        std::vector<rData> certs(m_batch.begin(), m_batch.end());
+        bundle(certs, [this](crData&& p) { m_sync.publish(std::move(p)); });
+        m_batch.clear();
+    }
+
     /*
      * publish bootstrap / local identity certs to the collection
      * 
@@ -125,21 +180,69 @@ struct DistCert
      * aggressive, and the 'connect' callback is called to move to the next
      * phase of operation.
      */
-    void initialPub(const rData c) {
+    void initialPub(crData&& c) {
         if (! m_initDone) {
             auto h = std::hash<tlvParser>{}(c);
             m_initialPubs.emplace(h);
-            m_sync.publish(c, [this, h](const auto& /*d*/, bool /*acked*/) {
+            m_sync.publish(std::move(c), [this, h](const auto& /*d*/, bool /*acked*/) {
                         // since cert pub lifetime is infinite 'acked' should always be true
                         // when this routine is called. If all the initial pubs have been acked
                         // and we have at least one peer's signing chain, initialization is done.
                         m_initialPubs.erase(h);
-                        if (m_havePeer && m_initialPubs.empty())
+                        if (m_havePeer && ! m_bootPending && m_initialPubs.empty())
                             initDone();
                     });
             return;
         }
-        m_sync.publish(c);
+        m_sync.publish(std::move(c));
+    }
+    void initialPub(const rData c) { initialPub(crData{c}); }
+
+    // pack 'certs' into as few cert bundles as possible, handing each to 'pub'
+    template<typename Certs, typename Pub>
+    void bundle(const Certs& certs, Pub&& pub) {
+        // space for the bundle's name, metainfo and (NULL) signature
+        static constexpr size_t maxBundle = maxPubSize - 128;
+        std::vector<uint8_t> buf{};
+        const auto flush = [this, &buf, &pub] {
+            if (buf.empty()) return;
+            crData p(m_cbPrefix/std::chrono::system_clock::now(), buf.size());
+            p.content(buf);
+            m_certSigMgr.sign(p);
+            pub(std::move(p));
+            buf.clear();
+        };
+        for (const auto& c : certs) {
+            auto s = c.asSpan();
+            if (s.size() > maxBundle) {
+                pub(crData{c});  // doesn't fit in a bundle
+                continue;
+            }
+            if (buf.size() + s.size() > maxBundle) flush();
+            buf.insert(buf.end(), s.begin(), s.end());
+        }
+        flush();
+    }
+
+    /*
+     * publish the bootstrap certs 'certs' packed into as few cert bundles as possible
+     *
+     * A restart with a snapshot gets back the bundles made last time when the
+     * collection starts so this waits for that (the collection's start is queued
+     * when it's constructed so it runs first) then bundles only the certs that
+     * weren't in one. If they all were, the bootstrap half of initialization is
+     * already done.
+     */
+    void initialPubs(const std::vector<rData>& certs) {
+        m_bootPending = true;
+        std::vector<crData> boot(certs.begin(), certs.end());
+        boost::asio::post(m_ioc, [this, boot = std::move(boot)] {
+                    m_bootPending = false;
+                    std::vector<crData> certs{};
+                    for (const auto& c : boot) if (! m_bundled.contains(std::hash<tlvParser>{}(c))) certs.emplace_back(c);
+                    bundle(certs, [this](crData&& p) { initialPub(std::move(p)); });
+                    if (! m_initDone && m_havePeer && m_initialPubs.empty()) initDone();
+                });
     }
 };
 
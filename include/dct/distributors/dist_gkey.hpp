@@ -19,6 +19,10 @@
  * subtopic mr is used by members of the group to request a copy of the encryption key, and
  * subtopic gk is used by the key maker to publish key records where the symmetric key is encrypted
  *      for each valid member of the group.
+ *
+ * For large groups the key maker can instead distribute the key via a key tree (see key_tree.hpp,
+ * enabled with useKeyTree()). Key records then carry tree node keys and a removal only needs
+ * O(log n) records rather than one per member.
  * The PDU prefix the distributor's sync uses is <tp_id>/keys/<pubs || pdus>, in the "keys" collection
  * 
  * Copyright (C) 2020-3 Pollere LLC
@@ -43,6 +47,7 @@
 #include <algorithm>
 #include <cstring> // for memcmp
 #include <functional>
+#include <unordered_map>
 #include <utility>
 
 #include <dct/schema/capability.hpp>
@@ -52,6 +57,7 @@
 #include <dct/sigmgrs/sigmgr_by_type.hpp>
 #include <dct/syncps/syncps.hpp>
 #include <dct/utility.hpp>
+#include "key_tree.hpp"
 #include "km_election.hpp"
 
 using namespace std::literals::chrono_literals;
@@ -77,6 +83,8 @@ struct DistGKey {
      */
     using gkr = std::pair<const thumbPrint, encGK>;
     static constexpr int maxKR = (maxPubSize - 96) / (sizeof(thumbPrint) + encGKeySz);
+    // key tree records per Publication
+    static constexpr int maxTR = (maxPubSize - 96) / sizeof(keyTree::rec);
 
     const crName m_prefix;        // prefix for pubs in this distributor's collection
     const crName m_gkPrefix;     // prefix for group symmetric key list publications
@@ -95,17 +103,31 @@ struct DistGKey {
     keyVal m_curKey{};          // current group key
     uint64_t m_curKeyCT{};      // current key creation time in microsecs
     std::map<thumbPrint,xmpk> m_mbrList{};
+    std::unordered_map<thumbPrint,xmpk> m_xpk{};  // converted public keys of (potential) members
 
     std::chrono::milliseconds m_reKeyInt{3600};
     std::chrono::milliseconds m_keyRand{10};
     std::chrono::milliseconds m_keyLifetime{3600+10};
     kmElection* m_kme{};
+    std::chrono::milliseconds m_kaInt{5000}; // keymaker keepalive interval (failover after 3 missed)
     uint32_t m_KMepoch{};        // current election epoch
     bool m_keyMaker{false};      // true if this entity is a key maker
     bool m_init{true};                  // key maker status unknown while in initialization
     bool m_pubdist = false;        // true indicates this is a pub group key distributor (not pdu)
     bool m_mrPending{false};    //member request pending
-    pTimer m_mrRefresh{std::make_shared<Timer>(getDefaultIoContext())};
+    TimerHandle m_mrRefresh{};
+    static constexpr std::chrono::milliseconds mrMinDelay{2000};  // member request refresh backs off
+    static constexpr std::chrono::milliseconds mrMaxDelay{32000}; //  from mrMinDelay to mrMaxDelay
+    std::chrono::milliseconds m_mrDelay{mrMinDelay};
+    std::shared_ptr<CryptoPool> m_crypto{}; // if set, rekey sealing is done on its threads
+    std::chrono::milliseconds m_batchDelay{50}; // window for batching joins and coalescing rekeys
+    Histogram m_rekeyUs{};              // time to make and publish each new key (keymaker, microseconds)
+    std::chrono::milliseconds m_keyLead{1000};  // how far ahead of its use a replacement key is sent
+    std::vector<thumbPrint> m_joins{};  // members whose key records are waiting to be published (sorted, unique)
+    TimerHandle m_joinTimer{};
+    bool m_reKeyPending{false};         // a rekey to remove member(s) is scheduled
+    bool m_useTree{false};              // distribute the key with a key tree
+    keyTree m_ktree{};
 
     DistGKey(DirectFace& face, const Name& pPre, const Name& dPre, addKeyCb&& gkeyCb, const certStore& cs,
              std::chrono::milliseconds reKeyInterval = std::chrono::seconds(3600), //XXX make methods
@@ -117,8 +139,9 @@ struct DistGKey {
              m_keyLifetime(m_reKeyInt + m_keyRand) {
        m_sync.cStateLifetime(253ms);
        m_sync.pubLifetime(std::chrono::milliseconds(reKeyInterval + reKeyRandomize + expirationGB));
-       m_sync.getLifetimeCb([this,cand=crPrefix(m_prefix/"km"/"cand"),mreq=crPrefix(m_mrPrefix)](const auto& p) {
+       m_sync.getLifetimeCb([this,cand=crPrefix(m_prefix/"km"/"cand"),elec=crPrefix(m_prefix/"km"/"elec"),mreq=crPrefix(m_mrPrefix)](const auto& p) {
             if (mreq.isPrefix(p.name())) return 6000ms;  // member request could last for a key lifetime
+            if (elec.isPrefix(p.name()) && m_kaInt > 0ms) return 3 * m_kaInt; // winner keeps refreshing it
             return cand.isPrefix(p.name())? 1000ms : m_keyLifetime; //election winner's km/elec should last indefinitely
             });
 #if 0
@@ -151,21 +174,37 @@ struct DistGKey {
         /* using ticks = std::chrono::duration<double,std::ratio<1,1000000>>;
         auto now = std::chrono::system_clock::now();
         print("{:%M:%S} {} publishes a {} membership request\n",  ticks(now.time_since_epoch()), m_certs[m_tp].name(), m_sync.collName_.last().toSv()); */
-        m_mrRefresh->cancel();  // if a membership request refresh is scheduled, cancel it
+        m_mrRefresh.cancel();  // if a membership request refresh is scheduled, cancel it
         crData p(m_mrPrefix/std::chrono::system_clock::now());
         p.content(std::vector<uint8_t>{});
         m_keySM.sign(p);    // will put my thumbprint into Publication
         m_mrPending = true;
         m_sync.publish(std::move(p));
-        m_mrRefresh = m_sync.schedule(2000ms, [this](){ publishMembershipReq(); });
+        m_mrRefresh = m_sync.schedule(jitter(m_mrDelay), [this](){ publishMembershipReq(); });
+        m_mrDelay = std::min(2 * m_mrDelay, mrMaxDelay);
+    }
+
+    // 'd' randomized to between d/2 and 3d/2 so members don't act in lockstep
+    static std::chrono::milliseconds jitter(std::chrono::milliseconds d) {
+        return d / 2 + std::chrono::milliseconds(randombytes_uniform(d.count() + 1));
+    }
+
+    // A new key was published without a record for me. Publish a membership request
+    // after a jittered delay (so a keymaker restart doesn't get every member's request
+    // at once) unless one is already out or scheduled. It's suppressed if a record for
+    // me shows up in the meantime.
+    void requestMembershipSoon() {
+        if (m_mrPending || m_mrRefresh.pending()) return;
+        m_mrRefresh = m_sync.schedule(jitter(mrMinDelay), [this](){ publishMembershipReq(); });
     }
 
     // Called when a group key has been received and decrypted. Cancel any pending refresh
     // of the membership request. It will be reissued only if a new group key record is received
     // and I'm not in the list
     void receivedGK() {
-        m_mrRefresh->cancel();  // if a membership request refresh is scheduled, cancel it
+        m_mrRefresh.cancel();  // if a membership request refresh is scheduled, cancel it
         m_mrPending = false;
+        m_mrDelay = mrMinDelay;
         //print("{} got a valid {} GK\n", m_certs[m_tp].name(), m_sync.collName_.last().toSv());
     }
 
@@ -232,8 +271,8 @@ struct DistGKey {
             return;
         }
         if (m_keyMaker) {
-            // another member claims to be a keyMaker - largest thumbPrint wins
-            if (m_tp < p.thumbprint()) {
+            // another member claims to be a keyMaker - later epoch (re-election) or largest thumbPrint wins
+            if (m_tp < p.thumbprint() || p.name().nextAt(m_gkPrefix.size()).toNumber() > m_KMepoch) {
                     print("keymaker got keylist from {}\n", m_certs[p].name());
                     m_keyMaker = false;
                     m_kmtp = p.thumbprint();
@@ -255,18 +294,18 @@ struct DistGKey {
         auto n = p.name();
         auto epoch = n.nextAt(m_gkPrefix.size()).toNumber();
         if (epoch != m_KMepoch) {
-            if (epoch > 1) { // XXX change this when re-elections supported
-                print("keylist ignored: bad epoch {} in {} from {}\n", epoch, p.name(), m_certs[p].name());
-                return;
-            }
-            //assert(m_KMepoch == 0);
+            if (epoch < m_KMepoch) return;  // from a keymaker that's since been replaced
             m_KMepoch = epoch;
             m_kmtp.fill(0);     //new epoch, reset my record of keymaker tp
         }
         // check if keymaker has a larger tp than my stored value (can resolve conflict after elections though can happen in
         // relayed domains in particular), if so, (re)set my saved value and cur key ct so I get a new key
         // if keyMaker rekeyed with a smaller tp, m_kmtp is not going to change but shouldn't matter since after election
-        if (m_kmtp < p.thumbprint())    { m_curKeyCT = 0; m_kmtp = p.thumbprint(); }
+        if (m_kmtp < p.thumbprint())    { m_curKeyCT = 0; m_kmtp = p.thumbprint(); m_ktree.resetMember(); }
+        if (m_useTree) {
+            receiveKeyTree(p);
+            return;
+        }
 
         // check if I'm in this publication's range
         static constexpr auto less = [](const auto& a, const auto& b) -> bool {
@@ -277,21 +316,8 @@ struct DistGKey {
             return r < 0;
         };
 
-        decltype(m_curKeyCT) newCT{};   //decode the new key's creation time
-
-        auto tpl = n.nextBlk().toSpan();
-        auto tph = n.nextBlk().toSpan();
-        auto tpId = std::span(m_tp).first(tpl.size());
-        if(less(tpId, tpl) || less(tph, tpId)) {
-            // no key for me in this pub
-            if (std::cmp_less(m_curKeyCT, newCT) && !m_mrPending) {
-                // new key is being published, make sure keymaker has my membership
-                m_sync.oneTime(2000ms, [this](){ publishMembershipReq(); } ) ;
-            }
-            return;
-        }
-
         // decode the content of the GK list
+        decltype(m_curKeyCT) newCT{};   //decode the new key's creation time
         std::span<const gkr> gkrVec{};
         try {
             auto content = p.content();
@@ -299,12 +325,25 @@ struct DistGKey {
             // a new key will have a creation time larger than m_curKeyCT
             // (future: ensure it's from the same creator as last time?)
             newCT = content.nextBlk(36).toNumber();
-            if(newCT <= m_curKeyCT) return; // group key not newer than ours 
             // the second tlv should be type 130 and should be a vector of gkr pairs
             gkrVec = content.nextBlk(130).toSpan<gkr>();
         } catch (std::runtime_error& ex) {
             return; //ignore this publication
         }
+
+        auto tpl = n.nextBlk().toSpan();
+        auto tph = n.nextBlk().toSpan();
+        auto tpId = std::span(m_tp).first(tpl.size());
+        if(less(tpId, tpl) || less(tph, tpId)) {
+            // no key for me in this pub. If it's a new key, make sure keymaker has my membership
+            if (std::cmp_less(m_curKeyCT, newCT)) requestMembershipSoon();
+            return;
+        }
+        if(newCT <= m_curKeyCT) {
+            // the keymaker has me (this is a record for my current key) so a scheduled request isn't needed
+            if (newCT == m_curKeyCT && !m_mrPending) m_mrRefresh.cancel();
+            return;
+        }
         auto it = std::find_if(gkrVec.begin(), gkrVec.end(), [this](auto p){ return p.first == m_tp; });
         if (it == gkrVec.end())      return;  // didn't find our encrypted key in pub
 
@@ -321,6 +360,35 @@ struct DistGKey {
         if (m_init)  initDone();    // member has a key, can exit init state
     }
 
+    /*
+     * Key tree version of receiveGKeyList. Content is the key creation time (tlv 36),
+     * the tree depth (tlv 37) and the key records (tlv 131).
+     * gk names <m_gkPrefix><epoch><node><under><timestamp> (node & under of the first record)
+     */
+    void receiveKeyTree(const rPub& p) {
+        uint64_t newCT{};
+        try {
+            auto content = p.content();
+            newCT = content.nextBlk(36).toNumber();
+            auto depth = content.nextBlk(37).toNumber();
+            auto recs = content.nextBlk(131).toSpan<keyTree::rec>();
+            if (! m_ktree.receive(recs, newCT, depth, m_tp, m_pDecKey, m_sDecKey)) {
+                // new key is being published and I'm not in the tree, make sure keymaker has my membership
+                if (std::cmp_less(m_curKeyCT, newCT) && m_ktree.myLeaf_ == 0) requestMembershipSoon();
+                return;
+            }
+        } catch (std::runtime_error& ex) {
+            return; //ignore this publication
+        }
+        const auto* rk = m_ktree.rootKey();
+        if (rk->ct <= m_curKeyCT) return;   // group key not newer than ours
+        m_curKeyCT = rk->ct;
+        m_curKey = rk->key;
+        m_newKeyCb(m_curKey, m_curKeyCT);   // call back parent with new key
+        receivedGK();
+        if (m_init)  initDone();    // member has a key, can exit init state
+    }
+
     /*
      * setup() is called from a connect() function in dct_model, typically
      * after some initial signing certs have been exchanged so it's known
@@ -361,17 +429,28 @@ struct DistGKey {
         // elections need to be longer for relayed trust domains
         if (m_kmpri(m_tp) > 0 ) {
             auto eDone = [this](auto elected, auto epoch) {
+                            auto wasKM = m_keyMaker;
                             m_keyMaker = elected;
                             m_KMepoch = epoch;
                             // all members  subscribe to group key subcollection; keymakers subscribe in case of conflicts
                             m_sync.subscribe(m_gkPrefix, [this](const auto& p){ receiveGKeyList(p); });
-                            if (! elected)   return;
-                            //print("{} wins election to make {} GKs\n", m_certs[m_tp].name(), m_sync.collName_.last().toSv());
+                            if (! elected) {
+                                if (! wasKM) return;
+                                // replaced by a re-election so become a member of the new keymaker's group
+                                m_sync.unsubscribe(m_mrPrefix);
+                                m_mbrList.clear();
+                                m_curKeyCT = 0;
+                                publishMembershipReq();
+                                return;
+                            }
                             // keymakers need the member requests
                             m_sync.subscribe(m_mrPrefix, [this](const auto& p){ addGroupMem(p); });
-                            gkeyTimeout();  //create a group key and reschedule group key creation
+                            if (! wasKM) gkeyTimeout();  //create a group key and reschedule group key creation
                           };
-            m_kme = new kmElection(m_prefix/"km", m_keySM.ref(), m_sync, std::move(eDone), std::move(kmpri), m_tp, m_pubdist? 5s : 500ms);
+            // skip the election wait if no known cert can outrank us. The keymaker's keepalive
+            // lets the others elect a replacement if it fails.
+            m_kme = new kmElection(m_prefix/"km", m_keySM.ref(), m_sync, std::move(eDone), std::move(kmpri), m_tp, m_pubdist? 5s : 500ms,
+                                   kmFastPath(m_certs, m_kmpri, m_tp), m_kaInt);
         } else { // non-keymaker,  subscribe to group key subcollection
             m_sync.subscribe(m_gkPrefix, [this](const auto& p){ receiveGKeyList(p); });
         }
@@ -390,6 +469,40 @@ struct DistGKey {
         m_sync.publish(std::move(p));
     }
 
+    // Publish key tree records, maxTR per pub. An empty 'recs' publishes one empty pub
+    // so a new keymaker still asserts its role.
+    void publishKeyTree(const std::vector<keyTree::rec>& recs, auto ts) {
+        auto it = recs.begin();
+        do {
+            auto r = std::min<size_t>(recs.end() - it, maxTR);
+            auto id = r? std::pair{it->node, it->under} : std::pair{0u, 0u};
+            tlvEncoder tkrEnc{};    //tlv encoded content
+            tkrEnc.addNumber(36, m_curKeyCT);
+            tkrEnc.addNumber(37, m_ktree.depth_);
+            tkrEnc.addArray(131, std::span(it, r));
+            it += r;
+            crData p(m_gkPrefix/m_KMepoch/id.first/id.second/ts);
+            p.content(tkrEnc.vec());
+            m_keySM.sign(p);
+            m_sync.publish(std::move(p));
+        } while (it != recs.end());
+    }
+
+    // make a new key, timing it (with crypto pool sealing only the local part is timed).
+    // 'staged' pre-stages it (see makeGKey), which only a periodic refresh may do.
+    void rekey(bool staged = false) {
+        auto t0 = std::chrono::steady_clock::now();
+        makeGKey(staged);
+        m_rekeyUs.since(t0);
+    }
+
+    // add the memory used by the distributor's collection and member list to 'r'
+    void memUse(MemReport& r, std::string_view nm) const {
+        m_sync.memUse(r);
+        r.add(format("{} members", nm), m_mbrList.size(),
+              mem::map(m_mbrList) + mem::hash(m_xpk) + mem::vec(m_joins) + mem::hash(m_ktree.key_) + mem::hash(m_ktree.cnt_));
+    }
+
     /*
      * Make a new group key, publish it, and locally switch to using the new key.
      * A keymaker that has just won an election will publish an empty gk list to assert its win
@@ -400,18 +513,65 @@ struct DistGKey {
      *
      * If in init state and there are group members, call initDone to exit init and callback to start
     */
-    void makeGKey() {
+    void makeGKey(bool staged = false) {
         //make a new key
         m_curKey.resize(aeadKeySz); // crypto_aead_xchacha20poly1305_IETF_KEYBYTES
         crypto_aead_xchacha20poly1305_ietf_keygen(m_curKey.data());
         //print("{} makes a new {} GK\n", m_certs[m_tp].name(), m_sync.collName_.last().toSv());
-        //set the key's creation time
-        m_curKeyCT = std::chrono::duration_cast<std::chrono::microseconds>(
-                        std::chrono::system_clock::now().time_since_epoch()).count();
+        //set the key's creation time. A periodic replacement key is pre-staged: its creation time
+        //is m_keyLead in the future and senders keep using the current key until then so members
+        //have the new key before the first packet encrypted with it (see sigmgr.hpp). A rekey that
+        //excludes a removed member takes effect at once. Creation times always increase (members
+        //ignore older keys) so one made while a key is pre-staged is just after it and senders
+        //use it right away since it supersedes the pre-staged key (see sigmgr.hpp signingKey).
+        std::chrono::microseconds lead{};
+        if (staged && m_curKeyCT) lead = std::min(m_keyLead, m_reKeyInt / 2);
+        m_curKeyCT = std::max<uint64_t>(m_curKeyCT + 1, std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::system_clock::now().time_since_epoch() + lead).count());
+        // the new key's records cover all the members so nothing that's waiting needs to be sent
+        m_joins.clear();
+        m_joinTimer.cancel();
+        m_reKeyPending = false;
 
         // remove expired certs (thumbprints) from memberList
-        auto now = std::chrono::system_clock::now();
-        std::erase_if(m_mbrList, [this,now](auto& kv) { return m_certs.contains(kv.first)? rCert(m_certs[kv.first]).validUntil() <= now : true; });
+        auto now = coarseClock::now();
+        std::erase_if(m_mbrList, [this,now](auto& kv) {
+                if (m_certs.contains(kv.first) && m_certs[kv.first].validUntil() > now) return false;
+                m_ktree.leave(kv.first);
+                m_xpk.erase(kv.first);
+                return true;
+            });
+
+        auto pubTS = std::chrono::system_clock::now();
+        if (m_useTree) {
+            // new keys for the root and the paths of removed members then add any members
+            // that aren't in the tree yet
+            auto recs = m_ktree.rekey(m_curKey);
+            for (const auto& [tp, pk] : m_mbrList) {
+                auto jr = m_ktree.join(tp, pk);
+                recs.insert(recs.end(), jr.begin(), jr.end());
+            }
+            publishKeyTree(recs, pubTS);
+            m_newKeyCb(m_curKey, m_curKeyCT);
+            if(m_init && m_mbrList.size())  initDone();
+            return;
+        }
+        if (m_crypto && m_mbrList.size()) {
+            // seal the key on the crypto pool, one pub's worth of members per job, and
+            // publish each pub as its job completes
+            std::vector<std::pair<thumbPrint,xmpk>> chunk{};
+            for (const auto& kv : m_mbrList) {
+                chunk.emplace_back(kv);
+                if (chunk.size() == size_t(maxKR)) {
+                    sealAsync(std::move(chunk), pubTS);
+                    chunk.clear();
+                }
+            }
+            if (chunk.size()) sealAsync(std::move(chunk), pubTS);
+            m_newKeyCb(m_curKey, m_curKeyCT);
+            if (m_init) initDone();
+            return;
+        }
 
         //encrypt the new group key for all the group members in a sealed box
         // that can only opened by the secret key associated with converted public key in mbrList
@@ -424,7 +584,6 @@ struct DistGKey {
 
         auto s = m_mbrList.size();
         auto p = s <= maxKR ? 1 : (s + maxKR - 1) / maxKR; // determine number of Publications needed
-        auto pubTS = std::chrono::system_clock::now();
         auto it = pubPairs.begin();
         for(auto i=0u; i<p; ++i) {
             auto r = s < maxKR ? s : maxKR;
@@ -448,11 +607,58 @@ struct DistGKey {
         if(m_init && m_mbrList.size())  initDone();
     }
 
+    // Seal the current group key for 'mbrs' (at most maxKR of them) on a crypto pool thread
+    // then publish their key records on the io thread. If the key has been replaced by
+    // the time the sealing finishes the records are dropped.
+    void sealAsync(std::vector<std::pair<thumbPrint,xmpk>>&& mbrs, std::chrono::system_clock::time_point pubTS) {
+        auto& pool = *m_crypto;
+        pool.submit([this, &pool, mbrs = std::move(mbrs), key = m_curKey, ct = m_curKeyCT, pubTS]() mutable {
+                std::vector<gkr> pairs{};
+                pairs.reserve(mbrs.size());
+                for (const auto& [k, v] : mbrs) {
+                    encGK egKey;
+                    crypto_box_seal(egKey.data(), key.data(), key.size(), v.data());
+                    pairs.emplace_back(k, egKey);
+                }
+                sodium_memzero(key.data(), key.size());
+                pool.complete([this, pairs = std::move(pairs), ct, pubTS] {
+                        if (ct != m_curKeyCT) return;
+                        tlvEncoder gkrEnc{};
+                        gkrEnc.addNumber(36, ct);
+                        gkrEnc.addArray(130, pairs);
+                        publishKeyRange(pairs.front().first, pairs.back().first, pubTS, gkrEnc.vec());
+                    });
+            });
+    }
+
+    // do rekey sealing on the threads of 'pool' (nullptr does it on the io thread). The
+    // pool must use the same io_context as this distributor.
+    auto& cryptoPool(std::shared_ptr<CryptoPool> pool) {
+        m_crypto = std::move(pool);
+        return *this;
+    }
+
+    // X25519 version of signing cert 'tp's public key for sealing keys to it. Converted the
+    // first time it's needed (or when the cert arrives at a keymaker, see signerAdded) then cached.
+    const xmpk* memberKey(const thumbPrint& tp) {
+        if (auto k = m_xpk.find(tp); k != m_xpk.end()) return &k->second;
+        if (! m_certs.contains(tp)) return nullptr;
+        auto pk = m_certs[tp].content().toSpan();
+        xmpk x;
+        if (pk.size() != crypto_sign_PUBLICKEYBYTES || crypto_sign_ed25519_pk_to_curve25519(x.data(), pk.data()) != 0)
+            return nullptr;
+        return &m_xpk.emplace(tp, x).first->second;
+    }
+
+    // called when a new signing cert has been validated. A keymaker converts its key now
+    // so the member request (and its refreshes) and rekeys don't have to.
+    void signerAdded(const thumbPrint& tp) { if (m_keyMaker) memberKey(tp); }
+
     // Periodically refresh the group key. This routine should only be called *once*
     // since each call will result in an additional refresh cycle running.
     void gkeyTimeout() {
         if (!m_keyMaker) return;    // since not a cancelable timer, need to stop if I lose a future election or another keymaker took priority
-        makeGKey();
+        rekey(true);
         m_sync.oneTime(m_reKeyInt, [this](){ gkeyTimeout();});  //next re-keying event
     }
 
@@ -474,39 +680,94 @@ struct DistGKey {
         if (!m_keyMaker) return;
         // number of Publications should be fewer than 'complete peeling' iblt threshold (currently 80).
         // Each gkR is ~100 bytes so the default maxPubSize of 1024 allows for ~800 members.
-        if (m_mbrList.size() == 80*maxKR) return;
-
         auto tp = p.thumbprint();
-        if (m_mbrList.contains(tp))     return;  // already a member
         // XXXX Test here for a member request (mr) from relay role when this is a "pubs" distributor (later would be rejected in validation)
         if (m_pubdist && m_certs[tp].name()[1].toSv() == "relay"s) return;  //this is a hacky hack
 
-        auto pk = m_certs[tp].content().toVector();   //access the public key for this signer's thumbPrint
-        // convert pk to form that can be used to encrypt and add to member list
-        if(crypto_sign_ed25519_pk_to_curve25519(m_mbrList[tp].data(), pk.data()) != 0) {
-            m_mbrList.erase(tp);    //unable to convert member's pk to sealed box pk
-            return;
+        // a refreshed request from a current member (it missed its record) just gets its record(s) resent
+        if (! m_mbrList.contains(tp)) {
+            if (m_useTree ? m_mbrList.size() >= m_ktree.cap() : m_mbrList.size() == 80*maxKR) return;
+            auto pk = memberKey(tp);
+            if (! pk) return;   //unable to convert member's pk to sealed box pk
+            m_mbrList.emplace(tp, *pk);
         }
         if(!m_curKeyCT)    return;  // haven't made first group key
 
-        //publish the group key for this new peer
-        encGK egKey;
-        crypto_box_seal(egKey.data(), m_curKey.data(), m_curKey.size(), m_mbrList[tp].data());
-        std::vector<gkr> ek{ {tp, egKey} };
+        // publish the group key for this new peer. Peers that join within m_batchDelay of
+        // each other get their key records in the same pub (up to maxKR records per pub).
+        // (m_joins is kept in thumbprint order so a repeated request finds its entry)
+        auto j = std::ranges::lower_bound(m_joins, tp);
+        if (j != m_joins.end() && *j == tp) return;
+        m_joins.insert(j, tp);
+        if (m_joins.size() >= size_t(maxKR)) publishJoins();
+        else if (m_joins.size() == 1) m_joinTimer = m_sync.schedule(m_batchDelay, [this]{ publishJoins(); });
+
+        if (m_init) initDone();    // keyMaker was in init state but now has a group key, and at least one member
+    }
+
+    // publish the current group key for the members that joined since this was last called
+    void publishJoins() {
+        m_joinTimer.cancel();
+        if (m_joins.empty() || !m_curKeyCT) return;
+        // (a pub's records have to be in thumbprint order for the range in its name and
+        // m_joins is kept in that order)
+        if (m_useTree) {
+            std::vector<keyTree::rec> recs{};
+            for (const auto& tp : m_joins) {
+                auto m = m_mbrList.find(tp);
+                if (m == m_mbrList.end()) continue;
+                auto jr = m_ktree.contains(tp)? m_ktree.pathOf(tp) : m_ktree.join(tp, m->second);
+                recs.insert(recs.end(), jr.begin(), jr.end());
+            }
+            m_joins.clear();
+            if (recs.size()) publishKeyTree(recs, std::chrono::system_clock::now());
+            return;
+        }
+        std::vector<gkr> ek{};
+        for (const auto& tp : m_joins) {
+            auto m = m_mbrList.find(tp);
+            if (m == m_mbrList.end()) continue;     // removed while waiting
+            encGK egKey;
+            crypto_box_seal(egKey.data(), m_curKey.data(), m_curKey.size(), m->second.data());
+            ek.emplace_back(tp, egKey);
+        }
+        m_joins.clear();
+        if (ek.empty()) return;
         tlvEncoder gkrEnc{};    //tlv encoded content
         gkrEnc.addNumber(36, m_curKeyCT);
         gkrEnc.addArray(130, ek);
-        publishKeyRange(tp, tp, std::chrono::system_clock::now(), gkrEnc.vec());
-        //print("{} addGroupMem publishes {} gkey for {}\n", m_certs[m_tp].name(), m_sync.collName_.last().toSv(), p.name());
-
-        if (m_init) initDone();    // keyMaker was in init state but now has a group key, and at least one member
+        publishKeyRange(ek.front().first, ek.back().first, std::chrono::system_clock::now(), gkrEnc.vec());
     }
 
     // won't encrypt a group key for this thumbPrint in future
-    // if reKey is set, change the group key now to exclude the removed member
+    // if reKey is set, change the group key to exclude the removed member. Removals within
+    // m_batchDelay of each other share one new key.
     void removeGroupMem(thumbPrint& tp, bool reKey = false) {
         m_mbrList.erase(tp);
-        if (reKey) makeGKey();
+        m_ktree.leave(tp);
+        if (! reKey || m_reKeyPending) return;
+        m_reKeyPending = true;
+        m_sync.oneTime(m_batchDelay, [this]{ if (m_reKeyPending) rekey(); });
+    }
+
+    // set the window for batching member joins & coalescing rekeys triggered by removals
+    auto& batchDelay(std::chrono::milliseconds d) {
+        m_batchDelay = d;
+        return *this;
+    }
+
+    // set how long before its creation time a periodic replacement group key is distributed
+    auto& keyLead(std::chrono::milliseconds d) {
+        m_keyLead = d;
+        return *this;
+    }
+
+    // distribute the group key with a key tree that can hold 2^depth members. Must be
+    // called before setup(). Members learn the depth from the key records.
+    auto& useKeyTree(uint32_t depth = 10) {
+        m_useTree = true;
+        m_ktree.reset(depth);
+        return *this;
     }
 };
 
@@ -42,6 +42,7 @@
 #include <algorithm>
 #include <cstring> // for memcmp
 #include <functional>
+#include <unordered_map>
 #include <utility>
 
 #include <dct/schema/capability.hpp>
@@ -102,17 +103,28 @@ struct DistSGKey {
     keyVal m_sgPK{};    // current subscribergroup public key: made and kept by keymaker
     uint64_t m_curKeyCT{};      // current sg key pair creation time in microsecs
     std::map<thumbPrint,xmpk> m_mbrList{};
+    std::unordered_map<thumbPrint,xmpk> m_xpk{};  // converted public keys of (potential) members
     std::chrono::milliseconds m_reKeyInt{3600};
     std::chrono::milliseconds m_keyRand{10};
     std::chrono::milliseconds m_keyLifetime{3600+10};
     kmElection* m_kme{};
+    std::chrono::milliseconds m_kaInt{5000}; // keymaker keepalive interval (failover after 3 missed)
     uint32_t m_KMepoch{};      // current election epoch
     bool m_keyMaker{false};     // true if this entity is a key maker
     bool m_subr{false};         // set if this identity has the subscriber capability
     bool m_init{true};          // key maker status unknown while in initialization
     bool m_pubdist{false};        // true indicates this is a pub group key distributor (not pdu)
     bool m_mrPending{false};    //member request pending
-    pTimer m_mrRefresh{std::make_shared<Timer>(getDefaultIoContext())}; // to refresh timed out member request
+    TimerHandle m_mrRefresh{}; // to refresh timed out member request
+    static constexpr std::chrono::milliseconds mrMinDelay{2000};  // member request refresh backs off
+    static constexpr std::chrono::milliseconds mrMaxDelay{32000}; //  from mrMinDelay to mrMaxDelay
+    std::chrono::milliseconds m_mrDelay{mrMinDelay};
+    std::shared_ptr<CryptoPool> m_crypto{}; // if set, rekey sealing is done on its threads
+    std::chrono::milliseconds m_batchDelay{50}; // window for batching joins and coalescing rekeys
+    Histogram m_rekeyUs{};              // time to make and publish each new key (keymaker, microseconds)
+    std::vector<thumbPrint> m_joins{};  // members whose key records are waiting to be published (sorted, unique)
+    TimerHandle m_joinTimer{};
+    bool m_reKeyPending{false};         // a rekey to remove member(s) is scheduled
 
     DistSGKey(DirectFace& face, const Name& pPre, const Name& dPre, addKeyCb&& sgkeyCb, const certStore& cs,
              std::chrono::milliseconds reKeyInterval = std::chrono::seconds(3600),
@@ -126,8 +138,9 @@ struct DistSGKey {
              m_keyLifetime(m_reKeyInt + m_keyRand) {
         m_sync.cStateLifetime(253ms);
         m_sync.pubLifetime(std::chrono::milliseconds(reKeyInterval + reKeyRandomize + expirationGB));
-        m_sync.getLifetimeCb([this,cand=crPrefix(m_prefix/"km"/"cand"),mreq=crPrefix(m_mrPrefix)](const auto& p) {
+        m_sync.getLifetimeCb([this,cand=crPrefix(m_prefix/"km"/"cand"),elec=crPrefix(m_prefix/"km"/"elec"),mreq=crPrefix(m_mrPrefix)](const auto& p) {
                 if (mreq.isPrefix(p.name())) return 6000ms; //0ms;
+                if (elec.isPrefix(p.name()) && m_kaInt > 0ms) return 3 * m_kaInt; // winner keeps refreshing it
                 return cand.isPrefix(p.name())? 1000ms : m_keyLifetime;
             });
 #if 0
@@ -155,22 +168,38 @@ struct DistSGKey {
     // publish my membership request with updated key: name <m_mrPrefix><timestamp>
     // requests don't have epoch since the keymaker sets the epoch, member learns from key list
     void publishMembershipReq() {
-        m_mrRefresh->cancel();  // if a membership request refresh is scheduled, cancel it
+        m_mrRefresh.cancel();  // if a membership request refresh is scheduled, cancel it
         if(!m_subr) return;     // don't have permission to be a member
         crData p(m_mrPrefix/std::chrono::system_clock::now());
         p.content(std::vector<uint8_t>{});
         m_keySM.sign(p);    // will put my thumbprint into Publication
         m_mrPending = true;
         m_sync.publish(std::move(p));
-        m_mrRefresh = m_sync.schedule(m_keyLifetime, [this](){ publishMembershipReq(); });
+        m_mrRefresh = m_sync.schedule(jitter(m_mrDelay), [this](){ publishMembershipReq(); });
+        m_mrDelay = std::min(2 * m_mrDelay, mrMaxDelay);
+    }
+
+    // 'd' randomized to between d/2 and 3d/2 so members don't act in lockstep
+    static std::chrono::milliseconds jitter(std::chrono::milliseconds d) {
+        return d / 2 + std::chrono::milliseconds(randombytes_uniform(d.count() + 1));
+    }
+
+    // A new key was published without a record for me. Publish a membership request
+    // after a jittered delay (so a keymaker restart doesn't get every member's request
+    // at once) unless one is already out or scheduled. It's suppressed if a record for
+    // me shows up in the meantime.
+    void requestMembershipSoon() {
+        if (m_mrPending || m_mrRefresh.pending()) return;
+        m_mrRefresh = m_sync.schedule(jitter(mrMinDelay), [this](){ publishMembershipReq(); });
     }
 
     // Called when a group key has been received and decrypted. Cancel any pending refresh
     // of the membership request. It will be reissued only if a new group key record is received
     // and I'm not in the list
     void receivedGK() {
-        m_mrRefresh->cancel();  // if a membership request refresh is scheduled, cancel it
+        m_mrRefresh.cancel();  // if a membership request refresh is scheduled, cancel it
         m_mrPending = false;
+        m_mrDelay = mrMinDelay;
     }
     /*
      * Called to process a new local signing key. Passes to the SigMgrs.
@@ -261,8 +290,8 @@ struct DistSGKey {
             return;
         }
         if (m_keyMaker) {
-            // another member claims to be a keyMaker - largest thumbPrint wins
-            if (m_tp < p.thumbprint()) {
+            // another member claims to be a keyMaker - later epoch (re-election) or largest thumbPrint wins
+            if (m_tp < p.thumbprint() || p.name().nextAt(m_krPrefix.size()).toNumber() > m_KMepoch) {
                     print("keymaker got keylist from {}\n", m_certs[p].name());
                     m_keyMaker = false;
                     m_kmtp = p.thumbprint();
@@ -284,11 +313,7 @@ struct DistSGKey {
         auto n = p.name();
         auto epoch = n.nextAt(m_krPrefix.size()).toNumber();
         if (epoch != m_KMepoch) {
-            if (epoch > 1) { // XXX change this when re-elections supported
-                print("keylist ignored: bad epoch {} in {} from {}\n", epoch, p.name(), m_certs[p].name());
-                return;
-            }
-            //assert(m_KMepoch == 0);
+            if (epoch < m_KMepoch) return;  // from a keymaker that's since been replaced
             m_KMepoch = epoch;
             m_kmtp.fill(0);     //new epoch, reset my record of keymaker tp
         }
@@ -314,11 +339,13 @@ struct DistSGKey {
         auto tph = n.nextBlk().toSpan();
         auto tpId = std::span(m_tp).first(tpl.size());
         if(m_subr && (less(tpId, tpl) || less(tph, tpId))) {
-            //no secret key for me in this pub
-            if (std::cmp_less(m_curKeyCT, newCT) && !m_mrPending) {
-                // new key is being published, make sure keymaker has my membership
-                m_sync.oneTime(2000ms, [this](){ publishMembershipReq(); } ) ;
+            //no secret key for me in this pub. If it's a new key, make sure keymaker has my membership
+            try {
+                newCT = p.content().nextBlk(36).toNumber();
+            } catch (std::runtime_error& ex) {
+                return;
             }
+            if (std::cmp_less(m_curKeyCT, newCT)) requestMembershipSoon();
             return;
         }
         std::span<const uint8_t> sgPK{};
@@ -330,6 +357,8 @@ struct DistSGKey {
             newCT = content.nextBlk(36).toNumber();
             // a new key will have a creation time larger than m_curKeyCT
             if(newCT <= m_curKeyCT) {
+                // a record range for my current key means the keymaker has me so a scheduled request isn't needed
+                if (m_subr && newCT == m_curKeyCT && !m_mrPending) m_mrRefresh.cancel();
                 return; //received key is not newer than current key
             }
 
@@ -408,16 +437,28 @@ struct DistSGKey {
 
         if(m_subr && m_kmpri(m_tp) > 0 ) {
             auto eDone = [this](auto elected, auto epoch) {
+                            auto wasKM = m_keyMaker;
                             m_keyMaker = elected;
                             m_KMepoch = epoch;
                             // all members  subscribe to group key subcollection; keymakers subscribe in case of conflicts
                             m_sync.subscribe(m_krPrefix, [this](const auto& p){ receiveSGKeyRecords(p); });
-                            if (! elected)  return;
-                            // keymaker must get requests
+                            if (! elected) {
+                                if (! wasKM) return;
+                                // replaced by a re-election so become a member of the new keymaker's group
+                                m_sync.unsubscribe(m_mrPrefix);
+                                m_mbrList.clear();
+                                m_curKeyCT = 0;
+                                publishMembershipReq();
+                                return;
+                            }
+                            // keymakers need the member requests
                             m_sync.subscribe(m_mrPrefix, [this](const auto& p){ addGroupMem(p); });
-                            sgkeyTimeout();  //create a group key, publish it, callback parent with key
+                            if (! wasKM) sgkeyTimeout();  //create a group key and reschedule group key creation
                           };
-            m_kme = new kmElection(m_prefix/"km", m_keySM.ref(), m_sync, std::move(eDone), std::move(kmpri), m_tp, m_pubdist? 5s : 500ms);
+            // skip the election wait if no known cert can outrank us. The keymaker's keepalive
+            // lets the others elect a replacement if it fails.
+            m_kme = new kmElection(m_prefix/"km", m_keySM.ref(), m_sync, std::move(eDone), std::move(kmpri), m_tp, m_pubdist? 5s : 500ms,
+                                   kmFastPath(m_certs, m_kmpri, m_tp), m_kaInt);
         } else {    // non-keymaker subscribers and pure publishers
              m_sync.subscribe(m_krPrefix, [this](const auto& p){ receiveSGKeyRecords(p); });
         }
@@ -439,6 +480,20 @@ struct DistSGKey {
         } else m_sync.publish(std::move(p));
     }
 
+    // make a new key, timing it (with crypto pool sealing only the local part is timed)
+    void rekey() {
+        auto t0 = std::chrono::steady_clock::now();
+        makeSGKey();
+        m_rekeyUs.since(t0);
+    }
+
+    // add the memory used by the distributor's collection and member list to 'r'
+    void memUse(MemReport& r, std::string_view nm) const {
+        m_sync.memUse(r);
+        r.add(format("{} members", nm), m_mbrList.size(),
+              mem::map(m_mbrList) + mem::hash(m_xpk) + mem::vec(m_joins));
+    }
+
     // Make a new subscriber key pair, publish it, and locally switch to using the new key.
 
     void makeSGKey() {
@@ -449,10 +504,36 @@ struct DistSGKey {
         //set the creation time
         m_curKeyCT = std::chrono::duration_cast<std::chrono::microseconds>(
                         std::chrono::system_clock::now().time_since_epoch()).count();
+        // the new key's records cover all the members so nothing that's waiting needs to be sent
+        m_joins.clear();
+        m_joinTimer.cancel();
+        m_reKeyPending = false;
 
         // remove expired (not valid) certs (thumbprints) from memberList
-        auto now = std::chrono::system_clock::now();
-        std::erase_if(m_mbrList, [this,now](auto& kv) { return m_certs.contains(kv.first)? rCert(m_certs[kv.first]).validUntil() <= now : true; });
+        auto now = coarseClock::now();
+        std::erase_if(m_mbrList, [this,now](auto& kv) {
+                if (m_certs.contains(kv.first) && m_certs[kv.first].validUntil() > now) return false;
+                m_xpk.erase(kv.first);
+                return true;
+            });
+
+        if (m_crypto && m_mbrList.size()) {
+            // seal the key on the crypto pool, one pub's worth of members per job, and
+            // publish each pub as its job completes
+            auto pubTS = std::chrono::system_clock::now();
+            std::vector<std::pair<thumbPrint,xmpk>> chunk{};
+            for (const auto& kv : m_mbrList) {
+                chunk.emplace_back(kv);
+                if (chunk.size() == size_t(maxKR)) {
+                    sealAsync(std::move(chunk), pubTS);
+                    chunk.clear();
+                }
+            }
+            if (chunk.size()) sealAsync(std::move(chunk), pubTS);
+            m_newKeyCb(m_sgPK, m_sgSK, m_curKeyCT);
+            if (m_init) initDone();
+            return;
+        }
 
         //encrypt the new secret key for all the subscriber group members
         std::vector<egkr> pubPairs;
@@ -489,11 +570,59 @@ struct DistSGKey {
         if(m_init && m_mbrList.size())  initDone();
     }
 
+    // Seal the current secret key for 'mbrs' (at most maxKR of them) on a crypto pool thread
+    // then publish their key records on the io thread. If the key pair has been replaced by
+    // the time the sealing finishes the records are dropped.
+    void sealAsync(std::vector<std::pair<thumbPrint,xmpk>>&& mbrs, std::chrono::system_clock::time_point pubTS) {
+        auto& pool = *m_crypto;
+        pool.submit([this, &pool, mbrs = std::move(mbrs), sk = m_sgSK, pk = m_sgPK, ct = m_curKeyCT, pubTS]() mutable {
+                std::vector<egkr> pairs{};
+                pairs.reserve(mbrs.size());
+                for (const auto& [k, v] : mbrs) {
+                    encSGK egKey;
+                    crypto_box_seal(egKey.data(), sk.data(), sk.size(), v.data());
+                    pairs.emplace_back(k, egKey);
+                }
+                sodium_memzero(sk.data(), sk.size());
+                pool.complete([this, pairs = std::move(pairs), pk = std::move(pk), ct, pubTS] {
+                        if (ct != m_curKeyCT) return;
+                        tlvEncoder sgkp{};
+                        sgkp.addNumber(36, ct);
+                        sgkp.addArray(150, pk);
+                        sgkp.addArray(130, pairs);
+                        publishKeyRange(pairs.front().first, pairs.back().first, pubTS, sgkp.vec());
+                    });
+            });
+    }
+
+    // do rekey sealing on the threads of 'pool' (nullptr does it on the io thread). The
+    // pool must use the same io_context as this distributor.
+    auto& cryptoPool(std::shared_ptr<CryptoPool> pool) {
+        m_crypto = std::move(pool);
+        return *this;
+    }
+
+    // X25519 version of signing cert 'tp's public key for sealing keys to it. Converted the
+    // first time it's needed (or when the cert arrives at a keymaker, see signerAdded) then cached.
+    const xmpk* memberKey(const thumbPrint& tp) {
+        if (auto k = m_xpk.find(tp); k != m_xpk.end()) return &k->second;
+        if (! m_certs.contains(tp)) return nullptr;
+        auto pk = m_certs[tp].content().toSpan();
+        xmpk x;
+        if (pk.size() != crypto_sign_PUBLICKEYBYTES || crypto_sign_ed25519_pk_to_curve25519(x.data(), pk.data()) != 0)
+            return nullptr;
+        return &m_xpk.emplace(tp, x).first->second;
+    }
+
+    // called when a new signing cert has been validated. A keymaker converts its key now
+    // so the member request (and its refreshes) and rekeys don't have to.
+    void signerAdded(const thumbPrint& tp) { if (m_keyMaker) memberKey(tp); }
+
     // Periodically refresh the group key. This routine should only be called *once*
     // since each call will result in an additional refresh cycle running.
     void sgkeyTimeout() {
         if (!m_keyMaker) return;    // since not a cancelable timer, need to stop if I lose a future election
-        makeSGKey();
+        rekey();
         m_sync.oneTime(m_reKeyInt, [this](){ sgkeyTimeout();});  //next re-keying event
     }
 
@@ -526,36 +655,68 @@ struct DistSGKey {
         // XXXX Test here for request from relay role in /keys/pubs/mr (later would be rejected in validation)
         if(m_pubdist && m_certs[tp].name()[1].toSv() == "relay"s)  return;    //this is a hacky hack
 
-        auto pk = m_certs[tp].content().toVector();   //access the public key for this signer's thumbPrint
-        // convert pk to form that can be used to encrypt and add to member list
-        if(crypto_sign_ed25519_pk_to_curve25519(m_mbrList[tp].data(), pk.data()) != 0) {
-            m_mbrList.erase(tp);    //unable to convert member's pk to sealed box pk
-            return;
+        // a refreshed request from a current member just gets its key record resent
+        if (! m_mbrList.contains(tp)) {
+            auto pk = memberKey(tp);
+            if (! pk) return;   //unable to convert member's pk to sealed box pk
+            m_mbrList.emplace(tp, *pk);
         }
         if(!m_curKeyCT)    return;  // haven't made first group key
 
-        //publish the subscriber group key for this new peer
-        encSGK egKey;
-        crypto_box_seal(egKey.data(), m_sgSK.data(), m_sgSK.size(), m_mbrList[tp].data());
-        std::vector<egkr> ekp {{tp,egKey}};
+        // publish the subscriber group key for this new peer. Peers that join within m_batchDelay
+        // of each other get their key records in the same pub (up to maxKR records per pub).
+        // (m_joins is kept in thumbprint order so a repeated request finds its entry)
+        auto j = std::ranges::lower_bound(m_joins, tp);
+        if (j != m_joins.end() && *j == tp) return;
+        m_joins.insert(j, tp);
+        if (m_joins.size() >= size_t(maxKR)) publishJoins();
+        else if (m_joins.size() == 1) m_joinTimer = m_sync.schedule(m_batchDelay, [this]{ publishJoins(); });
+
+        if (m_init) initDone();    // Have a keyMaker, a group key, and at least one member: exit init state
+    }
+
+    // publish the current secret key for the members that joined since this was last called
+    void publishJoins() {
+        m_joinTimer.cancel();
+        if (m_joins.empty() || !m_curKeyCT) return;
+        // (a pub's records have to be in thumbprint order for the range in its name and
+        // m_joins is kept in that order)
+        std::vector<egkr> ekp{};
+        for (const auto& tp : m_joins) {
+            auto m = m_mbrList.find(tp);
+            if (m == m_mbrList.end()) continue;     // removed while waiting
+            encSGK egKey;
+            crypto_box_seal(egKey.data(), m_sgSK.data(), m_sgSK.size(), m->second.data());
+            ekp.emplace_back(tp, egKey);
+        }
+        m_joins.clear();
+        if (ekp.empty()) return;
         tlvEncoder sgkp{};    //tlv encoded content
         sgkp.addNumber(36, m_curKeyCT);
         sgkp.addArray(150, m_sgPK);
         sgkp.addArray(130, ekp);
-        publishKeyRange(tp, tp, std::chrono::system_clock::now(), sgkp.vec());
+        publishKeyRange(ekp.front().first, ekp.back().first, std::chrono::system_clock::now(), sgkp.vec());
+    }
 
-        if (m_init) initDone();    // Have a keyMaker, a group key, and at least one member: exit init state
+    // set the window for batching member joins & coalescing rekeys triggered by removals
+    auto& batchDelay(std::chrono::milliseconds d) {
+        m_batchDelay = d;
+        return *this;
     }
 
     /*
      *  won't encrypt a group key for this thumbPrint in future
      * if this becomes a subscription callback for delisted publications, should
      * probably mark mbrList entries rather than delete
-     * if reKey is set, change the group key now to exclude the removed member
+     * if reKey is set, change the group key to exclude the removed member
      */
     void removeGroupMem(thumbPrint& tp, bool reKey = false) {
         m_mbrList.erase(tp);
-        if(reKey) makeSGKey(); //issue new key without disturbing rekey schedule
+        if (! reKey || m_reKeyPending) return;
+        // issue new key without disturbing rekey schedule. Removals within m_batchDelay
+        // of each other share one new key.
+        m_reKeyPending = true;
+        m_sync.oneTime(m_batchDelay, [this]{ if (m_reKeyPending) rekey(); });
     }
 };
 
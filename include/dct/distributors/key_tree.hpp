@@ -0,0 +1,288 @@
+#ifndef KEY_TREE_HPP
+#define KEY_TREE_HPP
+#pragma once
+/*
+ * key_tree - logical key hierarchy (LKH) used by DistGKey to distribute
+ *            a group key with O(log n) records per membership change
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  key_tree is not intended as production code.
+ *
+ * Members are the leaves of a complete binary tree of depth 'depth_' whose
+ * nodes are numbered heap-style: the root is 1, the children of node n are
+ * 2n and 2n+1 and the leaves are cap() .. 2*cap()-1. Each interior node
+ * with members below it has a symmetric key known to those members. The
+ * root's key is the group key. A member's leaf 'key' is its (curve25519
+ * converted) public signing key.
+ *
+ * A key record carries the key of a node encrypted by the key of one of
+ * its children: sealed (crypto_box_seal) to the member's public key if the
+ * child is a leaf, otherwise AEAD encrypted with the child's key.
+ *
+ * The keymaker side:
+ *  - join() gives a new member a leaf and returns the records that seal
+ *    the current key of each node on its path to that member. pathOf()
+ *    returns the same records for a current member.
+ *  - leave() frees a member's leaf and marks its path as compromised.
+ *  - rekey() makes new keys for the root and every compromised node and
+ *    returns the records for their occupied children. With one removal
+ *    that's at most 2*depth_ records instead of one per member.
+ *
+ * The member side (receive()) keeps the keys on its own path and decrypts
+ * the records that target them. Records within a rekey are ordered
+ * bottom-up but pubs can arrive in any order so records that can't be
+ * decrypted yet are held until the key they need shows up.
+ */
+
+#include <algorithm>
+#include <bit>
+#include <map>
+#include <set>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <dct/sigmgrs/sigmgr_defs.hpp>
+
+namespace dct {
+
+struct keyTree {
+    static constexpr size_t keySz = crypto_aead_xchacha20poly1305_IETF_KEYBYTES;
+    static constexpr size_t nonceSz = crypto_aead_xchacha20poly1305_IETF_NPUBBYTES;
+    static constexpr size_t macSz = crypto_aead_xchacha20poly1305_IETF_ABYTES;
+    using encKey = std::array<uint8_t, crypto_box_SEALBYTES + keySz>;
+    using xmpk = std::array<uint8_t, crypto_scalarmult_curve25519_BYTES>;
+    static_assert(nonceSz + keySz + macSz <= sizeof(encKey));
+
+    struct rec {
+        thumbPrint tp;      // member 'ek' is sealed for if 'under' is a leaf, otherwise zero
+        uint32_t node;      // node whose key is in 'ek'
+        uint32_t under;     // child of 'node' whose key encrypted 'ek'
+        encKey ek;
+    };
+    static_assert(std::is_trivially_copyable_v<rec> && sizeof(rec) == sizeof(thumbPrint) + 8 + sizeof(encKey));
+
+    uint32_t depth_{10};
+
+    // keymaker state
+    std::unordered_map<uint32_t,keyVal> key_{};     // interior nodes with members below them
+    std::unordered_map<uint32_t,uint32_t> cnt_{};   // number of members below each interior node
+    std::unordered_map<uint32_t,std::pair<thumbPrint,xmpk>> occ_{};  // occupied leaves
+    std::map<thumbPrint,uint32_t> leaf_{};          // member's leaf
+    std::set<uint32_t> free_{};                     // vacated leaves (reused lowest first)
+    std::set<uint32_t> dirty_{};                    // vacated since the last rekey
+    uint32_t next_{};                               // next never-used leaf
+
+    // member state
+    struct pkey { keyVal key; uint64_t ct; };
+    std::unordered_map<uint32_t,pkey> path_{};      // keys of the nodes on my leaf's path
+    std::vector<std::pair<rec,uint64_t>> pend_{};   // records for my path that couldn't be decrypted yet
+    uint32_t myLeaf_{};
+
+    keyTree() { reset(depth_); }
+
+    constexpr uint32_t cap() const noexcept { return 1u << depth_; }
+    constexpr bool isLeaf(uint32_t n) const noexcept { return n >= cap(); }
+    auto size() const noexcept { return leaf_.size(); }
+    bool full() const noexcept { return free_.empty() && next_ == 2*cap(); }
+    bool contains(const thumbPrint& tp) const { return leaf_.contains(tp); }
+    const keyVal& root() const { return key_.at(1); }
+
+    // is 'n' on the path from my leaf to the root?
+    bool onPath(uint32_t n) const noexcept {
+        if (n == 0 || myLeaf_ == 0 || n > myLeaf_) return false;
+        return (myLeaf_ >> (std::bit_width(myLeaf_) - std::bit_width(n))) == n;
+    }
+
+    void reset(uint32_t depth) {
+        if (depth < 1 || depth > 20) throw runtime_error("keyTree: depth must be 1..20");
+        depth_ = depth;
+        key_.clear(); cnt_.clear(); occ_.clear(); leaf_.clear(); free_.clear(); dirty_.clear();
+        next_ = cap();
+        resetMember();
+    }
+    void resetMember() {
+        path_.clear();
+        pend_.clear();
+        myLeaf_ = 0;
+    }
+
+    static keyVal newKey() {
+        keyVal k(keySz);
+        crypto_aead_xchacha20poly1305_ietf_keygen(k.data());
+        return k;
+    }
+
+    // seal the key of 'node' for the member 'tp' (with converted public key 'pk') at leaf 'l'
+    rec sealFor(uint32_t node, uint32_t l, const xmpk& pk, const thumbPrint& tp) const {
+        rec r{};
+        r.tp = tp;
+        r.node = node;
+        r.under = l;
+        const auto& k = key_.at(node);
+        crypto_box_seal(r.ek.data(), k.data(), k.size(), pk.data());
+        return r;
+    }
+
+    // encrypt the key of 'node' for its child 'under'
+    rec seal(uint32_t node, uint32_t under) const {
+        rec r{};
+        r.node = node;
+        r.under = under;
+        if (isLeaf(under)) {
+            const auto& [tp, pk] = occ_.at(under);
+            return sealFor(node, under, pk, tp);
+        }
+        const auto& k = key_.at(node);
+        auto* n = r.ek.data();
+        randombytes_buf(n, nonceSz);
+        const std::array<uint32_t,2> ad{node, under};
+        crypto_aead_xchacha20poly1305_ietf_encrypt_detached(n + nonceSz, n + nonceSz + keySz, nullptr,
+                k.data(), k.size(), (const uint8_t*)ad.data(), sizeof(ad), nullptr, n, key_.at(under).data());
+        return r;
+    }
+
+    /*** keymaker side ***/
+
+    // add member 'tp' with converted public key 'pk'. Returns the records giving it the keys
+    // of its path (empty if the tree is full or it's already a member).
+    std::vector<rec> join(const thumbPrint& tp, const xmpk& pk) {
+        std::vector<rec> res{};
+        if (full() || contains(tp)) return res;
+        uint32_t l;
+        if (free_.empty()) l = next_++;
+        else {
+            l = *free_.begin();
+            free_.erase(free_.begin());
+        }
+        leaf_.emplace(tp, l);
+        occ_.emplace(l, std::pair{tp, pk});
+        for (auto n = l >> 1; n > 0; n >>= 1) {
+            if (cnt_[n]++ == 0 && !key_.contains(n)) key_.emplace(n, newKey());
+            res.push_back(sealFor(n, l, pk, tp));
+        }
+        return res;
+    }
+
+    // the records that resend the current keys of existing member 'tp's path
+    std::vector<rec> pathOf(const thumbPrint& tp) const {
+        std::vector<rec> res{};
+        auto it = leaf_.find(tp);
+        if (it == leaf_.end()) return res;
+        auto l = it->second;
+        const auto& pk = occ_.at(l).second;
+        for (auto n = l >> 1; n > 0; n >>= 1) res.push_back(sealFor(n, l, pk, tp));
+        return res;
+    }
+
+    // remove member 'tp'. Every key it knew is changed by the next rekey().
+    void leave(const thumbPrint& tp) {
+        auto it = leaf_.find(tp);
+        if (it == leaf_.end()) return;
+        auto l = it->second;
+        leaf_.erase(it);
+        occ_.erase(l);
+        free_.insert(l);
+        dirty_.insert(l);
+        for (auto n = l >> 1; n > 1; n >>= 1) {
+            if (--cnt_[n] == 0) { cnt_.erase(n); key_.erase(n); }
+        }
+        if (cnt_[1] > 0) --cnt_[1];
+    }
+
+    // make 'root' the new group key and replace the keys of nodes whose subtree lost a
+    // member. Returns the records (bottom-up) that get the new keys to the remaining members.
+    std::vector<rec> rekey(const keyVal& root) {
+        std::set<uint32_t, std::greater<uint32_t>> nodes{1};
+        for (auto l : dirty_)
+            for (auto n = l >> 1; n > 1; n >>= 1) if (key_.contains(n)) nodes.insert(n);
+        dirty_.clear();
+
+        std::vector<rec> res{};
+        for (auto n : nodes) {
+            key_[n] = n == 1? root : newKey();
+            for (auto c : {2*n, 2*n + 1}) {
+                if (isLeaf(c) ? occ_.contains(c) : key_.contains(c)) res.emplace_back(seal(n, c));
+            }
+        }
+        return res;
+    }
+
+    /*** member side ***/
+
+    // try to decrypt record 'r' (from a key made at time 'ct'). Returns true if it was
+    // for me and it decrypted.
+    bool open(const rec& r, uint64_t ct, const thumbPrint& tp, const keyVal& pk, const keyVal& sk) {
+        if (r.node == 0 || r.node >= r.under) return false;
+        uint8_t m[keySz];
+        if (isLeaf(r.under)) {
+            if (r.tp != tp) return false;
+            if (crypto_box_seal_open(m, r.ek.data(), r.ek.size(), pk.data(), sk.data()) != 0) return false;
+            if (r.under != myLeaf_) {
+                // the keymaker put me at a new leaf so the keys of my old path are useless
+                resetMember();
+                myLeaf_ = r.under;
+            }
+            if (! onPath(r.node)) return false;
+        } else {
+            auto k = path_.find(r.under);
+            if (r.node != r.under >> 1 || k == path_.end()) return false;
+            const auto* n = r.ek.data();
+            const std::array<uint32_t,2> ad{r.node, r.under};
+            if (crypto_aead_xchacha20poly1305_ietf_decrypt_detached(m, nullptr, n + nonceSz, keySz, n + nonceSz + keySz,
+                        (const uint8_t*)ad.data(), sizeof(ad), n, k->second.key.data()) != 0) return false;
+        }
+        if (auto p = path_.find(r.node); p != path_.end() && p->second.ct > ct) return false;
+        path_[r.node] = pkey{keyVal(m, m + keySz), ct};
+        sodium_memzero(m, sizeof(m));
+        return true;
+    }
+
+    // process the records of a key tree pub. Returns true if it produced a root key.
+    bool receive(std::span<const rec> recs, uint64_t ct, uint32_t depth, const thumbPrint& tp,
+                 const keyVal& pk, const keyVal& sk) {
+        if (depth != depth_) reset(depth);
+        bool gotRoot{false};
+        for (const auto& r : recs) {
+            if (isLeaf(r.under) ? r.tp != tp : ! onPath(r.under)) continue;
+            if (open(r, ct, tp, pk, sk)) gotRoot |= r.node == 1;
+            else if (! isLeaf(r.under)) pend_.emplace_back(r, ct);
+        }
+        // retry held records until nothing more decrypts
+        for (bool progress = true; progress && pend_.size(); ) {
+            progress = false;
+            std::erase_if(pend_, [&](const auto& p) {
+                    if (! onPath(p.first.under)) return true;
+                    if (! open(p.first, p.second, tp, pk, sk)) return false;
+                    gotRoot |= p.first.node == 1;
+                    return progress = true;
+                });
+        }
+        if (pend_.size() > 4*depth_) pend_.erase(pend_.begin(), pend_.end() - 4*depth_);
+        return gotRoot;
+    }
+
+    const pkey* rootKey() const {
+        auto r = path_.find(1);
+        return r == path_.end()? nullptr : &r->second;
+    }
+};
+
+} // namespace dct
+
+#endif //KEY_TREE_HPP
@@ -53,19 +53,63 @@
  *
  * All candidates send their initial proposal with an epoch of 0.  If they receive
  * a proposal with a later epoch, the election has been finalized and they
- * are not the keyMaker.  To support (future) re-election on keyMaker failure,
- * the current epoch is remembered in m_kmEpoch.
+ * are not the keyMaker.
+ *
+ * Fast path: if the 'fast' callback says no known cert can outrank this
+ * candidate, the election finishes early instead of waiting out elecDur_.
+ * The callback is polled every elecDur_/8 from when the proposal is sent and
+ * kmFastPath's only says yes once the cert store has stopped changing between
+ * polls (the initial cert exchange is done) since an election decided on a
+ * store that's still filling could miss a higher-ranked candidate. (A later
+ * conflict with an unknown, higher-ranked keymaker is resolved by the
+ * distributor as before.)
+ *
+ * Failover: if a keepalive interval is set the winner republishes its 'elec'
+ * pub at that interval. A losing candidate that hears nothing from the winner
+ * for 3 intervals starts a new election in the current epoch, whose winner
+ * moves everyone to the next epoch. A candidate that can't run keeps the
+ * watch going so it learns of the next winner. done_ is called at the end of
+ * every election and whenever the winner steps down (it hears of a later
+ * epoch or a higher-ranked winner of its own).
  */
 
+#include <functional>
+#include <unordered_set>
 #include "invocable.h"
+#include "dct/schema/certstore.hpp"
 
 namespace dct {
 
+// true if no signing cert in 'cs' other than 'tp' would win an election against 'tp'
+// (signing certs are the ones that haven't signed any other cert in the store).
+static inline bool kmOutranksKnown(const certStore& cs, auto& kmpri, const thumbPrint& tp) {
+    std::unordered_set<thumbPrint> signers{};
+    cs.for_each([&signers](const auto& c) { signers.emplace(c.getKeyLoc()); });
+    const auto pri = kmpri(tp);
+    for (uint32_t i = 0; i < cs.size(); ++i) {
+        const auto& t = cs.at(i).computeThumbPrint();
+        if (t == tp || signers.contains(t)) continue;
+        auto p = kmpri(t);
+        if (p > pri || (p == pri && t > tp)) return false;
+    }
+    return pri > 0;
+}
+
+// kmElection fast path check: kmOutranksKnown once the cert store hasn't changed
+// since the previous check
+static inline auto kmFastPath(const certStore& cs, auto& kmpri, const thumbPrint& tp) {
+    return [&cs, &kmpri, &tp, n = ~size_t(0)]() mutable {
+        return std::exchange(n, cs.size()) == cs.size() && kmOutranksKnown(cs, kmpri, tp);
+    };
+}
+
 struct kmElection {
     using doneCB = ofats::any_invocable<void(bool,int32_t)>;
     using kmpriCB = ofats::any_invocable<int32_t(thumbPrint)>;
     using millis = std::chrono::milliseconds;
     using sys_micros = std::chrono::sys_time<std::chrono::microseconds>;
+    using fastCB = std::function<bool()>;
+    using Clock = std::chrono::steady_clock;
 
     const crName prefix_;   // prefix of election publications
     SigMgr& sigmgr_;        // signs and validates publications
@@ -78,6 +122,12 @@ struct kmElection {
     const millis elecDur_;  // election duration
     const uint16_t preSz_;  // leading prefix size of all election pubs
     const uint16_t nmBlks_; // number of components in election pub names
+    millis keepAlive_{};    // winner's keepalive interval (0 = no keepalive or failover)
+    Clock::time_point lastHeard_{}; // last election or keepalive pub from the winner
+    TimerHandle kaTimer_{};
+    TimerHandle elecTimer_{};   // end of the election in progress
+    fastCB fast_;           // can the election end early (see fast path above)
+    bool elected_{false};   // this instance won the last election
 
     // build and publish a key maker ('km') publication
     void publishKM(const char* topic) {
@@ -92,11 +142,61 @@ struct kmElection {
     // increments epoch_ then sends an 'elected' pub to tell other candidate KMs that it
     // has won. It then sends a group key list to everyone which will take them out of init state.
     void electionDone() {
-        if (priority_ > 0) {
+        elected_ = priority_ > 0;
+        if (elected_) {
             ++epoch_;
             publishKM("elec");
         }
-        done_(priority_ > 0, epoch_);
+        lastHeard_ = Clock::now();
+        done_(elected_, epoch_);
+        if (keepAlive_ > 0ms && ! kaTimer_.pending()) kaTimer_ = sync_.schedule(keepAlive_, [this]{ keepAlive(); });
+    }
+
+    // winner: assert the win. Others: start a new election if the winner has gone quiet.
+    void keepAlive() {
+        if (elected_) publishKM("elec");
+        else if (Clock::now() - lastHeard_ > 3 * keepAlive_) {
+            reElect();
+            return;
+        }
+        kaTimer_ = sync_.schedule(keepAlive_, [this]{ keepAlive(); });
+    }
+
+    void reElect() {
+        priority_ = kmpri_(ourTP_);
+        if (priority_ <= 0) {
+            // not a candidate now but keep watching for the next winner
+            lastHeard_ = Clock::now();
+            kaTimer_ = sync_.schedule(keepAlive_, [this]{ keepAlive(); });
+            return;
+        }
+        startElection();
+    }
+
+    void startElection() {
+        publishKM("cand");
+        elecTimer_ = sync_.schedule(elecDur_, [this]{ electionDone(); });
+        if (fast_) sync_.oneTime(elecDur_ / 8, [this]{ fastCheck(); });
+    }
+    void fastCheck() {
+        if (! elecTimer_.pending()) return;
+        if (! fast_()) {
+            sync_.oneTime(elecDur_ / 8, [this]{ fastCheck(); });
+            return;
+        }
+        elecTimer_.cancel();
+        electionDone();
+    }
+
+    // we've lost or been replaced: move to 'epoch' and, if we were the winner, stop
+    // acting as it
+    void stepDown(uint32_t epoch) {
+        if (priority_ > 0) priority_ = -priority_;
+        epoch_ = epoch;
+        if (elected_) {
+            elected_ = false;
+            done_(false, epoch_);
+        }
     }
 
     // check that msg from peer is in same epoch as us. Return value of 'true'
@@ -104,10 +204,7 @@ struct kmElection {
     // in later epoch, cancel current election & update our epoch.
     bool wrongEpoch(const auto epoch) {
         if (epoch == epoch_) return false;
-        if (epoch > epoch_) {
-            if (priority_ > 0) priority_ = -priority_;
-            epoch_ = epoch;
-        }
+        if (epoch > epoch_) stepDown(epoch);
         return true;
     }
 
@@ -134,16 +231,29 @@ struct kmElection {
         auto n = p.name();
         if (n.nBlks() != nmBlks_) return; // bad name format
         auto epoch = n.nextAt(preSz_).toNumber();
-        if (epoch_ >= epoch) return; // ignore msg from earlier election
-        if (kmpri_(p.thumbprint()) <= 0) return;
-        if (priority_ > 0) priority_ = -priority_;
-        epoch_ = epoch;
+        if (epoch_ > epoch) return; // ignore msg from earlier election
+        auto tp = p.thumbprint();
+        auto pri = kmpri_(tp);
+        if (tp == ourTP_ || pri <= 0) return;
+        lastHeard_ = Clock::now();
+        if (epoch_ == epoch) {
+            // a keepalive from the current winner or, if we think we won, a rival
+            // winner of this epoch (e.g., the two sides of a healed partition)
+            if (elected_) {
+                auto our = kmpri_(ourTP_);
+                if (pri > our || (pri == our && tp > ourTP_)) stepDown(epoch);
+            }
+            return;
+        }
+        // we were replaced (e.g., we were unreachable long enough to be considered failed)
+        stepDown(epoch);
     }
 
-    kmElection(crName&& pre, SigMgr& sm, SyncPS& sy, doneCB&& done, kmpriCB&& kmv, thumbPrint& tp, millis dur = 100ms)
+    kmElection(crName&& pre, SigMgr& sm, SyncPS& sy, doneCB&& done, kmpriCB&& kmv, thumbPrint& tp, millis dur = 100ms,
+               fastCB&& fast = {}, millis keepAlive = 0ms)
         : prefix_{std::move(pre)}, sigmgr_{sm}, sync_{sy}, done_{std::move(done)}, kmpri_{std::move(kmv)}, ourTP_{tp},
           elecDur_{dur}, preSz_{static_cast<uint16_t>((prefix_/"elec").size())},
-          nmBlks_{static_cast<uint16_t>(prefix_.nBlks()+3)} {
+          nmBlks_{static_cast<uint16_t>(prefix_.nBlks()+3)}, keepAlive_{keepAlive}, fast_{std::move(fast)} {
 
         // subscriptions are done first since we may have received pubs from an in-progress
         // or finished election. 'subscribe' will upcall for each of those pubs so we can
@@ -152,8 +262,7 @@ struct kmElection {
         sync_.subscribe(prefix_/"elec", [this](const auto& p){ handleKMelec(p); });
         sync_.subscribe(prefix_/"cand", [this](auto p){ handleKMcand(p); });
         if (priority_ <= 0) { electionDone(); return; } // we lost the election
-        publishKM("cand");
-        sync_.oneTime(elecDur_, [this]{ electionDone(); });
+        startElection();
     }
 };
 
@@ -29,12 +29,13 @@
 #include <boost/asio.hpp>
 
 #include <dct/schema/rpacket.hpp>
+#include "invocable.h"
 
 namespace dct {
 
 using Timer = boost::asio::system_timer;
 using pTimer = std::shared_ptr<Timer>;
-using TimerCb = std::function<void()>;
+using TimerCb = ofats::any_invocable<void()>;
 
 using DataCb = std::function<void(const rInterest& i, rData d)>;
 using InterestCb = std::function<void(const rName& n, const rInterest& i)>;
@@ -0,0 +1,93 @@
+#ifndef DCT_FACE_AWAITABLE_HPP
+#define DCT_FACE_AWAITABLE_HPP
+#pragma once
+/*
+ * Support for the asio completion token (e.g., co_await) forms of the face,
+ * syncps and dct_model asynchronous operations
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This is not intended as production code.
+ */
+
+/*
+ * The token forms take any asio completion token and default to
+ * boost::asio::use_awaitable so, in a coroutine started with co_spawn on the
+ * face's io_context:
+ *
+ *    auto d = co_await face.express(interest);       // throws on timeout
+ *    bool ok = co_await sync.publishConfirmed(std::move(pub));
+ *    if (! co_await model.connect()) ...
+ *
+ * Many operations can be in flight at once by co_spawning a coroutine per
+ * operation (or with any of asio's composition tokens). Callback tokens work too.
+ *
+ * The underlying operations take std::function callbacks which must be
+ * copyable while asio handlers are move-only so each operation keeps its
+ * handler in a one-shot completion shared by its callbacks. That's one
+ * allocation per operation, the same as the callback forms' captures.
+ */
+
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include <boost/asio.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+namespace dct {
+
+using defaultToken = boost::asio::use_awaitable_t<>;
+
+template<typename Sig, typename Handler> struct oneShot;
+
+/**
+ * Holds an operation's completion handler until the operation's first result,
+ * which is posted to the handler's executor (or 'ioc' if it doesn't have one)
+ * so the handler never runs inside the callback (or initiation) supplying the
+ * result. Later results (e.g., additional Data collected by a PIT entry) are
+ * ignored.
+ */
+template<typename Handler, typename... Args>
+struct oneShot<void(Args...), Handler> {
+    using executor = boost::asio::associated_executor_t<Handler, boost::asio::io_context::executor_type>;
+
+    std::optional<Handler> h_;
+    boost::asio::executor_work_guard<executor> work_;
+
+    oneShot(Handler&& h, boost::asio::io_context& ioc) : h_{std::move(h)},
+        work_{boost::asio::get_associated_executor(*h_, ioc.get_executor())} { }
+
+    void operator()(Args... args) {
+        if (! h_) return;
+        auto h = std::move(*h_);
+        h_.reset();
+        boost::asio::post(work_.get_executor(), [h = std::move(h), ...args = std::move(args)]() mutable {
+                    std::move(h)(std::move(args)...);
+                });
+        work_.reset();
+    }
+};
+
+template<typename Sig, typename Handler>
+static inline auto makeOneShot(Handler&& h, boost::asio::io_context& ioc) {
+    return std::make_shared<oneShot<Sig, std::decay_t<Handler>>>(std::move(h), ioc);
+}
+
+} // namespace dct
+
+#endif  // DCT_FACE_AWAITABLE_HPP
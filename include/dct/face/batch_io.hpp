@@ -0,0 +1,221 @@
+#ifndef DCT_FACE_BATCH_IO_HPP
+#define DCT_FACE_BATCH_IO_HPP
+#pragma once
+/*
+ * Batched datagram send & receive for Direct Face transports
+ *
+ * Copyright (C) 2022 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This is not intended as production code.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <linux/net_tstamp.h>
+#endif
+
+#include "pkt_buf.hpp"
+
+namespace dct {
+
+#ifndef __linux__
+// recvmmsg/sendmmsg are Linux-only. Elsewhere they're emulated with a
+// loop of recvmsg/sendmsg so the code compiles (but batching is off by
+// default since it doesn't save anything).
+struct mmsghdr {
+    msghdr msg_hdr;
+    unsigned int msg_len;
+};
+static inline int recvmmsg(int fd, mmsghdr* h, unsigned int n, int flags, void*) {
+    unsigned int i = 0;
+    for (; i < n; ++i) {
+        auto r = ::recvmsg(fd, &h[i].msg_hdr, flags);
+        if (r < 0) return i > 0? int(i) : -1;
+        h[i].msg_len = r;
+    }
+    return i;
+}
+static inline int sendmmsg(int fd, mmsghdr* h, unsigned int n, int flags) {
+    unsigned int i = 0;
+    for (; i < n; ++i) {
+        auto r = ::sendmsg(fd, &h[i].msg_hdr, flags);
+        if (r < 0) return i > 0? int(i) : -1;
+        h[i].msg_len = r;
+    }
+    return i;
+}
+#endif
+
+/**
+ * A datagram transport normally does a syscall per packet sent or received.
+ * Relays get bursts of hundreds of cAdds after each cState so BatchIO lets
+ * a transport drain everything waiting on its socket with one recvmmsg per
+ * 'maxBatch' packets and queue sends to be flushed, after the current
+ * io_context handlers have run, with one sendmmsg per 'maxBatch' packets.
+ *
+ * Since sends are deferred, each is copied into a pool buffer (the caller's
+ * packet may not outlive the send call).
+ *
+ * With rxTimestamps() on, each received packet also gets the kernel's (software,
+ * CLOCK_REALTIME) receive timestamp via SO_TIMESTAMPING so the time it waited in
+ * the socket and for the io_context can be measured.
+ */
+struct BatchIO {
+    static constexpr size_t maxBatch = 32;
+
+    PktPool& pool_;         // the transport's buffer pool (see pkt_buf.hpp)
+
+    // receive side
+    std::array<PktRef, maxBatch> rbuf_{};
+    std::array<iovec, maxBatch> riov_{};
+    std::array<sockaddr_in6, maxBatch> rfrom_{};
+    std::array<mmsghdr, maxBatch> rhdr_{};
+    static constexpr size_t ctlSize = CMSG_SPACE(3 * sizeof(timespec));
+    std::vector<std::array<uint8_t, ctlSize>> rctl_{};   // cmsg buffers (empty if timestamps are off)
+    std::chrono::system_clock::time_point rxTs_{};      // receive timestamp of the packet handed to 'cb'
+
+    // send side
+    std::vector<PktRef> sq_{};
+    std::array<iovec, maxBatch> siov_{};
+    std::array<mmsghdr, maxBatch> shdr_{};
+    sockaddr_in6 dst_{};
+    bool hasDst_{false};    // false if the socket is connected
+
+    explicit BatchIO(PktPool& pool) : pool_{pool} { }
+    // sends go to 'dst' (for an unconnected socket)
+    BatchIO(PktPool& pool, const void* dst, size_t len) : pool_{pool}, hasDst_{true} {
+        std::memcpy(&dst_, dst, std::min(len, sizeof(dst_)));
+    }
+
+    /**
+     * Receive every packet currently waiting on (non-blocking) socket 'fd'
+     * calling 'cb(PktRef& buf, size_t len, const sockaddr_in6& from)' for each.
+     * 'cb' can keep the packet by taking ownership of 'buf'.
+     */
+    template<typename CB>
+    void receive(int fd, CB&& cb) {
+        while (true) {
+            for (size_t i = 0; i < maxBatch; ++i) {
+                if (! rbuf_[i]) rbuf_[i] = PktRef::get(pool_);
+                riov_[i] = {rbuf_[i].buf(), rbuf_[i].capacity()};
+                rhdr_[i] = {};
+                rhdr_[i].msg_hdr.msg_name = &rfrom_[i];
+                rhdr_[i].msg_hdr.msg_namelen = sizeof(rfrom_[i]);
+                rhdr_[i].msg_hdr.msg_iov = &riov_[i];
+                rhdr_[i].msg_hdr.msg_iovlen = 1;
+                if (! rctl_.empty()) {
+                    rhdr_[i].msg_hdr.msg_control = rctl_[i].data();
+                    rhdr_[i].msg_hdr.msg_controllen = ctlSize;
+                }
+            }
+            auto n = recvmmsg(fd, rhdr_.data(), maxBatch, MSG_DONTWAIT, nullptr);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return;
+            for (int i = 0; i < n; ++i) {
+                if (rhdr_[i].msg_len == 0) continue;
+                if (! rctl_.empty()) rxTs_ = stamp(rhdr_[i].msg_hdr);
+                cb(rbuf_[i], rhdr_[i].msg_len, rfrom_[i]);
+            }
+            rxTs_ = {};
+            if (size_t(n) < maxBatch) return;
+        }
+    }
+
+    // turn on receive timestamps for socket 'fd'. Returns false if they aren't supported.
+    bool rxTimestamps([[maybe_unused]] int fd) {
+#if defined(__linux__) && defined(SO_TIMESTAMPING)
+        int f = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+        if (::setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &f, sizeof(f)) != 0) return false;
+        rctl_.resize(maxBatch);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // the software receive timestamp in 'h's control messages (zero if there isn't one)
+    static std::chrono::system_clock::time_point stamp([[maybe_unused]] msghdr& h) noexcept {
+#if defined(__linux__) && defined(SO_TIMESTAMPING)
+        for (auto c = CMSG_FIRSTHDR(&h); c != nullptr; c = CMSG_NXTHDR(&h, c)) {
+            if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_TIMESTAMPING) continue;
+            timespec ts[3];
+            std::memcpy(ts, CMSG_DATA(c), sizeof(ts));
+            if (ts[0].tv_sec == 0) break;
+            return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                        std::chrono::seconds(ts[0].tv_sec) + std::chrono::nanoseconds(ts[0].tv_nsec)));
+        }
+#endif
+        return {};
+    }
+
+    // queue a copy of a packet for sending. Returns true if the queue was empty
+    // (i.e., caller needs to arrange for a flush).
+    bool queue(const uint8_t* pkt, size_t len) {
+        sq_.emplace_back(PktRef::copy(pool_, pkt, len));
+        return sq_.size() == 1;
+    }
+
+    /**
+     * Send as many queued packets as (non-blocking) socket 'fd' will take.
+     * Returns true if the queue was emptied and false if the socket is full
+     * (caller should wait for it to become writable then flush again).
+     */
+    bool flush(int fd) {
+        size_t off = 0;
+        while (off < sq_.size()) {
+            auto n = std::min(sq_.size() - off, maxBatch);
+            for (size_t i = 0; i < n; ++i) {
+                auto& p = sq_[off + i];
+                siov_[i] = {const_cast<uint8_t*>(p.data()), p.size()};
+                shdr_[i] = {};
+                if (hasDst_) {
+                    shdr_[i].msg_hdr.msg_name = &dst_;
+                    shdr_[i].msg_hdr.msg_namelen = sizeof(dst_);
+                }
+                shdr_[i].msg_hdr.msg_iov = &siov_[i];
+                shdr_[i].msg_hdr.msg_iovlen = 1;
+            }
+            auto r = sendmmsg(fd, shdr_.data(), n, MSG_DONTWAIT);
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    sq_.erase(sq_.begin(), sq_.begin() + off);
+                    return false;
+                }
+                // like Transport::ehandler, a peer that isn't there yet isn't an error
+                if (errno != ECONNREFUSED)
+                    throw runtime_error(format("sendmmsg failed: {} len {}", std::strerror(errno), sq_[off].size()));
+                r = 1; // drop the packet that failed
+            }
+            off += r;
+        }
+        sq_.clear();
+        return true;
+    }
+};
+
+} // namespace dct
+
+#endif  // DCT_FACE_BATCH_IO_HPP
@@ -0,0 +1,70 @@
+#ifndef DCT_FACE_BUSY_POLL_HPP
+#define DCT_FACE_BUSY_POLL_HPP
+#pragma once
+/*
+ * Busy-poll event loop for latency-critical Direct Face users
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This is not intended as production code.
+ */
+
+#include <chrono>
+#include <sys/socket.h>
+
+#include <boost/asio/io_context.hpp>
+
+namespace dct {
+
+/*
+ * io_context::run() blocks in epoll between events so each packet pays a thread
+ * wakeup. busyPollRun instead runs the handlers that are ready with poll() (a
+ * non-blocking epoll_wait) and keeps doing so for up to 'spin' after the last
+ * one that ran. Once it's been idle that long it blocks for the next handler, as
+ * run() would, then goes back to spinning. It returns when the io_context is
+ * stopped or runs out of work. This burns a core while there's traffic so it's
+ * for apps that can dedicate one to DCT.
+ *
+ * With SO_BUSY_POLL (setBusyPoll) on a transport's sockets the kernel also polls
+ * the device queue for up to 'us' on a receive that finds nothing rather than
+ * waiting for its interrupt (for epoll this also needs the net.core.busy_poll
+ * sysctl). It's Linux-only and silently does nothing elsewhere or if the process
+ * doesn't have the privilege to raise the value over net.core.busy_read.
+ */
+static inline void busyPollRun(boost::asio::io_context& ioc, std::chrono::microseconds spin) {
+    using clock = std::chrono::steady_clock;
+    auto idle = clock::now();
+    while (! ioc.stopped()) {
+        if (ioc.poll() != 0) {
+            idle = clock::now();
+            continue;
+        }
+        if (clock::now() - idle < spin) continue;
+        if (ioc.run_one() == 0) break;
+        idle = clock::now();
+    }
+}
+
+static inline void setBusyPoll([[maybe_unused]] int fd, [[maybe_unused]] int us) noexcept {
+#ifdef SO_BUSY_POLL
+    ::setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &us, sizeof(us));
+#endif
+}
+
+} // namespace dct
+
+#endif // DCT_FACE_BUSY_POLL_HPP
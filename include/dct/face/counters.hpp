@@ -0,0 +1,197 @@
+#ifndef DCT_FACE_COUNTERS_HPP
+#define DCT_FACE_COUNTERS_HPP
+#pragma once
+/*
+ * Lightweight performance counters & histograms for faces and collections
+ *
+ * Copyright (C) 2022 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This is not intended as production code.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <dct/format.hpp>
+
+namespace dct {
+
+/**
+ * A Counter is only written by the thread running the face or collection that
+ * owns it so an increment is a relaxed load & store (no locked instruction)
+ * but it can be read at any time from any thread (e.g., by a monitoring thread).
+ *
+ * Building with DCT_NO_COUNTERS defined makes all the counting operations
+ * no-ops (and 'enabled' false so callers can skip gathering what they'd count,
+ * e.g., reading the clock for a latency).
+ */
+struct Counter {
+#ifndef DCT_NO_COUNTERS
+    static constexpr bool enabled = true;
+    std::atomic<uint64_t> v_{};
+
+    void inc(uint64_t n = 1) noexcept { v_.store(v_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    uint64_t get() const noexcept { return v_.load(std::memory_order_relaxed); }
+    void clear() noexcept { v_.store(0, std::memory_order_relaxed); }
+#else
+    static constexpr bool enabled = false;
+    void inc(uint64_t = 1) noexcept { }
+    uint64_t get() const noexcept { return 0; }
+    void clear() noexcept { }
+#endif
+    auto& operator++() noexcept { inc(); return *this; }
+    auto& operator+=(uint64_t n) noexcept { inc(n); return *this; }
+    operator uint64_t() const noexcept { return get(); }
+};
+
+// A value (e.g., a queue depth) with the same single writer, any reader semantics as Counter
+struct Gauge {
+#ifndef DCT_NO_COUNTERS
+    std::atomic<uint64_t> v_{};
+
+    void set(uint64_t v) noexcept { v_.store(v, std::memory_order_relaxed); }
+    uint64_t get() const noexcept { return v_.load(std::memory_order_relaxed); }
+#else
+    void set(uint64_t) noexcept { }
+    uint64_t get() const noexcept { return 0; }
+#endif
+};
+
+/**
+ * Histogram of non-negative values in power-of-2 buckets (bucket b holds values
+ * whose bit width is b, i.e., in [2^(b-1), 2^b)) so adding a value costs a
+ * couple of instructions and quantiles are reported as bucket upper bounds.
+ */
+struct Histogram {
+    static constexpr size_t nBuckets = 40;
+    std::array<Counter,nBuckets> b_{};
+    Counter n_{};
+    Counter sum_{};
+
+    void add(uint64_t v) noexcept {
+        b_[std::min<size_t>(std::bit_width(v), nBuckets - 1)].inc();
+        n_.inc();
+        sum_.inc(v);
+    }
+    // add the time since 't0' in microseconds
+    template<typename TP>
+    void since(TP t0) noexcept {
+        add(std::chrono::duration_cast<std::chrono::microseconds>(TP::clock::now() - t0).count());
+    }
+
+    uint64_t count() const noexcept { return n_.get(); }
+    double mean() const noexcept { auto n = count(); return n? double(sum_.get()) / n : 0.; }
+
+    // upper bound of the q'th quantile (0 <= q <= 1)
+    uint64_t quantile(double q) const noexcept {
+        auto n = count();
+        if (n == 0) return 0;
+        uint64_t want = std::max<uint64_t>(1, uint64_t(q * n + 0.5)), seen{};
+        for (size_t b = 0; b < nBuckets; ++b) {
+            if ((seen += b_[b].get()) >= want) return b == 0? 0 : (uint64_t(1) << b) - 1;
+        }
+        return ~uint64_t(0);
+    }
+
+    void clear() noexcept { for (auto& b : b_) b.clear(); n_.clear(); sum_.clear(); }
+
+    std::string str() const {
+        return format("n {} mean {:.1f} p50 {} p90 {} p99 {}", count(), mean(), quantile(.5), quantile(.9), quantile(.99));
+    }
+};
+
+/**
+ * DirectFace counters
+ */
+struct FaceStats {
+    Counter interestsIn{};  // interests received
+    Counter dataIn{};       // data received
+    Counter otherIn{};      // packets received that weren't an interest or data
+    Counter interestsOut{}; // interests sent
+    Counter dataOut{};      // data sent
+    Counter unicastOut{};   // data sent only to the sender of the interest (see unicastReplies)
+    Counter ditHits{};      // received interests dropped as duplicates
+    Counter ddtHits{};      // received data dropped as duplicates (mirroring transports)
+    Counter ritMisses{};    // received interests no one registered for
+    Counter unsolicited{};  // received data not matching a PIT entry
+    Counter suppressed{};   // expressed interests not sent because a peer just sent them
+    Counter timeouts{};     // PIT entries that timed out
+
+    std::string str() const {
+        return format("in: int {} data {} other {} dup {} dupData {} noRIT {} unsolicited {} | out: int {} data {} (unicast {}) suppressed {} | timeouts {}",
+                      interestsIn.get(), dataIn.get(), otherIn.get(), ditHits.get(), ddtHits.get(), ritMisses.get(), unsolicited.get(),
+                      interestsOut.get(), dataOut.get(), unicastOut.get(), suppressed.get(), timeouts.get());
+    }
+};
+
+/**
+ * SyncPS (per-collection) counters
+ */
+struct SyncStats {
+    Counter cStatesIn{};    // peer cStates handled
+    Counter cStatesOut{};   // cStates we expressed
+    Counter cStateDeltas{}; // cStates we sent as a change log (see SyncPS::neighborDeltas)
+    Counter cStateDeltaMiss{}; // peer change logs whose keyframe we didn't have
+    Counter cAddsIn{};      // cAdds received
+    Counter cAddsInvalid{}; // cAdds that failed validation
+    Counter cAddsLimited{}; // cAdds dropped unvalidated because their sender was over its limit or blacklisted
+    Counter cAddsOut{};     // cAdds sent
+    Counter cAddsReused{};  // cAdds built from a copy of an identical, already signed cAdd
+    Counter peelOk{};       // iblt differences that peeled
+    Counter peelFail{};     // iblt differences too big to peel
+    Counter peelCached{};   // pending cState differences updated from a cached peel
+    Counter peelClass{};    // priority class differences that peeled when the full one didn't
+    Counter pubsNew{};      // new pubs received
+    Counter pubsDup{};      // received pubs we already had (or had rejected)
+    Counter pubsInvalid{};  // received pubs that were expired or failed validation
+    Counter pubsLimited{};  // received pubs skipped because their signer was over its limit or blacklisted
+    Counter pubsOverQuota{};// received pubs refused because their signer had its quota of active pubs
+    Counter blacklisted{};  // times a cAdd sender or pub signer was blacklisted
+    Counter pubsDelivered{};// pubs given to subscribers
+    Counter pubsLocal{};    // pubs published locally
+    Counter pubsRelayed{};  // other nodes' pubs resent to peers lacking them (see SyncPS::relayPubs)
+    Histogram cAddPubs{};   // pubs per received cAdd
+    Histogram validateUs{}; // time to validate a cAdd's new pubs (microseconds)
+    Histogram cAddSignUs{}; // time to sign (and encrypt) a cAdd (microseconds)
+    Histogram cAddValidateUs{}; // time to validate (and decrypt) a received cAdd (microseconds)
+    Histogram deliveryUs{}; // pub creation (its timestamp) to delivery to a subscriber (microseconds)
+    // with kernel receive timestamps (DirectFace::rxTimestamps), deliveryUs split into:
+    Histogram netUs{};      // pub creation to the kernel receiving its cAdd (microseconds)
+    Histogram rxQueueUs{};  // kernel receive to syncps getting the cAdd (socket & io_context queueing, microseconds)
+    Histogram processUs{};  // syncps getting the cAdd to the pub's delivery (microseconds)
+
+    std::string str() const {
+        return format("cState in {} out {} delta {} delta miss {} | cAdd in {} invalid {} limited {} out {} reused {} | peel ok {} fail {} cached {} class {} | "
+                      "pubs new {} dup {} invalid {} limited {} over quota {} delivered {} local {} relayed {} | blacklisted {}\n"
+                      "  pubs/cAdd: {}\n  validate us: {}\n  cAdd sign us: {}\n  cAdd validate us: {}\n  delivery us: {}\n"
+                      "  net us: {}\n  rx queue us: {}\n  process us: {}",
+                      cStatesIn.get(), cStatesOut.get(), cStateDeltas.get(), cStateDeltaMiss.get(), cAddsIn.get(), cAddsInvalid.get(), cAddsLimited.get(),
+                      cAddsOut.get(), cAddsReused.get(), peelOk.get(), peelFail.get(), peelCached.get(), peelClass.get(), pubsNew.get(), pubsDup.get(),
+                      pubsInvalid.get(), pubsLimited.get(), pubsOverQuota.get(), pubsDelivered.get(), pubsLocal.get(), pubsRelayed.get(), blacklisted.get(),
+                      cAddPubs.str(), validateUs.str(), cAddSignUs.str(), cAddValidateUs.str(), deliveryUs.str(),
+                      netUs.str(), rxQueueUs.str(), processUs.str());
+    }
+};
+
+} // namespace dct
+
+#endif  // DCT_FACE_COUNTERS_HPP
@@ -26,10 +26,14 @@
 
 #include <net/if.h>
 #include <ifaddrs.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
 #ifdef __linux__
 #include <linux/if_link.h>
 #endif
 #include <array>
+#include <cstring>
 #include <string>
 #include <string_view>
 
@@ -101,6 +105,17 @@ static inline auto getIp6Addr(std::string_view ifnm) {
     return saddr;
 }
 
+// MTU of interface 'ifnm' (0 if it can't be found)
+static inline size_t ifMTU(std::string_view ifnm) {
+    auto s = ::socket(AF_INET6, SOCK_DGRAM, 0);
+    if (s < 0) return 0;
+    ifreq ifr{};
+    std::memcpy(ifr.ifr_name, ifnm.data(), std::min(ifnm.size(), sizeof(ifr.ifr_name) - 1));
+    auto r = ::ioctl(s, SIOCGIFMTU, &ifr);
+    ::close(s);
+    return r == 0 && ifr.ifr_mtu > 0? ifr.ifr_mtu : 0;
+}
+
 } // namespace dct
 
 #endif // DCT_FACE_DEFAULT_IF_HPP
@@ -50,13 +50,15 @@
 #include <type_traits>
 #include <unordered_set>
 
+#include "awaitable.hpp"
 #include "transport.hpp"
 #include "lpm_tables.hpp"
+#include "timer_service.hpp"
+#include "counters.hpp"
 
 namespace dct {
 
 using namespace std::literals;
-using TimerCb = std::function<void()>;
 
 /**
  * A DirectFace implements a subset of the NDN application-level API used by both the ndn-cxx
@@ -69,22 +71,32 @@ class DirectFace {
     using enum cSts;
     using connectCbList = std::vector<std::pair<std::vector<uint8_t>, RegisterCb>>;
 
-    boost::asio::io_context& ioContext_{getDefaultIoContext()};
+    boost::asio::io_context& ioContext_;
+    TimerService timers_;  // all the face's timers (declared before the tables holding their handles)
     dct::Transport& io_;   // boost async I/O transport (defaults to UDP6 multicast)
+    std::chrono::microseconds spin_{};  // run() busy-poll spin budget (0 = block in epoll)
 
     RIT rit_{}; // Registered Interest Table
-    PIT pit_{}; // Pending Interest Table
+    PIT pit_{io_.pool_}; // Pending Interest Table (copies go in the transport's buffer pool)
     DIT dit_{}; // Duplicate Interest Table
+    DIT ddt_{1, 1s}; // Duplicate Data Table (only used, and sized, if the transport mirrors)
 
     connectCbList ccb_;
     cSts cSts_{UNCONNECTED};
+    std::chrono::milliseconds dedWindow_{30ms}; // time a satisfied PIT entry collects more Data
+    std::chrono::milliseconds dedMin_{0ms};     // largest window asked for by dedWindow()
+    DedPolicy dedPolicy_{};                     // fixed or adaptive DED windows (see dedPolicy())
+    std::chrono::milliseconds suppressWindow_{0ms}; // don't send an interest a peer sent this recently (0 = off)
+    bool unicast_{false};                       // unicast Data that only one peer asked for (see unicastReplies)
+    FaceStats stats_{};
 
     auto rcvCb(auto pkt, auto len) -> void {
         // Packet receive handler: decode and process as Interest or Data (silently ignore anything else).
         // Since a matching interest might already be in the PIT or there might be
         // no matching interests for a data, don't do anything heavyweight here.
-        if (tlv(pkt[0]) == tlv::Interest) handleInterest({pkt, len});
-        else if (tlv(pkt[0]) == tlv::Data) handleData({pkt, len});
+        if (tlv(pkt[0]) == tlv::Interest) { ++stats_.interestsIn; handleInterest({pkt, len}, io_.rcvBuf(), io_.rxFrom()); }
+        else if (tlv(pkt[0]) == tlv::Data) { ++stats_.dataIn; handleData({pkt, len}); }
+        else ++stats_.otherIn;
     }
 
     auto conCb() -> void {
@@ -94,32 +106,124 @@ class DirectFace {
         ccb_.clear();
     }
 
-    DirectFace() : io_{dct::transport([this](auto p, auto l){ rcvCb(p, l); }, [this]{ conCb(); })} {
+    DirectFace() : ioContext_{getDefaultIoContext()}, timers_{ioContext_},
+            io_{dct::transport([this](auto p, auto l){ rcvCb(p, l); }, [this]{ conCb(); })} {
         io_.connect();
     }
 
-    DirectFace(std::string_view addr)
-            : io_{dct::transport(addr, [this](auto p, auto l){ rcvCb(p, l); }, [this]{ conCb(); })} {
+    DirectFace(std::string_view addr) : DirectFace(addr, getDefaultIoContext()) { }
+
+    /*
+     * A face that does all its work on io_context 'ioc'. Everything using the face
+     * (syncps, distributors, timers) runs on 'ioc' so DeftTs with faces on different
+     * io_contexts can be run by different threads. They mustn't call each other
+     * directly (see ptps::relay for how a relay hands off work).
+     */
+    DirectFace(std::string_view addr, boost::asio::io_context& ioc) : ioContext_{ioc}, timers_{ioc},
+            io_{dct::transport(addr, ioc, [this](auto p, auto l){ rcvCb(p, l); }, [this]{ conCb(); })} {
         io_.connect();
     }
 
     // Get the asio io_context used by this face
     boost::asio::io_context& getIoContext() const noexcept { return ioContext_; }
 
-    constexpr size_t getMaxPacketSize() const noexcept { return 1500 - 40 - 8; } //XXX
+    // run the face's io_context (see busyPoll)
+    void run() {
+        if (spin_ > decltype(spin_)::zero()) busyPollRun(ioContext_, spin_);
+        else ioContext_.run();
+    }
 
-    std::shared_ptr<Timer> schedule(std::chrono::microseconds delay, TimerCb&& cb) {
-        auto timer = std::make_shared<Timer>(ioContext_, delay);
-        timer->async_wait([cb=std::move(cb), timer](const auto& e) { if (e == boost::system::errc::success) cb(); });
-        return timer;
+    /*
+     * make run() spin on the io_context for up to 'spin' after it goes idle before
+     * blocking and set SO_BUSY_POLL of 'sockUs' on the transport's receive socket(s)
+     * (see busy_poll.hpp). A zero 'spin' goes back to blocking.
+     */
+    auto& busyPoll(std::chrono::microseconds spin, int sockUs = 50) {
+        spin_ = spin;
+        io_.busyPoll(spin > decltype(spin)::zero()? sockUs : 0);
+        return *this;
     }
 
-    void oneTime(std::chrono::microseconds delay, TimerCb&& cb) { schedule(delay, std::move(cb)); }
+    /*
+     * have the transport get kernel receive timestamps (see Transport::rxTimestamps).
+     * During a packet's upcall rxTime() is when the kernel received it or zero if
+     * it's not known. Returns false if the transport can't get them.
+     */
+    bool rxTimestamps() { return io_.rxTimestamps(); }
+    auto rxTime() const noexcept { return io_.rxTime(); }
+    // during a packet's upcall, its sender (sin6_family 0 if the transport doesn't say)
+    const auto& rxFrom() const noexcept { return io_.rxFrom(); }
 
-    auto timeOut(std::chrono::microseconds delay, TimerCb&& cb) {
-        auto timer = std::make_unique<Timer>(ioContext_, delay);
-        timer->async_wait([cb=std::move(cb)](const auto& e) { if (e == boost::system::errc::success) cb(); });
-        return timer;
+    /*
+     * Answer an interest (e.g., a cState) that's only been heard from one peer with a
+     * Data unicast to that peer rather than multicast to the segment so members that
+     * didn't ask for it don't have to receive, parse & dup-check it. An interest heard
+     * from more than one peer (e.g., lagging peers with the same need) is still answered
+     * by multicast. The face also receives unicasts and stops suppressing its interests
+     * (see suppressWindow) since it can't count on overhearing the answer to a peer's.
+     * The members of a segment should all use this: answers to a member that doesn't
+     * are still unicast but it can't receive them. Other responders no longer overhear
+     * an answer and stop answering themselves so a peer may get more than one. Returns
+     * false (and leaves replies multicast) if the transport can't (see Transport::unicast).
+     */
+    bool unicastReplies() {
+        if (! unicast_) unicast_ = io_.unicast();
+        return unicast_;
+    }
+
+    // largest packet the face's transport carries (see Transport::maxPayload)
+    size_t getMaxPacketSize() const noexcept { return io_.maxPayload(); }
+
+    // call 'cb' after 'delay'. The returned handle can be used to cancel or reschedule it.
+    TimerHandle schedule(std::chrono::microseconds delay, TimerCb&& cb) { return timers_.schedule(delay, std::move(cb)); }
+
+    void oneTime(std::chrono::microseconds delay, TimerCb&& cb) { timers_.schedule(delay, std::move(cb)); }
+
+    // call 'cb' every 'interval' (e.g., to dump stats periodically). Can't be canceled.
+    void every(std::chrono::microseconds interval, TimerCb&& cb) {
+        oneTime(interval, [this, interval, cb=std::move(cb)]() mutable { cb(); every(interval, std::move(cb)); });
+    }
+
+    // the face's counters. They can be read from any thread.
+    const auto& stats() const noexcept { return stats_; }
+
+    // counters plus table sizes (call from the face's thread)
+    std::string statsStr() const {
+        auto s = format("{} | pit {} timers {}", stats_.str(), pit_.lt_.size(), timers_.size());
+        if (auto p = io_.pacer(); p) s += format(" | pacer: {}", p->stats().str());
+        return s;
+    }
+
+    // add the memory used by the face's tables to 'r' (call from the face's thread)
+    void memUse(MemReport& r) const {
+        size_t b{};
+        for (const auto& [_, e] : pit_.lt_) b += e.pkt_.size();
+        r.add("face PIT", pit_.lt_.size(), pit_.heapBytes() + b);
+        b = 0;
+        for (const auto& [_, e] : rit_.lt_) b += sizeof(*e.name_) + e.name_->capacity() + mem::node;
+        r.add("face RIT", rit_.lt_.size(), rit_.heapBytes() + b);
+        r.add("face DIT", dit_.cnt_, mem::vec(dit_.ring_) + mem::vec(dit_.idx_));
+        r.add("face DDT", ddt_.cnt_, mem::vec(ddt_.ring_) + mem::vec(ddt_.idx_));
+    }
+
+    // attach the DED window of the registered prefix covering 'pe's interest (found as
+    // 'ri' or by lookup) to 'pe'. With an adaptive DED policy every prefix gets one,
+    // otherwise only those given a window by adaptDedWindow().
+    void dedTrack(PITentry& pe, RIT::iterator ri) {
+        if (pe.dt_ || ! rit_.found(ri)) return;
+        auto& dt = ri->second.dt_;
+        if (! dt) {
+            if (! dedPolicy_.adaptive) return;
+            dt = std::make_shared<DedTrack>();
+        }
+        pe.dt_ = dt;
+    }
+    void dedTrack(PITentry& pe) { if (! pe.dt_) dedTrack(pe, rit_.findLM(rPrefix(pe.i_.name()))); }
+
+    // the DED window of 'pe'
+    std::chrono::milliseconds dedWindow(const PITentry& pe) const noexcept {
+        if (pe.dt_) return std::max(pe.dt_->window(dedWindow_), dedMin_);
+        return dedWindow_;
     }
 
     // schedule or re-schedule PIT Interest Timeout callback
@@ -128,28 +232,111 @@ class DirectFace {
         // entry to replace the one being deleted. Otherwise give the remote peer's replacement
         // interest some extra time to get to us.
         auto lt = pe.i_.lifetime();
-        if (! pe.dCb_) lt += 30ms;
-        pe.timer(timeOut(lt, [this, idat=*pe.idat_] () mutable {
-                                auto i = rInterest(idat);
-                                pit_.itoCB(i); }
-                         )
-                );
+        if (! pe.dCb_) lt += dedPolicy_.itoGrace;
+        pe.timer(schedule(lt, [this, pkt=pe.pkt_] {
+                    rInterest i(pkt.data(), pkt.size());
+                    if (auto it = pit_.find(rPrefix(i.name())); pit_.found(it)) dedClose(it->second);
+                    ++stats_.timeouts;
+                    pit_.itoCB(i);
+                }));
     }
     // schedule PIT Deferred Entry Delete
     void schedDED(PITentry& pe) {
-        if (pe.ded_) return;  // already handled
+        if (pe.ded_) {
+            // another answer: note if it arrived in the last quarter of the window
+            pe.last_ = std::chrono::steady_clock::now();
+            if (pe.dt_ && (pe.last_ - pe.first_) * 4 >= dedWindow(pe) * 3) pe.late_ = true;
+            return;
+        }
         pe.ded_ = true;
-        if (pe.timer()->expires_after(30ms) <= 0) return; // timer already expired
-        pe.timer()->async_wait([this, idat=*pe.idat_](const auto& e) {
-                                    if (e == boost::system::errc::success) {
-                                        auto i = rInterest(idat);
-                                        pit_.itoCB(i);
-                                    }
-                                });
+        pe.first_ = pe.last_ = std::chrono::steady_clock::now();
+        // the entry's timeout callback does the delete so just move its time up
+        pe.timer_.expiresAfter(dedWindow(pe));
+    }
+    // 'pe's DED window is closing: add what it collected to its prefix's adaptive window
+    // (and remember its interest so an answer that turns up after it closes counts as late)
+    void dedClose(const PITentry& pe) {
+        if (! dedPolicy_.adaptive || ! pe.ded_ || ! pe.dt_) return;
+        pe.dt_->sample(std::chrono::duration_cast<std::chrono::microseconds>(pe.last_ - pe.first_), pe.late_, dedPolicy_);
+        pe.dt_->close(std::hash<tlvParser>{}(pe.i_.name()));
+    }
+    // an unsolicited Data 'd' may be a late answer to a closed DED window of its prefix
+    void dedLate(const rData& d) {
+        if (! dedPolicy_.adaptive) return;
+        if (auto ri = rit_.findLM(rPrefix(d.name())); rit_.found(ri) && ri->second.dt_)
+            ri->second.dt_->unsolicited(std::hash<tlvParser>{}(d.name()), dedPolicy_);
+    }
+
+    /*
+     * set the face's PIT entry retention policy (see DedPolicy in lpm_tables.hpp).
+     * It applies to entries made after the call.
+     */
+    auto& dedPolicy(const DedPolicy& p) noexcept {
+        dedPolicy_ = p;
+        return *this;
+    }
+    const auto& dedPolicy() const noexcept { return dedPolicy_; }
+
+    // set the deferred delete window (it only grows since the face may be shared)
+    auto& dedWindow(std::chrono::milliseconds w) noexcept {
+        if (w > dedWindow_) dedWindow_ = w;
+        if (w > dedMin_) dedMin_ = w;
+        return *this;
+    }
+
+    /*
+     * set the deferred delete window of registered prefix 'p' (a collection) from
+     * the collection's observed cAdd arrivals (see adaptive_timing.hpp). It goes in
+     * the prefix's DED window state so it only applies to the prefix's interests and,
+     * with an adaptive DED policy, the window is the larger of it and the face's own
+     * estimate. Unlike dedWindow() this can shrink the window but not below what a
+     * dedWindow() call has asked for beyond the default (e.g., to collect a cAdd burst).
+     */
+    auto& adaptDedWindow(const rName& p, std::chrono::milliseconds w) {
+        auto ri = rit_.find(rPrefix(p));
+        if (! rit_.found(ri)) return *this;
+        auto& dt = ri->second.dt_;
+        if (! dt) dt = std::make_shared<DedTrack>();
+        dt->hint(w);
+        return *this;
+    }
+
+    /*
+     * set the interest suppression window: an interest the app expresses isn't
+     * sent if a peer multicast the same interest (same name, e.g., a cState for
+     * the same collection with an equal IBLT) within the window. Everyone that
+     * could answer has heard the peer's copy and their answer will satisfy our
+     * PIT entry too. Our entry still times out normally so the app will
+     * re-express it. Like the deferred delete window this only grows.
+     */
+    auto& suppressWindow(std::chrono::milliseconds w) noexcept {
+        if (w > suppressWindow_) suppressWindow_ = w;
+        return *this;
+    }
+
+    /*
+     * pace the face's sends to 'rate' bytes/sec (see pacer.hpp) so bursts don't
+     * overrun peers. 'burst' bytes can go at line rate and up to 'maxQueue' bytes
+     * can be waiting (beyond that packets are dropped). Interests go first.
+     */
+    auto& pace(double rate, size_t burst = 16*1024, size_t maxQueue = 1024*1024) {
+        io_.pace(ioContext_, rate, burst, maxQueue);
+        return *this;
+    }
+    auto& transport() const noexcept { return io_; }
+
+    /*
+     * set the size & max entry age of the duplicate interest table. Like the
+     * deferred delete window these only grow since the face may be shared.
+     * The table's current contents are discarded.
+     */
+    auto& ditConfig(size_t size, std::chrono::milliseconds maxAge) {
+        if (size > dit_.size() || maxAge > dit_.maxAge())
+            dit_ = DIT(std::max(size, dit_.size()), std::max<DIT::clock::duration>(maxAge, dit_.maxAge()));
+        return *this;
     }
 
     void pitErase(PIT::iterator it) {
-        if (it->second.timer_) it->second.cancelTimer();
         pit_.erase(it);
     };
 
@@ -158,7 +345,7 @@ class DirectFace {
     /*
      * Send packet 'pkt' of length 'len' bytes
      */
-    void send(const uint8_t* pkt, size_t len) { io_.send(pkt, len); }
+    void send(const uint8_t* pkt, size_t len) { io_.output(pkt, len); }
     void send(const std::vector<uint8_t>& v) { send(v.data(), v.size()); }
     void send(const tlvParser& v) { send(v.data(), v.size()); }
 
@@ -188,13 +375,36 @@ class DirectFace {
      *   even though it was multicast to the net to unblock completion callbacks
      *   at the origin. E.g., during cert dist peer sent this interest followed
      *   by pubs and it needs to hear pubs arrived.
+     * - Unless a peer multicast the same interest within the suppression window
+     *   (see suppressWindow()), in which case it isn't sent.
      */
     auto express(const rInterest& i, DataCb&& onD, InterestTO&& ito) {
         if (cSts_ != CONNECTED) throw runtime_error("express: not connected");
         auto res = pit_.add(i, std::move(onD), std::move(ito));
-        schedITO(res.first->second);
+        auto& pe = res.first->second;
+        dedTrack(pe);
+        schedITO(pe);
         dit_.add(i);
-        send(i);    // XXX add time-based supression (maybe using dit or pit)
+        if (! res.second && pe.fromNet_ && suppressWindow_ > 0ms && ! unicast_ &&
+            std::chrono::steady_clock::now() - pe.netTime_ < suppressWindow_) { ++stats_.suppressed; return; }
+        ++stats_.interestsOut;
+        send(i);
+    }
+
+    /*
+     * Completion token form of express (see awaitable.hpp): 'co_await face.express(i)'
+     * returns the first Data answering 'i' or throws boost::asio::error::timed_out
+     * if the interest times out. The Data is a copy since the packet it arrives in
+     * doesn't outlive the PIT entry.
+     */
+    template<typename Token = defaultToken>
+    auto express(const rInterest& i, Token&& token = {}) {
+        using Sig = void(boost::system::error_code, crData);
+        return boost::asio::async_initiate<Token, Sig>([this](auto&& h, const rInterest& i) {
+                    auto c = makeOneShot<Sig>(std::move(h), ioContext_);
+                    express(i, [c](const rInterest&, rData d) { (*c)({}, crData{d}); },
+                               [c](const rInterest&) { (*c)(boost::asio::error::timed_out, crData{}); });
+                }, token, i);
     }
 
     /**
@@ -204,21 +414,25 @@ class DirectFace {
      *  - add it to dup interest table.
      *  - add it to PIT then upcall RIT listener (has to be done in
      *    this order so if upcall results in a Data, PIT entry exists).
+     *    'pkt', if set, is the transport buffer holding 'i' which
+     *    the PIT entry shares rather than copying the interest.
      */
-    void handleInterest(rInterest i) {
+    void handleInterest(rInterest i, const PktRef& pkt = {}, const sockaddr_in6& from = {}) {
         auto [isDup, h] = dit_.dupInterest(i);
-        if (isDup) return;
+        if (isDup) { ++stats_.ditHits; return; }
 
         // check RIT first to see if we can handle this interest. If not,
         // ignore it (DON'T add it to the DIT because we might register
         // a handler soon and don't want future matching Interests suppressed).
         auto ri = rit_.findLM(rPrefix(i.name()));
-        if (! rit_.found(ri)) return;
+        if (! rit_.found(ri)) { ++stats_.ritMisses; return; }
 
         dit_.add(h);    // detect future copies of i as dups
 
         // add interest to PIT then give it to RIT's listener.
-        schedITO(pit_.add(i).first->second);
+        auto& pe = pit_.add(i, pkt, from).first->second;
+        dedTrack(pe, ri);
+        schedITO(pe);
         ri->second.iCb_(rName{*ri->second.name_}, i);
     }
 
@@ -237,16 +451,80 @@ class DirectFace {
         return vec;
     }
 
+    /**
+     * Call 'f' with each pending interest matching prefix 'p' (the ones
+     * pendingInterests() returns) in place, without collecting them. The PIT
+     * keeps an interest's entries in one run so this is a lookup plus the
+     * matches. 'f' may satisfy (send a Data for) the interest it's given but
+     * mustn't otherwise remove PIT entries.
+     */
+    template<typename F>
+    void forPendingInterests(const rName& p, F&& f) {
+        pit_.forAll(rPrefix(p), [&f](PITentry& pe) { if (pe.fromNet_ && !pe.ded_) f(pe.i_); });
+    }
+
+    // the peer to unicast the answer to 'pe' to (sin6_family 0 if it's multicast)
+    sockaddr_in6 replyTo(const PITentry& pe) const noexcept {
+        if (unicast_ && pe.fromNet_ && ! pe.shared_ && ! pe.dCb_ && pe.from_.sin6_family == AF_INET6) return pe.from_;
+        return {};
+    }
+    void sendReply(const sockaddr_in6& to, const uint8_t* pkt, size_t len) {
+        if (to.sin6_family == 0) { send(pkt, len); return; }
+        ++stats_.unicastOut;
+        io_.sendTo(to, pkt, len);
+    }
+
     /**
      * Handle an outgoing data:
      * - if it's not in the pit or not marked as 'fromNet', ignore it
-     * - otherwise, delete the pit entry then send the packet.
+     * - otherwise, delete the pit entry then send the packet (to just the
+     *   interest's sender if it can be, see unicastReplies).
      */
     void send(rData d) {
         auto pi = pit_.find(rPrefix(d.name()));
         if (! pit_.found(pi)) return;
+        auto to = replyTo(pi->second);
+        pitErase(pi);
+        ++stats_.dataOut;
+        sendReply(to, d.data(), d.size());
+    }
+
+    /**
+     * Send a burst of Data packets answering the same pending interest:
+     * - if the interest isn't in the pit, ignore the burst
+     * - otherwise, delete the pit entry, send the first packet now then
+     *   send the rest, in order, 'gap' apart so they don't overrun the
+     *   receiver or the link. The receiver's deferred delete window has
+     *   to be long enough to collect the burst.
+     */
+    template<typename D>
+    void send(std::vector<D>&& burst, std::chrono::microseconds gap) {
+        if (burst.empty()) return;
+        auto pi = pit_.find(rPrefix(rData(burst.front()).name()));
+        if (! pit_.found(pi)) return;
+        auto to = replyTo(pi->second);
         pitErase(pi);
-        send(d.data(), d.size());
+        stats_.dataOut += burst.size();
+        auto b = std::make_shared<std::vector<D>>(std::move(burst));
+        sendReply(to, (*b)[0].data(), (*b)[0].size());
+        for (size_t i = 1; i < b->size(); ++i) oneTime(gap * i, [this, b, i, to]{ sendReply(to, (*b)[i].data(), (*b)[i].size()); });
+    }
+
+    /**
+     * With a transport that can deliver every packet more than once (see
+     * TransportAggregate), the copies of a Data after the first would reach its
+     * still-lingering PIT entry's callback and each be validated (and decrypted)
+     * again. Drop them here by remembering a Data's hash for a short time. Only
+     * Data that's delivered is remembered so a copy that arrives before its
+     * interest is sent isn't suppressed.
+     */
+    bool dupData(const rData& d) {
+        if (! io_.mirrors()) return false;
+        if (ddt_.size() == 1) ddt_ = DIT(256, 1s);
+        auto h = ddt_.hash(d);
+        if (ddt_.contains(h)) return true;
+        ddt_.add(h);
+        return false;
     }
 
     /**
@@ -258,12 +536,13 @@ class DirectFace {
      */
     void handleData(rData d) {
         auto pi = pit_.find(rPrefix(d.name()));
-        if (! pit_.found(pi)) return;
+        if (! pit_.found(pi)) { ++stats_.unsolicited; dedLate(d); return; }
         if (! pi->second.dCb_) { pitErase(pi); return; }
 
         // let the PIT entry hang around 'in the background' for a short time
         // to collect additional responses to the interest then delete it.
         auto& pe = pi->second;
+        if (dupData(d)) { ++stats_.ddtHits; return; }
         schedDED(pe);
         pe.dCb_(pe.i_, d);
     }
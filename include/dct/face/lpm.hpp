@@ -27,15 +27,22 @@
  *  This is not intended as production code.
  */
 
+#include <cstring>
 #include <map>
 #include <type_traits>
+#include <unordered_map>
 #include "../schema/crpacket.hpp"
+#include "../mem_report.hpp"
 
 namespace dct {
 
 // need to be able to recognize containers that combine a view with its backing store
 template<typename C> concept lpmCapable = std::is_convertible_v<const C &, const rPrefix&>;
 
+// lpmLT longest-match strategies (see findLM below)
+struct lpmBySize {};    // an exact-match map lookup for each distinct prefix size
+struct lpmHashed {};    // a hash table probe at each component boundary of the name
+
 /**
  * Lookup table to do longest-prefix-match on wire-format names. Both the RIT and PIT
  * are lookup tables containing name prefixes that must be matched against some name
@@ -50,8 +57,16 @@ template<typename C> concept lpmCapable = std::is_convertible_v<const C &, const
  * guarantee that the data that backs the prefix exists unmodified during the lifetime
  * of each entry. Types that combine the backing data with the view (crName/crPrefix)
  * can be used to ensure this.
+ *
+ * 'Index' selects how findLM works. lpmBySize (the default) costs one map lookup (a
+ * log(n) series of memcmps) per distinct prefix size. lpmHashed also keeps a hash
+ * table of the prefixes and hashes the name incrementally, probing the table at each
+ * component boundary, so it costs one pass over the name plus a probe per component
+ * no matter how many prefixes are in the table. (Since it holds iterators into the
+ * map, an lpmHashed table can't be copied.) lpmHashed exact-match lookups ('find') are
+ * also done via the hash table.
  */
-template<typename Prefix, typename Entry> requires lpmCapable<Prefix>
+template<typename Prefix, typename Entry, typename Index = lpmBySize> requires lpmCapable<Prefix>
 struct lpmLT {
     struct cmp {
         using is_transparent = void;
@@ -62,38 +77,131 @@ struct lpmLT {
 
     using iterator = typename decltype(lt_)::iterator;
 
+    static constexpr bool hashed = std::is_same_v<Index, lpmHashed>;
+    struct noIndex {};
+    [[no_unique_address]] std::conditional_t<hashed, std::unordered_multimap<uint64_t,iterator>, noIndex> idx_{};
+
+    lpmLT() = default;
+    lpmLT(const lpmLT&) requires (! hashed) = default;
+    lpmLT& operator=(const lpmLT&) requires (! hashed) = default;
+    lpmLT(lpmLT&&) = default;
+    lpmLT& operator=(lpmLT&&) = default;
+
+    // (64 bit FNV-1a so the hash of a name can be extended a component at a time)
+    static constexpr uint64_t hashBasis = 0xcbf29ce484222325ull;
+    static constexpr uint64_t hashStep(uint64_t h, const uint8_t* b, const uint8_t* e) noexcept {
+        for (; b < e; ++b) h = (h ^ *b) * 0x100000001b3ull;
+        return h;
+    }
+    static constexpr uint64_t hashOf(const rPrefix& p) noexcept { return hashStep(hashBasis, p.data(), p.data() + p.size()); }
+
+    // offset of the end of the tlv starting at 'off' in 'd' or 0 if it's malformed
+    static constexpr size_t tlvEnd(const uint8_t* d, size_t sz, size_t off) noexcept {
+        if (off >= sz) return 0;
+        auto t = d[off];
+        if (t > tlvParser::extra_bytes_code) return 0;
+        off += t < tlvParser::extra_bytes_code? 1 : 3;
+        if (off >= sz) return 0;
+        size_t l = d[off];
+        if (l > tlvParser::extra_bytes_code) return 0;
+        if (l < tlvParser::extra_bytes_code) ++off;
+        else if (off + 2 < sz) { l = (size_t(d[off+1]) << 8) | d[off+2]; off += 3; }
+        else return 0;
+        return off + l <= sz? off + l : 0;
+    }
+
+    void indexAdd(iterator it) {
+        if constexpr (hashed) idx_.emplace(hashOf(it->first), it);
+    }
+    void indexErase(iterator it) {
+        if constexpr (hashed) {
+            auto [b, e] = idx_.equal_range(hashOf(it->first));
+            for (; b != e; ++b) if (b->second == it) { idx_.erase(b); return; }
+        }
+    }
+
     auto end() const noexcept { return lt_.end(); }
     auto found(iterator it) const noexcept { return it != lt_.end(); }
 
      // find exact match to name 'n'.  Returns iterator pointing to entry if found.
-    auto find(const rPrefix& n) noexcept { return lt_.find(n); }
-    auto contains(const rPrefix& n) const noexcept { return lt_.contains(n); }
+    auto find(const rPrefix& n) noexcept {
+        if constexpr (hashed) {
+            auto [b, e] = idx_.equal_range(hashOf(n));
+            for (; b != e; ++b) if (rPrefix{b->second->first} == n) return b->second;
+            return lt_.end();
+        } else {
+            return lt_.find(n);
+        }
+    }
+    auto contains(const rPrefix& n) const noexcept { return const_cast<lpmLT*>(this)->find(n) != lt_.end(); }
+
+    // heap bytes of the table (not including anything the entries own)
+    size_t heapBytes() const noexcept {
+        auto b = mem::map(lt_) + mem::map(sz_);
+        if constexpr (hashed) b += mem::hash(idx_);
+        return b;
+    }
 
     /*
      * find longest match to name 'n'
      */
     auto findLM(rPrefix n) noexcept {
-        for (auto [sz, cnt] : sz_) {
-            // Do an exact match lookup of n's prefix at each prefix size starting with longest.
-            // This code is not currently taking advantage of the map's ordering and would work
-            // as well with an unordered_map (but sacrifice 'findAllM()'). It could also be
-            // rewritten to explicitly traverse the tree, matching prefixes on the fly, but
-            // there's not yet performance data to justify this.
-            if (sz > n.size()) continue;
-            if (auto it = lt_.find(rPrefix(n,sz)); it != lt_.end()) return it;
+        if constexpr (hashed) {
+            if (lt_.empty()) return lt_.end();
+            auto d = n.data();
+            auto nsz = n.size();
+            auto best = lt_.end();
+            auto h = hashBasis;
+            for (size_t off = 0; ; ) {
+                // check for a prefix ending at this component boundary
+                auto [b, e] = idx_.equal_range(h);
+                for (; b != e; ++b) {
+                    if (b->second->first.size() == off && (off == 0 || std::memcmp(b->second->first.data(), d, off) == 0)) {
+                        best = b->second;
+                        break;
+                    }
+                }
+                if (off >= nsz || off >= sz_.begin()->first) break;
+                auto nxt = tlvEnd(d, nsz, off);
+                if (nxt == 0) break;
+                h = hashStep(h, d + off, d + nxt);
+                off = nxt;
+            }
+            return best;
+        } else {
+            for (auto [sz, cnt] : sz_) {
+                // Do an exact match lookup of n's prefix at each prefix size starting with longest.
+                // This code is not currently taking advantage of the map's ordering and would work
+                // as well with an unordered_map (but sacrifice 'findAllM()'). It could also be
+                // rewritten to explicitly traverse the tree, matching prefixes on the fly (see
+                // lpmHashed for a strategy whose cost doesn't depend on the number of sizes).
+                if (sz > n.size()) continue;
+                if (auto it = lt_.find(rPrefix(n,sz)); it != lt_.end()) return it;
+            }
+            return lt_.end();
         }
-        return lt_.end();
     }
     auto findLM(rName n) noexcept { return findLM(rPrefix{n}); }
 
     /*
      * invoke unary predicate 'pred' on all matches to prefix 'p'
+     *
+     * The map's ordering puts all the names that 'p' is a prefix of in one run
+     * starting at the first entry >= 'p' so this costs a lookup plus the matches.
      */
     template <typename Unary>
     auto findAll(const rPrefix& p, Unary pred) const noexcept {
-        auto sz = p.size();
-        for (const auto& kv : lt_) {
-            if (kv.first.size() >= sz && p == Prefix(kv.first, sz)) pred(kv);
+        for (auto it = lt_.lower_bound(p); it != lt_.end() && p.isPrefix(rPrefix{it->first}); ++it) pred(*it);
+    }
+
+    // as findAll but 'f' gets each matching entry's value and may erase that entry
+    // (but no other) since the walk has moved past it before the call. Callers must
+    // keep 'f' from reentering anything that erases other entries (see SyncPS::handleCStates).
+    template <typename Unary>
+    void forAll(const rPrefix& p, Unary f) {
+        for (auto it = lt_.lower_bound(p); it != lt_.end() && p.isPrefix(rPrefix{it->first}); ) {
+            auto cur = it++;
+            f(cur->second);
         }
     }
 
@@ -101,7 +209,10 @@ struct lpmLT {
     template <typename... Args>
     auto add(Prefix&& p, Args&&... args) {
         auto res = lt_.try_emplace(std::forward<Prefix>(p), std::forward<Args>(args)...);
-        if (res.second) sz_[p.size()]++;
+        if (res.second) {
+            sz_[res.first->first.size()]++;
+            indexAdd(res.first);
+        }
         return res;
     }
 
@@ -111,28 +222,26 @@ struct lpmLT {
 
     void erase(iterator it) {
         decrSize(it->first.size());
+        indexErase(it);
         lt_.erase(it);
     }
 
     // need C++23 to do this the right way:
     //void erase(const rPrefix& p) { if (lt_.erase(p) > 0) decrSize(p.size()); }
     void erase(const rPrefix& p) {
-        if (auto it = lt_.find(p); it != lt_.end()) {
-            decrSize(p.size());
-            lt_.erase(it);
-        }
-    }
-
-    auto extract(const rPrefix& p) {
-        auto nh = lt_.extract(p);
-        if (nh) decrSize(p.size());
-        return nh;
+        if (auto it = find(p); it != lt_.end()) erase(it);
     }
 
     auto extract(iterator it) {
         decrSize(it->first.size());
+        indexErase(it);
         return lt_.extract(it);
     }
+
+    auto extract(const rPrefix& p) {
+        if (auto it = find(p); it != lt_.end()) return extract(it);
+        return decltype(lt_.extract(p)){};
+    }
 };
 
 } // namespace dct
@@ -27,16 +27,85 @@
  *  This is not intended as production code.
  */
 
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
 #include <map>
+#include <memory>
 #include <set>
 #include <type_traits>
-#include <unordered_set>
+#include <netinet/in.h>
 
 #include "api.hpp"
 #include "lpm.hpp"
+#include "pkt_buf.hpp"
+#include "timer_service.hpp"
 
 namespace dct {
 
+/**
+ * A face's policy for how long PIT entries outlive their interest's satisfaction or
+ * lifetime. A satisfied entry of a locally expressed interest is kept for a deferred
+ * delete (DED) window to collect more answers (e.g., the cAdds of other members) and
+ * the entry of a peer's interest is kept a grace period past its lifetime so the
+ * peer's replacement interest finds it. With 'adaptive' off these are the face's
+ * fixed dedWindow() and 'itoGrace'. With it on, each registered prefix (a
+ * collection) gets a window set from the observed spread of the Data answering its
+ * interests. The grace period stays 'itoGrace' since it covers a peer's re-expression
+ * delay, which has nothing to do with how spread out the answers are.
+ */
+struct DedPolicy {
+    bool adaptive{false};
+    std::chrono::milliseconds minWindow{5};    // adaptive window bounds
+    std::chrono::milliseconds maxWindow{300};
+    std::chrono::milliseconds itoGrace{30};    // fixed grace for peers' interests
+};
+
+/*
+ * The adaptive DED window of one registered prefix. Each closed DED window gives the
+ * time from the first to the last answer it collected. The window is twice the
+ * smoothed spread plus the minimum (so a lone peer's answer gets a short window) and
+ * grows by half when an answer arrived in the last quarter of the window (answers
+ * were probably still coming when it closed) or when an answer to the interest of
+ * the window that just closed arrives after it (up to maxWindow later). Answers in
+ * a window alone can't show that it's too short so, without the late ones, the
+ * window would shrink to minWindow and stay there.
+ */
+struct DedTrack {
+    static constexpr double weight = 1./8;
+    double spread_{};       // smoothed answer spread (us)
+    double win_{};          // current window (us), 0 until there's a sample
+    uint64_t samples_{};
+    double hint_{};         // window (us) set by the prefix's owner (see DirectFace::adaptDedWindow), 0 if none
+    std::chrono::steady_clock::time_point closed_{};    // when the last window closed
+    size_t closedName_{};   // hash of the name its interest had (0 once a late answer's counted)
+
+    static constexpr double us(std::chrono::microseconds d) noexcept { return double(d.count()); }
+
+    void sample(std::chrono::microseconds spread, bool late, const DedPolicy& p) noexcept {
+        spread_ = samples_++ == 0? us(spread) : spread_ + weight * (us(spread) - spread_);
+        auto w = 2 * spread_ + us(p.minWindow);
+        if (late) w = std::max(w, win_ * 1.5);
+        win_ = std::clamp(w, us(p.minWindow), us(p.maxWindow));
+    }
+    void close(size_t name) noexcept {
+        closed_ = std::chrono::steady_clock::now();
+        closedName_ = name;
+    }
+    // an answer with name hash 'name' that no PIT entry wanted arrived
+    void unsolicited(size_t name, const DedPolicy& p) noexcept {
+        if (! samples_ || name != closedName_ || std::chrono::steady_clock::now() - closed_ > p.maxWindow) return;
+        closedName_ = 0;
+        win_ = std::clamp(win_ * 1.5, us(p.minWindow), us(p.maxWindow));
+    }
+    std::chrono::milliseconds window(std::chrono::milliseconds dflt) const noexcept {
+        auto w = std::max(samples_? win_ : 0., hint_);
+        return w > 0? std::chrono::ceil<std::chrono::milliseconds>(std::chrono::microseconds(int64_t(w))) : dflt;
+    }
+    void hint(std::chrono::milliseconds w) noexcept { hint_ = us(w); }
+};
+
 /**
  * The Registered Interest Table (RIT) delivers incoming Interests to a
  * handler that may be able to satisfy them (respond with an appropriate
@@ -52,6 +121,7 @@ struct RITentry {
     InterestCb iCb_;
     std::vector<uint8_t>* name_;    // The 'prefix' is supplied as an rName since that's needed for the callback.
                                     // Its backing data is copied to the heap with a pointer here.
+    std::shared_ptr<DedTrack> dt_{}; // adaptive DED window of the prefix (made when first needed)
 
     RITentry(const rName& n, InterestCb&& iCb) : iCb_{std::move(iCb)},
         name_{new std::vector<uint8_t>{n.m_blk.begin(), n.m_blk.end()}} { }
@@ -70,24 +140,86 @@ struct RIT : lpmLT<rPrefix, RITentry> {
  * hashes each arriving Interest and compares it to a set recent hashes. If
  * the hash is not in the set it's accepted and added to the set. Otherwise
  * it's discarded.
+ *
+ * The set is a fixed size ring of (hash, arrival time) in arrival order plus
+ * an open-addressed (linear probe) index of ring positions with at least twice
+ * as many slots as the ring. Adding a hash overwrites the oldest ring entry and
+ * removes it from the index so every operation is O(1), nothing is allocated
+ * after construction and which entry gets evicted is deterministic. Entries
+ * older than 'maxAge' are ignored so a flood of Interests can't make the DIT
+ * suppress a re-expression that arrives long after the original.
  */
-struct DIT : std::unordered_set<size_t> {
-    std::unordered_set<size_t> ihash_{};
+struct DIT {
+    using clock = std::chrono::steady_clock;
+    struct Ent {
+        size_t h_;
+        clock::time_point t_;
+    };
+    static constexpr uint32_t noPos = ~0u;
+
+    std::vector<Ent> ring_;
+    std::vector<uint32_t> idx_;     // ring position of each entry or 'noPos' if slot is empty
+    clock::duration maxAge_;
+    size_t imask_;
+    uint32_t next_{};               // ring position that will be (over)written next
+    uint32_t cnt_{};                // number of ring positions in use
 
-    auto hash(const rInterest& i) const noexcept { return std::hash<tlvParser>{}(i); }
+    explicit DIT(size_t size = 256, clock::duration maxAge = std::chrono::seconds(10)) :
+            ring_(size? size : 1), idx_(std::bit_ceil(ring_.size() * 2), noPos), maxAge_{maxAge},
+            imask_{idx_.size() - 1} {}
+
+    auto size() const noexcept { return ring_.size(); }
+    auto maxAge() const noexcept { return maxAge_; }
+
+    auto hash(const tlvParser& p) const noexcept { return std::hash<tlvParser>{}(p); }
 
     void add(size_t h) {
-        // if too many entries, remove a random one
-        if (ihash_.size() >= 256) {
-            auto it = ihash_.begin();
-            for (int b = h & 0xff; b-- > 0; it++) { }
-            ihash_.erase(it);
+        auto now = clock::now();
+        auto s = slot(h);
+        if (idx_[s] != noPos) {
+            // already present - just refresh its time
+            ring_[idx_[s]].t_ = now;
+            return;
         }
-        ihash_.emplace(h);
+        if (cnt_ == ring_.size()) {
+            erase(ring_[next_].h_);
+            s = slot(h);    // erase may have moved entries
+        } else ++cnt_;
+        ring_[next_] = {h, now};
+        idx_[s] = next_;
+        if (++next_ == ring_.size()) next_ = 0;
     }
     void add(const rInterest& i) { add(hash(i)); }
 
-    auto dupInterest(const rInterest& i) { auto h = hash(i); return std::pair(ihash_.contains(h), h); }
+    bool contains(size_t h) const noexcept {
+        auto p = idx_[slot(h)];
+        return p != noPos && clock::now() - ring_[p].t_ < maxAge_;
+    }
+
+    auto dupInterest(const rInterest& i) { auto h = hash(i); return std::pair(contains(h), h); }
+
+  private:
+    // index slot holding 'h' or, if 'h' isn't present, the empty slot that ends its probe sequence
+    size_t slot(size_t h) const noexcept {
+        auto s = h & imask_;
+        while (idx_[s] != noPos && ring_[idx_[s]].h_ != h) s = (s + 1) & imask_;
+        return s;
+    }
+
+    // remove 'h' from the index, back shifting later entries of its probe run to fill the hole
+    void erase(size_t h) noexcept {
+        auto s = slot(h);
+        if (idx_[s] == noPos) return;
+        for (auto n = (s + 1) & imask_; idx_[n] != noPos; n = (n + 1) & imask_) {
+            auto home = ring_[idx_[n]].h_ & imask_;
+            // entry at 'n' can move to 's' if its home isn't cyclically in (s, n]
+            if (((n - home) & imask_) >= ((n - s) & imask_)) {
+                idx_[s] = idx_[n];
+                s = n;
+            }
+        }
+        idx_[s] = noPos;
+    }
 };
 
 /**
@@ -100,49 +232,68 @@ struct DIT : std::unordered_set<size_t> {
  *
  * PIT entrys are deleted when satisfied by a Data or when they time out.
  *
- * All Interests and Datas are matched against the PIT.
+ * All Interests and Datas are matched against the PIT. Since Data matching is exact, the
+ * PIT uses lpmLT's hashed index so a match costs a hash of the name and one probe.
  */
 struct PITentry {
-    using TOptr = std::unique_ptr<Timer>;
 
-    std::unique_ptr<std::vector<uint8_t>> idat_{}; // bytes of the interest (backing store for prefix & interest_)
+    PktRef pkt_{};  // bytes of the interest (backing store for prefix & i_)
     rInterest i_{};
     DataCb dCb_{};
     InterestTO ito_{};
-    TOptr timer_{};
+    TimerHandle timer_{};   // timeout (or deferred delete) of this entry
+    std::chrono::steady_clock::time_point netTime_{};   // when the interest was last heard from the net
+    sockaddr_in6 from_{};   // who sent it (sin6_family 0 if unknown)
     bool fromNet_{false};
+    bool shared_{false};    // heard from more than one sender
     bool ded_{false};
+    bool late_{false};      // an answer arrived near the end of the DED window
+    std::shared_ptr<DedTrack> dt_{};    // adaptive DED window of the interest's prefix (if any)
+    std::chrono::steady_clock::time_point first_{}, last_{}; // first & last answers in the DED window
 
-    PITentry(const rInterest& i, DataCb&& dCb, InterestTO&& ito) :
-                idat_{std::make_unique<std::vector<uint8_t>>(i.m_blk.begin(), i.m_blk.end())}, i_{*idat_},
+    PITentry(PktPool& pool, const rInterest& i, DataCb&& dCb, InterestTO&& ito) :
+                pkt_{PktRef::copy(pool, i.data(), i.size())}, i_{pkt_.data(), pkt_.size()},
                 dCb_{std::move(dCb)}, ito_{std::move(ito)} { }
 
-    PITentry(const rInterest& i) :
-                idat_{std::make_unique<std::vector<uint8_t>>(i.m_blk.begin(), i.m_blk.end())}, i_{*idat_},
-                fromNet_{true} { }
+    // an interest from the net can share the transport buffer it arrived in
+    // ('pkt') rather than being copied.
+    PITentry(PktPool& pool, const rInterest& i, const PktRef& pkt, const sockaddr_in6& from = {}) :
+                pkt_{pkt && pkt.data() == i.data() && pkt.size() == i.size()? pkt : PktRef::copy(pool, i.data(), i.size())},
+                i_{pkt_.data(), pkt_.size()}, netTime_{std::chrono::steady_clock::now()}, from_{from}, fromNet_{true} { }
 
-    auto& cancelTimer() {
-        if (timer_) {
-            timer_->cancel();
-            timer_.reset();
-        }
+    static bool sameSender(const sockaddr_in6& a, const sockaddr_in6& b) noexcept {
+        return a.sin6_port == b.sin6_port && std::memcmp(&a.sin6_addr, &b.sin6_addr, sizeof(a.sin6_addr)) == 0;
+    }
+
+    PITentry(PITentry&&) = default;
+    PITentry& operator=(PITentry&&) = default;
+    // an entry's timer mustn't outlive it (its callback would find a later entry with the same name)
+    ~PITentry() { cancelTimer(); }
+
+    PITentry& cancelTimer() {
+        timer_.cancel();
+        timer_.reset();
         return *this;
     }
 
     auto& timer() const noexcept { return timer_; }
 
-    auto& timer(TOptr&& t) {
+    auto& timer(TimerHandle&& t) {
         cancelTimer();
         timer_ = std::move(t);
         return *this;
     }
 };
 
-struct PIT : lpmLT<rPrefix, PITentry> {
-    using iterator = lpmLT<rPrefix, PITentry>::iterator;
+struct PIT : lpmLT<rPrefix, PITentry, lpmHashed> {
+    using iterator = lpmLT<rPrefix, PITentry, lpmHashed>::iterator;
+
+    PktPool& pool_;     // for copies of the interests (the face transport's pool, see pkt_buf.hpp)
 
-    auto erase(const rInterest& i) { lpmLT<rPrefix, PITentry>::erase(rPrefix{i.name()}); }
-    auto erase(iterator it) { lpmLT<rPrefix, PITentry>::erase(it); }
+    explicit PIT(PktPool& pool) : pool_{pool} { }
+
+    auto erase(const rInterest& i) { lpmLT<rPrefix, PITentry, lpmHashed>::erase(rPrefix{i.name()}); }
+    auto erase(iterator it) { lpmLT<rPrefix, PITentry, lpmHashed>::erase(it); }
 
     // Interest Time-Out callback
     // The PIT entry needs to be deleted and, since the callback might want to reinstate it,
@@ -151,19 +302,19 @@ struct PIT : lpmLT<rPrefix, PITentry> {
         auto nh = extract(rPrefix(i.name())); // remove entry from PIT
         //if (! nh) abort();
         if (! nh) return;
-        if (auto& pe = nh.mapped(); pe.ito_) pe.ito_(rInterest(*pe.idat_));
+        if (auto& pe = nh.mapped(); pe.ito_) pe.ito_(pe.i_);
     }
 
     /**
      * add a pit entry to the PIT. 
      *
-     * The entry has to contain a copy of the Interest which may be large (e.g. Sync Interests
+     * The entry has to keep the Interest which may be large (e.g. Sync Interests
      * names contain an iblt of O(128) bytes) so we want to minimize copying. Also, the key is the
-     * Interest name and we don't want two copies so the entry contains a pointer to a vector
+     * Interest name and we don't want two copies so the entry holds a reference to a packet buffer
      * containing the raw Interest and we build build the prefix from that.
      */
     auto add(PITentry&& e) {
-        return lpmLT<rPrefix, PITentry>::add(rPrefix{e.i_.name()}, std::move(e));
+        return lpmLT<rPrefix, PITentry, lpmHashed>::add(rPrefix{e.i_.name()}, std::move(e));
     }
 
     /**
@@ -187,17 +338,22 @@ struct PIT : lpmLT<rPrefix, PITentry> {
             pe.ito_ = std::move(ito);
             return std::pair<iterator,bool>{it, false};
         }
-        return add(PITentry{i, std::move(onD), std::move(ito)});
+        return add(PITentry{pool_, i, std::move(onD), std::move(ito)});
     }
 
-    // add network generated interest to PIT
-    auto add(const rInterest& i) {
+    // add network generated interest to PIT. 'pkt', if set, is the buffer 'i' arrived in
+    // and 'from', if known, its sender.
+    auto add(const rInterest& i, const PktRef& pkt = {}, const sockaddr_in6& from = {}) {
         if (auto it = find(rPrefix(i.name())); found(it)) {
             // update existing entry
-            it->second.fromNet_ = true;
+            auto& pe = it->second;
+            if (! pe.fromNet_) pe.from_ = from;
+            else if (! PITentry::sameSender(pe.from_, from)) pe.shared_ = true;
+            pe.fromNet_ = true;
+            pe.netTime_ = std::chrono::steady_clock::now();
             return std::pair<iterator,bool>{it, false};
         }
-        return add(PITentry{i});
+        return add(PITentry{pool_, i, pkt, from});
     }
 };
 
@@ -0,0 +1,157 @@
+#ifndef DCT_FACE_PACER_HPP
+#define DCT_FACE_PACER_HPP
+#pragma once
+/*
+ * Token bucket send pacing for Direct Face transports
+ *
+ * Copyright (C) 2022 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This is not intended as production code.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+
+#include <boost/asio/steady_timer.hpp>
+
+#include "counters.hpp"
+#include "pkt_buf.hpp"
+#include "invocable.h"
+
+namespace dct {
+
+struct PacerStats {
+    Counter sent{};         // packets sent
+    Counter delayed{};      // packets that had to wait in the queue
+    Counter dropped{};      // packets dropped because the queue was full
+    Gauge depth{};          // packets currently queued
+    Gauge bytes{};          // bytes currently queued
+    Gauge maxDepth{};       // most packets ever queued
+
+    std::string str() const {
+        return format("sent {} delayed {} dropped {} queued {} ({}B) max {}",
+                      sent.get(), delayed.get(), dropped.get(), depth.get(), bytes.get(), maxDepth.get());
+    }
+};
+
+/**
+ * A transport normally sends each packet as soon as it's handed one so a
+ * burst (e.g., the cAdds answering a cState or a relay's fan-out) goes out at
+ * line rate and can overrun peers' socket buffers. The losses this causes
+ * trigger more sync rounds and so more bursts.
+ *
+ * A Pacer limits the transport's send rate to 'rate' bytes/sec with bursts of
+ * up to 'burst' bytes (a token bucket). Packets that can't go immediately wait
+ * in one of two queues: Interests (cStates, whose loss stalls sync for a whole
+ * round) go ahead of everything else. Packets are dropped (newest first) when
+ * the queued bytes would exceed 'maxQueue' (an Interest first pushes out
+ * queued non-Interests).
+ */
+struct Pacer {
+    using Clock = std::chrono::steady_clock;
+    using Out = ofats::any_invocable<void(const uint8_t*, size_t)>;
+
+    PktPool& pool_;         // the transport's buffer pool (for queued packets)
+    Out out_;
+    boost::asio::steady_timer timer_;
+    double rate_;           // bytes per second
+    double burst_;          // bucket size in bytes
+    size_t maxQueue_;       // max bytes queued
+    double tokens_;
+    Clock::time_point last_{Clock::now()};
+    std::deque<PktRef> hi_{};
+    std::deque<PktRef> lo_{};
+    size_t qbytes_{};
+    bool waiting_{false};
+    PacerStats stats_{};
+
+    Pacer(PktPool& pool, boost::asio::io_context& ioc, Out&& out, double rate, size_t burst, size_t maxQueue)
+        : pool_{pool}, out_{std::move(out)}, timer_{ioc}, rate_{rate}, burst_{double(burst)}, maxQueue_{maxQueue}, tokens_{double(burst)} {
+        if (rate <= 0) throw runtime_error("Pacer: rate must be positive");
+    }
+    Pacer(const Pacer&) = delete;
+    Pacer& operator=(const Pacer&) = delete;
+
+    const auto& stats() const noexcept { return stats_; }
+
+    void send(const uint8_t* pkt, size_t len) {
+        refill();
+        if (tokens_ > 0 && hi_.empty() && lo_.empty()) { xmit(pkt, len); return; }
+        bool hi = tlv(pkt[0]) == tlv::Interest;
+        // an Interest can push out queued lower priority packets
+        while (hi && qbytes_ + len > maxQueue_ && ! lo_.empty()) {
+            qbytes_ -= lo_.back().size();
+            lo_.pop_back();
+            ++stats_.dropped;
+        }
+        if (qbytes_ + len > maxQueue_) { ++stats_.dropped; gauge(); return; }
+        (hi? hi_ : lo_).emplace_back(PktRef::copy(pool_, pkt, len));
+        qbytes_ += len;
+        ++stats_.delayed;
+        gauge();
+        drain();
+    }
+
+  private:
+    void refill() {
+        auto now = Clock::now();
+        tokens_ = std::min(burst_, tokens_ + rate_ * std::chrono::duration<double>(now - last_).count());
+        last_ = now;
+    }
+
+    // a packet can go when there's a positive balance (its size can take the balance negative
+    // which just delays the next packet) so a bucket smaller than a packet still works.
+    void xmit(const uint8_t* pkt, size_t len) {
+        tokens_ -= len;
+        ++stats_.sent;
+        out_(pkt, len);
+    }
+
+    void gauge() {
+        stats_.depth.set(hi_.size() + lo_.size());
+        stats_.bytes.set(qbytes_);
+        if (stats_.depth.get() > stats_.maxDepth.get()) stats_.maxDepth.set(stats_.depth.get());
+    }
+
+    void drain() {
+        if (waiting_) return;
+        refill();
+        while (tokens_ > 0 && (! hi_.empty() || ! lo_.empty())) {
+            auto& q = hi_.empty()? lo_ : hi_;
+            auto p = std::move(q.front());
+            q.pop_front();
+            qbytes_ -= p.size();
+            xmit(p.data(), p.size());
+        }
+        gauge();
+        if (hi_.empty() && lo_.empty()) return;
+        // wait until the balance is positive again
+        waiting_ = true;
+        timer_.expires_after(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>((1 - tokens_) / rate_)));
+        timer_.async_wait([this](const auto& e) {
+                // the pacer may no longer exist if the wait was aborted
+                if (e != boost::system::errc::success) return;
+                waiting_ = false;
+                drain();
+            });
+    }
+};
+
+} // namespace dct
+
+#endif  // DCT_FACE_PACER_HPP
@@ -0,0 +1,236 @@
+#ifndef DCT_FACE_PACKET_RING_HPP
+#define DCT_FACE_PACKET_RING_HPP
+#pragma once
+/*
+ * Raw Ethernet packet I/O via mmap'd AF_PACKET (TPACKET_V3) rings
+ *
+ * Copyright (C) 2022 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This is not intended as production code.
+ */
+
+#if defined(__linux__) && __has_include(<linux/if_packet.h>)
+#define DCT_HAVE_PACKET_RING 1
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "pkt_buf.hpp"
+
+namespace dct {
+
+/**
+ * DCT packets carried directly in Ethernet frames on a single L2 segment
+ * (no IPv6/UDP headers and no IP multicast group management). Frames use
+ * NDN's Ethertype and its Ethernet multicast group address so they're
+ * compatible with NDN Ethernet faces.
+ *
+ * Receive and transmit both use rings shared with the kernel. The receive
+ * ring is TPACKET_V3: the kernel fills variable size frames into blocks and
+ * hands a block to us when it's full or has aged 'rxTimeout' ms so one wakeup
+ * can deliver many packets. Sends are written into transmit ring frames and
+ * a single (empty) send() kicks the kernel to transmit all that are ready.
+ *
+ * Opening an AF_PACKET socket requires CAP_NET_RAW.
+ */
+struct PacketRing {
+    static constexpr uint16_t etherType = 0x8624;   // NDN
+    static constexpr std::array<uint8_t,6> mcastAddr{0x01, 0x00, 0x5e, 0x00, 0x17, 0xaa};
+    static constexpr size_t hdrLen = ETH_HLEN;
+
+    // receive ring: 'rxBlocks' blocks of 'rxBlockSize' bytes
+    static constexpr uint32_t rxBlockSize = 1u << 18;
+    static constexpr uint32_t rxBlocks = 16;
+    static constexpr uint32_t rxFrameSize = 1u << 11;   // (only used to size the ring)
+    static constexpr uint32_t rxTimeout = 2;            // ms before a partly full block is handed over
+    // transmit ring: fixed size frames that can hold any PktBuf plus headers
+    static constexpr uint32_t txFrameSize = 1u << 14;
+    static constexpr uint32_t txBlockSize = 1u << 16;
+    static constexpr uint32_t txBlocks = 16;
+    static constexpr uint32_t txFrames = txBlockSize / txFrameSize * txBlocks;
+    static constexpr size_t txDataOff = TPACKET_ALIGN(sizeof(tpacket3_hdr));
+
+    int fd_{-1};
+    uint8_t* map_{};
+    size_t mapLen_{};
+    uint8_t* rx_{};
+    uint8_t* tx_{};
+    uint32_t rxb_{};            // next rx block to check
+    uint32_t txf_{};            // next tx frame to fill
+    size_t mtu_{};
+    std::array<uint8_t,hdrLen> ehdr_{};   // header of frames we send
+
+    static auto err(const std::string& what) {
+        return runtime_error(format("PacketRing {}: {}", what, std::strerror(errno)));
+    }
+
+    explicit PacketRing(const std::string& ifname) {
+        auto ifindex = ::if_nametoindex(ifname.c_str());
+        if (ifindex == 0) throw err("no interface " + ifname);
+        fd_ = ::socket(AF_PACKET, SOCK_RAW | SOCK_NONBLOCK, htons(etherType));
+        if (fd_ < 0) throw err("can't open socket (needs CAP_NET_RAW)");
+        try {
+            setup(ifname, ifindex);
+        } catch (...) {
+            if (map_) ::munmap(map_, mapLen_);
+            ::close(fd_);
+            throw;
+        }
+    }
+    PacketRing(const PacketRing&) = delete;
+    PacketRing& operator=(const PacketRing&) = delete;
+    ~PacketRing() {
+        if (map_) ::munmap(map_, mapLen_);
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    int fd() const noexcept { return fd_; }
+    size_t maxPayload() const noexcept { return mtu_; }
+
+  private:
+    void sopt(int opt, const void* v, socklen_t len, const char* what) {
+        if (::setsockopt(fd_, SOL_PACKET, opt, v, len) != 0) throw err(what);
+    }
+
+    void setup(const std::string& ifname, unsigned ifindex) {
+        int v = TPACKET_V3;
+        sopt(PACKET_VERSION, &v, sizeof(v), "can't set TPACKET_V3");
+#ifdef PACKET_IGNORE_OUTGOING
+        // don't receive our own transmissions (older kernels: filtered by pkttype below)
+        v = 1;
+        ::setsockopt(fd_, SOL_PACKET, PACKET_IGNORE_OUTGOING, &v, sizeof(v));
+#endif
+        tpacket_req3 rq{};
+        rq.tp_block_size = rxBlockSize;
+        rq.tp_block_nr = rxBlocks;
+        rq.tp_frame_size = rxFrameSize;
+        rq.tp_frame_nr = rxBlockSize / rxFrameSize * rxBlocks;
+        rq.tp_retire_blk_tov = rxTimeout;
+        sopt(PACKET_RX_RING, &rq, sizeof(rq), "can't make rx ring");
+        tpacket_req3 tq{};
+        tq.tp_block_size = txBlockSize;
+        tq.tp_block_nr = txBlocks;
+        tq.tp_frame_size = txFrameSize;
+        tq.tp_frame_nr = txFrames;
+        sopt(PACKET_TX_RING, &tq, sizeof(tq), "can't make tx ring");
+
+        // the rings are mapped together, rx first
+        mapLen_ = size_t(rxBlockSize) * rxBlocks + size_t(txBlockSize) * txBlocks;
+        auto m = ::mmap(nullptr, mapLen_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, fd_, 0);
+        if (m == MAP_FAILED) m = ::mmap(nullptr, mapLen_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (m == MAP_FAILED) throw err("can't map rings");
+        map_ = static_cast<uint8_t*>(m);
+        rx_ = map_;
+        tx_ = map_ + size_t(rxBlockSize) * rxBlocks;
+
+        sockaddr_ll sa{};
+        sa.sll_family = AF_PACKET;
+        sa.sll_protocol = htons(etherType);
+        sa.sll_ifindex = ifindex;
+        if (::bind(fd_, (sockaddr*)&sa, sizeof(sa)) != 0) throw err("can't bind to " + ifname);
+
+        packet_mreq mr{};
+        mr.mr_ifindex = ifindex;
+        mr.mr_type = PACKET_MR_MULTICAST;
+        mr.mr_alen = mcastAddr.size();
+        std::memcpy(mr.mr_address, mcastAddr.data(), mcastAddr.size());
+        sopt(PACKET_ADD_MEMBERSHIP, &mr, sizeof(mr), "can't join multicast group");
+
+        ifreq ifr{};
+        std::strncpy(ifr.ifr_name, ifname.c_str(), IFNAMSIZ - 1);
+        if (::ioctl(fd_, SIOCGIFHWADDR, &ifr) != 0) throw err("can't get MAC of " + ifname);
+        std::memcpy(ehdr_.data(), mcastAddr.data(), ETH_ALEN);
+        std::memcpy(ehdr_.data() + ETH_ALEN, ifr.ifr_hwaddr.sa_data, ETH_ALEN);
+        ehdr_[12] = etherType >> 8;
+        ehdr_[13] = etherType & 0xff;
+        if (::ioctl(fd_, SIOCGIFMTU, &ifr) != 0) throw err("can't get MTU of " + ifname);
+        mtu_ = std::min<size_t>(ifr.ifr_mtu, PktBuf::capacity);
+    }
+
+    // ring status words are shared with the kernel
+    static auto status(uint32_t& s) noexcept { return std::atomic_ref<uint32_t>(s).load(std::memory_order_acquire); }
+    static void setStatus(uint32_t& s, uint32_t v) noexcept { std::atomic_ref<uint32_t>(s).store(v, std::memory_order_release); }
+
+  public:
+    /**
+     * Call 'cb(const uint8_t* payload, size_t len)' for each packet in all the
+     * rx blocks the kernel has handed over (then return the blocks). 'len' is
+     * the frame's payload length which may include Ethernet padding. Returns
+     * the number of packets.
+     */
+    template<typename CB>
+    size_t receive(CB&& cb) {
+        size_t n{};
+        while (true) {
+            auto bd = reinterpret_cast<tpacket_block_desc*>(rx_ + size_t(rxb_) * rxBlockSize);
+            if ((status(bd->hdr.bh1.block_status) & TP_STATUS_USER) == 0) return n;
+            auto h = reinterpret_cast<tpacket3_hdr*>((uint8_t*)bd + bd->hdr.bh1.offset_to_first_pkt);
+            for (uint32_t i = 0, np = bd->hdr.bh1.num_pkts; i < np; ++i) {
+                auto ll = reinterpret_cast<const sockaddr_ll*>((uint8_t*)h + TPACKET_ALIGN(sizeof(tpacket3_hdr)));
+                if (ll->sll_pkttype != PACKET_OUTGOING && h->tp_snaplen > hdrLen) {
+                    cb((const uint8_t*)h + h->tp_mac + hdrLen, size_t(h->tp_snaplen - hdrLen));
+                    ++n;
+                }
+                h = reinterpret_cast<tpacket3_hdr*>((uint8_t*)h + h->tp_next_offset);
+            }
+            setStatus(bd->hdr.bh1.block_status, TP_STATUS_KERNEL);
+            rxb_ = (rxb_ + 1) % rxBlocks;
+        }
+    }
+
+    /**
+     * Put a packet in the next tx frame. Returns false if the ring is full
+     * (i.e., the kernel hasn't sent the previous 'txFrames' packets yet).
+     * The packet isn't sent until the next kick().
+     */
+    bool queue(const uint8_t* pkt, size_t len) {
+        if (len > mtu_) throw runtime_error("PacketRing: packet too big");
+        auto h = reinterpret_cast<tpacket3_hdr*>(tx_ + size_t(txf_) * txFrameSize);
+        auto s = status(h->tp_status);
+        if (s == TP_STATUS_SEND_REQUEST || s == TP_STATUS_SENDING) return false;
+        auto d = (uint8_t*)h + txDataOff;
+        std::memcpy(d, ehdr_.data(), hdrLen);
+        std::memcpy(d + hdrLen, pkt, len);
+        h->tp_len = hdrLen + len;
+        h->tp_next_offset = 0;
+        setStatus(h->tp_status, TP_STATUS_SEND_REQUEST);
+        txf_ = (txf_ + 1) % txFrames;
+        return true;
+    }
+
+    // have the kernel send all queued frames
+    void kick() noexcept {
+        while (::send(fd_, nullptr, 0, MSG_DONTWAIT) < 0 && errno == EINTR) { }
+    }
+};
+
+} // namespace dct
+
+#endif  // __linux__
+
+#endif  // DCT_FACE_PACKET_RING_HPP
@@ -0,0 +1,147 @@
+#ifndef DCT_FACE_PKT_BUF_HPP
+#define DCT_FACE_PKT_BUF_HPP
+#pragma once
+/*
+ * Pool of reference counted packet buffers for Direct Face transports
+ *
+ * Copyright (C) 2022 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This is not intended as production code.
+ */
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <utility>
+
+#include <dct/schema/rpacket.hpp>
+
+namespace dct {
+
+/**
+ * Transports receive each packet into a PktBuf taken from their PktPool. The
+ * buffer is handed to the face via a PktRef (an intrusive refcounted handle)
+ * so anything that needs the packet after the receive upcall (e.g., a PIT
+ * entry) can keep it by copying the handle rather than the bytes. When the
+ * last handle goes away the buffer goes back on its pool's free list so, in
+ * steady state, receiving a packet costs neither an allocation nor a copy.
+ *
+ * Refcounts aren't atomic and a pool has no lock so a pool and all the
+ * handles of its buffers must only be used by one thread at a time. Each
+ * transport has its own pool (which lives as long as the transport) so that
+ * thread is the one running the face's io_context, and whichever thread
+ * constructs or destroys the face while it's not running. (A per-thread pool
+ * would get the first receive buffers of a face constructed on one thread and
+ * run on another and then have them put back from the wrong thread.)
+ */
+struct PktPool;
+
+struct PktBuf {
+    // no smaller than 1500 byte MTU - 40 IPv6 - 8 UDP = 1452 payload
+    // and big enough for a 9000 byte jumbo frame's 8952.
+    static constexpr size_t capacity = 9000 - 40 - 8;
+
+    PktPool* pool_;
+    PktBuf* next_{};        // free list link
+    uint32_t refs_{};
+    uint32_t off_{};        // start of packet in 'data_' (some receivers put a header first)
+    uint32_t len_{};        // bytes of packet
+    std::array<uint8_t, capacity> data_;
+
+    explicit PktBuf(PktPool* pool) noexcept : pool_{pool} { }
+};
+
+struct PktPool {
+    PktBuf* free_{};
+    size_t nfree_{};
+    size_t maxFree_{256};   // buffers beyond this are returned to the heap
+
+    PktPool() = default;
+    PktPool(const PktPool&) = delete;
+    PktPool& operator=(const PktPool&) = delete;
+    ~PktPool() {
+        while (free_) delete std::exchange(free_, free_->next_);
+    }
+
+    PktBuf* take() {
+        if (free_ == nullptr) return new PktBuf(this);
+        --nfree_;
+        return std::exchange(free_, free_->next_);
+    }
+
+    void put(PktBuf* b) noexcept {
+        if (nfree_ >= maxFree_) { delete b; return; }
+        b->next_ = std::exchange(free_, b);
+        ++nfree_;
+    }
+};
+
+class PktRef {
+    PktBuf* b_{};
+
+    void release() noexcept { if (b_ && --b_->refs_ == 0) b_->pool_->put(b_); b_ = nullptr; }
+
+  public:
+    PktRef() = default;
+    explicit PktRef(PktBuf* b) noexcept : b_{b} { b_->refs_ = 1; b_->off_ = 0; b_->len_ = 0; }
+    PktRef(const PktRef& r) noexcept : b_{r.b_} { if (b_) ++b_->refs_; }
+    PktRef(PktRef&& r) noexcept : b_{std::exchange(r.b_, nullptr)} { }
+    PktRef& operator=(const PktRef& r) noexcept {
+        auto b = r.b_;
+        if (b) ++b->refs_;
+        release();
+        b_ = b;
+        return *this;
+    }
+    PktRef& operator=(PktRef&& r) noexcept {
+        if (this != &r) { release(); b_ = std::exchange(r.b_, nullptr); }
+        return *this;
+    }
+    ~PktRef() { release(); }
+
+    // get an empty buffer from 'pool'
+    static PktRef get(PktPool& pool) { return PktRef{pool.take()}; }
+
+    // get a buffer from 'pool' containing a copy of 'len' bytes at 'p'
+    static PktRef copy(PktPool& pool, const uint8_t* p, size_t len) {
+        if (len > PktBuf::capacity) throw runtime_error("PktRef: packet too big");
+        auto r = get(pool);
+        std::memcpy(r.buf(), p, len);
+        r.len(len);
+        return r;
+    }
+
+    explicit operator bool() const noexcept { return b_ != nullptr; }
+    bool unique() const noexcept { return b_ && b_->refs_ == 1; }
+    void reset() noexcept { release(); }
+
+    // whole buffer (for receives)
+    uint8_t* buf() const noexcept { return b_->data_.data(); }
+    static constexpr size_t capacity() noexcept { return PktBuf::capacity; }
+
+    // the packet in the buffer
+    const uint8_t* data() const noexcept { return b_->data_.data() + b_->off_; }
+    size_t size() const noexcept { return b_->len_; }
+    void len(size_t n) noexcept { b_->len_ = n; }
+    void off(size_t o) noexcept { b_->off_ = o; }
+    auto span() const noexcept { return std::span<const uint8_t>(data(), size()); }
+};
+
+} // namespace dct
+
+#endif  // DCT_FACE_PKT_BUF_HPP
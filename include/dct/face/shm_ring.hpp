@@ -0,0 +1,201 @@
+#ifndef DCT_FACE_SHM_RING_HPP
+#define DCT_FACE_SHM_RING_HPP
+#pragma once
+/*
+ * Shared memory broadcast packet ring for co-located DCT applications
+ *
+ * Copyright (C) 2022 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This is not intended as production code.
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pkt_buf.hpp"
+
+namespace dct {
+
+/**
+ * A broadcast ring in a named POSIX shared memory segment. Any number of
+ * processes can send packets into it and every member receives every packet
+ * (except its own), i.e., it has the semantics of a localhost multicast
+ * group without the kernel copying each packet to each receiver.
+ *
+ * Each packet goes in the next slot of a fixed size ring. A sender claims a
+ * slot by incrementing the ring's 'head' then copies its packet in, guarded
+ * by the slot's sequence number (a seqlock) so readers never use a slot
+ * that's being written. Each member reads at its own pace from its own
+ * cursor. A member that falls more than a ring's worth behind loses the
+ * packets it missed (as it would from a full socket buffer).
+ *
+ * An all-zero segment is a valid empty ring so the segment's creator doesn't
+ * have to initialize it and there's no creation race.
+ *
+ * Readers that have run out of packets can ask to be woken up (see 'rdWait')
+ * and a sender wakes any waiting members after adding a packet. The wakeup
+ * itself is up to the caller (see TransportShm).
+ */
+struct ShmRing {
+    static constexpr size_t nSlots = 512;
+    static constexpr size_t maxMembers = 64;
+    static constexpr uint32_t version = 2;   // (changes with the slot layout)
+
+    struct Slot {
+        std::atomic<uint64_t> seq_;     // 0 while being written, else (ring index + 1) of its packet
+        uint32_t len_;
+        uint32_t sender_;               // member id of sender
+        uint8_t data_[PktBuf::capacity];
+    };
+    struct Member {
+        std::atomic<uint32_t> id_;      // 0 = free slot
+        std::atomic<uint32_t> pid_;
+        std::atomic<uint32_t> waiting_; // non-zero if member is waiting for a wakeup
+    };
+    struct Hdr {
+        alignas(64) std::atomic<uint64_t> head_;    // ring index of next packet
+        alignas(64) Member member_[maxMembers];
+        alignas(64) Slot slot_[nSlots];
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free);
+
+    std::string name_;
+    Hdr* h_{};
+    uint32_t id_{};         // this member's (random, non-zero) id
+    size_t mi_{maxMembers}; // this member's index in member_
+    uint64_t rd_{};         // ring index of next packet to read
+
+    static auto err(const std::string& what) {
+        return runtime_error(format("ShmRing {}: {}", what, std::strerror(errno)));
+    }
+
+    explicit ShmRing(std::string_view name, uint32_t id) : name_{format("/dct-shm{}-{}", version, name)}, id_{id} {
+        auto fd = ::shm_open(name_.c_str(), O_RDWR | O_CREAT, 0600);
+        if (fd < 0) throw err("can't open " + name_);
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || (size_t(st.st_size) < sizeof(Hdr) && ::ftruncate(fd, sizeof(Hdr)) != 0)) {
+            ::close(fd);
+            throw err("can't size " + name_);
+        }
+        auto m = ::mmap(nullptr, sizeof(Hdr), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (m == MAP_FAILED) throw err("can't map " + name_);
+        h_ = static_cast<Hdr*>(m);
+    }
+    ShmRing(const ShmRing&) = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+    ~ShmRing() {
+        leave();
+        if (h_) ::munmap(h_, sizeof(Hdr));
+    }
+
+    // join the ring. Reading starts with the next packet sent.
+    void join() {
+        for (size_t i = 0; i < maxMembers; ++i) {
+            auto& m = h_->member_[i];
+            auto id = m.id_.load();
+            // reclaim entries of processes that exited without leaving
+            if (id != 0 && ::kill(m.pid_.load(), 0) != 0 && errno == ESRCH) m.id_.compare_exchange_strong(id, 0);
+            uint32_t free = 0;
+            if (! m.id_.compare_exchange_strong(free, id_)) continue;
+            m.pid_ = ::getpid();
+            m.waiting_ = 0;
+            mi_ = i;
+            rd_ = h_->head_.load();
+            return;
+        }
+        throw runtime_error("ShmRing: too many members in " + name_);
+    }
+    void leave() noexcept {
+        if (mi_ < maxMembers) h_->member_[mi_].id_.store(0);
+        mi_ = maxMembers;
+    }
+
+    // add a packet to the ring then call 'wake(id)' for each member waiting for a packet
+    template<typename W>
+    void send(const uint8_t* pkt, size_t len, W&& wake) {
+        if (len > PktBuf::capacity) throw runtime_error("ShmRing: packet too big");
+        auto i = h_->head_.fetch_add(1);
+        auto& s = h_->slot_[i % nSlots];
+        s.seq_.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.len_ = len;
+        s.sender_ = id_;
+        std::memcpy(s.data_, pkt, len);
+        s.seq_.store(i + 1, std::memory_order_seq_cst);
+        for (auto& m : h_->member_) {
+            if (m.waiting_.load() && m.waiting_.exchange(0)) {
+                if (auto id = m.id_.load(); id != 0 && id != id_) wake(id);
+            }
+        }
+    }
+
+    /**
+     * Get the next packet sent by some other member, copied into a buffer from
+     * 'pool'. Returns an empty PktRef if there's no packet ready.
+     */
+    PktRef next(PktPool& pool) {
+        while (true) {
+            auto head = h_->head_.load(std::memory_order_acquire);
+            if (rd_ >= head) return {};
+            if (head - rd_ > nSlots) rd_ = head - nSlots;  // we've been lapped, skip what was lost
+            auto& s = h_->slot_[rd_ % nSlots];
+            auto q = s.seq_.load(std::memory_order_acquire);
+            if (q == 0 || q < rd_ + 1) return {};          // being written
+            if (q > rd_ + 1) { ++rd_; continue; }          // overwritten by a later packet
+            size_t len = s.len_;
+            auto sender = s.sender_;
+            PktRef r{};
+            if (sender != id_ && len > 0 && len <= PktBuf::capacity) {
+                r = PktRef::get(pool);
+                std::memcpy(r.buf(), s.data_, len);
+                r.len(len);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq_.load(std::memory_order_relaxed) != q) { ++rd_; continue; } // overwritten while copying
+            ++rd_;
+            if (r) return r;
+        }
+    }
+
+    /**
+     * Ask to be woken by the next sender. Returns false (and doesn't wait) if
+     * a packet arrived since the last next() returned nothing.
+     */
+    bool rdWait() {
+        auto& w = h_->member_[mi_].waiting_;
+        w.store(1, std::memory_order_seq_cst);
+        auto head = h_->head_.load(std::memory_order_seq_cst);
+        if (rd_ < head && h_->slot_[rd_ % nSlots].seq_.load(std::memory_order_seq_cst) >= rd_ + 1) {
+            w.store(0);
+            return false;
+        }
+        return true;
+    }
+};
+
+} // namespace dct
+
+#endif  // DCT_FACE_SHM_RING_HPP
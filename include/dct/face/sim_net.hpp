@@ -0,0 +1,143 @@
+#ifndef DCT_FACE_SIM_NET_HPP
+#define DCT_FACE_SIM_NET_HPP
+#pragma once
+/*
+ * In-process simulated broadcast network for testing and benchmarking
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This is not intended as production code.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "pkt_buf.hpp"
+
+namespace dct {
+
+/**
+ * A named broadcast segment connecting transports in the same process (see
+ * TransportSim) so many DeftT peers can be run, and their sync behavior
+ * measured, without a network. Every packet sent goes to every other member
+ * subject to the net's impairments:
+ *  - packets bigger than 'mtu' are dropped
+ *  - each copy is lost with probability 'loss'
+ *  - each copy is delayed by 'delay' plus a uniformly distributed random part
+ *    of up to 'jitter' so a non-zero jitter reorders packets
+ *
+ * Delays are real time (asio timers on the receiving member's io_context)
+ * since DCT's pub timestamps and lifetimes come from the system clock.
+ * A SimNet must only be used from one thread.
+ */
+struct SimNet {
+    using Clock = std::chrono::steady_clock;
+    using Deliver = std::function<void(PktRef&&)>;
+
+    struct Params {
+        double loss{};                          // probability a packet copy is lost
+        std::chrono::microseconds delay{};      // fixed delay
+        std::chrono::microseconds jitter{};     // max random extra delay
+        size_t mtu{PktBuf::capacity};
+        uint64_t seed{1};                       // so runs are repeatable
+    };
+    struct Stats {
+        uint64_t pktsSent{};
+        uint64_t bytesSent{};
+        uint64_t tooBig{};      // dropped for exceeding the mtu
+        uint64_t lost{};        // copies dropped by the loss process
+        uint64_t delivered{};   // copies delivered
+        uint64_t bytesDelivered{};
+    };
+    struct Member {
+        boost::asio::io_context* ioc_;
+        PktPool* pool_;     // the member's buffer pool (packets are copied into the receiver's)
+        Deliver cb_;
+    };
+
+  private:
+    Params p_{};
+    Stats s_{};
+    std::mt19937_64 rng_{p_.seed};
+    std::map<uint32_t,Member> members_{};
+    uint32_t nextId_{1};
+
+  public:
+    // the net named 'name' (created on first use)
+    static SimNet& get(std::string_view name) {
+        static std::map<std::string,std::unique_ptr<SimNet>,std::less<>> nets{};
+        auto n = nets.find(name);
+        if (n == nets.end()) n = nets.emplace(std::string(name), std::make_unique<SimNet>()).first;
+        return *n->second;
+    }
+
+    auto& params(const Params& p) { p_ = p; rng_.seed(p.seed); return *this; }
+    const auto& params() const noexcept { return p_; }
+    const auto& stats() const noexcept { return s_; }
+    void clearStats() noexcept { s_ = Stats{}; }
+    auto size() const noexcept { return members_.size(); }
+
+    uint32_t join(boost::asio::io_context& ioc, PktPool& pool, Deliver&& cb) {
+        members_.emplace(nextId_, Member{&ioc, &pool, std::move(cb)});
+        return nextId_++;
+    }
+    void leave(uint32_t id) { members_.erase(id); }
+
+    // send a copy of packet 'pkt' from member 'from' to all the others
+    void send(uint32_t from, const uint8_t* pkt, size_t len) {
+        ++s_.pktsSent;
+        s_.bytesSent += len;
+        if (len > p_.mtu) { ++s_.tooBig; return; }
+        std::uniform_real_distribution<double> u{0., 1.};
+        for (auto& [id, m] : members_) {
+            if (id == from) continue;
+            if (p_.loss > 0. && u(rng_) < p_.loss) { ++s_.lost; continue; }
+            auto d = p_.delay;
+            if (p_.jitter.count() > 0) d += std::chrono::microseconds(int64_t(u(rng_) * p_.jitter.count()));
+            auto b = PktRef::copy(*m.pool_, pkt, len);
+            ++s_.delivered;
+            s_.bytesDelivered += len;
+            if (d.count() == 0) {
+                boost::asio::post(*m.ioc_, [this, id, b=std::move(b)]() mutable { arrive(id, std::move(b)); });
+                continue;
+            }
+            auto t = std::make_shared<boost::asio::steady_timer>(*m.ioc_, d);
+            t->async_wait([this, id, t, b=std::move(b)](boost::system::error_code ec) mutable {
+                    if (! ec) arrive(id, std::move(b));
+                });
+        }
+    }
+
+  private:
+    // the member may have left while the packet was in flight
+    void arrive(uint32_t id, PktRef&& b) {
+        if (auto m = members_.find(id); m != members_.end()) m->second.cb_(std::move(b));
+    }
+};
+
+} // namespace dct
+
+#endif  // DCT_FACE_SIM_NET_HPP
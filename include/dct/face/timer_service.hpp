@@ -0,0 +1,255 @@
+#ifndef DCT_FACE_TIMER_SERVICE_HPP
+#define DCT_FACE_TIMER_SERVICE_HPP
+#pragma once
+/*
+ * Face-level timer service: cancelable timers without per-timer allocations
+ *
+ * Copyright (C) 2022 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This is not intended as production code.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "api.hpp"
+
+namespace dct {
+
+class TimerService;
+
+/**
+ * Handle of a timer scheduled with a TimerService. It's two indices and a
+ * pointer so it can be freely copied and needs no reference count. A timer
+ * is identified by its slab slot plus the slot's generation number so a
+ * handle of a timer that has fired or been canceled (whose slot may have
+ * been reused) is simply stale: cancel() on it does nothing.
+ *
+ * Moving a handle leaves the source empty.
+ */
+class TimerHandle {
+    friend class TimerService;
+    TimerService* ts_{};
+    uint32_t idx_{};
+    uint32_t gen_{};
+
+    TimerHandle(TimerService* ts, uint32_t idx, uint32_t gen) noexcept : ts_{ts}, idx_{idx}, gen_{gen} { }
+
+  public:
+    TimerHandle() = default;
+    TimerHandle(const TimerHandle&) = default;
+    TimerHandle& operator=(const TimerHandle&) = default;
+    TimerHandle(TimerHandle&& h) noexcept : ts_{std::exchange(h.ts_, nullptr)}, idx_{h.idx_}, gen_{h.gen_} { }
+    TimerHandle& operator=(TimerHandle&& h) noexcept {
+        ts_ = std::exchange(h.ts_, nullptr);
+        idx_ = h.idx_;
+        gen_ = h.gen_;
+        return *this;
+    }
+
+    explicit operator bool() const noexcept { return ts_ != nullptr; }
+
+    // true if the timer hasn't yet fired or been canceled
+    inline bool pending() const noexcept;
+
+    // cancel the timer (if it's pending). Returns true if it was pending.
+    inline bool cancel() noexcept;
+
+    // change a pending timer to fire 'after' from now. Returns false (and does
+    // nothing) if the timer has already fired or been canceled.
+    inline bool expiresAfter(std::chrono::microseconds after);
+
+    void reset() noexcept { ts_ = nullptr; }
+};
+
+/**
+ * All of a face's timers share one asio timer set to the earliest expiration
+ * time. Timer state lives in a slab of nodes that are recycled via a free list
+ * and pending timers are kept in a binary min-heap of slab indices (each node
+ * knows its heap position so cancel & reschedule are O(log n)). Callbacks are
+ * 'ofats::any_invocable's whose small buffer holds typical captures (e.g.,
+ * 'this' plus a PktRef) so, once the slab and heap have grown to their working
+ * size, scheduling, canceling and firing a timer don't allocate.
+ *
+ * Like the rest of the face this is single threaded: it must only be used
+ * from the thread running its io_context.
+ */
+class TimerService {
+  public:
+    using Clock = Timer::clock_type;
+
+  private:
+    friend class TimerHandle;
+    static constexpr uint32_t noPos = ~0u;
+
+    struct Node {
+        Clock::time_point when_{};
+        TimerCb cb_{};
+        uint32_t gen_{};
+        uint32_t pos_{noPos};   // position in heap_ (noPos if not pending)
+        uint32_t next_{noPos};  // free list link
+    };
+
+    Timer timer_;
+    std::vector<Node> nodes_{};
+    std::vector<uint32_t> heap_{};  // indices of pending nodes, earliest first
+    uint32_t free_{noPos};          // head of free node list
+    Clock::time_point armedAt_{Clock::time_point::max()};   // when the asio timer will fire (max if not waiting)
+
+    bool before(uint32_t a, uint32_t b) const noexcept { return nodes_[heap_[a]].when_ < nodes_[heap_[b]].when_; }
+
+    void place(uint32_t pos, uint32_t n) noexcept { heap_[pos] = n; nodes_[n].pos_ = pos; }
+
+    void swapPos(uint32_t a, uint32_t b) noexcept {
+        auto na = heap_[a];
+        place(a, heap_[b]);
+        place(b, na);
+    }
+
+    void up(uint32_t p) noexcept {
+        while (p > 0) {
+            auto parent = (p - 1) / 2;
+            if (! before(p, parent)) return;
+            swapPos(p, parent);
+            p = parent;
+        }
+    }
+
+    void down(uint32_t p) noexcept {
+        auto n = uint32_t(heap_.size());
+        while (true) {
+            auto c = 2 * p + 1;
+            if (c >= n) return;
+            if (c + 1 < n && before(c + 1, c)) ++c;
+            if (! before(c, p)) return;
+            swapPos(p, c);
+            p = c;
+        }
+    }
+
+    // take node at heap position 'p' out of the heap
+    void remove(uint32_t p) noexcept {
+        auto n = heap_[p];
+        nodes_[n].pos_ = noPos;
+        auto last = uint32_t(heap_.size() - 1);
+        if (p == last) { heap_.pop_back(); return; }
+        auto m = heap_[last];
+        place(p, m);
+        heap_.pop_back();
+        up(p);
+        down(nodes_[m].pos_);
+    }
+
+    // return node 'n' to the free list. Bumping its generation invalidates outstanding handles.
+    void release(uint32_t n) noexcept {
+        auto& nd = nodes_[n];
+        ++nd.gen_;
+        nd.cb_ = {};
+        nd.next_ = std::exchange(free_, n);
+    }
+
+    uint32_t alloc() {
+        if (free_ != noPos) return std::exchange(free_, nodes_[free_].next_);
+        nodes_.emplace_back();
+        return uint32_t(nodes_.size() - 1);
+    }
+
+    bool live(uint32_t idx, uint32_t gen) const noexcept {
+        return idx < nodes_.size() && nodes_[idx].gen_ == gen && nodes_[idx].pos_ != noPos;
+    }
+
+    // make sure the asio timer will go off no later than the earliest pending timer
+    void arm() {
+        if (heap_.empty()) return;
+        auto when = nodes_[heap_[0]].when_;
+        if (when >= armedAt_) return;
+        armedAt_ = when;
+        // (re)setting the expiry aborts any wait in progress
+        timer_.expires_at(when);
+        timer_.async_wait([this](const auto& e) {
+                // the service may no longer exist if the wait was aborted
+                if (e != boost::system::errc::success) return;
+                armedAt_ = Clock::time_point::max();
+                expire();
+            });
+    }
+
+    // run the callbacks of all the timers that are due
+    void expire() {
+        auto now = Clock::now();
+        while (! heap_.empty()) {
+            auto n = heap_[0];
+            if (nodes_[n].when_ > now) break;
+            remove(0);
+            // the callback may schedule timers (which can reallocate nodes_) so move it out first
+            auto cb = std::move(nodes_[n].cb_);
+            release(n);
+            cb();
+        }
+        arm();
+    }
+
+  public:
+    explicit TimerService(boost::asio::io_context& ioc) : timer_{ioc} { }
+    TimerService(const TimerService&) = delete;
+    TimerService& operator=(const TimerService&) = delete;
+
+    auto size() const noexcept { return heap_.size(); }
+
+    // call 'cb' 'after' from now
+    TimerHandle schedule(std::chrono::microseconds after, TimerCb&& cb) {
+        auto n = alloc();
+        auto& nd = nodes_[n];
+        nd.when_ = Clock::now() + after;
+        nd.cb_ = std::move(cb);
+        heap_.push_back(n);
+        nd.pos_ = uint32_t(heap_.size() - 1);
+        up(nd.pos_);
+        arm();
+        return {this, n, nodes_[n].gen_};
+    }
+
+    bool cancel(const TimerHandle& h) noexcept {
+        if (h.ts_ != this || ! live(h.idx_, h.gen_)) return false;
+        remove(nodes_[h.idx_].pos_);
+        release(h.idx_);
+        // the asio timer is left alone: if it fires early expire() just re-arms it
+        return true;
+    }
+
+    bool expiresAfter(const TimerHandle& h, std::chrono::microseconds after) {
+        if (h.ts_ != this || ! live(h.idx_, h.gen_)) return false;
+        auto& nd = nodes_[h.idx_];
+        nd.when_ = Clock::now() + after;
+        up(nd.pos_);
+        down(nd.pos_);
+        arm();
+        return true;
+    }
+
+    bool pending(const TimerHandle& h) const noexcept { return h.ts_ == this && live(h.idx_, h.gen_); }
+};
+
+inline bool TimerHandle::pending() const noexcept { return ts_ && ts_->pending(*this); }
+inline bool TimerHandle::cancel() noexcept { return ts_ && ts_->cancel(*this); }
+inline bool TimerHandle::expiresAfter(std::chrono::microseconds after) { return ts_ && ts_->expiresAfter(*this, after); }
+
+} // namespace dct
+
+#endif  // DCT_FACE_TIMER_SERVICE_HPP
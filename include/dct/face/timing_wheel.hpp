@@ -0,0 +1,122 @@
+#ifndef DCT_FACE_TIMING_WHEEL_HPP
+#define DCT_FACE_TIMING_WHEEL_HPP
+#pragma once
+/*
+ * Hashed timing wheel for large numbers of short, non-cancelable timed events
+ *
+ * Copyright (C) 2022 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This is not intended as production code.
+ */
+
+#include <array>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#include "api.hpp"
+
+namespace dct {
+
+/**
+ * @brief hashed timing wheel (Varghese & Lauck) driven by a single asio timer
+ *
+ * Events are small values ('Ev') handed to the wheel's callback at (or up to one
+ * 'tick' after) their expiration time. Adding an event is O(1) and doesn't allocate
+ * once the slot vectors have grown to their working size (they're never shrunk).
+ * Events further in the future than the wheel's span (NSlots * tick) stay in their
+ * slot through multiple revolutions of the wheel. There is no per-event cancel: the
+ * callback should check that the event is still relevant.
+ */
+template<typename Ev, size_t NSlots = 256>
+struct TimingWheel {
+    using Clock = Timer::clock_type;
+    using Callback = std::function<void(const Ev&)>;
+    struct Ent {
+        Clock::time_point when_;
+        Ev ev_;
+    };
+
+    Timer timer_;
+    Callback cb_;
+    std::chrono::microseconds tick_;
+    std::array<std::vector<Ent>,NSlots> slots_{};
+    std::vector<Ent> due_{};        // slot being processed (swapped in to reuse storage)
+    Clock::time_point base_{};      // time at which slot cur_ was processed
+    size_t cur_{};                  // current slot
+    size_t n_{};                    // number of pending events
+    bool armed_{false};             // timer is running
+
+    TimingWheel(boost::asio::io_context& ioc, Callback&& cb, std::chrono::microseconds tick = 10ms)
+        : timer_{ioc}, cb_{std::move(cb)}, tick_{tick}, base_{Clock::now()} { }
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    constexpr auto size() const noexcept { return n_; }
+
+    // schedule event 'ev' to happen 'after' from now
+    void add(std::chrono::microseconds after, Ev ev) {
+        auto now = Clock::now();
+        // if the wheel's been idle, advance it to now rather than stepping through the idle time
+        if (! armed_ && n_ == 0) base_ = now;
+        auto when = now + after;
+        auto dt = std::chrono::duration_cast<std::chrono::microseconds>(when - base_).count();
+        auto d = (dt + tick_.count() - 1) / tick_.count();
+        if (d < 1) d = 1; // never goes in the current slot (it may be being processed)
+        slots_[(cur_ + d) % NSlots].emplace_back(Ent{when, std::move(ev)});
+        ++n_;
+        arm();
+    }
+
+  private:
+    void arm() {
+        if (armed_ || n_ == 0) return;
+        armed_ = true;
+        timer_.expires_at(base_ + tick_);
+        timer_.async_wait([this](const auto& e) {
+                // the wheel may no longer exist if the wait was aborted
+                if (e != boost::system::errc::success) return;
+                armed_ = false;
+                expire();
+            });
+    }
+
+    // process all the slots whose time has come
+    void expire() {
+        auto now = Clock::now();
+        while (n_ > 0 && base_ + tick_ <= now) {
+            cur_ = (cur_ + 1) % NSlots;
+            base_ += tick_;
+            if (slots_[cur_].empty()) continue;
+            std::swap(due_, slots_[cur_]);
+            for (auto& e : due_) {
+                // events for a later revolution of the wheel stay in this slot
+                if (e.when_ > base_) { slots_[cur_].emplace_back(std::move(e)); continue; }
+                --n_;
+                cb_(e.ev_);
+            }
+            due_.clear();
+        }
+        if (n_ == 0) base_ = now;
+        arm();
+    }
+};
+
+} // namespace dct
+
+#endif  // DCT_FACE_TIMING_WHEEL_HPP
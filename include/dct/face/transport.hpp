@@ -27,6 +27,7 @@
 #include <charconv>
 #include <functional>
 #include <memory>
+#include <random>
 #include <string>
 #include <string_view>
 
@@ -53,6 +54,14 @@
 #include <dct/schema/rpacket.hpp>
 #include "default-if.hpp"
 #include "default-io-context.hpp"
+#include "batch_io.hpp"
+#include "busy_poll.hpp"
+#include "packet_ring.hpp"
+#include "pacer.hpp"
+#include "pkt_buf.hpp"
+#include "shm_ring.hpp"
+#include "sim_net.hpp"
+#include "uring.hpp"
 
 namespace dct {
 
@@ -61,23 +70,191 @@ using namespace boost::asio::ip;
 struct Transport {
     using onRcv = std::function<void(const uint8_t* pkt, size_t len)>;
     using onConnect = std::function<void()>;
-    //
-    // rcv buffer no smaller than 1500 byte MTU - 40 IPv6 - 8 UDP = 1452 payload
-    // but we hope for 9K MTU for local packets.
-    std::array<uint8_t, 8192> rcvbuf_;
+
+    // Packets are received into buffers from the transport's pool (see pkt_buf.hpp)
+    // with 'rcvDepth' receives kept outstanding so a burst doesn't have to wait for
+    // each packet's upcall to finish before the next receive is issued.
+    static constexpr size_t rcvDepth = 4;
+    PktPool pool_{};
+    struct rcvSlot {
+        PktRef buf_{};
+        udp::endpoint sender_{};
+    };
+    std::array<rcvSlot, rcvDepth> rslot_{};
+    PktRef rcvd_{};     // buffer of the packet currently being delivered to rcb_
+    std::chrono::system_clock::time_point rxTs_{}; // its kernel receive time (zero if unknown)
+    sockaddr_in6 rxFrom_{};     // and its sender (sin6_family 0 if unknown)
     onRcv rcb_;
     onConnect ccb_;
+    std::unique_ptr<BatchIO> bio_{};    // non-null if using batched I/O (see batch_io.hpp)
+#ifdef DCT_HAVE_URING
+    std::unique_ptr<UringIO> uio_{};    // non-null if using io_uring (see uring.hpp)
+#endif
+    std::unique_ptr<Pacer> pacer_{};    // non-null if sends are paced (see pacer.hpp)
+    int busyPollUs_{};                  // SO_BUSY_POLL time of the receive socket(s) (see busy_poll.hpp)
+
+    /*
+     * The largest packet the transport carries without fragmentation. Datagram
+     * transports use their interface's MTU less the IPv6 & UDP headers when it can
+     * be found (multicast) or assume a 1500 byte MTU (unicast UDP, whose path MTU
+     * isn't probed). Env var DCT_MTU overrides the MTU of both, e.g., for a unicast
+     * path that's all jumbo frames. It's never more than a receive buffer holds.
+     */
+    static constexpr size_t ipUdpHdrs = 40 + 8;
+    static constexpr size_t defaultMaxPayload = 1500 - ipUdpHdrs;
+
+    static size_t payloadFor(size_t mtu, size_t hdrs = ipUdpHdrs) noexcept {
+        if (auto e = getenv("DCT_MTU"); e) mtu = std::strtoul(e, nullptr, 10);
+        if (mtu < 1280) mtu = 1500; // (the IPv6 minimum)
+        return std::min(mtu - hdrs, PktBuf::capacity);
+    }
+    size_t maxPayload_{payloadFor(1500)};
+    size_t maxPayload() const noexcept { return maxPayload_; }
 
     Transport(onRcv&& rcb, onConnect&& ccb) : rcb_{std::move(rcb)}, ccb_{std::move(ccb)} { }
 
+    // Batched I/O is used on Linux unless env var DCT_NO_BATCH_IO is set
+    static bool useBatchIO() noexcept {
+#ifdef __linux__
+        return getenv("DCT_NO_BATCH_IO") == nullptr;
+#else
+        return false;
+#endif
+    }
+
     virtual void connect() = 0;
     virtual void send(const uint8_t* pkt, size_t len) = 0;
     virtual void close() = 0;
+    virtual void uring() { throw runtime_error("transport doesn't support io_uring"); }
+    // busy-poll the receive socket(s) for up to 'us' (transports without sockets ignore this)
+    virtual void busyPoll(int us) { busyPollUs_ = us; }
+    // get kernel receive timestamps (see rxTime). Only batched datagram I/O gets
+    // them. Returns false if the transport can't.
+    virtual bool rxTimestamps() { return false; }
+    // also receive packets unicast to the transport's send socket so peers can answer
+    // it alone (see DirectFace::unicastReplies). Returns false if the transport can't.
+    virtual bool unicast() { return false; }
+    // true if every packet can arrive more than once (see TransportAggregate)
+    virtual bool mirrors() const noexcept { return false; }
+    // send a packet to just 'to' (the rxFrom() of a packet from a peer)
+    virtual void sendTo(const sockaddr_in6& /*to*/, const uint8_t* /*pkt*/, size_t /*len*/) { }
+#ifdef DCT_HAVE_URING
+    bool usingUring() const noexcept { return uio_ != nullptr; }
+#else
+    bool usingUring() const noexcept { return false; }
+#endif
+
+    /*
+     * Send a packet, via the pacer if there is one. (The transport's send() is
+     * what actually puts a packet on the wire.)
+     */
+    void output(const uint8_t* pkt, size_t len) {
+        if (pacer_) pacer_->send(pkt, len);
+        else send(pkt, len);
+    }
+
+    // pace sends to 'rate' bytes/sec with bursts of up to 'burst' bytes and at most 'maxQueue' bytes waiting
+    void pace(boost::asio::io_context& ioc, double rate, size_t burst, size_t maxQueue) {
+        pacer_ = std::make_unique<Pacer>(pool_, ioc, [this](const uint8_t* p, size_t l){ send(p, l); }, rate, burst, maxQueue);
+    }
+    const Pacer* pacer() const noexcept { return pacer_.get(); }
+
+    // Buffer holding the packet being delivered (only set during an rcb_ upcall).
+    // The upcall can keep the packet beyond its return by copying this handle.
+    const PktRef& rcvBuf() const noexcept { return rcvd_; }
+    // Kernel receive time of the packet being delivered (only set during an rcb_ upcall,
+    // zero if the transport's rxTimestamps aren't on).
+    auto rxTime() const noexcept { return rxTs_; }
+    // Sender of the packet being delivered (only set during an rcb_ upcall by datagram
+    // transports not using io_uring)
+    const auto& rxFrom() const noexcept { return rxFrom_; }
+    void rxFrom(const udp::endpoint& ep) noexcept {
+        std::memcpy(&rxFrom_, ep.data(), std::min(size_t(ep.size()), sizeof(rxFrom_)));
+    }
+
+    // get a (pool) buffer for slot 's' if it doesn't have one
+    auto rbuf(rcvSlot& s) {
+        if (! s.buf_) s.buf_ = PktRef::get(pool_);
+        return boost::asio::buffer(s.buf_.buf(), s.buf_.capacity());
+    }
+
+    // hand the 'len' byte packet in 'buf' to the receive callback. If the
+    // callback didn't keep the buffer it's reused for the next receive.
+    void deliver(PktRef& buf, size_t len) {
+        buf.len(len);
+        rcvd_ = std::move(buf);
+        rcb_(rcvd_.data(), len);
+        if (rcvd_.unique()) buf = std::move(rcvd_);
+        else rcvd_.reset();
+    }
+    void deliver(rcvSlot& s, size_t len) { deliver(s.buf_, len); }
+
+    // batched receive: wait for 'sock' to be readable, drain it, repeat.
+    // 'ok(from)' says whether to accept a packet from 'from'.
+    void batchRead(udp::socket& sock, auto ok) noexcept {
+        sock.async_wait(udp::socket::wait_read, [this, &sock, ok](boost::system::error_code ec) {
+                if (ec == boost::asio::error::operation_aborted) return;
+                if (!ec) bio_->receive(sock.native_handle(), [this, &ok](PktRef& b, size_t len, const sockaddr_in6& from) {
+                                            if (! ok(from)) return;
+                                            rxTs_ = bio_->rxTs_;
+                                            rxFrom_ = from;
+                                            deliver(b, len);
+                                            rxTs_ = {};
+                                            rxFrom_ = {};
+                                        });
+                batchRead(sock, ok);
+            });
+    }
+
+    // batched send: queue a copy of the packet and, if the queue was empty,
+    // flush it after the io_context handlers that are currently ready have run
+    void batchSend(udp::socket& sock, const uint8_t* pkt, size_t len) {
+        if (bio_->queue(pkt, len))
+            boost::asio::post(sock.get_executor(), [this, &sock]{ batchFlush(sock); });
+    }
+#ifdef DCT_HAVE_URING
+    // switch to io_uring I/O. Receive on 'rsock' & send on 'tsock' to 'dst' (if set).
+    void useUring(udp::socket& rsock, udp::socket& tsock, const udp::endpoint* dst = nullptr) {
+        uio_ = std::make_unique<UringIO>(pool_, rsock.native_handle(), tsock.native_handle(),
+                                         dst? dst->data() : nullptr, dst? dst->size() : 0);
+        bio_.reset();
+    }
+    void uringRead(udp::socket& sock, auto ok) {
+        uio_->start(static_cast<boost::asio::io_context&>(sock.get_executor().context()), ok,
+                    [this](PktRef& b, size_t len) { deliver(b, len); });
+    }
+    void uringSend(udp::socket& sock, const uint8_t* pkt, size_t len) {
+        if (uio_->send(pkt, len)) boost::asio::post(sock.get_executor(), [this]{ uio_->submit(); });
+    }
+#endif
+    void batchFlush(udp::socket& sock) {
+        if (bio_->flush(sock.native_handle())) return;
+        sock.async_wait(udp::socket::wait_write, [this, &sock](boost::system::error_code ec) {
+                if (!ec) batchFlush(sock);
+            });
+    }
 
     static void ehandler(const boost::system::error_code& ec, size_t len) {
         if (ec.failed() && ec.value() != ECONNREFUSED)
             throw runtime_error(format("send_to failed: {} len {}", ec.message(), len));
     }
+
+    // length of the TLV-encoded packet at the start of 'b' (0 if not all of its header is there yet)
+    static size_t pktLen(const uint8_t* b, size_t n) noexcept {
+        auto vlen = [](uint8_t c) -> size_t { return c < 253? 1 : c == 253? 3 : c == 254? 5 : 9; };
+        auto vval = [](const uint8_t* p, size_t l) -> size_t {
+            if (l == 1) return p[0];
+            size_t v = 0;
+            for (size_t i = 1; i < l; ++i) v = (v << 8) | p[i];
+            return v;
+        };
+        if (n == 0) return 0;
+        auto tl = vlen(b[0]);
+        if (n < tl + 1) return 0;
+        auto ll = vlen(b[tl]);
+        if (n < tl + ll) return 0;
+        return tl + ll + vval(b + tl, ll);
+    }
 };
 
 struct TransportMulticast final : Transport {
@@ -85,16 +262,18 @@ struct TransportMulticast final : Transport {
     udp::socket tsock_;
     udp::endpoint listen_;
     udp::endpoint our_;
-    udp::endpoint sender_;
+    std::array<rcvSlot, rcvDepth> uslot_{}; // receives on tsock_ (if unicast() was called)
+    bool unicast_{false};
 
-    TransportMulticast(std::string_view maddr, boost::asio::io_context& ioc, onRcv&& rcb, onConnect&& ccb)
+    TransportMulticast(std::string_view maddr, const std::string& ifname, boost::asio::io_context& ioc,
+                       onRcv&& rcb, onConnect&& ccb)
         : Transport(std::move(rcb), std::move(ccb)), rsock_{ioc}, tsock_{ioc} {
 
         // XXX boost bug (up to at least 1.79) asio/detail/impl/socket_ops.ipp: inet_pton()
         // scope_id is not handled correctly for 'node_local' so we stick it in as a numeric value
-        auto ifaddr = getIp6Addr(defaultIf());
+        auto ifaddr = getIp6Addr(ifname);
         auto dst = make_address_v6(maddr);
-        if (ifaddr.sin6_scope_id == 0) ifaddr.sin6_scope_id = if_nametoindex(defaultIf().c_str());
+        if (ifaddr.sin6_scope_id == 0) ifaddr.sin6_scope_id = if_nametoindex(ifname.c_str());
         dst.scope_id(ifaddr.sin6_scope_id);
         // NFD uses port 56363. Use a different one because NFD doesn't handle multicast well:
         // lack of working dup suppression combined with its Content Store makes it babel.
@@ -112,25 +291,63 @@ struct TransportMulticast final : Transport {
         if (ifaddr.sin6_addr.s6_addr[0] == 0xfe) a.scope_id(ifaddr.sin6_scope_id);
         tsock_.bind(udp::endpoint(a, 0));
         our_ = tsock_.local_endpoint();
+        maxPayload_ = payloadFor(ifMTU(ifname));
+        if (useBatchIO()) bio_ = std::make_unique<BatchIO>(pool_, listen_.data(), listen_.size());
         // If there were only one app using DCT per machine, disabling loopback would cut
         // down on some dups but the win is small for the problems it can cause. It would be
         // better to fix the kernel to not loopback to the sending process.
         //tsock_.set_option(multicast::enable_loopback(false));
     }
+    TransportMulticast(std::string_view maddr, boost::asio::io_context& ioc, onRcv&& rcb, onConnect&& ccb)
+        : TransportMulticast(maddr, defaultIf(), ioc, std::move(rcb), std::move(ccb)) {}
     TransportMulticast(boost::asio::io_context& ioc, onRcv&& rcb, onConnect&& ccb) :
-        TransportMulticast(getenv("DCT_LOCALHOST_MULTICAST")? "ff01::1234":"ff02::1234",
-                            ioc, std::move(rcb), std::move(ccb)) {}
+        TransportMulticast(defaultGroup(), ioc, std::move(rcb), std::move(ccb)) {}
 
-    void issueRead() noexcept {
-        rsock_.async_receive_from(boost::asio::buffer(rcvbuf_), sender_,
-            [this](boost::system::error_code ec, std::size_t len) {
+    static std::string_view defaultGroup() noexcept {
+        return getenv("DCT_LOCALHOST_MULTICAST")? "ff01::1234":"ff02::1234";
+    }
+
+    void issueRead(rcvSlot& s) noexcept {
+        rsock_.async_receive_from(rbuf(s), s.sender_,
+            [this, &s](boost::system::error_code ec, std::size_t len) {
                 // multicast loops back packets to the sender so filter them out
-                if (!ec && (sender_.port() != our_.port() || sender_.address() != our_.address())) {
-                    rcb_(rcvbuf_.data(), len);
+                if (!ec && (s.sender_.port() != our_.port() || s.sender_.address() != our_.address())) {
+                    rxFrom(s.sender_);
+                    deliver(s, len);
+                    rxFrom_ = {};
                 }
-                issueRead();
+                issueRead(s);
+            });
+    }
+    // peers' unicasts arrive on the send socket
+    void issueUnicastRead(rcvSlot& s) noexcept {
+        tsock_.async_receive_from(rbuf(s), s.sender_,
+            [this, &s](boost::system::error_code ec, std::size_t len) {
+                if (ec == boost::asio::error::operation_aborted) return;
+                if (!ec) {
+                    rxFrom(s.sender_);
+                    deliver(s, len);
+                    rxFrom_ = {};
+                }
+                issueUnicastRead(s);
             });
     }
+    void issueRead() noexcept {
+        if (bio_ || usingUring()) {
+            sockaddr_in6 our;
+            std::memcpy(&our, our_.data(), std::min(size_t(our_.size()), sizeof(our)));
+            auto notUs = [our](const sockaddr_in6& from) {
+                    return from.sin6_port != our.sin6_port ||
+                           std::memcmp(&from.sin6_addr, &our.sin6_addr, sizeof(our.sin6_addr)) != 0;
+                };
+#ifdef DCT_HAVE_URING
+            if (uio_) { uringRead(rsock_, notUs); return; }
+#endif
+            batchRead(rsock_, notUs);
+            return;
+        }
+        for (auto& s : rslot_) issueRead(s);
+    }
 
     void connect() {
         // datagram socket 'connects' immediately. Connect callbacks can do initialization
@@ -144,8 +361,32 @@ struct TransportMulticast final : Transport {
         tsock_.close();
     }
 
+#ifdef DCT_HAVE_URING
+    void uring() final { useUring(rsock_, tsock_, &listen_); }
+#endif
+    void busyPoll(int us) final { busyPollUs_ = us; setBusyPoll(rsock_.native_handle(), us); }
+    bool rxTimestamps() final { return bio_ && bio_->rxTimestamps(rsock_.native_handle()); }
+
+    bool unicast() final {
+        if (usingUring()) return false;
+        if (std::exchange(unicast_, true)) return true;
+        if (bio_) batchRead(tsock_, [](const sockaddr_in6&) { return true; });
+        else for (auto& s : uslot_) issueUnicastRead(s);
+        return true;
+    }
+    // (unicasts are sent immediately, bypassing batching & the pacer. A failed send
+    // isn't an error: the peer re-expresses its interest.)
+    void sendTo(const sockaddr_in6& to, const uint8_t* pkt, size_t len) final {
+        if (len > PktBuf::capacity) throw runtime_error( "send: packet too big");
+        ::sendto(tsock_.native_handle(), pkt, len, 0, (const sockaddr*)&to, sizeof(to));
+    }
+
     void send(const uint8_t* pkt, size_t len) {
-        if (len > sizeof(rcvbuf_)) throw runtime_error( "send: packet too big");
+        if (len > PktBuf::capacity) throw runtime_error( "send: packet too big");
+#ifdef DCT_HAVE_URING
+        if (uio_) { uringSend(tsock_, pkt, len); return; }
+#endif
+        if (bio_) { batchSend(tsock_, pkt, len); return; }
         tsock_.async_send_to(boost::asio::buffer(pkt, len), listen_, ehandler);
     }
 };
@@ -156,22 +397,43 @@ struct TransportUdp : Transport {
     udp::socket sock_;
 
     TransportUdp(boost::asio::io_context& ioc, onRcv&& rcb, onConnect&& ccb)
-        : Transport(std::move(rcb), std::move(ccb)), sock_{ioc} { }
+        : Transport(std::move(rcb), std::move(ccb)), sock_{ioc} { if (useBatchIO()) bio_ = std::make_unique<BatchIO>(pool_); }
     TransportUdp(uint16_t port, boost::asio::io_context& ioc, onRcv&& rcb, onConnect&& ccb)
-        : Transport(std::move(rcb), std::move(ccb)), listen_{udp::v6(), port}, sock_{ioc, listen_} { }
+        : Transport(std::move(rcb), std::move(ccb)), listen_{udp::v6(), port}, sock_{ioc, listen_} {
+        if (useBatchIO()) bio_ = std::make_unique<BatchIO>(pool_);
+    }
 
-    void issueRead() {
-        sock_.async_receive(boost::asio::buffer(rcvbuf_),
-                [this](boost::system::error_code ec, std::size_t len) {
-                    if (!ec && len > 0) rcb_(rcvbuf_.data(), len);
-                    issueRead();
+    void issueRead(rcvSlot& s) {
+        sock_.async_receive(rbuf(s),
+                [this, &s](boost::system::error_code ec, std::size_t len) {
+                    if (!ec && len > 0) deliver(s, len);
+                    issueRead(s);
                 });
     }
+    void issueRead() {
+        // socket is connected so everything received is from the peer
+        auto any = [](const sockaddr_in6&) { return true; };
+#ifdef DCT_HAVE_URING
+        if (uio_) { uringRead(sock_, any); return; }
+#endif
+        if (bio_) batchRead(sock_, any);
+        else for (auto& s : rslot_) issueRead(s);
+    }
 
     void close() final { sock_.close(); }
 
+#ifdef DCT_HAVE_URING
+    void uring() final { useUring(sock_, sock_); }
+#endif
+    void busyPoll(int us) final { busyPollUs_ = us; if (sock_.is_open()) setBusyPoll(sock_.native_handle(), us); }
+    bool rxTimestamps() final { return bio_ && sock_.is_open() && bio_->rxTimestamps(sock_.native_handle()); }
+
     void send(const uint8_t* pkt, size_t len) final {
-        if (len > sizeof(rcvbuf_)) throw runtime_error( "send: packet too big");
+        if (len > PktBuf::capacity) throw runtime_error( "send: packet too big");
+#ifdef DCT_HAVE_URING
+        if (uio_) { uringSend(sock_, pkt, len); return; }
+#endif
+        if (bio_) { batchSend(sock_, pkt, len); return; }
         sock_.async_send(boost::asio::buffer(pkt, len), ehandler);
     }
 };
@@ -204,12 +466,13 @@ struct TransportUdpP final : TransportUdp {
     // If incoming packet is acceptable the socket is connected to that peer, connect & receive
     // callbacks are invoked and the next (normal) read initiated..
     void issueInitialRead() {
-        sock_.async_receive_from(boost::asio::buffer(rcvbuf_), sender_,
-                [this](boost::system::error_code ec, std::size_t len) {
+        auto& s = rslot_[0];
+        sock_.async_receive_from(rbuf(s), sender_,
+                [this, &s](boost::system::error_code ec, std::size_t len) {
                     if (ec) throw runtime_error(format("receive_from failed: {} len {}", ec.message(), len));
                     sock_.connect(sender_);
                     ccb_();
-                    rcb_(rcvbuf_.data(), len);
+                    deliver(s, len);
                     issueRead();
                 });
     }
@@ -217,6 +480,383 @@ struct TransportUdpP final : TransportUdp {
     void connect() { issueInitialRead(); }
 };
 
+/**
+ * Stream (TCP) transport for links over lossy WAN paths where UDP loss
+ * costs repeated cState rounds. NDN packets are TLVs so they delimit
+ * themselves and are sent back-to-back on the stream (the same framing NFD
+ * uses for its stream faces). Packets can be up to 'maxPkt' bytes.
+ *
+ * Nagle is disabled. Instead, packets sent while a write is in progress (or
+ * during the current io_context dispatch) are appended to a single buffer
+ * that goes out with the next write so a burst of small cAdds costs one
+ * syscall and fills segments. If the link backs up beyond 'maxQueued' bytes
+ * new packets are dropped, as they would be on a UDP link.
+ *
+ * The active side retries connecting once a second until it succeeds and
+ * reconnects if the connection is lost. The passive side accepts one peer
+ * at a time and accepts a new one if its current peer goes away. Packets
+ * sent while there's no connection are dropped.
+ */
+struct TransportTcp : Transport {
+    static constexpr size_t maxPkt = 65536;
+    static constexpr size_t maxQueued = 4 * 1024 * 1024;
+
+    tcp::socket sock_;
+    boost::asio::steady_timer retry_;
+    std::vector<uint8_t> rbuf_ = std::vector<uint8_t>(2 * maxPkt);
+    size_t rlen_{};                     // bytes of rbuf_ in use
+    std::vector<uint8_t> wq_{};         // packets waiting to be written
+    std::vector<uint8_t> wbuf_{};       // packets being written
+    bool writing_{false};
+    bool connected_{false};
+    bool everConnected_{false};
+
+    TransportTcp(boost::asio::io_context& ioc, onRcv&& rcb, onConnect&& ccb)
+        : Transport(std::move(rcb), std::move(ccb)), sock_{ioc}, retry_{ioc} { maxPayload_ = PktBuf::capacity; }
+
+    void busyPoll(int us) final { busyPollUs_ = us; if (connected_) setBusyPoll(sock_.native_handle(), us); }
+
+    // connection established: start reading & flush anything queued
+    void up() {
+        sock_.set_option(tcp::no_delay(true));
+        if (busyPollUs_) setBusyPoll(sock_.native_handle(), busyPollUs_);
+        connected_ = true;
+        rlen_ = 0;
+        if (! std::exchange(everConnected_, true)) ccb_();
+        issueRead();
+        if (! wq_.empty()) flush();
+    }
+
+    // connection lost or protocol error: drop it and let subclass re-establish it
+    void down() {
+        if (! connected_) return;
+        connected_ = false;
+        writing_ = false;
+        wq_.clear();
+        boost::system::error_code ec;
+        sock_.close(ec);
+        reconnect();
+    }
+    virtual void reconnect() = 0;
+
+    void issueRead() {
+        sock_.async_read_some(boost::asio::buffer(rbuf_.data() + rlen_, rbuf_.size() - rlen_),
+                [this](boost::system::error_code ec, std::size_t len) {
+                    if (ec) { if (ec != boost::asio::error::operation_aborted) down(); return; }
+                    rlen_ += len;
+                    size_t off = 0;
+                    for (size_t n; (n = pktLen(rbuf_.data() + off, rlen_ - off)) != 0 && n <= rlen_ - off; off += n) {
+                        if (n > maxPkt) { down(); return; }
+                        rcb_(rbuf_.data() + off, n);
+                    }
+                    if (pktLen(rbuf_.data() + off, rlen_ - off) > maxPkt) { down(); return; }
+                    if (off > 0) {
+                        std::memmove(rbuf_.data(), rbuf_.data() + off, rlen_ - off);
+                        rlen_ -= off;
+                    }
+                    issueRead();
+                });
+    }
+
+    void flush() {
+        if (writing_ || wq_.empty() || ! connected_) return;
+        writing_ = true;
+        wbuf_.clear();
+        std::swap(wbuf_, wq_);
+        boost::asio::async_write(sock_, boost::asio::buffer(wbuf_),
+                [this](boost::system::error_code ec, std::size_t) {
+                    if (ec) { if (ec != boost::asio::error::operation_aborted) down(); return; }
+                    writing_ = false;
+                    flush();
+                });
+    }
+
+    void send(const uint8_t* pkt, size_t len) final {
+        if (len > maxPkt) throw runtime_error( "send: packet too big");
+        if (! connected_ || wq_.size() + len > maxQueued) return;
+        bool idle = wq_.empty() && ! writing_;
+        wq_.insert(wq_.end(), pkt, pkt + len);
+        // defer the write to the end of this dispatch so packets sent together go together
+        if (idle) boost::asio::post(sock_.get_executor(), [this]{ flush(); });
+    }
+
+    void close() final {
+        connected_ = false;
+        retry_.cancel();
+        boost::system::error_code ec;
+        sock_.close(ec);
+    }
+};
+
+// Active (initiator) side of a TCP link. Has to be given the address and port of a passive peer.
+struct TransportTcpA final : TransportTcp {
+    tcp::resolver::results_type dst_;
+
+    TransportTcpA(std::string_view host, std::string_view port, boost::asio::io_context& ioc,
+            onRcv&& rcb, onConnect&& ccb) : TransportTcp(ioc, std::move(rcb), std::move(ccb)) {
+        dst_ = tcp::resolver(ioc).resolve(host, port, tcp::resolver::query::numeric_service);
+    }
+
+    void connect() {
+        boost::asio::async_connect(sock_, dst_, [this](boost::system::error_code ec, const tcp::endpoint&) {
+                if (ec) { reconnect(); return; }
+                up();
+            });
+    }
+
+    void reconnect() {
+        retry_.expires_after(std::chrono::seconds(1));
+        retry_.async_wait([this](const auto& e) { if (e == boost::system::errc::success) connect(); });
+    }
+};
+
+// Passive side of a TCP link. Listens on 'port' and uses the first peer that connects.
+struct TransportTcpP final : TransportTcp {
+    tcp::acceptor acc_;
+
+    TransportTcpP(uint16_t port, boost::asio::io_context& ioc, onRcv&& rcb, onConnect&& ccb)
+        : TransportTcp(ioc, std::move(rcb), std::move(ccb)), acc_{ioc, tcp::endpoint(tcp::v6(), port)} { }
+
+    void connect() {
+        acc_.async_accept(sock_, [this](boost::system::error_code ec) {
+                if (ec) {
+                    if (ec != boost::asio::error::operation_aborted) reconnect();
+                    return;
+                }
+                up();
+            });
+    }
+
+    void reconnect() { connect(); }
+};
+
+#ifdef __linux__
+/**
+ * Transport for apps on the same host via a shared memory ring (see
+ * shm_ring.hpp) rather than localhost multicast. Sending a packet copies it
+ * into the ring and receiving copies it out to a pool buffer so there are no
+ * kernel copies and no syscalls per packet while a receiver is busy. When a
+ * receiver runs dry it asks to be woken and waits on a (Linux abstract
+ * namespace) unix datagram socket. The next sender sends it a one byte wakeup.
+ */
+struct TransportShm final : Transport {
+    using wproto = boost::asio::local::datagram_protocol;
+    static constexpr size_t maxBatch = 64;  // packets handled per io_context dispatch
+
+    uint32_t id_;
+    ShmRing ring_;
+    wproto::socket wsock_;
+    uint8_t wb_[8];
+
+    static uint32_t randId() {
+        std::random_device rd;
+        uint32_t id;
+        while ((id = rd()) == 0) { }
+        return id;
+    }
+    std::string wname(uint32_t id) const { return format("{}{}-{:08x}", '\0', ring_.name_, id); }
+
+    TransportShm(std::string_view name, boost::asio::io_context& ioc, onRcv&& rcb, onConnect&& ccb)
+        : Transport(std::move(rcb), std::move(ccb)), id_{randId()}, ring_{name, id_}, wsock_{ioc} {
+        maxPayload_ = PktBuf::capacity;
+        wsock_.open();
+        wsock_.bind(wproto::endpoint(wname(id_)));
+        wsock_.non_blocking(true);
+    }
+
+    void issueRead() {
+        for (size_t n = 0; n < maxBatch; ++n) {
+            auto p = ring_.next(pool_);
+            if (! p) {
+                if (ring_.rdWait()) {
+                    wsock_.async_receive(boost::asio::buffer(wb_), [this](boost::system::error_code ec, size_t) {
+                                if (ec != boost::asio::error::operation_aborted) issueRead();
+                            });
+                    return;
+                }
+                continue;
+            }
+            deliver(p, p.size());
+        }
+        // more packets are waiting but let other handlers run first
+        boost::asio::post(wsock_.get_executor(), [this]{ issueRead(); });
+    }
+
+    void connect() {
+        ring_.join();
+        ccb_();
+        issueRead();
+    }
+
+    void close() {
+        ring_.leave();
+        boost::system::error_code ec;
+        wsock_.close(ec);
+    }
+
+    void send(const uint8_t* pkt, size_t len) {
+        ring_.send(pkt, len, [this](uint32_t id) {
+                    // the wakeup can fail if the member just exited or already has a wakeup queued
+                    boost::system::error_code ec;
+                    wsock_.send_to(boost::asio::buffer(wb_, 1), wproto::endpoint(wname(id)), 0, ec);
+                });
+    }
+};
+#endif
+
+#ifdef DCT_HAVE_PACKET_RING
+/**
+ * Transport for a single L2 segment that carries DCT packets directly in
+ * Ethernet frames via mmap'd AF_PACKET rings (see packet_ring.hpp). A wakeup
+ * delivers all the packets in the rx blocks the kernel has handed over and
+ * sends are put in the tx ring then, after the io_context handlers that are
+ * currently ready have run, one syscall sends them all.
+ */
+struct TransportEth final : Transport {
+    PacketRing ring_;
+    boost::asio::posix::stream_descriptor desc_;    // (a dup of the ring's socket) to wait on
+    bool kickPending_{false};
+
+    TransportEth(std::string_view ifname, boost::asio::io_context& ioc, onRcv&& rcb, onConnect&& ccb)
+        : Transport(std::move(rcb), std::move(ccb)), ring_{std::string(ifname)}, desc_{ioc, ::dup(ring_.fd())} {
+        maxPayload_ = ring_.maxPayload();
+    }
+
+    void issueRead() {
+        desc_.async_wait(boost::asio::posix::stream_descriptor::wait_read, [this](boost::system::error_code ec) {
+                if (ec == boost::asio::error::operation_aborted) return;
+                if (!ec) ring_.receive([this](const uint8_t* p, size_t len) {
+                            // the frame may be padded so use the packet's TLV length
+                            auto n = pktLen(p, len);
+                            if (n == 0 || n > len) return;
+                            auto b = PktRef::copy(pool_, p, n);
+                            deliver(b, n);
+                        });
+                issueRead();
+            });
+    }
+
+    void connect() {
+        ccb_();
+        issueRead();
+    }
+
+    void close() {
+        boost::system::error_code ec;
+        desc_.close(ec);
+    }
+
+    void send(const uint8_t* pkt, size_t len) {
+        if (! ring_.queue(pkt, len)) {
+            // ring is full: push out what's there and try again. If the kernel still
+            // hasn't freed a frame the packet is dropped (like a full socket buffer).
+            ring_.kick();
+            if (! ring_.queue(pkt, len)) return;
+        }
+        if (! std::exchange(kickPending_, true))
+            boost::asio::post(desc_.get_executor(), [this]{ kickPending_ = false; ring_.kick(); });
+    }
+};
+#endif
+
+/**
+ * Transport attached to an in-process simulated network (see sim_net.hpp).
+ * All the transports using the same net name share a broadcast segment with
+ * the net's loss, delay, reordering and mtu.
+ */
+struct TransportSim final : Transport {
+    SimNet& net_;
+    boost::asio::io_context& ioc_;
+    uint32_t id_{};
+
+    TransportSim(std::string_view name, boost::asio::io_context& ioc, onRcv&& rcb, onConnect&& ccb)
+        : Transport(std::move(rcb), std::move(ccb)), net_{SimNet::get(name)}, ioc_{ioc} {
+        maxPayload_ = std::min(net_.params().mtu, PktBuf::capacity);
+    }
+
+    void connect() {
+        id_ = net_.join(ioc_, pool_, [this](PktRef&& b) { auto len = b.size(); deliver(b, len); });
+        ccb_();
+    }
+
+    void close() { if (id_) net_.leave(std::exchange(id_, 0)); }
+
+    void send(const uint8_t* pkt, size_t len) { if (id_) net_.send(id_, pkt, len); }
+};
+
+/**
+ * Transport that aggregates the multicast links of several interfaces (e.g., the two
+ * NICs of a node on redundant networks) into one face so it doesn't take a relay to
+ * bridge them. Every link's packets go to the face, which discards the copies that
+ * arrive on more than one of them: dup Interests (cStates) via its DIT and dup Data
+ * (cAdds from peers that mirror their sends) via its duplicate data table. (A mirrored cAdd
+ * copy still finds the PIT entry the first one satisfied since it lingers for the DED
+ * window so, without the table, each copy would be validated and decrypted again.)
+ * Sends are either mirrored on every link (redundancy) or go to
+ * the links in turn (combined bandwidth; a node that's lost a link then misses some
+ * of the packets until sync repairs them).
+ *
+ * The face's maxPayload is the smallest of the links'.
+ */
+struct TransportAggregate final : Transport {
+    std::vector<std::unique_ptr<Transport>> links_{};
+    bool mirror_;
+    size_t next_{};     // next link for round-robin sends
+
+    TransportAggregate(std::string_view ifnames, bool mirror, boost::asio::io_context& ioc,
+                       onRcv&& rcb, onConnect&& ccb)
+        : Transport(std::move(rcb), std::move(ccb)), mirror_{mirror} {
+        while (ifnames.size()) {
+            auto n = ifnames.substr(0, ifnames.find(','));
+            ifnames.remove_prefix(std::min(n.size() + 1, ifnames.size()));
+            if (n.empty()) continue;
+            auto i = links_.size();
+            links_.emplace_back(std::make_unique<TransportMulticast>(TransportMulticast::defaultGroup(),
+                                    std::string(n), ioc, [this, i](auto p, auto l){ rcvLink(i, p, l); }, []{}));
+        }
+        if (links_.empty()) throw runtime_error("aggregate transport needs at least one interface");
+        maxPayload_ = PktBuf::capacity;
+        for (const auto& l : links_) maxPayload_ = std::min(maxPayload_, l->maxPayload());
+    }
+
+    // deliver a packet from link 'i' with the link's buffer & receive time (so the face's
+    // rcvBuf() and rxTime() work as they would with a single link)
+    void rcvLink(size_t i, const uint8_t* pkt, size_t len) {
+        auto& l = *links_[i];
+        rcvd_ = std::move(l.rcvd_);
+        rxTs_ = l.rxTs_;
+        rcb_(pkt, len);
+        l.rcvd_ = std::move(rcvd_);
+        rxTs_ = {};
+    }
+
+    void connect() {
+        ccb_();
+        for (auto& l : links_) l->connect();
+    }
+    void close() { for (auto& l : links_) l->close(); }
+
+    void uring() final { for (auto& l : links_) l->uring(); }
+    void busyPoll(int us) final { busyPollUs_ = us; for (auto& l : links_) l->busyPoll(us); }
+    bool rxTimestamps() final {
+        bool ok{true};
+        for (auto& l : links_) ok &= l->rxTimestamps();
+        return ok;
+    }
+    // whether a peer mirrors its sends isn't known here so, with more than one link,
+    // any packet may arrive more than once
+    bool mirrors() const noexcept final { return links_.size() > 1; }
+
+    void send(const uint8_t* pkt, size_t len) {
+        if (mirror_) {
+            for (auto& l : links_) l->send(pkt, len);
+            return;
+        }
+        links_[next_]->send(pkt, len);
+        if (++next_ >= links_.size()) next_ = 0;
+    }
+};
+
 /**
  * Return a transport connection as specified by 'addr'.
  *
@@ -230,20 +870,70 @@ struct TransportUdpP final : TransportUdp {
  *  host:port - (active) unicast UDP connection to given host and port.
  *              Host may specified by name or address, port must be a
  *              non-zero integer string.
+ *
+ *  tcp:port  - (passive) TCP link listening on 'port'.
+ *
+ *  tcp:host:port - (active) TCP link to given host and port.
+ *
+ *  shm:name  - shared memory ring 'name' connecting apps on this host
+ *              (Linux only). 'shm:' uses ring 'default'.
+ *
+ *  eth:ifname - raw Ethernet frames on interface 'ifname' (Linux only, needs
+ *              CAP_NET_RAW). 'eth:' uses the default interface.
+ *
+ *  sim:name  - in-process simulated network 'name' (see sim_net.hpp). 'sim:'
+ *              uses net 'default'.
+ *
+ *  mc:if1,if2,... - IP6 multicast on each of the interfaces with sends mirrored
+ *              on all of them. 'mc-rr:' sends on each in turn (see TransportAggregate).
+ *
+ * Any of the UDP forms can be prefixed with 'uring:' to do the transport's I/O
+ * via io_uring rather than the io_context's reactor (Linux only).
  */
 //XXX should be constexpr but gcc 11.2 complains
 [[maybe_unused]]
 static Transport& transport(std::string_view addr, boost::asio::io_context& ioc,
                             Transport::onRcv&& rcb, Transport::onConnect&& ccb) {
-    if (addr.size() == 0) return *new TransportMulticast(ioc, std::move(rcb), std::move(ccb));
+    if (addr.starts_with("uring:")) {
+        auto& t = transport(addr.substr(6), ioc, std::move(rcb), std::move(ccb));
+        t.uring();
+        return t;
+    }
+    if (addr.starts_with("shm:")) {
+#ifdef __linux__
+        addr.remove_prefix(4);
+        return *new TransportShm(addr.size()? addr : "default", ioc, std::move(rcb), std::move(ccb));
+#else
+        throw runtime_error("shm transport is only supported on Linux");
+#endif
+    }
+    if (addr.starts_with("sim:")) {
+        addr.remove_prefix(4);
+        return *new TransportSim(addr.size()? addr : "default", ioc, std::move(rcb), std::move(ccb));
+    }
+    if (addr.starts_with("eth:")) {
+#ifdef DCT_HAVE_PACKET_RING
+        addr.remove_prefix(4);
+        return *new TransportEth(addr.size()? std::string(addr) : defaultIf(), ioc, std::move(rcb), std::move(ccb));
+#else
+        throw runtime_error("eth transport is only supported on Linux");
+#endif
+    }
+    if (addr.starts_with("mc:")) return *new TransportAggregate(addr.substr(3), true, ioc, std::move(rcb), std::move(ccb));
+    if (addr.starts_with("mc-rr:")) return *new TransportAggregate(addr.substr(6), false, ioc, std::move(rcb), std::move(ccb));
+    bool tcp = addr.starts_with("tcp:");
+    if (tcp) addr.remove_prefix(4);
+    else if (addr.size() == 0) return *new TransportMulticast(ioc, std::move(rcb), std::move(ccb));
 
     auto sep = addr.find(':');
     if (sep == addr.npos) {
         uint16_t port{};
         std::from_chars(addr.data(), addr.data()+addr.size(), port);
-        if (port == 0) throw runtime_error(format("invalid Udp listen port {}", addr));
+        if (port == 0) throw runtime_error(format("invalid {} listen port {}", tcp? "Tcp" : "Udp", addr));
+        if (tcp) return *new TransportTcpP(port, ioc, std::move(rcb), std::move(ccb));
         return *new TransportUdpP(port, ioc, std::move(rcb), std::move(ccb));
     }
+    if (tcp) return *new TransportTcpA(addr.substr(0, sep), addr.substr(sep+1), ioc, std::move(rcb), std::move(ccb));
     return *new TransportUdpA(addr.substr(0, sep), addr.substr(sep+1), ioc, std::move(rcb), std::move(ccb));
 }
 
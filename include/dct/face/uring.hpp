@@ -0,0 +1,351 @@
+#ifndef DCT_FACE_URING_HPP
+#define DCT_FACE_URING_HPP
+#pragma once
+/*
+ * io_uring datagram I/O for Direct Face transports (Linux only)
+ *
+ * Copyright (C) 2022 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This is not intended as production code.
+ */
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define DCT_HAVE_URING 1
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+#include "pkt_buf.hpp"
+
+namespace dct {
+
+/**
+ * Minimal io_uring submission/completion ring using the raw syscalls (so
+ * there's no liburing dependency). Single threaded: one thread submits and
+ * reaps.
+ */
+class Uring {
+    int fd_{-1};
+    void* sqPtr_{};
+    size_t sqSz_{};
+    void* cqPtr_{};
+    size_t cqSz_{};
+    io_uring_sqe* sqes_{};
+    size_t sqesSz_{};
+
+    unsigned* sqHead_{};
+    unsigned* sqTail_{};
+    unsigned* sqArray_{};
+    unsigned sqMask_{};
+    unsigned sqEntries_{};
+    unsigned sqLocalTail_{};
+    unsigned toSubmit_{};
+
+    unsigned* cqHead_{};
+    unsigned* cqTail_{};
+    io_uring_cqe* cqes_{};
+    unsigned cqMask_{};
+
+    static auto load(const unsigned* p) noexcept { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+    static void store(unsigned* p, unsigned v) noexcept { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+    static auto err(const char* what) { return runtime_error(format("io_uring {}: {}", what, std::strerror(errno))); }
+
+    static void* map(size_t sz, int fd, off_t off) {
+        auto p = ::mmap(nullptr, sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, off);
+        if (p == MAP_FAILED) throw err("mmap");
+        return p;
+    }
+
+  public:
+    Uring(unsigned entries, unsigned cqEntries) {
+        io_uring_params p{};
+        p.flags = IORING_SETUP_CQSIZE;
+        p.cq_entries = cqEntries;
+        fd_ = ::syscall(__NR_io_uring_setup, entries, &p);
+        if (fd_ < 0) throw err("setup");
+        sqSz_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cqSz_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        if (p.features & IORING_FEAT_SINGLE_MMAP) sqSz_ = cqSz_ = std::max(sqSz_, cqSz_);
+        sqPtr_ = map(sqSz_, fd_, IORING_OFF_SQ_RING);
+        cqPtr_ = (p.features & IORING_FEAT_SINGLE_MMAP)? sqPtr_ : map(cqSz_, fd_, IORING_OFF_CQ_RING);
+        sqesSz_ = p.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(map(sqesSz_, fd_, IORING_OFF_SQES));
+
+        auto sq = static_cast<uint8_t*>(sqPtr_);
+        sqHead_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+        sqTail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sqArray_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        sqMask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        sqEntries_ = p.sq_entries;
+        sqLocalTail_ = *sqTail_;
+
+        auto cq = static_cast<uint8_t*>(cqPtr_);
+        cqHead_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cqTail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        cqMask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    }
+    Uring(const Uring&) = delete;
+    Uring& operator=(const Uring&) = delete;
+    ~Uring() {
+        if (sqes_) ::munmap(sqes_, sqesSz_);
+        if (cqPtr_ && cqPtr_ != sqPtr_) ::munmap(cqPtr_, cqSz_);
+        if (sqPtr_) ::munmap(sqPtr_, sqSz_);
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    auto fd() const noexcept { return fd_; }
+
+    int registerOp(unsigned op, void* arg, unsigned nargs) {
+        return ::syscall(__NR_io_uring_register, fd_, op, arg, nargs);
+    }
+
+    // next free (zeroed) submission queue entry. Submits the queued entries if the SQ is full.
+    io_uring_sqe* sqe() {
+        if (sqLocalTail_ - load(sqHead_) >= sqEntries_) submit();
+        auto i = sqLocalTail_++ & sqMask_;
+        auto s = &sqes_[i];
+        std::memset(s, 0, sizeof(*s));
+        sqArray_[i] = i;
+        ++toSubmit_;
+        return s;
+    }
+
+    auto pending() const noexcept { return toSubmit_; }
+
+    // hand all the queued entries to the kernel with a single syscall
+    void submit() {
+        store(sqTail_, sqLocalTail_);
+        while (toSubmit_ > 0) {
+            auto n = ::syscall(__NR_io_uring_enter, fd_, toSubmit_, 0, 0, nullptr, 0);
+            if (n < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+                throw err("enter");
+            }
+            toSubmit_ -= n;
+        }
+    }
+
+    // call 'cb(const io_uring_cqe&)' for each completion that's ready
+    template<typename CB>
+    void reap(CB&& cb) {
+        auto head = *cqHead_;
+        for (auto tail = load(cqTail_); head != tail; tail = load(cqTail_)) {
+            for (; head != tail; ++head) cb(cqes_[head & cqMask_]);
+            store(cqHead_, head);
+        }
+    }
+};
+
+/**
+ * io_uring receive & send for a datagram socket. All the packets arriving
+ * on the socket are delivered by a single multishot recvmsg into a ring of
+ * provided (kernel registered) pool buffers so, once started, receiving
+ * doesn't need a syscall per packet nor an epoll wakeup: completions are
+ * reaped in batches when the ring's eventfd fires. Sends are queued as
+ * SQEs and submitted with one io_uring_enter after the current io_context
+ * handlers have run.
+ *
+ * The recvmsg puts an io_uring_recvmsg_out header and the sender's address
+ * in front of each packet in its buffer so PktRefs of received packets
+ * have a non-zero offset.
+ */
+struct UringIO {
+    static constexpr unsigned nSqe = 256;
+    static constexpr unsigned nCqe = 1024;
+    static constexpr unsigned nBufs = 256;          // provided receive buffers (power of 2)
+    static constexpr uint16_t bgid = 0;             // provided buffer group id
+    static constexpr uint64_t rcvTag = ~0ull;       // user_data of multishot receive
+
+    PktPool& pool_;                 // the transport's buffer pool (see pkt_buf.hpp)
+    Uring ring_{nSqe, nCqe};
+    io_uring_buf* br_{};            // provided buffer ring (see provide())
+    size_t brSz_{};
+    uint16_t brTail_{};
+    std::array<PktRef, nBufs> rbuf_{};
+    msghdr rmsg_{};
+    int rsock_{-1};
+    int tsock_{-1};
+    sockaddr_in6 dst_{};
+    bool hasDst_{false};
+    bool rcvArmed_{false};
+    bool submitPosted_{false};
+    std::vector<PktRef> sops_{};    // packets of sends in progress
+    std::vector<uint32_t> freeOps_{};
+    int efd_{-1};
+    uint64_t evcnt_{};
+    std::unique_ptr<boost::asio::posix::stream_descriptor> ev_{};
+
+    // receive on socket 'rsock' and send on 'tsock' to 'dst' (if non-null, i.e., tsock isn't connected)
+    UringIO(PktPool& pool, int rsock, int tsock, const void* dst, size_t dlen) : pool_{pool}, rsock_{rsock}, tsock_{tsock} {
+        if (dst) {
+            std::memcpy(&dst_, dst, std::min(dlen, sizeof(dst_)));
+            hasDst_ = true;
+        }
+        brSz_ = nBufs * sizeof(io_uring_buf);
+        auto m = ::mmap(nullptr, brSz_, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+        if (m == MAP_FAILED) throw runtime_error("io_uring: can't map buffer ring");
+        br_ = static_cast<io_uring_buf*>(m);
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(br_);
+        reg.ring_entries = nBufs;
+        reg.bgid = bgid;
+        if (ring_.registerOp(IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+            throw runtime_error(format("io_uring: can't register buffer ring: {}", std::strerror(errno)));
+        for (uint16_t i = 0; i < nBufs; ++i) provide(i);
+
+        efd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (efd_ < 0 || ring_.registerOp(IORING_REGISTER_EVENTFD, &efd_, 1) < 0)
+            throw runtime_error(format("io_uring: can't register eventfd: {}", std::strerror(errno)));
+
+        rmsg_.msg_namelen = sizeof(sockaddr_in6);
+    }
+    UringIO(const UringIO&) = delete;
+    UringIO& operator=(const UringIO&) = delete;
+    ~UringIO() {
+        ev_.reset();    // closes efd_
+        io_uring_buf_reg reg{};
+        reg.bgid = bgid;
+        ring_.registerOp(IORING_UNREGISTER_PBUF_RING, &reg, 1);
+        if (br_) ::munmap(br_, brSz_);
+    }
+
+    /*
+     * (re)give receive buffer 'bid' to the kernel.
+     *
+     * The ring is an array of io_uring_buf with the ring's tail overlaid on
+     * the first entry's 'resv' field. It's indexed directly rather than via
+     * io_uring_buf_ring because, in C++, that struct's flexible array member
+     * doesn't start at offset 0 (__DECLARE_FLEX_ARRAY adds an empty struct).
+     */
+    void provide(uint16_t bid) {
+        if (! rbuf_[bid]) rbuf_[bid] = PktRef::get(pool_);
+        auto& b = br_[brTail_ & (nBufs - 1)];
+        b.addr = reinterpret_cast<uint64_t>(rbuf_[bid].buf());
+        b.len = rbuf_[bid].capacity();
+        b.bid = bid;
+        __atomic_store_n(&br_[0].resv, ++brTail_, __ATOMIC_RELEASE);
+    }
+
+    void armReceive() {
+        auto s = ring_.sqe();
+        s->opcode = IORING_OP_RECVMSG;
+        s->fd = rsock_;
+        s->addr = reinterpret_cast<uint64_t>(&rmsg_);
+        s->ioprio = IORING_RECV_MULTISHOT;
+        s->flags = IOSQE_BUFFER_SELECT;
+        s->buf_group = bgid;
+        s->user_data = rcvTag;
+        rcvArmed_ = true;
+    }
+
+    /**
+     * Start receiving. 'ok(from)' says whether to accept a packet from 'from'.
+     * 'deliver(PktRef& buf, size_t len)' is called with each accepted packet and
+     * can keep the packet by taking ownership of 'buf'.
+     */
+    template<typename OK, typename DLV>
+    void start(boost::asio::io_context& ioc, OK&& ok, DLV&& deliver) {
+        ev_ = std::make_unique<boost::asio::posix::stream_descriptor>(ioc, efd_);
+        armReceive();
+        ring_.submit();
+        waitEv(std::forward<OK>(ok), std::forward<DLV>(deliver));
+    }
+
+    template<typename OK, typename DLV>
+    void waitEv(OK ok, DLV deliver) {
+        ev_->async_read_some(boost::asio::buffer(&evcnt_, sizeof(evcnt_)),
+                [this, ok, deliver](boost::system::error_code ec, size_t) mutable {
+                    if (ec == boost::asio::error::operation_aborted) return;
+                    complete(ok, deliver);
+                    waitEv(ok, deliver);
+                });
+    }
+
+    template<typename OK, typename DLV>
+    void complete(OK& ok, DLV& deliver) {
+        ring_.reap([this, &ok, &deliver](const io_uring_cqe& c) {
+            if (c.user_data != rcvTag) {
+                // send completion: release the packet. Errors are ignored like
+                // Transport::ehandler ignores ECONNREFUSED (a missing peer).
+                sops_[c.user_data].reset();
+                freeOps_.push_back(c.user_data);
+                return;
+            }
+            if (! (c.flags & IORING_CQE_F_MORE)) rcvArmed_ = false;
+            if (c.res < 0 || ! (c.flags & IORING_CQE_F_BUFFER)) return; // e.g., ENOBUFS, re-armed below
+            uint16_t bid = c.flags >> IORING_CQE_BUFFER_SHIFT;
+            auto& b = rbuf_[bid];
+            auto o = reinterpret_cast<const io_uring_recvmsg_out*>(b.buf());
+            auto from = reinterpret_cast<const sockaddr_in6*>(b.buf() + sizeof(*o));
+            if (! (o->flags & MSG_TRUNC) && o->payloadlen > 0 && ok(*from)) {
+                b.off(sizeof(*o) + rmsg_.msg_namelen);
+                deliver(b, o->payloadlen);
+            }
+            provide(bid);
+        });
+        if (! rcvArmed_) armReceive();
+        if (ring_.pending()) ring_.submit();
+    }
+
+    // queue a copy of a packet to be sent. Returns true if the caller needs to
+    // arrange for submit() to be called (i.e., none is pending).
+    bool send(const uint8_t* pkt, size_t len) {
+        if (freeOps_.empty()) {
+            freeOps_.push_back(sops_.size());
+            sops_.emplace_back();
+        }
+        auto i = freeOps_.back();
+        freeOps_.pop_back();
+        sops_[i] = PktRef::copy(pool_, pkt, len);
+        auto s = ring_.sqe();
+        s->opcode = IORING_OP_SEND;
+        s->fd = tsock_;
+        s->addr = reinterpret_cast<uint64_t>(sops_[i].data());
+        s->len = len;
+        if (hasDst_) {
+            // sendto form of IORING_OP_SEND (kernel 6.0+)
+            s->addr2 = reinterpret_cast<uint64_t>(&dst_);
+            s->addr_len = sizeof(dst_);
+        }
+        s->user_data = i;
+        return ! std::exchange(submitPosted_, true);
+    }
+
+    void submit() {
+        submitPosted_ = false;
+        if (ring_.pending()) ring_.submit();
+    }
+};
+
+} // namespace dct
+
+#endif // __linux__ && io_uring.h
+
+#endif  // DCT_FACE_URING_HPP
@@ -3,6 +3,7 @@
 #pragma once
 /*
  * fileToVec - read the contents of a file into a vector
+ * mappedFile - map the contents of a file read-only
  *
  * Copyright (C) 2021 Pollere LLC
  *
@@ -25,8 +26,14 @@
  */
 #include <iostream>
 #include <fstream>
+#include <span>
 #include <stdexcept>
+#include <utility>
 #include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "format.hpp"
 
 namespace dct {
@@ -50,6 +57,36 @@ static auto fileToVec(std::string_view fname) {
     return buf;
 }
 
+// A file's contents mapped (read only) for as long as the mappedFile exists. Parsing
+// the mapping directly, rather than a copy read with fileToVec, saves a read and a copy.
+struct mappedFile {
+    const uint8_t* data_{};
+    size_t size_{};
+
+    explicit mappedFile(std::string_view fname) {
+        std::string f{fname};
+        auto fd = ::open(f.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error(format("can't open file {}", fname));
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size < 2 || st.st_size > 65536) {
+            ::close(fd);
+            throw std::runtime_error(format("{} file size unreasonable ({} bytes)\n", fname, st.st_size));
+        }
+        auto p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);    // (the mapping holds its own reference to the file)
+        if (p == MAP_FAILED) throw std::runtime_error(format("couldn't map file {}\n", fname));
+        data_ = (const uint8_t*)p;
+        size_ = st.st_size;
+    }
+    mappedFile(const mappedFile&) = delete;
+    mappedFile& operator=(const mappedFile&) = delete;
+    mappedFile(mappedFile&& m) noexcept : data_{std::exchange(m.data_, nullptr)}, size_{std::exchange(m.size_, 0)} { }
+    ~mappedFile() { if (data_) ::munmap((void*)data_, size_); }
+
+    std::span<const uint8_t> span() const noexcept { return {data_, size_}; }
+    auto size() const noexcept { return size_; }
+};
+
 } // namespace dct
 
 #endif // FILE_TO_VEC_HPP
@@ -0,0 +1,145 @@
+#ifndef DCT_MEM_REPORT_HPP
+#define DCT_MEM_REPORT_HPP
+#pragma once
+/*
+ * Memory accounting of DCT's tables and collections
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This is not intended as production code.
+ */
+
+/*
+ * Each subsystem (collections, cert store, face tables, mbps reassembly,
+ * distributor member lists) adds the number of items it holds and the heap
+ * bytes they use to a MemReport (see DCTmodel::memoryReport()). Bytes are
+ * computed from container sizes and capacities plus the usual node overheads
+ * of the std containers so they're estimates (within allocator rounding) that
+ * cost nothing until a report is asked for. Like statsStr(), a report has to
+ * be made on the face's thread.
+ *
+ * As a check on the estimates, defining DCT_TRACK_ALLOC when building an app
+ * replaces the global operator new & delete with versions that count the
+ * program's live heap bytes and allocations, which MemReport::str() then
+ * includes. (An app made from several translation units must define it in
+ * only one of them.)
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <dct/format.hpp>
+
+#if defined(DCT_TRACK_ALLOC)
+#if __has_include(<malloc.h>)
+#include <malloc.h>
+#define DCT_ALLOC_SIZE(p) malloc_usable_size(p)
+#elif __has_include(<malloc/malloc.h>)
+#include <malloc/malloc.h>
+#define DCT_ALLOC_SIZE(p) malloc_size(p)
+#else
+#error "DCT_TRACK_ALLOC needs malloc_usable_size or malloc_size"
+#endif
+#endif
+
+namespace dct {
+
+// counts maintained by the DCT_TRACK_ALLOC operator new & delete
+struct AllocStats {
+    static inline std::atomic<int64_t> live{};      // heap bytes in use
+    static inline std::atomic<uint64_t> allocs{};   // allocations made
+    static inline std::atomic<uint64_t> frees{};
+};
+
+// heap bytes of the common containers (payload plus allocator node overhead)
+namespace mem {
+    static constexpr size_t node = 2 * sizeof(void*);   // per-allocation bookkeeping
+    template<typename V> static size_t vec(const V& v) { return v.capacity() * sizeof(typename V::value_type); }
+    template<typename M> static size_t map(const M& m) {
+        return m.size() * (sizeof(typename M::value_type) + 4 * sizeof(void*) + node);
+    }
+    template<typename M> static size_t hash(const M& m) {
+        return m.size() * (sizeof(typename M::value_type) + sizeof(void*) + sizeof(size_t) + node) +
+               m.bucket_count() * sizeof(void*);
+    }
+} // namespace mem
+
+struct MemReport {
+    struct Use {
+        std::string what_;
+        size_t items_;
+        size_t bytes_;
+    };
+    std::vector<Use> use_{};
+
+    auto& add(std::string_view what, size_t items, size_t bytes) {
+        use_.emplace_back(std::string(what), items, bytes);
+        return *this;
+    }
+    auto& add(const MemReport& r) {
+        use_.insert(use_.end(), r.use_.begin(), r.use_.end());
+        return *this;
+    }
+    size_t total() const noexcept {
+        size_t t{};
+        for (const auto& u : use_) t += u.bytes_;
+        return t;
+    }
+
+    std::string str() const {
+        std::string s = format("{:<36} {:>9} {:>11} {:>9}\n", "subsystem", "items", "bytes", "bytes/item");
+        for (const auto& u : use_)
+            s += format("{:<36} {:>9} {:>11} {:>9}\n", u.what_, u.items_, u.bytes_, u.items_? u.bytes_ / u.items_ : 0);
+        s += format("{:<36} {:>9} {:>11}\n", "total", "", total());
+        if (AllocStats::allocs.load())
+            s += format("heap: live {} bytes in {} allocations\n", AllocStats::live.load(),
+                        AllocStats::allocs.load() - AllocStats::frees.load());
+        return s;
+    }
+};
+
+} // namespace dct
+
+#if defined(DCT_TRACK_ALLOC)
+// replacement global allocation functions (they can't be inline so only one TU may define DCT_TRACK_ALLOC)
+void* operator new(std::size_t n) {
+    auto p = std::malloc(n? n : 1);
+    if (! p) throw std::bad_alloc();
+    dct::AllocStats::live.fetch_add(DCT_ALLOC_SIZE(p), std::memory_order_relaxed);
+    dct::AllocStats::allocs.fetch_add(1, std::memory_order_relaxed);
+    return p;
+}
+void* operator new[](std::size_t n) { return ::operator new(n); }
+void operator delete(void* p) noexcept {
+    if (! p) return;
+    dct::AllocStats::live.fetch_sub(DCT_ALLOC_SIZE(p), std::memory_order_relaxed);
+    dct::AllocStats::frees.fetch_add(1, std::memory_order_relaxed);
+    std::free(p);
+}
+void operator delete[](void* p) noexcept { ::operator delete(p); }
+void operator delete(void* p, std::size_t) noexcept { ::operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { ::operator delete(p); }
+#endif
+
+#endif  // DCT_MEM_REPORT_HPP
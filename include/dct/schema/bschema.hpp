@@ -37,6 +37,7 @@
 #include <vector>
 #include <unordered_map>
 #include "dct/format.hpp"
+#include "wyhash.hpp"
 
 namespace dct {
 
@@ -125,6 +126,43 @@ static inline constexpr bool operator<(const tPub& l, const tPub& r) {
     return std::tie(l.par, l.pub, l.tag, l.d) < std::tie(r.par, r.pub, r.tag, r.d);
 }
 
+// Perfect hash of a schema's tokens (there are at most maxTok of them) built when
+// the schema is read. The table holds token indices and is addressed by a seeded
+// wyhash of the token string with the seed and table size chosen so no two tokens
+// collide, making a lookup one hash and one string compare. The table doesn't
+// refer to the string table so it stays valid when a schema is copied or moved.
+struct tokHash {
+    std::vector<bComp> tab_{};  // token index or maxTok if slot is empty
+    uint64_t seed_{};
+    size_t mask_{};
+
+    size_t slot(bTok t) const noexcept { return wyHash{}((const uint8_t*)t.data(), t.size(), seed_) & mask_; }
+
+    void build(const std::vector<bTok>& tok) {
+        for (size_t sz = std::bit_ceil(tok.size() * 2 + 1); sz <= (1u << 16); sz <<= 1) {
+            mask_ = sz - 1;
+            for (seed_ = 0; seed_ < 64; seed_++) {
+                tab_.assign(sz, maxTok);
+                size_t i = 0;
+                for (; i < tok.size(); i++) {
+                    auto& t = tab_[slot(tok[i])];
+                    if (t == maxTok) t = i;
+                    else if (tok[t] != tok[i]) break; // (a duplicate token maps to its first index)
+                }
+                if (i == tok.size()) return;
+            }
+        }
+        throw schema_error("can't make token hash");
+    }
+
+    // return the index of token 't' or maxTok if it isn't one of 'tok'
+    bComp find(const std::vector<bTok>& tok, bTok t) const noexcept {
+        if (tab_.empty()) return maxTok;
+        auto i = tab_[slot(t)];
+        return i < maxTok && tok[i] == t ? i : maxTok;
+    }
+};
+
 static inline const std::map<sTLV,const char*> tlvName{
     {sTLV::none, "none"},
     {sTLV::schema, "schema"},
@@ -152,9 +190,12 @@ struct bSchema {
     std::vector<bName> vlist_{};
     std::vector<tDiscrim> discrim_{};
     std::vector<tPub> pub_{};
-    std::unordered_map<bTok,bComp> tm_{};
+    tokHash tm_{};
     std::vector<uint8_t> schemaTP_{};
 
+    // return the index of token 't' or maxTok if it's not in the schema
+    bComp findTok(bTok t) const noexcept { return tm_.find(tok_, t); }
+
     // return the name of the pub at index 'i'
     bTok pubName(pubidx i) const {
         if (i >= pub_.size()) throw schema_error(format("no pub with index {} in schema", i));
@@ -215,17 +256,41 @@ struct bSchema {
         discrim_ = other.discrim_;
         pub_ = other.pub_;
         schemaTP_ = other.schemaTP_;;
-        tm_.clear();
+        tm_ = other.tm_;
         auto off = stab_.data() - other.stab_.data();
         for (size_t i = 0, n = tok_.size(); i < n; i++) {
             auto& otok = other.tok_[i];
             tok_[i] = bTok(otok.data() + off, otok.size());
-            tm_.emplace(tok_[i], i);
         }
     }
     bSchema() = default;
 
-    bSchema(bSchema&& other) = default;
+    // a moved string keeps its buffer unless it's short enough to be held in the string
+    // itself so the tokens are rebased if stab_'s data moved
+    bSchema(bSchema&& other) noexcept { *this = std::move(other); }
+
+    bSchema& operator=(bSchema&& other) noexcept {
+        if (this == &other) return *this;
+        const auto odata = other.stab_.data();
+        stab_ = std::move(other.stab_);
+        tok_ = std::move(other.tok_);
+        cert_ = std::move(other.cert_);
+        chain_ = std::move(other.chain_);
+        cor_ = std::move(other.cor_);
+        tag_ = std::move(other.tag_);
+        tmplt_ = std::move(other.tmplt_);
+        vlist_ = std::move(other.vlist_);
+        discrim_ = std::move(other.discrim_);
+        pub_ = std::move(other.pub_);
+        tm_ = std::move(other.tm_);
+        schemaTP_ = std::move(other.schemaTP_);
+        if (stab_.data() != odata) {
+            for (auto& t : tok_) t = bTok(stab_.data() + (t.data() - odata), t.size());
+        }
+        other.stab_.clear();
+        other.tok_.clear();
+        return *this;
+    }
 
     bSchema(const bSchema& other) { _fixup_tok(other); }
 
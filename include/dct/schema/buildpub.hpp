@@ -80,11 +80,20 @@ struct pTmplt {
 
 template<bool pbdebug = false>
 struct pubBldr {
-    // make a 'builder' for pub 'pub' of binary schema 'bs' using certificate store 'cs'.
-    pubBldr(const bSchema& bs, certStore& cs, bTok pub) : bs_{bs}, cs_{cs} {
+    // make a 'builder' for pub 'pub' of binary schema 'bs' using the signing chain
+    // of certificate store 'cs'.
+    pubBldr(const bSchema& bs, const certStore& cs, bTok pub) : pubBldr(bs, cs.signingChain(), pub) { }
+
+    // as above but using the chain of 'cs' whose signing cert is 'signer'
+    pubBldr(const bSchema& bs, const certStore& cs, const thumbPrint& signer, bTok pub)
+        : pubBldr(bs, cs.signingChain(signer), pub) { }
+
+    // make a 'builder' for pub 'pub' of binary schema 'bs' using signing chain 'schain'
+    pubBldr(const bSchema& bs, certVec&& schain, bTok pub) : bs_{bs}, schain_{std::move(schain)} {
         pidx_ = bs_.findPub(pub);
         if (pidx_ < 0) throw schema_error(format("pub {} not found", pub));
         makePubTmplts(findCerts());
+        schain_ = {};   // (it views the certStore's certs and is only needed to make the templates)
     }
     // internal struct and utility definitions
     template <typename... T>
@@ -149,7 +158,7 @@ struct pubBldr {
         }
         // find the first chain matching the cert store signing chain
         auto cbm = cbm_;
-        auto schain = cs_.signingChain();
+        auto& schain = schain_;
         for (auto bm = cbm; bm != 0; ) {
             auto c = std::countr_zero(bm);
             bm &=~ (1u << c);
@@ -186,7 +195,7 @@ struct pubBldr {
 
     // find or add token 'tok'
     bComp findOrAddTok(bTok tok) {
-        if (auto t = bs_.tm_.find(tok); t != bs_.tm_.end()) return t->second;
+        if (auto t = bs_.findTok(tok); t < maxTok) return t;
         if (auto t = ptm_.find(tok); t != ptm_.end()) return t->second;
         return newTok(tok);
     }
@@ -196,7 +205,7 @@ struct pubBldr {
     // 'cor' an error is thrown.
     auto mapCor(auto idx, auto c, auto cor) {
         c &= SC_VALUE;
-        auto cert = cs_.signingChain();
+        auto& cert = schain_;
         for (const auto& [cert1, comp1, cert2, comp2] : bs_.cor_[cor]) {
             if (cert1 == idx && c == comp1) return findOrAddTok(cert[cert2-1][comp2].toSv());
         }
@@ -283,7 +292,7 @@ struct pubBldr {
     }
     // construct all the pub templates compatible with cert chains specified
     // by 'cbm'. At this point, all the certs from these chains are
-    // available in the certStore cs_ so 'correspondences' between pub
+    // available in schain_ so 'correspondences' between pub
     // and cert name components can be resolved. The resulting templates
     // will be complete except for parameter values and 'call' ops.
     void makePubTmplts(chainBM cbm) {
@@ -339,32 +348,35 @@ struct pubBldr {
     template<typename... Rest>
     void doParam(Params& par, std::string_view tag, Rest... rest) { doParam(par, tm_[tag], rest...); }
 
-    auto appendComp(const Params& par, bComp c, crName res) const {
-        if (isLit(c)) return res / bs_.tok_[c];
-        if (isIndex(c)) return res / ptok_[typeValue(c)];
-        if (isParam(c)) return std::visit(overloaded {
-                            [&res](std::monostate) { return res / "(empty)"; },
-                            [&res](std::string_view val) { return res / val; },
-                            [&res](std::string val) { return res / val; },
-                            [&res](timeVal val) { return res / val; },
-                            [&res](uint64_t val) { return res / val; },
+    // append component 'c' to 'res'. 'res' is moved through the operator/ calls so the
+    // name is built in its storage rather than copied per component.
+    void appendComp(const Params& par, bComp c, crName& res) const {
+        if (isLit(c)) { res = std::move(res) / bs_.tok_[c]; return; }
+        if (isIndex(c)) { res = std::move(res) / ptok_[typeValue(c)]; return; }
+        if (isParam(c)) {
+            res = std::visit(overloaded {
+                            [&res](std::monostate) { return std::move(res) / "(empty)"; },
+                            [&res](std::string_view val) { return std::move(res) / val; },
+                            [&res](std::string val) { return std::move(res) / val; },
+                            [&res](timeVal val) { return std::move(res) / val; },
+                            [&res](uint64_t val) { return std::move(res) / val; },
                         }, par[typeValue(c)]);
+            return;
+        }
         if (!isCall(c)) throw schema_error(format("invalid comp {} in template", c));
         // handle 'call()' ops
         c = typeValue(c);
-        if (c == 0) return res / std::chrono::system_clock::now();
-        if (c == 1) return res / sysID();
+        if (c == 0) { res = std::move(res) / std::chrono::system_clock::now(); return; }
+        if (c == 1) { res = std::move(res) / sysID(); return; }
         throw schema_error(format("invalid call {} in template", c));
     }
-    crName fillTmplt(const Params& par, pTmplt pt) const {
-        crName res{};
-        for (auto c : pt.tmplt_) res = appendComp(par, c, res);
-        return crName(res);
+    void fillTmplt(const Params& par, pTmplt pt, crName& res) const {
+        res.clear();
+        for (auto c : pt.tmplt_) appendComp(par, c, res);
     }
     bComp parToTok(const Params& par, compidx c) const {
         auto pval = format("{}", par[c]);
-        if (const auto v = bs_.tm_.find(pval); v != bs_.tm_.end()) return v->second;
-        return maxTok;
+        return bs_.findTok(pval);
     }
     bool checkParVal(const Params& par, const pTmplt& pt, compidx c) const noexcept {
         // assert(parmbm_[c] == true)
@@ -391,7 +403,7 @@ struct pubBldr {
         throw schema_error("no matching pub template");
     }
 
-    crName completeTmplt(Params& par) const {
+    void completeTmplt(Params& par, crName& res) const {
         // make sure all parameters were supplied or defaulted
         for (auto c = 0u; c < par.size(); c++) {
             if (parmbm_[c] && par[c].index() == 0) {
@@ -399,7 +411,12 @@ struct pubBldr {
                 par[c] = pdefault_[c];
             }
         }
-        return fillTmplt(par, matchTmplt(par));
+        fillTmplt(par, matchTmplt(par), res);
+    }
+    crName completeTmplt(Params& par) const {
+        crName res{};
+        completeTmplt(par, res);
+        return res;
     }
 
     // defaults(name, value ...) - set default pub parameter value(s)
@@ -442,6 +459,23 @@ struct pubBldr {
         return completeTmplt(par);
     }
 
+    // as name() but the name is built in the builder's reusable buffer (which only
+    // allocates when a name is bigger than any previous one). The returned name is
+    // valid until the next tmpName() call.
+    template<typename... Rest> requires ((sizeof...(Rest) & 1) == 0)
+    const crName& tmpName(Rest&&... rest) {
+        pbuf_.assign(tag_.size(), {});
+        doParam(pbuf_, std::forward<Rest>(rest)...);
+        completeTmplt(pbuf_, nbuf_);
+        return nbuf_;
+    }
+    const crName& tmpName(const std::vector<parItem>& pvec) {
+        pbuf_.assign(tag_.size(), {});
+        for (auto& [tag, val] : pvec) doOneParam(pbuf_, tm_[tag], val);
+        completeTmplt(pbuf_, nbuf_);
+        return nbuf_;
+    }
+
     // construct complete pub name given vector of <tag name> <value> pairs
     //
     // Each tag must refer to one of the pub's parameters and values for all
@@ -465,11 +499,13 @@ struct pubBldr {
     parmSet parmbm_{};
     chainBM cbm_{};
     const bSchema& bs_;
-    certStore& cs_;
+    certVec schain_{};          // signing chain the templates are made for
     std::unordered_map<bTok,bComp> ptm_{}; // pub-specific token map
     std::vector<bTok> ptok_{};
     std::string pstab_{};       // pub-specific string table
     int pidx_{-1};              // pub's index in bs_.pub_
+    crName nbuf_{};             // reusable buffers for tmpName()
+    Params pbuf_{};
 };
 
 } // namespace dct
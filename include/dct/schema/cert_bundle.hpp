@@ -23,10 +23,13 @@
  *  The DCT proof-of-concept is not intended as production code.
  *  More information on DCT is available from info@pollere.net
  */
+#include <span>
 #include <string_view>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
+#include "dct/file_to_vec.hpp"
 #include "dct/format.hpp"
 #include "dct/schema/dct_cert.hpp"
 #include "dct/schema/tlv_parser.hpp"
@@ -37,11 +40,11 @@ namespace dct {
 using certItem = std::pair<dctCert,keyVal>;
 using certBundle = std::vector<certItem>;
 
-static inline certBundle rdCertBundle(const std::vector<uint8_t>& buf) {
+static inline certBundle rdCertBundle(std::span<const uint8_t> buf) {
 
     // unpack all the objects in the bundle
     certBundle cb{};
-    auto bundle = tlvParser(tlvParser::Blk(buf), 0U); 
+    auto bundle = tlvParser(buf, 0U);
     for (auto obj : bundle) {
         // Bundles contain only certs (tlv 6 = Data) and keys (tlv 23 = Signature).
         // Keys immediately follow their cert so each iteration must start with cert.
@@ -62,6 +65,20 @@ static inline certBundle rdCertBundle(const std::vector<uint8_t>& buf) {
     }
     return cb;
 }
+static inline certBundle rdCertBundle(const std::vector<uint8_t>& buf) { return rdCertBundle(std::span(buf)); }
+
+// return the unpacked bundle in file 'fname'. The file is parsed where it's mapped
+// and the result kept, keyed by the hash of the file's contents, so a bundle used
+// by several DeftTs (or re-read) is only unpacked (and its thumbprints computed) once.
+static inline const certBundle& loadBundle(std::string_view fname) {
+    static std::unordered_map<thumbPrint,const certBundle> bundles{};
+
+    mappedFile mf(fname);
+    thumbPrint h{};
+    crypto_generichash(h.data(), h.size(), mf.span().data(), mf.size(), NULL, 0);
+    if (auto b = bundles.find(h); b != bundles.end()) return b->second;
+    return bundles.try_emplace(h, rdCertBundle(mf.span())).first->second;
+}
 
 } // namespace dct
 
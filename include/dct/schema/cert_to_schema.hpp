@@ -24,7 +24,7 @@
  *  More information on DCT is available from info@pollere.net
  */
 
-#include <sstream>
+#include <span>
 #include "dct_cert.hpp"
 #include "dct/format.hpp"
 #include "dct/sigmgrs/sigmgr_by_type.hpp"
@@ -36,8 +36,8 @@ namespace dct {
 // It's assumed that the cert signature has been validated and
 // the cert name checked for conformance to schema conventions.
 static inline bSchema certToSchema(const dctCert& cert, thumbPrint& tp) {
-    std::istringstream is(std::string(cert.content().toSv()), std::ios::binary);
-    auto bs = rdSchema(is).read();
+    // the schema is parsed directly from the cert's content
+    auto bs = rdSchema(cert.content().rest()).read();
     bs.schemaTP_.insert(bs.schemaTP_.begin(), tp.begin(), tp.end());
     return bs;
 }
@@ -25,12 +25,17 @@
  */
 
 #include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <memory>
 #include <set>
 #include <span>
 #include <string>
 #include <vector>
 #include "bschema.hpp"
 #include "dct_cert.hpp"
+#include "dct/mem_report.hpp"
+#include "dct/syncps/flat_map.hpp"
 
 namespace dct {
 
@@ -42,8 +47,59 @@ using keyVal = std::vector<uint8_t>;
 using certAddCb = std::function<void(const dctCert&)>;
 using chainAddCb = std::function<void(const dctCert&)>;
 
+/*
+ * A cert in a certStore: a view of the cert's bytes in the store's arena plus the
+ * fields lookups & chain walks use (so they don't touch the arena unless the cert
+ * itself is needed). 'signer_' is the store index of the cert's signing cert.
+ */
+struct storedCert : rCert {
+    using systime = dctCert::systime;
+    using validTime = dctCert::validTime;
+    static constexpr uint32_t unlinked = ~uint32_t(0);     // signer not yet resolved
+    static constexpr uint32_t selfSigned_ = ~uint32_t(1);  // no signer (trust anchor)
+
+    thumbPrint tp_{};
+    validTime validAfter_{};
+    validTime validUntil_{};
+    keyRef pk_{};
+    mutable uint32_t signer_{unlinked};
+
+    storedCert(rData d, const dctCert& c, uint32_t signer)
+        : rCert{d}, tp_{c.computeThumbPrint()}, validAfter_{c.validAfter()}, validUntil_{c.validUntil()},
+          pk_{content().rest()}, signer_{signer} { }
+
+    const thumbPrint& computeThumbPrint() const noexcept { return tp_; }
+    const thumbPrint& getKeyLoc() const { return thumbprint(); }
+    auto selfSigned() const { return dctCert::selfSigned(getKeyLoc()); }
+    auto getSigType() const { return sigType(); }
+
+    auto validAfter() const noexcept { return validAfter_; }
+    auto validUntil() const noexcept { return validUntil_; }
+    // (see dctCert::validAt)
+    bool validAt(systime tp = coarseClock::now()) const noexcept {
+        return validAfter_ <= tp + coarseClock::resolution() && std::chrono::floor<std::chrono::seconds>(tp) <= validUntil_;
+    }
+};
+
+/*
+ * The store keeps one copy of each cert's bytes in an arena of fixed size chunks
+ * (certs are never removed so nothing is freed until the store is), the certs'
+ * storedCert records in segments of a vector that never reallocate, and a flat
+ * thumbprint -> index map. Each record has the index of its signing cert so walking
+ * a chain is following indices rather than hashing each signer's thumbprint. With
+ * tens of thousands of member certs this is a fraction of the memory of a node per
+ * cert plus a separately allocated copy of its bytes. Records and cert bytes stay
+ * where they're put so references (and key views) handed out are stable.
+ */
 struct certStore {
-    std::unordered_map<thumbPrint,dctCert> certs_{}; // validated certs
+    static constexpr size_t chunkBytes = 32 * 1024;
+    static constexpr size_t segCerts = 256;
+
+    std::vector<std::unique_ptr<uint8_t[]>> arena_{};   // cert bytes
+    size_t used_{chunkBytes};                           // bytes used in the last (filling) chunk
+    size_t arenaBytes_{};
+    std::vector<std::vector<storedCert>> segs_{};      // cert records, 'segCerts' per segment
+    FlatMap<thumbPrint,uint32_t> idx_{};                // thumbprint -> record index
     std::unordered_map<thumbPrint,keyVal> key_{};    // cert-to-key (for signing certs)
     certChain chains_{}; // array of signing chain heads (thumbprints of signing certs)
     certAddCb addCb_{[](const dctCert&){}};          // called when a cert is added
@@ -53,17 +109,24 @@ struct certStore {
     void dumpcerts() const {
         print("Cert Dump\n");
         int i = 0;
-        for (const auto& [tp, cert] : certs_) print("{} {} tp {:x}\n", i++, cert.name(), fmt::join(tp," "));
+        for_each([&i](const storedCert& c) { print("{} {} tp {:x}\n", i++, c.name(), fmt::join(c.tp_," ")); });
     }
 
-    auto begin() const { return certs_.cbegin(); }
-    auto end() const { return certs_.cend(); }
+    auto size() const noexcept { return idx_.size(); }
+
+    const storedCert& at(uint32_t i) const noexcept { return segs_[i / segCerts][i % segCerts]; }
+
+    // invoke 'op' on each cert in the store (in the order they were added)
+    template<typename Op>
+    void for_each(Op&& op) const {
+        for (const auto& s : segs_) for (const auto& c : s) op(c);
+    }
 
     // lookup a cert given its thumbprint
-    const dctCert& get(const thumbPrint& tp) const { return certs_.at(tp); }
+    const storedCert& get(const thumbPrint& tp) const { return at(idx_.at(tp)); }
     const auto& operator[](const thumbPrint& tp) const { return get(tp); }
 
-    auto contains(const thumbPrint& tp) const noexcept { return certs_.contains(tp); }
+    auto contains(const thumbPrint& tp) const noexcept { return idx_.contains(tp); }
 
     // lookup the signing cert of 'data'
     const auto& operator[](rData data) const {
@@ -75,72 +138,103 @@ struct certStore {
         return get(tp);
     }
 
-    // lookup the (public) signing key of 'data'
-    auto signingKey(rData data) const {
+    // lookup the (public) signing key of 'data' (throws if its signing cert isn't in the store)
+    keyRef signingKey(rData data) const {
         const auto& tp = dctCert::getKeyLoc(data);
-        if (! dctCert::selfSigned(tp)) data = get(tp);
-        return data.content().rest();
+        if (dctCert::selfSigned(tp)) return data.content().rest();
+        return get(tp).pk_;
+    }
+
+    // the public key of cert 'tp' (nullptr if it's not in the store). Certs are never
+    // removed from the store so the pointer remains valid for the life of the store.
+    const keyRef* pubKey(const thumbPrint& tp) const noexcept {
+        auto i = idx_.find(tp);
+        return i != idx_.end()? &at(i->second).pk_ : nullptr;
     }
 
     const auto& key(const thumbPrint& tp) const { return key_.at(tp); }
     auto canSign(const thumbPrint& tp) const { return key_.contains(tp); }
 
-    auto finishAdd(auto it) {
-        if (it.second) {
-            const auto& [tp, cert] = *it.first;
-            addCb_(cert);
-        }
-        return it;
+    // the signing cert of 'c' (nullptr if 'c' is self-signed). A cert added before its
+    // signer is linked the first time its chain is walked.
+    const storedCert* signerOf(const storedCert& c) const {
+        if (c.signer_ == storedCert::selfSigned_) return nullptr;
+        if (c.signer_ == storedCert::unlinked) c.signer_ = idx_.at(c.getKeyLoc());
+        return &at(c.signer_);
     }
-    // Routines to add a cert to the store. The first two add non-signing certs.
-    // The third adds a signing cert with its secret key. If the thumbprint is
-    // already in the store, nothing is added or changed (since the thumbprint
-    // is a 1-1 mapping to its cert, it should be an error for the mapping
-    // to change but this is not currently checked).
-    // All return an <iterator,status> pair the points to the element added with
-    // 'status' true if the element was added and false if it was already there.
-    auto add(const dctCert& c) {
-        if (! c.valid()) {
-            print("cert {} invalid\n", c.name());
-            return std::pair<decltype(certs_)::iterator,bool>{certs_.end(), false};
+
+    // copy 'n' bytes at 'p' into the arena (certs bigger than a quarter chunk get their own)
+    const uint8_t* store(const uint8_t* p, size_t n) {
+        uint8_t* d;
+        if (n > chunkBytes / 4) {
+            // (goes before the chunk being filled so that stays last)
+            auto it = arena_.insert(arena_.end() - (used_ < chunkBytes? 1 : 0), std::make_unique_for_overwrite<uint8_t[]>(n));
+            d = it->get();
+            arenaBytes_ += n;
+        } else {
+            if (used_ + n > chunkBytes) {
+                arena_.emplace_back(std::make_unique_for_overwrite<uint8_t[]>(chunkBytes));
+                arenaBytes_ += chunkBytes;
+                used_ = 0;
+            }
+            d = arena_.back().get() + used_;
+            used_ += n;
         }
-        return finishAdd(certs_.try_emplace(c.computeThumbPrint(), c));
+        std::memcpy(d, p, n);
+        return d;
     }
-    auto add(dctCert&& c) {
+
+    std::pair<const storedCert*,bool> insert(const dctCert& c) {
         if (! c.valid()) {
             print("cert {} invalid\n", c.name());
-            return std::pair<decltype(certs_)::iterator,bool>{certs_.end(), false};
+            return {nullptr, false};
         }
-        return finishAdd(certs_.try_emplace(c.computeThumbPrint(), std::move(c)));
+        const auto& tp = c.computeThumbPrint();
+        if (auto i = idx_.find(tp); i != idx_.end()) return {&at(i->second), false};
+
+        rData r{c};
+        rData d{store(r.data(), r.size()), r.size()};
+        const auto& stp = c.getKeyLoc();
+        auto signer = dctCert::selfSigned(stp)? storedCert::selfSigned_ : storedCert::unlinked;
+        if (auto s = idx_.find(stp); s != idx_.end()) signer = s->second;
+        auto n = uint32_t(size());
+        if (n % segCerts == 0) segs_.emplace_back().reserve(segCerts);
+        const auto& sc = segs_.back().emplace_back(d, c, signer);
+        idx_.try_emplace(tp, n);
+        addCb_(c);
+        return {&sc, true};
     }
 
+    // Routines to add a cert to the store. The first two add non-signing certs.
+    // The third adds a signing cert with its secret key. If the thumbprint is
+    // already in the store, nothing is added or changed (since the thumbprint
+    // is a 1-1 mapping to its cert, it should be an error for the mapping
+    // to change but this is not currently checked).
+    // All return a <cert,status> pair pointing to the store's copy of the cert with
+    // 'status' true if it was added and false if it was already there.
+    // (The cert's bytes are copied to the arena so an rvalue cert isn't kept.)
+    auto add(const dctCert& c) { return insert(c); }
+    auto add(dctCert&& c) { return insert(c); }
+
     auto add(const dctCert& c, const keyVal& k) {
-        if (! c.valid()) {
-            print("cert {} invalid\n", c.name());
-            return std::pair<decltype(certs_)::iterator,bool>{certs_.end(), false};
-        }
-        auto it = finishAdd(certs_.try_emplace(c.computeThumbPrint(), c));
-        if (k.size() && it.second) {
-            const auto& [tp, cert] = *it.first;
-            key_.try_emplace(tp, k);
-        }
+        auto it = insert(c);
+        if (k.size() && it.second) key_.try_emplace(it.first->tp_, k);
         return it;
     }
 
+    // iterates over the signing chain starting with 'tp' (the chain's certs
+    // have to be in the store)
     struct chainIter {
-        const thumbPrint* tp_;
         const certStore& cs_;
+        const storedCert* c_;
 
-        chainIter(const thumbPrint& tp, const certStore& cs) : tp_{&tp}, cs_{cs} {}
-        constexpr bool operator!=(const thumbPrint& tp) const { return *tp_ != tp; }
-        constexpr void operator++() const { }
-        const auto& operator*() {
-            const auto& c = cs_[*tp_];
-            tp_ = &c.getKeyLoc();
-            return c;
-        }
-        constexpr auto& begin() const { return *this; }
-        constexpr auto& end() const { return ztp_; }
+        chainIter(const thumbPrint& tp, const certStore& cs)
+            : cs_{cs}, c_{dctCert::selfSigned(tp)? nullptr : &cs.get(tp)} {}
+        bool operator!=(std::default_sentinel_t) const noexcept { return c_ != nullptr; }
+        void operator++() { c_ = cs_.signerOf(*c_); }
+        const auto& operator*() const noexcept { return *c_; }
+        auto begin() const { return *this; }
+        auto end() const noexcept { return std::default_sentinel; }
     };
 
     // for the signing chain starting with 'tp', return the first element that satisfies 'pred'
@@ -151,32 +245,29 @@ struct certStore {
     }
 
     // construct a vector of the names of each cert in cert's signing chain.
-    certVec chainNames(const dctCert& cert) const {
+    certVec chainNames(rData cert) const {
         certVec cv{};
         cv.emplace_back(tlvVec{cert.name()});
-        for (const auto& c: chainIter(cert.getKeyLoc(),*this)) cv.emplace_back(tlvVec{c.name()});
+        for (const auto& c: chainIter(dctCert::getKeyLoc(cert), *this)) cv.emplace_back(tlvVec{c.name()});
         return cv;
     }
 
     // invoke 'Op' on every element of the cert chain starting with 'tp'
     template<typename Op>
     auto chain_for_each(const thumbPrint& tp, Op&& op) const {
-        const thumbPrint* t = &tp;
-        while (*t != ztp_) {
-            const auto& c = get(*t);
-            op(c);
-            t = &c.thumbprint();
-        }
+        for (const auto& c: chainIter(tp, *this)) op(c);
     }
 
     auto signingChain() const { return chains_.empty()? certVec{} : chainNames(get(chains_[0])); } //XXX
+    // the names of the signing chain whose signing cert is 'tp'
+    auto signingChain(const thumbPrint& tp) const { return chainNames(get(tp)); }
 
     // return the trust anchor thumbprint of signing chain 'idx'.
     const auto& trustAnchorTP(size_t idx) const {
         if (chains_.empty()) throw schema_error(format("trustAnchorTP: signing chain {} doesn't exist", idx));
-        const auto* ltp = &ztp_;
-        for (const auto* tp = &chains_[idx]; !dctCert::selfSigned(*tp); tp = &get(*tp).getKeyLoc()) { ltp = tp; }
-        return *ltp;
+        const auto* c = &get(chains_[idx]);
+        while (const auto* s = signerOf(*c)) c = s;
+        return c->tp_;
     }
 
     // for my signing chain in bootstrap
@@ -192,6 +283,14 @@ struct certStore {
         chainAddCb_(cert);
     }
     const auto& Chains() const { return chains_; }
+
+    // heap bytes held (see mem_report.hpp)
+    size_t heapBytes() const noexcept {
+        auto b = arenaBytes_ + mem::vec(arena_) + mem::vec(segs_) + idx_.heapBytes() + mem::hash(key_) + mem::vec(chains_);
+        for (const auto& s : segs_) b += mem::vec(s);
+        for (const auto& [_, k] : key_) b += k.capacity();
+        return b;
+    }
 };
 
 } // namespace dct
@@ -0,0 +1,232 @@
+#ifndef COMPILED_SCHEMA_HPP
+#define COMPILED_SCHEMA_HPP
+#pragma once
+/*
+ * Support for pub builders & structural validators generated by 'schemaCompile -c'
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <span>
+#include <string_view>
+#include "buildpub.hpp"
+
+/*
+ * Given '-c file', schemaCompile writes a header with a struct for each of the
+ * schema's publications holding its tags and templates as constexpr tables, e.g.:
+ *
+ *   struct msgs {
+ *       static constexpr std::string_view name{"#msgs"};
+ *       struct tag { enum : uint8_t { _network, _domain, target, topic, trgtLvl, _roleId, _ts }; };
+ *       static constexpr std::array<std::string_view,7> tags{ ... };
+ *       static constexpr dct::cschema::cComp t0_[]{ ... };
+ *       static constexpr std::array<dct::cschema::cTmplt,2> tmplts{ ... };
+ *       using Params = std::array<dct::paramVal,tags.size()>;
+ *   };
+ *
+ * A pub's parameters (and the components it gets from its signing chain) are
+ * set by tag so a misspelled tag is a compile error rather than a run-time
+ * schema_error, and the template selection & matching below are constexpr so
+ * a build with literal parameter values can be checked by a static_assert.
+ * The templates are fixed when the firmware is compiled: there's no token map,
+ * string table or per-component type dispatch at run time.
+ *
+ * The structural check is the schema's literal & discriminator constraints.
+ * Components set from the signing chain (correspondences) take any value: they're
+ * checked when the chain is validated, as they are for the binary schema. *
+ * mismatch<Pub>() compares a generated struct with the binary schema an app was
+ * given (e.g., examples/loadgen/load_schema.hpp is checked by 'chk_schema load.scm').
+ */
+
+namespace dct::cschema {
+
+enum class cKind : uint8_t { lit, param, cor, call, anon };
+
+// one template component: a literal value, a parameter or correspondence (filled
+// from the Params entry of its component index) or a 'call' (val is its name)
+struct cComp {
+    cKind kind;
+    std::string_view val{};
+};
+
+struct cTmplt {
+    std::span<const cComp> comp;
+    uint8_t dpar{bschema::maxTok};          // component index of the distinguishing param
+    std::span<const std::string_view> dval{};   // its values (empty = any value)
+    bschema::chainBM chains{};              // signing chains that can use this template
+};
+
+static constexpr bschema::chainBM anyChain = 0xff;
+
+// names of the schema's 'call' functions in the order schemaCompile numbers them
+static constexpr std::array<std::string_view,6> callName{ "timestamp", "sysId", "pid", "host", "uid", "seq" };
+
+// does template 't' accept the component values 'c' for a pub signed by one of 'chains'?
+// (the value of each component is checked and the results and-ed rather than stopping
+// at the first mismatch)
+static constexpr bool accepts(const cTmplt& t, std::span<const std::string_view> c, bschema::chainBM chains = anyChain) noexcept {
+    if (c.size() != t.comp.size() || (t.chains & chains) == 0) return false;
+    bool ok{true};
+    for (size_t i = 0; i < c.size(); ++i) ok &= t.comp[i].kind != cKind::lit || t.comp[i].val == c[i];
+    if (t.dpar < c.size() && ! t.dval.empty()) ok &= std::ranges::find(t.dval, c[t.dpar]) != t.dval.end();
+    return ok;
+}
+
+// index of the first of 'Pub's templates that accepts 'c' or -1 if none do
+template<typename Pub>
+static constexpr int select(std::span<const std::string_view> c, bschema::chainBM chains = anyChain) noexcept {
+    for (size_t i = 0; i < Pub::tmplts.size(); ++i) if (accepts(Pub::tmplts[i], c, chains)) return i;
+    return -1;
+}
+
+// structural validation of a pub name that arrived signed by one of 'chains'
+template<typename Pub>
+static bool validate(const rName& name, bschema::chainBM chains = anyChain) noexcept {
+    std::array<std::string_view,Pub::tags.size()> c{};
+    size_t n{};
+    try {
+        for (tlvParser nm{name}; ! nm.eof(); ) {
+            if (n >= c.size()) return false;
+            c[n++] = nm.nextBlk().toSv();
+        }
+    } catch (const std::exception&) { return false; }
+    return n == c.size() && select<Pub>(c, chains) >= 0;
+}
+
+/*
+ * Build a pub name from 'par' (indexed by Pub::tag) with the first template usable by
+ * 'chains' whose literals and discriminator match the supplied values and that has
+ * a value for each of its parameters & correspondences (components whose template
+ * value is a literal don't have to be supplied). Throws schema_error if there's none.
+ */
+template<typename Pub>
+static crName build(const typename Pub::Params& par, bschema::chainBM chains = anyChain) {
+    std::array<std::string,Pub::tags.size()> s{};
+    std::array<std::string_view,Pub::tags.size()> c{};
+    for (size_t i = 0; i < c.size(); ++i) if (par[i].index() != 0) s[i] = format("{}", par[i]);
+    int ti{-1};
+    for (size_t i = 0; i < Pub::tmplts.size() && ti < 0; ++i) {
+        const auto& t = Pub::tmplts[i].comp;
+        bool ok{true};
+        for (size_t j = 0; j < c.size(); ++j) {
+            c[j] = {};
+            if (par[j].index() != 0) c[j] = s[j];
+            else if (t[j].kind == cKind::lit) c[j] = t[j].val;
+            else ok &= t[j].kind == cKind::call;
+        }
+        if (ok && accepts(Pub::tmplts[i], c, chains)) ti = i;
+    }
+    if (ti < 0) throw schema_error(format("no {} template matches (or a param is missing)", Pub::name));
+
+    crName res{};
+    const auto& t = Pub::tmplts[ti].comp;
+    for (size_t i = 0; i < t.size(); ++i) {
+        switch (t[i].kind) {
+        case cKind::lit: res = std::move(res) / t[i].val; break;
+        case cKind::param:
+        case cKind::cor:
+            res = std::visit(overloaded {
+                            [&res](std::monostate) { return std::move(res) / "(empty)"; },
+                            [&res](const auto& val) { return std::move(res) / val; },
+                        }, par[i]);
+            break;
+        case cKind::call:
+            if (t[i].val == "timestamp") res = std::move(res) / std::chrono::system_clock::now();
+            else if (t[i].val == "sysId") res = std::move(res) / sysID();
+            else throw schema_error(format("unsupported call {} in {}", t[i].val, Pub::name));
+            break;
+        case cKind::anon: throw schema_error(format("{} component {} has no value", Pub::name, i));
+        }
+    }
+    return res;
+}
+
+/*
+ * Check that 'Pub' describes the same pub as binary schema 'bs': the same tags and,
+ * for each of the schema's discriminators, a template with the same components,
+ * distinguishing param & values usable by the same signing chains. Returns an empty
+ * string if it does, otherwise a description of the first difference. A header
+ * compiled into an app is fixed when it's built so this catches one that's stale
+ * relative to the schema the app was given.
+ */
+template<typename Pub>
+static std::string mismatch(const bschema::bSchema& bs) {
+    using namespace bschema;
+    pubidx pi;
+    try { pi = bs.findPub(Pub::name); } catch (const schema_error& e) { return e.what(); }
+    const auto& p = bs.pub_[pi];
+    const auto& tag = bs.tag_[p.tag];
+    if (tag.size() != Pub::tags.size())
+        return format("{} has {} tags in the schema but {} compiled", Pub::name, tag.size(), Pub::tags.size());
+    for (size_t i = 0; i < tag.size(); ++i) {
+        if (bs.tok_[tag[i]] != Pub::tags[i])
+            return format("{} tag {} is {} in the schema but {} compiled", Pub::name, i, bs.tok_[tag[i]], Pub::tags[i]);
+    }
+    // does compiled component 'c' say the same thing as schema template component 'b'?
+    auto sameComp = [&bs](const cComp& c, bComp b) {
+        switch (c.kind) {
+        case cKind::lit: return b < SC_PARAM && b < bs.tok_.size() && bs.tok_[b] == c.val;
+        case cKind::param: return (b & 0xe0) == SC_PARAM;
+        case cKind::cor: return (b & 0xe0) == SC_COR;
+        case cKind::call: return (b & 0xe0) == SC_CALL && (b & SC_VALUE) < callName.size() && callName[b & SC_VALUE] == c.val;
+        case cKind::anon: return b == SC_ANON;
+        }
+        return false;
+    };
+    auto sameDiscrim = [&bs,&sameComp](const cTmplt& t, const tDiscrim& d) {
+        const auto& tm = bs.tmplt_[d.tmpl];
+        if (tm.size() != t.comp.size() || d.disc != t.dpar) return false;
+        for (size_t i = 0; i < tm.size(); ++i) if (! sameComp(t.comp[i], tm[i])) return false;
+        bName vals{};
+        if (d.vl & 0x80) vals = bs.vlist_[d.vl & 0x7f];
+        else if (d.vl != 0) vals.emplace_back(d.vl);
+        if (vals.size() != t.dval.size()) return false;
+        for (auto v : vals) if (v >= bs.tok_.size() || std::ranges::find(t.dval, bs.tok_[v]) == t.dval.end()) return false;
+        return true;
+    };
+    // a compiled template covers all the schema discriminators that differ only in
+    // their correspondences so its chains are the union of theirs
+    discBM found{};
+    for (size_t i = 0; i < Pub::tmplts.size(); ++i) {
+        const auto& t = Pub::tmplts[i];
+        bool matched{};
+        chainBM cbm{};
+        for (auto d = p.d; d != 0; d &= d - 1) {
+            auto di = std::countr_zero(d);
+            if (! sameDiscrim(t, bs.discrim_[di])) continue;
+            matched = true;
+            cbm |= bs.discrim_[di].cbm;
+            found |= discBM(1) << di;
+        }
+        if (! matched) return format("{} template {} isn't in the schema", Pub::name, i);
+        if (cbm != t.chains)
+            return format("{} template {} has chains {:02x} in the schema but {:02x} compiled", Pub::name, i, cbm, t.chains);
+    }
+    if (found != p.d) return format("{} has schema templates that aren't compiled", Pub::name);
+    return {};
+}
+
+} // namespace dct::cschema
+
+#endif // COMPILED_SCHEMA_HPP
@@ -77,6 +77,8 @@ struct crTLV : rView {
         } else {
             rView::m_blk = decltype(rView::m_blk){v_.data() + hoff, len + hsz};
             rView::m_off = hsz;
+            // the contents may have changed so drop any block index (see rData::indexBlks)
+            if constexpr (std::is_base_of_v<rData,rView>) rView::blk_ = {};
         }
     }
 
@@ -118,6 +120,15 @@ struct crTLV : rView {
 
     constexpr crTLV() : v_(thisTLV != tlv::Name? 4:8) { }
 
+    // an empty backing store with room for the outer tlv hdr and 'len' bytes of
+    // payload (for TLVs whose size is known in advance so they're built with one allocation)
+    static auto presized(size_t len) {
+        std::vector<uint8_t> v{};
+        v.reserve(len + 4);
+        v.resize(4);
+        return v;
+    }
+
     // constructor debugging
     crTLV(const crTLV& c) : v_{c.v_} {
         //print("{}cp {}\n", tlvNum(), v_.size());
@@ -210,6 +221,13 @@ struct crTLV : rView {
         return *this;
     }
 
+    // empty this tlv but keep its storage so it can be rebuilt without allocating
+    constexpr auto& clear() noexcept {
+        v_.assign(thisTLV != tlv::Name? 4:8, 0);
+        static_cast<rView&>(*this) = rView{};
+        return *this;
+    }
+
     // the following routines figure out in advance how big the tlv
     // is going to be and pre-allocate the space.
 
@@ -317,11 +335,27 @@ struct crPrefix : crTLV<rPrefix,tlv::Name> {
 };
 
 struct crInterest : crTLV<rInterest,tlv::Interest> {
+    // the nonce is fixed-format so it's copied from a skeleton (see tlvValOff) then set
+    static constexpr auto nonceSkel = TLV<tlv::Nonce>(std::array<uint8_t,4>{});
+    static constexpr size_t nonceOff = tlvValOff(nonceSkel, {tlv::Nonce});
+
     crInterest(crName&& n, std::chrono::milliseconds lt, uint32_t non = rand32()) : crTLV{std::move(n)} {
-        append(tlv::Nonce, std::array{uint8_t(non), uint8_t(non >> 8), uint8_t(non >> 16), uint8_t(non >> 24)});
+        v_.reserve(v_.size() + nonceSkel.size() + 2 + sizeof(uint64_t));  // (the most lifetime can take)
+        auto off = v_.size() + nonceOff;
+        append(nonceSkel);
+        v_[off] = non; v_[off+1] = non >> 8; v_[off+2] = non >> 16; v_[off+3] = non >> 24;
         append(tlv::InterestLifetime, lt.count());
         done();
     }
+
+    // replace the interest's nonce in place (so a cached interest can be re-expressed)
+    using rInterest::nonce;
+    auto& nonce(uint32_t non) {
+        auto n = tlvParser(*this).findBlk(tlv::Nonce).rest();
+        auto off = n.data() - v_.data();
+        v_[off] = non; v_[off+1] = non >> 8; v_[off+2] = non >> 16; v_[off+3] = non >> 24;
+        return *this;
+    }
 };
 
 struct crData : crTLV<rData,tlv::Data> {
@@ -332,6 +366,12 @@ struct crData : crTLV<rData,tlv::Data> {
     crData(rData d) : crTLV(d) { }
     crData(crName&& n, tlv typ=tlv::ContentType_Blob) : crTLV{std::move(n)} { init(typ); }
     crData(rName n, tlv typ=tlv::ContentType_Blob) { append(n.asSpan()); init(typ); }
+    // 'extra' is the space needed for everything after the name (MetaInfo, Content,
+    // SignatureInfo & SignatureValue) so the Data can be completed and signed in place.
+    crData(const crName& n, size_t extra, tlv typ=tlv::ContentType_Blob) : crTLV{presized(n.asSpan().size() + extra)} {
+        append(n.asSpan());
+        init(typ);
+    }
 
     auto content() const { return rData::content(); }
 
@@ -62,13 +62,6 @@
 #include "../sigmgrs/sigmgr.hpp"
 #include "crpacket.hpp"
 
-// XXX would be nice if std:array had its own hash specialization
-template<> struct std::hash<dct::thumbPrint> {
-    size_t operator()(const dct::thumbPrint& tp) const noexcept {
-        return std::hash<std::u8string_view>{}({(char8_t*)tp.data(), tp.size()});
-    }
-};
-
 namespace dct {
 
 struct dctCert : crCert {
@@ -78,8 +71,27 @@ struct dctCert : crCert {
     using seconds = std::chrono::seconds;
     using days = std::chrono::days;
 
+    using validTime = date::sys_time<std::chrono::microseconds>;
+
+    // the cert's validity period, parsed once when the cert is constructed. A cert
+    // without a well-formed DCT sigInfo gets an empty period (so is never valid).
+    validTime validAfter_{validTime::max()};
+    validTime validUntil_{validTime::min()};
+
+    void setValidity() {
+        rCert c{*this};
+        if (! c.validForm()) return;
+        validAfter_ = c.validAfter();
+        validUntil_ = c.validUntil();
+    }
+
+    // the cert's thumbprint, computed once when the cert is constructed
+    thumbPrint tp_{};
+
     constexpr dctCert() = default;
-    dctCert(rCert d) : crCert(d) { }
+    dctCert(rCert d) : crCert(d), tp_{computeThumbPrint(d)} { setValidity(); }
+    // for a cert whose thumbprint is already known
+    dctCert(rCert d, const thumbPrint& tp) : crCert(d), tp_{tp} { setValidity(); }
 
     static constexpr auto keyId(keyRef pk) {
         // key ID is a 4-byte hash of the public key.
@@ -102,6 +114,8 @@ struct dctCert : crCert {
         sigInfo.insert(sigInfo.end(), vp.begin(), vp.end());
         sigInfo[1] += vp.size();
         if (! sm.sign(*this, sigInfo)) exit(1);
+        tp_ = computeThumbPrint(*this);
+        setValidity();
     }
 
     dctCert(crName&& name, keyRef pk, SigMgr& sm)
@@ -132,11 +146,22 @@ struct dctCert : crCert {
 
     auto selfSigned() const { return selfSigned(getKeyLoc()); }
 
-    thumbPrint computeThumbPrint() const { return computeThumbPrint(*this); }
+    // (the thumbprint is computed when the cert is made so this doesn't hash anything)
+    const thumbPrint& computeThumbPrint() const noexcept { return tp_; }
 
     // return the 'signature type' (tlv 27) byte of 'data'
     static inline auto getSigType(rData data) { return data.sigType(); }
     auto getSigType() const { return getSigType(*this); }
+
+    auto validAfter() const noexcept { return validAfter_; }
+    auto validUntil() const noexcept { return validUntil_; }
+
+    // check that 'tp' is within the cert's validity period (at the one second
+    // granularity of the period's encoding and allowing for the coarse clock's lag
+    // on the NotBefore side)
+    bool validAt(systime tp = coarseClock::now()) const noexcept {
+        return validAfter_ <= tp + coarseClock::resolution() && std::chrono::floor<seconds>(tp) <= validUntil_;
+    }
 };
 
 } // namespace dct
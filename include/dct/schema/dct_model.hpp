@@ -27,6 +27,8 @@
 
 #include <algorithm>
 #include <functional>
+#include <map>
+#include <memory>
 #include <string_view>
 #include <set>
 #include <unordered_map>
@@ -35,6 +37,7 @@
 #include "certstore.hpp"
 #include "dct/format.hpp"
 #include "dct/utility.hpp"
+#include "pending_certs.hpp"
 #include "validate_bootstrap.hpp"
 #include "validate_pub.hpp"
 #include "dct/distributors/dist_cert.hpp"
@@ -48,8 +51,9 @@ namespace dct {
 //template<typename sPub>
 struct DCTmodel {
     certStore cs_{};        // certificates used by this model instance
-    std::unordered_multimap<thumbPrint,dctCert> pending_{};
+    pendingCerts pending_{};  // certs waiting for their signing cert to arrive
     const bSchema& bs_;     // trust schema for this model instance
+    schemaShared& shared_;  // chain validation & pub validators shared with models using bs_
     pubBldr<false> bld_;    // publication builder/verifier
     SigMgrAny psm_;         // publication signing/validation
     SigMgrAny csm_;         // cert signing/validation (XXXX currently limited to EdDSA)
@@ -63,6 +67,19 @@ struct DCTmodel {
     DistGKey* m_pgkd{};      // pubs group key distributor (if needed)
     DistSGKey* m_psgkd{};    // pubs subscriber group key distributor (if needed)
     tpToValidator pv_{};    // map signer thumbprint to pub structural validator
+    DirectFace& face_;
+    // optional sharding of pubs into per-topic collections (see shardBy())
+    size_t shardComp_{};    // index of the pub name component that selects the shard (0 = none)
+    std::map<std::string,std::unique_ptr<SyncPS>,std::less<>> shards_{};
+    std::vector<std::pair<crPrefix,SubCb>> allShardSubs_{}; // subscriptions that span shards
+    size_t valThreads_{};   // cAdd validation threads per pub collection (see validateThreads())
+    std::shared_ptr<CryptoPool> crypto_{}; // optional threads for pub signing & validation (see cryptoThreads())
+    std::shared_ptr<PubCodec> codec_{}; // optional pub content compression (see compression())
+    std::unique_ptr<PubQueue> pubQ_{}; // optional queue of pubs from app threads (see publishQueue())
+    std::optional<ValidateLimiter::Params> limits_{}; // optional per-signer validation limits (see validateLimits())
+    std::optional<SignerQuota::Params> quota_{}; // optional per-signer pub quotas (see signerQuota())
+    std::string snapDir_{}; // directory for collection snapshots (empty = none)
+    bool started_{false};   // pub collection(s) started
 
     SigMgr& wireSigMgr() { return wsm_.ref(); }
     SigMgr& pubSigMgr() { return psm_.ref(); }
@@ -75,28 +92,47 @@ struct DCTmodel {
 
     const auto& certs() const { return cs_; }
 
-    bool isSigningCert(const dctCert& cert) const {
+    bool isSigningCert(rData cert) const {
         // signing certs are the first item each signing chain so go through
         // all the chains and see if the first item matches 'cert'
+        auto nm = tlvVec{cert.name()};
         for (const auto& chn : bs_.chain_) {
             if (chn.size() == 0) continue;
-            if (matches(bs_, cert.name(), chn[0])) return true;
+            if (matches(bs_, nm, chn[0])) return true;
         }
         return false;
     }
 
+    // sigmgrs that derive per-publisher keys (PPAEAD, PPSIGN) are told of each new
+    // signing cert so they can do it before that publisher's first packet arrives.
+    void addSigner(rData cert, const thumbPrint& tp) {
+        const bool sg = pubSigMgr().subscriberGroup() || wireSigMgr().subscriberGroup();
+        const bool km = (m_gkd && m_gkd->m_keyMaker) || (m_sgkd && m_sgkd->m_keyMaker) ||
+                        (m_pgkd && m_pgkd->m_keyMaker) || (m_psgkd && m_psgkd->m_keyMaker);
+        if (! (sg || km) || ! isSigningCert(cert)) return;
+        // keymakers convert a new peer's key for sealing group keys once, here
+        if (km) {
+            if (m_gkd) m_gkd->signerAdded(tp);
+            if (m_sgkd) m_sgkd->signerAdded(tp);
+            if (m_pgkd) m_pgkd->signerAdded(tp);
+            if (m_psgkd) m_psgkd->signerAdded(tp);
+        }
+        if (! sg) return;
+        auto pk = cert.content().rest();
+        pubSigMgr().addSigner(tp, pk);
+        wireSigMgr().addSigner(tp, pk);
+    }
+
     // setup the information needed to validate pubs signed with the cert
     // associated with 'tp' which is the head of schema signing chain 'chain'.
     void setupPubValidator(const thumbPrint& tp) {
-        //XXX this is a hack and should be refactored
-        // Make a temporary builder to construct the pub templates associated
-        // with this signing chain. To do this we need a *copy* of the current
-        // certstore with its signing chain 0 set to 'tp'.
-        certStore cs = cs_;
-        cs.chains_[0] = tp;
-        pubBldr bld(bs_, cs, bs_.pubName(0));
-        pv_.emplace(tp, pubValidator(std::move(bld.pt_), std::move(bld.ptm_),
-                                     std::move(bld.ptok_), std::move(bld.pstab_)));
+        // If no model with this schema has one, make a temporary builder to
+        // construct the pub templates associated with this signing chain.
+        pv_.emplace(tp, shared_.validator(tp, [this, &tp] {
+                        pubBldr bld(bs_, cs_, tp, bs_.pubName(0));
+                        return pubValidator(bs_, std::move(bld.pt_), std::move(bld.ptm_),
+                                            std::move(bld.ptok_), std::move(bld.pstab_));
+                    }));
     }
 
     // Check if newly added cert 'tp' allows validation of pending cert(s)
@@ -104,21 +140,19 @@ struct DCTmodel {
     // so this routine can get called recursively but the recursion depth
     // should be at most the schema's max signing chain length - 2.
     void checkPendingCerts(const dctCert& cert, const thumbPrint& tp) {
-        auto [b, e] = pending_.equal_range(tp);
-        if (b == e) return;
-        std::vector<dctCert> pv{};
-        for (auto i = b; i != e; ++i) {
-            if (certSigMgr().validate(i->second, cert)) pv.emplace_back(std::move(i->second));
+        if (! pending_.waitingFor(tp)) return;
+        for (const auto& p : pending_.take(tp)) {
+            if (certSigMgr().validate(p, cert)) addCert(p);
         }
-        pending_.erase(tp);
-        for (auto p : pv) addCert(p);
     }
 
     // Cryptographically and structurally validate a cert before adding it to the
-    // cert store. Since certs can arrive in any order, a small number of certs
-    // are held pending their signing cert's arrival.
-    void addCert(rData d) {
-        const auto tp = dctCert::computeThumbPrint(d);
+    // cert store. Since certs can arrive in any order, a bounded number of certs
+    // are held pending their signing cert's arrival (see pending_certs.hpp).
+    void addCert(rData d) { addCert(d, dctCert::computeThumbPrint(d)); }
+    void addCert(const dctCert& c) { addCert(c, c.computeThumbPrint()); }
+
+    void addCert(rData d, const thumbPrint& tp) {
         if (cs_.contains(tp)) return;
         // check if cert is consistent with the schema:
         //  - cert metainfo must say it's a key
@@ -141,28 +175,27 @@ struct DCTmodel {
             if (cname.size() >= 7 && cname[-6].toSv() == "schema") return; // can't add new schema
  
             // cert is structurally ok so see if it crytographically validates
+            dctCert dc{cert, tp};
             if (! cs_.contains(stp)) {
-                // don't have cert's signing cert - check it when that arrives
-                if (pending_.size() > 64) {
-                    // XXX too many pending certs - drop something
-                } 
-                pending_.emplace(stp, cert);
+                // don't have cert's signing cert - check it when that arrives. If nothing
+                // else is waiting on that signer, ask peers for what we're missing.
+                if (pending_.add(stp, tp, std::move(dc))) m_ckd.requestMissing();
                 return;
             }
             if (! certSigMgr().validate(cert, cs_[stp])) return;
 
-            if (isSigningCert(cert)) {
+            if (isSigningCert(dc)) {
                 // we validated a signing cert which means we have its entire chain
                 // in the certstore so we can validate all the names in the chain
                 // against the schema. If the chain is ok, set up structural validation
                 // state for pubs signed with this thumbprint.
-                if (validateChain(bs_, cs_, cert) < 0) return; // chain structure invalid
-                cs_.add(cert);
+                if (shared_.validateChain(bs_, cs_, dc) < 0) return; // chain structure invalid
+                cs_.add(std::move(dc));
                 setupPubValidator(tp);
                 return; // done since nothing can be pending on a signing cert
             }
-            cs_.add(cert);
-            checkPendingCerts(cert, tp);
+            cs_.add(dc);
+            checkPendingCerts(dc, tp);
         } catch (const std::exception&) {};
     }
 
@@ -173,7 +206,7 @@ struct DCTmodel {
         auto sp = spCb();       //new signing key pair
         auto sc = sp.first;     // public cert of pair
         auto now = std::chrono::system_clock::now();
-        auto nt = rCert(sc).validUntil() - 10s;   // reschedule before expiration time
+        auto nt = sc.validUntil() - 10s;   // reschedule before expiration time
         if (nt <= now)
             std::runtime_error("getNewSP was handed an expired cert");
         auto time = std::chrono::duration_cast<std::chrono::microseconds>(nt-now);
@@ -183,7 +216,7 @@ struct DCTmodel {
             auto sc = sp.first;
             cs_.add(sc, sp.second);   //add this signing cert
             // make it a signing chain head
-            if (validateChain(bs_, cs_, sc) < 0) throw schema_error(format("cert {} signing chain invalid", sc.name()));
+            if (shared_.validateChain(bs_, cs_, sc) < 0) throw schema_error(format("cert {} signing chain invalid", sc.name()));
             cs_.insertChain(sc);
             // pass new signing pair to sigmgrs and distributors
             pubSigMgr().updateSigningKey(sp.second, sc);
@@ -196,9 +229,9 @@ struct DCTmodel {
             else if (m_psgkd) m_psgkd->updateSigningKey(sp.second, sc);
         };
 
-        if (rCert(sc).validAfter() > now) {
+        if (sc.validAfter() > now) {
             // schedule usage of the new pair once validity period starts
-            auto time = rCert(sc).validAfter() - now;
+            auto time = sc.validAfter() - now;
             auto timeMillis = std::chrono::duration_cast<std::chrono::milliseconds>(time);
             oneTime(timeMillis, [addKP,sp] { addKP(sp); } );
         } else
@@ -210,6 +243,7 @@ struct DCTmodel {
     // optional string for face name
     DCTmodel(const certCb& rootCb, const certCb& schemaCb, const chainCb& idChainCb, const pairCb& signIdCb, DirectFace& face = defaultFace()) :
             bs_{validateBootstrap(rootCb, schemaCb, idChainCb, signIdCb, cs_)},
+            shared_{schemaShared::get(bs_)},
             bld_{pubBldr(bs_, cs_, bs_.pubName(0))},
             psm_{getSigMgr(bs_)},
             csm_{getCertSigMgr(bs_)},
@@ -217,17 +251,26 @@ struct DCTmodel {
             syncSm_{psm_.ref(), bs_, pv_},
             m_sync{face, wirePrefix()/"pubs", wireSigMgr(), syncSm_},
             m_ckd{ face, pubPrefix(), wirePrefix()/"cert",
-                   [this](auto cert){ addCert(cert);},  [](auto /*p*/){return false;} }
+                   [this](auto cert){ addCert(cert);},  [](auto /*p*/){return false;} },
+            face_{face}
     {
+        // the schema can declare a pub name tag whose value shards the pub collection
+        if (std::ranges::any_of(bs_.pub_, [this](const auto& p){ return bs_.tok_[p.pub] == "#shardTag"; }))
+            shardBy(bs_.pubVal("#shardTag").substr(1));
+
         // pub sync session is started after distributor(s) have completed their setup
         m_sync.autoStart(false);
-        if(wsm_.ref().encryptsContent()) {
+        m_sync.pubPrefix(pubPrefix());
+        // a schema with a KT capability cert has its symmetric group keys distributed via a key tree
+        const bool keyTree = matchesAny(bs_, pubPrefix()/"CAP"/"KT"/"_"/"KEY"/"_"/"dct"/"_") >= 0;
+        if(wsm_.ref().encryptsContent() || wsm_.ref().groupKey()) {
             if (matchesAny(bs_, pubPrefix()/"CAP"/"KM"/"_"/"KEY"/"_"/"dct"/"_") < 0) {
-                throw schema_error("Encrypted CAdds require that some entity(s) have KeyMaker capability");
+                throw schema_error("Encrypted or group keyed CAdds require that some entity(s) have KeyMaker capability");
             }
             if (! wsm_.ref().subscriberGroup()) {
                 m_gkd = new DistGKey(face, pubPrefix(), wirePrefix()/"keys"/"pdus",
                              [this](auto gk, auto gkt){ wsm_.ref().addKey(gk, gkt);}, certs());
+                if (keyTree) m_gkd->useKeyTree();
             } else {
                 if (matchesAny(bs_, pubPrefix()/"CAP"/"SG"/"_"/"KEY"/"_"/"dct"/"_") < 0) {
                     // schema doesn't contain an SG member so PP won't work XXXX should extract name of group from schema
@@ -238,6 +281,8 @@ struct DCTmodel {
             }
         }
         //encryption methods for pubs MUST be signed versions
+        if (psm_.ref().groupKey() && ! psm_.ref().encryptsContent())
+            throw schema_error("pubs must be signed by their originator so can't use a group key MAC");
         if(psm_.ref().encryptsContent()) {
             if (matchesAny(bs_, pubPrefix()/"CAP"/"KMP"/"_"/"KEY"/"_"/"dct"/"_") < 0) {
                 // schema doesn't contain a "KeyMaker" capability cert so AEAD won't work
@@ -254,13 +299,16 @@ struct DCTmodel {
             } else {
                 m_pgkd = new DistGKey(face, pubPrefix(), wirePrefix()/"keys"/"pubs",
                              [this](auto gk, auto gkt){ psm_.ref().addKey(gk, gkt);}, certs());
+                if (keyTree) m_pgkd->useKeyTree();
             }
         }
 
         // cert distributor needs a callback when cert added to certstore.
-        cs_.addCb_ = [&ckd=m_ckd] (const dctCert& cert) { ckd.publishCert(cert); };
+        cs_.addCb_ = [this, &ckd=m_ckd] (const dctCert& cert) { ckd.publishCert(cert); addSigner(cert, cert.computeThumbPrint()); };
 
-        for (const auto& [tp, cert] : cs_) m_ckd.initialPub(cert);
+        std::vector<rData> boot{};
+        cs_.for_each([this, &boot](const auto& cert) { boot.emplace_back(cert); addSigner(cert, cert.computeThumbPrint()); });
+        m_ckd.initialPubs(boot);
 
         // pub and wire sigmgrs each need its signing key setup and its validator needs
         // a callback to return a public key given a cert thumbprint.
@@ -275,7 +323,7 @@ struct DCTmodel {
         _s2i = std::bind(&decltype(bld_)::index, bld_, std::placeholders::_1);
 
         // set up timer to request a new signing pair before this pair expires
-        auto time = std::chrono::duration_cast<std::chrono::microseconds>(rCert(cs_[tp]).validUntil() - std::chrono::system_clock::now() - 10s);
+        auto time = std::chrono::duration_cast<std::chrono::microseconds>(cs_[tp].validUntil() - std::chrono::system_clock::now() - 10s);
         oneTime(time , [this, signIdCb] {getNewSP(signIdCb);});    //schedule re-keying
     }
 
@@ -283,27 +331,274 @@ struct DCTmodel {
  
     auto run() { m_sync.run(); };
     auto stop() { m_sync.stop(); };
+    // spin for up to 'spin' before blocking when idle (see DirectFace::busyPoll)
+    auto& busyPoll(std::chrono::microseconds spin, int sockUs = 50) { face_.busyPoll(spin, sockUs); return *this; }
+    // split pub delivery latency into network, queueing & processing time (see DirectFace::rxTimestamps)
+    bool rxTimestamps() { return face_.rxTimestamps(); }
+    // answer cStates only one peer sent by unicast (see DirectFace::unicastReplies)
+    bool unicastReplies() { return face_.unicastReplies(); }
 
     auto& subscribe(const Name& topic, SubCb&& cb) {
+        if (! spansShards(topic)) {
+            shard(topic).subscribe(crPrefix{topic}, std::move(cb));
+            return *this;
+        }
+        for (auto& [v, s] : shards_) s->subscribe(crPrefix{topic}, SubCb{cb});
+        allShardSubs_.emplace_back(crPrefix{topic}, cb);
         m_sync.subscribe(crPrefix{topic}, std::move(cb));
         return *this;
     }
     auto& unsubscribe(const Name& topic) {
+        if (! spansShards(topic)) {
+            shard(topic).unsubscribe(crPrefix{topic});
+            return *this;
+        }
+        for (auto& [v, s] : shards_) s->unsubscribe(crPrefix{topic});
+        std::erase_if(allShardSubs_, [t=rPrefix{topic}](const auto& s){ return rPrefix{s.first} == t; });
         m_sync.unsubscribe(crPrefix{topic});
         return *this;
     }
-    auto publish(Publication&& pub) { return m_sync.publish(std::move(pub)); }
+    // read-only, zero-copy scans of the active pubs under 'topic' in each shard it
+    // spans (see SyncPS::scanPubs: the views are only valid during the call to 'f')
+    template<typename F>
+    size_t scanPubs(const Name& topic, F&& f) {
+        return scanShards(topic, f, [](SyncPS& s, const rPrefix& p, auto&& g) { return s.scanPubs(p, g); });
+    }
+    template<typename F>
+    size_t scanPubs(const Name& topic, std::chrono::system_clock::time_point from,
+                    std::chrono::system_clock::time_point to, F&& f) {
+        return scanShards(topic, f, [from, to](SyncPS& s, const rPrefix& p, auto&& g) { return s.scanPubs(p, from, to, g); });
+    }
+    template<typename F>
+    size_t scanPubsBySigner(const Name& topic, const thumbPrint& tp, F&& f) {
+        return scanShards(topic, f, [&tp](SyncPS& s, const rPrefix& p, auto&& g) { return s.scanPubsBySigner(p, tp, g); });
+    }
+    auto publish(Publication&& pub) { return shard(pub.name()).publish(std::move(pub)); }
+
+    auto publish(Publication&& pub, DelivCb&& cb) { return shard(pub.name()).publish(std::move(pub), std::move(cb)); }
+    // publish a signed pub whose buffer is shared (e.g., relayed to several DeftTs)
+    auto publish(sharedPub&& pub) { return shard(pub.name()).publish(std::move(pub)); }
+    auto publish(sharedPub&& pub, DelivCb&& cb) { return shard(pub.name()).publish(std::move(pub), std::move(cb)); }
+    // publish a burst of pubs with one cState/cAdd pass per collection (the pubs are moved from)
+    size_t publishBatch(std::span<Publication> pubs) {
+        if (shardComp_ == 0) return m_sync.publishBatch(pubs);
+        std::map<SyncPS*,std::vector<Publication>> bs{};
+        for (auto& p : pubs) bs[&shard(p.name())].emplace_back(std::move(p));
+        size_t n{};
+        for (auto& [s, pv] : bs) n += s->publishBatch(pv);
+        return n;
+    }
+    auto& orderPub(OrderPubCb&& cb) {
+        for (auto& [v, s] : shards_) s->orderPubCb(OrderPubCb{cb});
+        m_sync.orderPubCb(std::move(cb));
+        return *this;
+    }
+    // resend other nodes' pubs peers are lacking after 'hold' (see SyncPS::relayPubs)
+    auto& relayPubs(std::chrono::milliseconds hold) {
+        for (auto& [v, s] : shards_) s->relayPubs(hold);
+        m_sync.relayPubs(hold);
+        return *this;
+    }
+    // send cState change logs rather than iblts on a single peer link (see SyncPS::neighborDeltas)
+    auto& neighborDeltas(bool on) {
+        for (auto& [v, s] : shards_) s->neighborDeltas(on);
+        m_sync.neighborDeltas(on);
+        return *this;
+    }
+    // priority class of each pub offered to peers (see PubPriorityCb in syncps.hpp)
+    auto& pubPriority(PubPriorityCb&& cb) {
+        for (auto& [v, s] : shards_) s->pubPriorityCb(PubPriorityCb{cb});
+        m_sync.pubPriorityCb(std::move(cb));
+        return *this;
+    }
+    // trace the lifecycle of the pubs in the pub collection(s) (see pub_trace.hpp)
+    auto& trace(TraceCb&& cb) {
+        for (auto& [v, s] : shards_) s->traceCb(TraceCb{cb});
+        m_sync.traceCb(std::move(cb));
+        return *this;
+    }
+    // estimated memory used by each of the model's subsystems (see mem_report.hpp).
+    // Call from the face's thread.
+    MemReport memoryReport() const {
+        MemReport r{};
+        m_sync.memUse(r);
+        for (const auto& [_, s] : shards_) s->memUse(r);
+        m_ckd.m_sync.memUse(r);
+        r.add("cert store", cs_.size(), cs_.heapBytes());
+        r.add("pending certs", pending_.size(), pending_.heapBytes());
+        r.add("pub validators", pv_.size(), mem::map(pv_));
+        if (m_gkd) m_gkd->memUse(r, "group key");
+        if (m_sgkd) m_sgkd->memUse(r, "subscriber group key");
+        if (m_pgkd) m_pgkd->memUse(r, "pub group key");
+        if (m_psgkd) m_psgkd->memUse(r, "pub subscriber group key");
+        face_.memUse(r);
+        return r;
+    }
+    auto& validateThreads(size_t n) {
+        valThreads_ = n;
+        m_sync.validateThreads(n);
+        for (auto& [v, s] : shards_) s->validateThreads(n);
+        return *this;
+    }
+    // sign (publishAsync) & validate pubs and seal group key rekeys on 'n' crypto threads
+    // concurrently with the io thread (0 = none). If 'cpus' isn't empty the threads are
+    // pinned to them (see crypto_pool.hpp).
+    auto& cryptoThreads(size_t n, const std::vector<int>& cpus = {}) {
+        crypto_ = n > 0? std::make_shared<CryptoPool>(face_.getIoContext(), n, cpus) : nullptr;
+        m_sync.cryptoPool(crypto_);
+        for (auto& [v, s] : shards_) s->cryptoPool(crypto_);
+        // group key distributors seal rekeys on it
+        if (m_gkd) m_gkd->cryptoPool(crypto_);
+        if (m_sgkd) m_sgkd->cryptoPool(crypto_);
+        if (m_pgkd) m_pgkd->cryptoPool(crypto_);
+        if (m_psgkd) m_psgkd->cryptoPool(crypto_);
+        return *this;
+    }
+    // the DeftT's executor (null if cryptoThreads wasn't called) for other work that
+    // shouldn't be on the io thread. Completions go to the face's io_context.
+    auto executor() const noexcept { return crypto_; }
+    /*
+     * Compress the content of pubs made by pub() & unsignedPub() when that makes it
+     * smaller and expand compressed pubs before delivering them so more small,
+     * repetitive pubs fit in a cAdd (see syncps/pub_codec.hpp). Dictionaries are added
+     * to the returned codec, e.g., 'compression().dictionary(topicPrefix, samples)'.
+     * Every member publishing or subscribing to compressed pubs has to turn this on
+     * and add the same dictionaries.
+     */
+    PubCodec& compression() {
+        if (! codec_) {
+            codec_ = std::make_shared<PubCodec>();
+            m_sync.pubCodec(codec_);
+            for (auto& [v, s] : shards_) s->pubCodec(codec_);
+        }
+        return *codec_;
+    }
+
+    // bound the cAdd & pub validation work done per signer & blacklist signers that keep failing
+    auto& validateLimits(const ValidateLimiter::Params& p) {
+        limits_ = p;
+        m_sync.validateLimits(p);
+        for (auto& [v, s] : shards_) s->validateLimits(p);
+        return *this;
+    }
+    // limit each signer's active pubs & share cAdds between signers (see syncps/signer_quota.hpp)
+    auto& signerQuota(const SignerQuota::Params& p) {
+        quota_ = p;
+        m_sync.signerQuota(p);
+        for (auto& [v, s] : shards_) s->signerQuota(p);
+        return *this;
+    }
+    // sign then publish 'pub' (built by unsignedPub()), signing on a crypto thread if there are any
+    void publishAsync(Publication&& pub) { shard(pub.name()).publishAsync(std::move(pub), pubSigMgr()); }
+    /*
+     * Accept pubs from app threads (see syncps/publish_queue.hpp). Call on the io thread
+     * before any thread calls publishQueued(). Worker threads build pubs themselves
+     * (pub() & unsignedPub() use the model's name builder so they're io thread only)
+     * and queue them signed or, with 'sign', to be signed with the model's pub signer.
+     * Queued pubs are published in batches (by publishBatch) on the io thread.
+     */
+    auto& publishQueue() {
+        pubQ_ = std::make_unique<PubQueue>(face_.getIoContext(),
+                    [this](std::vector<Publication>& signedPubs, std::span<Publication> unsignedPubs) {
+                        for (auto& p : unsignedPubs) {
+                            if (crypto_) publishAsync(std::move(p));
+                            else if (pubSigMgr().sign(p)) signedPubs.emplace_back(std::move(p));
+                        }
+                        publishBatch(signedPubs);
+                    });
+        return *this;
+    }
+    // (any thread) queue 'pub' for publication. Returns false if the queue is full or not set up.
+    bool publishQueued(Publication&& pub, bool sign = false) { return pubQ_ && pubQ_->push(std::move(pub), sign); }
+    // keep on-disk snapshots of the pub & cert collections in directory 'dir' so they're
+    // reloaded on restart rather than re-pulled from peers (call before starting)
+    auto& snapshot(const std::string& dir) {
+        snapDir_ = dir;
+        m_sync.snapshot(dir + "/pubs.snap");
+        for (auto& [v, s] : shards_) s->snapshot(dir + "/pubs-" + v + ".snap");
+        m_ckd.m_sync.snapshot(dir + "/certs.snap");
+        return *this;
+    }
+
+    /*
+     * Shard the pub collection by the value of pub name component 'tag'. Each value
+     * gets its own collection (named wirePrefix()/"pubs-<value>", a sibling of the
+     * main collection rather than under it, so a member without the shard never
+     * takes a shard's cState for one of its own) which is created when the value
+     * is first published or subscribed to so members only sync the shards they use
+     * and a busy shard doesn't crowd others out of cAdds. publish() and subscribe()
+     * are routed to the shard named by the pub or topic. A topic too short to
+     * include the tag applies to all the shards this member knows about (those
+     * it's used or declared via 'shards()'). Must be called before starting.
+     */
+    DCTmodel& shardBy(std::string_view tag) {
+        shardComp_ = bld_.index(tag);
+        return *this;
+    }
+    // create the shards for tag values 'vals' (e.g., so a subscription to all shards covers them)
+    auto& shards(const std::vector<std::string>& vals) {
+        for (const auto& v : vals) shardByValue(v);
+        return *this;
+    }
+
+    // return the collection that handles name 'n'
+    SyncPS& shard(rName n) {
+        if (shardComp_ == 0 || n.nBlks() <= shardComp_) return m_sync;
+        return shardByValue(n.nthBlk(shardComp_).toSv());
+    }
+    bool spansShards(rName topic) const { return shardComp_ != 0 && topic.nBlks() <= shardComp_; }
+
+    // do 'scan(syncps, prefix, g)' on each of the collections 'topic' spans, where 'g'
+    // calls 'f' until it asks to stop
+    template<typename F, typename Scan>
+    size_t scanShards(const Name& topic, F& f, Scan&& scan) {
+        rPrefix pfx{topic};
+        if (! spansShards(topic)) return scan(shard(topic), pfx, f);
+        bool more{true};
+        auto g = [&f, &more](const rPub& p) { return more = SyncPS::scanCall(f, p); };
+        auto n = scan(m_sync, pfx, g);
+        for (auto& [v, s] : shards_) if (more) n += scan(*s, pfx, g);
+        return n;
+    }
+
+    SyncPS& shardByValue(std::string_view v) {
+        if (auto s = shards_.find(v); s != shards_.end()) return *s->second;
+        auto& s = *shards_.emplace(std::string(v), std::make_unique<SyncPS>(face_, wirePrefix()/("pubs-" + std::string(v)),
+                                                        wireSigMgr(), syncSm_)).first->second;
+        s.autoStart(false);
+        s.pubPrefix(pubPrefix());
+        s.pubLifetime(m_sync.pubLifetime_);
+        s.orderPubCb(OrderPubCb{m_sync.orderPub_});
+        s.relayPubs(m_sync.relayHold_);
+        s.neighborDeltas(m_sync.deltas_);
+        s.pubPriorityCb(PubPriorityCb{m_sync.pubPriority_});
+        s.traceCb(TraceCb{m_sync.trace_});
+        s.validateThreads(valThreads_);
+        s.cryptoPool(crypto_);
+        s.pubCodec(codec_);
+        if (limits_) s.validateLimits(*limits_);
+        if (quota_) s.signerQuota(*quota_);
+        if (! snapDir_.empty()) s.snapshot(snapDir_ + "/pubs-" + std::string(v) + ".snap");
+        for (const auto& [t, cb] : allShardSubs_) s.subscribe(crPrefix{t}, SubCb{cb});
+        if (started_) s.start();
+        return s;
+    }
+
+    // start the pub collection(s) (done after the distributors have completed their setup)
+    void startSync() {
+        started_ = true;
+        m_sync.start();
+        for (auto& [v, s] : shards_) s->start();
+    }
 
-    auto publish(Publication&& pub, DelivCb&& cb) { return m_sync.publish(std::move(pub), std::move(cb)); }
-    auto orderPub(OrderPubCb&& cb) { return m_sync.orderPubCb(std::move(cb));}
     auto& pubLifetime(std::chrono::milliseconds t) {
+        for (auto& [v, s] : shards_) s->pubLifetime(t);
         m_sync.pubLifetime(t);
         return *this;    
     }
 
-    // Can be used by application to schedule a cancelable timer. Note that
-    // this is expensive compared to a oneTime timer and should be used
-    // only for timers that need to be canceled before they fire.
+    // Can be used by application to schedule a cancelable timer. The returned
+    // handle's cancel() stops the timer if it hasn't fired yet.
     auto schedule(std::chrono::microseconds delay, TimerCb&& cb) { return m_sync.schedule(delay, std::move(cb)); }
 
 
@@ -311,21 +606,46 @@ struct DCTmodel {
     template<typename... Rest> requires ((sizeof...(Rest) & 1) == 0)
     auto name(Rest&&... rest) { return bld_.name(std::forward<Rest>(rest)...); }
 
-    // construct a publication with the given content using rest of args to construct its name
+    // space needed after a pub's name for its MetaInfo, Content hdr, SignatureInfo and
+    // SignatureValue TLVs (at most 158 bytes, for AEADSGN & AESGCMSGN's 104 byte sigs).
+    static constexpr size_t pubOverhead = 160;
+
+    // make an unsigned pub named 'nm' with the given content (compressed if compression is
+    // on and that makes it smaller).
+    Publication makePub(const crName& nm, std::span<const uint8_t> content) {
+        if (codec_) {
+            if (auto c = codec_->compress(nm, content); c.size()) {
+                Publication pub(nm, c.size() + pubOverhead, tlv::ContentType_Compressed);
+                pub.content(c);
+                return pub;
+            }
+        }
+        Publication pub(nm, content.size() + pubOverhead);
+        pub.content(content);
+        return pub;
+    }
+
+    // construct a publication with the given content using rest of args to construct its name.
+    // The name is built in the pub builder's reusable buffer then copied into a Data sized
+    // for the content and signature so the pub is built and signed with one allocation.
     template<typename... Rest> requires ((sizeof...(Rest) & 1) == 0)
     auto pub(std::span<const uint8_t> content, Rest&&... rest) {
-        Publication pub(name(std::forward<Rest>(rest)...));
-        pub.content(content);
-        pubSigMgr().sign(pub);
+        auto pub = makePub(bld_.tmpName(std::forward<Rest>(rest)...), content);
+        psm_.sign(pub);
         return pub;
     }
 
+    // as pub() but the pub isn't signed (for publishAsync())
+    template<typename... Rest> requires ((sizeof...(Rest) & 1) == 0)
+    auto unsignedPub(std::span<const uint8_t> content, Rest&&... rest) {
+        return makePub(bld_.tmpName(std::forward<Rest>(rest)...), content);
+    }
+
     auto name(const std::vector<parItem>& pvec) { return bld_.name(pvec); }
 
     auto pub(std::span<const uint8_t> content, const std::vector<parItem>& pvec) {
-        Publication pub(name(pvec));
-        pub.content(content);
-        pubSigMgr().sign(pub);
+        auto pub = makePub(bld_.tmpName(pvec), content);
+        psm_.sign(pub);
         return pub;
     }
 
@@ -339,53 +659,36 @@ struct DCTmodel {
         auto pdu_dist = m_gkd == NULL? m_sgkd != NULL :  true;
         auto pub_dist = m_pgkd == NULL ? m_psgkd != NULL :  true;
         if (!pdu_dist && !pub_dist) {
-            m_ckd.setup([this,cb=std::move(cb)](bool c){ cb(c); m_sync.start(); });
+            m_ckd.setup([this,cb=std::move(cb)](bool c){ cb(c); startSync(); });
             return;
         }
 
-        // complete pdu key distribution before pub key distribution
-        if ( pdu_dist && !pub_dist ) {
-            m_ckd.setup([this, cb=std::move(cb)](bool c) mutable {
-                        if (!c) { cb(false); return; }
-                        if (m_gkd) {
-                            m_gkd->setup([this,cb=std::move(cb)](bool c){ cb(c); m_sync.start(); });
-                        } else { // must be m_sgkd
-                            m_sgkd->setup([this,cb=std::move(cb)](bool c){ cb(c); m_sync.start(); });
-                        }
-                    });
-            return;
-        } else  if ( !pdu_dist && pub_dist) {
-             m_ckd.setup([this, cb=std::move(cb)](bool c) mutable {
-                        if (!c) { cb(false); return; }
-                        if (m_pgkd) {
-                            m_pgkd->setup([this,cb=std::move(cb)](bool c){ cb(c); m_sync.start(); });
-                        } else { // must be m_psgkd
-                            m_psgkd->setup([this,cb=std::move(cb)](bool c){ cb(c); m_sync.start(); });
-                        }
-                    });
-            return;
-        } else {    //both pdus and pubs have a distributor
-           m_ckd.setup([this, cb=std::move(cb)](bool c) mutable {
-                        if (!c) { cb(false); return; }
-                        if (m_gkd) {
-                            m_gkd->setup([this,cb=std::move(cb)](bool c){
-                                if (!c) { cb(false); return; }  // check if pdu distributor returns false
-                                if (m_pgkd)
-                                    m_pgkd->setup([this,cb=std::move(cb)](bool c){ cb(c); m_sync.start(); });
-                                else    // must be m_psgkd
-                                    m_psgkd->setup([this,cb=std::move(cb)](bool c){ cb(c); m_sync.start(); });
-                           });
-                        } else { // must be m_sgkd
-                           m_sgkd->setup([this,cb=std::move(cb)](bool c){
-                                if (!c) { cb(false); return; }  // check if pdu distributor returns false
-                                if (m_pgkd)
-                                    m_pgkd->setup([this,cb=std::move(cb)](bool c){ cb(c); m_sync.start(); });
-                                else    // must be m_psgkd
-                                    m_psgkd->setup([this,cb=std::move(cb)](bool c){ cb(c); m_sync.start(); });
-                           });
-                        }
-                    });
-        }
+        // pdu and pub key distributors use separate collections and don't depend on each
+        // other so, once certs are done, they set up (elections and key fetches) concurrently.
+        // 'cb' is called when the last one finishes or as soon as one fails.
+        m_ckd.setup([this, n=int(pdu_dist)+int(pub_dist), cb=std::move(cb)](bool c) mutable {
+                    if (!c) { cb(false); return; }
+                    auto done = [this, pending=std::make_shared<int>(n),
+                                 cb=std::make_shared<connectedCb>(std::move(cb))](bool c) {
+                            if (*pending <= 0) return;  // a failure has already been reported
+                            if (!c) { *pending = 0; (*cb)(false); return; }
+                            if (--*pending == 0) { (*cb)(true); startSync(); }
+                        };
+                    if (m_gkd) m_gkd->setup(connectedCb{done});
+                    else if (m_sgkd) m_sgkd->setup(connectedCb{done});
+                    if (m_pgkd) m_pgkd->setup(connectedCb{done});
+                    else if (m_psgkd) m_psgkd->setup(connectedCb{done});
+                });
+    }
+
+    // completion token form of start (see face/awaitable.hpp): 'co_await model.connect()'
+    // returns true once the certs and keys needed to sync have been set up
+    template<typename Token = defaultToken>
+    auto connect(Token&& token = {}) {
+        return boost::asio::async_initiate<Token, void(bool)>([this](auto&& h) {
+                    auto c = makeOneShot<void(bool)>(std::move(h), face_.getIoContext());
+                    start([c](bool ok) { (*c)(ok); });
+                }, token);
     }
 
     // inspection API to extract information from the schema.
@@ -404,16 +707,38 @@ struct DCTmodel {
     // #pubPrefix or #chainInfo. If used on a pub that requires parameters it
     // will throw an error.
     auto pubVal(std::string_view pubnm) const {
-        auto cs{cs_};
-        pubBldr<false> bld{bs_, cs, pubnm};
+        pubBldr<false> bld{bs_, cs_, pubnm};
         return bld.name();
     }
     auto pubVal(std::string_view pubnm, std::string_view fldNm) const {
-        auto cs{cs_};
-        pubBldr<false> bld{bs_, cs, pubnm};
+        pubBldr<false> bld{bs_, cs_, pubnm};
         return std::string(bld.name().nthBlk(bld.index(fldNm)).toSv());;
     }
 
+    // Accessor for the pub name component with a particular tag as a T (an unsigned
+    // integer, std::string, std::string_view or system_clock::time_point). It's made
+    // by field<T>(tag) which looks up the tag's component index once so, unlike
+    // sPub's string(tag), number(tag), etc., using it doesn't cost a tag lookup.
+    // (A std::string_view refers to the pub so it's only valid while the pub is.)
+    template<typename T>
+    struct Field {
+        size_t c_;
+
+        template<typename P>
+        T operator()(const P& p) const {
+            auto c = p.name().nthBlk(c_);
+            if constexpr (std::is_same_v<T, std::string>) return std::string(c.toSv());
+            else if constexpr (std::is_same_v<T, std::string_view>) return c.toSv();
+            else if constexpr (std::is_same_v<T, std::chrono::system_clock::time_point>) return c.toTimestamp();
+            else {
+                static_assert(std::is_unsigned_v<T>, "Field type must be unsigned, string, string_view or time_point");
+                return c.toNumber();
+            }
+        }
+    };
+    template<typename T>
+    auto field(std::string_view tag) const { return Field<T>{bld_.index(tag)}; }
+
     struct sPub : Publication {
         using Publication::Publication;
         sPub(const Publication& p) { *this = reinterpret_cast<const sPub&>(p); }
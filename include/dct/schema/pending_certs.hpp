@@ -0,0 +1,124 @@
+#ifndef PENDING_CERTS_HPP
+#define PENDING_CERTS_HPP
+#pragma once
+/*
+ * bounded store for certs waiting for their signing cert to arrive
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+#include <chrono>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "dct_cert.hpp"
+#include "dct/mem_report.hpp"
+
+namespace dct {
+
+/*
+ * Certs can arrive before the cert that signed them so they're held here, keyed
+ * by their signer's thumbprint, until it shows up. The store is bounded:
+ *  - at most 'maxCerts_' certs are held. Adding to a full store evicts the oldest.
+ *  - at most 'maxPerSigner_' certs wait on any one signer. Adding more evicts the
+ *    oldest of that signer's certs (so one peer can't fill the store).
+ *  - certs are dropped after waiting 'maxAge_'.
+ */
+struct pendingCerts {
+    using Clock = std::chrono::steady_clock;
+
+  private:
+    struct entry {
+        thumbPrint signer;
+        thumbPrint tp;
+        dctCert cert;
+        Clock::time_point added;
+    };
+    using entries = std::list<entry>;               // oldest first
+
+    entries ent_{};
+    std::unordered_multimap<thumbPrint,entries::iterator> bySigner_{};
+    size_t maxCerts_;
+    size_t maxPerSigner_;
+    Clock::duration maxAge_;
+
+    void erase(entries::iterator it) {
+        auto [b, e] = bySigner_.equal_range(it->signer);
+        for (auto i = b; i != e; ++i) if (i->second == it) { bySigner_.erase(i); break; }
+        ent_.erase(it);
+    }
+
+  public:
+    pendingCerts(size_t maxCerts = 256, size_t maxPerSigner = 16, Clock::duration maxAge = std::chrono::seconds(30)) :
+        maxCerts_{maxCerts}, maxPerSigner_{maxPerSigner}, maxAge_{maxAge} { }
+
+    // drop certs that have been waiting too long
+    void expire(Clock::time_point now = Clock::now()) {
+        while (ent_.size() && now - ent_.front().added > maxAge_) erase(ent_.begin());
+    }
+
+    // hold cert 'c' (thumbprint 'tp') until signer 'stp' arrives. Returns true if this
+    // is the first cert waiting on 'stp' (the caller may want to go looking for it).
+    bool add(const thumbPrint& stp, const thumbPrint& tp, dctCert&& c, Clock::time_point now = Clock::now()) {
+        expire(now);
+        auto [b, e] = bySigner_.equal_range(stp);
+        size_t n{};
+        auto oldest = ent_.end();
+        for (auto i = b; i != e; ++i, ++n) {
+            if (i->second->tp == tp) return false;  // already waiting
+            if (oldest == ent_.end() || i->second->added < oldest->added) oldest = i->second;
+        }
+        if (n >= maxPerSigner_) {
+            erase(oldest);
+            --n;
+        }
+        if (ent_.size() >= maxCerts_) erase(ent_.begin());
+        ent_.push_back(entry{stp, tp, std::move(c), now});
+        bySigner_.emplace(stp, std::prev(ent_.end()));
+        return n == 0;
+    }
+
+    // remove and return the certs waiting for signer 'stp'
+    std::vector<dctCert> take(const thumbPrint& stp) {
+        std::vector<dctCert> res{};
+        auto [b, e] = bySigner_.equal_range(stp);
+        for (auto i = b; i != e; ++i) {
+            res.emplace_back(std::move(i->second->cert));
+            ent_.erase(i->second);
+        }
+        bySigner_.erase(b, e);
+        return res;
+    }
+
+    bool waitingFor(const thumbPrint& stp) const { return bySigner_.contains(stp); }
+    auto size() const noexcept { return ent_.size(); }
+
+    // heap bytes held (see mem_report.hpp)
+    size_t heapBytes() const noexcept {
+        size_t b = ent_.size() * (sizeof(entry) + 2 * sizeof(void*) + mem::node) + mem::hash(bySigner_);
+        for (const auto& e : ent_) b += e.cert.size();
+        return b;
+    }
+};
+
+} // namespace dct
+
+#endif // PENDING_CERTS_HPP
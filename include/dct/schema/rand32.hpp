@@ -29,10 +29,9 @@
 
 namespace dct {
 
+// per-thread so DeftTs running on different threads don't share (race on) generator state
 static inline auto& randGen() noexcept {
-    static std::minstd_rand randomGen{};
-    static bool needInit{true};
-    if (needInit) { randomGen.seed((std::random_device{})()); needInit = false; }
+    static thread_local std::minstd_rand randomGen{(std::random_device{})()};
     return randomGen;
 }
 
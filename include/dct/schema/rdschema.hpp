@@ -29,6 +29,8 @@
 #include <iostream>
 #include <istream>
 #include <map>
+#include <span>
+#include <streambuf>
 #include <type_traits>
 #include <version>
 #include "bschema.hpp"
@@ -42,9 +44,30 @@ using parmSet = std::bitset<sizeof(parmBM)*8>;
 using chainSet = std::bitset<sizeof(chainBM)*8>;
 using discSet = std::bitset<sizeof(discBM)*8>;
 
+// read-only streambuf over a block of memory so a schema can be parsed in place
+// (e.g., from a schema cert's content) rather than from a copy in a stringstream.
+struct spanBuf : std::streambuf {
+    spanBuf(std::span<const uint8_t> s) {
+        auto b = (char*)s.data();
+        setg(b, b, b + s.size());
+    }
+    spanBuf() = default;
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) override {
+        auto p = dir == std::ios_base::beg? eback() + off : dir == std::ios_base::cur? gptr() + off : egptr() + off;
+        if (p < eback() || p > egptr()) return pos_type(off_type(-1));
+        setg(eback(), p, egptr());
+        return pos_type(p - eback());
+    }
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+};
+
 template<bool rsdebug = false>
 struct rdSchema {
     explicit rdSchema(std::istream& is) : is_(is), remaining_{65535} {}
+    explicit rdSchema(std::span<const uint8_t> s) : sb_{s}, ms_{&sb_}, is_(ms_), remaining_{65535} {}
 
     // ------ helper routines start here ------
     template <typename... T>
@@ -167,10 +190,10 @@ struct rdSchema {
                 if (off + siz > stablen) throw schema_error("token outside stab");
                 if (vec.size() >= maxTok) throw schema_error("too many tokens");
                 auto tok = bTok(bs_.stab_.data() + off, siz);
-                bs_.tm_.emplace(tok, vec.size());
                 dprint("tok {}: {}\n", vec.size(), tok);
                 return tok;
             });
+        bs_.tm_.build(vec);
     }
     void readCert() {
         // each cert has a length followed by that many component tokens. Each token must be
@@ -392,7 +415,9 @@ struct rdSchema {
             }
         }
     }
+    // parse the schema and move it out (it isn't copied) so read can be called just once
     bSchema read() {
+        if (bs_.stab_.size() || bs_.tok_.size()) throw schema_error("rdSchema::read called twice");
         remaining_ = checkHDR(sTLV::schema);
         readStr();
         readTok();
@@ -405,9 +430,11 @@ struct rdSchema {
         readDiscrim();
         readPub();
         chkConsist();
-        return bs_;
+        return std::move(bs_);
     }
 
+    spanBuf sb_{};
+    std::istream ms_{nullptr};
     std::istream& is_;
     int remaining_{};
     bSchema bs_{};
@@ -28,6 +28,7 @@
 #include <cstring>
 #include <sstream>
 #include "date/date.h" // XXX should be in <chrono>
+#include "dct/coarse_clock.hpp"
 
 #include "../sigmgrs/sigmgr_defs.hpp"
 #include "tlv_parser.hpp"
@@ -140,6 +141,67 @@ constexpr auto rName::operator<=>(const rName& rhs) const noexcept { return rPre
 constexpr bool rName::isPrefix(const rName& nm) const noexcept { return rPrefix(*this).isPrefix(rPrefix(nm)); }
 constexpr auto rName::first(int comp) const { return rPrefix(*this).first(comp); }
 
+// An rName with an index of where each of its components starts. The index is
+// built by the first component access so repeated nBlks(), nthBlk(), last() and
+// [] calls on the same name don't each walk it from the start. It's for code that
+// looks at several components of one name (e.g., matching a pub name against
+// templates). Names with more than 'maxComps' components aren't indexed and are
+// walked as an rName would be.
+struct rNameIdx : rName {
+    static constexpr size_t maxComps = 16;
+
+  private:
+    static constexpr uint8_t unbuilt = 0xff;
+    static constexpr uint8_t tooLong = 0xfe;
+    mutable std::array<uint16_t,maxComps+1> o_;  // start of each component then the end of the last
+    mutable uint8_t n_{unbuilt};                 // number of components
+
+    bool indexed() const {
+        if (n_ == unbuilt) {
+            tlvParser b{*this};
+            uint8_t n{};
+            for (; ! b.eof(); ++n) {
+                if (n == maxComps) return (n_ = tooLong), false;
+                o_[n] = b.off();
+                b.nextBlk();
+            }
+            o_[n] = b.off();
+            n_ = n;
+        }
+        return n_ != tooLong;
+    }
+
+    // parser for component 'c' positioned at its content (as nextBlk() returns)
+    tlvParser comp(size_t c) const {
+        tlvParser p(subspan(o_[c], o_[c+1] - o_[c]), 0);
+        p.blkLen();     // skip over type
+        p.blkLen();     // and length
+        return p;
+    }
+
+  public:
+    rNameIdx() = default;
+    rNameIdx(const rName& n) : rName(n) { }
+
+    size_t nBlks() const { return indexed()? n_ : rName::nBlks(); }
+
+    tlvParser nthBlk(int blkIdx) const {
+        if (! indexed()) return rName::nthBlk(blkIdx);
+        if (blkIdx < 0 || blkIdx >= n_) throw runtime_error(format("requested blk {} but only {} blks in TLV", blkIdx, n_));
+        return comp(blkIdx);
+    }
+
+    tlvParser last() const {
+        if (! indexed()) return rName::last();
+        return n_ == 0? tlvParser{} : comp(n_ - 1);
+    }
+
+    auto operator[](int c) const {
+        if (c < 0) c += nBlks();
+        return nthBlk(c);
+    }
+};
+
 struct rInterest : tlvParser {
     constexpr rInterest() = default;
     rInterest(const rInterest&) = default;
@@ -169,6 +231,10 @@ struct rInterest : tlvParser {
 };
 
 struct rData : tlvParser {
+    // offsets (from data()) of the MetaInfo, Content, SignatureInfo & SignatureValue
+    // blocks once indexBlks() has found them (blk_[0] is zero until then)
+    std::array<uint16_t,4> blk_{};
+
     constexpr rData() = default;
     rData(const rData&) = default;
     rData(rData&&) = default;
@@ -182,6 +248,7 @@ struct rData : tlvParser {
     // a Data is valid if it starts with the correct TLV, its name is valid and
     // it contains the 5 required TLV blocks in the right order and nothing else.
     bool valid() const {
+        if (blk_[0]) return true;   // indexBlks() checked it
         try {
             tlvParser t(*this);
             rName(t.nextBlk(tlv::Name)).valid();
@@ -194,22 +261,52 @@ struct rData : tlvParser {
         return true;
     }
 
+    /*
+     * Check that the Data is valid (as above) and record where its blocks are, in one
+     * pass, so the accessors below go straight to a block rather than scanning the
+     * packet from its name. A pub is looked at many times (validity, expiration, its
+     * signer, signature check, delivery) so it's indexed when it arrives and the copies
+     * of it handed to sigmgrs & callbacks carry the offsets. A Data that isn't valid
+     * (or is too big for 16 bit offsets) is left unindexed. Returns *this.
+     */
+    rData& indexBlks() noexcept {
+        if (blk_[0] || size() > 0xffff) return *this;
+        try {
+            tlvParser t(*this);
+            if (! rName(t.nextBlk(tlv::Name)).valid()) return *this;
+            std::array<uint16_t,4> b;
+            size_t i{};
+            for (auto typ : {tlv::MetaInfo, tlv::Content, tlv::SignatureInfo, tlv::SignatureValue}) {
+                b[i++] = t.off();
+                t.nextBlk(typ);
+            }
+            if (t.eof()) blk_ = b;
+        } catch (const std::exception&) { }
+        return *this;
+    }
+
+    // block 'i' of blk_ (type 'typ')
+    tlvParser blk(size_t i, tlv typ) const {
+        if (blk_[0]) return tlvParser(*this).skipTo(blk_[i]).nextBlk();
+        return tlvParser(*this).findBlk(typ);
+    }
+
     auto name() const { return rName(tlvParser(*this).nextBlk(tlv::Name)); }
 
-    auto metainfo() const { return tlvParser(*this).findBlk(tlv::MetaInfo); }
+    auto metainfo() const { return blk(0, tlv::MetaInfo); }
 
         auto contentType() const { return metainfo().findBlk(tlv::ContentType).toByte(); }
 
-    auto content() const { return tlvParser(*this).findBlk(tlv::Content); }
+    auto content() const { return blk(1, tlv::Content); }
 
-    auto sigInfo() const { return tlvParser(*this).findBlk(tlv::SignatureInfo); }
+    auto sigInfo() const { return blk(2, tlv::SignatureInfo); }
 
         auto sigType() const { return sigInfo().findBlk(tlv::SignatureType).toByte(); }
 
         auto& thumbprint() const {
             static constinit std::array<uint8_t,4> kloc{ 28, thumbPrint_s+2, 29, thumbPrint_s };
             auto si = sigInfo().findBlk(tlv::KeyLocator);
-            if (memcmp(si.data(), kloc.data(), kloc.size()) != 0)
+            if (si.size() < kloc.size() + thumbPrint_s || memcmp(si.data(), kloc.data(), kloc.size()) != 0)
                 throw runtime_error("KeyLocator not a DCT thumbprint");
             return *(thumbPrint*)(si.data() + sizeof(kloc));
         }
@@ -220,7 +317,7 @@ struct rData : tlvParser {
             return tp;
         }
 
-    auto signature() const { return tlvParser(*this).findBlk(tlv::SignatureValue); }
+    auto signature() const { return blk(3, tlv::SignatureValue); }
 
     auto operator<=>(const rData& rhs) const noexcept { return name() <=> rhs.name(); }
 };
@@ -234,11 +331,39 @@ struct iso8601 : std::array<uint8_t,15> {
         auto s = fmt::format("{:%G%m%dT%H%M%S}", fmt::gmtime(tp));
         std::copy(s.begin(), s.begin()+this->size(), this->begin());
     }
+    // the current time. It's only reformatted when the time has moved to a new
+    // second since certs are validated far more often than that (and the coarse
+    // clock is read since a second's resolution is all that's needed).
+    static const iso8601& now() { return cached<0>(coarseClock::now()); }
+
+    // the latest the current time can be given the coarse clock's lag. A cert made
+    // with a NotBefore of the current second (e.g., a new signing cert) is compared
+    // against this so it isn't 'not valid yet' for the tick after a second boundary.
+    static const iso8601& latest() { return cached<1>(coarseClock::now() + coarseClock::resolution()); }
+
+    template<int N>
+    static const iso8601& cached(std::chrono::system_clock::time_point tp) {
+        using namespace std::chrono;
+        static thread_local auto sec = floor<seconds>(tp);
+        static thread_local iso8601 cur{sec};
+        if (auto t = floor<seconds>(tp); t != sec) {
+            sec = t;
+            cur = iso8601(t);
+        }
+        return cur;
+    }
+
+    // convert back to a time point (the format is fixed so the digits are converted
+    // directly rather than through a stream parser)
     auto toTP() const {
-        date::sys_time<std::chrono::microseconds> tp{};
-        std::istringstream is(std::string((const char*)data(), size()));
-        date::from_stream(is, "%Y%m%dT%H%M%S", tp);
-        return tp;
+        using namespace std::chrono;
+        auto num = [this](size_t off, size_t len) {
+            int v{};
+            for (auto i = off; i < off + len; i++) v = v * 10 + ((*this)[i] - '0');
+            return v;
+        };
+        auto d = date::sys_days{date::year{num(0, 4)}/date::month(num(4, 2))/date::day(num(6, 2))};
+        return date::sys_time<microseconds>{d + hours{num(9, 2)} + minutes{num(11, 2)} + seconds{num(13, 2)}};
     }
     using ordering = std::strong_ordering;
     auto operator<=>(const iso8601& rhs) const noexcept {
@@ -250,6 +375,29 @@ struct iso8601 : std::array<uint8_t,15> {
     }
 };
 
+// The siginfo of a DCT cert has a fixed layout: signature type, the signer's thumbprint
+// and a validity period. This is its skeleton (see tlvValOff) and field offsets.
+struct certSigInfo {
+    static constexpr auto skel = TLV<tlv::SignatureInfo>(tlvFlatten(
+                TLV<tlv::SignatureType>(0),
+                TLV<tlv::KeyLocator>(TLV<tlv::KeyDigest>(std::array<uint8_t,thumbPrint_s>{})),
+                TLV<tlv::ValidityPeriod>(tlvFlatten(
+                    TLV<tlv::NotBefore>(std::array<uint8_t,sizeof(iso8601)>{}),
+                    TLV<tlv::NotAfter>(std::array<uint8_t,sizeof(iso8601)>{})))));
+    static constexpr size_t typeOff = tlvValOff(skel, {tlv::SignatureInfo, tlv::SignatureType});
+    static constexpr size_t keyDigestOff = tlvValOff(skel, {tlv::SignatureInfo, tlv::KeyLocator, tlv::KeyDigest});
+    static constexpr size_t notBeforeOff = tlvValOff(skel, {tlv::SignatureInfo, tlv::ValidityPeriod, tlv::NotBefore});
+    static constexpr size_t notAfterOff = tlvValOff(skel, {tlv::SignatureInfo, tlv::ValidityPeriod, tlv::NotAfter});
+    static_assert(notAfterOff + sizeof(iso8601) == skel.size());
+
+    // does the siginfo at 'si' have this layout? (only the bytes between the fields are compared)
+    static bool matches(const uint8_t* si) noexcept {
+        auto same = [si](size_t b, size_t e) { return std::memcmp(si + b, skel.data() + b, e - b) == 0; };
+        return same(0, typeOff) && same(typeOff + 1, keyDigestOff) &&
+               same(keyDigestOff + thumbPrint_s, notBeforeOff) && same(notBeforeOff + sizeof(iso8601), notAfterOff);
+    }
+};
+
 // An rCert is an rData with a particular structure.  This class validates that structure.
 struct rCert : rData {
     constexpr rCert() = default;
@@ -262,14 +410,7 @@ struct rCert : rData {
         if (contentType() != uint8_t(tlv::ContentType_Key)) return false;
         // a DCT cert siginfo is constant size so its entire structure can be
         // checked at once
-        static const std::array<uint8_t,4> si0{22, 81, 27, 1};
-        static const std::array<uint8_t,4> si5{28, thumbPrint_s+2, 29, thumbPrint_s};
-        static const std::array<uint8_t,8> si41{253, 0, 253, 38, 253, 0, 254, 15};
-        static const std::array<uint8_t,4> si64{253, 0, 255, 15};
-        const auto si = sigInfo().data();
-        if (std::memcmp(si+0, si0.data(), si0.size()) || std::memcmp(si+5, si5.data(), si5.size()) ||
-            std::memcmp(si+41, si41.data(), si41.size()) || std::memcmp(si+64, si64.data(), si64.size())) return false; 
-        return true;
+        return certSigInfo::matches(sigInfo().data());
     }
 
     // check that cert's sigInfo is formatted correctly and that it's within its validity period.
@@ -278,9 +419,10 @@ struct rCert : rData {
 
         // check validity period
         const auto si = sigInfo().data();
-        auto now = iso8601(std::chrono::system_clock::now());
-        if (std::memcmp(now.data(), si+49, now.size()) < 0) return false; // not valid yet
-        if (std::memcmp(si+68, now.data(), now.size()) < 0) return false; // expired
+        const auto& now = iso8601::now();
+        const auto& latest = iso8601::latest();
+        if (std::memcmp(latest.data(), si + certSigInfo::notBeforeOff, latest.size()) < 0) return false; // not valid yet
+        if (std::memcmp(si + certSigInfo::notAfterOff, now.data(), now.size()) < 0) return false; // expired
         return true;
     }
 
@@ -292,8 +434,8 @@ struct rCert : rData {
     }
     // NOTE: these routines *assume* that rCert validity has been checked with .validForm()
     // and will misbehave badly if that is not true.
-    auto validAfter() const noexcept { return ((const iso8601*)(sigInfo().data() + 49))->toTP(); }
-    auto validUntil() const noexcept { return ((const iso8601*)(sigInfo().data() + 68))->toTP(); }
+    auto validAfter() const noexcept { return ((const iso8601*)(sigInfo().data() + certSigInfo::notBeforeOff))->toTP(); }
+    auto validUntil() const noexcept { return ((const iso8601*)(sigInfo().data() + certSigInfo::notAfterOff))->toTP(); }
 };
 
 } // namespace dct
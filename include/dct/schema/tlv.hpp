@@ -26,6 +26,7 @@
  *  More information on DCT is available from info@pollere.net
  */
 #include <array>
+#include <initializer_list>
 
 namespace dct {
 
@@ -66,6 +67,8 @@ enum class tlv : uint16_t {
                 ContentType_Nack = 3,
                 ContentType_Manifest = 4,
                 ContentType_CAdd = 42,
+                ContentType_Compressed = 43,   // content is compressed (see syncps/pub_codec.hpp)
+                ContentType_CAddCompact = 44,  // cAdd with delta-encoded pub names (see syncps/cadd_codec.hpp)
             FreshnessPeriod = 25,
             //FinalBlockId = 26,
         Content = 21,
@@ -132,6 +135,42 @@ static constexpr auto TLV(std::array<uint8_t,S> arg) noexcept { return tlvFlatte
 template<tlv typ>
 static constexpr auto TLV(uint8_t arg) noexcept { return std::to_array<uint8_t>({ uint8_t(typ), 1, arg}); }
 
+/*
+ * Packets with a fixed format (siginfos, cert validity periods, ...) can be emitted
+ * by copying a compile-time 'skeleton' of them (made with the routines above with
+ * zeros for the variable fields) then storing the fields. tlvValOff gives the offset
+ * in skeleton 's' of the value of the tlv reached by 'path': each element of 'path'
+ * is the type of a tlv at the current level and all but the last are containers the
+ * next is looked for in. It returns S (so a static_assert fails) if there's no such tlv.
+ * E.g.,
+ *   static constexpr auto si = TLV<tlv::SignatureInfo>(TLV<tlv::SignatureType>(0));
+ *   static constexpr auto typeOff = tlvValOff(si, {tlv::SignatureInfo, tlv::SignatureType});
+ */
+template<size_t S>
+static constexpr size_t tlvValOff(const std::array<uint8_t,S>& s, std::initializer_list<tlv> path,
+                                  size_t off = 0, size_t end = S) noexcept {
+    auto num = [&s](size_t& o) -> size_t {
+        size_t v = s[o++];
+        if (v == 253) { v = (size_t(s[o]) << 8) | s[o+1]; o += 2; }
+        return v;
+    };
+    for (auto typ : path) {
+        for (;;) {
+            if (off >= end) return S;
+            auto t = num(off);
+            auto l = num(off);
+            if (t == size_t(typ)) { end = off + l; break; }
+            off += l;
+        }
+    }
+    return off;
+}
+
+// store the low 'n' bytes of 'v' big-endian (network order) at 'p'
+static constexpr void tlvStore(uint8_t* p, uint64_t v, size_t n) noexcept {
+    while (n-- > 0) { p[n] = uint8_t(v); v >>= 8; }
+}
+
 } // namespace dct
 
 #endif // TLV_HPP
@@ -31,6 +31,7 @@
 #include <span>
 #include <vector>
 #include <utility>
+#include "tlv.hpp"
 
 namespace dct {
 
@@ -51,18 +52,15 @@ struct tlvEncoder {
     auto data() const noexcept { return m_blk.data(); }
 
 
-    // add an uint64_t with tlv type 'typ'
+    // add an uint64_t with tlv type 'typ' (its layout is fixed so the space is added
+    // at once then the header & value are stored)
     void addNumber(uint8_t typ, uint64_t num) {
-        m_blk.emplace_back(typ);
-        m_blk.emplace_back(8);
-        m_blk.emplace_back(num >> 56);
-        m_blk.emplace_back(num >> 48);
-        m_blk.emplace_back(num >> 40);
-        m_blk.emplace_back(num >> 32);
-        m_blk.emplace_back(num >> 24);
-        m_blk.emplace_back(num >> 16);
-        m_blk.emplace_back(num >>  8);
-        m_blk.emplace_back(num);
+        auto o = m_blk.size();
+        m_blk.resize(o + 2 + sizeof(num));
+        auto* p = m_blk.data() + o;
+        p[0] = typ;
+        p[1] = sizeof(num);
+        tlvStore(p + 2, num, sizeof(num));
         m_off = m_blk.size();
     }
 
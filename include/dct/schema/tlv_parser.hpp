@@ -30,6 +30,7 @@
 #include <vector>
 #include "dct/format.hpp"
 #include "tlv.hpp"
+#include "wyhash.hpp"
 
 namespace dct {
 
@@ -327,10 +328,10 @@ struct tlvVec {
 
 } // namespace dct
 
+// tlvs are hashed with wyhash since it's much faster than std::hash<string_view> on
+// long names (see tools/time_hashing.cpp)
 template<> struct std::hash<dct::tlvParser> {
-    constexpr size_t operator()(const dct::tlvParser& tp) const noexcept {
-        return std::hash<std::u8string_view>{}({(char8_t*)tp.data(), tp.size()});
-    }
+    size_t operator()(const dct::tlvParser& tp) const noexcept { return wyHash{}(tp.data(), tp.size()); }
 };
 
 #endif // TLVPARSER_HPP
@@ -24,7 +24,9 @@
  *  More information on DCT is available from info@pollere.net
  */
 
+#include <set>
 #include <string_view>
+#include <utility>
 #include "cert_bundle.hpp"
 #include "cert_to_schema.hpp"
 #include "certstore.hpp"
@@ -52,6 +54,18 @@ static inline const bSchema& loadSchema(const dctCert& scert) {
     return schemas.try_emplace(tp, certToSchema(scert, tp)).first->second;
 }
 
+// validate 'cert' against 'signer' remembering, by the thumbprints of the pair, the
+// ones that passed. A relay's DeftTs share a trust anchor and schema (and often
+// identity chain certs) so each signature is only checked once per process.
+static inline bool validateOnce(auto& sm, const dctCert& cert, const dctCert& signer) {
+    static std::set<std::pair<thumbPrint,thumbPrint>> valid{};
+
+    std::pair key{cert.computeThumbPrint(), signer.computeThumbPrint()};
+    if (valid.contains(key)) return true;
+    if (! sm.validate(cert, signer)) return false;
+    valid.emplace(key);
+    return true;
+}
 
 // 'bootstrap' of a Defined-trust transport instance requires the following certs and one secret key
 //      0: the trust anchor
@@ -70,12 +84,12 @@ static inline const auto& validateBootstrap(const certCb& rootCb, const certCb&
     auto sm = sigMgrByType(sigType);
     if (! sm.needsKey()) throw schema_error("bootstrap certs can't use a keyless validator");
     if (! root.selfSigned()) throw schema_error("bootstrap first item not a trust anchor");
-    if (! sm.validate(root, root)) throw schema_error("trust anchor doesn't validate");
+    if (! validateOnce(sm, root, root)) throw schema_error("trust anchor doesn't validate");
     cs.add(root);
 
     // validate then load the schema
     auto scert = schemaCb();
-    if (! sm.validate(scert, root)) throw schema_error("schema cert doesn't validate");
+    if (! validateOnce(sm, scert, root)) throw schema_error("schema cert doesn't validate");
     auto scname = tlvVec{scert.name()};
     if (scname[-6].toSv() != "schema" || scname[-4].toSv() != "KEY")
         throw schema_error("schema cert name malformed");
@@ -107,7 +121,7 @@ static inline const auto& validateBootstrap(const certCb& rootCb, const certCb&
         const auto& cert = ch[c];
         if (cert.getSigType() != sigType) throw schema_error("identity chain certs don't all have same signing type");
         if (cert.getKeyLoc() != prevTP) throw schema_error(format("cert {} signing chain invalid",cert.name()));
-        if (! sm.validate(cert, cs[prevTP])) throw schema_error(format("cert {} doesn't validate", c));
+        if (! validateOnce(sm, cert, cs[prevTP])) throw schema_error(format("cert {} doesn't validate", c));
         if (matchesAny(bs, cert.name()) < 0) throw schema_error(format("cert {} doesn't match a schema cert", cert.name()));
         cs.add(cert);
         prevTP = cert.computeThumbPrint();
@@ -140,7 +154,7 @@ static inline const auto& validateBootstrap(const certCb& rootCb, const certCb&
 // stores. Nothing in the bundle is trusted implicitly so all of the contents are
 // validated.
 static inline const auto& validateBootstrap(std::string_view bootstrap, certStore& cs) {
-    auto cb = rdCertBundle(fileToVec(bootstrap));
+    const auto& cb = loadBundle(bootstrap);
     // first item must be a trust anchor and validly signed
     // all items in the bundle must use the same signature type so use root's
     // type to get a sigMgr then validate the root.
@@ -149,12 +163,12 @@ static inline const auto& validateBootstrap(std::string_view bootstrap, certStor
     auto sm = sigMgrByType(sigType);
     if (! sm.needsKey()) throw schema_error("bootstrap certs can't use a keyless validator");
     if (! root.selfSigned()) throw schema_error("bootstrap first item not a trust anchor");
-    if (! sm.validate(root, root)) throw schema_error("trust anchor doesn't validate");
+    if (! validateOnce(sm, root, root)) throw schema_error("trust anchor doesn't validate");
     cs.add(root);
 
     // validate then load the schema
     const auto& scert = cb[1].first;
-    if (! sm.validate(scert, root)) throw schema_error("schema cert doesn't validate");
+    if (! validateOnce(sm, scert, root)) throw schema_error("schema cert doesn't validate");
     auto scname = tlvVec{scert.name()};
     if (scname[-6].toSv() != "schema" || scname[-4].toSv() != "KEY")
         throw schema_error("schema cert name malformed");
@@ -183,7 +197,7 @@ static inline const auto& validateBootstrap(std::string_view bootstrap, certStor
         if (cert.getSigType() != sigType) throw schema_error("bundle certs don't all have same signing type");
         if (cert.getKeyLoc() != prev.computeThumbPrint())
             throw schema_error(format("cert {} signing chain invalid",cert.name()));
-        if (! sm.validate(cert, prev)) throw schema_error(format("cert {} doesn't validate", c));
+        if (! validateOnce(sm, cert, prev)) throw schema_error(format("cert {} doesn't validate", c));
         if (matchesAny(bs, cert.name()) < 0) throw schema_error(format("cert {} doesn't match a schema cert", cert.name()));
         cs.add(cert, key);
     }
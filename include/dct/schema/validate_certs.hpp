@@ -93,12 +93,13 @@ static inline int matchesChain(const bSchema& bs, const certStore& cs, const dct
 
 // check that schema 'bs' cert name component correspondences indexed by 'ci'
 // hold for vector of cert names 'cv'.
-static inline bool validateChainCors(const bSchema& bs, certVec&& cv, coridx ci) {
+static inline bool validateChainCors(const bSchema& bs, certVec& cv, coridx ci) {
     for (const auto [n1, c1, n2, c2] : bs.cor_[ci]) {
         if (n1 > 0 && cv[n1-1][c1].toSv() != cv[n2-1][c2].toSv()) return false;
     }
     return true;
 }
+static inline bool validateChainCors(const bSchema& bs, certVec&& cv, coridx ci) { return validateChainCors(bs, cv, ci); }
 
 // validate the entire signing chain of 'cert' against schema 'bs'. 'cert' must be a signing cert.
 // 'cert' doesn't need to be in certStore 'cs' but all the other certs of the chain must be.
@@ -117,6 +118,75 @@ static inline int validateChain(const bSchema& bs, const certStore& cs, const dc
     return c;
 }
 
+/*
+ * validateChain() with the schema matching of signing chains memoized by cert.
+ *
+ * Many signing certs usually share the upper part of their chains (e.g., all the
+ * devices of a site are signed by the same site and domain certs) so the result of
+ * matching the certs from some cert up to the trust anchor against the tail of a
+ * schema chain is saved by that cert's thumbprint. Validating a new signing cert then
+ * takes a schema match of its own name against the first cert of each schema chain
+ * plus a lookup for its signer. This is valid as long as the certStore and schema
+ * aren't changed (certs are never removed from a certStore and a thumbprint
+ * identifies exactly one cert).
+ */
+struct chainValidator {
+    // bit 8*k+p of known_ is set if it's been determined whether the certs from
+    // the key's cert to the trust anchor match positions p..end of schema chain k
+    // and the same bit of ok_ says if they did.
+    struct memo { uint64_t known_; uint64_t ok_; };
+    std::unordered_map<thumbPrint,memo> memo_{};
+
+    // check if the chain starting at cert 'tp' matches schema chain 'k' from position 'p' on
+    bool suffixMatches(const bSchema& bs, const certStore& cs, const thumbPrint& tp, size_t k, size_t p) {
+        const auto& sc = bs.chain_[k];
+        if (p >= sc.size() || dctCert::selfSigned(tp)) return false;
+        // only the first 8 positions of the first 8 chains fit in a memo
+        const bool memoize = p < 8 && k < 8;
+        const auto bit = memoize? uint64_t(1) << (8 * k + p) : 0;
+        if (memoize) {
+            if (const auto& m = memo_[tp]; m.known_ & bit) return (m.ok_ & bit) != 0;
+        }
+
+        const auto& cert = cs[tp];
+        auto nm = tlvVec{cert.name()};
+        bool ok = matches(bs, nm, sc[p]) &&
+                  (p + 1 == sc.size()? cert.selfSigned() : suffixMatches(bs, cs, cert.getKeyLoc(), k, p + 1));
+        if (memoize) {
+            // (the recursion may have rehashed memo_ so look the entry up again)
+            auto& mm = memo_[tp];
+            mm.known_ |= bit;
+            if (ok) mm.ok_ |= bit;
+        }
+        return ok;
+    }
+
+    // return the index of the schema chain that signing cert 'cert's chain matches or -1
+    int matchesChain(const bSchema& bs, const certStore& cs, const dctCert& cert) {
+        auto nm = tlvVec{cert.name()};
+        for (int n = bs.chain_.size(), k = 0; k < n; k++) {
+            const auto& sc = bs.chain_[k];
+            if (sc.size() == 0 || ! matches(bs, nm, sc[0])) continue;
+            if (sc.size() == 1? cert.selfSigned() : suffixMatches(bs, cs, cert.getKeyLoc(), k, 1)) return k;
+        }
+        return -1;
+    }
+
+    // same result as validateChain()
+    int validate(const bSchema& bs, const certStore& cs, const dctCert& cert) {
+        auto c = matchesChain(bs, cs, cert);
+        if (c < 0 || bs.cor_.size() == 0) return c;
+        const auto chn = 1u << c;
+        certVec cv{};
+        for (const auto& d : bs.discrim_) {
+            if ((d.cbm & chn) == 0 || bs.cor_[d.cor].size() == 0) continue;
+            if (cv.empty()) cv = cs.chainNames(cert);
+            if (! validateChainCors(bs, cv, d.cor)) return -1;
+        }
+        return c;
+    }
+};
+
 static inline auto getSigMgr(const bSchema& bs) { return sigMgrByType(bs.pubVal("#pubValidator").substr(1)); }
 static inline auto getCertSigMgr(const bSchema&) { return sigMgrByType("EdDSA"s); }
 static inline auto getWireSigMgr(const bSchema& bs) { return sigMgrByType(bs.pubVal("#wireValidator").substr(1)); }
@@ -26,6 +26,10 @@
 
 #include <algorithm>
 #include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string_view>
 #include <set>
 #include <unordered_map>
@@ -40,67 +44,149 @@
 
 namespace dct {
 
+/*
+ * A pub validator's templates compiled into a decision tree over the components
+ * of a name so a name is checked against all of them in one pass.
+ *
+ * Each node is the set of templates consistent with the name components seen so
+ * far. Its edges are the literal values some of those templates require for the
+ * next component (the template literal or, for the template's distinguishing
+ * parameter, one of its values). A literal's edge goes to the templates that
+ * require it plus those that accept any value there and the node's 'any_' edge
+ * goes to just the latter. A node accepts a name that ends there if one of its
+ * templates has that many components. Nodes are shared by identical
+ * (depth, template set) pairs so the tree is no bigger than the templates.
+ */
+struct tmpltDFA {
+    static constexpr uint32_t none = ~0u;
+    struct Edge {
+        std::string val_;       // component value
+        uint32_t next_;         // node for names with this component value
+    };
+    struct Node {
+        uint32_t edge_{};       // index of first of this node's edges
+        uint32_t nedge_{};      // number of edges
+        uint32_t any_{none};    // node for other component values (none = no match)
+        bool accept_{};         // a name that ends here matches
+    };
+    std::vector<Node> nodes_{};
+    std::vector<Edge> edges_{};
+
+    // allowed values for each component of each template (nullopt = any value)
+    using Allowed = std::vector<std::vector<std::optional<std::set<std::string>>>>;
+
+    tmpltDFA() = default;
+    tmpltDFA(const Allowed& al) {
+        std::vector<uint32_t> all(al.size());
+        for (uint32_t i = 0; i < all.size(); ++i) all[i] = i;
+        std::map<std::pair<size_t,std::vector<uint32_t>>,uint32_t> memo{};
+        build(al, 0, all, memo);
+    }
+
+    uint32_t build(const Allowed& al, size_t d, const std::vector<uint32_t>& ts,
+                   std::map<std::pair<size_t,std::vector<uint32_t>>,uint32_t>& memo) {
+        if (auto m = memo.find({d, ts}); m != memo.end()) return m->second;
+        uint32_t n = nodes_.size();
+        nodes_.emplace_back();
+        memo.emplace(std::pair{d, ts}, n);
+
+        // the literal values of component 'd' then the templates that go with each
+        std::set<std::string> lits{};
+        std::vector<uint32_t> any{};
+        for (auto t : ts) {
+            if (al[t].size() == d) { nodes_[n].accept_ = true; continue; }
+            if (const auto& a = al[t][d]; a) lits.insert(a->begin(), a->end());
+            else any.push_back(t);
+        }
+        std::vector<Edge> edges{};
+        for (const auto& v : lits) {
+            std::vector<uint32_t> vt{};
+            for (auto t : ts) {
+                if (al[t].size() == d) continue;
+                if (const auto& a = al[t][d]; ! a || a->contains(v)) vt.push_back(t);
+            }
+            edges.push_back(Edge{v, build(al, d + 1, vt, memo)});
+        }
+        auto anyn = any.empty()? none : build(al, d + 1, any, memo);
+        auto& nd = nodes_[n];
+        nd.edge_ = edges_.size();
+        nd.nedge_ = edges.size();
+        nd.any_ = anyn;
+        for (auto& e : edges) edges_.emplace_back(std::move(e));
+        return n;
+    }
+
+    bool match(const rName& name) const noexcept {
+        if (nodes_.empty()) return false;
+        try {
+            uint32_t n = 0;
+            for (tlvParser nm{name}; ! nm.eof(); ) {
+                const auto& nd = nodes_[n];
+                auto c = nm.nextBlk().toSv();
+                auto next = nd.any_;
+                for (auto e = nd.edge_, ee = e + nd.nedge_; e < ee; ++e) {
+                    if (edges_[e].val_ == c) { next = edges_[e].next_; break; }
+                }
+                if (next == none) return false;
+                n = next;
+            }
+            return nodes_[n].accept_;
+        } catch (const std::exception&) { }
+        return false;
+    }
+};
+
 struct pubValidator {
     std::vector<pTmplt> ptmplts_;
     std::unordered_map<bTok,bComp> ptm_;    // pub-specific token map
     std::vector<bTok> ptok_;                // pub-specific tokens
     std::string pstab_;                     // pub-specific string table
+    tmpltDFA dfa_{};                        // the templates compiled for matchTmplt
  
-    pubValidator(std::vector<pTmplt>&& pt, std::unordered_map<bTok,bComp>&& ptm,
+    pubValidator(const bSchema& bs, std::vector<pTmplt>&& pt, std::unordered_map<bTok,bComp>&& ptm,
                  std::vector<bTok>&& ptok, std::string&& pstab) :
                     ptmplts_{std::move(pt)}, ptm_{std::move(ptm)}, ptok_{std::move(ptok)}, pstab_{std::move(pstab)} {
         // specialize templates for validation (vs construction)
+        tmpltDFA::Allowed al{};
         for (auto& pt : ptmplts_) {
             //assert(pt.dpar_ != maxTok || pt.vs_.to_ulong() == 0ul);
+            auto& a = al.emplace_back();
             for (auto& c : pt.tmplt_) {
                 //assert(! isCor(c));
                 //XXX eventually want type checking here
                 if (isParam(c) || isCall(c)) c = SC_ANON;
+                a.emplace_back(allowed(bs, c));
+            }
+            // a template's distinguishing parameter must have one of its values
+            if (pt.vs_.to_ulong() > 1ul) {
+                std::set<std::string> vs{};
+                for (size_t t = 0; t < pt.vs_.size() && t < bs.tok_.size(); ++t) {
+                    if (pt.vs_[t] && (! a[pt.dpar_] || a[pt.dpar_]->contains(std::string(bs.tok_[t]))))
+                        vs.emplace(bs.tok_[t]);
+                }
+                a[pt.dpar_] = std::move(vs);
             }
         }
+        dfa_ = tmpltDFA(al);
     }
 
     using Name = rName;
-    using Comp = tlvParser;
 
-    // Map 'nm' component 'c' to a template token number.
-    // Returns the token number if found, maxTok otherwise.
-    bComp compToTok(const bSchema& bs, std::string_view pval) const noexcept {
-        if (const auto v = bs.tm_.find(pval); v != bs.tm_.end()) return v->second;
-        return maxTok;
-    }
-    // Match Name component 'nmc' to template component 'pt[c]'
-    // Different types of template components have different matching rules:
+    // The values of a name component that match template component 'ptc'
+    // (nullopt if any value matches). Different types of template components
+    // have different matching rules:
     //  - 'param', 'call' or 'anon' match anything
     //  - a literal or template-specific literal matches exactly
-    //  - a value set matches any member of the set
-    bool matchCompVal(const bSchema& bs, std::string_view nmc, const bComp ptc) const noexcept {
-        if (isAnon(ptc)) return true;     // template doesn't constrain value
-        if (isLit(ptc)) return nmc == bs.tok_[ptc];    // comp must match template literal
-        if (isIndex(ptc)) return nmc == ptok_[typeValue(ptc)]; // value must match cor literal
-        return false;
-    }
-    // check that everything in the template matches its correponding name component
-    bool matchComps(const bSchema& bs, const Name& nm, const pTmplt& pt) const noexcept {
-        auto n{nm};
-        for (auto c = 0u; c < pt.tmplt_.size(); c++) {
-            if (!matchCompVal(bs, n.nextBlk().toSv(), pt.tmplt_[c])) return false;
-        }
-        return true;
+    //  - anything else matches nothing
+    std::optional<std::set<std::string>> allowed(const bSchema& bs, const bComp ptc) const {
+        if (isAnon(ptc)) return std::nullopt;    // template doesn't constrain value
+        if (isLit(ptc)) return std::set<std::string>{std::string(bs.tok_[ptc])};  // comp must match template literal
+        if (isIndex(ptc)) return std::set<std::string>{std::string(ptok_[typeValue(ptc)])}; // value must match cor literal
+        return std::set<std::string>{};
     }
+
     // check that Name 'nm' matches one of our pub templates
-    bool matchTmplt(const bSchema& bs, const Name& nm) const noexcept {
-        auto ncomp = nm.nBlks();
-        for (const auto& pt : ptmplts_) {
-            if (ncomp != pt.tmplt_.size()) continue;
-            // if template has a discriminator check it first
-            if (pt.vs_.to_ulong() > 1ul) {
-                if (auto t = compToTok(bs, nm.nthBlk(pt.dpar_).toSv()); t == maxTok || !pt.vs_[t]) continue;
-            }
-            if (matchComps(bs, nm, pt)) return true;
-        }
-        return false;
-    }
+    bool matchTmplt(const bSchema&, const Name& nm) const noexcept { return dfa_.match(nm); }
 };
 
 // syncps validates each arriving publication using the 'validate' method of
@@ -126,9 +212,47 @@ struct pubValidator {
 // chain. The cert validator stores this validator in the DCTmodel instance
 // in a map indexed by signing cert thumbPrints. This map is passed to the
 // SigMgrSchema constructor below so it can find the appropriate validator
-// for each arriving Pub.
+// for each arriving Pub. Validators are immutable and shared by all the
+// DCTmodels with the same schema (see schemaShared).
+
+using tpToValidator = std::unordered_map<thumbPrint,std::shared_ptr<const pubValidator>>;
 
-using tpToValidator = std::unordered_map<thumbPrint,pubValidator>;
+/*
+ * Process-wide state derived from a schema and the certs validated under it, shared
+ * by all the DCTmodels using that schema (e.g., a relay's DeftTs). It's a function
+ * of the schema and cert thumbprints alone (a thumbprint identifies one cert and,
+ * via its key locator, its signing chain) so a signing chain that arrives on each
+ * of N DeftTs is matched against the schema and has its pub validator built once.
+ * (The bSchema itself is shared by loadSchema().) Which signers a DCTmodel knows
+ * stays per-instance: it's the set of validators in the instance's tpToValidator.
+ */
+struct schemaShared {
+    std::mutex mtx_{};
+    chainValidator chainVal_{};
+    std::unordered_map<thumbPrint,std::shared_ptr<const pubValidator>> pv_{};
+
+    // the shared state for schema 'bs' (keyed by its schema cert thumbprint)
+    static schemaShared& get(const bSchema& bs) {
+        static std::mutex mtx{};
+        static std::map<std::vector<uint8_t>,schemaShared> reg{};
+        std::lock_guard lck(mtx);
+        return reg[bs.schemaTP_];
+    }
+
+    int validateChain(const bSchema& bs, const certStore& cs, const dctCert& cert) {
+        std::lock_guard lck(mtx_);
+        return chainVal_.validate(bs, cs, cert);
+    }
+
+    // validator for pubs signed by 'tp', made by 'mk' if there isn't one yet
+    template<typename Mk>
+    std::shared_ptr<const pubValidator> validator(const thumbPrint& tp, Mk&& mk) {
+        std::lock_guard lck(mtx_);
+        auto& v = pv_[tp];
+        if (! v) v = std::make_shared<const pubValidator>(mk());
+        return v;
+    }
+};
 
 struct SigMgrSchema final : SigMgr {
     std::reference_wrapper<SigMgr> pubsm_;
@@ -147,13 +271,42 @@ struct SigMgrSchema final : SigMgr {
         // structurally validate 'data'
         try {
             const auto& pubval = pv_.at(dctCert::getKeyLoc(data));
-            auto valid = pubval.matchTmplt(bs_, data.name());
+            auto valid = pubval->matchTmplt(bs_, data.name());
             if (!valid) print("SigMgrSchema::validate: invalid structure {}\n", data.name());
             return valid;
         } catch (std::exception& e) { print("SigMgrSchema::validate: structure validation err: {}\n", e.what()); }
         return false;
     }
 
+    // structurally validate the survivors of a batch validated by the pub sigmgr
+    void checkStructure(std::span<const rData> d, std::span<uint8_t> ok) const {
+        for (size_t i = 0; i < d.size(); ++i) {
+            if (! ok[i]) continue;
+            try {
+                ok[i] = pv_.at(dctCert::getKeyLoc(d[i]))->matchTmplt(bs_, d[i].name());
+                if (! ok[i]) print("SigMgrSchema::validate: invalid structure {}\n", d[i].name());
+            } catch (std::exception& e) {
+                print("SigMgrSchema::validate: structure validation err: {}\n", e.what());
+                ok[i] = 0;
+            }
+        }
+    }
+
+    // cryptographically validate the batch with the pub sigmgr then structurally validate the survivors
+    void validateBatch(std::span<const rData> d, std::span<uint8_t> ok) override final {
+        pubsm_.get().validateBatch(d, ok);
+        checkStructure(d, ok);
+    }
+
+    // as validateBatch but the structure checks are done in the completion (on the io thread)
+    void validateAsync(CryptoPool& pool, std::vector<crData>&& d, std::vector<uint8_t>&& ok, BatchCb&& cb) override final {
+        pubsm_.get().validateAsync(pool, std::move(d), std::move(ok),
+                [this, cb = std::move(cb)](std::vector<crData>&& d, std::vector<uint8_t>&& ok) mutable {
+                    checkStructure(std::vector<rData>(d.begin(), d.end()), ok);
+                    cb(std::move(d), std::move(ok));
+                });
+    }
+
     bool decrypt(rData data) override final { return pubsm_.get().decrypt(data); }
 
     void setSigMgr(SigMgr& sm) { pubsm_ = sm; }
@@ -168,6 +321,10 @@ struct SigMgrPT final : SigMgr {
     SigMgrPT(SigMgr& pubsm) : SigMgr(pubsm.type()), pubsm_{pubsm} { }
 
     bool validate(rData data) override final { return pubsm_.validate(data); }
+    void validateBatch(std::span<const rData> d, std::span<uint8_t> ok) override final { pubsm_.validateBatch(d, ok); }
+    void validateAsync(CryptoPool& pool, std::vector<crData>&& d, std::vector<uint8_t>&& ok, BatchCb&& cb) override final {
+        pubsm_.validateAsync(pool, std::move(d), std::move(ok), std::move(cb));
+    }
 };
 
 } // namespace dct
@@ -29,6 +29,7 @@
 #include <functional>
 #include <getopt.h>
 #include <iostream>
+#include <map>
 #include <random>
 #include <stdexcept>
 #include <unordered_map>
@@ -36,6 +37,7 @@
 
 #include <dct/syncps/syncps.hpp>
 #include <dct/schema/dct_model.hpp>
+#include "rs_fec.hpp"
 
 namespace dct {
 
@@ -52,6 +54,17 @@ static constexpr size_t MAX_SEGS = 64;  //max segments of a msg, <= maxDifferenc
  * are segmented and sent in multiple Publications and reassembled into
  * messages that are passed to the application's callback.
  *
+ * Messages of more than MAX_SEGS segments (firmware images, config blobs) are
+ * sent as streams: at most a window of segments is unconfirmed at any time
+ * (so the collection isn't flooded) and, if the app sets a streamHndlr, the
+ * receiver passes it each contiguous range of the message as it completes.
+ *
+ * With forward error correction on (fec()), a multi-segment message also gets
+ * repair segments (see rs_fec.hpp) and the receiver rebuilds it from whichever
+ * n of its n + r segments arrive first rather than waiting for all n data segments.
+ * The n + r segments are at most MAX_SEGS (what one iblt peel carries) so fewer
+ * repair segments are sent for the largest messages and a MAX_SEGS segment
+ * message is sent without them.
  */
 
 struct mbps;
@@ -68,15 +81,34 @@ struct mbpsMsg : mbpsPub {
 // (defined in library as a string and a value that is a legal parmeter type)
 using msgParms = std::vector<parItem>;
 using msgHndlr = std::function<void(mbps&, const mbpsMsg&, std::vector<uint8_t>&)>;
+// stream data: 'len' bytes at offset 'off' of the message. 'last' is set on its final range.
+using streamHndlr = std::function<void(mbps&, const mbpsMsg&, size_t off, std::span<const uint8_t>, bool last)>;
+// returns the parameters to publish a repair request for the message that 'msg' is a piece of
+using nackParmsCb = std::function<msgParms(const mbpsMsg& msg)>;
 using connectCb = std::function<void()>;
 using confHndlr = std::function<void(const bool, const uint32_t)>;
 
 using error = std::runtime_error;
 using MsgID = uint32_t;
 using SegCnt = uint16_t;
-using MsgInfo = std::unordered_map<MsgID,std::bitset<64>>;
 using MsgSegs = std::vector<uint8_t>;
-using MsgCache = std::unordered_map<MsgID,MsgSegs>;
+
+// sCnt value that marks a publication carrying several aggregated messages (single
+// piece messages have an sCnt of 0 and multi-piece an sCnt of (k << 8) | n with k >= 1)
+static constexpr SegCnt AGG_CNT = 1;
+static constexpr size_t AGG_HDR = 2;    // each aggregated message is preceded by its 2 byte length
+
+// sCnt value that marks a repair request: its msgID is the message it's for and its
+// content lists the (0-based) indices of the pieces wanted
+static constexpr SegCnt NACK_CNT = 2;
+
+// sCnt of segment k (1-based) of an n segment stream is STREAM_CNT | k << 24 | n
+static constexpr uint64_t STREAM_CNT = 1ull << 48;
+static constexpr size_t MAX_STREAM_SEGS = (1u << 24) - 1;
+
+// sCnt of piece i (0-based, data pieces then repair pieces) of a message of 'len'
+// bytes sent as n data and r repair pieces is FEC_CNT | len << 24 | i << 16 | r << 8 | n
+static constexpr uint64_t FEC_CNT = 1ull << 49;
 
 struct mbps
 {   
@@ -84,16 +116,115 @@ struct mbps
     DirectFace m_face;
     DCTmodel m_pb;
     crName m_pubpre{};        // full prefix for Publications
+    DCTmodel::Field<uint64_t> m_sCnt;   // accessors for the pub name components mbps uses
+    DCTmodel::Field<uint64_t> m_msgID;
     std::string m_uniqId{};   //create this from #chainInfo to use in creating message Ids
-    std::unordered_map<MsgID, confHndlr> m_msgConfCb;
-    MsgInfo m_pending{};    // unconfirmed published messages
-    MsgInfo m_received{};   //received publications of a message
-    MsgCache m_reassemble{}; //reassembly of received message segments
+    using Clock = std::chrono::steady_clock;
+    // confirmation state of a published message that asked for confirmation
+    struct MsgConf {
+        confHndlr ch{};
+        std::bitset<2*MAX_SEGS> got{};  // pieces confirmed
+        size_t n{1};                    // pieces
+        Clock::time_point start{Clock::now()};
+        size_t spare{};                 // pieces that can fail (FEC repair pieces)
+        size_t lost{};                  // pieces that failed
+    };
+    std::unordered_map<MsgID, MsgConf> m_msgConf{};
+    using ownedParms = std::vector<std::pair<std::string,paramVal>>;
+    // reassembly of a received multi-piece message
+    struct Partial {
+        MsgSegs msg{};
+        std::bitset<MAX_SEGS> got{};    // pieces received
+        Clock::time_point last{};       // when it last made progress
+        size_t n{};                     // pieces
+        uint32_t nacks{};               // repair requests sent
+        ownedParms nackParms{};
+        size_t bytes{};                 // memory held (counted in m_rsBytes)
+        size_t len{};                   // FEC messages: message size (0 if not FEC)
+        size_t r{};                     //  repair pieces sent
+        std::vector<std::pair<size_t,MsgSegs>> rep{}; // repair pieces received (index, content)
+    };
+    std::unordered_map<MsgID, Partial> m_partial{};
+    std::unordered_map<MsgID, Clock::time_point> m_recent{};    // recently completed multi-piece msgs
+
+    // Selective repair: a receiver whose partial message has made no progress for a pub
+    // lifetime publishes a repair request (NACK) listing its missing pieces, up to
+    // m_maxNacks times. Publishers that keep a repair cache republish those pieces
+    // (same msgID & sCnt, new mts). Requests are published with the parameters from
+    // m_nackParms so the app chooses a topic the publisher subscribes to.
+    struct Sent {
+        ownedParms parms{};             // message parameters (without mts, msgID & sCnt)
+        MsgSegs data{};
+        size_t n{};
+        Clock::time_point at{};
+        Clock::time_point repaired{};
+    };
+    nackParmsCb m_nackParms{};
+    uint32_t m_maxNacks{3};
+    size_t m_repairBytes{};             // repair cache size (0 = no cache)
+    size_t m_sentBytes{};
+    std::unordered_map<MsgID, Sent> m_sent{};
+
+    // Partial messages and streams are dropped if they make no progress for m_rsAge (0 means
+    // twice the pub lifetime plus clock skew, after which missing pieces can't arrive) and the
+    // memory they hold is capped at m_rsBudget bytes by dropping the oldest.
+    struct Stats {
+        uint64_t abandoned{};       // partial messages/streams that timed out
+        uint64_t evicted{};         // partial messages/streams dropped to stay within budget
+        uint64_t confTimeouts{};    // confirmations that never came
+    };
+    std::chrono::milliseconds m_rsAge{0};
+    size_t m_rsBudget{64u << 20};
+    size_t m_rsBytes{};
+    Stats m_stats{};
+    TimerHandle m_sweepTimer{};
+    std::vector<MsgSegs> m_bufPool{};   // spare message buffers (kept for their capacity)
+    static constexpr size_t maxPoolBufs = 8;
     Timer* m_timer;
 
+    // Aggregation of small messages: messages with the same parameters published within
+    // 'm_aggDelay' of each other are packed into one Publication (one signature, one
+    // collection entry) with a content of <length><message> records.
+    struct AggQ {
+        std::vector<std::pair<std::string,paramVal>> parms{};   // (owned copy of) message parameters
+        std::vector<uint8_t> content{};                         // packed messages
+        std::vector<std::pair<MsgID,confHndlr>> confs{};        // confirmation callbacks of packed msgs
+        uint32_t gen{};                                         // incremented when flushed
+    };
+    std::chrono::microseconds m_aggDelay{0};   // latency budget (0 = don't aggregate)
+    std::unordered_map<std::string,AggQ> m_aggQ{};
+    std::unordered_map<MsgID,std::vector<std::pair<MsgID,confHndlr>>> m_aggConf{};
+
+    // Streams: an outgoing stream owns its data and publishes its next segment as each
+    // one in flight is confirmed. An incoming stream holds the segments that arrived
+    // ahead of the next one to deliver (or, with no streamHndlr, the whole message).
+    struct OutStream {
+        ownedParms parms{};     // message parameters (with mts & msgID)
+        std::vector<uint8_t> data{};
+        size_t n{};         // segments
+        size_t next{};      // segments published
+        size_t inFlight{};  // published but not yet confirmed
+        size_t done{};      // confirmed
+        confHndlr ch{};
+    };
+    struct InStream {
+        std::vector<bool> have{};       // segments received
+        std::map<size_t,MsgSegs> ahead{};
+        MsgSegs msg{};                  // contiguous data (when there's no streamHndlr)
+        size_t next{};                  // next segment to deliver
+        size_t bytes{};                 // memory held (counted in m_rsBytes)
+        Clock::time_point last{};       // when it last got a segment
+    };
+    size_t m_streamWin{32};  // stream segments in flight
+    unsigned m_fecPct{};     // FEC repair segments as a percentage of data segments (0 = off)
+    std::unordered_map<MsgID,OutStream> m_outStreams{};
+    std::unordered_map<MsgID,InStream> m_inStreams{};
+    streamHndlr m_streamHndlr{};
+
     mbps(const certCb& rootCb, const certCb& schemaCb, const chainCb& idChainCb, const pairCb& signIdCb, std::string_view addr)
         : m_face{addr}, m_pb{rootCb, schemaCb, idChainCb, signIdCb, m_face},
-          m_pubpre{m_pb.pubPrefix()}  { }
+          m_pubpre{m_pb.pubPrefix()}, m_sCnt{m_pb.field<uint64_t>("sCnt")},
+          m_msgID{m_pb.field<uint64_t>("msgID")}  { }
 
     mbps(const certCb& rootCb, const certCb& schemaCb, const chainCb& idChainCb, const pairCb& signIdCb)
         : mbps(rootCb, schemaCb, idChainCb, signIdCb, "")  { }
@@ -160,6 +291,19 @@ struct mbps
         return *this;
     }
 
+    /*
+     * Pack messages of at most 'maxSize' bytes that are published with identical
+     * parameters within 'delay' of one another into a single Publication which is
+     * split back into the individual messages on delivery. All the members of a trust
+     * zone must use aggregation if any do (older receivers discard aggregated pubs).
+     * Each message handler call for an aggregated message gets the aggregate's mbpsMsg
+     * so its msgID and mts are those of the aggregate.
+     */
+    mbps& aggregate(std::chrono::microseconds delay) {
+        m_aggDelay = delay;
+        return *this;
+    }
+
     /*
      * receivePub() is called when a new Publication (carrying a message segment) is
      * received in a subscribed topic.
@@ -172,6 +316,8 @@ struct mbps
      * returns all the tags of a publication
      *
      * This receivePub guarantees in-order delivery of Publications within a message.
+     * Message buffers come from a small pool so, in steady state, delivering a message
+     * costs one copy of its content and no allocation.
      *
      * If in-order delivery is required across messages from an origin for a particular
      * application, messages can be held by their origin and timestamp until ordering can
@@ -180,39 +326,425 @@ struct mbps
      void receivePub(const Publication& pub, const msgHndlr& mh)
      {      
         const auto& p = mbpsPub(pub);
+        auto sc = m_sCnt(p);
+        if (sc & STREAM_CNT) {
+            receiveStream(p, sc, mh);
+            return;
+        }
+        if (sc & FEC_CNT) {
+            receiveFec(p, sc, mh);
+            return;
+        }
         //all the publication name ftags (in order) set by app or mbps
-        SegCnt k = p.number("sCnt"), n = 1u;
-        std::vector<uint8_t> msg{}; //for message body
+        SegCnt k = sc, n = 1u;
+        if (k == NACK_CNT) {
+            receiveNack(p);
+            return;
+        }
 
         auto content = p.content().rest();
-        if (k == 0) { //single publication in this message
-            if(auto sz = content.size()) msg.assign(content.data(), content.data() + sz);
+        if (k == 0 || k == AGG_CNT) {
+            auto msg = getBuf(content.size()); //for message body
+            deliver(p, content, k == AGG_CNT, msg, mh);
+            putBuf(std::move(msg));
+            return;
+        }
+        MsgID mId = m_msgID(p);
+        n = 255 & k;    //bottom byte
+        k >>= 8;
+        if (k > n || k == 0 || n > MAX_SEGS) {
+            print("receivePub: msgID {} piece {} > n pieces\n", m_msgID(p), k, n);
+            return;
+        }
+        // reassemble message: each segment is copied once, into its place in the buffer
+        const auto& m = content;
+        auto r = m_partial.find(mId);
+        if (r == m_partial.end()) {
+            if (m_recent.contains(mId)) return;     // a repaired piece of a msg that's been delivered
+            if (! reserveRs(n*MAX_CONTENT)) return;
+            r = m_partial.emplace(mId, Partial{getBuf(n*MAX_CONTENT), {}, {}, n}).first;
+            r->second.bytes = r->second.msg.capacity();
+            m_rsBytes += r->second.bytes;
+            if (m_nackParms) r->second.nackParms = own(m_nackParms(mbpsMsg(p)));
+            armSweep();
+        }
+        r->second.last = Clock::now();
+        auto& dst = r->second.msg;
+        if (k == n)
+            dst.resize((n-1)*MAX_CONTENT+m.size());
+        else if (dst.size() == 0)
+            dst.resize(n*MAX_CONTENT);
+        std::copy(m.begin(), m.end(), dst.begin()+(--k)*MAX_CONTENT);
+        r->second.got.set(k);
+        if (r->second.got.count() != n) return; // all segments haven't arrived
+        // Complete message received: the reassembly buffer itself is handed to the msgHndlr
+        auto msg = std::move(dst);
+        dropPartial(r);
+        m_recent.emplace(mId, Clock::now());
+        mh(*this, mbpsMsg(p), msg);
+        putBuf(std::move(msg));
+    }
+
+    /*
+     * Piece i of an FEC message: data pieces are copied into place in the reassembly
+     * buffer and repair pieces are kept until there are n pieces, when any missing data
+     * pieces are rebuilt from them. Pieces beyond the first n are ignored.
+     */
+    void receiveFec(const mbpsPub& p, uint64_t sc, const msgHndlr& mh) {
+        MsgID mId = m_msgID(p);
+        size_t n = sc & 255, r = (sc >> 8) & 255, i = (sc >> 16) & 255, len = (sc >> 24) & 0xffff;
+        auto m = p.content().rest();
+        if (n < 2 || r == 0 || n + r > MAX_SEGS || i >= n + r ||
+            len <= (n - 1) * MAX_CONTENT || len > n * MAX_CONTENT ||
+            m.size() != (i < n? std::min(MAX_CONTENT, len - i * MAX_CONTENT) : MAX_CONTENT)) {
+            print("receiveFec: msgID {} bad piece {} of {}+{}\n", mId, i, n, r);
+            return;
+        }
+        auto e = m_partial.find(mId);
+        if (e == m_partial.end()) {
+            if (m_recent.contains(mId)) return;
+            if (! reserveRs(n*MAX_CONTENT)) return;
+            e = m_partial.emplace(mId, Partial{getBuf(n*MAX_CONTENT), {}, {}, n}).first;
+            auto& pm = e->second;
+            pm.msg.assign(n*MAX_CONTENT, 0);    // rebuilding needs the last piece zero padded
+            pm.len = len;
+            pm.r = r;
+            pm.bytes = pm.msg.capacity();
+            m_rsBytes += pm.bytes;
+            armSweep();
+        }
+        auto& pm = e->second;
+        if (pm.len != len || pm.r != r || pm.n != n) return;    // not the same message
+        if (i < n) {
+            if (pm.got[i]) return;
+            std::copy(m.begin(), m.end(), pm.msg.begin() + i * MAX_CONTENT);
+            pm.got.set(i);
         } else {
-            MsgID mId = p.number("msgID");
-            n = 255 & k;    //bottom byte
-            k >>= 8;
-            if (k > n || k == 0 || n > MAX_SEGS) {
-                print("receivePub: msgID {} piece {} > n pieces\n", p.number("msgID"), k, n);
-                return;
+            if (std::ranges::any_of(pm.rep, [j = i - n](const auto& x){ return x.first == j; })) return;
+            if (! reserveRs(MAX_CONTENT, &pm)) return;
+            pm.rep.emplace_back(i - n, MsgSegs(m.begin(), m.end()));
+            pm.bytes += pm.rep.back().second.capacity();
+            m_rsBytes += pm.rep.back().second.capacity();
+        }
+        pm.last = Clock::now();
+        if (pm.got.count() + pm.rep.size() < n) return;
+        if (! rsCode::decode(std::span(pm.msg), MAX_CONTENT, n, r, [&pm](size_t k){ return pm.got[k]; }, pm.rep)) {
+            print("receiveFec: msgID {} can't be rebuilt\n", mId);
+            return;
+        }
+        auto msg = std::move(pm.msg);
+        msg.resize(len);
+        dropPartial(e);
+        m_recent.emplace(mId, Clock::now());
+        mh(*this, mbpsMsg(p), msg);
+        putBuf(std::move(msg));
+    }
+
+    // owned copy of message parameters (string views become strings) and a view of one
+    static ownedParms own(const msgParms& mp) {
+        ownedParms o{};
+        for (const auto& [tag, val] : mp) {
+            if (auto sv = std::get_if<std::string_view>(&val)) o.emplace_back(tag, std::string(*sv));
+            else o.emplace_back(tag, val);
+        }
+        return o;
+    }
+    static msgParms view(const ownedParms& o) {
+        msgParms mp{};
+        for (const auto& [tag, val] : o) mp.emplace_back(tag, val);
+        return mp;
+    }
+
+    // ask the publisher(s) of partial message 'mId' to resend its missing pieces
+    void sendNack(MsgID mId, Partial& r) {
+        std::vector<uint8_t> miss{};
+        for (size_t i = 0; i < r.n; ++i) if (! r.got[i]) miss.push_back(i);
+        auto mp = view(r.nackParms);
+        mp.emplace_back("mts", std::chrono::system_clock::now());
+        mp.emplace_back("msgID", mId);
+        mp.emplace_back("sCnt", NACK_CNT);
+        m_pb.publish(m_pb.pub(miss, mp));
+        ++r.nacks;
+        r.last = Clock::now();
+    }
+
+    /*
+     * A repair request: if its message is in the repair cache (and wasn't just repaired),
+     * republish the pieces it lists. If it's for a message I'm also missing pieces of, hold
+     * off on my own request since the repair is on its way.
+     */
+    void receiveNack(const mbpsPub& p) {
+        MsgID mId = m_msgID(p);
+        if (auto r = m_partial.find(mId); r != m_partial.end()) r->second.last = Clock::now();
+        auto s = m_sent.find(mId);
+        if (s == m_sent.end()) return;
+        auto& m = s->second;
+        auto now = Clock::now();
+        if (now - m.repaired < m_pb.m_sync.pubLifetime_ / 2) return; // already resending
+        m.repaired = now;
+        auto mp = view(m.parms);
+        mp.emplace_back("mts", std::chrono::system_clock::now());
+        mp.emplace_back("msgID", mId);
+        for (auto i : p.content().rest()) {
+            if (i >= m.n) continue;
+            mp.emplace_back("sCnt", (i + 1) << 8 | m.n);
+            auto off = i * MAX_CONTENT;
+            m_pb.publish(m_pb.pub(std::span(m.data).subspan(off, std::min(m.data.size() - off, MAX_CONTENT)), mp));
+            mp.pop_back();
+        }
+    }
+
+    // keep a copy of a multi-piece message for repair (dropping the oldest if over budget)
+    void cacheSent(MsgID mId, const msgParms& mp, std::span<const uint8_t> msg, size_t n) {
+        if (msg.size() > m_repairBytes) return;
+        // a re-sent mId replaces its entry so its bytes are only counted once
+        if (auto o = m_sent.find(mId); o != m_sent.end()) {
+            m_sentBytes -= o->second.data.size();
+            m_sent.erase(o);
+        }
+        while (m_sentBytes + msg.size() > m_repairBytes) {
+            auto o = std::ranges::min_element(m_sent, {}, [](const auto& e){ return e.second.at; });
+            m_sentBytes -= o->second.data.size();
+            m_sent.erase(o);
+        }
+        auto& s = m_sent[mId];
+        s.parms = own(mp);
+        s.data.assign(msg.begin(), msg.end());
+        s.n = n;
+        s.at = Clock::now();
+        m_sentBytes += msg.size();
+        armSweep();
+    }
+
+    // send repair requests for incomplete messages, using 'cb' for their parameters
+    mbps& repairRequests(const nackParmsCb& cb, uint32_t maxNacks = 3) {
+        m_nackParms = cb;
+        m_maxNacks = maxNacks;
+        return *this;
+    }
+    // keep up to 'bytes' of recently published multi-piece messages to answer repair requests
+    mbps& repairCache(size_t bytes) {
+        m_repairBytes = bytes;
+        return *this;
+    }
+
+    // a buffer for a message of up to 'sz' bytes, from the pool if there's one
+    MsgSegs getBuf(size_t sz) {
+        MsgSegs b{};
+        if (m_bufPool.size()) {
+            b = std::move(m_bufPool.back());
+            m_bufPool.pop_back();
+            b.clear();
+        }
+        b.reserve(sz);
+        return b;
+    }
+    // return a buffer to the pool (unless the msgHndlr took it)
+    void putBuf(MsgSegs&& b) {
+        if (b.capacity() && m_bufPool.size() < maxPoolBufs) m_bufPool.emplace_back(std::move(b));
+    }
+
+    // deliver the message(s) in a single-piece or aggregated ('agg') publication's content using 'msg' as
+    // the message buffer
+    void deliver(const mbpsPub& p, std::span<const uint8_t> content, bool agg, MsgSegs& msg, const msgHndlr& mh) {
+        if (agg) { // several small messages in this publication
+            const mbpsMsg mm(p);
+            for (size_t off = 0; off + AGG_HDR <= content.size(); ) {
+                size_t len = content[off] | content[off+1] << 8;
+                off += AGG_HDR;
+                if (len > content.size() - off) {
+                    print("receivePub: msgID {} aggregated msg truncated\n", m_msgID(p));
+                    return;
+                }
+                msg.assign(content.data() + off, content.data() + off + len);
+                off += len;
+                mh(*this, mm, msg);
             }
-            //reassemble message            
-            const auto& m = content;
-            auto& dst = m_reassemble[mId];
-            if (k == n)
-                dst.resize((n-1)*MAX_CONTENT+m.size());
-            else if (dst.size() == 0)
-                dst.resize(n*MAX_CONTENT);
-            std::copy(m.begin(), m.end(), dst.begin()+(--k)*MAX_CONTENT);
-            m_received[mId].set(k);
-            if (m_received[mId].count() != n) return; // all segments haven't arrived
-            msg = m_reassemble[mId];
-            m_received.erase(mId);  //delete msg state
-            m_reassemble.erase(mId);
-        }                
-        // Complete message received, prepare arguments for msgHndlr callback
+            return;
+        }
+        //single publication in this message
+        msg.assign(content.begin(), content.end());
         mh(*this, mbpsMsg(p), msg);
     }
 
+    /*
+     * Stream segments are delivered in order. A segment that arrives ahead of the next
+     * one to deliver is held. Otherwise it's passed (without a copy) to the streamHndlr
+     * followed by any held segments it makes contiguous. With no streamHndlr, the
+     * contiguous data is accumulated and passed to 'mh' when the stream completes.
+     * Held segments were delivered under the name of the segment that released them
+     * (names differ only in their sCnt).
+     */
+    void receiveStream(const mbpsPub& p, uint64_t sc, const msgHndlr& mh) {
+        MsgID mId = m_msgID(p);
+        size_t n = sc & MAX_STREAM_SEGS, k = (sc >> 24) & MAX_STREAM_SEGS;
+        if (k > n || k == 0) {
+            print("receiveStream: msgID {} piece {} > n pieces\n", mId, k, n);
+            return;
+        }
+        auto it = m_inStreams.find(mId);
+        if (it == m_inStreams.end()) {
+            auto sz = n/8 + (m_streamHndlr? 0 : n*MAX_CONTENT);
+            if (! reserveRs(sz)) return;
+            it = m_inStreams.try_emplace(mId).first;
+            it->second.have.resize(n);
+            if (! m_streamHndlr) it->second.msg.reserve(n*MAX_CONTENT);
+            it->second.bytes = sz;
+            m_rsBytes += sz;
+            armSweep();
+        }
+        auto& s = it->second;
+        if (s.have.size() != n) return;
+        auto content = p.content().rest();
+        if (--k < s.next || s.have[k]) return;     // already have it
+        s.have[k] = true;
+        s.last = Clock::now();
+        if (k != s.next) {
+            if (! reserveRs(content.size())) return;
+            // (eviction could have dropped this stream)
+            if (it = m_inStreams.find(mId); it == m_inStreams.end()) return;
+            it->second.ahead.emplace(k, MsgSegs(content.begin(), content.end()));
+            it->second.bytes += content.size();
+            m_rsBytes += content.size();
+            return;
+        }
+        const mbpsMsg mm(p);
+        MsgSegs held{};
+        for (auto seg = content;;) {
+            auto off = s.next * MAX_CONTENT;
+            bool last = ++s.next == n;
+            if (m_streamHndlr) m_streamHndlr(*this, mm, off, seg, last);
+            else s.msg.insert(s.msg.end(), seg.begin(), seg.end());
+            if (last) {
+                auto msg = std::move(s.msg);
+                dropStream(it);
+                if (! m_streamHndlr) mh(*this, mm, msg);
+                return;
+            }
+            auto a = s.ahead.find(s.next);
+            if (a == s.ahead.end()) return;
+            held = std::move(a->second);
+            s.ahead.erase(a);
+            s.bytes -= held.size();
+            m_rsBytes -= held.size();
+            seg = held;
+        }
+    }
+
+    // (what's released is what was counted in: the reassembly buffer may have been
+    // moved out to hand the completed message to its handler)
+    void dropPartial(decltype(m_partial)::iterator r) {
+        m_rsBytes -= r->second.bytes;
+        m_partial.erase(r);
+    }
+    void dropStream(decltype(m_inStreams)::iterator s) {
+        m_rsBytes -= s->second.bytes;
+        m_inStreams.erase(s);
+    }
+
+    // drop the partial message (other than 'keep') or stream that's made no progress for longest.
+    // Returns false if there are none.
+    bool dropOldest(const Partial* keep = nullptr) {
+        auto r = m_partial.end();
+        for (auto e = m_partial.begin(); e != m_partial.end(); ++e) {
+            if (&e->second != keep && (r == m_partial.end() || e->second.last < r->second.last)) r = e;
+        }
+        auto s = std::ranges::min_element(m_inStreams, {}, [](const auto& e){ return e.second.last; });
+        if (r == m_partial.end() && s == m_inStreams.end()) return false;
+        if (s == m_inStreams.end() || (r != m_partial.end() && r->second.last < s->second.last)) dropPartial(r);
+        else dropStream(s);
+        return true;
+    }
+
+    // make room for 'sz' more bytes of reassembly state (for 'keep', if it's an existing
+    // partial message, which isn't evicted). Returns false if it won't fit.
+    bool reserveRs(size_t sz, const Partial* keep = nullptr) {
+        if (sz > m_rsBudget) {
+            ++m_stats.evicted;
+            return false;
+        }
+        while (m_rsBytes + sz > m_rsBudget && dropOldest(keep)) ++m_stats.evicted;
+        return true;
+    }
+
+    auto rsAge() const {
+        if (m_rsAge > 0ms) return m_rsAge;
+        return 2 * (m_pb.m_sync.pubLifetime_ + maxClockSkew);
+    }
+
+    // periodically drop reassembly and confirmation state that can no longer complete
+    void armSweep() {
+        if (m_sweepTimer.pending()) return;
+        m_sweepTimer = schedule(rsAge() / 2, [this]{ sweep(); });
+    }
+    void sweep() {
+        auto now = Clock::now();
+        auto old = now - rsAge();
+        // a partial message that's made no progress for a pub lifetime won't without a repair
+        auto stalled = now - (m_pb.m_sync.pubLifetime_ + maxClockSkew);
+        for (auto r = m_partial.begin(); r != m_partial.end(); ) {
+            auto nx = std::next(r);
+            auto& pm = r->second;
+            // (FEC messages aren't kept for repair)
+            if (m_nackParms && pm.len == 0 && pm.last < stalled && pm.nacks < m_maxNacks) sendNack(r->first, pm);
+            else if (pm.last < old) { dropPartial(r); ++m_stats.abandoned; }
+            r = nx;
+        }
+        std::erase_if(m_recent, [old](const auto& e){ return e.second < old; });
+        for (auto s = m_sent.begin(); s != m_sent.end(); ) {
+            auto nx = std::next(s);
+            if (s->second.at < old - rsAge()) {
+                m_sentBytes -= s->second.data.size();
+                m_sent.erase(s);
+            }
+            s = nx;
+        }
+        for (auto s = m_inStreams.begin(); s != m_inStreams.end(); ) {
+            auto nx = std::next(s);
+            if (s->second.last < old) { dropStream(s); ++m_stats.abandoned; }
+            s = nx;
+        }
+        std::vector<std::pair<MsgID,confHndlr>> failed{};
+        std::erase_if(m_msgConf, [&](auto& e) {
+                if (e.second.start >= old) return false;
+                failed.emplace_back(e.first, std::move(e.second.ch));
+                return true;
+            });
+        m_stats.confTimeouts += failed.size();
+        for (auto& [id, ch] : failed) ch(false, id);
+        if (m_partial.size() || m_inStreams.size() || m_msgConf.size() || m_recent.size() || m_sent.size()) armSweep();
+    }
+
+    // drop partial messages & streams with no progress for 'age' (0 = derive from the pub lifetime)
+    mbps& reassemblyAge(std::chrono::milliseconds age) {
+        m_rsAge = age;
+        return *this;
+    }
+    // cap the memory held by partial messages & streams
+    mbps& reassemblyBudget(size_t bytes) {
+        m_rsBudget = bytes;
+        return *this;
+    }
+    const Stats& stats() const noexcept { return m_stats; }
+
+    // the DCTmodel's memory report plus mbps's message state (call from the face's thread)
+    MemReport memoryReport() const {
+        auto r = m_pb.memoryReport();
+        r.add("mbps reassembly", m_partial.size() + m_inStreams.size(),
+              m_rsBytes + mem::hash(m_partial) + mem::hash(m_inStreams) + mem::hash(m_recent));
+        size_t b = mem::hash(m_sent);
+        for (const auto& [_, s] : m_sent) b += s.data.capacity();
+        r.add("mbps sent (for repair)", m_sent.size(), b);
+        b = mem::hash(m_outStreams);
+        for (const auto& [_, s] : m_outStreams) b += s.data.capacity();
+        r.add("mbps out streams", m_outStreams.size(), b);
+        b = mem::hash(m_aggQ) + mem::hash(m_aggConf);
+        for (const auto& [_, q] : m_aggQ) b += q.content.capacity() + mem::vec(q.confs);
+        r.add("mbps aggregation", m_aggQ.size(), b);
+        r.add("mbps confirmations", m_msgConf.size(), mem::hash(m_msgConf));
+        return r;
+    }
+
     /*
      * Confirms whether Publication made it to the Collection.
      * If "at least once" semantics are desired, the confirmPublication
@@ -230,26 +762,48 @@ struct mbps
     void confirmPublication(const Publication& pub, bool success)
     {
         const mbpsPub& p = mbpsPub(pub);
-        MsgID mId = p.number("msgID");
-        SegCnt k = p.number("sCnt"), n = 1u;
-        if (k != 0) {
-            // Don't need to keep state for single piece msgs but multi-piece succeed
-            // only if all their pieces arrive and fail otherwise. Keep per-msg arrival
-            // state in a bitmap that's created on-demand and erased on completion or timeout.
-            n = k & 255;
+        MsgID mId = m_msgID(p);
+        uint64_t k = m_sCnt(p);
+        if (k & STREAM_CNT) {
+            streamConfirm(mId, success);
+            return;
+        }
+        if (k & FEC_CNT) {
+            // a FEC message succeeds if enough pieces to rebuild it arrive
+            auto it = m_msgConf.find(mId);
+            if (it == m_msgConf.end()) return;
+            auto& m = it->second;
             if (success) {
-                m_pending[mId].set(k >> 8);
-                if (m_pending[mId].count() != n) return; // all pieces haven't arrived
+                if (auto i = (k >> 16) & 255; i < m.n) m.got.set(i);
+                if (m.got.count() < m.n - m.spare) return;
+            } else if (++m.lost <= m.spare) return;
+            auto ch = std::move(m.ch);
+            m_msgConf.erase(it);
+            ch(success, mId);
+            return;
+        }
+        if (k == AGG_CNT) {
+            // confirm each of the aggregated messages that asked for confirmation
+            if (auto a = m_aggConf.find(mId); a != m_aggConf.end()) {
+                auto confs = std::move(a->second);
+                m_aggConf.erase(a);
+                for (auto& [id, ch] : confs) ch(success, id);
             }
-            // either msg complete or piece timed out so delivery has failed - delete msg state
-            if (m_pending.contains(mId)) m_pending.erase(mId);
+            return;
         }
-        try {
-            m_msgConfCb.at(mId)(success,mId);
-        } catch (...) {
-                //no confCb for this message, do nothing
+        auto it = m_msgConf.find(mId);
+        if (it == m_msgConf.end()) return;  // no confCb for this message (or it's already failed)
+        auto& m = it->second;
+        // multi-piece msgs succeed only if all their pieces arrive and fail otherwise
+        if (success && k != 0) {
+            auto i = ((k >> 8) & 255) - 1;
+            if (i < m.n) m.got.set(i);
+            if (m.got.count() != m.n) return; // all pieces haven't arrived
         }
-        m_msgConfCb.erase(mId); //used the callback so erase
+        // either msg complete or piece timed out - delete msg state
+        auto ch = std::move(m.ch);
+        m_msgConf.erase(it);
+        ch(success, mId);
     }
 
     /*
@@ -285,26 +839,30 @@ struct mbps
          * msgID is an uint32_t hash of the message, incorporating ID and timestamp to make unique
          */
         auto size = msg.size();
+        if (size > MAX_SEGS * MAX_CONTENT)  // too many segments for a message so stream it
+            return publishStream(std::move(mp), std::vector<uint8_t>(msg.begin(), msg.end()), confHndlr{ch});
         auto mts = std::chrono::system_clock::now();
-        mp.emplace_back("mts", mts);
-
-        uint64_t tms = duration_cast<std::chrono::microseconds>(mts.time_since_epoch()).count();
-        std::vector<uint8_t> emsg;
-        for(size_t i=0; i<sizeof(tms); i++)
-            emsg.push_back( tms >> i*8 );
-        emsg.insert(emsg.end(), m_uniqId.begin(), m_uniqId.end());
-        emsg.insert(emsg.end(), msg.begin(),msg.end());
-        std::array<uint8_t, 4> h;        //so fits in uint32_t
-        crypto_generichash(h.data(), h.size(), emsg.data(), emsg.size(), NULL, 0);
-        uint32_t mId = h[0] | h[1] << 8 | h[2] << 16 | h[3] << 24;
-        mp.emplace_back("msgID", mId);
-
+        auto mId = msgID(mts, msg);
+        if (m_aggDelay.count() > 0 && size + AGG_HDR <= MAX_CONTENT) {
+            aggPublish(std::move(mp), msg, mId, confHndlr{ch});
+            return mId;
+        }
         // determine number of message segments: sCnt forces n < 256,
-        // iblt is sized for 80 but 64 fits in an int bitset
+        // iblt is sized for 80 but 64 fits in an int bitset. Larger messages are streamed.
         size_t n = (size + (MAX_CONTENT - 1)) / MAX_CONTENT;
-        if(n > MAX_SEGS) throw error("publishMsg: message too large");
+        if (n > 1 && n < MAX_SEGS && m_fecPct) {
+            publishFec(std::move(mp), msg, mts, mId, n, ch);
+            return mId;
+        }
+        if (n > 1 && m_repairBytes) cacheSent(mId, mp, msg, n);
+        mp.emplace_back("mts", mts);
+        mp.emplace_back("msgID", mId);
         auto sCnt = n > 1? n + 256 : 0;
         mp.emplace_back("sCnt", sCnt);
+        if(ch) {
+            m_msgConf[mId] = MsgConf{ch, {}, std::max(n, size_t(1))};    //set mesg confirmation callback
+            armSweep();
+        }
 
         if(size == 0) { //empty message body
             if(ch)
@@ -327,48 +885,187 @@ struct mbps
             mp.pop_back();   //sCnt is last argument on the list
             mp.emplace_back("sCnt", sCnt);
         }
-        if(ch) {
-            m_msgConfCb[mId] = std::move(ch);    //set mesg confirmation callback
+        return mId;
+    }
+
+    /*
+     * Publish the n data pieces of FEC message 'msg' followed by its repair pieces
+     * (m_fecPct percent of n, at least one and no more than fit in MAX_SEGS pieces).
+     */
+    void publishFec(msgParms&& mp, std::span<const uint8_t> msg, std::chrono::system_clock::time_point mts,
+                    MsgID mId, size_t n, const confHndlr& ch) {
+        size_t r = std::clamp<size_t>((n * m_fecPct + 99) / 100, 1, MAX_SEGS - n);
+        mp.emplace_back("mts", mts);
+        mp.emplace_back("msgID", mId);
+        if (ch) {
+            m_msgConf[mId] = MsgConf{ch, {}, n + r, Clock::now(), r};
+            armSweep();
+        }
+        const uint64_t sc = FEC_CNT | uint64_t(msg.size()) << 24 | r << 8 | n;
+        for (size_t i = 0; i < n + r; ++i) {
+            mp.emplace_back("sCnt", sc | i << 16);
+            auto pub = i < n? m_pb.pub(rsCode::shard(msg, i, MAX_CONTENT), mp) :
+                              m_pb.pub(rsCode::encode(msg, MAX_CONTENT, i - n, r), mp);
+            if (ch) m_pb.publish(std::move(pub), [this](auto p, bool s) { confirmPublication(mbpsPub(p),s); });
+            else m_pb.publish(std::move(pub));
+            mp.pop_back();
         }
+    }
+
+    // send 'pct' percent more segments than a multi-segment message needs as FEC repair segments (0 = off)
+    mbps& fec(unsigned pct) {
+        m_fecPct = pct;
+        return *this;
+    }
+
+    /*
+     * Publish 'data' as a stream of segments with at most m_streamWin of them unconfirmed at any
+     * time. 'ch' is called with true when all the segments have been confirmed or with false
+     * as soon as one times out (the rest of the stream isn't sent).
+     */
+    MsgID publishStream(msgParms&& mp, std::vector<uint8_t>&& data, confHndlr&& ch = nullptr) {
+        size_t n = (data.size() + (MAX_CONTENT - 1)) / MAX_CONTENT;
+        if (n == 0 || n > MAX_STREAM_SEGS) throw error("publishStream: bad stream size");
+        auto mts = std::chrono::system_clock::now();
+        auto mId = msgID(mts, data);
+        if (m_outStreams.contains(mId)) throw error("publishStream: duplicate msgID");
+        auto& s = m_outStreams[mId];
+        s.parms = own(mp);
+        s.parms.emplace_back("mts", mts);
+        s.parms.emplace_back("msgID", mId);
+        s.data = std::move(data);
+        s.n = n;
+        s.ch = std::move(ch);
+        streamFill(s);
         return mId;
     }
 
-    // Can be used by application to schedule a cancelable timer. Note that
-    // this is expensive compared to a oneTime timer and should be used
-    // only for timers that need to be canceled before they fire.
-    pTimer schedule(std::chrono::microseconds d, TimerCb&& cb) { return m_pb.schedule(d, std::move(cb)); }
+    // publish an outgoing stream's segments until its window is full
+    void streamFill(OutStream& s) {
+        while (s.inFlight < m_streamWin && s.next < s.n) {
+            auto off = s.next * MAX_CONTENT;
+            auto len = std::min(s.data.size() - off, MAX_CONTENT);
+            ++s.next;
+            ++s.inFlight;
+            auto mp = view(s.parms);
+            mp.emplace_back("sCnt", STREAM_CNT | s.next << 24 | s.n);
+            m_pb.publish(m_pb.pub(std::span(s.data).subspan(off, len), mp),
+                         [this](auto p, bool ok) { confirmPublication(mbpsPub(p), ok); });
+        }
+    }
+
+    void streamConfirm(MsgID mId, bool success) {
+        auto it = m_outStreams.find(mId);
+        if (it == m_outStreams.end()) return;   // stream already failed
+        auto& s = it->second;
+        if (success) {
+            --s.inFlight;
+            if (++s.done < s.n) {
+                streamFill(s);
+                return;
+            }
+        }
+        auto ch = std::move(s.ch);
+        m_outStreams.erase(it);
+        if (ch) ch(success, mId);
+    }
+
+    // set the number of unconfirmed segments a stream can have in flight
+    mbps& streamWindow(size_t w) {
+        m_streamWin = std::max(w, size_t(1));
+        return *this;
+    }
+
+    // pass incoming streams to 'sh' a range at a time instead of as a complete message
+    mbps& streamHandler(const streamHndlr& sh) {
+        m_streamHndlr = sh;
+        return *this;
+    }
+
+    // msgID is an uint32_t hash of the message, incorporating ID and timestamp to make unique
+    MsgID msgID(std::chrono::system_clock::time_point mts, std::span<const uint8_t> msg) const {
+        uint64_t tms = duration_cast<std::chrono::microseconds>(mts.time_since_epoch()).count();
+        std::vector<uint8_t> emsg;
+        for(size_t i=0; i<sizeof(tms); i++)
+            emsg.push_back( tms >> i*8 );
+        emsg.insert(emsg.end(), m_uniqId.begin(), m_uniqId.end());
+        emsg.insert(emsg.end(), msg.begin(),msg.end());
+        std::array<uint8_t, 4> h;        //so fits in uint32_t
+        crypto_generichash(h.data(), h.size(), emsg.data(), emsg.size(), NULL, 0);
+        return h[0] | h[1] << 8 | h[2] << 16 | h[3] << 24;
+    }
+
+    /*
+     * Add a message to the aggregate for its parameters, flushing the aggregate first
+     * if the message won't fit. A new aggregate is flushed after the latency budget.
+     */
+    void aggPublish(msgParms&& mp, std::span<const uint8_t> msg, MsgID mId, confHndlr&& ch) {
+        std::string key{};
+        for (const auto& [tag, val] : mp) {
+            key += tag;
+            key += '\0';
+            std::visit(overloaded {
+                    [&key](std::monostate) { },
+                    [&key](const std::string& v) { key += v; },
+                    [&key](std::string_view v) { key += v; },
+                    [&key](uint64_t v) { key += std::to_string(v); },
+                    [&key](timeVal v) { key += std::to_string(v.time_since_epoch().count()); }
+                }, val);
+            key += '\0';
+        }
+        auto& q = m_aggQ[key];
+        if (q.content.size() + AGG_HDR + msg.size() > MAX_CONTENT) aggFlush(q);
+        if (q.content.empty()) {
+            if (q.parms.empty()) {
+                for (const auto& [tag, val] : mp) {
+                    // keep copies, not views, of string parameters
+                    if (auto sv = std::get_if<std::string_view>(&val)) q.parms.emplace_back(tag, std::string(*sv));
+                    else q.parms.emplace_back(tag, val);
+                }
+            }
+            m_pb.oneTime(m_aggDelay, [this, key, gen = q.gen] {
+                        if (auto a = m_aggQ.find(key); a != m_aggQ.end() && a->second.gen == gen) aggFlush(a->second);
+                    });
+        }
+        q.content.emplace_back(msg.size());
+        q.content.emplace_back(msg.size() >> 8);
+        q.content.insert(q.content.end(), msg.begin(), msg.end());
+        if (ch) q.confs.emplace_back(mId, std::move(ch));
+    }
+
+    void aggFlush(AggQ& q) {
+        ++q.gen;
+        if (q.content.empty()) return;
+        msgParms mp{};
+        for (const auto& [tag, val] : q.parms) mp.emplace_back(tag, val);
+        auto mts = std::chrono::system_clock::now();
+        auto aId = msgID(mts, q.content);
+        mp.emplace_back("mts", mts);
+        mp.emplace_back("msgID", aId);
+        mp.emplace_back("sCnt", AGG_CNT);
+        if (q.confs.empty()) {
+            m_pb.publish(m_pb.pub(q.content, mp));
+        } else {
+            m_aggConf[aId] = std::move(q.confs);
+            m_pb.publish(m_pb.pub(q.content, mp), [this](auto p, bool s) { confirmPublication(mbpsPub(p),s); });
+        }
+        q.content.clear();
+        q.confs.clear();
+    }
+
+    // Can be used by application to schedule a cancelable timer. The returned
+    // handle's cancel() stops the timer if it hasn't fired yet.
+    TimerHandle schedule(std::chrono::microseconds d, TimerCb&& cb) { return m_pb.schedule(d, std::move(cb)); }
 
     // schedule a call to 'cb' in 'd' microseconds (cannot be canceled)
     void oneTime(std::chrono::microseconds d, TimerCb&& cb) { m_pb.oneTime(d, std::move(cb)); }
 
-    //setting non-default orderPubCb in shim (for now)
-    // For commented code, add "ov" for second arg
-    bool robustPub(PubVec& pv, PubVec&){
-        //first do same as default and sort locally produced pubs
-        std::sort(pv.begin(), pv.end(), [](const auto& p1, const auto& p2){
-                return p1.name().last().toTimestamp() > p2.name().last().toTimestamp(); });
-        auto newPubs = false;   //indicate new publications on list
- /*      auto now = std::chrono::system_clock::now();
-          for(const auto& p : pv) {
-            if(p.reqSrv == 0) newPubs = true;
-            p.reqSrv = now;  // next time through, won't be new
-        }
-        if(ov.size() == 0) return newPubs;
-
-        //process others' pubs to see if I should resend
-        auto resendRst = now - 10 * cStateRegenInterval;
-        auto sendAt = now + 0.9*cStateRegenInterval;
-         for(const auto& p : ov) {
-            if(p.reqSrv < now && p.reqSrv > resendRst) {
-                pv.emplace_back(p);
-                p.reqSrv = now;
-            } else if(p.reqSrv == 0 || p.reqSrv < resendRst) p.reqSrv = sendAt;
-         }
-*/
-         return newPubs;
-    }
-    void setOrderPub() {
-    //    m_pb.orderPub([this](auto& pv1, auto& pv2) {return robustPub(pv1, pv2);});
+    // Resend other nodes' msgs peers are still missing after 'hold' so they get across
+    // partitioned meshes (see SyncPS::relayPubs). The resend times are kept per pub by
+    // syncps. 0 turns it off.
+    auto& robustPub(std::chrono::milliseconds hold = std::chrono::milliseconds(1200)) {
+        m_pb.relayPubs(hold);
+        return *this;
     }
 };
 
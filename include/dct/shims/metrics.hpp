@@ -0,0 +1,268 @@
+#ifndef DCT_SHIMS_METRICS_HPP
+#define DCT_SHIMS_METRICS_HPP
+#pragma once
+/*
+ * Export DCT counters in the Prometheus/OpenMetrics text format
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This is not intended as production code.
+ */
+
+/*
+ * 'Metrics' builds an exposition of the face, collection, distributor and
+ * mbps counters (see dct/face/counters.hpp) and table sizes. Its text can be
+ * served to a Prometheus scraper by a 'MetricsServer' (a minimal HTTP
+ * endpoint running on the face's io_context) or, where there's no IP, carried
+ * in an application's own pubs (e.g., an mbps message published every few
+ * seconds to a monitoring topic).
+ *
+ * Table sizes are read without locking so, like statsStr(), the metrics must
+ * be gathered on the face's thread (which is what MetricsServer does).
+ */
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include <dct/format.hpp>
+#include <dct/face/counters.hpp>
+#include "mbps.hpp"
+
+namespace dct {
+
+struct Metrics {
+    struct Family {
+        std::string name_;
+        std::string hdr_;       // HELP & TYPE lines
+        std::string samples_{};
+    };
+    std::vector<Family> fam_{};
+    std::unordered_map<std::string,size_t> idx_{};
+    std::string lbl_{};         // labels added to every sample
+
+    // 'labels' (e.g., 'node="gw1"') are added to every sample
+    explicit Metrics(std::string_view labels = "") : lbl_{labels} { }
+
+    // label value with '\', '"' & newline escaped
+    static std::string esc(std::string_view v) {
+        std::string s{};
+        for (auto c : v) {
+            if (c == '\\' || c == '"') s += '\\';
+            if (c == '\n') { s += "\\n"; continue; }
+            s += c;
+        }
+        return s;
+    }
+    static std::string label(std::string_view k, std::string_view v) { return format("{}=\"{}\"", k, esc(v)); }
+
+    // the samples of a family have to be contiguous so each is collected separately
+    Family& family(std::string_view name, std::string_view type, std::string_view help) {
+        auto [it, added] = idx_.try_emplace(std::string(name), fam_.size());
+        if (added) fam_.emplace_back(std::string(name), format("# HELP {} {}\n# TYPE {} {}\n", name, help, name, type));
+        return fam_[it->second];
+    }
+
+    void sample(Family& f, std::string_view suffix, std::string_view labels, auto v) {
+        if (lbl_.empty() && labels.empty()) { f.samples_ += format("{}{} {}\n", f.name_, suffix, v); return; }
+        auto sep = lbl_.size() && labels.size()? "," : "";
+        f.samples_ += format("{}{}{{{}{}{}}} {}\n", f.name_, suffix, lbl_, sep, labels, v);
+    }
+
+    auto& counter(std::string_view name, std::string_view help, std::string_view labels, uint64_t v) {
+        sample(family(name, "counter", help), "_total", labels, v);
+        return *this;
+    }
+    auto& gauge(std::string_view name, std::string_view help, std::string_view labels, double v) {
+        sample(family(name, "gauge", help), "", labels, v);
+        return *this;
+    }
+    // a Histogram's power-of-2 buckets are reported as cumulative 'le' buckets
+    auto& histogram(std::string_view name, std::string_view help, std::string_view labels, const Histogram& h) {
+        auto& f = family(name, "histogram", help);
+        auto sep = labels.size()? "," : "";
+        uint64_t cum{};
+        size_t last{};
+        for (size_t b = 0; b < Histogram::nBuckets - 1; ++b) if (h.b_[b].get()) last = b;
+        for (size_t b = 0; b <= last; ++b) {
+            cum += h.b_[b].get();
+            sample(f, "_bucket", format("{}{}le=\"{}\"", labels, sep, b == 0? 0 : (uint64_t(1) << b) - 1), cum);
+        }
+        sample(f, "_bucket", format("{}{}le=\"+Inf\"", labels, sep), h.count());
+        sample(f, "_count", labels, h.count());
+        sample(f, "_sum", labels, h.sum_.get());
+        return *this;
+    }
+
+    auto& add(const DirectFace& face, std::string_view labels = "") {
+        const auto& s = face.stats();
+        counter("dct_face_interests_in", "interests received", labels, s.interestsIn);
+        counter("dct_face_data_in", "data received", labels, s.dataIn);
+        counter("dct_face_other_in", "packets received that weren't an interest or data", labels, s.otherIn);
+        counter("dct_face_interests_out", "interests sent", labels, s.interestsOut);
+        counter("dct_face_data_out", "data sent", labels, s.dataOut);
+        counter("dct_face_unicast_out", "data sent only to the interest's sender", labels, s.unicastOut);
+        counter("dct_face_dup_interests", "received interests dropped as duplicates", labels, s.ditHits);
+        counter("dct_face_dup_data", "received data dropped as duplicates", labels, s.ddtHits);
+        counter("dct_face_rit_misses", "received interests no one registered for", labels, s.ritMisses);
+        counter("dct_face_unsolicited", "received data not matching a PIT entry", labels, s.unsolicited);
+        counter("dct_face_suppressed", "interests not sent because a peer just sent them", labels, s.suppressed);
+        counter("dct_face_timeouts", "PIT entries that timed out", labels, s.timeouts);
+        gauge("dct_face_pit_entries", "pending interests", labels, face.pit_.lt_.size());
+        gauge("dct_face_dit_entries", "duplicate interest table entries in use", labels, face.dit_.cnt_);
+        gauge("dct_face_timers", "scheduled timers", labels, face.timers_.size());
+        return *this;
+    }
+
+    auto& add(const SyncPS& sync, std::string_view labels = "") {
+        auto l = format("{}{}{}", labels, labels.size()? "," : "", label("coll", format("{}", sync.collName_)));
+        const auto& s = sync.stats();
+        gauge("dct_sync_pubs", "pubs in the collection", l, sync.pubs_.size());
+        gauge("dct_sync_subscriptions", "subscriptions", l, sync.pubCbs_.size());
+        gauge("dct_sync_rejected", "hashes of rejected pubs being remembered", l, sync.rejected_.size());
+        gauge("dct_sync_lifetime_seconds", "pub lifetime", l, std::chrono::duration<double>(sync.pubLifetime_).count());
+        counter("dct_sync_cstates_in", "peer cStates handled", l, s.cStatesIn);
+        counter("dct_sync_cstates_out", "cStates expressed", l, s.cStatesOut);
+        counter("dct_sync_cstate_deltas", "cStates sent as a change log", l, s.cStateDeltas);
+        counter("dct_sync_cstate_delta_miss", "peer change logs whose keyframe wasn't held", l, s.cStateDeltaMiss);
+        counter("dct_sync_cadds_in", "cAdds received", l, s.cAddsIn);
+        counter("dct_sync_cadds_invalid", "cAdds that failed validation", l, s.cAddsInvalid);
+        counter("dct_sync_cadds_limited", "cAdds dropped for their sender's validation limit", l, s.cAddsLimited);
+        counter("dct_sync_cadds_out", "cAdds sent", l, s.cAddsOut);
+        counter("dct_sync_cadds_reused", "cAdds reused without re-signing", l, s.cAddsReused);
+        counter("dct_sync_peel_ok", "iblt differences that peeled", l, s.peelOk);
+        counter("dct_sync_peel_fail", "iblt differences too big to peel", l, s.peelFail);
+        counter("dct_sync_peel_cached", "pending cState differences updated from a cached peel", l, s.peelCached);
+        counter("dct_sync_peel_class", "priority class differences that peeled when the full one didn't", l, s.peelClass);
+        counter("dct_sync_pubs_new", "new pubs received", l, s.pubsNew);
+        counter("dct_sync_pubs_dup", "received pubs already held or rejected", l, s.pubsDup);
+        counter("dct_sync_pubs_invalid", "received pubs expired or failing validation", l, s.pubsInvalid);
+        counter("dct_sync_pubs_limited", "received pubs skipped for their signer's validation limit", l, s.pubsLimited);
+        counter("dct_sync_pubs_over_quota", "received pubs refused for their signer's active pub quota", l, s.pubsOverQuota);
+        counter("dct_sync_blacklisted", "senders or signers blacklisted", l, s.blacklisted);
+        counter("dct_sync_pubs_delivered", "pubs given to subscribers", l, s.pubsDelivered);
+        counter("dct_sync_pubs_relayed", "other nodes' pubs resent to peers lacking them", l, s.pubsRelayed);
+        counter("dct_sync_pubs_local", "pubs published locally", l, s.pubsLocal);
+        histogram("dct_sync_cadd_pubs", "pubs per received cAdd", l, s.cAddPubs);
+        histogram("dct_sync_validate_us", "time to validate a cAdd's new pubs (us)", l, s.validateUs);
+        histogram("dct_sync_cadd_sign_us", "time to sign a cAdd (us)", l, s.cAddSignUs);
+        histogram("dct_sync_cadd_validate_us", "time to validate a received cAdd (us)", l, s.cAddValidateUs);
+        histogram("dct_sync_delivery_us", "pub creation to delivery (us)", l, s.deliveryUs);
+        histogram("dct_sync_net_us", "pub creation to kernel receive of its cAdd (us)", l, s.netUs);
+        histogram("dct_sync_rx_queue_us", "kernel receive to syncps getting a cAdd (us)", l, s.rxQueueUs);
+        histogram("dct_sync_process_us", "syncps getting a cAdd to pub delivery (us)", l, s.processUs);
+        return *this;
+    }
+
+    // the model's face, collections (including shards and distributors') and rekey times
+    auto& add(const DCTmodel& m, std::string_view labels = "") {
+        add(m.face_, labels);
+        add(m.m_sync, labels);
+        for (const auto& [_, s] : m.shards_) add(*s, labels);
+        add(m.m_ckd.m_sync, labels);
+        auto dist = [this, labels](const auto* d, std::string_view nm) {
+            if (! d) return;
+            add(d->m_sync, labels);
+            auto l = format("{}{}{}", labels, labels.size()? "," : "", label("dist", nm));
+            gauge("dct_dist_keymaker", "1 if this member is the distributor's keymaker", l, d->m_keyMaker);
+            histogram("dct_dist_rekey_us", "time to make and publish a new key (us)", l, d->m_rekeyUs);
+        };
+        dist(m.m_gkd, "gk");
+        dist(m.m_sgkd, "sgk");
+        dist(m.m_pgkd, "pgk");
+        dist(m.m_psgkd, "psgk");
+        return *this;
+    }
+
+    auto& add(const mbps& s, std::string_view labels = "") {
+        add(s.m_pb, labels);
+        gauge("dct_mbps_partial_msgs", "multi-pub messages being reassembled", labels, s.m_partial.size());
+        gauge("dct_mbps_in_streams", "streams being reassembled", labels, s.m_inStreams.size());
+        gauge("dct_mbps_reassembly_bytes", "memory held by reassembly", labels, s.m_rsBytes);
+        gauge("dct_mbps_pending_confs", "messages waiting for confirmation", labels, s.m_msgConf.size());
+        counter("dct_mbps_abandoned", "partial messages or streams that timed out", labels, s.m_stats.abandoned);
+        counter("dct_mbps_evicted", "partial messages or streams dropped to stay within budget", labels, s.m_stats.evicted);
+        counter("dct_mbps_conf_timeouts", "confirmations that never came", labels, s.m_stats.confTimeouts);
+        return *this;
+    }
+
+    std::string str() const {
+        std::string s{};
+        for (const auto& f : fam_) s += f.hdr_ + f.samples_;
+        return s + "# EOF\n";
+    }
+};
+
+/**
+ * A minimal HTTP endpoint answering every request on 'port' with the
+ * exposition made by 'gen' (called on the io_context's thread). It must
+ * outlive the io_context's run().
+ */
+struct MetricsServer {
+    using tcp = boost::asio::ip::tcp;
+    using Gen = std::function<std::string()>;
+
+    tcp::acceptor acc_;
+    Gen gen_;
+
+    MetricsServer(boost::asio::io_context& ioc, uint16_t port, Gen&& gen) :
+            acc_{ioc, tcp::endpoint(tcp::v6(), port)}, gen_{std::move(gen)} {
+        accept();
+    }
+    // serve metrics for 'm' (e.g., an mbps shim) on 'port' of its face's io_context
+    template<typename M>
+    MetricsServer(M& m, boost::asio::io_context& ioc, uint16_t port, std::string_view labels = "") :
+            MetricsServer(ioc, port, [&m, l=std::string(labels)]{ return Metrics{l}.add(m).str(); }) { }
+
+  private:
+    void accept() {
+        acc_.async_accept([this](boost::system::error_code ec, tcp::socket s) {
+                if (ec == boost::asio::error::operation_aborted) return;
+                if (! ec) serve(std::move(s));
+                accept();
+            });
+    }
+
+    // read the request's header then reply and close
+    void serve(tcp::socket&& sock) {
+        struct Conn {
+            tcp::socket s_;
+            boost::asio::streambuf in_{8192};
+            std::string out_{};
+        };
+        auto c = std::make_shared<Conn>(std::move(sock));
+        boost::asio::async_read_until(c->s_, c->in_, "\r\n\r\n", [this, c](boost::system::error_code ec, size_t) {
+                if (ec) return;
+                auto body = gen_();
+                c->out_ = format("HTTP/1.0 200 OK\r\nContent-Type: application/openmetrics-text; version=1.0.0; "
+                                 "charset=utf-8\r\nContent-Length: {}\r\nConnection: close\r\n\r\n{}", body.size(), body);
+                boost::asio::async_write(c->s_, boost::asio::buffer(c->out_), [c](boost::system::error_code, size_t) {
+                        boost::system::error_code e;
+                        c->s_.shutdown(tcp::socket::shutdown_both, e);
+                    });
+            });
+    }
+};
+
+} // namespace dct
+
+#endif  // DCT_SHIMS_METRICS_HPP
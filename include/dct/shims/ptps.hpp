@@ -25,17 +25,28 @@
  */
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <bitset>
+#include <chrono>
+#include <deque>
 #include <functional>
 #include <getopt.h>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <random>
+#include <set>
 #include <stdexcept>
+#include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <dct/syncps/syncps.hpp>
 #include <dct/schema/dct_model.hpp>
+#include "spsc_queue.hpp"
 
 namespace dct {
 
@@ -51,6 +62,101 @@ using connectCb = std::function<void()>;
 using pubCb = std::function<void(ptps*, const Publication&)>;
 using chnCb = std::function<void(ptps*, const rData, const certStore&)>;
 
+/*
+ * A pub being relayed to several DeftTs. It's copied once, into a shared immutable
+ * buffer that goes into every DeftT's collection (see sharedPub), and the result of checking it against a trust schema is cached by schema
+ * thumbprint (DeftTs with the same schema give the same answer) so a relay with N
+ * DeftTs checks each pub once per distinct schema rather than N-1 times. The DeftTs
+ * can be on different threads so the cache is locked.
+ */
+struct relayPub {
+    struct verdicts {
+        std::mutex m{};
+        std::vector<std::pair<std::vector<uint8_t>,bool>> v{};  // (schema thumbprint, valid)
+    };
+    sharedPub pub;
+    std::shared_ptr<verdicts> cache{std::make_shared<verdicts>()};
+
+    explicit relayPub(const Publication& p) : pub{std::make_shared<const Publication>(p)} { }
+
+    // is the pub valid under 'schema'? 'check()' is called if that isn't known yet
+    template<typename F>
+    bool valid(const std::vector<uint8_t>& schema, F&& check) const {
+        {
+            std::lock_guard lck(cache->m);
+            for (const auto& [s, ok] : cache->v) if (s == schema) return ok;
+        }
+        bool ok = check();
+        std::lock_guard lck(cache->m);
+        cache->v.emplace_back(schema, ok);
+        return ok;
+    }
+};
+
+/*
+ * Pubs seen by a relay on any of its DeftTs. A pub that arrives on one DeftT is relayed
+ * to all the others so, in a mesh, the copies that later arrive on those DeftTs (via
+ * other relays) have nothing left to do and are dropped here, before any per-DeftT
+ * work. Pubs are identified by their sync hash (the same identity their collections
+ * use) and remembered for as long as they can be live, their max lifetime plus clock
+ * skew. The DeftTs can be on different threads so it's locked.
+ */
+struct relayFilter {
+    using Clock = std::chrono::steady_clock;
+    using PubHash = SyncPS::PubHash;
+
+  private:
+    std::mutex m_{};
+    std::unordered_map<PubHash,Clock::time_point> seen_{};
+    std::deque<std::pair<Clock::time_point,PubHash>> order_{};  // oldest first
+    Clock::duration hold_;
+
+  public:
+    relayFilter(Clock::duration hold = maxPubLifetime + maxClockSkew) : hold_{hold} { }
+
+    // true the first time 'p' is seen (within the hold time), false for its copies
+    bool firstSighting(const rPub& p, Clock::time_point now = Clock::now()) {
+        auto h = SyncPS::hashPub(p);
+        std::lock_guard lck(m_);
+        while (order_.size() && now - order_.front().first > hold_) {
+            if (auto s = seen_.find(order_.front().second); s != seen_.end() && s->second == order_.front().first)
+                seen_.erase(s);
+            order_.pop_front();
+        }
+        if (! seen_.try_emplace(h, now).second) return false;
+        order_.emplace_back(now, h);
+        return true;
+    }
+    auto size() { std::lock_guard lck(m_); return seen_.size(); }
+};
+
+/*
+ * The topics (the name component following the pub prefix) a DeftT's trust schema
+ * allows. It's derived from the schema's templates when the DeftT is created and
+ * never changes after so relays can consult any DeftT's rule from any thread to
+ * skip DeftTs that can't accept a pub. It's conservative: a template whose topic
+ * isn't a literal (a parameter or correspondence) admits every topic.
+ */
+struct topicRule {
+    size_t plen_{};                 // number of components in the pub prefix
+    bool any_{};                    // schema allows any topic
+    std::set<std::string,std::less<>> topics_{};
+
+    topicRule() = default;
+    topicRule(const bSchema& bs, const rName& pubPrefix) : plen_{pubPrefix.nBlks()} {
+        for (const auto& t : bs.tmplt_) {
+            if (t.size() <= plen_) continue;
+            if (auto c = t[plen_]; isLit(c) && c < bs.tok_.size()) topics_.emplace(bs.tok_[c]);
+            else any_ = true;
+        }
+    }
+    bool admits(const rName& nm) const noexcept {
+        if (any_) return true;
+        try { return topics_.contains(nm[plen_].toSv()); } catch (const std::exception&) { }
+        return false;
+    }
+};
+
 /* 
  * ptps (pass-through publish/subscribe) provides a DeftT pub/sub
  * API where the information unit is the same as that used by the
@@ -73,17 +179,30 @@ struct DCTmodelPT final : DCTmodel  {
     SyncPS* m_gkSync{};
     std::unordered_map<thumbPrint,bool> m_rlyCerts {};
     bool m_pubDist;
+    bool m_relaying{false};  // adding certs relayed from another DeftT
     addChnCb m_rlyCertCb{};  //used to relay validated cert chain to shim
 
     bool wasRelayed(thumbPrint tp) { return m_rlyCerts.count(tp);}
     void addRelayed(thumbPrint tp) { m_rlyCerts[tp] = true;}
 
+    // add cert 'c' (thumbprint 'tp') relayed from another DeftT. Its publication
+    // is batched with the other relayed certs (see DistCert::publishRelayed).
+    void addRelayedCert(rData c, const thumbPrint& tp) {
+        m_relaying = true;
+        addCert(c, tp);
+        m_relaying = false;
+    }
+
+    // true if this DeftT knows the signer of 'pub' (i.e., has its structural validator).
+    // Unlike the match itself, this can differ between DeftTs with the same schema.
+    bool knowsSigner(rData pub) const { return pv_.contains(dctCert::getKeyLoc(pub)); }
+
     // ensure a publication is structurally valid on the outgoing DeftT
-    bool isValidPub(const Publication& pub) {
+    bool isValidPub(rData pub) {
         // structurally validate 'pub'
         try {
             const auto& pubval = pv_.at(dctCert::getKeyLoc(pub));
-            return pubval.matchTmplt(bs_, pub.name());
+            return pubval->matchTmplt(bs_, pub.name());
         } catch (std::exception&) {}
         return false;
     }
@@ -113,7 +232,9 @@ struct DCTmodelPT final : DCTmodel  {
 
         // change the cert store's callback so adding a valid cert will relay the signing cert chain 
         cs_.addCb_ = [this, &ckd=m_ckd] (const dctCert& cert) {
-                           ckd.publishCert(cert);
+                           if (m_relaying) ckd.publishRelayed(cert);
+                           else ckd.publishCert(cert);
+                           addSigner(cert, cert.computeThumbPrint());
                            if (isSigningCert(cert) && !wasRelayed(cert.computeThumbPrint())) {
                                //pass the signing cert and the cert store containing its chain
                                m_rlyCertCb(cert, certs());
@@ -128,6 +249,7 @@ struct ptps
     DirectFace m_face;
     DCTmodelPT m_pb;
     crName m_pubpre{};     // full prefix for Publications
+    topicRule m_topics{};  // topics this DeftT's schema allows
     Timer* m_timer;
     chnCb m_chCb;                 // call back to app when this DefTT's cert distributor gets a fully validated signing cert that arrived from its syncps
     pubCb m_gkCb;            // call back for Publication group key distributor pubs
@@ -135,21 +257,62 @@ struct ptps
     std::string m_label;        // label for the transport to be used by this face
     uint64_t m_success{};
     uint64_t m_fail{};
+
+    /*
+     * Relayed pubs wait in a bounded queue and are handed to syncps only while fewer
+     * than 'm_maxInFlight' of them are awaiting delivery (i.e., still in this DeftT's
+     * collection), so a fast DeftT can't fill a slow one's collection with pubs it
+     * will never get into a cAdd. The queue is drained in priority order by class,
+     * chosen by a pub's topic (see topicClass()). Certs and key distributor pubs go to
+     * their own collections and are never queued so they effectively come first.
+     */
+    enum class relayClass : uint8_t { high, normal, bulk };
+    static constexpr size_t nRelayClasses = 3;
+    // what a full queue gives up: the oldest queued pub of the arriving pub's class or
+    // lower ('oldest') or the arriving pub unless a lower class pub can go ('newest').
+    enum class dropPolicy : uint8_t { oldest, newest };
+    struct RelayStats {
+        uint64_t queued{};      // relayed pubs queued
+        uint64_t sent{};        // passed to syncps
+        uint64_t dropFull{};    // dropped because queue was full
+        uint64_t dropStale{};   // expired while queued
+        uint64_t dropDup{};     // collection already had it
+        size_t maxDepth{};      // queue high water mark
+        std::array<uint64_t,nRelayClasses> byClass{}; // queued per class
+    };
+    std::array<std::deque<sharedPub>,nRelayClasses> m_rq{};
+    std::map<std::string,relayClass,std::less<>> m_topicClass{};
+    RelayStats m_rstats{};
+    size_t m_rqDepth{};
+    size_t m_rqMax{256};
+    size_t m_inFlight{};
+    size_t m_maxInFlight{64};
+    dropPolicy m_dropPolicy{dropPolicy::oldest};
     bool m_connected{false};
     bool isConnected() const { return m_connected; }
     const auto& schemaTP() { return m_pb.bs_.schemaTP_; }
+    // true if this DeftT's schema might accept 'p' (false means it certainly won't)
+    bool admitsTopic(const Publication& p) const noexcept { return m_topics.admits(p.name()); }
 
-    ptps(const certCb& rootCb, const certCb& schemaCb, const chainCb& idChainCb, const pairCb& signIdCb,
-             const std::string& fl, const chnCb& certHndlr = {}, const pubCb& distCb = {}, const pubCb& failCb={}) :
-        m_face{fl},
+    // a ptps whose face (and everything using it) runs on io_context 'ioc', e.g.,
+    // so each of a relay's DeftTs can be run by its own thread.
+    ptps(boost::asio::io_context& ioc, const certCb& rootCb, const certCb& schemaCb, const chainCb& idChainCb,
+             const pairCb& signIdCb, const std::string& fl, const chnCb& certHndlr = {}, const pubCb& distCb = {},
+             const pubCb& failCb={}) :
+        m_face{fl, ioc},
         m_pb{rootCb, schemaCb, idChainCb, signIdCb, m_face, [this](const rData c, const certStore& cs){ m_chCb(this, c, cs); } },
         m_pubpre{m_pb.pubPrefix()},
+        m_topics{m_pb.bs_, m_pubpre},
         m_chCb{certHndlr},
         m_gkCb{distCb},
         m_failCb{failCb},
         m_label{fl.size()? fl : "default"} {}
 
-    void run() { m_pb.run(); }
+    ptps(const certCb& rootCb, const certCb& schemaCb, const chainCb& idChainCb, const pairCb& signIdCb,
+             const std::string& fl, const chnCb& certHndlr = {}, const pubCb& distCb = {}, const pubCb& failCb={}) :
+        ptps(getDefaultIoContext(), rootCb, schemaCb, idChainCb, signIdCb, fl, certHndlr, distCb, failCb) {}
+
+    void run() { s_running = this; m_pb.run(); }
     const auto& pubPrefix() const noexcept { return m_pubpre; }
     const std::string& label() { return m_label; }
     const auto& face() { return m_face; }
@@ -157,6 +320,17 @@ struct ptps
     auto successCnt() { return m_success; }
     void clearFailures() { m_fail = 0; }
 
+    // relay queue configuration and counters
+    auto& relayQueue(size_t maxDepth, size_t maxInFlight) {
+        m_rqMax = maxDepth;
+        m_maxInFlight = std::max(maxInFlight, size_t(1));
+        return *this;
+    }
+    auto& relayDrop(dropPolicy p) { m_dropPolicy = p; return *this; }
+    auto& topicClass(std::string_view topic, relayClass c) { m_topicClass.insert_or_assign(std::string(topic), c); return *this; }
+    const auto& relayStats() const noexcept { return m_rstats; }
+    auto relayDepth() const noexcept { return m_rqDepth; }
+
     // relies on trust schema using convention of collecting all the signing chain
     // identity information (e.g., _role, _roleId) in pseudo-pub "#chainInfo" so
     // the app can extract what it needs to operate.
@@ -225,6 +399,12 @@ struct ptps
         }
         return;
     }
+    // publish a pub whose buffer is shared with the other DeftTs it's relayed to
+    void publish(sharedPub&& p)
+    {
+        if(m_failCb) m_pb.publish(std::move(p), [this](auto p, bool s){confirmPublication(Publication(p), s);});
+        else m_pb.publish(std::move(p));
+    }
     /*
      * p is a complete schema-compliant Publication for the input DeftT
      * A sub-schema can be used to limit Publications that are accepted from relay to DeftT
@@ -287,20 +467,197 @@ struct ptps
      * this is only useful for the case of identical trust schema for all DefTTs so is both
      * less general and not "belt and suspenders" security
      */
-    void addRelayedChain(const rData c, const auto& cs) {
+    /*
+     * Only the part of the chain this DeftT doesn't have is added: a cert is only in
+     * a cert store if its signer is so once a known cert is found the rest of the chain
+     * is too (with key rotation that's usually everything but the new signing cert).
+     * The missing certs are added signer first so each validates as it's added rather
+     * than waiting in pending certs for its signer.
+     */
+    void addRelayedChain(const rData c, const certStore& cs) {
         auto tp = c.computeTP();
         if (m_pb.certs().contains(tp)) return;   //already have this signing chain
 
         m_pb.addRelayed(tp);    // add to list of signing chains that were relayed to this DeftT
-        // for each cert on signing chain
-        cs.chain_for_each(tp, [this](const auto &c) { m_pb.addCert(c);  }  );
+        std::vector<const storedCert*> missing{};
+        for (const auto& sc : certStore::chainIter(tp, cs)) {
+            if (m_pb.certs().contains(sc.computeThumbPrint())) break;
+            missing.emplace_back(&sc);
+        }
+        for (auto c = missing.rbegin(); c != missing.rend(); ++c) m_pb.addRelayedCert(**c, (*c)->computeThumbPrint());
         // m_pb.certs().dumpcerts();
     }
+    // same as above for a chain that was copied out of its cert store (signing cert first)
+    void addRelayedChain(const thumbPrint& tp, const std::vector<dctCert>& chain) {
+        if (m_pb.certs().contains(tp)) return;
+        m_pb.addRelayed(tp);
+        auto n = std::ranges::find_if(chain, [this](const auto& c) { return m_pb.certs().contains(c.computeThumbPrint()); })
+                 - chain.begin();
+        while (n-- > 0) m_pb.addRelayedCert(chain[n], chain[n].computeThumbPrint());
+    }
+
+    // how long relayed certs are collected before being published as bundles (0 = no batching)
+    void chainBatch(std::chrono::milliseconds w) { m_pb.m_ckd.batchWindow(w); }
+
+    size_t classOf(const rName& nm) const noexcept {
+        if (m_topicClass.size()) {
+            try {
+                if (auto c = m_topicClass.find(nm[m_topics.plen_].toSv()); c != m_topicClass.end()) return size_t(c->second);
+            } catch (const std::exception&) { }
+        }
+        return size_t(relayClass::normal);
+    }
+
+    // make room for a pub of class 'c' in a full relay queue. Returns false if the new pub should be dropped.
+    bool makeRoom(size_t c) {
+        auto lo = m_dropPolicy == dropPolicy::oldest? c : c + 1;
+        for (auto l = nRelayClasses; l-- > lo; ) {
+            if (m_rq[l].empty()) continue;
+            if (m_dropPolicy == dropPolicy::oldest) m_rq[l].pop_front(); else m_rq[l].pop_back();
+            --m_rqDepth;
+            ++m_rstats.dropFull;
+            return true;
+        }
+        ++m_rstats.dropFull;
+        return false;
+    }
+
+    // queue relayed pub 'p' for this DeftT's collection
+    void enqueue(sharedPub&& p) {
+        auto c = classOf(p.name());
+        if (m_rqDepth >= m_rqMax && ! makeRoom(c)) return;
+        m_rq[c].emplace_back(std::move(p));
+        ++m_rstats.queued;
+        ++m_rstats.byClass[c];
+        m_rstats.maxDepth = std::max(m_rstats.maxDepth, ++m_rqDepth);
+        drainRelayQueue();
+    }
+
+    // pass queued pubs to syncps, highest class first, while there's room in flight. Each pub holds
+    // its in-flight slot until syncps is done with its delivery callback (delivered, timed out
+    // or dropped) and a freed slot restarts the drain (posted so syncps isn't reentered).
+    void drainRelayQueue() {
+        while (m_inFlight < m_maxInFlight && m_rqDepth) {
+            auto& q = *std::ranges::find_if(m_rq, [](const auto& q){ return ! q.empty(); });
+            auto p = std::move(q.front());
+            q.pop_front();
+            --m_rqDepth;
+            if (m_pb.m_sync.isExpired_(p)) { ++m_rstats.dropStale; continue; }
+            ++m_inFlight;
+            std::shared_ptr<void> slot(nullptr, [this](void*) {
+                                            --m_inFlight;
+                                            if (m_rqDepth) post([this]{ drainRelayQueue(); });
+                                        });
+            auto h = m_pb.publish(std::move(p), [this, slot](auto p, bool s) {
+                                            if (m_failCb) confirmPublication(Publication(p), s); });
+            if (h == 0) ++m_rstats.dropDup; else ++m_rstats.sent;
+        }
+    }
+
+    /*
+     * Cross-DeftT handoff for relays.
+     *
+     * Each ptps must only be used from the thread running its io_context. When
+     * all of a relay's DeftTs share one io_context these just call the matching
+     * method directly. Otherwise they copy whatever they need from the caller
+     * (which runs on the arrival DeftT's thread) and hand the operation off to
+     * this ptps's thread (see handoff()).
+     */
+    bool onThread() const noexcept { return m_face.getIoContext().get_executor().running_in_this_thread(); }
+
+    template<typename F>
+    void post(F&& f) { boost::asio::post(m_face.getIoContext(), std::forward<F>(f)); }
+
+    /*
+     * When the relay's DeftTs are on their own threads, work for this ptps from each
+     * of the others goes through a lock-free SPSC queue (one per source DeftT, so each
+     * has a single producer) rather than a locked asio post per item. A producer only
+     * posts a wakeup when this ptps isn't already due to drain its inbox so a burst of
+     * relayed pubs costs one post. Items that don't fit (queue full) or come from a
+     * thread that isn't running a peer fall back to a post.
+     */
+    using Work = std::function<void()>;
+    using Inbox = spscQueue<Work>;
+    static inline thread_local const ptps* s_running{};  // ptps whose run() this thread is in
+    std::vector<std::pair<const ptps*,std::unique_ptr<Inbox>>> m_inbox{};
+    std::atomic<bool> m_wake{false};
+    std::atomic<uint64_t> m_inboxFull{};   // items posted because an inbox was full
+
+    // make an inbox for each of 'peers' (other than this). Must be done before any of them runs.
+    void relayPeers(const std::vector<ptps*>& peers) {
+        m_inbox.clear();
+        for (auto p : peers) if (p != this) m_inbox.emplace_back(p, std::make_unique<Inbox>());
+    }
+
+    void drainInbox() {
+        m_wake.store(false);
+        Work w{};
+        for (auto& [p, q] : m_inbox)
+            while (q->pop(w)) {
+                try { w(); } catch (const std::exception&) {}
+            }
+    }
+
+    // run 'f' on this ptps's thread
+    void handoff(Work&& f) {
+        if (onThread()) { f(); return; }
+        for (auto& [p, q] : m_inbox) {
+            if (p != s_running) continue;
+            if (! q->push(std::move(f))) break;
+            if (! m_wake.exchange(true)) post([this]{ drainInbox(); });
+            return;
+        }
+        if (f) {
+            if (s_running) m_inboxFull.fetch_add(1, std::memory_order_relaxed);
+            post([f=std::move(f)] { try { f(); } catch (const std::exception&) {} });
+        }
+    }
+
+    // relay pub 'rp' (shared by the DeftTs it goes to), checking it against this DeftT's schema if 'validate'
+    void relay(const relayPub& rp, bool validate) {
+        auto send = [this](const relayPub& rp, bool validate) {
+            const auto& p = rp.pub.asView();
+            if (validate && (! m_pb.knowsSigner(p) || ! rp.valid(schemaTP(), [this, &p]{ return m_pb.isValidPub(p); })))
+                return;
+            enqueue(sharedPub(rp.pub));
+        };
+        if (onThread()) {
+            send(rp, validate);
+            return;
+        }
+        handoff([send, rp, validate]() { send(rp, validate); });
+    }
+
+    // relay pub 'p', checking it against this DeftT's schema if 'validate'
+    void relay(const Publication& p, bool validate) {
+        if (onThread()) {
+            if (! validate || m_pb.isValidPub(p)) enqueue(sharedPub(Publication(p)));
+            return;
+        }
+        handoff([this, p=std::make_shared<Publication>(p), validate]() {
+                if (! validate || m_pb.isValidPub(*p)) enqueue(sharedPub(std::shared_ptr<const crData>(std::move(p))));
+            });
+    }
+
+    // relay a pub key distributor pub
+    void relayKnown(const Publication& p) {
+        if (onThread()) { publishKnown(Publication(p)); return; }
+        handoff([this, p=std::make_shared<Publication>(p)] { publishKnown(std::move(*p)); });
+    }
+
+    // relay the signing chain of cert 'c' from cert store 'cs'
+    void relayChain(const rData c, const certStore& cs) {
+        if (onThread()) { addRelayedChain(c, cs); return; }
+        // 'cs' belongs to the caller's thread so copy the chain now
+        auto tp = c.computeTP();
+        std::vector<dctCert> chain{};
+        cs.chain_for_each(tp, [&chain](const auto& c) { chain.emplace_back(c, c.computeThumbPrint()); });
+        handoff([this, tp, chain=std::move(chain)] { addRelayedChain(tp, chain); });
+    }
 
-    // Can be used by application to schedule a cancelable timer. Note that
-    // this is expensive compared to a oneTime timer and should be used
-    // only for timers that need to be canceled before they fire.
-    pTimer schedule(std::chrono::microseconds d, TimerCb&& cb) { return m_pb.schedule(d, std::move(cb)); }
+    // Can be used by application to schedule a cancelable timer. The returned
+    // handle's cancel() stops the timer if it hasn't fired yet.
+    TimerHandle schedule(std::chrono::microseconds d, TimerCb&& cb) { return m_pb.schedule(d, std::move(cb)); }
 
     // schedule a call to 'cb' in 'd' microseconds (cannot be canceled)
     void oneTime(std::chrono::microseconds d, TimerCb&& cb) { m_pb.oneTime(d, std::move(cb)); }
@@ -0,0 +1,158 @@
+#ifndef RS_FEC_HPP
+#define RS_FEC_HPP
+#pragma once
+/*
+ * rsCode: systematic Reed-Solomon erasure code over GF(2^8) for mbps messages
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace dct {
+
+// GF(2^8) log & antilog tables (exp is doubled so a product's log needs no reduction)
+struct gfTables {
+    std::array<uint8_t,512> exp{};
+    std::array<uint8_t,256> log{};
+    constexpr gfTables() {
+        unsigned x = 1;
+        for (size_t i = 0; i < 255; ++i) {
+            exp[i] = exp[i + 255] = x;
+            log[x] = i;
+            x <<= 1;
+            if (x & 0x100) x ^= 0x11d;  // x^8 + x^4 + x^3 + x^2 + 1
+        }
+    }
+};
+
+/*
+ * A message of n 'len' byte data shards (the last zero padded) gets r repair
+ * shards. Repair shard j is sum_i C[j][i] * data shard i where C is the r x n
+ * Cauchy matrix C[j][i] = 1 / (j + (r + i)) (GF(2^8) addition is xor). Every
+ * square submatrix of a Cauchy matrix is invertible so any n of the n + r shards
+ * rebuild the message (n + r <= 256). Decoding only solves for the missing data
+ * shards: an e x e system for e missing shards.
+ */
+struct rsCode {
+    static constexpr size_t maxShards = 256;
+
+    static constexpr gfTables gf{};
+
+    static constexpr uint8_t mul(uint8_t a, uint8_t b) noexcept {
+        return a == 0 || b == 0? 0 : gf.exp[gf.log[a] + gf.log[b]];
+    }
+    static constexpr uint8_t inv(uint8_t a) noexcept { return gf.exp[255 - gf.log[a]]; }
+
+    static constexpr uint8_t coef(size_t j, size_t i, size_t r) noexcept { return inv(uint8_t(j ^ (r + i))); }
+
+    // dst ^= c * src
+    static void muladd(uint8_t* dst, const uint8_t* src, size_t len, uint8_t c) noexcept {
+        if (c == 0) return;
+        const auto lc = gf.log[c];
+        for (size_t b = 0; b < len; ++b) if (src[b]) dst[b] ^= gf.exp[gf.log[src[b]] + lc];
+    }
+
+    // data shard 'i' of 'msg' (may be short or empty at the end of the message)
+    static std::span<const uint8_t> shard(std::span<const uint8_t> msg, size_t i, size_t len) noexcept {
+        auto off = std::min(i * len, msg.size());
+        return msg.subspan(off, std::min(len, msg.size() - off));
+    }
+
+    // repair shard 'j' (0 <= j < r) of the n = ceil(msg.size() / len) data shards of 'msg'
+    static std::vector<uint8_t> encode(std::span<const uint8_t> msg, size_t len, size_t j, size_t r) {
+        std::vector<uint8_t> out(len, 0);
+        size_t n = (msg.size() + len - 1) / len;
+        for (size_t i = 0; i < n; ++i) {
+            auto s = shard(msg, i, len);
+            muladd(out.data(), s.data(), s.size(), coef(j, i, r));
+        }
+        return out;
+    }
+
+    /**
+     * @brief rebuild the missing data shards of 'data'
+     *
+     * 'data' holds the n data shards (n * len bytes, missing ones zero) and have(i)
+     * says whether shard i arrived. 'rep' holds (j, repair shard j) pairs, at least
+     * as many as there are missing shards. Returns false if there aren't enough.
+     */
+    template<typename Have, typename Rep>
+    static bool decode(std::span<uint8_t> data, size_t len, size_t n, size_t r, Have&& have, const Rep& rep) {
+        std::vector<size_t> miss{};
+        for (size_t i = 0; i < n; ++i) if (! have(i)) miss.push_back(i);
+        const auto e = miss.size();
+        if (e == 0) return true;
+        if (rep.size() < e || data.size() < n * len) return false;
+
+        // syndromes: each repair shard less the contribution of the shards we have
+        std::vector<std::vector<uint8_t>> s(e);
+        for (size_t a = 0; a < e; ++a) {
+            const auto& [j, rs] = rep[a];
+            if (j >= r || rs.size() != len) return false;
+            s[a].assign(rs.begin(), rs.end());
+            for (size_t i = 0; i < n; ++i) if (have(i)) muladd(s[a].data(), &data[i * len], len, coef(j, i, r));
+        }
+        // invert the e x e Cauchy submatrix (rows: repair shards used, cols: missing shards)
+        std::vector<uint8_t> m(e * e), mi(e * e, 0);
+        for (size_t a = 0; a < e; ++a) {
+            for (size_t b = 0; b < e; ++b) m[a * e + b] = coef(rep[a].first, miss[b], r);
+            mi[a * e + a] = 1;
+        }
+        for (size_t c = 0; c < e; ++c) {
+            auto p = c;
+            while (p < e && m[p * e + c] == 0) ++p;
+            if (p == e) return false;   // repeated repair shard
+            if (p != c) {
+                for (size_t b = 0; b < e; ++b) {
+                    std::swap(m[p * e + b], m[c * e + b]);
+                    std::swap(mi[p * e + b], mi[c * e + b]);
+                }
+            }
+            auto iv = inv(m[c * e + c]);
+            for (size_t b = 0; b < e; ++b) {
+                m[c * e + b] = mul(m[c * e + b], iv);
+                mi[c * e + b] = mul(mi[c * e + b], iv);
+            }
+            for (size_t a = 0; a < e; ++a) {
+                if (a == c || m[a * e + c] == 0) continue;
+                auto f = m[a * e + c];
+                for (size_t b = 0; b < e; ++b) {
+                    m[a * e + b] ^= mul(f, m[c * e + b]);
+                    mi[a * e + b] ^= mul(f, mi[c * e + b]);
+                }
+            }
+        }
+        for (size_t b = 0; b < e; ++b) {
+            auto* d = &data[miss[b] * len];
+            for (size_t a = 0; a < e; ++a) muladd(d, s[a].data(), len, mi[b * e + a]);
+        }
+        return true;
+    }
+};
+
+} // namespace dct
+
+#endif // RS_FEC_HPP
@@ -0,0 +1,76 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+#pragma once
+/*
+ * spscQueue: bounded, lock-free, single producer / single consumer queue
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace dct {
+
+/*
+ * A ring of 'N' (a power of 2) slots. 'head_' is only written by the consumer and
+ * 'tail_' only by the producer so neither side ever waits on the other: push() fails
+ * if the ring is full and pop() if it's empty. The indices are on separate cache
+ * lines so the two threads don't false share.
+ */
+template<typename T, size_t N = 1024>
+struct spscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "spscQueue size must be a power of 2");
+
+  private:
+    alignas(64) std::atomic<size_t> head_{};    // next slot to pop
+    alignas(64) std::atomic<size_t> tail_{};    // next slot to push
+    alignas(64) std::array<T,N> slot_{};
+
+  public:
+    // (producer) add 't'. Returns false (and leaves 't' alone) if the queue is full.
+    bool push(T&& t) {
+        auto tl = tail_.load(std::memory_order_relaxed);
+        if (tl - head_.load(std::memory_order_acquire) >= N) return false;
+        slot_[tl & (N - 1)] = std::move(t);
+        tail_.store(tl + 1, std::memory_order_release);
+        return true;
+    }
+
+    // (consumer) remove the oldest item into 't'. Returns false if the queue is empty.
+    bool pop(T& t) {
+        auto hd = head_.load(std::memory_order_relaxed);
+        if (hd == tail_.load(std::memory_order_acquire)) return false;
+        t = std::move(slot_[hd & (N - 1)]);
+        slot_[hd & (N - 1)] = T{};
+        head_.store(hd + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const noexcept { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+    size_t size() const noexcept { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+    static constexpr size_t capacity() noexcept { return N; }
+};
+
+} // namespace dct
+
+#endif // SPSC_QUEUE_HPP
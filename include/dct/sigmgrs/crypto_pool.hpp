@@ -0,0 +1,176 @@
+#ifndef DCT_SIGMGRS_CRYPTO_POOL_HPP
+#define DCT_SIGMGRS_CRYPTO_POOL_HPP
+#pragma once
+/*
+ * Thread pool for asynchronous signing & signature verification (and other DeftT work)
+ *
+ * Copyright (C) 2022 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This is not intended as production code.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include "invocable.h"
+
+namespace dct {
+
+/**
+ * Unlike WorkerPool (syncps/worker_pool.hpp), where the io thread waits for a
+ * batch of work to finish, a CryptoPool runs jobs while the io thread carries
+ * on with packet & timer processing. A job gets copies of what it needs (the
+ * packets and keys) when it's submitted since io thread state can change while
+ * it runs. It ends by handing a completion to complete(), which posts it to the
+ * io thread, so everything other than the crypto itself is still done there.
+ *
+ * It's the DeftT's one executor: a DCTmodel's pool (see cryptoThreads()) is shared
+ * by its collections, sigmgrs and distributors so they don't each start threads.
+ * Each thread has its own job queue. Jobs submitted by a pool thread go on its own
+ * queue, others are spread over the queues round robin, and a thread whose queue
+ * is empty takes the oldest job of another's so a burst submitted at once (e.g.,
+ * the pubs of a cAdd) doesn't wait behind a slow one. The threads can be pinned
+ * to CPUs (Linux only).
+ *
+ * The pool's threads finish the queued jobs then exit when it's destroyed. Since
+ * completions reference their submitter, the pool (and the io_context) must
+ * be destroyed before the DeftTs using it.
+ */
+class CryptoPool {
+  public:
+    using Job = ofats::any_invocable<void()>;
+
+  private:
+    struct Queue {
+        std::mutex mtx_{};
+        std::deque<Job> jobs_{};
+    };
+    boost::asio::io_context& ioc_;
+    std::vector<std::unique_ptr<Queue>> q_{};   // one per thread
+    std::atomic<size_t> pending_{};             // jobs queued (not yet taken)
+    std::atomic<size_t> next_{};                // queue for the next job from outside the pool
+    std::atomic<uint64_t> stolen_{};            // jobs taken from another thread's queue
+    std::mutex mtx_{};
+    std::condition_variable cv_{};
+    bool stop_{false};
+    std::vector<std::thread> threads_{};
+    static inline thread_local const CryptoPool* self_{};  // pool of the current thread (if any)
+    static inline thread_local size_t idx_{};              // and its index in that pool
+
+    // take the oldest job of queue 'i' (ours or, when ours is empty, another's)
+    bool take(size_t i, Job& job) {
+        auto& q = *q_[i];
+        std::lock_guard lck{q.mtx_};
+        if (q.jobs_.empty()) return false;
+        job = std::move(q.jobs_.front());
+        q.jobs_.pop_front();
+        pending_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void worker(size_t me) {
+        self_ = this;
+        idx_ = me;
+        Job job{};
+        while (true) {
+            bool got = take(me, job);
+            for (size_t k = 1; ! got && k < q_.size(); ++k) {
+                if ((got = take((me + k) % q_.size(), job))) stolen_.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (got) {
+                job();
+                job = nullptr;
+                continue;
+            }
+            std::unique_lock lck{mtx_};
+            cv_.wait(lck, [this]{ return stop_ || pending_.load(std::memory_order_relaxed) != 0; });
+            if (stop_ && pending_.load(std::memory_order_relaxed) == 0) return;
+        }
+    }
+
+  public:
+    /*
+     * 'nthreads' threads whose completions go to 'ioc'. If 'cpus' isn't empty
+     * thread i is pinned to cpus[i % cpus.size()].
+     */
+    CryptoPool(boost::asio::io_context& ioc, size_t nthreads, const std::vector<int>& cpus = {}) : ioc_{ioc} {
+        for (size_t i = 0; i < nthreads; ++i) q_.emplace_back(std::make_unique<Queue>());
+        threads_.reserve(nthreads);
+        for (size_t i = 0; i < nthreads; ++i) {
+            auto& t = threads_.emplace_back([this, i]{ worker(i); });
+#ifdef __linux__
+            if (! cpus.empty()) {
+                cpu_set_t cs;
+                CPU_ZERO(&cs);
+                CPU_SET(cpus[i % cpus.size()], &cs);
+                pthread_setaffinity_np(t.native_handle(), sizeof(cs), &cs);
+            }
+#else
+            (void)t;
+#endif
+        }
+    }
+    CryptoPool(const CryptoPool&) = delete;
+    CryptoPool& operator=(const CryptoPool&) = delete;
+
+    ~CryptoPool() {
+        {
+            std::lock_guard lck{mtx_};
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& t : threads_) t.join();
+    }
+
+    auto size() const noexcept { return threads_.size(); }
+    auto stolen() const noexcept { return stolen_.load(std::memory_order_relaxed); }
+    auto& ioContext() const noexcept { return ioc_; }
+
+    // run 'job' on a pool thread ('job' must not throw)
+    void submit(Job&& job) {
+        if (q_.empty()) { job(); return; }
+        auto i = self_ == this? idx_ : next_.fetch_add(1, std::memory_order_relaxed) % q_.size();
+        // (counted before it's queued so a thief can't take it first)
+        {
+            std::lock_guard lck{mtx_};
+            pending_.fetch_add(1, std::memory_order_relaxed);
+        }
+        {
+            std::lock_guard lck{q_[i]->mtx_};
+            q_[i]->jobs_.emplace_back(std::move(job));
+        }
+        cv_.notify_one();
+    }
+
+    // called by a job to run 'done' on the io thread
+    void complete(Job&& done) { boost::asio::post(ioc_, std::move(done)); }
+};
+
+} // namespace dct
+
+#endif  // DCT_SIGMGRS_CRYPTO_POOL_HPP
@@ -0,0 +1,112 @@
+#ifndef SG_DEC_KEYS_HPP
+#define SG_DEC_KEYS_HPP
+#pragma once
+/*
+ * Per-publisher subscriber group decryption keys for the PPAEAD & PPSIGN sigmgrs
+ *
+ * Copyright (C) 2022 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This is not intended as production code.
+ */
+
+#include <array>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "sigmgr_defs.hpp"
+
+namespace dct {
+
+/*
+ * A PP sigmgr decrypts a publisher's packets with a key derived (crypto_kx) from
+ * the publisher's signing public key (converted to X25519) and one of the (up to
+ * two) subscriber group key pairs. Deriving it costs two scalar multiplies so the
+ * results are kept per publisher thumbprint, one per group key pair, along
+ * with the converted public key (which doesn't change when the group rekeys).
+ *
+ * Publishers are added as their signing certs arrive (addSigner) so their keys
+ * can be derived before their first packet. When a new group key pair arrives
+ * (rekey) the per-pair keys shift down with the key list and the keys for the
+ * new pair are derived for all the known publishers at once.
+ *
+ * At most 'maxSigners' publishers are kept (an arbitrary one is dropped to make room).
+ */
+struct SGDecKeys {
+    static constexpr size_t maxSigners = 1024;
+    static constexpr size_t maxPairs = 2;
+    using xKey = std::array<uint8_t,crypto_scalarmult_curve25519_BYTES>;
+
+    struct Signer {
+        xKey xpk;                           // publisher's public key in X25519 form
+        std::array<keyVal,maxPairs> dk{};   // dk[i] derived with group key pair i (empty if not yet derived)
+    };
+    std::unordered_map<thumbPrint,Signer> signers_{};
+
+    static void derive(keyVal& dk, const xKey& xpk, keyRef gpk, keyRef gsk) {
+        if (gsk.size() != crypto_kx_SECRETKEYBYTES) throw std::runtime_error("SGDecKeys: no group secret key");
+        dk.resize(crypto_kx_SESSIONKEYBYTES);
+        if (crypto_kx_server_session_keys(dk.data(), NULL, gpk.data(), gsk.data(), xpk.data()) != 0) {
+            dk.clear();
+            throw std::runtime_error("SGDecKeys: unable to derive decryption key");
+        }
+    }
+
+    Signer& add(const thumbPrint& tp, keyRef pk) {
+        if (auto it = signers_.find(tp); it != signers_.end()) return it->second;
+        xKey xpk;
+        if (crypto_sign_ed25519_pk_to_curve25519(xpk.data(), pk.data()) != 0) {
+            throw std::runtime_error("SGDecKeys: unable to convert signing pk to sealed box pk");
+        }
+        if (signers_.size() >= maxSigners) signers_.erase(signers_.begin());
+        return signers_.emplace(tp, Signer{xpk}).first->second;
+    }
+
+    // add publisher 'tp' with signing public key 'pk' and derive its key for the newest
+    // group pair ('gpk','gsk') if we have its secret key.
+    void addSigner(const thumbPrint& tp, keyRef pk, keyRef gpk, keyRef gsk) {
+        auto& s = add(tp, pk);
+        if (gsk.size() && s.dk[0].empty()) derive(s.dk[0], s.xpk, gpk, gsk);
+    }
+
+    /*
+     * decryption key of publisher 'tp' for group key pair 'i' ('gpk','gsk'). 'pk()'
+     * returns the publisher's signing public key and is only called if the publisher
+     * isn't known (it can throw if there's no cert for 'tp').
+     */
+    template<typename PK>
+    const keyVal& get(const thumbPrint& tp, PK&& pk, size_t i, keyRef gpk, keyRef gsk) {
+        auto it = signers_.find(tp);
+        auto& s = it != signers_.end()? it->second : add(tp, pk());
+        if (s.dk[i].empty()) derive(s.dk[i], s.xpk, gpk, gsk);
+        return s.dk[i];
+    }
+
+    // a new group key pair ('gpk','gsk') has been put at the front of the key list
+    void rekey(keyRef gpk, keyRef gsk) {
+        for (auto& [tp, s] : signers_) {
+            for (auto i = maxPairs - 1; i > 0; --i) s.dk[i] = std::move(s.dk[i-1]);
+            s.dk[0].clear();
+            if (gsk.size()) try { derive(s.dk[0], s.xpk, gpk, gsk); } catch(...) {}  // (get() will retry)
+        }
+    }
+
+    auto size() const noexcept { return signers_.size(); }
+};
+
+} // namespace dct
+
+#endif // SG_DEC_KEYS_HPP
@@ -30,6 +30,10 @@
  * these methods should be overridden in derived classes.
  */
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>  // for memcpy
 #include <functional>
 #include <span>
 
@@ -38,7 +42,9 @@ extern "C" {
     #include <sodium.h>
 };
 
+#include "crypto_pool.hpp"
 #include "sigmgr_defs.hpp"
+#include "verify_cache.hpp"
 #include "../schema/crpacket.hpp"
 
 namespace dct {
@@ -50,30 +56,49 @@ struct SigMgr {
     SigInfo m_sigInfo;
     keyVal m_signingKey{};
     KeyCb m_keyCb{};
+    std::vector<uint8_t> m_scratch{};   // aeadDecrypt output when its input has to be kept
 
     // types that require a key locator in their sigInfo   
-    static constexpr uint64_t needsKey_{ (1 << stEdDSA) | (1 << stPPAEAD) | (1 << stPPSIGN) | (1 << stAEADSGN) };
+    static constexpr uint64_t needsKey_{ (1 << stEdDSA) | (1 << stPPAEAD) | (1 << stPPSIGN) | (1 << stAEADSGN) |
+                                         (1 << stAESGCMSGN) };
     static constexpr bool needsKey(SigType typ) noexcept { return (needsKey_ & (1 << typ)) != 0; };
 
     // types that encrypt content
-    static constexpr uint64_t encryptsContent_{(1 << stAEAD) | (1 << stPPAEAD) | (1 << stPPSIGN) | (1 << stAEADSGN)};
+    static constexpr uint64_t encryptsContent_{(1 << stAEAD) | (1 << stPPAEAD) | (1 << stPPSIGN) | (1 << stAEADSGN) |
+                                               (1 << stAESGCM) | (1 << stAESGCMSGN)};
     static constexpr bool encryptsContent(SigType typ) noexcept  { return (encryptsContent_ & (1 << typ)) != 0; };
 
     // types that with restricted subscriber group
     static constexpr uint64_t subscriberGroup_{(1 << stPPAEAD) | (1 << stPPSIGN)};
     static constexpr bool subscriberGroup(SigType typ) noexcept  { return (subscriberGroup_ & (1 << typ)) != 0; };
 
-    // build a siginfo for signing key type 'typ'
-    auto  mkSigInfo(SigType typ) {
-        if (! needsKey(typ)) {
-            auto a = TLV<tlv::SignatureInfo>(TLV<tlv::SignatureType>(typ));
-            return SigInfo{a.begin(), a.end()};
-        } else {
-            auto a = TLV<tlv::SignatureInfo>(tlvFlatten(
-                        TLV<tlv::SignatureType>(typ),
+    // types that use the trust zone's group key from dist_gkey.hpp
+    static constexpr uint64_t groupKey_{(1 << stAEAD) | (1 << stAEADSGN) | (1 << stAESGCM) | (1 << stAESGCMSGN) |
+                                        (1 << stBLAKE2K)};
+    static constexpr bool groupKey(SigType typ) noexcept  { return (groupKey_ & (1 << typ)) != 0; };
+
+    // types whose signature ends with an EdDSA signature by the signer
+    static constexpr uint64_t edSigned_{(1 << stEdDSA) | (1 << stPPSIGN) | (1 << stAEADSGN) | (1 << stAESGCMSGN)};
+    static constexpr bool edSigned(SigType typ) noexcept  { return (edSigned_ & (1 << typ)) != 0; };
+
+    // siginfo skeletons (see tlvValOff) for types without and with a key locator. The
+    // signing key's thumbprint goes at 'keyDigestOff', the type at 'sigTypeOff' for both.
+    static constexpr auto sigInfoSkel = TLV<tlv::SignatureInfo>(TLV<tlv::SignatureType>(0));
+    static constexpr auto keyedSigInfoSkel = TLV<tlv::SignatureInfo>(tlvFlatten(
+                        TLV<tlv::SignatureType>(0),
                         TLV<tlv::KeyLocator>(TLV<tlv::KeyDigest>(std::array<uint8_t,thumbPrint_s>{}))));
-            return SigInfo{a.begin(), a.end()};
-        }
+    static constexpr size_t sigTypeOff = tlvValOff(sigInfoSkel, {tlv::SignatureInfo, tlv::SignatureType});
+    static constexpr size_t keyDigestOff = tlvValOff(keyedSigInfoSkel,
+                                               {tlv::SignatureInfo, tlv::KeyLocator, tlv::KeyDigest});
+    static_assert(sigTypeOff == tlvValOff(keyedSigInfoSkel, {tlv::SignatureInfo, tlv::SignatureType}));
+    static_assert(keyDigestOff + thumbPrint_s == keyedSigInfoSkel.size());
+
+    // build a siginfo for signing key type 'typ'
+    static SigInfo mkSigInfo(SigType typ) {
+        SigInfo si = needsKey(typ)? SigInfo(keyedSigInfoSkel.begin(), keyedSigInfoSkel.end()) :
+                                    SigInfo(sigInfoSkel.begin(), sigInfoSkel.end());
+        si[sigTypeOff] = typ;
+        return si;
     }
 
     SigMgr(SigType typ) : m_type{typ}, m_sigInfo{mkSigInfo(typ)} { if (sodium_init() == -1) exit(EXIT_FAILURE); }
@@ -87,17 +112,247 @@ struct SigMgr {
     virtual bool validateDecrypt(rData d, const rData&) { return validate(d); };
     virtual bool decrypt(rData) { return true; };
 
+    /*
+     * Validate a batch of packets (e.g., the new pubs in a cAdd): for each i with
+     * ok[i] non-zero on entry, ok[i] is set to whether d[i] validates. The default
+     * validates them one at a time. Public key sigmgrs override this to share the
+     * per-signer work across the batch (see byKey).
+     */
+    virtual void validateBatch(std::span<const rData> d, std::span<uint8_t> ok) {
+        for (size_t i = 0; i < d.size(); ++i) if (ok[i]) ok[i] = validate(d[i]);
+    }
+
     virtual void addKey(keyRef, uint64_t = 0) {};
     virtual void addKey(keyRef pk, keyRef, uint64_t = 0) { addKey(pk, 0); };
     virtual void updateSigningKey(keyRef, const rData&) {};
+    // called with the thumbprint and public key of each signing cert added to the cert store
+    virtual void addSigner(const thumbPrint&, keyRef) {};
 
     constexpr bool needsKey() const noexcept { return needsKey(m_type); };
     constexpr bool encryptsContent() const noexcept { return encryptsContent(m_type); };
     constexpr bool subscriberGroup() const noexcept { return subscriberGroup(m_type); };
+    constexpr bool edSigned() const noexcept { return edSigned(m_type); };
+    constexpr bool groupKey() const noexcept { return groupKey(m_type); };
 
     // if validate requires public keys of publishers, m_keyCb returns by keylocator
     void setKeyCb(KeyCb&& kcb) { m_keyCb = std::move(kcb);}
 
+    /*
+     * validateBatch helper for sigmgrs that verify with the signer's public key:
+     * set ok[i] to verify(d[i], pk) where pk is from m_keyCb. The key is looked up
+     * once per run of packets with the same signer (the usual case for a cAdd).
+     */
+    template<typename V>
+    void byKey(std::span<const rData> d, std::span<uint8_t> ok, V&& verify) const {
+        const thumbPrint* tp{};
+        keyRef pk{};
+        for (size_t i = 0; i < d.size(); ++i) {
+            if (! ok[i]) continue;
+            try {
+                const auto& t = d[i].thumbprint();
+                if (tp == nullptr || t != *tp) {
+                    tp = nullptr;
+                    pk = m_keyCb(d[i]);
+                    tp = &t;
+                }
+            } catch (...) {
+                ok[i] = 0;
+                continue;
+            }
+            ok[i] = verify(d[i], pk);
+        }
+    }
+
+    /*
+     * Check the signature of 'd' made with public key 'pk' using 'verify()' unless
+     * the process VerifyCache (if enabled) says this packet & key already verified.
+     */
+    template<typename V>
+    static bool cachedVerify(rData d, keyRef pk, V&& verify) {
+        if (auto vc = VerifyCache::get(); vc) return vc->check({d.data(), d.size()}, pk, verify);
+        return verify();
+    }
+
+    /*
+     * AEAD helpers for the encrypting sigmgrs. Both work on the content in place
+     * so there's no temporary copy of it per packet. The cipher defaults to
+     * XChaCha20-Poly1305 but can be any libsodium AEAD with the same (detached)
+     * API, e.g., AES-256-GCM using a precomputed key schedule (K is then the
+     * cipher's state type rather than the key bytes).
+     *
+     * libsodium zeroes the output when a decryption fails to authenticate so, if
+     * 'keep' is true (another key will be tried if this one fails), aeadDecrypt
+     * decrypts into a reusable scratch buffer which is copied back on success.
+     */
+    using AeadEnc = decltype(&crypto_aead_xchacha20poly1305_ietf_encrypt_detached);
+    using AeadDec = decltype(&crypto_aead_xchacha20poly1305_ietf_decrypt_detached);
+
+    template<typename K, typename E = AeadEnc>
+    static bool aeadEncrypt(std::span<const uint8_t> content, std::span<const uint8_t> ad, const uint8_t* nonce,
+                            uint8_t* mac, const K* key, E enc = crypto_aead_xchacha20poly1305_ietf_encrypt_detached) {
+        unsigned long long maclen;
+        return enc((uint8_t*)content.data(), mac, &maclen, content.data(), content.size(), ad.data(), ad.size(),
+                   NULL, nonce, key) == 0;
+    }
+    template<typename K, typename D = AeadDec>
+    bool aeadDecrypt(std::span<const uint8_t> content, std::span<const uint8_t> ad, const uint8_t* nonce,
+                     const uint8_t* mac, const K* key, bool keep, D dec = crypto_aead_xchacha20poly1305_ietf_decrypt_detached) {
+        auto m = (uint8_t*)content.data();
+        if (keep) {
+            if (m_scratch.size() < content.size()) m_scratch.resize(content.size());
+            m = m_scratch.data();
+        }
+        if (dec(m, NULL, content.data(), content.size(), mac, ad.data(), ad.size(), nonce, key) != 0) return false;
+        if (keep && content.size()) std::memcpy((uint8_t*)content.data(), m, content.size());
+        return true;
+    }
+
+    /*
+     * Group key list helpers for the sigmgrs that encrypt with a shared key. Key
+     * records ('ts' is the key's creation time) are kept newest first. A key
+     * distributor can hand out the next key before its creation time: it's then
+     * used to decrypt but senders stay on the current key until that time so
+     * receivers have the new key before the first packet that needs it.
+     *
+     * Senders using a 24-byte (XChaCha20) nonce put the key's id (the low bytes of
+     * its creation time) in the last keyIdSize bytes of the nonce so a receiver
+     * tries the matching key first and only falls back to the others if that fails
+     * (or if the ids collide). That leaves 176 random bits per nonce, far more than
+     * random-nonce collision resistance needs. AES-GCM's 12-byte nonce has no bits to
+     * spare so it carries no id and a receiver tries the current signing key first.
+     */
+    static constexpr size_t maxGroupKeys = 3;
+    static constexpr size_t keyIdSize = 2;
+    static constexpr size_t keyIdMinNonce = crypto_aead_xchacha20poly1305_IETF_NPUBBYTES;
+
+    static uint64_t nowMicros() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+    template<typename R>
+    static void addKeyRecord(std::vector<R>& kl, R&& r) {
+        auto it = std::find_if(kl.begin(), kl.end(), [ts = r.ts](const auto& k){ return k.ts <= ts; });
+        if (it != kl.end() && it->ts == r.ts) return;   // already have this key
+        kl.insert(it, std::move(r));
+        if (kl.size() > maxGroupKeys) kl.pop_back();
+    }
+    // the newest key whose creation time has arrived (the oldest if none has). The
+    // distributor only pre-stages one key at a time so, if the two newest keys are both
+    // in the future, the newest is a rekey that had to take effect at once (e.g., to
+    // exclude a removed member) which was made after, and supersedes, the pre-staged one.
+    template<typename R>
+    static const R& signingKey(const std::vector<R>& kl) {
+        auto now = nowMicros();
+        if (kl.size() > 1 && kl[1].ts > now) return kl.front();
+        for (const auto& k : kl) if (k.ts <= now) return k;
+        return kl.back();
+    }
+    static void setKeyId(std::span<uint8_t> nonce, uint64_t ts) {
+        if (nonce.size() < keyIdMinNonce) return;
+        for (size_t i = 0; i < keyIdSize; ++i) nonce[nonce.size() - keyIdSize + i] = uint8_t(ts >> (i*8));
+    }
+    static bool hasKeyId(std::span<const uint8_t> nonce, uint64_t ts) {
+        for (size_t i = 0; i < keyIdSize; ++i) if (nonce[nonce.size() - keyIdSize + i] != uint8_t(ts >> (i*8))) return false;
+        return true;
+    }
+    // order in which to try the keys of 'kl' on a packet with 'nonce': id matches (or,
+    // if the nonce can't carry an id, the signing key) first
+    template<typename R>
+    static auto tryOrder(const std::vector<R>& kl, std::span<const uint8_t> nonce) {
+        const bool ids = nonce.size() >= keyIdMinNonce;
+        const auto* sk = kl.empty()? nullptr : &signingKey(kl);
+        auto first = [&](size_t i) { return ids? hasKeyId(nonce, kl[i].ts) : &kl[i] == sk; };
+        std::array<uint8_t,maxGroupKeys> ord{};
+        size_t n{};
+        for (size_t i = 0; i < kl.size(); ++i) if (first(i)) ord[n++] = i;
+        for (size_t i = 0; i < kl.size(); ++i) if (! first(i)) ord[n++] = i;
+        return std::pair{ord, n};
+    }
+
+    /*
+     * The edSigned sigmgrs split signing into signPrep(), which does everything
+     * but the EdDSA signature (adds the sigInfo & signature TLVs, encrypts, ...)
+     * and returns the number of bytes at the start of d.rest() to be signed (0 if
+     * 'd' can't be signed), and edSign(), which puts the signature of those bytes
+     * in the last crypto_sign_BYTES of 'd'. verifyWith() checks an edSigned packet's
+     * signature given its signer's public key. Neither edSign() nor verifyWith()
+     * touch sigmgr state so they can be run on any thread.
+     */
+    virtual size_t signPrep(crData&, const SigInfo&) { return 0; }
+    virtual bool verifyWith(rData, keyRef) const { return false; }
+
+    static void edSign(crData& d, size_t n, keyRef sk) {
+        auto s = d.rest();
+        unsigned long long sigLen;
+        crypto_sign_detached((uint8_t*)s.data() + s.size() - crypto_sign_BYTES, &sigLen, s.data(), n, sk.data());
+    }
+
+    /*
+     * Asynchronous signing and batch validation using the threads of 'pool'.
+     * Both are called on the io thread and call their completion callback there.
+     * Whatever needs sigmgr or cert state (nonces, encryption, signer key lookup)
+     * is done before returning and only the EdDSA work is done by the pool so
+     * types that aren't edSigned are handled in line and just the callback is
+     * deferred. The packets are moved into the operation and handed back to the callback.
+     */
+    using SignCb = ofats::any_invocable<void(crData&&, bool)>;
+    using BatchCb = ofats::any_invocable<void(std::vector<crData>&&, std::vector<uint8_t>&&)>;
+
+    void signAsync(CryptoPool& pool, crData&& d, SignCb&& cb) {
+        if (! edSigned()) {
+            auto ok = sign(d);
+            pool.complete([d = std::move(d), ok, cb = std::move(cb)]() mutable { cb(std::move(d), ok); });
+            return;
+        }
+        auto n = m_signingKey.empty()? 0 : signPrep(d, m_sigInfo);
+        if (n == 0) {
+            pool.complete([d = std::move(d), cb = std::move(cb)]() mutable { cb(std::move(d), false); });
+            return;
+        }
+        pool.submit([&pool, d = std::move(d), n, sk = m_signingKey, cb = std::move(cb)]() mutable {
+                edSign(d, n, sk);
+                pool.complete([d = std::move(d), cb = std::move(cb)]() mutable { cb(std::move(d), true); });
+            });
+    }
+
+    /*
+     * For each i with ok[i] non-zero on entry, set ok[i] to whether d[i] validates
+     * (as validateBatch). Keys are copied once per run of packets with the same signer.
+     */
+    virtual void validateAsync(CryptoPool& pool, std::vector<crData>&& d, std::vector<uint8_t>&& ok, BatchCb&& cb) {
+        if (! edSigned()) {
+            validateBatch(std::vector<rData>(d.begin(), d.end()), ok);
+            pool.complete([d = std::move(d), ok = std::move(ok), cb = std::move(cb)]() mutable {
+                    cb(std::move(d), std::move(ok)); });
+            return;
+        }
+        std::vector<keyVal> keys{};
+        std::vector<uint32_t> ki(d.size());
+        const thumbPrint* tp{};
+        for (size_t i = 0; i < d.size(); ++i) {
+            if (! ok[i]) continue;
+            try {
+                const auto& t = d[i].thumbprint();
+                if (tp == nullptr || t != *tp) {
+                    tp = nullptr;
+                    auto pk = m_keyCb(d[i]);
+                    keys.emplace_back(pk.begin(), pk.end());
+                    tp = &t;
+                }
+            } catch (...) {
+                ok[i] = 0;
+                continue;
+            }
+            ki[i] = keys.size() - 1;
+        }
+        pool.submit([this, &pool, d = std::move(d), ok = std::move(ok), keys = std::move(keys), ki = std::move(ki),
+                     cb = std::move(cb)]() mutable {
+                for (size_t i = 0; i < d.size(); ++i) if (ok[i]) ok[i] = verifyWith(d[i], keys[ki[i]]);
+                pool.complete([d = std::move(d), ok = std::move(ok), cb = std::move(cb)]() mutable {
+                        cb(std::move(d), std::move(ok)); });
+            });
+    }
+
     SigType type() const noexcept { return m_type; };
     SigInfo getSigInfo() const noexcept { return m_sigInfo; }
 };
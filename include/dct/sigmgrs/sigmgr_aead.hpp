@@ -68,8 +68,9 @@ struct SigMgrAEAD final : SigMgr {
     struct keyRecord {
         keyVal key;
         keyVal iv;
+        uint64_t ts;
 
-        keyRecord(keyRef k, uint64_t kts) {
+        keyRecord(keyRef k, uint64_t kts) : ts{kts} {
             key.assign(k.begin(),k.end());
             //convert key timestamp to array of uint8_t
                 for(int i=0; i<8; ++i) iv.push_back((unsigned char) (kts >> (i*8)));
@@ -82,18 +83,15 @@ struct SigMgrAEAD final : SigMgr {
 
     std::array<uint8_t,nonceSize>  m_nonce;
     std::vector<keyRecord> m_keyList;
-    size_t m_decryptIndex;
 
     SigMgrAEAD() : SigMgr(stAEAD) {
         randombytes_buf(m_nonce.data(), m_nonce.size()); //always done - set unique part of nonce (12 bytes)
     }
 
-    // update to signing keyList with these values. New key goes
-    // at the front of keyList and no more than two keys are kept.
+    // add a key to keyList (ordered newest first, at most maxGroupKeys). A key
+    // whose creation time is in the future is pre-staged (see sigmgr.hpp).
     void addKey(keyRef k, uint64_t ktm) override final {
-        m_keyList.insert(m_keyList.begin(), keyRecord(k, ktm));
-        if(m_keyList.size() > 2) m_keyList.pop_back();
-        m_decryptIndex = (keyListSize() > 1) ? 1 : 0;
+        addKeyRecord(m_keyList, keyRecord(k, ktm));
     }
 
     bool sign(crData& d, const SigInfo& si, const keyVal&) override final {
@@ -121,15 +119,11 @@ struct SigMgrAEAD final : SigMgr {
         auto mac = std::span(sig.data() + nonceSize, macSize);
         std::copy(m_nonce.begin(), m_nonce.end(), sig.begin());
         sodium_increment(m_nonce.data(), nonceSize);
-        const auto& [curKey, curIV] = m_keyList.front();
-        for (auto i = 0u; i < curIV.size(); ++i) sig[i] ^= curIV[i];
-
-        std::vector<uint8_t> ctext(content.size(),0);
-        unsigned long long maclen;
-        if (crypto_aead_xchacha20poly1305_ietf_encrypt_detached(ctext.data(), mac.data(), &maclen,
-                             content.data(), content.size(), ad.data(), ad.size(),
-                             NULL, sig.data(), curKey.data()) != 0 )    return false;
-        if (content.size()) std::memcpy((uint8_t*)content.data(), ctext.data(), content.size());
+        const auto& cur = signingKey(m_keyList);
+        for (auto i = 0u; i < cur.iv.size(); ++i) sig[i] ^= cur.iv[i];
+        setKeyId(sig.first(nonceSize), cur.ts);
+
+        if (! aeadEncrypt(content, ad, sig.data(), mac.data(), cur.key.data())) return false;
         return true;
     }
 
@@ -149,19 +143,11 @@ struct SigMgrAEAD final : SigMgr {
         auto content = d.content().rest();
         auto ad = d.rest();
         ad = ad.first(content.data() - ad.data());
-        std::vector<uint8_t> decrypted(content.size(),0);
-        auto i = m_decryptIndex;    //start with last successful key
-        do {
-            if(crypto_aead_xchacha20poly1305_ietf_decrypt_detached(decrypted.data(),
-                             NULL, content.data(), content.size(), sig.data() + nonceSize,
-                             ad.data(), ad.size(), sig.data(), m_keyList[i].key.data()) == 0) {
-                m_decryptIndex = i; //successful key index
-                // copy decrypted content back into packet
-                if (content.size()) std::memcpy((uint8_t*)content.data(), decrypted.data(), content.size());
+        auto [ord, n] = tryOrder(m_keyList, sig.first(nonceSize));
+        for (size_t j = 0; j < n; ++j) {
+            if (aeadDecrypt(content, ad, sig.data(), sig.data() + nonceSize, m_keyList[ord[j]].key.data(), j + 1 < n))
                 return true;
-             }
-             i = (i + 1) % keyListSize();
-        } while (i != m_decryptIndex);
+        }
         print("aead decrypt failed on {}\n", d.name());
         return false;
     }
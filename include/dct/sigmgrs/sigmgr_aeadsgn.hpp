@@ -70,8 +70,9 @@ struct SigMgrAEADSGN final : SigMgr {
     struct keyRecord {
         keyVal key;
         keyVal iv;
+        uint64_t ts;
 
-        keyRecord(keyRef k, uint64_t kts) {
+        keyRecord(keyRef k, uint64_t kts) : ts{kts} {
             key.assign(k.begin(),k.end());
             //convert key timestamp to array of uint8_t
             for(int i=0; i<8; ++i) iv.push_back((unsigned char) (kts >> (i*8)));
@@ -84,7 +85,6 @@ struct SigMgrAEADSGN final : SigMgr {
 
     std::array<uint8_t,nonceSize>  m_nonce;
     std::vector<keyRecord> m_keyList;
-    size_t m_decryptIndex;
 
     SigMgrAEADSGN() : SigMgr(stAEADSGN) {
         randombytes_buf(m_nonce.data(), m_nonce.size()); //always done - set unique part of nonce (12 bytes)
@@ -103,16 +103,14 @@ struct SigMgrAEADSGN final : SigMgr {
         std::copy(tp.begin(), tp.end(), m_sigInfo.begin() + off);
         }
 
-    // update to encrypt/decrypt  keyList with these values. New key goes
-    // at the front of keyList and no more than two keys are kept.
+    // add a key to keyList (ordered newest first, at most maxGroupKeys). A key
+    // whose creation time is in the future is pre-staged (see sigmgr.hpp).
     void addKey(keyRef k, uint64_t ktm) override final {
-        m_keyList.insert(m_keyList.begin(), keyRecord(k, ktm));
-        if(m_keyList.size() > 2) m_keyList.pop_back();
-        m_decryptIndex = (keyListSize() > 1) ? 1 : 0;
+        addKeyRecord(m_keyList, keyRecord(k, ktm));
     }
 
-    bool sign(crData& d, const SigInfo& si, const keyVal&) override final {
-        if (!keyListSize()) return false;
+    size_t signPrep(crData& d, const SigInfo& si) override final {
+        if (!keyListSize()) return 0;
 
         // add the two final TLVs to 'd' to avoid realloc memcpy during signing
         d.siginfo(si);
@@ -136,21 +134,20 @@ struct SigMgrAEADSGN final : SigMgr {
         auto mac = std::span(sig.data() + nonceSize, macSize);
         std::copy(m_nonce.begin(), m_nonce.end(), sig.begin());
         sodium_increment(m_nonce.data(), nonceSize);
-        const auto& [curKey, curIV] = m_keyList.front();
-        for (auto i = 0u; i < curIV.size(); ++i) sig[i] ^= curIV[i];
-
-        std::vector<uint8_t> ctext(content.size(),0);
-        unsigned long long maclen;
-        if (crypto_aead_xchacha20poly1305_ietf_encrypt_detached(ctext.data(), mac.data(), &maclen,
-                             content.data(), content.size(), ad.data(), ad.size(),
-                             NULL, sig.data(), curKey.data()) != 0 )    return false;
-        if (content.size()) std::memcpy((uint8_t*)content.data(), ctext.data(), content.size());
-
-        //sign the data up through nonce|mac and put signature after nonce and mac
-        unsigned long long sigLen;
-        auto s = d.rest();
-        s = s.first(s.size() - crypto_sign_BYTES);
-        crypto_sign_detached(sig.data() + nonceSize + macSize, &sigLen, s.data(), s.size(), m_signingKey.data());
+        const auto& cur = signingKey(m_keyList);
+        for (auto i = 0u; i < cur.iv.size(); ++i) sig[i] ^= cur.iv[i];
+        setKeyId(sig.first(nonceSize), cur.ts);
+
+        if (! aeadEncrypt(content, ad, sig.data(), mac.data(), cur.key.data())) return 0;
+
+        // the signature of the data up through nonce|mac goes after nonce and mac
+        return d.rest().size() - crypto_sign_BYTES;
+    }
+
+    bool sign(crData& d, const SigInfo& si, const keyVal&) override final {
+        auto n = signPrep(d, si);
+        if (n == 0) return false;
+        edSign(d, n, m_signingKey);
         return true;
     }
     /*
@@ -165,19 +162,11 @@ struct SigMgrAEADSGN final : SigMgr {
         auto ad = d.rest();
         ad = ad.first(content.data() - ad.data());
         auto sig = d.signature().rest();
-        std::vector<uint8_t> decrypted(content.size(),0);
-        auto i = m_decryptIndex;    //start with last successful key
-        do {
-            if(crypto_aead_xchacha20poly1305_ietf_decrypt_detached(decrypted.data(),
-                             NULL, content.data(), content.size(), sig.data() + nonceSize,
-                             ad.data(), ad.size(), sig.data(), m_keyList[i].key.data()) == 0) {
-                m_decryptIndex = i; //successful key index
-                // copy decrypted content back into packet
-                if (content.size()) std::memcpy((uint8_t*)content.data(), decrypted.data(), content.size());
+        auto [ord, n] = tryOrder(m_keyList, sig.first(nonceSize));
+        for (size_t j = 0; j < n; ++j) {
+            if (aeadDecrypt(content, ad, sig.data(), sig.data() + nonceSize, m_keyList[ord[j]].key.data(), j + 1 < n))
                 return true;
-             }
-             i = (i + 1) % keyListSize();
-        } while (i != m_decryptIndex);
+        }
         print("aeadsgn decrypt failed on: ");
         print(" {}\n", d.name());
         return false;
@@ -190,9 +179,21 @@ struct SigMgrAEADSGN final : SigMgr {
      * the nonce and MAC.
      * The key locator is the thumbprint of the signer and EdDSA is used
      */
+    // verify the EdDSA signature following the nonce & MAC using publisher public key 'ppk'
+    bool verify(rData d, keyRef ppk) const {
+        auto sig = d.signature().rest();
+        if (sig.size() != sigSize) return false;
+        auto o = nonceSize + macSize;
+        auto strt = d.name().data();
+        return cachedVerify(d, ppk, [&] {
+                return crypto_sign_verify_detached(sig.data() + o, strt, sig.data() + o - strt, ppk.data()) == 0; });
+    }
+
+    bool verifyWith(rData d, keyRef pk) const override final { return verify(d, pk); }
+
     bool validate(rData d) override final {
         auto sig = d.signature().rest();
-        if (sig.size() != sigSize) { return false; }
+        if (sig.size() != sigSize) return false;
 
         keyRef ppk;                         // for publisher public key
         try {
@@ -200,12 +201,11 @@ struct SigMgrAEADSGN final : SigMgr {
         } catch(...) {
             return false;   // no public cert for key locator in the rData
         }
+        return verify(d, ppk);  //eddsa provenance and integrity check
+    }
 
-        auto o = nonceSize + macSize;
-        auto strt = d.name().data();
-        if(crypto_sign_verify_detached(sig.data() + o, strt, sig.data() + o - strt, ppk.data()) != 0)
-            return false;   //eddsa provenance and integrity verify failed
-        return true;
+    void validateBatch(std::span<const rData> d, std::span<uint8_t> ok) override final {
+        byKey(d, ok, [this](rData p, keyRef pk) { return verify(p, pk); });
     }
 
     /*
@@ -0,0 +1,153 @@
+#ifndef SIGMGRAESGCM_HPP
+#define SIGMGRAESGCM_HPP
+#pragma once
+/*
+ * AES-256-GCM AEAD Signature Manager
+ *
+ * Copyright (C) 2022 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+/*
+ * sigmgr_aesgcm.hpp is sigmgr_aead.hpp using libsodium's hardware AES-256-GCM
+ * (AES-NI/VAES + CLMUL on x86, the crypto extensions on ARMv8) instead of
+ * XChaCha20-Poly1305. On CPUs with AES support it's several times faster for
+ * typical (~1KB) packets. It uses the same group keys (distributed by
+ * dist_gkey.hpp) and the same nonce construction except that the nonce is
+ * 12 bytes: a random value (set at startup and incremented after each use)
+ * xor'd with the timestamp of the group key. Each group key's AES key
+ * schedule is computed once when the key arrives.
+ *
+ * libsodium has no software AES-GCM so sigMgrByType() substitutes
+ * sigmgr_aead.hpp on CPUs without AES support. This sigmgr accepts the
+ * AEAD (XChaCha20) packets such members send but *they can't decrypt AESGCM
+ * packets* so a schema should only select AESGCM when all members that need to
+ * read the encrypted packets have AES hardware.
+ */
+
+/*
+ * The SignatureInfo content is fixed 5 bytes for this signing method:
+ *  0x16 (SigInfo) <number of bytes to follow in SigInfo>
+ *  0x1b (SignatureType) <number of bytes to follow that give signatureType>
+ *  0x0e (encrypted with AES-256-GCM)
+ *  Followed by:
+ *  0x17 (SignatureValueType) <number of bytes in signature> <nonce><mac>
+ */
+
+#include <array>
+#include "sigmgr.hpp"
+
+namespace dct {
+
+struct SigMgrAESGCM final : SigMgr {
+    struct keyRecord {
+        crypto_aead_aes256gcm_state st; // AES key schedule
+        keyVal key;                     // (for XChaCha20 packets from members without AES)
+        keyVal iv;
+        uint64_t ts;
+
+        keyRecord(keyRef k, uint64_t kts) : ts{kts} {
+            key.assign(k.begin(),k.end());
+            crypto_aead_aes256gcm_beforenm(&st, k.data());
+            //convert key timestamp to array of uint8_t
+            for(int i=0; i<8; ++i) iv.push_back((unsigned char) (kts >> (i*8)));
+        }
+    };
+    static constexpr uint32_t aeadkeySize = crypto_aead_aes256gcm_KEYBYTES;
+    static constexpr uint32_t nonceSize = crypto_aead_aes256gcm_NPUBBYTES;
+    static constexpr uint32_t macSize = crypto_aead_aes256gcm_ABYTES;
+    static constexpr uint32_t sigSize = nonceSize + macSize;
+    // AEAD (XChaCha20) packets
+    static constexpr uint32_t xNonceSize = crypto_aead_xchacha20poly1305_IETF_NPUBBYTES;
+    static constexpr uint32_t xSigSize = xNonceSize + crypto_aead_xchacha20poly1305_IETF_ABYTES;
+    static_assert(aeadkeySize == crypto_aead_xchacha20poly1305_IETF_KEYBYTES && macSize == crypto_aead_xchacha20poly1305_IETF_ABYTES);
+
+    std::array<uint8_t,nonceSize>  m_nonce;
+    std::vector<keyRecord> m_keyList;
+
+    // true if this CPU can do AES-256-GCM
+    static bool available() { return sodium_init() != -1 && crypto_aead_aes256gcm_is_available(); }
+
+    SigMgrAESGCM() : SigMgr(stAESGCM) {
+        if (! available()) throw std::runtime_error("SigMgrAESGCM: CPU doesn't support AES-256-GCM");
+        randombytes_buf(m_nonce.data(), m_nonce.size()); //always done - set unique part of nonce
+    }
+
+    // add a key to keyList (ordered newest first, at most maxGroupKeys). A key
+    // whose creation time is in the future is pre-staged (see sigmgr.hpp).
+    void addKey(keyRef k, uint64_t ktm) override final {
+        if (k.size() != aeadkeySize) return;
+        addKeyRecord(m_keyList, keyRecord(k, ktm));
+    }
+
+    bool sign(crData& d, const SigInfo& si, const keyVal&) override final {
+        if (!keyListSize()) return false;
+
+        // add the two final TLVs to 'd' to avoid realloc memcpy during signing
+        d.siginfo(si);
+        auto sig = d.signature(sigSize);
+
+        // the content and associated data are the same as for sigmgr_aead.hpp
+        auto content = d.content().rest();
+        auto ad = d.rest();
+        ad = ad.first(content.data() - ad.data());
+
+        auto mac = std::span(sig.data() + nonceSize, macSize);
+        std::copy(m_nonce.begin(), m_nonce.end(), sig.begin());
+        sodium_increment(m_nonce.data(), nonceSize);
+        const auto& cur = signingKey(m_keyList);
+        for (auto i = 0u; i < cur.iv.size(); ++i) sig[i] ^= cur.iv[i];
+        setKeyId(sig.first(nonceSize), cur.ts);
+
+        return aeadEncrypt(content, ad, sig.data(), mac.data(), &cur.st, crypto_aead_aes256gcm_encrypt_detached_afternm);
+    }
+
+    /*
+     * returns true if success, false if failure. On success, the content of 'd' will have been decrypted.
+     */
+    bool validateDecrypt(rData d) override final {
+        //can't decrypt without a key
+        if(!keyListSize()) return false;
+
+        // signature holds nonce followed by computed MAC for this Data
+        auto sig = d.signature().rest();
+        bool x = d.sigType() == stAEAD;
+        if (sig.size() != (x? xSigSize : sigSize)) return false;
+        auto mac = sig.data() + (x? xNonceSize : nonceSize);
+        auto content = d.content().rest();
+        auto ad = d.rest();
+        ad = ad.first(content.data() - ad.data());
+        auto [ord, n] = tryOrder(m_keyList, sig.first(x? xNonceSize : nonceSize));
+        for (size_t j = 0; j < n; ++j) {
+            const auto& k = m_keyList[ord[j]];
+            auto keep = j + 1 < n;
+            if (x? aeadDecrypt(content, ad, sig.data(), mac, k.key.data(), keep) :
+                   aeadDecrypt(content, ad, sig.data(), mac, &k.st, keep, crypto_aead_aes256gcm_decrypt_detached_afternm))
+                return true;
+        }
+        print("aesgcm decrypt failed on {}\n", d.name());
+        return false;
+    }
+
+    inline size_t keyListSize() const { return m_keyList.size(); }
+};
+
+} // namespace dct
+
+#endif // SIGMGRAESGCM_HPP
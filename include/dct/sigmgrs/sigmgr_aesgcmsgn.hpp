@@ -0,0 +1,190 @@
+#ifndef SIGMGRAESGCMSGN_HPP
+#define SIGMGRAESGCMSGN_HPP
+#pragma once
+/*
+ * AES-256-GCM AEAD + EdDSA Signature Manager
+ *
+ * Copyright (C) 2022 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+/*
+ * sigmgr_aesgcmsgn.hpp is sigmgr_aeadsgn.hpp using hardware AES-256-GCM (see
+ * sigmgr_aesgcm.hpp) for the encryption: the content is encrypted then the
+ * packet through the nonce and MAC is signed by the originator with EdDSA.
+ * Since Publications MUST be signed this is the AES version to use for them.
+ *
+ * As with sigmgr_aesgcm.hpp, sigMgrByType() substitutes sigmgr_aeadsgn.hpp on
+ * CPUs without AES support and this sigmgr accepts the AEADSGN packets those
+ * members send (but they can't decrypt AESGCMSGN packets).
+ */
+
+/*
+ * The SignatureInfo content for this signing method:
+ *  0x16 (SigInfo) <number of bytes to follow in SigInfo>
+ *  0x1b (SignatureType) <number of bytes to follow that give signatureType>
+ *  0x0f (encrypted with AES-256-GCM, signed using EdDSA)
+ *  0x1c (KeyLocator) 0x1d (KeyDigest) <signer's thumbprint>
+ *  Followed by:
+ *  0x17 (SignatureValueType) <number of bytes in signature> <nonce><mac><EdDSA signature>
+ */
+
+#include <array>
+#include "sigmgr.hpp"
+#include "sigmgr_aesgcm.hpp"
+
+namespace dct {
+
+struct SigMgrAESGCMSGN final : SigMgr {
+    using keyRecord = SigMgrAESGCM::keyRecord;
+    static constexpr uint32_t nonceSize = SigMgrAESGCM::nonceSize;
+    static constexpr uint32_t macSize = SigMgrAESGCM::macSize;
+    static constexpr uint32_t sigSize = nonceSize + macSize + crypto_sign_BYTES;
+    // AEADSGN (XChaCha20) packets
+    static constexpr uint32_t xNonceSize = SigMgrAESGCM::xNonceSize;
+    static constexpr uint32_t xSigSize = SigMgrAESGCM::xSigSize + crypto_sign_BYTES;
+
+    std::array<uint8_t,nonceSize>  m_nonce;
+    std::vector<keyRecord> m_keyList;
+
+    SigMgrAESGCMSGN() : SigMgr(stAESGCMSGN) {
+        if (! SigMgrAESGCM::available()) throw std::runtime_error("SigMgrAESGCMSGN: CPU doesn't support AES-256-GCM");
+        randombytes_buf(m_nonce.data(), m_nonce.size()); //always done - set unique part of nonce
+    }
+
+    /*
+     * Called by parent when there is a new signing key.
+     * Use the pubcert tp to set up m_sigInfo
+     */
+    void updateSigningKey(keyRef sk, const rData& c) override final {
+        // update private signing key then compute thumbprint of cert and put it at end of sigInfo
+        m_signingKey.assign(sk.begin(), sk.end());
+        auto tp = c.computeTP();   // to reset thumbPrint in sigInfo
+        const auto off = m_sigInfo.size() - sizeof(tp);
+        std::copy(tp.begin(), tp.end(), m_sigInfo.begin() + off);
+    }
+
+    // add a key to keyList (ordered newest first, at most maxGroupKeys). A key
+    // whose creation time is in the future is pre-staged (see sigmgr.hpp).
+    void addKey(keyRef k, uint64_t ktm) override final {
+        if (k.size() != SigMgrAESGCM::aeadkeySize) return;
+        addKeyRecord(m_keyList, keyRecord(k, ktm));
+    }
+
+    size_t signPrep(crData& d, const SigInfo& si) override final {
+        if (!keyListSize()) return 0;
+
+        // add the two final TLVs to 'd' to avoid realloc memcpy during signing
+        d.siginfo(si);
+        auto sig = d.signature(sigSize);
+
+        auto content = d.content().rest();
+        auto ad = d.rest();
+        ad = ad.first(content.data() - ad.data());
+
+        auto mac = std::span(sig.data() + nonceSize, macSize);
+        std::copy(m_nonce.begin(), m_nonce.end(), sig.begin());
+        sodium_increment(m_nonce.data(), nonceSize);
+        const auto& cur = signingKey(m_keyList);
+        for (auto i = 0u; i < cur.iv.size(); ++i) sig[i] ^= cur.iv[i];
+        setKeyId(sig.first(nonceSize), cur.ts);
+
+        if (! aeadEncrypt(content, ad, sig.data(), mac.data(), &cur.st, crypto_aead_aes256gcm_encrypt_detached_afternm))
+            return 0;
+
+        // the signature of the data up through nonce|mac goes after nonce and mac
+        return d.rest().size() - crypto_sign_BYTES;
+    }
+
+    bool sign(crData& d, const SigInfo& si, const keyVal&) override final {
+        auto n = signPrep(d, si);
+        if (n == 0) return false;
+        edSign(d, n, m_signingKey);
+        return true;
+    }
+
+    /*
+     * Decrypts rData d's content and replaces d's content with the decrypted data
+     * This is used on rData that have already been validated
+     */
+    bool decrypt(rData d) override final {
+        if(!keyListSize()) return false;    //can't decrypt without a key
+        auto content = d.content().rest();
+        auto ad = d.rest();
+        ad = ad.first(content.data() - ad.data());
+        auto sig = d.signature().rest();
+        bool x = d.sigType() == stAEADSGN;
+        auto mac = sig.data() + (x? xNonceSize : nonceSize);
+        auto [ord, n] = tryOrder(m_keyList, sig.first(x? xNonceSize : nonceSize));
+        for (size_t j = 0; j < n; ++j) {
+            const auto& k = m_keyList[ord[j]];
+            auto keep = j + 1 < n;
+            if (x? aeadDecrypt(content, ad, sig.data(), mac, k.key.data(), keep) :
+                   aeadDecrypt(content, ad, sig.data(), mac, &k.st, keep, crypto_aead_aes256gcm_decrypt_detached_afternm))
+                return true;
+        }
+        print("aesgcmsgn decrypt failed on {}\n", d.name());
+        return false;
+    }
+
+    /*
+     * The signed region goes from the start of the name through the Signature tlv and includes
+     * the nonce and MAC. The key locator is the thumbprint of the signer and EdDSA is used.
+     */
+    // verify the EdDSA signature following the nonce & MAC using publisher public key 'ppk'
+    bool verify(rData d, keyRef ppk) const {
+        auto sig = d.signature().rest();
+        bool x = d.sigType() == stAEADSGN;
+        if (sig.size() != (x? xSigSize : sigSize)) return false;
+        auto o = (x? xNonceSize : nonceSize) + macSize;
+        auto strt = d.name().data();
+        return cachedVerify(d, ppk, [&] {
+                return crypto_sign_verify_detached(sig.data() + o, strt, sig.data() + o - strt, ppk.data()) == 0; });
+    }
+
+    bool verifyWith(rData d, keyRef pk) const override final { return verify(d, pk); }
+
+    bool validate(rData d) override final {
+        keyRef ppk;                         // for publisher public key
+        try {
+            ppk = m_keyCb(d);
+        } catch(...) {
+            return false;   // no public cert for key locator in the rData
+        }
+        return verify(d, ppk);  //eddsa provenance and integrity check
+    }
+
+    void validateBatch(std::span<const rData> d, std::span<uint8_t> ok) override final {
+        byKey(d, ok, [this](rData p, keyRef pk) { return verify(p, pk); });
+    }
+
+    /*
+     * returns true if success, false if failure. On success, the content of 'd' will have been decrypted.
+     */
+    bool validateDecrypt(rData d) override final {
+        if(! validate(d))    return false;
+        return decrypt(d);
+    }
+
+    inline size_t keyListSize() const { return m_keyList.size(); }
+};
+
+} // namespace dct
+
+#endif // SIGMGRAESGCMSGN_HPP
@@ -0,0 +1,122 @@
+#ifndef SIGMGRBLAKE2K_HPP
+#define SIGMGRBLAKE2K_HPP
+#pragma once
+/*
+ * Keyed BLAKE2b (RFC7693 MAC) Signature Manager
+ *
+ * Copyright (C) 2022 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+/*
+ * sigmgr_blake2k.hpp is sigmgr_rfc7693.hpp with the BLAKE2b hash keyed by the
+ * group key distributed by dist_gkey.hpp (i.e., the same key AEAD uses), making
+ * it a MAC: only members of the trust zone can make a signature that validates.
+ * The content is not encrypted. It's meant for cAdds on (physically) secured
+ * segments where authentication is needed but privacy isn't, since validating
+ * costs a hash of the packet rather than an EdDSA verify or AEAD decrypt.
+ *
+ * As with AEAD, it authenticates the trust zone, not the sender, so it can't
+ * be used for Publications (which MUST be signed by their originator).
+ *
+ * The BLAKE2b state after absorbing each group key is computed when the key
+ * arrives so a packet's MAC only costs hashing the packet. New keys go at the
+ * front of the key list and the previous one is kept so packets made with it
+ * still validate while the new key propagates.
+ */
+
+/*
+ * The SignatureInfo content is fixed 5 bytes for this signing method:
+ *  0x16 (SigInfo) <number of bytes to follow in SigInfo>
+ *  0x1b (SignatureType) <number of bytes to follow that give signatureType>
+ *  0x10 (keyed BLAKE2b)
+ *  Followed by:
+ *  0x17 (SignatureValueType) <number of bytes in signature> <MAC bytes>
+ */
+
+#include <array>
+
+#include "sigmgr.hpp"
+
+namespace dct {
+
+struct SigMgrBLAKE2K final : SigMgr {
+    static constexpr uint32_t keySize = crypto_generichash_KEYBYTES;
+    static constexpr uint32_t macSize = crypto_generichash_BYTES;
+
+    struct keyRecord {
+        crypto_generichash_state st;    // hash state after absorbing the key
+
+        keyRecord(keyRef k) { crypto_generichash_init(&st, k.data(), k.size(), macSize); }
+
+        // compute the MAC of 's' into 'mac'
+        void mac(std::span<const uint8_t> s, uint8_t* mac) const {
+            auto h = st;
+            crypto_generichash_update(&h, s.data(), s.size());
+            crypto_generichash_final(&h, mac, macSize);
+        }
+    };
+    std::vector<keyRecord> m_keyList;
+    size_t m_validateIndex{};
+
+    SigMgrBLAKE2K() : SigMgr(stBLAKE2K) { }
+
+    // New key goes at the front of keyList and no more than two keys are kept.
+    void addKey(keyRef k, uint64_t) override final {
+        if (k.size() != keySize) return;
+        m_keyList.insert(m_keyList.begin(), keyRecord(k));
+        if (m_keyList.size() > 2) m_keyList.pop_back();
+        m_validateIndex = (keyListSize() > 1) ? 1 : 0;
+    }
+
+    bool sign(crData& d, const SigInfo& si, const keyVal&) override final {
+        if (! keyListSize()) return false;
+        d.siginfo(si);
+        auto sig = d.signature(macSize);
+        auto s = d.rest();
+        s = s.first(s.size() - sig.size() - 2);
+        m_keyList.front().mac(s, sig.data());
+        return true;
+    }
+
+    bool validate(rData d) override final {
+        if (! keyListSize()) return false;
+        auto sig = d.signature();
+        if (sig.size() - sig.off() != macSize) return false;
+        auto strt = d.name().data();
+        auto s = std::span<const uint8_t>(strt, sig.data() - strt);
+        std::array<uint8_t, macSize> mac;
+        auto i = m_validateIndex;    //start with last successful key
+        do {
+            m_keyList[i].mac(s, mac.data());
+            if (sodium_memcmp(sig.data() + sig.off(), mac.data(), mac.size()) == 0) {
+                m_validateIndex = i;
+                return true;
+            }
+            i = (i + 1) % keyListSize();
+        } while (i != m_validateIndex);
+        return false;
+    }
+
+    inline size_t keyListSize() const { return m_keyList.size(); }
+};
+
+} // namespace dct
+
+#endif // SIGMGRBLAKE2K_HPP
@@ -40,6 +40,9 @@
  *  0x0b PPAEAD
  *  0x0c PPSIGN
  *  0x0d AEADSGN
+ *  0x0e AESGCM     (AEAD if the CPU can't do AES-256-GCM)
+ *  0x0f AESGCMSGN  (AEADSGN if the CPU can't do AES-256-GCM)
+ *  0x10 BLAKE2K
  */
 #include <string>
 #include <string_view>
@@ -53,6 +56,9 @@
 #include "sigmgr_ppaead.hpp"
 #include "sigmgr_ppaeadsgn.hpp"
 #include "sigmgr_aeadsgn.hpp"
+#include "sigmgr_aesgcm.hpp"
+#include "sigmgr_aesgcmsgn.hpp"
+#include "sigmgr_blake2k.hpp"
 #include "sigmgr_null.hpp"
 
 namespace dct {
@@ -62,7 +68,8 @@ using namespace std::string_literals;
 template<class... Ts> struct overload : Ts... { using Ts::operator()...; };
 template<class... Ts> overload(Ts...) -> overload<Ts...>;
 
-using Variants = std::variant<SigMgrSHA256,SigMgrAEAD,SigMgrRFC7693,SigMgrNULL,SigMgrEdDSA,SigMgrPPAEAD,SigMgrPPSIGN,SigMgrAEADSGN>;
+using Variants = std::variant<SigMgrSHA256,SigMgrAEAD,SigMgrRFC7693,SigMgrNULL,SigMgrEdDSA,SigMgrPPAEAD,SigMgrPPSIGN,SigMgrAEADSGN,
+                              SigMgrAESGCM,SigMgrAESGCMSGN,SigMgrBLAKE2K>;
 
 struct SigMgrAny : Variants {
     using Variants::Variants;
@@ -70,13 +77,23 @@ struct SigMgrAny : Variants {
     // return a reference to whichever sigmgr is in the variant
     SigMgr& ref() const noexcept { return (SigMgr&)*this; }
 
-    // invoke methods of whichever sigmgr is set in the variant
-    bool sign(crData& d) { return ref().sign(d); }
-    bool sign(crData& d, const SigInfo& s) { return ref().sign(d, s); }
-    bool sign(crData& d, const SigInfo& s, const keyVal& k) { return ref().sign(d, s, k); }
-    bool validate(rData d) { return ref().validate(d); }
+    // call 'f' with whichever sigmgr is in the variant as its concrete type. Since the
+    // sigmgrs are 'final', the calls 'f' makes are direct (so can be inlined) rather
+    // than virtual. (A method the concrete sigmgr doesn't override resolves to SigMgr's.)
+    template<typename F>
+    decltype(auto) visit(F&& f) { return std::visit(std::forward<F>(f), static_cast<Variants&>(*this)); }
+
+    // invoke methods of whichever sigmgr is set in the variant. The per-packet
+    // ones are dispatched by visit(), the rest through ref().
+    bool sign(crData& d) { return visit([&d](auto& sm) { return sm.sign(d, sm.m_sigInfo, sm.m_signingKey); }); }
+    bool sign(crData& d, const SigInfo& s) { return visit([&](auto& sm) { return sm.sign(d, s, sm.m_signingKey); }); }
+    bool sign(crData& d, const SigInfo& s, const keyVal& k) { return visit([&](auto& sm) { return sm.sign(d, s, k); }); }
+    bool validate(rData d) { return visit([d](auto& sm) { return sm.validate(d); }); }
     bool validate(rData d, const rData& c) { return ref().validate(d, c); }
-    bool validateDecrypt(rData d) { return ref().validateDecrypt(d); }
+    bool validateDecrypt(rData d) { return visit([d](auto& sm) { return sm.validateDecrypt(d); }); }
+    void validateBatch(std::span<const rData> d, std::span<uint8_t> ok) {
+        visit([d, ok](auto& sm) { sm.validateBatch(d, ok); });
+    }
     bool validateDecrypt(rData d, const rData& c) { return ref().validateDecrypt(d, c); };
 
     void addKey(keyRef k, uint64_t ktm = 0) { ref().addKey(k, ktm); }
@@ -95,7 +112,10 @@ static inline const std::unordered_map<std::string,uint8_t> sigmgr_name_to_type
     {"NULL"s,    stNULL},
     {"PPAEAD"s,  stPPAEAD},
     {"PPSIGN"s,  stPPSIGN},
-    {"AEADSGN"s, stAEADSGN}
+    {"AEADSGN"s, stAEADSGN},
+    {"AESGCM"s,  stAESGCM},
+    {"AESGCMSGN"s, stAESGCMSGN},
+    {"BLAKE2K"s, stBLAKE2K}
 };
 
 static inline SigMgrAny sigMgrByType(uint8_t type) {
@@ -108,6 +128,10 @@ static inline SigMgrAny sigMgrByType(uint8_t type) {
         case stPPAEAD:  return SigMgrPPAEAD();
         case stPPSIGN:    return SigMgrPPSIGN();
         case stAEADSGN: return SigMgrAEADSGN();
+        // libsodium only has hardware AES so fall back to XChaCha20 without it
+        case stAESGCM:  if (SigMgrAESGCM::available()) return SigMgrAESGCM(); else return SigMgrAEAD();
+        case stAESGCMSGN: if (SigMgrAESGCM::available()) return SigMgrAESGCMSGN(); else return SigMgrAEADSGN();
+        case stBLAKE2K: return SigMgrBLAKE2K();
     }
     throw std::runtime_error(format("sigMgrByType: unknown signer type {}", type));
 }
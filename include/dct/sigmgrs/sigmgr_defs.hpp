@@ -31,6 +31,8 @@
  * their signatures.
  */
 
+#include <array>
+#include <cstring>
 #include <functional>
 #include <span>
 #include <vector>
@@ -43,7 +45,21 @@ extern "C" {
 namespace dct {
     constexpr size_t thumbPrint_s{crypto_hash_sha256_BYTES};
     using thumbPrint = std::array<uint8_t,thumbPrint_s>;
+} // namespace dct
+
+// XXX would be nice if std:array had its own hash specialization.
+// A thumbprint is a SHA256 hash so its first bytes are already uniformly distributed
+// and can be the hash (saving a hash of 32 bytes per lookup). (The thumbprints in the
+// maps all come from packets that passed wire validation.)
+template<> struct std::hash<dct::thumbPrint> {
+    size_t operator()(const dct::thumbPrint& tp) const noexcept {
+        size_t h;
+        std::memcpy(&h, tp.data(), sizeof(h));
+        return h;
+    }
+};
 
+namespace dct {
     using keyVal = std::vector<uint8_t>;
     using keyRef = std::span<const uint8_t>;
     using SigInfo = std::vector<uint8_t>;
@@ -58,6 +74,9 @@ namespace dct {
     static constexpr SigType stPPAEAD = 11;
     static constexpr SigType stPPSIGN = 12;
     static constexpr SigType stAEADSGN = 13;
+    static constexpr SigType stAESGCM = 14;
+    static constexpr SigType stAESGCMSGN = 15;
+    static constexpr SigType stBLAKE2K = 16;
 
 } // namespace dct
 
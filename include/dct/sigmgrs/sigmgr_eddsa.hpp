@@ -108,16 +108,20 @@ struct SigMgrEdDSA final : SigMgr {
     /* private signing key */
     void addKey(keyRef sk, uint64_t = 0) override final { m_signingKey.assign(sk.begin(), sk.end()); }
 
-    bool sign(crData& d, const SigInfo& si, const keyVal& sk) override final {
-        if(sk.empty() || si.empty()) return false;
+    size_t signPrep(crData& d, const SigInfo& si) override final {
+        if(si.empty()) return 0;
 
         // add the two final TLVs to 'd' to avoid realloc memcpy during signing
         d.siginfo(si);
         auto sig = d.signature(crypto_sign_BYTES);
-        unsigned long long sigLen;
-        auto s = d.rest();
-        s = s.first(s.size() - sig.size() - 2);
-        crypto_sign_detached(sig.data(), &sigLen, s.data(), s.size(), sk.data());
+        return d.rest().size() - sig.size() - 2;
+    }
+
+    bool sign(crData& d, const SigInfo& si, const keyVal& sk) override final {
+        if(sk.empty()) return false;
+        auto n = signPrep(d, si);
+        if (n == 0) return false;
+        edSign(d, n, sk);
         return true;
     }
 
@@ -128,9 +132,12 @@ struct SigMgrEdDSA final : SigMgr {
 
         // signed region goes from start of 'name' to end of 'signature' tlv
         auto strt = d.name().data();
-        return crypto_sign_verify_detached(sig.data() + sig.off(), strt, sig.data() - strt, pk.data()) == 0;
+        return cachedVerify(d, pk, [&] {
+                return crypto_sign_verify_detached(sig.data() + sig.off(), strt, sig.data() - strt, pk.data()) == 0; });
     }
 
+    bool verifyWith(rData d, keyRef pk) const override final { return validate(d, pk); }
+
     bool validate(rData d, const rData& scert) override final { return validate(d, scert.content().rest()); }
 
     bool validate(rData d) override final {
@@ -138,6 +145,11 @@ struct SigMgrEdDSA final : SigMgr {
         try { return validate(d, m_keyCb(d)); } catch (...) {}
         return false;
     }
+
+    void validateBatch(std::span<const rData> d, std::span<uint8_t> ok) override final {
+        assert(m_keyCb != 0);
+        byKey(d, ok, [this](rData p, keyRef pk) { return validate(p, pk); });
+    }
 };
 
 } // namespace dct
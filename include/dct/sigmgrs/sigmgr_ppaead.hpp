@@ -74,6 +74,7 @@
 #include <cstring>  // for memcpy
 #include "dct/utility.hpp"
 #include "sigmgr.hpp"
+#include "sg_dec_keys.hpp"
 
 namespace dct {
 
@@ -100,7 +101,7 @@ struct SigMgrPPAEAD final : SigMgr {
     std::array<uint8_t,nonceSize>  m_nonce;
     size_t m_decryptIndex;      //index of SG key pairs to try first (usually last successful one)
     keyVal m_publicKey{};           //the public key for this publisher
-    std::unordered_map<thumbPrint, keyVal> m_decKeys;   //keep list of computed decryption keys
+    SGDecKeys m_decKeys{};          //per-publisher decryption keys
     //this vector keeps group keys and derived information - up to two deep
     std::vector<kpInfo>  m_keyList{};
 
@@ -169,6 +170,16 @@ struct SigMgrPPAEAD final : SigMgr {
         m_decryptIndex = m_keyList.size(); //set to 0 if new key pair, otherwise set to 1 (the previous kp)
         //add to front of key pair vector; encryption key isn't computed until first use
         m_keyList.insert(m_keyList.begin(), kpi);
+        //shift publishers' decryption keys to match and derive those for the new pair
+        try { m_decKeys.rekey(m_keyList[0].pk, m_keyList[0].sk); } catch(...) {}
+    }
+
+    // a publisher's signing cert arrived: set up its decryption key(s) before its first packet
+    void addSigner(const thumbPrint& tp, keyRef pk) override final {
+        try {
+            if (m_keyList.empty()) m_decKeys.add(tp, pk);
+            else m_decKeys.addSigner(tp, pk, m_keyList[0].pk, m_keyList[0].sk);
+        } catch(...) {}
     }
 
     /*
@@ -206,12 +217,7 @@ struct SigMgrPPAEAD final : SigMgr {
         const auto& curIV = m_keyList.front().iv;
         for (auto i = 0u; i < curIV.size(); ++i) sig[i] ^= curIV[i];
 
-        std::vector<uint8_t> ctext(content.size(),0);
-        unsigned long long maclen;
-        crypto_aead_xchacha20poly1305_ietf_encrypt_detached(ctext.data(), mac.data(), &maclen,
-                             content.data(), content.size(), ad.data(), ad.size(),
-                             NULL, sig.data(), curKey.data());
-            if (content.size())  std::memcpy((uint8_t*)content.data(), ctext.data(), content.size());
+        aeadEncrypt(content, ad, sig.data(), mac.data(), curKey.data());
         return true;
     }
 
@@ -228,57 +234,30 @@ struct SigMgrPPAEAD final : SigMgr {
         if (sig.size() != sigSize) return false;
 
         const auto& tp = d.thumbprint();    //get the thumbprint of publisher
-        if(! m_decKeys.contains(tp)) {  //get or compute the associated decryption key
-            try {
-                computeDecKey(0, m_keyCb(d), tp);   //compute decryption key using latest SG key pair
-            } catch(...) {
-                return false;   //no public cert for thumbprint in key locator field
-            }
-        }
-        keyVal curKey = m_decKeys.at(tp);
 
         auto content = d.content().rest();
         auto ad = d.rest();
         ad = ad.first(content.data() - ad.data());
         //decrypt
-        std::vector<uint8_t> decrypted(content.size(),0);
         auto i = m_decryptIndex;            //start with last successful key
         do {
-            if(crypto_aead_xchacha20poly1305_ietf_decrypt_detached(decrypted.data(),
-                             NULL, content.data(), content.size(), sig.data() + nonceSize,
-                             ad.data(), ad.size(), sig.data(), curKey.data()) == 0) {
-                // copy decrypted content back into packet
-                if (content.size())  std::memcpy((uint8_t*)content.data(), decrypted.data(), content.size());
+            const keyVal* dk;
+            try {
+                dk = &m_decKeys.get(tp, [this,&d]{ return m_keyCb(d); }, i, m_keyList[i].pk, m_keyList[i].sk);
+            } catch(...) {
+                return false;   //no public cert for thumbprint in key locator field
+            }
+            auto next = (i + 1) % m_keyList.size();
+            // keep the ciphertext if there's another key pair to try
+            if (aeadDecrypt(content, ad, sig.data(), sig.data() + nonceSize, dk->data(), next != m_decryptIndex)) {
                 m_decryptIndex = i; //successful key index
                 return true;
-             }
-             if(m_keyList.size() > 1) { //try next key pair if there is one
-                 i = i==0? 1 : 0;
-                 if(i == m_decryptIndex) {   //been here before
-                    return false;   //unable to decrypt
-                 }
-                 computeDecKey(i, m_keyCb(d), tp);   //recompute decryption key using other SG key pair
-                 curKey = m_decKeys.at(tp);
             }
+            i = next;
         } while (i != m_decryptIndex);
         return false;   //unable to decrypt
     }
 
-    //compute the SG decryption key for this publisher and i-th sg key pair
-    // should perhaps remove the older SG key pair after some set expiration time?
-    // would then need to keep the update time
-    void computeDecKey(size_t i, keyRef pk, thumbPrint tp) {
-        //(re)compute decryption key for this publisher using the newest SG key pair
-        unsigned char xpk[crypto_scalarmult_curve25519_BYTES];
-        if (crypto_sign_ed25519_pk_to_curve25519(xpk, pk.data()) != 0) {
-            throw std::runtime_error("sigmgr_ppaead::computeDecKey unable to convert signing pk to sealed box pk");
-        }
-        unsigned char dk[crypto_kx_SESSIONKEYBYTES];
-        if (crypto_kx_server_session_keys(dk, NULL, m_keyList[i].pk.data(), m_keyList[i].sk.data(), xpk) != 0) {
-            throw std::runtime_error("sigmgr_ppaead::computeDecKey unable to convert signing pk to sealed box pk");
-        }
-        m_decKeys[tp].assign(dk, dk + crypto_kx_SESSIONKEYBYTES);
-    }
 };
 
 } // namespace dct
@@ -62,6 +62,7 @@
 #include <cstring>  // for memcpy
 #include "dct/utility.hpp"
 #include "sigmgr.hpp"
+#include "sg_dec_keys.hpp"
 
 namespace dct {
 
@@ -88,7 +89,7 @@ struct SigMgrPPSIGN final : SigMgr {
     std::array<uint8_t,nonceSize>  m_nonce;
     size_t m_decryptIndex;      //index of SG key pairs to try first (usually last successful one)
     keyVal m_publicKey{};           //the public key for this publisher
-    std::unordered_map<thumbPrint, keyVal> m_decKeys;   //keep list of computed decryption keys
+    SGDecKeys m_decKeys{};          //per-publisher decryption keys
     //this vector keeps subscriber group key pairs and derived information - up to two deep
     std::vector<kpInfo>  m_keyList{};
 
@@ -157,6 +158,16 @@ struct SigMgrPPSIGN final : SigMgr {
         m_decryptIndex = m_keyList.size(); //set to 0 if new key pair, otherwise set to 1 (the previous kp)
         //add to front of key pair vector; encryption key isn't computed until first use
         m_keyList.insert(m_keyList.begin(), kpi);
+        //shift publishers' decryption keys to match and derive those for the new pair
+        try { m_decKeys.rekey(m_keyList[0].pk, m_keyList[0].sk); } catch(...) {}
+    }
+
+    // a publisher's signing cert arrived: set up its decryption key(s) before its first packet
+    void addSigner(const thumbPrint& tp, keyRef pk) override final {
+        try {
+            if (m_keyList.empty()) m_decKeys.add(tp, pk);
+            else m_decKeys.addSigner(tp, pk, m_keyList[0].pk, m_keyList[0].sk);
+        } catch(...) {}
     }
 
     /*
@@ -164,8 +175,8 @@ struct SigMgrPPSIGN final : SigMgr {
      * the publisher's unique encryption key and initial vector (m_encKey and m_encIV)
        get used in signing which is otherwise like AEAD
      */
-    bool sign(crData& d, const SigInfo& si, const keyVal&) override final {
-        if(!pKeyListSize()) return false; //can't sign without a signing group public key
+    size_t signPrep(crData& d, const SigInfo& si) override final {
+        if(!pKeyListSize()) return 0; //can't sign without a signing group public key
         if(eKeySize(0) == 0) computeNewEncKey(); //haven't yet computed an encryption key
 
         // add the two final TLVs to 'd' to avoid realloc memcpy during signing
@@ -194,18 +205,16 @@ struct SigMgrPPSIGN final : SigMgr {
         const auto& curIV = m_keyList.front().iv;
         for (auto i = 0u; i < curIV.size(); ++i) sig[i] ^= curIV[i];
 
-        std::vector<uint8_t> ctext(content.size(),0);
-        unsigned long long maclen;
-        crypto_aead_xchacha20poly1305_ietf_encrypt_detached(ctext.data(), mac.data(), &maclen,
-                             content.data(), content.size(), ad.data(), ad.size(),
-                             NULL, sig.data(), curKey.data());
-           if (content.size())  std::memcpy((uint8_t*)content.data(), ctext.data(), content.size());
-
-        //sign the data up through nonce|mac and put signature after nonce and mac
-        unsigned long long sigLen;
-        auto s = d.rest();
-        s = s.first(s.size() - crypto_sign_BYTES);
-        crypto_sign_detached(sig.data() + nonceSize + macSize, &sigLen, s.data(), s.size(), m_signingKey.data());
+        aeadEncrypt(content, ad, sig.data(), mac.data(), curKey.data());
+
+        // the signature of the data up through nonce|mac goes after nonce and mac
+        return d.rest().size() - crypto_sign_BYTES;
+    }
+
+    bool sign(crData& d, const SigInfo& si, const keyVal&) override final {
+        auto n = signPrep(d, si);
+        if (n == 0) return false;
+        edSign(d, n, m_signingKey);
         return true;
     }
 
@@ -220,39 +229,27 @@ struct SigMgrPPSIGN final : SigMgr {
 
         //get the decryption key associated with the publisher
         const auto& tp = d.thumbprint();
-        keyRef ppk;
-        try {
-            ppk = m_keyCb(d);           // get public cert of d's signer
-        } catch(...) {  return false;  }  //no public cert for thumbprint in Data
-
-        if(! m_decKeys.contains(tp))
-            computeDecKey(0, ppk, tp);   //compute decryption key using latest SG key pair
-        keyVal curKey = m_decKeys.at(tp);
 
         auto sig = d.signature().rest();
         auto content = d.content().rest();
         auto ad = d.rest();
         ad = ad.first(content.data() - ad.data());
         //decrypt
-        std::vector<uint8_t> decrypted(content.size(),0);
         auto i = m_decryptIndex;            //start with last successful key
         do {
-            if(crypto_aead_xchacha20poly1305_ietf_decrypt_detached(decrypted.data(),
-                             NULL, content.data(), content.size(), sig.data() + nonceSize,
-                             ad.data(), ad.size(), sig.data(), curKey.data()) == 0) {
-                // copy decrypted content back into packet
-                if (content.size()) std::memcpy((uint8_t*)content.data(), decrypted.data(), content.size());
+            const keyVal* dk;
+            try {
+                dk = &m_decKeys.get(tp, [this,&d]{ return m_keyCb(d); }, i, m_keyList[i].pk, m_keyList[i].sk);
+            } catch(...) {
+                return false;   //no public cert for thumbprint in key locator field
+            }
+            auto next = (i + 1) % m_keyList.size();
+            // keep the ciphertext if there's another key pair to try
+            if (aeadDecrypt(content, ad, sig.data(), sig.data() + nonceSize, dk->data(), next != m_decryptIndex)) {
                 m_decryptIndex = i; //successful key index
                 return true;
-             }
-             if(m_keyList.size() > 1) { //try next key pair if there is one
-                 i = i==0? 1 : 0;
-                 if(i == m_decryptIndex) {   //been here before
-                    return false;   //unable to decrypt
-                 }
-                 computeDecKey(i, ppk, tp);   //recompute decryption key using other SG key pair
-                 curKey = m_decKeys.at(tp);
             }
+            i = next;
         } while (i != m_decryptIndex);
         return false;   //unable to decrypt
     }
@@ -263,22 +260,33 @@ struct SigMgrPPSIGN final : SigMgr {
      * the nonce and MAC.
      * The key locator is the thumbprint of the signer and EdDSA is used
      */
+    // verify the EdDSA signature following the nonce & MAC using publisher public key 'ppk'
+    bool verify(rData d, keyRef ppk) const {
+        auto sig = d.signature().rest();
+        if (sig.size() != sigSize) return false;
+        auto o = nonceSize + macSize;
+        auto strt = d.name().data();
+        return cachedVerify(d, ppk, [&] {
+                return crypto_sign_verify_detached(sig.data() + o, strt, sig.data() + o - strt, ppk.data()) == 0; });
+    }
+
+    bool verifyWith(rData d, keyRef pk) const override final { return verify(d, pk); }
+
     bool validate(rData d) override final {
         auto sig = d.signature().rest();
         if (sig.size() != sigSize) return false;
 
-        keyRef ppk;                                    //publisher public key
+        keyRef ppk;                         // for publisher public key
         try {
             ppk = m_keyCb(d);
         } catch(...) {
-            return false;   //no public cert for thumbprint
+            return false;   // no public cert for key locator in the rData
         }
+        return verify(d, ppk);  //eddsa provenance and integrity check
+    }
 
-        auto o = nonceSize + macSize;
-        auto strt = d.name().data();
-        if(crypto_sign_verify_detached(sig.data() + o, strt, sig.data() + o - strt, ppk.data()) != 0)
-            return false;   //eddsa provenance and integrity verify failed
-        return true;
+    void validateBatch(std::span<const rData> d, std::span<uint8_t> ok) override final {
+        byKey(d, ok, [this](rData p, keyRef pk) { return verify(p, pk); });
     }
 
     // returns true if success, false if failure. On success, the content of 'd' will have been decrypted.
@@ -287,21 +295,6 @@ struct SigMgrPPSIGN final : SigMgr {
         return decrypt(d);
     }
 
-    //compute the SG decryption key for this publisher and i-th sg key pair
-    // should perhaps remove the older SG key pair after some set expiration time?
-    // would then need to keep the update time
-    void computeDecKey(size_t i, keyRef pk, thumbPrint tp) {
-        //(re)compute decryption key for this publisher using the newest SG key pair
-        unsigned char xpk[crypto_scalarmult_curve25519_BYTES];
-        if (crypto_sign_ed25519_pk_to_curve25519(xpk, pk.data()) != 0) {
-            throw std::runtime_error("sigmgr_ppsign::computeDecKey unable to convert signing pk to sealed box pk");
-        }
-        unsigned char dk[crypto_kx_SESSIONKEYBYTES];
-        if (crypto_kx_server_session_keys(dk, NULL, m_keyList[i].pk.data(), m_keyList[i].sk.data(), xpk) != 0) {
-            throw std::runtime_error("sigmgr_ppsign::computeDecKey unable to convert signing pk to sealed box pk");
-        }
-        m_decKeys[tp].assign(dk, dk + crypto_kx_SESSIONKEYBYTES);
-    }
 };
 
 } // namespace dct
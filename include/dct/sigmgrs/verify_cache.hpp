@@ -0,0 +1,167 @@
+#ifndef DCT_SIGMGRS_VERIFY_CACHE_HPP
+#define DCT_SIGMGRS_VERIFY_CACHE_HPP
+#pragma once
+/*
+ * Process-wide cache of successful signature verifications
+ *
+ * Copyright (C) 2022 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This is not intended as production code.
+ */
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+extern "C" {
+    #include <sodium.h>
+};
+
+namespace dct {
+
+/**
+ * A relay sees the same publication on each of its faces and validates it on
+ * each then again when it's relayed so, without help, it does the same
+ * asymmetric signature check once per hop. A VerifyCache remembers which
+ * (packet, signing key) pairs have verified so the repeats cost a hash.
+ *
+ * Entries are 64 bit tags from a BLAKE2b hash keyed with a secret random
+ * per-process key over the packet's bytes and the signer's public key. Since
+ * the hash key is unknown outside the process, a packet can't be crafted to
+ * match a cached tag. Only successes are cached (a failure might be due to a
+ * key that's not yet known) and a key only verifies after the signer's cert
+ * is found so cert checks done before verification still gate every packet.
+ *
+ * The table is 4-way set associative with CLOCK (second chance) replacement
+ * within a set: each tag's low bit is its 'referenced' bit, set on a hit and
+ * cleared as the replacement hand passes. Slots are atomic words so the cache
+ * can be shared lock-free by all the DeftTs (and validation threads) of a
+ * process. Racing updates can lose an entry, never corrupt one.
+ *
+ * There's one cache per process and it's off until enable() is called (or the
+ * DCT_VERIFY_CACHE environment variable is set to the number of entries).
+ */
+class VerifyCache {
+    static constexpr size_t ways = 4;
+    using Set = std::array<std::atomic<uint64_t>,ways>;
+
+    std::vector<Set> sets_;
+    uint64_t mask_;
+    std::array<uint8_t,crypto_generichash_KEYBYTES> key_;
+    std::atomic<uint64_t> hits_{};
+    std::atomic<uint64_t> misses_{};
+
+    static inline std::atomic<VerifyCache*> cache_{};
+
+    // 0 marks an empty slot so tags always have a non-zero high part
+    static constexpr uint64_t tagOf(uint64_t h) noexcept { h &= ~uint64_t(1); return h? h : 2; }
+
+    Set& set(uint64_t t) noexcept { return sets_[(t >> 1) & mask_]; }
+
+  public:
+    explicit VerifyCache(size_t entries)
+        : sets_(std::bit_ceil(std::max<size_t>(entries / ways, 1))), mask_{sets_.size() - 1} {
+        if (sodium_init() == -1) exit(EXIT_FAILURE);
+        randombytes_buf(key_.data(), key_.size());
+    }
+    VerifyCache(const VerifyCache&) = delete;
+    VerifyCache& operator=(const VerifyCache&) = delete;
+
+    /*
+     * Turn on the process-wide cache with (about) 'entries' entries. Should be
+     * done before any DeftT is started. Only the first call has any effect.
+     */
+    static void enable(size_t entries = 1u << 16) {
+        static std::once_flag once;
+        static std::unique_ptr<VerifyCache> owner;
+        std::call_once(once, [entries] {
+                owner = std::make_unique<VerifyCache>(entries);
+                cache_.store(owner.get(), std::memory_order_release);
+            });
+    }
+
+    // the process's cache (nullptr if it's not enabled)
+    static VerifyCache* get() noexcept {
+        static const bool fromEnv = [] {
+                if (auto e = getenv("DCT_VERIFY_CACHE"); e && std::atoll(e) > 0) enable(std::atoll(e));
+                return true;
+            }();
+        (void)fromEnv;
+        return cache_.load(std::memory_order_acquire);
+    }
+
+    // tag of the packet bytes 'pkt' signed with public key 'pk'
+    uint64_t tag(std::span<const uint8_t> pkt, std::span<const uint8_t> pk) const noexcept {
+        crypto_generichash_state st;
+        uint64_t h;
+        crypto_generichash_init(&st, key_.data(), key_.size(), sizeof(h));
+        crypto_generichash_update(&st, pkt.data(), pkt.size());
+        crypto_generichash_update(&st, pk.data(), pk.size());
+        crypto_generichash_final(&st, (uint8_t*)&h, sizeof(h));
+        return tagOf(h);
+    }
+
+    bool contains(uint64_t t) noexcept {
+        for (auto& s : set(t)) {
+            auto v = s.load(std::memory_order_relaxed);
+            if ((v & ~uint64_t(1)) != t) continue;
+            if ((v & 1) == 0) s.fetch_or(1, std::memory_order_relaxed);
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void add(uint64_t t) noexcept {
+        auto& s = set(t);
+        // the hand starts at a tag-dependent way and clears 'referenced' bits as it
+        // passes so the second time around it always finds a slot
+        auto w = (t >> 60) % ways;
+        for (size_t i = 0; i < 2 * ways; ++i, w = (w + 1) % ways) {
+            auto v = s[w].load(std::memory_order_relaxed);
+            if ((v & ~uint64_t(1)) == t) return;
+            if ((v & 1) == 0) { s[w].store(t | 1, std::memory_order_relaxed); return; }
+            s[w].fetch_and(~uint64_t(1), std::memory_order_relaxed);
+        }
+    }
+
+    // if packet 'pkt' signed with key 'pk' is known to verify return true, otherwise return
+    // the result of 'verify()' (caching it if it succeeded)
+    template<typename V>
+    bool check(std::span<const uint8_t> pkt, std::span<const uint8_t> pk, V&& verify) {
+        auto t = tag(pkt, pk);
+        if (contains(t)) return true;
+        if (! verify()) return false;
+        add(t);
+        return true;
+    }
+
+    auto size() const noexcept { return sets_.size() * ways; }
+    auto hits() const noexcept { return hits_.load(std::memory_order_relaxed); }
+    auto misses() const noexcept { return misses_.load(std::memory_order_relaxed); }
+};
+
+} // namespace dct
+
+#endif  // DCT_SIGMGRS_VERIFY_CACHE_HPP
@@ -0,0 +1,165 @@
+#ifndef SYNCPS_ADAPTIVE_TIMING_HPP
+#define SYNCPS_ADAPTIVE_TIMING_HPP
+#pragma once
+/*
+ * Copyright (C) 2023 Pollere LLC
+ * Pollere authors at info@pollere.net
+ *
+ * This file is part of syncps (DCT pubsub via Collection Sync)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include <dct/format.hpp>
+#include <dct/sigmgrs/sigmgr_defs.hpp>
+
+namespace dct {
+
+/**
+ * @brief adapts a collection's sync timing to what it observes of its peers
+ *
+ * Sync's cState & cAdd response delays are random so, on a shared segment,
+ * one member's response suppresses the others'. The fixed default (7-23ms)
+ * is too short for a segment of hundreds of members (responses collide and
+ * every one is sent) and too long for a point-to-point link (there's no one
+ * to suppress). Each cState we send starts a round that collects:
+ *   - the time to the first cAdd answering it (an RTT sample)
+ *   - the spread of the arrival times of the cAdds answering it
+ *   - how many distinct members (cAdd sources, or signers if the transport can't
+ *     say where a packet came from) answered it
+ *   - how many of those cAdds were duplicates (carried no pub we lacked)
+ * At the end of each round (when the next cState is sent) smoothed values of
+ * these set:
+ *   - the response delay window: it grows multiplicatively while there are
+ *     duplicate answers and shrinks slowly when there aren't. It's never less
+ *     than the time for one responder's cAdd to reach the others (about half an
+ *     RTT for each other responder), so a lone peer gets a short delay.
+ *   - the collection's deferred delete window (its prefix's window on the face):
+ *     the cAdd spread plus the delay window, so the PIT entry collects every answer.
+ *   - the cState lifetime: a number of RTTs plus the delay window, so a lost
+ *     cState or cAdd is repaired quickly on a fast link.
+ * All three stay within 'Limits'.
+ */
+struct AdaptiveTiming {
+    using Clock = std::chrono::steady_clock;
+    using millis = std::chrono::milliseconds;
+    using micros = std::chrono::microseconds;
+
+    struct Limits {
+        millis minDelay{1};             // response delay window upper end bounds
+        millis maxDelay{200};
+        millis minDED{5};               // face deferred delete window bounds
+        millis maxDED{300};
+        millis minLifetime{300};        // cState lifetime bounds
+        millis maxLifetime{4000};
+    };
+    static constexpr double rttWeight = 1./8;   // EWMA weights (as TCP's srtt)
+    static constexpr double dupWeight = 1./4;
+    static constexpr double dupHigh = 0.1;      // duplicate fractions that grow &
+    static constexpr double dupLow = 0.02;      //  shrink the delay window
+    static constexpr size_t lifetimeRTTs = 8;
+    static constexpr size_t maxResponders = 64;
+
+    Limits lim_;
+    double srtt_{};                     // smoothed values (us), 0 until there's a sample
+    double spread_{};
+    double peers_{};                    // smoothed number of responders to a cState
+    double dup_{};                      // smoothed fraction of duplicate cAdds
+    double delay_;                      // current delay window upper end (us)
+
+    // the current round
+    uint32_t nonce_{};
+    bool open_{false};
+    Clock::time_point sent_{}, first_{}, last_{};
+    uint32_t ncAdd_{}, ndup_{};
+    std::vector<thumbPrint> responders_{};
+
+    uint64_t rounds_{};                 // rounds that got an answer
+
+    explicit AdaptiveTiming(Limits lim) : lim_{lim} {
+        delay_ = std::clamp<double>(23'000., us(lim_.minDelay), us(lim_.maxDelay));
+    }
+    AdaptiveTiming() : AdaptiveTiming(Limits{}) { }
+
+    static constexpr double us(millis m) noexcept { return double(micros(m).count()); }
+    static millis ms(double us) noexcept { return std::chrono::duration_cast<millis>(micros(int64_t(us))); }
+
+    // current response delay window (delays are drawn from its upper two thirds)
+    millis delayMin() const noexcept { return std::max(lim_.minDelay, ms(delay_ / 3)); }
+    millis delayMax() const noexcept { return std::max(delayMin(), ms(delay_)); }
+
+    millis dedWindow() const noexcept { return std::clamp(ms(2 * spread_ + delay_), lim_.minDED, lim_.maxDED); }
+
+    millis cStateLifetime() const noexcept {
+        if (srtt_ == 0) return lim_.maxLifetime;
+        return std::clamp(ms(lifetimeRTTs * srtt_ + delay_), lim_.minLifetime, lim_.maxLifetime);
+    }
+
+    // we sent cState 'nonce': close the current round and start a new one
+    void cStateSent(uint32_t nonce, Clock::time_point now = Clock::now()) {
+        endRound();
+        nonce_ = nonce;
+        open_ = true;
+        sent_ = now;
+        ncAdd_ = ndup_ = 0;
+        responders_.clear();
+    }
+
+    // a cAdd from 'signer' (whatever tells responders apart, e.g., the cAdd's source)
+    // answered cState 'nonce'. 'dup' if it had no pub we lacked.
+    void cAdd(uint32_t nonce, const thumbPrint& signer, bool dup, Clock::time_point now = Clock::now()) {
+        if (! open_ || nonce != nonce_) return;
+        if (ncAdd_++ == 0) first_ = now;
+        last_ = now;
+        if (dup) ++ndup_;
+        if (responders_.size() < maxResponders && std::find(responders_.begin(), responders_.end(), signer) == responders_.end())
+            responders_.push_back(signer);
+    }
+
+    void endRound() {
+        if (! std::exchange(open_, false) || ncAdd_ == 0) return;
+        ++rounds_;
+        double rtt = std::chrono::duration<double,std::micro>(first_ - sent_).count();
+        double spread = std::chrono::duration<double,std::micro>(last_ - first_).count();
+        if (srtt_ == 0) {
+            srtt_ = rtt;
+            spread_ = spread;
+            peers_ = responders_.size();
+        } else {
+            srtt_ += rttWeight * (rtt - srtt_);
+            spread_ += rttWeight * (spread - spread_);
+            peers_ += rttWeight * (double(responders_.size()) - peers_);
+        }
+        dup_ += dupWeight * (double(ndup_) / ncAdd_ - dup_);
+
+        if (dup_ > dupHigh) delay_ *= 1.5;
+        else if (dup_ < dupLow) delay_ *= 0.9;
+        delay_ = std::clamp(std::max(delay_, (peers_ - 1) * srtt_ / 2), us(lim_.minDelay), us(lim_.maxDelay));
+    }
+
+    std::string str() const {
+        return format("rounds {} rtt {:.1f}ms spread {:.1f}ms responders {:.1f} dups {:.2f} | delay {}-{}ms ded {}ms "
+                      "lifetime {}ms", rounds_, srtt_ / 1e3, spread_ / 1e3, peers_, dup_, delayMin().count(),
+                      delayMax().count(), dedWindow().count(), cStateLifetime().count());
+    }
+};
+
+} // namespace dct
+
+#endif  // SYNCPS_ADAPTIVE_TIMING_HPP
@@ -0,0 +1,131 @@
+#ifndef SYNCPS_CADD_CODEC_HPP
+#define SYNCPS_CADD_CODEC_HPP
+#pragma once
+/*
+ * Compact cAdd encoding: pub names delta-encoded against the previous pub's
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+#include <algorithm>
+#include <span>
+#include <vector>
+
+#include <dct/schema/rpacket.hpp>
+
+/*
+ * The pubs in a cAdd usually share a long name prefix (the collection's pub
+ * prefix, role, room, ...). A compact cAdd (ContentType_CAddCompact) has, in
+ * place of each pub's TLV, an entry:
+ *   k (1 byte, or 253 + 2 bytes BE if k >= 253)
+ *   the pub's Data & Name TLV headers
+ *   its name value less the first k bytes (which are the previous pub's)
+ *   the rest of the pub (MetaInfo ... SignatureValue)
+ * The first pub's k is 0. Pubs are signed in their canonical form which the
+ * receiver reconstructs (decode) before validating them. The cAdd itself is
+ * signed over its compact content.
+ */
+
+namespace dct {
+
+struct CAddCodec {
+    // size of the TLV header at 'p' (of 'n' bytes) and its value length in 'vlen', 0 if malformed
+    static size_t hdr(const uint8_t* p, size_t n, size_t& vlen) noexcept {
+        if (n < 2 || p[0] >= 253) return 0;
+        if (p[1] < 253) { vlen = p[1]; return 2; }
+        if (p[1] > 253 || n < 4) return 0;
+        vlen = size_t(p[2]) << 8 | p[3];
+        return 4;
+    }
+    static std::span<const uint8_t> nameValue(const rData& p) noexcept { rPrefix n{p.name()}; return {n.data(), n.size()}; }
+
+    static size_t shared(std::span<const uint8_t> a, std::span<const uint8_t> b) noexcept {
+        return std::mismatch(a.begin(), a.end(), b.begin(), b.end()).first - a.begin();
+    }
+    static constexpr size_t kSize(size_t k) noexcept { return k < 253? 1 : 3; }
+
+    // encoded size of 'p' following a pub named 'prev' (empty for the first pub)
+    static size_t entrySize(std::span<const uint8_t> prev, const rData& p) noexcept {
+        auto k = shared(prev, nameValue(p));
+        return p.size() - k + kSize(k);
+    }
+
+    // compact content for 'pubs'
+    template<typename Pubs>
+    static std::vector<uint8_t> encode(const Pubs& pubs) {
+        std::vector<uint8_t> o{};
+        size_t n{};
+        for (const auto& p : pubs) n += p.size() + 1;
+        o.reserve(n);
+        std::span<const uint8_t> prev{};
+        for (const rData& p : pubs) {
+            auto nv = nameValue(p);
+            auto k = shared(prev, nv);
+            if (k < 253) o.push_back(k);
+            else o.insert(o.end(), {uint8_t(253), uint8_t(k >> 8), uint8_t(k)});
+            auto off = nv.data() - p.data();    // start of the name value in the pub
+            o.insert(o.end(), p.data(), p.data() + off);
+            o.insert(o.end(), p.data() + off + k, p.data() + p.size());
+            prev = nv;
+        }
+        return o;
+    }
+
+    /**
+     * @brief reconstruct the canonical pubs of compact content 'c' into 'out'
+     *
+     * 'out' is replaced by the concatenated pub TLVs (the form of a regular
+     * cAdd's content). Returns false if 'c' is malformed.
+     */
+    static bool decode(std::span<const uint8_t> c, std::vector<uint8_t>& out) {
+        out.clear();
+        out.reserve(c.size() * 2);
+        size_t prevOff{}, prevLen{};    // previous pub's name value in 'out'
+        for (size_t i = 0; i < c.size(); ) {
+            size_t k = c[i];
+            if (k < 253) ++i;
+            else if (k == 253 && c.size() - i >= 3) { k = size_t(c[i+1]) << 8 | c[i+2]; i += 3; }
+            else return false;
+            if (k > prevLen || i >= c.size()) return false;
+
+            size_t dlen, nlen;
+            auto dh = c[i] == uint8_t(tlv::Data)? hdr(&c[i], c.size() - i, dlen) : 0;
+            if (dh == 0) return false;
+            auto nh = dh < c.size() - i && c[i + dh] == uint8_t(tlv::Name)? hdr(&c[i + dh], c.size() - i - dh, nlen) : 0;
+            if (nh == 0 || nlen < k || nh + nlen > dlen) return false;
+            auto rest = dlen - nh - k;      // bytes after the shared part of the name
+            if (c.size() - i - dh - nh < rest) return false;
+
+            auto start = out.size();
+            out.insert(out.end(), &c[i], &c[i] + dh + nh);
+            out.resize(out.size() + k);     // (may reallocate so copy by offset after)
+            std::copy_n(out.begin() + prevOff, k, out.end() - k);
+            out.insert(out.end(), &c[i] + dh + nh, &c[i] + dh + nh + rest);
+            i += dh + nh + rest;
+            prevOff = start + dh + nh;
+            prevLen = nlen;
+        }
+        return true;
+    }
+};
+
+} // namespace dct
+
+#endif  // SYNCPS_CADD_CODEC_HPP
@@ -0,0 +1,126 @@
+#ifndef SYNCPS_DIFF_ESTIMATOR_HPP
+#define SYNCPS_DIFF_ESTIMATOR_HPP
+#pragma once
+/*
+ * Copyright (C) 2022 Pollere LLC
+ * Pollere authors at info@pollere.net
+ *
+ * This file is part of syncps (DCT pubsub via Collection Sync)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace dct {
+
+/**
+ * @brief Set difference size estimator (bottom-k min-wise sketch)
+ *
+ * An iblt can only be peeled if it's sized for the difference it holds so
+ * a cState can carry this small sketch of the sender's collection to let
+ * the receiver estimate how many items differ. The sketch is the size of the
+ * set plus its K smallest hashes. Since pub hashes are uniformly distributed,
+ * the fraction of the K smallest hashes of the union of two sets that are in
+ * both estimates their Jaccard similarity J and the difference size is then
+ * (|A|+|B|)(1-J)/(1+J).
+ *
+ * A hash in our sketch that's smaller than the peer's largest sketch hash but
+ * isn't in the peer's sketch is definitely missing from the peer's set so the
+ * sketch also identifies a few items the peer needs even when the iblt can't
+ * be peeled.
+ */
+template<typename HashVal, size_t K = 16>
+struct DiffEstimator {
+    uint32_t n_{};                  // number of items in the set
+    std::array<HashVal,K> min_{};   // smallest hashes of the set (ascending)
+    uint8_t k_{};                   // number of valid entries in min_
+
+    constexpr auto begin() const noexcept { return min_.begin(); }
+    constexpr auto end() const noexcept { return min_.begin() + k_; }
+    constexpr auto size() const noexcept { return n_; }
+    constexpr bool full() const noexcept { return k_ == K; }
+
+    // add hash 'h' to the sketch (each item of the set should be added exactly once)
+    constexpr void add(HashVal h) noexcept {
+        ++n_;
+        if (full() && h >= min_[K-1]) return;
+        auto p = std::upper_bound(min_.begin(), min_.begin() + k_, h);
+        std::copy_backward(p, min_.begin() + k_ - (full()? 1 : 0), min_.begin() + k_ + (full()? 0 : 1));
+        *p = h;
+        if (! full()) ++k_;
+    }
+
+    // true if the set this sketch describes definitely doesn't contain 'h'
+    constexpr bool lacks(HashVal h) const noexcept {
+        if (full() && h > min_[K-1]) return false;
+        return ! std::binary_search(begin(), end(), h);
+    }
+
+    /**
+     * @brief encode as size followed by the hashes, all little-endian
+     */
+    auto encode() const {
+        std::vector<uint8_t> v{};
+        v.reserve(sizeof(n_) + k_ * sizeof(HashVal));
+        for (size_t i = 0; i < sizeof(n_); ++i) v.emplace_back(n_ >> (i * 8));
+        for (auto h : *this) for (size_t i = 0; i < sizeof(HashVal); ++i) v.emplace_back(h >> (i * 8));
+        return v;
+    }
+
+    /**
+     * @brief decode a sketch encoded by 'encode()'
+     *
+     * @throws runtime_error if the encoding is malformed
+     */
+    static auto decode(std::span<const uint8_t> v) {
+        DiffEstimator est{};
+        if (v.size() < sizeof(n_) || (v.size() - sizeof(n_)) % sizeof(HashVal) != 0 ||
+            (v.size() - sizeof(n_)) / sizeof(HashVal) > K) throw std::runtime_error("invalid diff estimator");
+        for (size_t i = 0; i < sizeof(n_); ++i) est.n_ |= uint32_t(v[i]) << (i * 8);
+        for (auto p = v.begin() + sizeof(n_); p < v.end(); p += sizeof(HashVal)) {
+            HashVal h{};
+            for (size_t i = 0; i < sizeof(HashVal); ++i) h |= HashVal(p[i]) << (i * 8);
+            if (est.k_ > 0 && h <= est.min_[est.k_ - 1]) throw std::runtime_error("invalid diff estimator");
+            est.min_[est.k_++] = h;
+        }
+        if (est.k_ > est.n_ || (est.k_ < K && est.k_ != est.n_)) throw std::runtime_error("invalid diff estimator");
+        return est;
+    }
+
+    /**
+     * @brief estimate the size of the symmetric difference of this set and 'other's
+     */
+    constexpr size_t estimate(const DiffEstimator& other) const noexcept {
+        // walk the K smallest hashes of the union counting those in both sets
+        size_t u{}, both{};
+        for (auto a = begin(), b = other.begin(); u < K && (a != end() || b != other.end()); ++u) {
+            if (b == other.end() || (a != end() && *a < *b)) ++a;
+            else if (a == end() || *b < *a) ++b;
+            else { ++both; ++a; ++b; }
+        }
+        if (u == 0) return 0;
+        // (n_ + other.n_) * (1 - J) / (1 + J) where J = both / u
+        return ((size_t(n_) + other.n_) * (u - both) + (u + both) / 2) / (u + both);
+    }
+};
+
+}  // namespace dct
+
+#endif  // SYNCPS_DIFF_ESTIMATOR_HPP
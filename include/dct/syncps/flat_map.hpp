@@ -0,0 +1,263 @@
+#ifndef SYNCPS_FLAT_MAP_HPP
+#define SYNCPS_FLAT_MAP_HPP
+#pragma once
+/*
+ * Copyright (C) 2022 Pollere LLC
+ * Pollere authors at info@pollere.net
+ *
+ * This file is part of syncps (DCT pubsub via Collection Sync)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+namespace dct {
+
+/**
+ * @brief open-addressing hash map with Swiss-table style metadata bytes
+ *
+ * Each slot has a control byte that's either 'empty', 'deleted' or holds 7 bits
+ * of the key's hash. Lookups probe groups of 8 control bytes at a time using
+ * word-at-a-time (SWAR) compares so they rarely touch a slot that doesn't hold
+ * the key. Keys and values are stored inline in one array so there's no
+ * per-item allocation and no pointer chasing.
+ *
+ * This implements the subset of the std::unordered_map API used by syncps
+ * Collections. As with std::unordered_map, inserts can invalidate iterators
+ * but, unlike it, they can also move items (pointers and references to items
+ * are only stable until the next insert).
+ */
+template<typename K, typename V, typename Hash = std::hash<K>>
+struct FlatMap {
+    static_assert(std::endian::native == std::endian::little, "FlatMap control groups assume little endian");
+
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<const K, V>;
+    using size_type = size_t;
+
+  private:
+    static constexpr size_t GW = 8;             // control group width (bytes)
+    static constexpr int8_t kEmpty = -128;      // 0b10000000
+    static constexpr int8_t kDeleted = -2;      // 0b11111110
+    static constexpr uint64_t lsbs = 0x0101010101010101ull;
+    static constexpr uint64_t msbs = 0x8080808080808080ull;
+
+    union Slot {
+        value_type v;
+        Slot() { }
+        ~Slot() { }
+    };
+
+    std::unique_ptr<int8_t[]> ctrl_{};
+    std::unique_ptr<Slot[]> slots_{};
+    size_t cap_{};          // number of slots (0 or a power of 2 >= GW)
+    size_t size_{};
+    size_t growthLeft_{};   // inserts into empty slots allowed before a rehash
+
+    static constexpr uint64_t mix(size_t h) noexcept { return uint64_t(h) * 0x9E3779B97F4A7C15ull; }
+    static constexpr int8_t h2(uint64_t m) noexcept { return int8_t(m >> 57); }  // top 7 bits
+    constexpr size_t h1(uint64_t m) const noexcept { return size_t(m) & (cap_ - 1) & ~(GW - 1); }
+
+    uint64_t group(size_t pos) const noexcept {
+        uint64_t g;
+        std::memcpy(&g, ctrl_.get() + pos, sizeof(g));
+        return g;
+    }
+    // bitmasks with the high bit of each matching byte set. 'match' may have false
+    // positives in bytes following a true match so keys are always compared.
+    static constexpr uint64_t match(uint64_t g, int8_t h) noexcept {
+        auto x = g ^ (lsbs * uint8_t(h));
+        return (x - lsbs) & ~x & msbs;
+    }
+    static constexpr uint64_t matchEmpty(uint64_t g) noexcept { return g & (~g << 6) & msbs; }
+    static constexpr uint64_t matchEmptyOrDeleted(uint64_t g) noexcept { return g & ~(g << 7) & msbs; }
+    static constexpr size_t lowestByte(uint64_t bits) noexcept { return std::countr_zero(bits) >> 3; }
+
+    static constexpr size_t maxLoad(size_t cap) noexcept { return cap - cap / 8; }
+
+    // return the index of the slot holding 'k' or cap_ if there isn't one
+    size_t findIdx(const K& k) const noexcept {
+        if (size_ == 0) return cap_;
+        auto m = mix(Hash{}(k));
+        auto h = h2(m);
+        for (size_t pos = h1(m), step = GW; ; pos = (pos + step) & (cap_ - 1), step += GW) {
+            auto g = group(pos);
+            for (auto bits = match(g, h); bits; bits &= bits - 1) {
+                auto i = pos + lowestByte(bits);
+                if (slots_[i].v.first == k) return i;
+            }
+            if (matchEmpty(g)) return cap_;
+        }
+    }
+
+    // return the index of an empty or deleted slot for a key with mixed hash 'm'
+    size_t freeIdx(uint64_t m) const noexcept {
+        for (size_t pos = h1(m), step = GW; ; pos = (pos + step) & (cap_ - 1), step += GW) {
+            if (auto bits = matchEmptyOrDeleted(group(pos)); bits) return pos + lowestByte(bits);
+        }
+    }
+
+    void rehash(size_t ncap) {
+        auto octrl = std::move(ctrl_);
+        auto oslots = std::move(slots_);
+        auto ocap = cap_;
+        ctrl_ = std::make_unique<int8_t[]>(ncap);
+        std::memset(ctrl_.get(), kEmpty, ncap);
+        slots_ = std::make_unique<Slot[]>(ncap);
+        cap_ = ncap;
+        growthLeft_ = maxLoad(ncap) - size_;
+        for (size_t i = 0; i < ocap; ++i) {
+            if (octrl[i] < 0) continue;
+            auto m = mix(Hash{}(oslots[i].v.first));
+            auto j = freeIdx(m);
+            ctrl_[j] = h2(m);
+            new (&slots_[j].v) value_type(std::move(oslots[i].v));
+            oslots[i].v.~value_type();
+        }
+    }
+
+    void destroyAll() noexcept {
+        for (size_t i = 0; i < cap_; ++i) if (ctrl_[i] >= 0) slots_[i].v.~value_type();
+    }
+
+  public:
+    template<bool Const>
+    struct Iter {
+        using Map = std::conditional_t<Const, const FlatMap, FlatMap>;
+        using value_type = FlatMap::value_type;
+        using reference = std::conditional_t<Const, const value_type&, value_type&>;
+        using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        Map* m_{};
+        size_t i_{};
+
+        Iter() = default;
+        Iter(Map* m, size_t i) : m_{m}, i_{i} { skip(); }
+        operator Iter<true>() const noexcept { return {m_, i_}; }
+
+        void skip() noexcept { while (i_ < m_->cap_ && m_->ctrl_[i_] < 0) ++i_; }
+        reference operator*() const noexcept { return m_->slots_[i_].v; }
+        pointer operator->() const noexcept { return &m_->slots_[i_].v; }
+        Iter& operator++() noexcept { ++i_; skip(); return *this; }
+        Iter operator++(int) noexcept { auto t = *this; ++*this; return t; }
+        bool operator==(const Iter& o) const noexcept { return i_ == o.i_; }
+    };
+    using iterator = Iter<false>;
+    using const_iterator = Iter<true>;
+
+    FlatMap() = default;
+    FlatMap(const FlatMap&) = delete;
+    FlatMap& operator=(const FlatMap&) = delete;
+    FlatMap(FlatMap&& o) noexcept { swap(o); }
+    FlatMap& operator=(FlatMap&& o) noexcept { if (this != &o) { clear(); swap(o); } return *this; }
+    ~FlatMap() { destroyAll(); }
+
+    void swap(FlatMap& o) noexcept {
+        std::swap(ctrl_, o.ctrl_);
+        std::swap(slots_, o.slots_);
+        std::swap(cap_, o.cap_);
+        std::swap(size_, o.size_);
+        std::swap(growthLeft_, o.growthLeft_);
+    }
+
+    constexpr auto size() const noexcept { return size_; }
+    constexpr bool empty() const noexcept { return size_ == 0; }
+    constexpr auto capacity() const noexcept { return cap_; }
+    // heap bytes of the table (not including anything the items own)
+    constexpr size_t heapBytes() const noexcept { return cap_ * (sizeof(Slot) + 1); }
+
+    iterator begin() noexcept { return {this, 0}; }
+    iterator end() noexcept { return {this, cap_}; }
+    const_iterator begin() const noexcept { return {this, 0}; }
+    const_iterator end() const noexcept { return {this, cap_}; }
+
+    iterator find(const K& k) noexcept { return {this, findIdx(k)}; }
+    const_iterator find(const K& k) const noexcept { return {this, findIdx(k)}; }
+    bool contains(const K& k) const noexcept { return findIdx(k) != cap_; }
+
+    V& at(const K& k) {
+        auto i = findIdx(k);
+        if (i == cap_) throw std::out_of_range("FlatMap::at: key not found");
+        return slots_[i].v.second;
+    }
+    const V& at(const K& k) const { return const_cast<FlatMap*>(this)->at(k); }
+
+    void reserve(size_t n) {
+        size_t ncap = GW * 2;
+        while (maxLoad(ncap) < n) ncap <<= 1;
+        if (ncap > cap_) rehash(ncap);
+    }
+
+    template<typename... Args>
+    std::pair<iterator,bool> try_emplace(const K& k, Args&&... args) {
+        if (auto i = findIdx(k); i != cap_) return {iterator{this, i}, false};
+        if (growthLeft_ == 0) {
+            // grow unless the table is mostly tombstones, in which case just clean it up
+            rehash(cap_ == 0? GW * 2 : size_ * 2 >= maxLoad(cap_)? cap_ * 2 : cap_);
+        }
+        auto m = mix(Hash{}(k));
+        auto i = freeIdx(m);
+        if (ctrl_[i] == kEmpty) --growthLeft_;
+        new (&slots_[i].v) value_type(std::piecewise_construct, std::forward_as_tuple(k),
+                                      std::forward_as_tuple(std::forward<Args>(args)...));
+        ctrl_[i] = h2(m);
+        ++size_;
+        return {iterator{this, i}, true};
+    }
+
+    iterator erase(const_iterator it) noexcept {
+        auto i = it.i_;
+        slots_[i].v.~value_type();
+        --size_;
+        // A slot can go back to 'empty' if its group has an empty slot (a probe for
+        // any key would have stopped in this group). Otherwise it's a tombstone.
+        if (matchEmpty(group(i & ~(GW - 1)))) {
+            ctrl_[i] = kEmpty;
+            ++growthLeft_;
+        } else {
+            ctrl_[i] = kDeleted;
+        }
+        return {this, i + 1};
+    }
+    iterator erase(iterator it) noexcept { return erase(const_iterator(it)); }
+    size_type erase(const K& k) noexcept {
+        auto i = findIdx(k);
+        if (i == cap_) return 0;
+        erase(const_iterator{this, i});
+        return 1;
+    }
+
+    void clear() noexcept {
+        destroyAll();
+        if (cap_) std::memset(ctrl_.get(), kEmpty, cap_);
+        size_ = 0;
+        growthLeft_ = maxLoad(cap_);
+    }
+};
+
+}  // namespace dct
+
+#endif  // SYNCPS_FLAT_MAP_HPP
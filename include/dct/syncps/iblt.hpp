@@ -52,15 +52,19 @@
  * SOFTWARE.
 */
 
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <inttypes.h>
 #include <iomanip>
 #include <iostream>
 #include <set>
+#include <span>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <tuple>
+#include <type_traits>
 #include <vector>
 
 #include "murmurHash3.hpp"
@@ -72,6 +76,8 @@ namespace dct {
  */
 template<typename HashVal>
 struct IBLT {
+    static_assert(std::is_same_v<HashVal,uint32_t> || std::is_same_v<HashVal,uint64_t>, "IBLT hashes are 32 or 64 bits");
+
     /*
      * Optimal number of hashes is 3 or 4. 3 results in less computation and
      * fewer cache misses so this code uses 3 hashes. The following
@@ -80,63 +86,168 @@ struct IBLT {
      */
     static constexpr size_t N_HASH{3};
     static constexpr size_t N_HASHCHECK{0x53a1df9a}; // random bit string with half the bits set
-    static constexpr size_t stsize = 19; // sub-table size (should be prime)
-    static constexpr size_t nEntries = stsize * N_HASH; // must be <128
-    static constexpr uint8_t MAXCNT = 0x80; // max run length & run start marker, must be > nEntries
+    /*
+     * The table size is a runtime parameter chosen from the following list of
+     * sub-table sizes (each should be prime). A table peels reliably when the
+     * difference it holds is less than ~2/3 of its entries so the smallest size
+     * handles ~40 differences and the largest ~75. The largest table must have
+     * fewer than MAXCNT entries (entry counts are RLE encoded in a byte) and
+     * its encoding (9 bytes per entry, 17 for 64-bit hashes) has to fit in a
+     * cState packet so 64-bit tables are smaller.
+     */
+    static constexpr std::array<size_t,3> stsizes = sizeof(HashVal) == 4? std::array<size_t,3>{19, 29, 37} :
+                                                                           std::array<size_t,3>{13, 19, 23};
+    static constexpr size_t stsize = stsizes.front(); // default sub-table size
+    static constexpr size_t maxEntries = stsizes.back() * N_HASH; // must be <128
+    static constexpr uint8_t MAXCNT = 0x80; // max run length & run start marker, must be > maxEntries
+    static_assert(maxEntries < MAXCNT);
     static constexpr murmurHash3 mh3{};
 
+    static constexpr bool validSize(size_t st) noexcept {
+        return std::find(stsizes.begin(), stsizes.end(), st) != stsizes.end();
+    }
+    // next larger (or smaller) supported sub-table size (returns 'st' if there isn't one)
+    static constexpr size_t largerSize(size_t st) noexcept {
+        for (auto s : stsizes) if (s > st) return s;
+        return st;
+    }
+    static constexpr size_t smallerSize(size_t st) noexcept {
+        size_t r = st;
+        for (auto s : stsizes) if (s < st) r = s;
+        return r;
+    }
+    // smallest supported sub-table size that comfortably holds 'ndiff' differences
+    static constexpr size_t sizeFor(size_t ndiff) noexcept {
+        for (auto s : stsizes) if (ndiff <= s) return s;
+        return stsizes.back();
+    }
+
+    // 64-bit hashes are two 32-bit murmur hashes with different seeds
     template<typename V>
-    static inline HashVal hashobj(const V& v) noexcept { return mh3(N_HASHCHECK, v.data(), v.size()); }
+    static inline HashVal hashobj(const V& v) noexcept {
+        if constexpr (sizeof(HashVal) == 4) return mh3(N_HASHCHECK, v.data(), v.size());
+        else return HashVal(mh3(N_HASHCHECK, v.data(), v.size())) << 32 | mh3(uint32_t(~N_HASHCHECK), v.data(), v.size());
+    }
+
+    // h[i] = hashobj(v[i]), murmurHash3::lanes hashes at a time (see murmurHash3::hashN)
+    template<typename V>
+    static void hashobjs(std::span<const V> v, HashVal* h) noexcept {
+        constexpr int lanes = murmurHash3::lanes;
+        constexpr int per = sizeof(HashVal) == 4? lanes : lanes / 2; // (a 64-bit hash takes two lanes)
+        uint32_t seed[lanes], r[lanes];
+        const uint8_t* d[lanes];
+        int len[lanes];
+        for (size_t b = 0; b < v.size(); b += per) {
+            const int n = std::min<size_t>(per, v.size() - b);
+            for (int i = 0; i < n; ++i) {
+                const auto& o = v[b + i];
+                if constexpr (sizeof(HashVal) == 4) {
+                    seed[i] = N_HASHCHECK;
+                    d[i] = o.data();
+                    len[i] = o.size();
+                } else {
+                    seed[2*i] = N_HASHCHECK;
+                    seed[2*i+1] = uint32_t(~N_HASHCHECK);
+                    d[2*i] = d[2*i+1] = o.data();
+                    len[2*i] = len[2*i+1] = o.size();
+                }
+            }
+            if constexpr (sizeof(HashVal) == 4) {
+                murmurHash3::hashN(seed, d, len, r, n);
+                for (int i = 0; i < n; ++i) h[b + i] = r[i];
+            } else {
+                murmurHash3::hashN(seed, d, len, r, 2 * n);
+                for (int i = 0; i < n; ++i) h[b + i] = HashVal(r[2*i]) << 32 | r[2*i+1];
+            }
+        }
+    }
+
+    static constexpr HashVal checkHash(HashVal key) noexcept {
+        if constexpr (sizeof(HashVal) == 4) return mh3(uint64_t(key) | (N_HASHCHECK << 32));
+        else return murmurHash3::moremur(key ^ (N_HASHCHECK << 32 | N_HASHCHECK));
+    }
 
     struct HashTableEntry {
         int32_t count;
         HashVal keySum;
         HashVal keyCheck;
 
-        bool isPure() const {
-            return (count == 1 || count == -1) && mh3(uint64_t(keySum) | (N_HASHCHECK << 32)) == keyCheck;
-        }
+        bool isPure() const { return (count == 1 || count == -1) && checkHash(keySum) == keyCheck; }
         bool isEmpty() const { return count == 0 && keySum == 0 && keyCheck == 0; }
     };
 
-    using HashTable = std::array<HashTableEntry,nEntries>;
-    HashTable hashTable_{};
+    /*
+     * The table is stored as a structure of arrays (one per entry field) sized
+     * for the largest table so whole-table operations are simple loops the
+     * compiler vectorizes (SSE2/AVX/NEON) and no IBLT operation allocates.
+     */
+    size_t stsize_;                                 // sub-table size
+    uint64_t fastM_;                                // fastmod multiplier for stsize_
+    std::array<int32_t,maxEntries> count_{};
+    std::array<HashVal,maxEntries> keySum_{};
+    std::array<HashVal,maxEntries> keyCheck_{};
+
+    explicit IBLT(size_t st = stsize) { reset(st); }
+
+    constexpr auto subtableSize() const noexcept { return stsize_; }
+    constexpr size_t nEntries() const noexcept { return stsize_ * N_HASH; }
+
+    HashTableEntry entry(size_t idx) const {
+        if (idx >= nEntries()) throw std::out_of_range("IBLT entry index out of range");
+        return {count_[idx], keySum_[idx], keyCheck_[idx]};
+    }
+    bool isPure(size_t idx) const noexcept {
+        return (count_[idx] == 1 || count_[idx] == -1) && checkHash(keySum_[idx]) == keyCheck_[idx];
+    }
+    bool isEmpty(size_t idx) const noexcept { return count_[idx] == 0 && keySum_[idx] == 0 && keyCheck_[idx] == 0; }
 
     static constexpr int INSERT = 1;
     static constexpr int ERASE = -1;
 
     /**
-     * @brief run-length encode this iblt into a byte vector.
+     * @brief run-length encode this iblt into 'rle' returning the number of bytes used.
      *
      * 'count' is encoded as a byte (assumes iblt max length < 128) then
      * keySum and keyCheck in little-endian order. Runs of zero entries are encoded as a 'count'
-     * with the high bit set and the run length in the LSBs.
+     * with the high bit set and the run length in the LSBs. 'rle' must be at least
+     * maxRLESize bytes.
      */
-    auto rlEncode() const noexcept {
-        std::vector<uint8_t> rle{};
+    static constexpr size_t rleEntrySize = 1 + 2 * sizeof(HashVal);
+    static constexpr size_t maxRLESize = maxEntries * rleEntrySize;
+
+    static constexpr void putHash(std::span<uint8_t> rle, size_t& o, HashVal h) noexcept {
+        for (size_t b = 0; b < sizeof(HashVal); ++b) rle[o++] = h >> (b * 8);
+    }
+    static constexpr HashVal getHash(const uint8_t* p) noexcept {
+        HashVal h{};
+        for (size_t b = 0; b < sizeof(HashVal); ++b) h |= HashVal(p[b]) << (b * 8);
+        return h;
+    }
+
+    size_t rlEncode(std::span<uint8_t> rle) const noexcept {
+        size_t o{};
         uint8_t cnt{};
-        for (const auto& e : hashTable_) {
-            if (e.isEmpty()) {
-                if (++cnt >= MAXCNT) { rle.emplace_back(cnt | MAXCNT); cnt = 0; }
+        for (size_t i = 0; i < nEntries(); ++i) {
+            if (isEmpty(i)) {
+                if (++cnt >= MAXCNT) { rle[o++] = cnt | MAXCNT; cnt = 0; }
                 continue;
             }
-            if (cnt != 0) { rle.emplace_back(cnt | MAXCNT); cnt = 0; }
-
-            rle.emplace_back(e.count);
+            if (cnt != 0) { rle[o++] = cnt | MAXCNT; cnt = 0; }
 
-            rle.emplace_back(e.keySum);
-            rle.emplace_back(e.keySum >> 8);
-            rle.emplace_back(e.keySum >> 16);
-            rle.emplace_back(e.keySum >> 24);
-
-            rle.emplace_back(e.keyCheck);
-            rle.emplace_back(e.keyCheck >> 8);
-            rle.emplace_back(e.keyCheck >> 16);
-            rle.emplace_back(e.keyCheck >> 24);
+            rle[o++] = count_[i];
+            putHash(rle, o, keySum_[i]);
+            putHash(rle, o, keyCheck_[i]);
         }
         // trailing empty entry count is omitted except for
         // empty iblt (to avoid empty name component).
-        if (rle.empty() && cnt != 0) rle.emplace_back(cnt | MAXCNT);
+        if (o == 0 && cnt != 0) rle[o++] = cnt | MAXCNT;
+        return o;
+    }
+
+    // run-length encode into a byte vector
+    auto rlEncode() const noexcept {
+        std::vector<uint8_t> rle(maxRLESize);
+        rle.resize(rlEncode(rle));
         return rle;
     }
 
@@ -153,16 +264,17 @@ struct IBLT {
             if (b >= MAXCNT) {
                 if (b > MAXCNT) b &= MAXCNT-1;
                 i += b; // advance over zero entries
-                if (i > nEntries) throw std::runtime_error("compressed IBLT too large");;
+                if (i > nEntries()) throw std::runtime_error("compressed IBLT too large");
                 ++r;
                 continue;
             }
             // extract entry
-            hashTable_[i].count = b;
-            hashTable_[i].keySum   = r[1] | (r[2] << 8) | (r[3] << 16) | (r[4] << 24);
-            hashTable_[i].keyCheck = r[5] | (r[6] << 8) | (r[7] << 16) | (r[8] << 24);
-            if (++i > nEntries) throw std::runtime_error("compressed IBLT too large");;
-            r += 9;
+            if (i >= nEntries() || size_t(rle.end() - r) < rleEntrySize) throw std::runtime_error("compressed IBLT too large");
+            count_[i] = b;
+            keySum_[i]   = getHash(&r[1]);
+            keyCheck_[i] = getHash(&r[1 + sizeof(HashVal)]);
+            ++i;
+            r += rleEntrySize;
         }
     }
 
@@ -174,18 +286,22 @@ struct IBLT {
      * parts of it are used for per-table indices. Each entry is added/deleted
      * from all subtables.
      *
-     * XXX hash index should be computed via Lemire's multiplicative method. See:
+     * The sub-table index is computed via Lemire's multiplicative method which
+     * gives exactly 'h % stsize_' without a division. See:
      *  https://github.com/lemire/fastmod/blob/master/include/fastmod.h
      *  https://arxiv.org/abs/1902.01961
-     *  https://github.com/lemire/fastmod
-     *  https://lemire.me/blog/2019/02/08/faster-remainders-when-the-divisor-is-a-constant-beating-compilers-and-libdivide/
      */
+    static constexpr uint64_t fastmodM(uint32_t d) noexcept { return ~uint64_t(0) / d + 1; }
+    constexpr uint32_t fastmod(uint32_t a) const noexcept {
+        return uint32_t((__uint128_t(fastM_ * a) * stsize_) >> 64);
+    }
+
     auto hash(size_t key) const noexcept
     {
-        auto h = mh3(key);
-        auto h0 = (h % stsize) * N_HASH;
-        auto h1 = ((h >> 8) % stsize) * N_HASH + 1;
-        auto h2 = ((h >> 16) % stsize) * N_HASH + 2;
+        uint32_t h = mh3(key);
+        size_t h0 = fastmod(h) * N_HASH;
+        size_t h1 = fastmod(h >> 8) * N_HASH + 1;
+        size_t h2 = fastmod(h >> 16) * N_HASH + 2;
         return std::tuple{h0, h1, h2};
     }
 
@@ -198,8 +314,7 @@ struct IBLT {
      *  - one or more of the key's 3 hash entries is 'pure' but doesn't contain 'key'
      */
     bool chkPeer(size_t key, size_t idx) const noexcept {
-        auto hte = getHashTable().at(idx);
-        return hte.isEmpty() || (hte.isPure() && hte.keySum != key);
+        return isEmpty(idx) || (isPure(idx) && keySum_[idx] != key);
     }
 
     bool badPeers(size_t key) const noexcept {
@@ -217,6 +332,43 @@ struct IBLT {
         update(ERASE, key);
     }
 
+    /**
+     * @brief fixed capacity, allocation-free buffer for peel results
+     *
+     * A peel can't produce more entries than the largest iblt has cells so results
+     * always fit (a peel that would overflow is from a corrupt iblt and fails).
+     * The buffer is deliberately not zero-initialized.
+     */
+    struct HashBuf {
+        std::array<HashVal,maxEntries> h_;
+        size_t n_{};
+
+        constexpr auto begin() const noexcept { return h_.begin(); }
+        constexpr auto end() const noexcept { return h_.begin() + n_; }
+        constexpr auto size() const noexcept { return n_; }
+        constexpr auto empty() const noexcept { return n_ == 0; }
+        constexpr auto full() const noexcept { return n_ >= h_.size(); }
+        constexpr void clear() noexcept { n_ = 0; }
+        constexpr bool push_back(HashVal h) noexcept {
+            if (full()) return false;
+            h_[n_++] = h;
+            return true;
+        }
+        constexpr bool contains(HashVal h) const noexcept { return std::find(begin(), end(), h) != end(); }
+        // remove 'h' (keeping the order of the others). Returns false if it wasn't present.
+        constexpr bool erase(HashVal h) noexcept {
+            auto e = std::remove(h_.begin(), h_.begin() + n_, h);
+            if (e == h_.begin() + n_) return false;
+            n_ = e - h_.begin();
+            return true;
+        }
+        // sort then remove duplicates
+        constexpr void sortUnique() noexcept {
+            std::sort(h_.begin(), h_.begin() + n_);
+            n_ = std::unique(h_.begin(), h_.begin() + n_) - h_.begin();
+        }
+    };
+
     /**
      * @brief "peel" entries from an iblt
      *
@@ -228,73 +380,154 @@ struct IBLT {
     auto peel() const noexcept {
         std::set<HashVal> have{};
         std::set<HashVal> need{};
-        bool peeledSomething;
+        peel(have, need);
+        return std::pair{have, need};
+    }
+
+    /**
+     * @brief peel into caller's 'have' & 'need' sets
+     *
+     * Returns true if the iblt was completely peeled (the difference was small
+     * enough to be decoded). A false return means the iblt is too small for the
+     * difference (or is corrupt) and 'have' & 'need' contain only part of it.
+     */
+    bool peel(std::set<HashVal>& have, std::set<HashVal>& need) const noexcept {
         IBLT peeled{*this};
+        return peeled.peelInPlace([&have,&need](HashVal k, bool h) { (h? have : need).insert(k); return true; });
+    }
+
+    /**
+     * @brief allocation-free peel into caller's flat buffers
+     *
+     * Like the above but the peel is done in 'scratch' (whose table storage gets
+     * reused across calls) and the results, sorted and without duplicates, are
+     * appended to 'have' and 'need'.
+     */
+    bool peel(HashBuf& have, HashBuf& need, IBLT& scratch) const noexcept {
+        scratch.assign(*this);
+        return scratch.peelInPlace(have, need);
+    }
+
+    // destructively peel this iblt into flat buffers
+    bool peelInPlace(HashBuf& have, HashBuf& need) noexcept {
+        auto res = peelInPlace([&have,&need](HashVal k, bool h) { return (h? have : need).push_back(k); });
+        have.sortUnique();
+        need.sortUnique();
+        return res;
+    }
 
+    /*
+     * Peel this iblt, calling 'out(key, isHave)' on each key peeled. 'out'
+     * returns false if it can't take a key which terminates the peel.
+     */
+    template<typename Out>
+    bool peelInPlace(Out&& out) noexcept {
+        bool peeledSomething;
         do {
             peeledSomething = false;
-            for (const auto& entry : peeled.hashTable_) {
-                if (! entry.isPure()) continue;
-
-                if (peeled.badPeers(entry.keySum)) {
-                    //std::cerr << "error - invalid iblt: badPeers for entry:" << entry << "\n";
-                    std::cerr << "error - invalid iblt: badPeers for entry:" << entry.keySum << "\n";
-                    peeledSomething = false;
-                    break;
+            for (size_t i = 0; i < nEntries(); ++i) {
+                if (! isPure(i)) continue;
+
+                const auto key = keySum_[i];
+                if (badPeers(key)) {
+                    std::cerr << "error - invalid iblt: badPeers for entry:" << key << "\n";
+                    return false;
                 }
-                if (entry.count > 0) have.insert(entry.keySum); else need.insert(entry.keySum);
-                peeled.update(-entry.count, entry.keySum);
+                if (! out(key, count_[i] > 0)) return false;
+                update(-count_[i], key);
                 peeledSomething = true;
             }
         } while (peeledSomething);
-        return std::pair{have, need};
+        for (size_t i = 0; i < nEntries(); ++i) if (! isEmpty(i)) return false;
+        return true;
     }
 
-    IBLT operator-(const IBLT& other) const {
-        IBLT result(*this);
-        for (size_t i = 0; i < nEntries; i++) {
-            HashTableEntry& e1 = result.hashTable_.at(i);
-            const HashTableEntry& e2 = other.hashTable_.at(i);
-            e1.count -= e2.count;
-            e1.keySum ^= e2.keySum;
-            e1.keyCheck ^= e2.keyCheck;
-        }
-        return result;
+    /*
+     * In-place table operations. These reuse the table's storage so they
+     * don't allocate once it has grown to the largest size used.
+     */
+    IBLT& assign(const IBLT& other) noexcept {
+        stsize_ = other.stsize_;
+        fastM_ = other.fastM_;
+        const auto n = nEntries();
+        std::copy_n(other.count_.begin(), n, count_.begin());
+        std::copy_n(other.keySum_.begin(), n, keySum_.begin());
+        std::copy_n(other.keyCheck_.begin(), n, keyCheck_.begin());
+        return *this;
+    }
+
+    // reset to an empty table with sub-table size 'st'
+    IBLT& reset(size_t st) {
+        if (! validSize(st)) throw std::runtime_error("invalid IBLT size");
+        stsize_ = st;
+        fastM_ = fastmodM(st);
+        const auto n = nEntries();
+        std::fill_n(count_.begin(), n, 0);
+        std::fill_n(keySum_.begin(), n, 0);
+        std::fill_n(keyCheck_.begin(), n, 0);
+        return *this;
     }
 
-    const HashTable& getHashTable() const noexcept { return hashTable_; }
+    IBLT& operator-=(const IBLT& other) {
+        if (other.stsize_ != stsize_) throw std::runtime_error("IBLT size mismatch");
+        // separate loops over each field array so each vectorizes
+        const auto n = nEntries();
+        for (size_t i = 0; i < n; i++) count_[i] -= other.count_[i];
+        for (size_t i = 0; i < n; i++) keySum_[i] ^= other.keySum_[i];
+        for (size_t i = 0; i < n; i++) keyCheck_[i] ^= other.keyCheck_[i];
+        return *this;
+    }
+
+    // set this to the difference 'a - b' in a single pass over each field
+    IBLT& assignDiff(const IBLT& a, const IBLT& b) {
+        if (a.stsize_ != b.stsize_) throw std::runtime_error("IBLT size mismatch");
+        stsize_ = a.stsize_;
+        fastM_ = a.fastM_;
+        const auto n = nEntries();
+        for (size_t i = 0; i < n; i++) count_[i] = a.count_[i] - b.count_[i];
+        for (size_t i = 0; i < n; i++) keySum_[i] = a.keySum_[i] ^ b.keySum_[i];
+        for (size_t i = 0; i < n; i++) keyCheck_[i] = a.keyCheck_[i] ^ b.keyCheck_[i];
+        return *this;
+    }
+
+    // true if the two tables have the same size and contents
+    bool equal(const IBLT& other) const noexcept {
+        const auto n = nEntries();
+        return other.stsize_ == stsize_ && std::equal(count_.begin(), count_.begin() + n, other.count_.begin()) &&
+               std::equal(keySum_.begin(), keySum_.begin() + n, other.keySum_.begin()) &&
+               std::equal(keyCheck_.begin(), keyCheck_.begin() + n, other.keyCheck_.begin());
+    }
 
-    void update1(int plusOrMinus, HashVal key, size_t idx) {
-        HashTableEntry& entry = hashTable_.at(idx);
-        entry.count += plusOrMinus;
-        entry.keySum ^= key;
-        entry.keyCheck ^= mh3(uint64_t(key) | (N_HASHCHECK << 32));
+    IBLT operator-(const IBLT& other) const {
+        IBLT result{stsize_};
+        result.assignDiff(*this, other);
+        return result;
     }
+
+    // update the key's entry in each sub-table (its keyCheck is computed once for all three)
     void update(int plusOrMinus, HashVal key) {
         const auto [hash0, hash1, hash2] = hash(key);
-        update1(plusOrMinus, key, hash0);
-        update1(plusOrMinus, key, hash1);
-        update1(plusOrMinus, key, hash2);
+        const auto chk = checkHash(key);
+        for (auto idx : {hash0, hash1, hash2}) {
+            count_[idx] += plusOrMinus;
+            keySum_[idx] ^= key;
+            keyCheck_[idx] ^= chk;
+        }
     }
 };
 
 template<typename T>
-static inline bool operator==(const IBLT<T>& iblt1, const IBLT<T>& iblt2)
-{
-    return memcmp(iblt1.hashTable_.data(), iblt2.hashTable_.data(), iblt1.hashTable_.size()) == 0;
-}
+static inline bool operator==(const IBLT<T>& iblt1, const IBLT<T>& iblt2) { return iblt1.equal(iblt2); }
 
 template<typename T>
 static inline bool operator!=(const IBLT<T>& iblt1, const IBLT<T>& iblt2) { return !(iblt1 == iblt2); }
 
-#if 0
 template<typename T>
-static inline std::ostream& operator<<(std::ostream& out, const IBLT<T>::HashTableEntry& hte) {
+static inline std::ostream& operator<<(std::ostream& out, const typename IBLT<T>::HashTableEntry& hte) {
     out << std::dec << std::setw(5) << hte.count << std::hex << std::setw(9)
         << hte.keySum << std::setw(9) << hte.keyCheck;
     return out;
 }
-#endif
 
 template<typename T>
 static inline std::string prtPeer(const IBLT<T>& iblt, size_t idx, size_t rep) {
@@ -302,10 +535,10 @@ static inline std::string prtPeer(const IBLT<T>& iblt, size_t idx, size_t rep) {
 
     std::ostringstream rslt{};
     rslt << " @" << std::hex << rep;
-    auto hte = iblt.getHashTable().at(rep);
+    auto hte = iblt.entry(rep);
     if (hte.isEmpty()) {
         rslt << "!";
-    } else if (iblt.getHashTable().at(idx).keySum != hte.keySum) {
+    } else if (iblt.entry(idx).keySum != hte.keySum) {
         rslt << (hte.isPure()? "?" : "*");
     }
     return rslt.str();
@@ -313,7 +546,7 @@ static inline std::string prtPeer(const IBLT<T>& iblt, size_t idx, size_t rep) {
 
 template<typename T>
 static inline std::string prtPeers(const IBLT<T>& iblt, size_t idx) {
-    auto hte = iblt.getHashTable().at(idx);
+    auto hte = iblt.entry(idx);
     // can only get the peers of 'pure' entries
     if (! hte.isPure()) return "";
     const auto [hash0, hash1, hash2] = iblt.hash(hte.keySum);
@@ -323,10 +556,8 @@ static inline std::string prtPeers(const IBLT<T>& iblt, size_t idx) {
 template<typename T>
 static inline std::ostream& operator<<(std::ostream& out, const IBLT<T>& iblt) {
     out << "idx count keySum keyCheck\n";
-    auto idx = 0;
-    for (const auto& hte : iblt.getHashTable()) {
-        out << std::hex << std::setw(2) << idx << hte << prtPeers(iblt, idx) << "\n";
-        idx++;
+    for (size_t idx = 0; idx < iblt.nEntries(); idx++) {
+        operator<< <T>(out << std::hex << std::setw(2) << idx, iblt.entry(idx)) << prtPeers(iblt, idx) << "\n";
     }
     return out;
 }
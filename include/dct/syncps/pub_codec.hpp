@@ -0,0 +1,263 @@
+#ifndef SYNCPS_PUB_CODEC_HPP
+#define SYNCPS_PUB_CODEC_HPP
+#pragma once
+/*
+ * Optional compression of publication content with per-topic dictionaries
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <dct/schema/crpacket.hpp>
+
+/*
+ * Small, repetitive records (e.g., JSON or CBOR sensor readings) compress
+ * well against a dictionary of typical records. A pub made by DCTmodel::pub()
+ * with compression on has its content compressed (before it's signed and,
+ * possibly, encrypted) if that makes it smaller and its MetaInfo ContentType
+ * is then ContentType_Compressed. SyncPS::deliver reverses this (after any
+ * decryption) for collections with a codec so subscribers see the original
+ * content. Collections without one (e.g., relays, which must pass pubs on
+ * unchanged) deliver the compressed pub.
+ *
+ * Dictionaries are registered per pub name prefix (the longest matching
+ * prefix's is used) and identified in the content by a hash of their bytes so
+ * a subscriber without the publisher's dictionary drops the pub rather than
+ * delivering garbage. Publishers & subscribers have to register the same
+ * dictionaries; how they get them (configuration, a well-known pub, ...) is up
+ * to the app.
+ *
+ * Compressed content is:
+ *   dictionary id (4 bytes LE, 0 = none), original size (2 bytes LE), LZ data
+ * The LZ data is a sequence of LZ4-style token/literals/offset/match triples
+ * whose matches can reach back into the dictionary. Decoding checks every
+ * length and offset since the content comes from the network.
+ */
+
+namespace dct {
+
+struct PubCodec {
+    static constexpr size_t hdrSize = 6;
+    static constexpr size_t minMatch = 4;
+    static constexpr size_t maxOffset = 65535;
+    static constexpr size_t maxContent = 65535;
+    static constexpr size_t hashBits = 12;
+    static constexpr uint32_t empty = ~0u;
+    using hashTab = std::array<uint32_t, 1u << hashBits>;
+
+    struct Dict {
+        std::vector<uint8_t> pfx_;  // name prefix (TLV value bytes) it's used for
+        std::vector<uint8_t> d_;    // dictionary content
+        uint32_t id_;
+        hashTab ht_;                // hash table of the dictionary's positions
+    };
+    std::vector<Dict> dicts_{};
+    size_t minSize_{32};            // content smaller than this isn't compressed
+
+    // counters
+    size_t compressed_{}, bytesIn_{}, bytesOut_{}, expanded_{}, bad_{};
+
+    std::vector<uint8_t> buf_{};    // scratch buffers (dictionary + content, output)
+    std::vector<uint8_t> out_{};
+    hashTab ht_{};
+
+    static uint32_t read32(const uint8_t* p) noexcept { uint32_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+    static uint32_t hash(uint32_t v) noexcept { return (v * 2654435761u) >> (32 - hashBits); }
+
+    static uint32_t dictId(std::span<const uint8_t> d) noexcept {
+        uint32_t h = 2166136261u;   // FNV-1a
+        for (auto b : d) h = (h ^ b) * 16777619u;
+        return h == 0? 1 : h;
+    }
+
+    /**
+     * @brief use 'dict' to compress the content of pubs whose names start with 'prefix'
+     *
+     * Good dictionaries are a few KB of concatenated typical content. An empty
+     * prefix matches every pub.
+     */
+    PubCodec& dictionary(const rName& prefix, std::vector<uint8_t> dict) {
+        auto p = prefix.rest();
+        std::vector<uint8_t> pfx(p.begin(), p.end());
+        std::erase_if(dicts_, [&pfx](const auto& d) { return d.pfx_ == pfx; });
+        if (dict.size() > maxOffset) dict.erase(dict.begin(), dict.end() - maxOffset); // only the end is reachable
+        auto& d = dicts_.emplace_back(Dict{std::move(pfx), std::move(dict), 0, {}});
+        d.id_ = dictId(d.d_);
+        d.ht_.fill(empty);
+        for (size_t i = 0; i + minMatch <= d.d_.size(); ++i) d.ht_[hash(read32(d.d_.data() + i))] = i;
+        return *this;
+    }
+    PubCodec& minSize(size_t n) { minSize_ = n; return *this; }
+
+    const Dict* dictFor(const rName& name) const noexcept {
+        auto n = name.rest();
+        const Dict* res{};
+        for (const auto& d : dicts_) {
+            if (d.pfx_.size() > n.size() || ! std::equal(d.pfx_.begin(), d.pfx_.end(), n.begin())) continue;
+            if (! res || d.pfx_.size() > res->pfx_.size()) res = &d;
+        }
+        return res;
+    }
+    const Dict* dictById(uint32_t id) const noexcept {
+        for (const auto& d : dicts_) if (d.id_ == id) return &d;
+        return nullptr;
+    }
+
+    static void putLen(std::vector<uint8_t>& o, size_t l) {
+        for (; l >= 255; l -= 255) o.push_back(255);
+        o.push_back(l);
+    }
+    static void putSeq(std::vector<uint8_t>& o, std::span<const uint8_t> lit, size_t off, size_t mlen) {
+        auto ml = mlen? mlen - minMatch : 0;
+        o.push_back((std::min<size_t>(lit.size(), 15) << 4) | std::min<size_t>(ml, 15));
+        if (lit.size() >= 15) putLen(o, lit.size() - 15);
+        o.insert(o.end(), lit.begin(), lit.end());
+        if (mlen == 0) return;
+        o.push_back(off);
+        o.push_back(off >> 8);
+        if (ml >= 15) putLen(o, ml - 15);
+    }
+
+    /**
+     * @brief compress the content 'c' of pub 'name'
+     *
+     * @return the compressed content (valid until the next call) or an empty span if
+     *         it doesn't make the content smaller
+     */
+    std::span<const uint8_t> compress(const rName& name, std::span<const uint8_t> c) {
+        if (c.size() < minSize_ || c.size() > maxContent) return {};
+        const auto* d = dictFor(name);
+        size_t base = d? d->d_.size() : 0;
+        buf_.resize(base + c.size());
+        if (d) std::copy(d->d_.begin(), d->d_.end(), buf_.begin());
+        std::copy(c.begin(), c.end(), buf_.begin() + base);
+        if (d) ht_ = d->ht_;
+        else ht_.fill(empty);
+
+        out_.clear();
+        auto id = d? d->id_ : 0;
+        out_.insert(out_.end(), {uint8_t(id), uint8_t(id >> 8), uint8_t(id >> 16), uint8_t(id >> 24),
+                                 uint8_t(c.size()), uint8_t(c.size() >> 8)});
+        const auto* b = buf_.data();
+        const auto n = buf_.size();
+        size_t ip = base, anchor = base;
+        while (ip + minMatch <= n) {
+            auto v = read32(b + ip);
+            auto& e = ht_[hash(v)];
+            auto ref = e;
+            e = ip;
+            if (ref == empty || ip - ref > maxOffset || read32(b + ref) != v) { ++ip; continue; }
+            auto len = minMatch;
+            while (ip + len < n && b[ref + len] == b[ip + len]) ++len;
+            putSeq(out_, {b + anchor, ip - anchor}, ip - ref, len);
+            ip += len;
+            anchor = ip;
+            if (out_.size() >= c.size()) return {};
+        }
+        putSeq(out_, {b + anchor, n - anchor}, 0, 0);
+        if (out_.size() >= c.size()) return {};
+        ++compressed_;
+        bytesIn_ += c.size();
+        bytesOut_ += out_.size();
+        return out_;
+    }
+
+    static bool getLen(std::span<const uint8_t> s, size_t& i, size_t& l) noexcept {
+        for (uint8_t b = 255; b == 255; l += b) {
+            if (i >= s.size()) return false;
+            b = s[i++];
+        }
+        return true;
+    }
+
+    /**
+     * @brief decompress compressed content 'c'
+     *
+     * @return the original content or nullopt if 'c' is malformed or was
+     *         compressed with a dictionary we don't have
+     */
+    std::optional<std::vector<uint8_t>> expand(std::span<const uint8_t> c) const {
+        if (c.size() < hdrSize) return std::nullopt;
+        auto id = uint32_t(c[0]) | c[1] << 8 | c[2] << 16 | uint32_t(c[3]) << 24;
+        size_t osize = c[4] | c[5] << 8;
+        std::span<const uint8_t> dict{};
+        if (id != 0) {
+            const auto* d = dictById(id);
+            if (! d) return std::nullopt;
+            dict = d->d_;
+        }
+        std::vector<uint8_t> o{};
+        o.reserve(osize);
+        auto s = c.subspan(hdrSize);
+        for (size_t i = 0; i < s.size(); ) {
+            auto tok = s[i++];
+            size_t lit = tok >> 4;
+            if (lit == 15 && ! getLen(s, i, lit)) return std::nullopt;
+            if (lit > s.size() - i || lit > osize - o.size()) return std::nullopt;
+            o.insert(o.end(), s.begin() + i, s.begin() + i + lit);
+            i += lit;
+            if (i == s.size()) break;   // last sequence has no match
+            if (s.size() - i < 2) return std::nullopt;
+            size_t off = s[i] | s[i+1] << 8;
+            i += 2;
+            size_t len = (tok & 15) + minMatch;
+            if ((tok & 15) == 15 && ! getLen(s, i, len)) return std::nullopt;
+            if (off == 0 || off > dict.size() + o.size() || len > osize - o.size()) return std::nullopt;
+            // the match starts 'off' bytes back in dictionary + output and can overlap its end
+            for (size_t p = dict.size() + o.size() - off, e = p + len; p < e; ++p) {
+                o.push_back(p < dict.size()? dict[p] : o[p - dict.size()]);
+            }
+        }
+        if (o.size() != osize) return std::nullopt;
+        return o;
+    }
+
+    /**
+     * @brief return a copy of compressed pub 'p' with its original content
+     *
+     * The copy keeps p's SignatureInfo & SignatureValue (which no longer match it)
+     * so it has the same signer but, like a decrypted pub, it's only for delivery.
+     */
+    std::optional<crData> expand(const rData& p) {
+        auto c = expand(p.content().rest());
+        if (! c) { ++bad_; return std::nullopt; }
+        ++expanded_;
+        crData d(p.name(), tlv::ContentType_Blob);
+        d.content(*c);
+        d.siginfo(p.sigInfo().asSpan());
+        d.signature(p.signature().rest());
+        return d;
+    }
+
+    static bool isCompressed(const rData& p) noexcept {
+        try { return p.contentType() == uint8_t(tlv::ContentType_Compressed); } catch (const std::exception&) { }
+        return false;
+    }
+};
+
+} // namespace dct
+
+#endif  // SYNCPS_PUB_CODEC_HPP
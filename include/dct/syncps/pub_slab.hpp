@@ -0,0 +1,125 @@
+#ifndef SYNCPS_PUB_SLAB_HPP
+#define SYNCPS_PUB_SLAB_HPP
+#pragma once
+/*
+ * PubSlabs: generational slab storage for a collection's network pubs
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+
+#include "shared_pub.hpp"
+
+namespace dct {
+
+/*
+ * Each pub in a collection normally has its own heap buffer and pubs arriving
+ * together are freed together a lifetime later, which over time fragments the
+ * heap of a long-running device. PubSlabs instead copies a pub into a fixed size
+ * slab shared with the other pubs that will be erased in the same 'epoch' (their
+ * arrival time plus hold time, rounded down to a multiple of 'epoch'). The pubs
+ * are views of their slab that hold a reference to it so the slab is freed, in
+ * one piece, when the last of its pubs is erased from every collection holding it
+ * (and the app has dropped any it kept). Nothing is done per pub when it's erased.
+ *
+ * A slab only takes pubs while its epoch is open: once it's past, or the slab is
+ * full, new pubs go in a new slab. A slab's size comes from the smoothed number of
+ * bytes the recent epochs got, or this one has (up to 'slabBytes'), so sparse traffic doesn't pin a
+ * mostly empty 16KB slab per pub and, when an epoch is expected to get less than
+ * half of the smallest slab, pubs get their own buffers as before. So do pubs
+ * bigger than a quarter of the slab they'd go in.
+ */
+struct PubSlabs {
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t slabBytes = 16 * 1024;
+    static constexpr size_t minSlabBytes = 2 * 1024;
+    static constexpr double weight = 1./4;
+
+    struct Slab {
+        std::unique_ptr<uint8_t[]> b_;
+        size_t size_;
+        size_t used_{};
+        explicit Slab(size_t size) : b_{std::make_unique_for_overwrite<uint8_t[]>(size)}, size_{size} { }
+    };
+    struct Epoch {
+        std::shared_ptr<Slab> s_{};
+        size_t bytes_{};    // bytes of all the epoch's pubs (in slabs or not)
+    };
+    std::chrono::milliseconds epoch_;
+    std::map<int64_t,Epoch> open_{};   // slab being filled for each erase epoch
+    double perEpoch_{};     // smoothed bytes per epoch
+    uint64_t slabs_{};      // slabs allocated
+
+    explicit PubSlabs(std::chrono::milliseconds epoch = std::chrono::milliseconds(250)) : epoch_{epoch} { }
+
+    auto epochOf(Clock::time_point t) const noexcept {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(t.time_since_epoch()).count() / epoch_.count();
+    }
+
+    // size of a new slab for an epoch that has had 'bytes' so far given the expected
+    // bytes per epoch (0 if it's too few for a slab)
+    size_t slabSize(size_t bytes) const noexcept {
+        auto b = std::max<double>(perEpoch_, bytes);
+        if (b < minSlabBytes / 2) return 0;
+        return std::clamp<size_t>(std::bit_ceil(size_t(b * 1.25)), minSlabBytes, slabBytes);
+    }
+
+    // a copy of 'd', which will be erased after 'hold', in the slab of its erase epoch
+    sharedPub store(rData d, std::chrono::milliseconds hold) {
+        auto now = Clock::now();
+        // epochs that have started won't get more pubs so drop their slabs (they're
+        // freed with their last pub) after noting how much they got
+        auto past = open_.lower_bound(epochOf(now));
+        for (auto e = open_.begin(); e != past; ++e)
+            perEpoch_ = perEpoch_ == 0? e->second.bytes_ : perEpoch_ + weight * (e->second.bytes_ - perEpoch_);
+        open_.erase(open_.begin(), past);
+        auto& e = open_[epochOf(now + hold)];
+        e.bytes_ += d.size();
+        auto& s = e.s_;
+        if (! s || s->used_ + d.size() > s->size_) {
+            auto sz = slabSize(e.bytes_);
+            if (d.size() > sz / 4) return sharedPub(d);
+            s = std::make_shared<Slab>(sz);
+            ++slabs_;
+        }
+        auto* p = s->b_.get() + s->used_;
+        std::memcpy(p, d.data(), d.size());
+        s->used_ += d.size();
+        return sharedPub(rData(p, d.size()), std::shared_ptr<const void>(s, p));
+    }
+
+    // bytes in slabs still taking pubs
+    size_t openBytes() const noexcept {
+        size_t b{};
+        for (const auto& [_, e] : open_) if (e.s_) b += e.s_->size_;
+        return b;
+    }
+};
+
+} // namespace dct
+
+#endif // SYNCPS_PUB_SLAB_HPP
@@ -0,0 +1,164 @@
+#ifndef SYNCPS_PUB_STORE_HPP
+#define SYNCPS_PUB_STORE_HPP
+#pragma once
+/*
+ * Copyright (C) 2022 Pollere LLC
+ * Pollere authors at info@pollere.net
+ *
+ * This file is part of syncps (DCT pubsub via Collection Sync)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <dct/schema/rpacket.hpp>
+
+namespace dct {
+
+/**
+ * @brief append-only on-disk snapshot of a collection's publications
+ *
+ * Lets a restarted process reload the pubs it had rather than re-pulling
+ * them all from its peers. The file is a sequence of records, each a 4 byte
+ * little-endian length followed by a wire-format pub. Pubs are appended as
+ * they're added to the collection and nothing is ever removed: expired pubs
+ * are dropped when the file is reloaded (which rewrites it with just the
+ * pubs that survived). A partially written record at the end of the file
+ * (e.g., from a crash) is ignored.
+ *
+ * The snapshot is read via mmap so loading doesn't copy the file. Appends are
+ * buffered until flush() so the pubs added in one pass (e.g., a cAdd's) cost
+ * one write. Writes don't throw: flush() and rewrite() return false on an
+ * error (with error() saying why) and the caller decides what to do.
+ */
+struct PubStore {
+    static constexpr size_t hdrSize = 4;
+
+    std::string path_;
+    int fd_{-1};
+    size_t size_{};     // current file size (including the appends not yet flushed)
+    std::vector<uint8_t> pend_{};   // appended records not yet written
+    std::string err_{};
+
+    explicit PubStore(std::string path) : path_{std::move(path)} {
+        if (! open()) throw runtime_error(err_);
+    }
+    PubStore(const PubStore&) = delete;
+    PubStore& operator=(const PubStore&) = delete;
+    ~PubStore() { if (fd_ >= 0) ::close(fd_); }
+
+    constexpr auto size() const noexcept { return size_; }
+    bool pending() const noexcept { return ! pend_.empty(); }
+    const auto& error() const noexcept { return err_; }
+
+    /**
+     * @brief call 'cb' with each well-formed pub in the snapshot, in the order they were added
+     *
+     * 'cb's rData argument is a view of the mapped file which is only valid during the call.
+     */
+    template<typename CB>
+    void load(CB&& cb) const {
+        if (size_ == 0) return;
+        auto m = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (m == MAP_FAILED) throw runtime_error("PubStore: can't map " + path_ + ": " + std::strerror(errno));
+        auto b = static_cast<const uint8_t*>(m);
+        for (size_t off = 0; off + hdrSize <= size_; ) {
+            size_t len = b[off] | b[off+1] << 8 | b[off+2] << 16 | size_t(b[off+3]) << 24;
+            off += hdrSize;
+            if (len == 0 || len > size_ - off) break;
+            try {
+                rData d(b + off, len);
+                if (d.valid()) cb(d);
+            } catch (const runtime_error&) {}
+            off += len;
+        }
+        ::munmap(m, size_);
+    }
+
+    // add a pub to the end of the snapshot (it's written by the next flush())
+    void append(const rData& d) {
+        auto len = d.size();
+        uint8_t hdr[hdrSize]{uint8_t(len), uint8_t(len >> 8), uint8_t(len >> 16), uint8_t(len >> 24)};
+        pend_.insert(pend_.end(), hdr, hdr + hdrSize);
+        pend_.insert(pend_.end(), d.data(), d.data() + len);
+        size_ += hdrSize + len;
+    }
+
+    // write the pending appends. False on an error.
+    bool flush() {
+        auto b = pend_.data();
+        auto n = pend_.size();
+        while (n > 0) {
+            auto w = ::write(fd_, b, n);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                return fail("write to " + path_ + " failed");
+            }
+            b += w;
+            n -= w;
+        }
+        pend_.clear();
+        return true;
+    }
+
+    /**
+     * @brief replace the snapshot with the pubs in 'pubs' (a range of things convertible to rData)
+     *
+     * The new snapshot is written to a temporary file then renamed so there's
+     * always a complete snapshot on disk. False on an error.
+     */
+    template<typename Range>
+    bool rewrite(const Range& pubs) {
+        auto tmp = path_ + ".tmp";
+        ::close(fd_);
+        pend_.clear();
+        fd_ = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0600);
+        if (fd_ < 0) return fail("can't create " + tmp);
+        size_ = 0;
+        for (const auto& p : pubs) append(p);
+        if (! flush()) return false;
+        if (::rename(tmp.c_str(), path_.c_str()) != 0) return fail("can't rename " + tmp);
+        ::close(fd_);
+        return open();
+    }
+
+  private:
+    bool fail(const std::string& what) {
+        err_ = "PubStore: " + what + ": " + std::strerror(errno);
+        return false;
+    }
+
+    bool open() {
+        fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND, 0600);
+        if (fd_ < 0) return fail("can't open " + path_);
+        struct stat st;
+        if (::fstat(fd_, &st) != 0) return fail("can't stat " + path_);
+        size_ = st.st_size;
+        return true;
+    }
+};
+
+} // namespace dct
+
+#endif // SYNCPS_PUB_STORE_HPP
@@ -0,0 +1,92 @@
+#ifndef SYNCPS_PUB_TRACE_HPP
+#define SYNCPS_PUB_TRACE_HPP
+#pragma once
+/*
+ * Tracing points for following a publication from publish to delivery
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <dct/format.hpp>
+#include <dct/schema/rpacket.hpp>
+
+/*
+ * A pub's timestamp (last name component) is when it was made (e.g., by
+ * DCTmodel::pub()) and syncps reports four later points in its life:
+ *   publish  - it was added to the collection by a local publish
+ *   send     - it went out in a cAdd
+ *   receive  - it arrived in a cAdd (new to this collection, before validation)
+ *   deliver  - it was handed to a subscription callback
+ * Each is reported with the pub's iblt hash, which is the same on every node,
+ * so events from different nodes can be correlated (see tools/trace_lat).
+ *
+ * Reports go to the callback set by SyncPS::traceCb(). If DCT_USDT is defined
+ * and <sys/sdt.h> is available, there's also a static probe (provider 'dct',
+ * probes pub_publish, pub_send, pub_receive & pub_deliver with the hash and
+ * the pub's name) that costs a nop when nothing is attached.
+ */
+#if defined(DCT_USDT) && __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define DCT_PUB_PROBE(ev, h, p) DTRACE_PROBE3(dct, pub_##ev, (h), (p).name().data(), (p).name().size())
+#else
+#define DCT_PUB_PROBE(ev, h, p) do { } while (0)
+#endif
+
+namespace dct {
+
+enum class TraceEv : uint8_t { publish, send, receive, deliver };
+
+static constexpr const char* traceEvName(TraceEv e) noexcept {
+    constexpr const char* nm[]{"publish", "send", "receive", "deliver"};
+    return nm[size_t(e)];
+}
+
+using TraceCb = std::function<void(TraceEv, uint64_t hash, const rData& pub)>;
+
+/*
+ * A TraceCb that appends one line per event to file 'path':
+ *   <event> <hash> <pub timestamp us> <event time us> <node> <pub name>
+ * Times are system clock microseconds so the files of nodes with synchronized
+ * clocks can be merged.
+ */
+[[maybe_unused]]
+static TraceCb traceToFile(const std::string& path, const std::string& node) {
+    std::shared_ptr<FILE> f(std::fopen(path.c_str(), "a"), [](FILE* f){ if (f) std::fclose(f); });
+    if (! f) throw std::runtime_error(format("can't open trace file {}", path));
+    return [f, node](TraceEv e, uint64_t h, const rData& p) {
+        using namespace std::chrono;
+        int64_t ts{};
+        try { ts = duration_cast<microseconds>(p.name().last().toTimestamp().time_since_epoch()).count(); }
+        catch (const std::exception&) { }
+        auto now = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+        auto l = format("{} {:08x} {} {} {} {}\n", traceEvName(e), h, ts, now, node, p.name());
+        std::fwrite(l.data(), 1, l.size(), f.get());
+    };
+}
+
+} // namespace dct
+
+#endif // SYNCPS_PUB_TRACE_HPP
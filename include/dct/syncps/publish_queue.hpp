@@ -0,0 +1,158 @@
+#ifndef SYNCPS_PUBLISH_QUEUE_HPP
+#define SYNCPS_PUBLISH_QUEUE_HPP
+#pragma once
+/*
+ * PubQueue: lock-free handoff of pubs from app threads to a collection's io thread
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include <dct/schema/crpacket.hpp>
+
+namespace dct {
+
+/*
+ * A bounded ring of 'N' (a power of 2) slots for any number of producers and one
+ * consumer. Each slot has a sequence number saying whose turn it is: producers
+ * claim a slot by advancing 'tail_' with a CAS then publish the item by bumping the
+ * slot's sequence so the consumer never waits for a producer that's claimed but not
+ * yet filled a later slot. push() fails if the ring is full and pop() if the next
+ * slot hasn't been filled.
+ */
+template<typename T, size_t N = 1024>
+struct mpscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "mpscQueue size must be a power of 2");
+
+  private:
+    struct Slot {
+        std::atomic<size_t> seq_;
+        T v_{};
+    };
+    alignas(64) std::atomic<size_t> head_{};    // next slot to pop (written only by the consumer)
+    alignas(64) std::atomic<size_t> tail_{};    // next slot to claim
+    alignas(64) std::array<Slot,N> slot_;
+
+  public:
+    mpscQueue() { for (size_t i = 0; i < N; ++i) slot_[i].seq_.store(i, std::memory_order_relaxed); }
+
+    // (any thread) add 't'. Returns false (and leaves 't' alone) if the queue is full.
+    bool push(T&& t) {
+        auto pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            auto& s = slot_[pos & (N - 1)];
+            auto d = intptr_t(s.seq_.load(std::memory_order_acquire)) - intptr_t(pos);
+            if (d == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (d < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        auto& s = slot_[pos & (N - 1)];
+        s.v_ = std::move(t);
+        s.seq_.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // (consumer) remove the oldest item into 't'. Returns false if there isn't one ready.
+    bool pop(T& t) {
+        auto pos = head_.load(std::memory_order_relaxed);
+        auto& s = slot_[pos & (N - 1)];
+        if (s.seq_.load(std::memory_order_acquire) != pos + 1) return false;
+        t = std::move(s.v_);
+        s.v_ = T{};
+        s.seq_.store(pos + N, std::memory_order_release);
+        head_.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const noexcept {
+        auto t = tail_.load(std::memory_order_acquire), h = head_.load(std::memory_order_acquire);
+        return t > h? t - h : 0;
+    }
+    bool empty() const noexcept { return size() == 0; }
+    static constexpr size_t capacity() noexcept { return N; }
+};
+
+/*
+ * Pubs built on app threads are pushed (already signed or to be signed) into the queue
+ * and the io thread drains it in batches of up to 'maxBatch' handed to 'drain'. As with
+ * ptps's inboxes, a producer only posts a wakeup to the io_context when a drain isn't
+ * already due so a burst of pubs costs one post rather than one per pub.
+ */
+struct PubQueue {
+    struct Item {
+        crData pub_{};
+        bool sign_{};       // pub still has to be signed
+    };
+    // called on the io thread with the drained pubs that are signed and those that aren't
+    // (the callback can move pubs it signs into 'signedPubs')
+    using DrainCb = std::function<void(std::vector<crData>& signedPubs, std::span<crData> unsignedPubs)>;
+    static constexpr size_t maxBatch = 256;
+
+    boost::asio::io_context& ioc_;
+    DrainCb drain_;
+    mpscQueue<Item> q_{};
+    std::atomic<bool> wake_{false};
+    std::atomic<uint64_t> full_{};  // pushes refused because the queue was full
+    std::vector<crData> signed_{}, unsigned_{};   // io thread scratch
+
+    PubQueue(boost::asio::io_context& ioc, DrainCb&& drain) : ioc_{ioc}, drain_{std::move(drain)} { }
+
+    // (any thread) queue 'pub' for publication. Returns false if the queue is full.
+    bool push(crData&& pub, bool sign) {
+        Item it{std::move(pub), sign};
+        if (! q_.push(std::move(it))) {
+            pub = std::move(it.pub_);   // give it back so the caller can retry
+            full_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (! wake_.exchange(true)) boost::asio::post(ioc_, [this]{ drain(); });
+        return true;
+    }
+
+    // (io thread) publish what's queued, yielding between batches
+    void drain() {
+        wake_.store(false);
+        signed_.clear();
+        unsigned_.clear();
+        Item it{};
+        while (signed_.size() + unsigned_.size() < maxBatch && q_.pop(it)) {
+            (it.sign_? unsigned_ : signed_).emplace_back(std::move(it.pub_));
+        }
+        if (signed_.size() + unsigned_.size()) drain_(signed_, unsigned_);
+        if (! q_.empty() && ! wake_.exchange(true)) boost::asio::post(ioc_, [this]{ drain(); });
+    }
+};
+
+} // namespace dct
+
+#endif // SYNCPS_PUBLISH_QUEUE_HPP
@@ -0,0 +1,53 @@
+#ifndef SYNCPS_SHARED_PUB_HPP
+#define SYNCPS_SHARED_PUB_HPP
+#pragma once
+/*
+ * Copyright (C) 2023 Pollere LLC
+ * Pollere authors at info@pollere.net
+ *
+ * This file is part of syncps (DCT pubsub via Collection Sync)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <memory>
+
+#include <dct/schema/crpacket.hpp>
+
+namespace dct {
+
+/*
+ * A publication whose (immutable) backing store is reference counted. It's a view of
+ * the pub so it can be used anywhere an rData can and copying it just bumps the count.
+ * It's the item type of a syncps pubs Collection so a relay that publishes the same pub
+ * on several DeftTs holds one copy of it, shared by all their collections.
+ * The owner is type-erased so the store can be a crData or a slab shared by many
+ * pubs (see pub_slab.hpp).
+ */
+struct sharedPub : rData {
+    std::shared_ptr<const void> own_{};
+
+    sharedPub() = default;
+    explicit sharedPub(std::shared_ptr<const crData> p) : rData(static_cast<const rData&>(*p)), own_{std::move(p)} { }
+    // view 'v' of storage kept alive by 'own'
+    sharedPub(rData v, std::shared_ptr<const void> own) : rData(v), own_{std::move(own)} { }
+    sharedPub(crData&& d) : sharedPub(std::make_shared<const crData>(std::move(d))) { }
+    explicit sharedPub(rData d) : sharedPub(crData{d}) { }
+
+    constexpr const rData& asView() const noexcept { return *this; }
+};
+
+} // namespace dct
+
+#endif // SYNCPS_SHARED_PUB_HPP
@@ -0,0 +1,118 @@
+#ifndef SYNCPS_SIGNER_QUOTA_HPP
+#define SYNCPS_SIGNER_QUOTA_HPP
+#pragma once
+/*
+ * Copyright (C) 2023 Pollere LLC
+ * Pollere authors at info@pollere.net
+ *
+ * This file is part of syncps (DCT pubsub via Collection Sync)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <dct/sigmgrs/sigmgr_defs.hpp>
+
+namespace dct {
+
+/**
+ * @brief per-signer shares of a collection
+ *
+ * Counts each signer's (thumbprint's) active pubs so a collection can refuse
+ * the pubs of a signer that already has 'maxActive_' of them. When a cAdd is
+ * filled the pubs a peer lacks are taken in priority class order and, within
+ * a class, the signers take turns: each turn a signer contributes its next
+ * 'weight_(signer)' pubs (newest first), so a chatty publisher can't crowd a
+ * quiet one out of the cAdd.
+ */
+struct SignerQuota {
+    using WeightCb = std::function<uint32_t(const thumbPrint&)>;
+
+    struct Params {
+        size_t maxActive_{0};   // active pubs a signer may have (0 = no limit)
+        WeightCb weight_{};     // pubs a signer gets per turn (default 1)
+    };
+
+  private:
+    Params p_;
+    std::unordered_map<thumbPrint,uint32_t> active_{};
+    // scratch for interleave
+    std::unordered_map<thumbPrint,uint32_t> group_{};
+    std::vector<std::vector<size_t>> members_{};
+    std::vector<uint32_t> weights_{};
+    std::vector<size_t> order_{};
+
+  public:
+    SignerQuota(const Params& p) : p_{p} { }
+
+    // can a pub signed by 'tp' be added to the collection?
+    bool admit(const thumbPrint& tp) const {
+        if (p_.maxActive_ == 0) return true;
+        auto it = active_.find(tp);
+        return it == active_.end() || it->second < p_.maxActive_;
+    }
+    void add(const thumbPrint& tp) { ++active_[tp]; }
+    void remove(const thumbPrint& tp) {
+        if (auto it = active_.find(tp); it != active_.end() && --it->second == 0) active_.erase(it);
+    }
+    auto signers() const noexcept { return active_.size(); }
+
+    uint32_t weight(const thumbPrint& tp) const { return p_.weight_? std::max<uint32_t>(p_.weight_(tp), 1) : 1; }
+
+    /*
+     * Reorder 'c', which is in priority order, so that within each run of items of
+     * the same class ('cls(item)') the signers ('signer(item)') take turns as above.
+     * The order of each signer's items is kept.
+     */
+    template<typename T, typename Cls, typename Signer>
+    void interleave(std::vector<T>& c, Cls&& cls, Signer&& signer) {
+        std::vector<T> res{};
+        res.reserve(c.size());
+        for (size_t b = 0; b < c.size(); ) {
+            auto e = b;
+            while (e < c.size() && cls(c[e]) == cls(c[b])) ++e;
+            group_.clear();
+            members_.clear();
+            weights_.clear();
+            for (auto i = b; i < e; ++i) {
+                const auto& tp = signer(c[i]);
+                auto [g, added] = group_.try_emplace(tp, members_.size());
+                if (added) {
+                    members_.emplace_back();
+                    weights_.emplace_back(weight(tp));
+                }
+                members_[g->second].emplace_back(i);
+            }
+            order_.assign(members_.size(), 0);  // next item of each signer
+            for (auto left = e - b; left > 0; ) {
+                for (size_t g = 0; g < members_.size(); ++g) {
+                    for (uint32_t n = 0; n < weights_[g] && order_[g] < members_[g].size(); ++n, --left) {
+                        res.emplace_back(std::move(c[members_[g][order_[g]++]]));
+                    }
+                }
+            }
+            b = e;
+        }
+        c = std::move(res);
+    }
+};
+
+} // namespace dct
+
+#endif // SYNCPS_SIGNER_QUOTA_HPP
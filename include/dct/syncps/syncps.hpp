@@ -23,18 +23,38 @@
 
 #include <algorithm>
 #include <cstring>
+#include <deque>
 #include <functional>
 #include <limits>
 #include <map>
+#include <optional>
 #include <random>
 #include <ranges>
+#include <set>
+#include <span>
+#include <tuple>
 #include <type_traits>
-#include <unordered_map>
 
 #include <dct/face/direct.hpp>
+#include <dct/face/timing_wheel.hpp>
 #include <dct/format.hpp>
+#include <dct/coarse_clock.hpp>
 #include <dct/schema/dct_cert.hpp>
+#include "adaptive_timing.hpp"
+#include "cadd_codec.hpp"
+#include "diff_estimator.hpp"
+#include "flat_map.hpp"
 #include "iblt.hpp"
+#include "pub_codec.hpp"
+#include "pub_slab.hpp"
+#include "publish_queue.hpp"
+#include "pub_store.hpp"
+#include "pub_trace.hpp"
+#include "shared_pub.hpp"
+#include "signer_quota.hpp"
+#include "topic_filter.hpp"
+#include "validate_limiter.hpp"
+#include "worker_pool.hpp"
 
 namespace dct {
 
@@ -50,6 +70,8 @@ using namespace std::literals::chrono_literals;
 //default values
 static constexpr int maxPubSize = 1024; // max payload in Data (with 1448B MTU
                                         // and 424B iblt, 1K left for payload)
+static constexpr size_t maxCAddSize = maxPubSize + 424; // name + content space of a cAdd
+static constexpr uint8_t ibltShrinkAfter = 16; // small differences seen before shrinking iblt
 static constexpr std::chrono::milliseconds maxPubLifetime = 2s;
 static constexpr std::chrono::milliseconds maxClockSkew = 1s;
 
@@ -81,6 +103,13 @@ using GetLifetimeCb = std::function<std::chrono::milliseconds(const rPub&)>;
 using PubPtr = rPub;
 using PubVec = std::vector<PubPtr>;
 using OrderPubCb = std::function<bool(PubVec&,PubVec&)>;
+/**
+ * @brief app callback to return the priority class of a Publication
+ *
+ * Pubs are offered to peers in class order (0 first) and, within a class,
+ * newest first. The class is computed once, when the pub is added.
+ */
+using PubPriorityCb = std::function<uint8_t(const rPub&)>;
 
 /**
  * @brief sync a collection of publications between an arbitrary set of nodes.
@@ -96,8 +125,15 @@ using OrderPubCb = std::function<bool(PubVec&,PubVec&)>;
  * is signed so it is protected against replay attacks. App publications
  * are signed by pubCertificate and external publications are verified by
  * pubValidator on arrival.
+ *
+ * Pubs are identified by a 32-bit hash (SyncPS) or, for collections big or
+ * long-lived enough that two pubs having the same hash is a real possibility
+ * (the second is silently dropped), a 64-bit one (SyncPS64). The wider hash
+ * uses smaller iblts so cStates still fit in a packet but they peel smaller
+ * differences. Every member of a collection has to use the same width.
  */
-struct SyncPS {
+template<typename PubHashT = uint32_t>
+struct BasicSyncPS {
     using Error = std::runtime_error;
     using Nonce = uint32_t; // cState Nonce format
 
@@ -105,35 +141,110 @@ struct SyncPS {
     // actual pub Item, its source (local or from net) and whether it is active (unexpired).
     // The collection keeps both a hash-indexed map of entries and the iblt of the collection
     // so it can guarantee they are consistent with each other.
-    using PubHash = uint32_t; // iblt publication hash type
+    using PubHash = PubHashT; // iblt publication hash type
     static inline PubHash hashPub(const rPub& r) { return IBLT<PubHash>::hashobj(r); }
+    using Estimator = DiffEstimator<PubHash>;
+    using HashBuf = typename IBLT<PubHash>::HashBuf;
 
     template<typename Item>
     struct CE { // Collection Entry 
         Item i_;
         uint8_t s_; // item status
+        uint64_t ord_{}; // cAdd ordering key (see orderKey)
+        std::chrono::steady_clock::time_point rs_{}; // another node's pub: when we may next resend it (see relayPubs)
 
         constexpr CE(Item&& i, uint8_t s) : i_{std::forward<Item>(i)}, s_{s} {}
         static constexpr uint8_t act = 1;  // 0 = expired, 1 = active
         static constexpr uint8_t loc = 2;  // 0 = from net, 2 = local
+        static constexpr uint8_t dcb = 4;  // local pub whose delivery callback is pending
         auto active() const noexcept { return (s_ & act) != 0; }
+        auto awaitingConfirm() const noexcept { return (s_ & (act|dcb)) == (act|dcb); }
+        auto& awaitConfirm(bool on) { on? s_ |= dcb : s_ &=~ dcb; return *this; }
         auto fromNet() const noexcept { return (s_ & (act|loc)) == act; }
         auto local() const noexcept { return (s_ & (act|loc)) == (act|loc); }
         auto& deactivate() { s_ &=~ act; return *this; }
     };
 
-    template<typename Item, typename Ent = CE<Item>, typename Base = std::unordered_map<PubHash,Ent>>
+    // Collections default to an open-addressing table since they're probed on every
+    // cState & cAdd. Note that its items can move when it grows.
+    template<typename Item, typename Ent = CE<Item>, typename Base = FlatMap<PubHash,Ent>>
     struct Collection : Base {
-        IBLT<PubHash> iblt_{};
+        // The collection's iblt is kept at each of the supported table sizes so a
+        // peer's cState can be answered whatever size iblt it carries.
+        std::vector<IBLT<PubHash>> iblts_{IBLT<PubHash>::stsizes.begin(), IBLT<PubHash>::stsizes.end()};
+
+        constexpr auto& iblt() noexcept { return iblts_.front(); }
+        auto& iblt(size_t stsize) {
+            for (auto& i : iblts_) if (i.subtableSize() == stsize) return i;
+            throw Error("no collection iblt of size " + std::to_string(stsize));
+        }
+        uint64_t gen_{};    // incremented on every change to the collection
+
+        constexpr auto generation() const noexcept { return gen_; }
+
+        // The most recent iblt changes (hash, true if inserted) so a peel of an earlier
+        // version of the iblt can be brought up to date (see handleCState).
+        static constexpr size_t journalSize = 64;
+        std::array<std::pair<PubHash,bool>,journalSize> journal_{};
+        uint64_t ibltGen_{};    // number of iblt changes
+
+        void ibltInsert(PubHash h) { for (auto& i : iblts_) i.insert(h); ++gen_; journal_[ibltGen_++ % journalSize] = {h, true}; }
+        void ibltErase(PubHash h) { for (auto& i : iblts_) i.erase(h); ++gen_; journal_[ibltGen_++ % journalSize] = {h, false}; }
+
+        // call 'f(hash, inserted)' on each iblt change after change number 'g'. Returns
+        // false (without calling 'f') if they're no longer all in the journal.
+        template<typename F>
+        bool changesSince(uint64_t g, F&& f) const {
+            if (ibltGen_ - g > journalSize) return false;
+            for (; g < ibltGen_; ++g) f(journal_[g % journalSize].first, journal_[g % journalSize].second);
+            return true;
+        }
 
-        constexpr auto& iblt() noexcept { return iblt_; }
+        // Collections of pubs also keep an ordered index of their items' names (the name's
+        // TLV value bytes, which stay put since pub buffers are shared) so the items under a
+        // prefix can be found without scanning the collection. A component prefix of a name
+        // is a byte prefix of its value so they're adjacent in the index.
+        using NameBytes = std::span<const uint8_t>;
+        struct NameKey {
+            NameBytes n_;
+            PubHash h_;
+        };
+        struct NameLess {
+            using is_transparent = void;
+            static bool less(NameBytes a, NameBytes b) noexcept {
+                return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+            }
+            bool operator()(const NameKey& a, const NameKey& b) const noexcept {
+                return less(a.n_, b.n_) || (! less(b.n_, a.n_) && a.h_ < b.h_);
+            }
+            bool operator()(const NameKey& a, NameBytes b) const noexcept { return less(a.n_, b); }
+            bool operator()(NameBytes a, const NameKey& b) const noexcept { return less(a, b.n_); }
+        };
+        std::set<NameKey,NameLess> names_{};
+
+        static NameBytes nameBytes(const rName& n) noexcept { rPrefix p{n}; return {p.data(), p.size()}; }
+
+        // call 'f' with the hash of each item whose name starts with 'pfx' (in name order)
+        template<typename F, typename C=Item> requires hasView<C>
+        void forPrefix(const rPrefix& pfx, F&& f) const {
+            NameBytes pb{pfx.data(), pfx.size()};
+            for (auto k = names_.lower_bound(pb); k != names_.end(); ++k) {
+                if (k->n_.size() < pb.size() || ! std::equal(pb.begin(), pb.end(), k->n_.begin())) break;
+                // (an 'f' that returns bool stops the scan by returning false)
+                if constexpr (std::is_same_v<std::invoke_result_t<F&,PubHash>,bool>) { if (! f(k->h_)) break; }
+                else f(k->h_);
+            }
+        }
 
+        using Base::contains;
         template<typename C=Item> requires hasView<C>
         constexpr auto contains(decltype(C().asView())&& c) const noexcept { return Base::contains(hashPub(c)); }
 
         PubHash add(PubHash h, Item&& i, decltype(Ent::s_) s) {
-            if (const auto& [it,added] = Base::try_emplace(h, std::forward<Item>(i), s); !added) return 0;
-            iblt_.insert(h);
+            const auto& [it,added] = Base::try_emplace(h, std::forward<Item>(i), s);
+            if (! added) return 0;
+            if constexpr (hasView<Item>) names_.emplace(NameKey{nameBytes(it->second.i_.name()), h});
+            ibltInsert(h);
             return h;
         }
         auto addLocal(PubHash h, Item&& i) { return add(h, std::forward<Item>(i), Ent::loc|Ent::act); }
@@ -141,6 +252,7 @@ struct SyncPS {
         auto add(Item&& i, decltype(Ent::s_) s) { return add(hashPub(i), std::forward<Item>(i), s); }
         auto addLocal(Item&& i) { return add(std::forward<Item>(i), Ent::loc|Ent::act); }
         auto addNet(Item&& i) { return add(std::forward<Item>(i), Ent::act); }
+        auto addNet(PubHash h, Item&& i) { return add(h, std::forward<Item>(i), Ent::act); }
 
         template<typename C=Item> requires hasView<C>
         auto addNet(decltype(C().asView())&& c) { return add(Item{c}, Ent::act); }
@@ -148,20 +260,30 @@ struct SyncPS {
         auto deactivate(PubHash h) {
             if (auto p = Base::find(h); p != Base::end() && p->second.active()) {
                 p->second.deactivate();
-                iblt_.erase(h);
+                ibltErase(h);
             }
         }
         auto erase(PubHash h) {
             if (auto p = Base::find(h); p != Base::end()) {
-                if (p->second.active()) iblt_.erase(h);
+                if (p->second.active()) ibltErase(h);
+                if constexpr (hasView<Item>) names_.erase(NameKey{nameBytes(p->second.i_.name()), h});
                 Base::erase(p);
+                ++gen_;
             }
         }
     };
 
-    Collection<crData> pubs_{};             // current publications
-    Collection<DelivCb> pubCbs_{};          // pubs requesting delivery callbacks
-    lpmLT<crPrefix,SubCb> subscriptions_{}; // subscription callbacks
+    // publication lifecycle events are handled by a timing wheel rather than
+    // allocating an asio timer per event (there are 2-3 events per pub).
+    enum class PubEv : uint8_t { delivTimeout, deactivate, erase, unignore };
+    struct PubEvent {
+        PubHash h_;
+        PubEv ev_;
+    };
+
+    Collection<sharedPub> pubs_{};          // current publications (buffers can be shared with other collections)
+    FlatMap<PubHash,DelivCb> pubCbs_{};     // delivery callbacks of local pubs (see CE::dcb)
+    lpmLT<crPrefix,SubCb,lpmHashed> subscriptions_{}; // subscription callbacks
 
     DirectFace& face_;
     const crName collName_;         // 'name' of the collection
@@ -170,30 +292,148 @@ struct SyncPS {
     std::chrono::milliseconds cStateLifetime_{1357ms};
     std::chrono::milliseconds pubLifetime_{maxPubLifetime};
     std::chrono::milliseconds pubExpirationGB_{maxPubLifetime};
-    pTimer scheduledCStateId_{std::make_shared<Timer>(getDefaultIoContext())};
-    pTimer scheduledCAddId_{std::make_shared<Timer>(getDefaultIoContext())};
+    TimerHandle scheduledCStateId_{};
+    TimerHandle scheduledCAddId_{};
     std::uniform_int_distribution<unsigned short> randInt_{7u, 23u}; // cstate publish delay interval
     Nonce  nonce_{};                // nonce of current cState
+    size_t ibltSize_{IBLT<PubHash>::stsize}; // sub-table size of the iblt in our cState
+    uint8_t smallDiffs_{};          // consecutive cStates whose difference fit a smaller iblt
+    // Pending peer cStates are rehandled after every publish and cAdd (see handleCStates)
+    // but their iblts don't change and ours only by the pubs added or expired since, so
+    // each keeps its decoded iblt and the peel of its difference with ours which is
+    // brought up to date from the pubs_ iblt journal.
+    struct CStatePeel {
+        std::vector<uint8_t> name_{};   // the cState's name
+        IBLT<PubHash> peer_{};          // its decoded iblt
+        HashBuf have_{}, need_{};       // the peel of pubs_ - peer_ ...
+        uint64_t ibltGen_{};            // ... as of this pubs_ iblt change
+        bool peeled_{false};            // false if have_/need_ aren't valid
+        uint64_t pass_{};               // handleCStates pass that last used it
+    };
+    static constexpr size_t maxPeels = 16;
+    static constexpr uint8_t maxClasses = 3;    // (see priorityClasses)
+    // bytes of a cState besides its name's components: the interest, name & iblt tlv
+    // headers, nonce & lifetime and the neighborDeltas components
+    static constexpr size_t cStateOverhead = 48;
+    std::vector<CStatePeel> peels_{};
+    uint64_t peelPass_{};           // handleCStates passes
+    bool handling_{false};          // cStates are being handled (see handleCStates)
+    bool rehandle_{false};          // ... and another handleCStates pass was requested
+    IBLT<PubHash> scratch_{};       // scratch table for handleCState's iblt arithmetic
+    // iblts of the slices of the collection matching the topic filters of pending cStates
+    // (and, for priority class iblts, a class)
+    static constexpr uint8_t anyClass = 0xff;
+    struct TopicSlice {
+        std::vector<uint8_t> filter_{};
+        uint8_t cls_{anyClass};
+        IBLT<PubHash> iblt_{};
+        FlatMap<PubHash,uint8_t> members_{}; // hashes in iblt_
+        uint64_t ibltGen_{};            // pubs_.ibltGen_ when iblt_ was updated
+        uint64_t pass_{};               // handleCStates pass that last used it
+    };
+    static constexpr size_t maxSlices = 8;
+    std::vector<TopicSlice> slices_{};
+    bool topicFilter_{false};       // put a filter of our subscriptions in our cStates
+    size_t pubPfxLen_;              // bytes of the name prefix all pubs share (see pubPrefix)
+    uint8_t nClasses_{1};           // priority classes (all but the last get an iblt in cStates)
+    IBLT<PubHash> clsPeer_{};       // scratch for a peer's priority class iblt
+    std::optional<crInterest> cState_{}; // last cState sent (reused while collection is unchanged)
+    uint64_t cStateGen_{};          // pubs_ generation when cState_ was built
+    size_t cStateIBLTSize_{};       // iblt size when cState_ was built
+    // neighborDeltas state (see cStateName & noteNeighbor)
+    bool deltas_{false};            // send our iblt as a change log once the peer has a keyframe
+    struct Keyframe {
+        uint32_t id_{};                 // (0 = unused)
+        uint64_t ibltGen_{};            // pubs_.ibltGen_ of the keyframe's iblt
+        size_t stsize_{};               // its sub-table size
+    };
+    std::array<Keyframe,4> myKeys_{};   // our most recent keyframes
+    uint8_t nextKey_{};             // next myKeys_ slot to use
+    uint32_t ackedKey_{};           // our newest keyframe the peer says it has (0 = none)
+    struct PeerKey {
+        uint32_t id_{};
+        IBLT<PubHash> iblt_{};
+    };
+    std::vector<PeerKey> peerKeys_{};   // the peer's most recent keyframes, oldest first
+    uint32_t peerAck_{};            // the peer's newest keyframe, acked in our cStates (0 = none)
+    bool peerDeltas_{false};        // the peer has sent a keyframe id or ack (it does neighborDeltas)
+    uint32_t unkeyed_{};            // keyframes that could have gone without an id (see cStateName)
+    static constexpr size_t oldCStateComps = 3;   // components after the collection name an older syncps takes
+    static constexpr uint32_t probeKeys = 8;
+    uint8_t maxCAddBurst_{1};       // max cAdds sent in response to one cState
+    bool compactCAdds_{false};      // send cAdds with delta-encoded pub names (see cadd_codec.hpp)
+    struct SignedCAdd {
+        std::chrono::steady_clock::time_point t_{};
+        std::vector<PubHash> pubs_{};   // hashes of the pubs in cAdd_ (empty if slot unused)
+        Publication cAdd_{};
+    };
+    std::array<SignedCAdd,4> cAddCache_{}; // recently signed cAdds (see makeCAdd)
+    uint8_t cAddCacheNext_{};       // next cAddCache_ slot to replace
+    std::chrono::microseconds cAddGap_{2ms}; // interval between cAdds of a burst
+    std::unique_ptr<WorkerPool> validators_{}; // optional threads for parallel pub validation
+    std::shared_ptr<CryptoPool> crypto_{}; // optional threads for asynchronous pub signing & validation
+    std::unique_ptr<PubQueue> pubQ_{}; // optional queue of pubs from other threads (see publishQueued)
+    std::shared_ptr<PubCodec> codec_{}; // optional expansion of compressed pubs for delivery (see pub_codec.hpp)
+    std::unique_ptr<AdaptiveTiming> adaptive_{}; // optional adaptation of delays & lifetimes to the network
+    std::unique_ptr<PubSlabs> slabs_{};         // optional slab storage of network pubs
+    std::unique_ptr<ValidateLimiter> cAddLimiter_{}; // optional limits on cAdd validation per sender
+    std::unique_ptr<ValidateLimiter> pubLimiter_{}; // optional limits on pub validation per signer
+    std::unique_ptr<SignerQuota> quota_{};  // optional per-signer pub quotas & cAdd shares (see signerQuota)
+    // when the cAdd being handled was received by the kernel (zero if unknown) and by us
+    struct RxTimes {
+        std::chrono::system_clock::time_point kernel_{}, user_{};
+    };
+    RxTimes cAddRx_{};
+    thumbPrint cAddSrc_{};          // srcId() of the cAdd whose pubs are being handled
+    struct PendingCAdd {
+        uint64_t seq_;
+        std::chrono::steady_clock::time_point t0_{};
+        RxTimes rx_{};
+        thumbPrint src_{};
+        std::vector<crData> pubs_{};
+        std::vector<PubHash> hashes_{};
+        std::vector<uint8_t> ok_{};
+        bool done_{false};
+    };
+    std::deque<PendingCAdd> pendingCAdds_{}; // cAdds whose pubs crypto_ is validating (in arrival order)
+    uint64_t cAddSeq_{};            // sequence number of next pendingCAdds_ entry
+    std::vector<rData> cAddPubs_{}; // scratch for onCAdd: new pubs in the cAdd
+    std::vector<PubHash> cAddHashes_{}; // ... and their hashes
+    std::vector<rData> cAddAll_{};  // scratch for onCAdd: all the cAdd's pubs
+    std::vector<PubHash> cAddAllHashes_{}; // ... and their hashes
+    std::vector<uint8_t> cAddExp_{}; // scratch for onCAdd: canonical pubs of a compact cAdd
+    FlatMap<PubHash,uint8_t> rejected_{}; // hashes of pubs being ignored (failed validation or expired)
+    std::vector<uint8_t> pubOk_{};  // scratch for onCAdd: pub validation results
+    std::vector<uint8_t> plain_{};  // scratch for deliver: decrypted copy of the pub being delivered
+    bool plainBusy_{false};         // plain_ holds a pub whose delivery is in progress
+    std::unique_ptr<PubStore> snap_{}; // optional on-disk snapshot of the collection
+    std::vector<crData> snapPubs_{}; // pubs loaded from the snapshot, added at start()
+    size_t snapLive_{};             // snapshot size after it was last rewritten
     uint32_t publications_{};       // # local publications
     bool delivering_{false};        // currently processing a cAdd
     bool registering_{true};        // RIT not set up yet
     bool autoStart_{true};          // call 'start()' when done registering
+    SyncStats stats_{};             // performance counters
+    TraceCb trace_{};               // pub lifecycle tracing (see pub_trace.hpp)
+    TimingWheel<PubEvent> pubEvents_{face_.getIoContext(), [this](const auto& e){ pubEvent(e); }};
     GetLifetimeCb getLifetime_{ [this](auto){ return pubLifetime_; } };
     IsExpiredCb isExpired_{
         // default CB assumes last component of name is a timestamp and says pub is expired
         // if the time from publication to now is >= the pub lifetime
-        [this](const auto& p) { auto dt = std::chrono::system_clock::now() - p.name().last().toTimestamp();
+        [this](const auto& p) { auto dt = coarseClock::now() - p.name().last().toTimestamp();
                          return dt >= getLifetime_(p) + maxClockSkew || dt <= -maxClockSkew; } };
-    OrderPubCb orderPub_{[](PubVec& pv, PubVec&){   //default doesn't send others pubs
-            // can't use modern c++ on a mac
-            //std::ranges::sort(pOurs, {}, [](const auto& p) { return p.name().last().toTimestamp(); });
-            std::sort(pv.begin(), pv.end(), [](const auto& p1, const auto& p2){
-                    return p1.name().last().toTimestamp() > p2.name().last().toTimestamp(); });
-            return true;    //to keep same behavior as before adding resending
+    // pv & pvOth arrive in priority order (see orderKey) so the default just doesn't send others' pubs
+    OrderPubCb orderPub_{[](PubVec&, PubVec&){ return true; }}; //to keep same behavior as before adding resending
+    std::chrono::milliseconds relayHold_{0ms};  // wait before resending others' pubs (0 = don't, see relayPubs)
+    PubPriorityCb pubPriority_{};   // null puts every pub in class 0
+    std::vector<std::pair<uint64_t,PubHash>> cands_{}; // scratch for handleCState: candidate pubs by orderKey
+
+    auto randInt() {
+        if (adaptive_) {
+            return std::uniform_int_distribution<unsigned>(adaptive_->delayMin().count(), adaptive_->delayMax().count())(randGen());
         }
-    };
-
-    constexpr auto randInt() { return randInt_(randGen()); }
+        return unsigned(randInt_(randGen()));
+    }
 
     /**
      * @brief constructor
@@ -203,22 +443,47 @@ struct SyncPS {
      * @param wsig - sigmgr for cAdd packet signing and validation
      * @param psig - sigmgr for Publication validation
      */
-    SyncPS(DirectFace& face, rName collName, SigMgr& wsig, SigMgr& psig)
-        : face_{face}, collName_{collName}, pktSigmgr_{wsig}, pubSigmgr_{psig} {
+    BasicSyncPS(DirectFace& face, rName collName, SigMgr& wsig, SigMgr& psig)
+        : face_{face}, collName_{collName}, pktSigmgr_{wsig}, pubSigmgr_{psig},
+          pubPfxLen_{collName_.rest().size()} {
         // if auto-starting at the time 'run()' is called, fire off a register for collection name
-        getDefaultIoContext().dispatch([this]{ if (autoStart_) start(); });
+        face_.getIoContext().dispatch([this]{ if (autoStart_) start(); });
     }
 
-    SyncPS(rName collName, SigMgr& wsig, SigMgr& psig) : SyncPS(defaultFace(), collName, wsig, psig) {}
+    BasicSyncPS(rName collName, SigMgr& wsig, SigMgr& psig) : BasicSyncPS(defaultFace(), collName, wsig, psig) {}
 
 
+    /**
+     * @brief key giving the order pubs are offered in cAdds (smallest first)
+     *
+     * The priority class is the top byte and the rest is the complement of the pub's
+     * timestamp (us since the epoch, which fits in 56 bits) so newer pubs sort first.
+     * It's computed once per pub rather than parsing names on every comparison.
+     */
+    uint64_t orderKey(const rPub& p) const {
+        static constexpr uint64_t tsMask = (uint64_t(1) << 56) - 1;
+        uint64_t ts{};
+        try {
+            ts = std::chrono::duration_cast<std::chrono::microseconds>(
+                        p.name().last().toTimestamp().time_since_epoch()).count();
+        } catch (const std::exception&) { }     // no timestamp sorts as oldest
+        uint64_t cls = pubPriority_? pubPriority_(p) : 0;
+        return cls << 56 | (tsMask - (ts & tsMask));
+    }
+
     /**
      * @brief add a new local or network publication to the 'active' pubs set
+     * ('h' is its hash, if that's already known)
      */
-    auto addToActive(crData&& p, bool localPub) {
+    auto addToActive(sharedPub&& p, bool localPub, PubHash h = 0) {
         //print("addToActive {:x} {} {}: {}\n", hashPub(p), p.size(), p.name(), localPub);
         auto lt = getLifetime_(p);
-        auto hash = localPub? pubs_.addLocal(std::move(p)) : pubs_.addNet(std::move(p));
+        auto ord = orderKey(p);
+        if (h == 0) h = hashPub(p);
+        auto hash = localPub? pubs_.addLocal(h, std::move(p)) : pubs_.addNet(h, std::move(p));
+        if (hash != 0) pubs_.at(hash).ord_ = ord;
+        if (hash != 0 && quota_) quota_->add(signerOf(pubs_.at(hash).i_.asView()));
+        if (hash != 0 && snap_) snapAppend(pubs_.at(hash).i_);
         if (hash == 0 || lt == decltype(lt)::zero()) return hash;
 
         // We remove an expired publication from our active set at twice its pub
@@ -230,12 +495,32 @@ struct SyncPS {
         // interval to prevent a peer with a late clock giving it back to us as soon
         // as we delete it.
 
-        if (localPub) oneTime(lt, [this, hash]{ if (pubCbs_.size() > 0) doDeliveryCb(hash, false); });
-        oneTime(lt + maxClockSkew, [this, hash]{ pubs_.deactivate(hash); });
-        oneTime(lt + pubExpirationGB_, [this, hash]{ pubs_.erase(hash); });
+        if (localPub) pubEvents_.add(lt, {hash, PubEv::delivTimeout});
+        pubEvents_.add(lt + maxClockSkew, {hash, PubEv::deactivate});
+        pubEvents_.add(lt + pubExpirationGB_, {hash, PubEv::erase});
         return hash;
     }
 
+    // an active pub is leaving the active set so no longer counts against its signer's quota
+    void quotaRelease(PubHash h) {
+        if (auto p = pubs_.find(h); p != pubs_.end() && p->second.active()) quota_->remove(signerOf(p->second.i_.asView()));
+    }
+
+    /**
+     * @brief handle a publication lifecycle event from the timing wheel
+     */
+    void pubEvent(const PubEvent& e) {
+        switch (e.ev_) {
+            case PubEv::delivTimeout: if (pubCbs_.size() > 0) doDeliveryCb(e.h_, false); break;
+            case PubEv::deactivate:
+                if (quota_) quotaRelease(e.h_);
+                pubs_.deactivate(e.h_);
+                break;
+            case PubEv::erase: pubs_.erase(e.h_); break;
+            case PubEv::unignore: pubs_.ibltErase(e.h_); rejected_.erase(e.h_); break;
+        }
+    }
+
     /**
      * @brief handle a new publication from app
      *
@@ -244,10 +529,16 @@ struct SyncPS {
      *
      * @param pub the object to publish
      */
-    PubHash publish(crData&& pub) {
+    PubHash publish(crData&& pub) { return publish(sharedPub(std::move(pub))); }
+
+    // publish a pub whose buffer may also be in other collections (e.g., a relayed pub)
+    PubHash publish(sharedPub&& pub) {
         auto h = addToActive(std::move(pub), true);
         if (h == 0) return h;
         ++publications_;
+        ++stats_.pubsLocal;
+        if (trace_) trace(TraceEv::publish, h, pubs_.at(h).i_);
+        DCT_PUB_PROBE(publish, h, pubs_.at(h).i_);
         // new pub may let us respond to pending cState(s).
         if (! delivering_) {
             sendCState();
@@ -265,23 +556,141 @@ struct SyncPS {
      *
      * @param pub the object to publish
      */
-    PubHash publish(crData&& pub, DelivCb&& cb) {
+    PubHash publish(crData&& pub, DelivCb&& cb) { return publish(sharedPub(std::move(pub)), std::move(cb)); }
+    PubHash publish(sharedPub&& pub, DelivCb&& cb) {
         auto h = publish(std::move(pub));
-        if (h != 0) pubCbs_.addLocal(h, std::move(cb));
+        if (h != 0) {
+            pubCbs_.try_emplace(h, std::move(cb));
+            pubs_.at(h).awaitConfirm(true);
+        }
         return h;
     }
 
+    /**
+     * @brief completion token form of publish with a delivery callback (see face/awaitable.hpp)
+     *
+     * 'co_await sync.publishConfirmed(std::move(pub))' returns true when the pub's arrival
+     * at another member is confirmed and false if it expires first (or couldn't be published).
+     */
+    template<typename Token = defaultToken>
+    auto publishConfirmed(crData&& pub, Token&& token = {}) {
+        return boost::asio::async_initiate<Token, void(bool)>([this](auto&& h, crData&& pub) {
+                    auto c = makeOneShot<void(bool)>(std::move(h), face_.getIoContext());
+                    if (publish(std::move(pub), [c](const rPub&, bool ok) { (*c)(ok); }) == 0) (*c)(false);
+                }, token, std::move(pub));
+    }
+
+    /**
+     * @brief sign 'pub' with sigmgr 'sm' then publish it
+     *
+     * If there's a crypto pool the signature is computed by one of its threads
+     * and the pub is published when that completes so an app publishing at a
+     * high rate overlaps signing with the io thread's sync & network work
+     * (pubs signed at the same time may be added in a different order than that of
+     * the calls). Otherwise the pub is signed and published before returning.
+     *
+     * @param pub the (unsigned) object to publish
+     * @param sm  the publication signing sigmgr
+     */
+    void publishAsync(crData&& pub, SigMgr& sm) {
+        if (! crypto_) {
+            if (sm.sign(pub)) publish(std::move(pub));
+            return;
+        }
+        sm.signAsync(*crypto_, std::move(pub), [this](crData&& p, bool ok) {
+                if (ok) publish(std::move(p));
+                else print("syncps::publishAsync: couldn't sign {}\n", p.name());
+            });
+    }
+
+    /**
+     * @brief accept pubs from threads other than the io thread (see publish_queue.hpp)
+     *
+     * Must be called on the io thread before any other thread calls publishQueued().
+     * Pubs queued unsigned are signed by 'signer' (on the crypto pool if there is one).
+     */
+    auto& publishQueue(SigMgr& signer) {
+        pubQ_ = std::make_unique<PubQueue>(face_.getIoContext(),
+                    [this, &signer](std::vector<crData>& signedPubs, std::span<crData> unsignedPubs) {
+                        for (auto& p : unsignedPubs) {
+                            if (crypto_) publishAsync(std::move(p), signer);
+                            else if (signer.sign(p)) signedPubs.emplace_back(std::move(p));
+                        }
+                        publishBatch(signedPubs);
+                    });
+        return *this;
+    }
+
+    /**
+     * @brief (any thread) queue 'pub' to be published by the io thread
+     *
+     * The io thread drains the queue in batches through publishBatch() so a stream of
+     * pubs from worker threads costs neither an allocation nor a handoff per pub.
+     *
+     * @param pub  the publication (signed or, if 'sign', to be signed by the queue's signer)
+     * @return false if the queue is full (pub is left unchanged) or publishQueue() hasn't been called
+     */
+    bool publishQueued(crData&& pub, bool sign = false) { return pubQ_ && pubQ_->push(std::move(pub), sign); }
+
+    /**
+     * @brief publish a batch of publications then do a single cState/cAdd pass
+     *
+     * Each publish() sends a new cState and rescans the pending peer cStates so an
+     * app publishing a burst of pubs in a loop sends a burst of cStates. This adds
+     * all of 'pubs' (which are moved from) to the collection before doing either.
+     *
+     * @param pubs the objects to publish
+     * @return number of pubs published
+     */
+    size_t publishBatch(std::span<crData> pubs) {
+        auto initpubs = publications_;
+        auto wasDelivering = std::exchange(delivering_, true);
+        for (auto& p : pubs) publish(std::move(p));
+        delivering_ = wasDelivering;
+        auto n = publications_ - initpubs;
+        if (n != 0 && ! delivering_) {
+            sendCState();
+            handleCStates();
+        }
+        return n;
+    }
+
     /**
      * @brief deliver a publication to a subscription's callback
      *
      * Since pub content may be encrypted, handles decrypting a copy
-     * of the pub before presenting it to the subscriber then deleting
+     * of the pub before presenting it to the subscriber then wiping
      * the copy (plaintext versions of encrypted objects must be ephemeral).
+     * The copy is made in a scratch buffer reused by every delivery so
+     * delivering doesn't allocate. A delivery nested inside a callback (e.g.,
+     * the callback subscribes) uses its own buffer. If the collection has a
+     * codec, compressed pubs are expanded (after decryption) the same way.
      */
     void deliver(const rPub& pub, const SubCb& cb) {
+        ++stats_.pubsDelivered;
+        if (trace_) trace(TraceEv::deliver, hashPub(pub), pub);
+        DCT_PUB_PROBE(deliver, hashPub(pub), pub);
         if (pubSigmgr_.encryptsContent() && pub.content().size() > 0) {
-            Publication pcpy{pub};
-            if (pubSigmgr_.decrypt(pcpy)) cb(pcpy);
+            if (plainBusy_) {
+                std::vector<uint8_t> buf{};
+                deliverDecrypted(pub, cb, buf);
+                return;
+            }
+            plainBusy_ = true;
+            struct inUse { bool& b; ~inUse() { b = false; } } busy{plainBusy_};
+            deliverDecrypted(pub, cb, plain_);
+            return;
+        }
+        deliverExpanded(pub, cb);
+    }
+    void deliverDecrypted(const rPub& pub, const SubCb& cb, std::vector<uint8_t>& buf) {
+        buf.assign(pub.data(), pub.data() + pub.size());
+        struct wipe { std::vector<uint8_t>& b; ~wipe() { sodium_memzero(b.data(), b.size()); } } w{buf};
+        if (rPub p{buf.data(), buf.size()}; pubSigmgr_.decrypt(p)) deliverExpanded(p, cb);
+    }
+    void deliverExpanded(const rPub& pub, const SubCb& cb) {
+        if (codec_ && PubCodec::isCompressed(pub)) {
+            if (auto p = codec_->expand(pub); p) cb(*p);
             return;
         }
         cb(pub);
@@ -303,47 +712,401 @@ struct SyncPS {
             t->second = std::move(cb);
             return *this;
         }
-        // deliver all active pubs matching this subscription
-        for (const auto& [h, pe] : pubs_) if (pe.fromNet() && topic.isPrefix(pe.i_.name())) deliver(pe.i_, cb);
-
+        // deliver all active pubs matching this subscription (found via the collection's
+        // name index). 'cb' may publish (which can move pubs_ items) so the matches are
+        // collected before delivering. They're shared pubs so they outlive their entries.
+        std::vector<sharedPub> pv{};
+        pubs_.forPrefix(topic, [this, &pv](PubHash h) {
+                    if (const auto& pe = pubs_.at(h); pe.fromNet()) pv.emplace_back(pe.i_);
+                });
+        crPrefix t{topic};
         subscriptions_.add(std::move(topic), std::move(cb));
+        if (topicFilter_) cState_.reset();  // its filter has changed
+        if (! pv.empty()) replay(std::move(t), std::make_shared<std::vector<sharedPub>>(std::move(pv)), 0);
         return *this;
     }
+
+    // Deliver a new subscription's backlog of pubs 'replayBatch' at a time, yielding to
+    // the io_context between batches so a large backlog doesn't stall the face. Pubs
+    // arriving meanwhile are delivered by the (already added) subscription. The backlog
+    // stops if the subscription is removed.
+    static constexpr size_t replayBatch = 64;
+    void replay(crPrefix topic, std::shared_ptr<std::vector<sharedPub>> pv, size_t next) {
+        auto s = subscriptions_.find(topic);
+        if (s == subscriptions_.end()) return;
+        const auto cb = s->second; // 'cb' can change the subscriptions table
+        for (auto e = std::min(next + replayBatch, pv->size()); next < e; ++next) deliver((*pv)[next], cb);
+        if (next >= pv->size()) return;
+        oneTime(std::chrono::microseconds(0), [this, topic = std::move(topic), pv = std::move(pv), next]() mutable {
+                    replay(std::move(topic), std::move(pv), next);
+                });
+    }
     auto& subscribe(crName&& topic, SubCb&& cb) { return subscribe(crPrefix{std::move(topic)}, std::move(cb)); }
     auto& subscribe(const rName& topic, SubCb&& cb) { return subscribe(crPrefix{topic}, std::move(cb)); }
 
-    auto& unsubscribe(crPrefix&& topic) { subscriptions_.erase(topic); return *this; }
+    auto& unsubscribe(crPrefix&& topic) {
+        subscriptions_.erase(topic);
+        if (topicFilter_) cState_.reset();
+        return *this;
+    }
+
+    /**
+     * @brief read-only scans of the collection's active pubs
+     *
+     * 'f(const rPub&)' is called, in name order, with a view of each active pub whose
+     * name starts with 'pfx' (and, for the other forms, whose timestamp is in [from, to)
+     * or whose signer has thumbprint 'tp'). Nothing is copied: the views are of the
+     * collection's buffers and are only valid during the call, so 'f' must copy what
+     * it keeps and mustn't publish or otherwise change the collection. An 'f' that
+     * returns bool ends the scan by returning false. Returns the number of pubs 'f'
+     * was called with. (Subscriptions are for pubs as they arrive; these are for
+     * dashboards & bulk exports of what's there now.)
+     */
+    template<typename F>
+    size_t scanPubs(const rPrefix& pfx, F&& f) const { return scan(pfx, [](const rPub&) { return true; }, f); }
+
+    template<typename F>
+    size_t scanPubs(const rPrefix& pfx, std::chrono::system_clock::time_point from,
+                    std::chrono::system_clock::time_point to, F&& f) const {
+        return scan(pfx, [from, to](const rPub& p) {
+                        try {
+                            auto t = p.name().last().toTimestamp();
+                            return t >= from && t < to;
+                        } catch (const std::exception&) { return false; }
+                    }, f);
+    }
+
+    template<typename F>
+    size_t scanPubsBySigner(const rPrefix& pfx, const thumbPrint& tp, F&& f) const {
+        return scan(pfx, [&tp](const rPub& p) { return signerOf(p) == tp; }, f);
+    }
+
+    // call scan callback 'f' on 'p', returning false if it wants the scan to stop
+    template<typename F>
+    static bool scanCall(F& f, const rPub& p) {
+        if constexpr (std::is_same_v<std::invoke_result_t<F&,const rPub&>,bool>) return f(p);
+        else {
+            f(p);
+            return true;
+        }
+    }
+
+    /**
+     * @brief put a filter of our subscriptions in our cStates (see topic_filter.hpp) so
+     * peers only send us pubs we subscribe to
+     *
+     * Collections that pass pubs on (e.g., relays) mustn't set this. Peers running an
+     * older syncps ignore cStates with a filter when they also carry an iblt size and
+     * difference estimator so it's off by default.
+     */
+    auto& topicFilter(bool on) {
+        topicFilter_ = on;
+        cState_.reset();
+        return *this;
+    }
+
+    /**
+     * @brief the name prefix all of the collection's pubs share if it isn't the
+     * collection name (e.g., a DCT app's #pubPrefix). Topic filters only test the
+     * components after it and a subscription to it covers the whole collection.
+     */
+    auto& pubPrefix(const rName& p) {
+        pubPfxLen_ = p.rest().size();
+        cState_.reset();
+        return *this;
+    }
+
+    /**
+     * @brief split the collection into 'n' (1 to 3) priority classes by pubPriorityCb
+     * (priorities of n-1 and up are the last class)
+     *
+     * cAdds are always filled in priority order but, when a peer's collection differs
+     * by more than its iblt can peel, only what its difference estimator shows gets
+     * sent. With classes, cStates also carry a default size iblt of each class but
+     * the last so the difference of those classes (e.g., certs, keys & alarms) usually
+     * peels even with a bulk (last class) backlog and their pubs go out first. All
+     * the collection's members must use the same priorities.
+     */
+    auto& priorityClasses(uint8_t n) {
+        nClasses_ = std::clamp<uint8_t>(n, 1, maxClasses);
+        slices_.clear();
+        cState_.reset();
+        return *this;
+    }
 
     /**
      * @brief timers to schedule a callback after some time
      *
-     * 'oneTime' schedules a non-cancelable callback, 'schedule' creates a cancelable/restartable
-     * timer. Note that this is expensive compared to a oneTime timer and oneTime should be used
-     * when the timer doesn't need to referenced.
+     * 'oneTime' schedules a non-cancelable callback, 'schedule' returns a handle that can
+     * cancel or restart the timer. Both come from the face's timer service and neither allocates.
      */
     auto schedule(std::chrono::microseconds after, TimerCb&& cb) const { return face_.schedule(after, std::move(cb)); }
     void oneTime(std::chrono::microseconds after, TimerCb&& cb) const { return face_.oneTime(after, std::move(cb)); }
 
+    /**
+     * @brief sketch of our active publications for estimating difference sizes
+     */
+    auto estimator() const noexcept {
+        Estimator est{};
+        for (const auto& [h, pe] : pubs_) if (pe.active()) est.add(h);
+        return est;
+    }
+
+    /**
+     * @brief Construct the name of a cState describing our publication set.
+     *
+     * cStates with the default size iblt have the form /<sync-prefix>/<own-IBF>
+     * (whatever the collection's size, so peers that never grow their iblt stay
+     * wire compatible). Larger iblts include their sub-table size as a SequenceNum
+     * component and, if our collection is big enough that peers might not be able
+     * to peel the difference, a difference estimator (Generic component) follows it.
+     * With topicFilter on, a filter of our subscriptions (Keyword component, see
+     * topic_filter.hpp) comes next and the iblts (own and class) only hold the pubs
+     * matching it, which is what a peer takes their difference with. With
+     * priorityClasses, the default size iblt of each class but the last (Segment
+     * component, the class number then the iblt) comes last before the iblt unless
+     * that would make the cState too big for the face's packets (see validCStateName for what a receiver accepts):
+     *   /<sync-prefix>[/<size>][/<estimator>][/<filter>][/<class-IBF>...]/<own-IBF>
+     *
+     * With neighborDeltas on, the newest of the peer's keyframes we have (Timestamp
+     * component) and the id of the keyframe (Version component) come before the
+     * iblt. A syncps without neighborDeltas drops cStates with more than three
+     * components after the collection name so, until the peer has sent us a keyframe
+     * id or ack, a keyframe only gets an id if that leaves it within the limit or
+     * it's every probeKeys'th keyframe (so two peers with big collections still find
+     * each other). Once the peer has acked one of our keyframes, and while the iblt changes
+     * since it are still in the journal and encode smaller than the iblt, the last
+     * component is a log of those changes (ByteOffset component, see changeLog)
+     * rather than the iblt. (The journal doesn't say which changes match a topic
+     * filter so a filtered cState is always a keyframe.)
+     */
+    crName cStateName() {
+        crName n{collName_};
+        if (ibltSize_ != IBLT<PubHash>::stsize) {
+            n = std::move(n)/uint64_t(ibltSize_);
+            if (pubs_.size() > IBLT<PubHash>::stsize) n = std::move(n)/estimator().encode();
+        }
+        const auto f = subscriptionFilter();
+        if (! f.empty()) n.append(tlv::Keyword, f).done();
+        std::array<uint8_t,IBLT<PubHash>::maxRLESize> rle;
+        auto sz = (f.empty()? pubs_.iblt(ibltSize_) : sliceFor(f, ibltSize_)).rlEncode(rle);
+        // the class iblts are left out if they'd make the cState too big for the face
+        std::array<std::array<uint8_t,IBLT<PubHash>::maxRLESize+1>,maxClasses-1> crle;
+        std::array<size_t,maxClasses-1> csz{};
+        size_t cbytes{};
+        for (uint8_t c = 0; c + 1 < nClasses_; ++c) {
+            crle[c][0] = c;
+            csz[c] = sliceFor(f, IBLT<PubHash>::stsize, c).rlEncode(std::span(crle[c]).subspan(1)) + 1;
+            cbytes += csz[c] + 4;
+        }
+        if (n.size() + cbytes + sz + cStateOverhead <= face_.getMaxPacketSize()) {
+            for (uint8_t c = 0; c + 1 < nClasses_; ++c) n.append(tlv::Segment, std::span(crle[c].data(), csz[c])).done();
+        }
+        if (! deltas_ || ! f.empty()) return std::move(n)/std::span(rle.data(), sz);
+
+        if (peerAck_) n.append(tlv::Timestamp, uint64_t(peerAck_)).done();
+        if (auto k = std::ranges::find(myKeys_, ackedKey_, &Keyframe::id_);
+                ackedKey_ && k != myKeys_.end() && k->stsize_ == ibltSize_) {
+            std::vector<uint8_t> log{};
+            if (changeLog(k->ibltGen_, log) && log.size() < sz) {
+                ++stats_.cStateDeltas;
+                n.append(tlv::Version, uint64_t(k->id_)).done();
+                n.append(tlv::ByteOffset, log).done();
+                return n;
+            }
+        }
+        if (! peerDeltas_ && n.nBlks() - collName_.nBlks() + 2 > oldCStateComps && unkeyed_++ % probeKeys != 0)
+            return std::move(n)/std::span(rle.data(), sz);
+        auto& k = myKeys_[nextKey_++ % myKeys_.size()];
+        k = {uint32_t(rand32()) | 1u, pubs_.ibltGen_, ibltSize_};
+        n.append(tlv::Version, uint64_t(k.id_)).done();
+        return std::move(n)/std::span(rle.data(), sz);
+    }
+
+    // A change log is a record per iblt change since a keyframe: an op byte (1 for an
+    // insert, 0xff for an erase) then the hash, little-endian. (A difference iblt would
+    // need negative counts, which the rle encoding can't carry.)
+    static constexpr size_t logRecSize = 1 + sizeof(PubHash);
+
+    // the log of pubs_'s iblt changes since change 'g' in 'log'. False if they're no longer in the journal.
+    bool changeLog(uint64_t g, std::vector<uint8_t>& log) const {
+        return pubs_.changesSince(g, [&log](PubHash h, bool inserted) {
+                    log.push_back(inserted? 1 : 0xff);
+                    for (size_t i = 0; i < sizeof(PubHash); ++i) log.push_back(uint8_t(h >> (i * 8)));
+                });
+    }
+
+    // apply change log 'log' to 'iblt'. False if the log is malformed.
+    static bool applyLog(std::span<const uint8_t> log, IBLT<PubHash>& iblt) {
+        if (log.size() % logRecSize) return false;
+        for (auto r = log.begin(); r != log.end(); r += logRecSize) {
+            PubHash h{};
+            for (size_t i = 0; i < sizeof(PubHash); ++i) h |= PubHash(r[1 + i]) << (i * 8);
+            if (*r == 1) iblt.insert(h);
+            else if (*r == 0xff) iblt.erase(h);
+            else return false;
+        }
+        return true;
+    }
+
+    // the keyframe id & ack components of cState 'name' (0 if absent)
+    std::pair<uint32_t,uint32_t> name2keys(const rNameIdx& name) const noexcept {
+        uint32_t key{}, ack{};
+        try {
+            for (auto i = collName_.nBlks(), e = name.nBlks() - 1; i < e; ++i) {
+                if (auto c = name[i]; c.isType(tlv::Version)) key = c.toNumber();
+                else if (c.isType(tlv::Timestamp)) ack = c.toNumber();
+            }
+        } catch (const std::exception& e) { }
+        return {key, ack};
+    }
+    bool isChangeLog(const rNameIdx& name) const noexcept { return name.last().isType(tlv::ByteOffset); }
+
+    const PeerKey* peerKey(uint32_t id) const noexcept {
+        auto k = std::ranges::find(peerKeys_, id, &PeerKey::id_);
+        return id && k != peerKeys_.end()? &*k : nullptr;
+    }
+
+    /**
+     * @brief neighborDeltas bookkeeping for a cState that has just arrived
+     *
+     * Its ack says which of our keyframes our next cStates can be logged against
+     * and, if it's a keyframe, it's kept (with the last few) as the base of the
+     * peer's change logs and acked in our cStates. A change log against a keyframe
+     * we don't have (e.g., we restarted) stops our acks so the peer goes back to
+     * sending keyframes.
+     */
+    void noteNeighbor(const rNameIdx& name) {
+        auto [key, ack] = name2keys(name);
+        if ((key || ack) && ! peerDeltas_) {
+            peerDeltas_ = true;
+            cState_.reset();
+        }
+        if (std::ranges::find(myKeys_, ack, &Keyframe::id_) == myKeys_.end()) ack = 0;
+        if (ack != ackedKey_) {
+            ackedKey_ = ack;
+            cState_.reset();
+        }
+        if (key == 0) return;
+        if (isChangeLog(name)) {
+            if (peerKey(key)) return;
+            ++stats_.cStateDeltaMiss;
+            if (peerAck_) {
+                peerAck_ = 0;
+                cState_.reset();
+                if (! delivering_) sendCStateSoon();
+            }
+            return;
+        }
+        if (! peerKey(key)) {
+            if (peerKeys_.size() >= myKeys_.size()) peerKeys_.erase(peerKeys_.begin());
+            auto& k = peerKeys_.emplace_back();
+            k.id_ = key;
+            name2iblt(name, k.iblt_);
+        }
+        if (peerAck_ != key) {
+            peerAck_ = key;
+            cState_.reset();
+        }
+    }
+
+    /**
+     * @brief check that 'name' has the form of a cState (see cStateName)
+     *
+     * A cState has one more component than the collection name (the iblt or a change
+     * log) and, between them, only the optional components cStateName adds: at most
+     * one each of the iblt size (which comes first), estimator, filter and neighborDeltas
+     * ack & keyframe id plus a class iblt for each class but the last. They're checked
+     * by type rather than counted since which of them a cState carries varies.
+     */
+    bool validCStateName(const rNameIdx& name) const noexcept {
+        const auto b = collName_.nBlks(), e = name.nBlks();
+        if (e <= b) return false;
+        try {
+            uint32_t seen{};
+            size_t classes{};
+            for (auto i = b; i + 1 < e; ++i) {
+                auto c = name[i];
+                if (c.isType(tlv::Segment)) {
+                    if (++classes > maxClasses - 1) return false;
+                    continue;
+                }
+                uint32_t bit{};
+                if (c.isType(tlv::SequenceNum)) bit = i == b? 1 : 0;
+                else if (c.isType(tlv::Generic)) {
+                    // must be an estimator (not, e.g., a component of a longer collection name)
+                    (void)Estimator::decode(c.rest());
+                    bit = 2;
+                }
+                else if (c.isType(tlv::Keyword)) bit = 4;
+                else if (c.isType(tlv::Timestamp)) bit = 8;
+                else if (c.isType(tlv::Version)) bit = 16;
+                if (bit == 0 || (seen & bit)) return false;
+                seen |= bit;
+            }
+            auto l = name.last();
+            return l.isType(tlv::Generic) || l.isType(tlv::ByteOffset);
+        } catch (const std::exception&) { }
+        return false;
+    }
+
+    /**
+     * @brief return our current cState with nonce 'nonce'
+     *
+     * The cState is only rebuilt when the collection or the iblt size has changed
+     * since the last one (e.g., not for the re-expressions done on interest timeout).
+     */
+    const crInterest& cState(Nonce nonce) {
+        if (cState_ && cStateGen_ == pubs_.generation() && cStateIBLTSize_ == ibltSize_) return cState_->nonce(nonce);
+        cState_.emplace(cStateName(), cStateLifetime_, nonce);
+        cStateGen_ = pubs_.generation();
+        cStateIBLTSize_ = ibltSize_;
+        return *cState_;
+    }
+
     /**
      * @brief Send a cState describing our publication set to our peers.
      *
-     * Creates & sends cState of the form: /<sync-prefix>/<own-IBF>
+     * Creates & sends cState named by cStateName()
      */
     void sendCState() {
         // if a cState is sent before the initial register is done the reply can't
         // reach us. don't send now since the register callback will do it.
         if (registering_) return;
 
-        scheduledCStateId_->cancel();
+        scheduledCStateId_.cancel();
         nonce_ = rand32();
-        face_.express(crInterest(collName_/pubs_.iblt().rlEncode(), cStateLifetime_, nonce_),
+        ++stats_.cStatesOut;
+        if (adaptive_) adapt();
+        face_.express(cState(nonce_),
                         [this](auto ri, auto rd) { // cAdd response to interest
                             // print("syncps received cAdd: {}\n", rd.name());
-                            if (! pktSigmgr_.validateDecrypt(rd)) {
+                            ++stats_.cAddsIn;
+                            // senders over their validation limit or blacklisted are ignored without doing any
+                            // crypto. Senders are known by their address (the cAdd's key locator isn't validated
+                            // yet) and only they are struck for invalid cAdds.
+                            cAddSrc_ = srcId();
+                            thumbPrint tp{};
+                            if (cAddLimiter_ && ! cAddLimiter_->allow(tp = cAddSrc_ != ValidateLimiter::anySigner? cAddSrc_ : signerOf(rd))) {
+                                ++stats_.cAddsLimited;
+                                if (ri.nonce() == nonce_) sendCStateSoon();
+                                return;
+                            }
+                            std::chrono::steady_clock::time_point t0{};
+                            if constexpr (Counter::enabled) {
+                                t0 = std::chrono::steady_clock::now();
+                                cAddRx_ = {face_.rxTime(), std::chrono::system_clock::now()};
+                                if (auto dt = cAddRx_.user_ - cAddRx_.kernel_; cAddRx_.kernel_ != decltype(cAddRx_.kernel_){} && dt.count() >= 0)
+                                    stats_.rxQueueUs.add(std::chrono::duration_cast<std::chrono::microseconds>(dt).count());
+                            }
+                            auto valid = pktSigmgr_.validateDecrypt(rd);
+                            if constexpr (Counter::enabled) stats_.cAddValidateUs.since(t0);
+                            if (cAddLimiter_ && cAddLimiter_->result(cAddSrc_, valid)) ++stats_.blacklisted;
+                            if (! valid) {
+                                ++stats_.cAddsInvalid;
                                 // print("syncps invalid cAdd: {}\n", rd.name());
                                 // Got an invalid cAdd so ignore the pubs it contains.  Need to reissue
                                 // our pending cState but delay a bit or we'll get the same thing again.
-                                // XXX may want to track & filter out bad actors to avoid DoS potential here.
                                 if (ri.nonce() == nonce_) sendCStateSoon();
                                 return;
                             }
@@ -353,57 +1116,293 @@ struct SyncPS {
                     );
     }
 
+    // start an adaptive timing round for the cState about to be sent and apply what
+    // the previous rounds showed
+    void adapt() {
+        adaptive_->cStateSent(nonce_);
+        face_.adaptDedWindow(collName_, adaptive_->dedWindow());
+        if (adaptive_->rounds_ == 0) return;
+        // the cached cState is only rebuilt for a lifetime change of more than 10%
+        auto lt = adaptive_->cStateLifetime();
+        if (auto d = lt - cStateLifetime_; d * 10 > cStateLifetime_ || -d * 10 > cStateLifetime_) {
+            cStateLifetime_ = lt;
+            cState_.reset();
+        }
+    }
+
     /**
      * @brief Send a cState after a random delay. If called again before timer expires
      * restart the time. (This is used to collect all the cAdds responding to a cState
      * before sending a new cState.)
      */
     void sendCStateSoon() {
-        scheduledCStateId_->cancel();
+        scheduledCStateId_.cancel();
         scheduledCStateId_ = schedule(std::chrono::milliseconds(randInt()), [this]{ sendCState(); });
     }
 
-    auto name2iblt(const rName& name) const noexcept {
+    // decode the cState's iblt into 'iblt' (reusing its storage). An invalid
+    // iblt decodes as an empty one of the default size. (A change log is applied to
+    // a copy of its keyframe, which handleCState has checked we have.)
+    void name2iblt(const rNameIdx& name, IBLT<PubHash>& iblt) const noexcept {
+        try {
+            // a sub-table size component is present if the cState iblt isn't the default size
+            size_t stsize{IBLT<PubHash>::stsize};
+            if (auto n = collName_.nBlks(); name.nBlks() > n + 1) {
+                if (auto c = name[n]; c.isType(tlv::SequenceNum)) stsize = c.toNumber();
+            }
+            if (isChangeLog(name)) {
+                auto k = peerKey(name2keys(name).first);
+                if (k && k->iblt_.subtableSize() == stsize) {
+                    iblt = k->iblt_;
+                    if (applyLog(name.last().rest(), iblt)) return;
+                }
+            } else {
+                iblt.reset(stsize).rlDecode(name.last().rest());
+                return;
+            }
+        } catch (const std::exception& e) { }
+        iblt.reset(IBLT<PubHash>::stsize);
+    }
+    auto name2iblt(const rNameIdx& name) const noexcept {
         IBLT<PubHash> iblt{};
-        try { iblt.rlDecode(name.last().rest()); } catch (const std::exception& e) { }
+        name2iblt(name, iblt);
         return iblt;
     }
 
+    // filter of our subscription prefixes for our cStates (empty if topicFilter is off or
+    // a subscription covers the whole collection)
+    std::vector<uint8_t> subscriptionFilter() const {
+        if (! topicFilter_ || subscriptions_.lt_.empty()) return {};
+        std::vector<std::span<const uint8_t>> pfx{};
+        for (const auto& [p, _] : subscriptions_.lt_) {
+            rPrefix rp{p};
+            if (rp.size() <= pubPfxLen_) return {};
+            pfx.emplace_back(rp.data(), rp.size());
+        }
+        return TopicFilter::make(pfx);
+    }
+
+    // return the cState's topic filter (empty if it doesn't have a valid one)
+    std::span<const uint8_t> name2filter(const rNameIdx& name) const noexcept {
+        try {
+            for (auto i = collName_.nBlks(), e = name.nBlks() - 1; i < e; ++i) {
+                if (auto c = name[i]; c.isType(tlv::Keyword)) {
+                    auto f = c.rest();
+                    return TopicFilter::valid(f)? f : std::span<const uint8_t>{};
+                }
+            }
+        } catch (const std::exception& e) { }
+        return {};
+    }
+    bool inFilter(std::span<const uint8_t> f, const rPub& p) const noexcept {
+        return f.empty() || TopicFilter::matches(f, p.name().rest(), pubPfxLen_);
+    }
+
+    // priority class of a pub with order key 'ord' (see orderKey & priorityClasses)
+    uint8_t classOf(uint64_t ord) const noexcept { return std::min<uint64_t>(ord >> 56, nClasses_ - 1); }
+
+    template<typename E>
+    bool inSlice(const TopicSlice& s, const E& e) const noexcept {
+        return (s.cls_ == anyClass || classOf(e.ord_) == s.cls_) && inFilter(s.filter_, e.i_);
+    }
+
+    // the iblt (of size 'stsize') of our active pubs matching topic filter 'f' and of
+    // priority class 'cls', brought up to date from the collection's journal or rebuilt
+    // if that isn't possible
+    const IBLT<PubHash>& sliceFor(std::span<const uint8_t> f, size_t stsize, uint8_t cls = anyClass) {
+        const auto& full = pubs_.iblt(stsize);  // (throws if the size isn't supported)
+        auto sl = std::ranges::find_if(slices_, [f, stsize, cls](const auto& s) {
+                        return s.iblt_.subtableSize() == stsize && s.cls_ == cls && std::ranges::equal(s.filter_, f); });
+        if (sl == slices_.end()) {
+            if (slices_.size() >= maxSlices) slices_.erase(std::ranges::min_element(slices_, {}, &TopicSlice::pass_));
+            sl = slices_.emplace(slices_.end());
+            sl->filter_.assign(f.begin(), f.end());
+            sl->cls_ = cls;
+            sl->ibltGen_ = ~0ull;
+        }
+        auto& s = *sl;
+        s.pass_ = peelPass_;
+        if (s.ibltGen_ == pubs_.ibltGen_) return s.iblt_;
+        bool ok = s.ibltGen_ != ~0ull && pubs_.changesSince(s.ibltGen_, [this, &s](PubHash h, bool inserted) {
+                    if (! inserted) {
+                        if (s.members_.erase(h)) s.iblt_.erase(h);
+                    } else if (auto p = pubs_.find(h); p != pubs_.end() && inSlice(s, p->second)) {
+                        if (s.members_.try_emplace(h, 0).second) s.iblt_.insert(h);
+                    }
+                });
+        if (! ok) {
+            s.iblt_.reset(full.subtableSize());
+            s.members_.clear();
+            for (const auto& [h, e] : pubs_) {
+                if (e.active() && inSlice(s, e)) {
+                    s.members_.try_emplace(h, 0);
+                    s.iblt_.insert(h);
+                }
+            }
+        }
+        s.ibltGen_ = pubs_.ibltGen_;
+        return s.iblt_;
+    }
+
+    // return the cState's difference estimator (if it has a valid one)
+    std::optional<Estimator> name2est(const rNameIdx& name) const noexcept {
+        try {
+            for (auto i = collName_.nBlks(), e = name.nBlks() - 1; i < e; ++i) {
+                if (auto c = name[i]; c.isType(tlv::Generic)) return Estimator::decode(c.rest());
+            }
+        } catch (const std::exception& e) { }
+        return std::nullopt;
+    }
+
+    // call 'f(class, rle)' for each of the cState's priority class iblts
+    template<typename F>
+    void forClassIBLTs(const rNameIdx& name, F&& f) const noexcept {
+        try {
+            for (auto i = collName_.nBlks(), e = name.nBlks() - 1; i < e; ++i) {
+                if (auto c = name[i]; c.isType(tlv::Segment) && c.rest().size() > 1) f(c.rest()[0], c.rest().subspan(1));
+            }
+        } catch (const std::exception& e) { }
+    }
+
+    /**
+     * @brief adapt the size of the iblt in our cState to the differences we see.
+     *
+     * A peer's cState that can't be completely peeled means our collections differ
+     * by more than its iblt holds so we move to the next larger size. Peers that see
+     * the larger iblt in our cState get a difference that fits and grow too if it
+     * doesn't fit in theirs. If the peer's cState has a difference estimate ('est')
+     * we go straight to the size that fits it. A run of differences that fit in a
+     * smaller iblt than we're using shrinks ours (one size at a time). Returns true
+     * if the iblt grew.
+     */
+    bool adjustIBLTSize(size_t peerSize, bool peeled, size_t ndiff, size_t est = 0) {
+        using I = IBLT<PubHash>;
+        auto want = peeled? I::sizeFor(ndiff) :
+                            std::max({I::largerSize(peerSize), I::sizeFor(est), ibltSize_});
+        if (want > ibltSize_) {
+            ibltSize_ = want;
+            smallDiffs_ = 0;
+            return true;
+        }
+        if (want == ibltSize_) smallDiffs_ = 0;
+        else if (++smallDiffs_ >= ibltShrinkAfter) {
+            ibltSize_ = I::smallerSize(ibltSize_);
+            smallDiffs_ = 0;
+        }
+        return false;
+    }
+
     void doDeliveryCb(PubHash hash, bool arrived) {
         auto cb = pubCbs_.find(hash);
         if (cb == pubCbs_.end()) return;
 
-        // there's a callback for this hash. do it if pub was ours and is still active
-        if (auto p = pubs_.find(hash); p != pubs_.end() && p->second.local()) (cb->second.i_)(p->second.i_, arrived);
+        // there's a callback for this hash. do it if pub was ours and is still active.
+        // The callback may publish (moving collection items) so it's moved out of
+        // pubCbs_ and handed a view of the pub rather than a reference into pubs_.
+        auto dcb = std::move(cb->second);
         pubCbs_.erase(hash);
+        if (auto p = pubs_.find(hash); p != pubs_.end() && p->second.local()) {
+            p->second.awaitConfirm(false);
+            dcb(rPub(p->second.i_), arrived);
+        }
     }
 
-    bool handleCState(const rName& name) {
+    bool handleCState(const rNameIdx& name) {
         //if a scheduleCAddId_ is set, cancel it
-        scheduledCAddId_->cancel(); // (should I only do this for a network cState?)
+        scheduledCAddId_.cancel(); // (should I only do this for a network cState?)
+        ++stats_.cStatesIn;
 
         // The last component of 'name' is the peer's iblt. 'Peeling'
         // the difference between the peer's iblt & ours gives two sets:
         //   have - (hashes of) items we have that they don't
         //   need - (hashes of) items we need that they have
         //
-        // pubCbs_ contains pubs that require delivery callbacks so which the peer already has.
         // pubs_ contains all pubs we have so send the ones we have & the peer doesn't.
-        auto iblt{name2iblt(name)};
-        if(pubCbs_.size()) {
-            // remove delivery confirmation pubs from our iblt to see which the peer has (will be in 'need' set)
-            for (const auto hash : (pubs_.iblt() - pubCbs_.iblt() - iblt).peel().second) doDeliveryCb(hash, true);
+        // Our pubs awaiting delivery confirmation (pubCbs_) that aren't in 'have' are ones
+        // the peer has so the one peel also confirms their delivery.
+        //
+        // The peer's iblt may be larger than the default so the difference is taken
+        // with our iblt of the same size.
+        //
+        // The iblt arithmetic is done in the scratch_ table and the results go in stack
+        // buffers so, once a cState is in peels_, none of this allocates. The peel is
+        // done before any delivery callbacks since a callback can publish which reenters here.
+        //
+        // A cState with a topic filter only describes the pubs matching it so the
+        // difference is taken with the matching slice of our collection (and the peel
+        // isn't cached since pubs_'s journal doesn't say which changes match).
+        //
+        // A change log whose keyframe we don't have says nothing about the peer's
+        // collection (see noteNeighbor) so it isn't answered.
+        if (isChangeLog(name) && ! peerKey(name2keys(name).first)) return false;
+        auto& pc = peelFor(name);
+        const auto& peer = pc.peer_;
+        const auto stsize = peer.subtableSize();
+        const auto filt = name2filter(name);
+        const auto& ours = filt.empty()? pubs_.iblt(stsize) : sliceFor(filt, stsize);
+        HashBuf have, need, delivered;
+        auto peeled = pc.peeled_ && filt.empty() && updatePeel(pc);
+        if (peeled) ++stats_.peelCached;
+        else {
+            pc.have_.clear();
+            pc.need_.clear();
+            peeled = scratch_.assignDiff(ours, peer).peelInPlace(pc.have_, pc.need_);
+            ++(peeled? stats_.peelOk : stats_.peelFail);
+            pc.peeled_ = peeled;
+            pc.ibltGen_ = pubs_.ibltGen_;
+        }
+        have = pc.have_;
+        need = pc.need_;
+        // (a pub the peer's cState doesn't cover, because of its topic filter, isn't confirmed)
+        if (peeled && pubCbs_.size()) {
+            for (const auto& [h, _] : pubCbs_) {
+                if (auto p = pubs_.find(h); p != pubs_.end() && p->second.awaitingConfirm() &&
+                    ! have.contains(h) && inFilter(filt, p->second.i_)) delivered.push_back(h);
+            }
+        }
+        size_t estDiff{};
+        if (! peeled) {
+            // The difference is too big for the peer's iblt. If the cState has an estimator
+            // use it to size our iblt and add the pubs it shows the peer lacks to 'have'.
+            if (auto est = name2est(name); est) {
+                auto ours = estimator();
+                estDiff = ours.estimate(*est);
+                for (auto h : ours) if (est->lacks(h) && ! have.contains(h)) have.push_back(h);
+            }
+            // The peer's priority class iblts can peel when the full difference doesn't
+            // (e.g., a bulk backlog) so the pubs of those classes still go out this round.
+            if (nClasses_ > 1) forClassIBLTs(name, [&](uint8_t c, std::span<const uint8_t> rle) {
+                    if (c + 1 >= nClasses_) return;
+                    try { clsPeer_.reset(IBLT<PubHash>::stsize).rlDecode(rle); } catch (const std::exception&) { return; }
+                    HashBuf ch, cn;
+                    if (! scratch_.assignDiff(sliceFor(filt, IBLT<PubHash>::stsize, c), clsPeer_).peelInPlace(ch, cn)) return;
+                    ++stats_.peelClass;
+                    for (auto h : ch) if (! have.contains(h)) have.push_back(h);
+                    for (auto h : cn) if (! need.contains(h)) need.push_back(h);
+                });
         }
-        auto [have, need] = (pubs_.iblt() - iblt).peel();
+        for (const auto hash : delivered) doDeliveryCb(hash, true);
+        if (adjustIBLTSize(stsize, peeled, have.size() + need.size(), estDiff) && !delivering_) sendCStateSoon();
         if (have.size() == 0) return false;
 
-        PubVec pv{}, pvOth{};    //vectors of publications I have, local or others
+        // the pubs we have go in pv (local) or pvOth (others') in priority order
+        cands_.clear();
         for (const auto hash : have) {
-            //if (const auto& p = pubs_.find(hash); p != pubs_.end()) pv.emplace_back(p->second.i_);
-            if (const auto& p = pubs_.find(hash); p != pubs_.end() ) {
-                if(p->second.local()) pv.emplace_back(p->second.i_);
-                else pvOth.emplace_back(p->second.i_);
-            }
+            if (const auto& p = pubs_.find(hash); p != pubs_.end() && inFilter(filt, p->second.i_)) cands_.emplace_back(p->second.ord_, hash);
+        }
+        std::sort(cands_.begin(), cands_.end());
+        if (quota_) quota_->interleave(cands_, [this](const auto& c) { return classOf(c.first); },
+                                       [this](const auto& c) { return signerOf(pubs_.at(c.second).i_.asView()); });
+        PubVec pv{}, pvOth{};    //vectors of publications I have, local or others
+        std::vector<PubHash> due{};     // others' pubs whose relay hold is over
+        const auto now = std::chrono::steady_clock::now();
+        for (const auto& [k, hash] : cands_) {
+            auto& e = pubs_.at(hash);
+            if (e.local()) pv.emplace_back(e.i_);
+            else if (relayHold_ > 0ms && relayDue(e, now)) {
+                pv.emplace_back(e.i_);
+                due.emplace_back(hash);
+            } else pvOth.emplace_back(e.i_);
         }
         if (pv.empty() && pvOth.empty()) return false;
 
@@ -413,34 +1412,196 @@ struct SyncPS {
         auto newPubs = orderPub_(pv,pvOth);    //order priority returns all pubs to send in pv
         if(pv.empty()) return false;
         auto othPubs = false;
-        // send all the pubs that will fit in a cAdd packet, always sending at least one.
-        if (pv.size() > 1) {
-            for (size_t i{}, psize{}; i < pv.size(); ++i) {
-                if (pv[i].size() > maxPubSize) {
-                    // print("pub {} too large: {} {}\n", i, pv[i].size(), pv[i].name());
+        // Send all the pubs that will fit in up to maxCAddBurst_ cAdd packets, always
+        // sending at least one pub per packet. (The cAdd's name is the cState's so a
+        // large iblt leaves less room for pubs.)
+        const size_t cs = cAddSize(), hdr = std::max(name.size(), maxCAddSize - maxPubSize);
+        const size_t space = cs > hdr? cs - hdr : 0;
+        std::vector<Publication> cAdds{};
+        for (size_t i{}; i < pv.size() && cAdds.size() < maxCAddBurst_; ) {
+            auto j = i;
+            for (size_t psize{}; j < pv.size(); ++j) {
+                if (pv[j].size() > maxPubSize) {
+                    // print("pub {} too large: {} {}\n", j, pv[j].size(), pv[j].name());
                     abort();
                 }
-                if ((psize += pv[i].size()) > maxPubSize) {
-                    if(pubs_.at(hashPub(pv[i])).fromNet())
-                        othPubs = true;
-                    pv.resize(i); break; }
+                psize += compactCAdds_? CAddCodec::entrySize(j > i? CAddCodec::nameValue(pv[j-1]) :
+                                                             std::span<const uint8_t>{}, pv[j]) : pv[j].size();
+                if (psize > space && j > i) break;
+            }
+            // note if the first pub that didn't fit in the last packet is from another node
+            if (j < pv.size() && cAdds.size() + 1 == maxCAddBurst_ && pubs_.at(hashPub(pv[j])).fromNet()) othPubs = true;
+            if (auto c = makeCAdd(name, PubVec(pv.begin() + i, pv.begin() + j)); c) {
+                cAdds.emplace_back(std::move(*c));
+                // only the relayed pubs that made it into the burst start a new hold
+                if (! due.empty()) for (auto k = i; k < j; ++k) relayed(due, hashPub(pv[k]), now);
             }
+            i = j;
         }
-        auto cAdd = crData{name, tlv::ContentType_CAdd}.content(pv);
+        if (cAdds.empty()) return true;
+
         // newPubs = true => there's a new local publication in this cAdd
         // othPubs =  true => there are publications from others in this cAdd
         if(newPubs | !othPubs) {   //both send and resend own with priority
-            if (pktSigmgr_.sign(cAdd)) face_.send(cAdd);
-        } else if (pktSigmgr_.sign(cAdd)) {   //delay sending others pubs (sign in lambda?)
+            sendCAdds(std::move(cAdds));
+        } else {                   //delay sending others pubs
             // schedule to send after a delay (cancel sending if new cState shows up)
-            scheduledCAddId_ = schedule(std::chrono::milliseconds(randInt()), [this,cAdd]{ face_.send(cAdd); });
+            scheduledCAddId_ = schedule(std::chrono::milliseconds(randInt()),
+                                        [this,cAdds]() mutable { sendCAdds(std::move(cAdds)); });
         }
         return true;
     }
 
+    /*
+     * Should another node's pub 'e', which a peer lacks, be resent now (see relayPubs)?
+     * The first time it's found lacking (or if it's been 10 holds since it last was)
+     * its hold starts. Once the hold is over it's resent and, if it fit in the
+     * cAdd burst, 'relayed' starts its next hold.
+     */
+    template<typename E>
+    bool relayDue(E& e, std::chrono::steady_clock::time_point now) noexcept {
+        if (e.rs_ == decltype(e.rs_){} || now - e.rs_ > 10 * relayHold_) {
+            e.rs_ = now + relayHold_;
+            return false;
+        }
+        return now >= e.rs_;
+    }
+    // pub 'h' has been put in a cAdd. If it's one of the 'due' relays, start its next hold.
+    void relayed(const std::vector<PubHash>& due, PubHash h, std::chrono::steady_clock::time_point now) noexcept {
+        if (std::ranges::find(due, h) == due.end()) return;
+        if (auto p = pubs_.find(h); p != pubs_.end()) {
+            p->second.rs_ = now + relayHold_;
+            ++stats_.pubsRelayed;
+        }
+    }
+    // someone sent pub 'h', which we have, so we don't need to resend it for a while
+    void heardPub(PubHash h) {
+        if (auto p = pubs_.find(h); p != pubs_.end() && p->second.fromNet())
+            p->second.rs_ = std::chrono::steady_clock::now() + relayHold_;
+    }
+
+    // name + content space of our cAdds: maxCAddSize plus however much more than a
+    // 1500 byte MTU packet the face's transport carries (e.g., with jumbo frames)
+    size_t cAddSize() const noexcept {
+        auto mp = face_.getMaxPacketSize();
+        return mp > Transport::defaultMaxPayload? maxCAddSize + (mp - Transport::defaultMaxPayload) : maxCAddSize;
+    }
+
+    /**
+     * @brief the signed cAdd named 'name' carrying 'pubs'
+     *
+     * handleCStates() is rerun over all the pending cStates each time the collection
+     * changes so a cState that hasn't been answered yet (e.g., its cAdd is being
+     * delayed) gets the same cAdd built again. A cAdd's name is its cState's name so
+     * this can't be shared between cStates but a copy of a recently signed cAdd with
+     * the same name and pubs is reused rather than paying for another signature. Copies
+     * are only reused for a cState lifetime so they can't outlive the packet signing key.
+     * The pubs are traced here, before signing, since an encrypting packet sigmgr
+     * leaves nothing parseable in the signed cAdd's content.
+     *
+     * @return the cAdd or nullopt if it couldn't be signed
+     */
+    std::optional<Publication> makeCAdd(const rName& name, PubVec&& pubs) {
+        std::vector<PubHash> hv{};
+        hv.reserve(pubs.size());
+        for (const auto& p : pubs) hv.emplace_back(hashPub(p));
+        auto now = std::chrono::steady_clock::now();
+        for (auto& c : cAddCache_) {
+            if (c.pubs_ == hv && now - c.t_ < cStateLifetime_ && c.cAdd_.name() == name) {
+                ++stats_.cAddsReused;
+                traceSent(pubs, hv);
+                return c.cAdd_;
+            }
+        }
+        auto cAdd = compactCAdds_? crData{name, tlv::ContentType_CAddCompact}.content(CAddCodec::encode(pubs)) :
+                                   crData{name, tlv::ContentType_CAdd}.content(pubs);
+        std::chrono::steady_clock::time_point t0{};
+        if constexpr (Counter::enabled) t0 = std::chrono::steady_clock::now();
+        if (! pktSigmgr_.sign(cAdd)) return std::nullopt;
+        if constexpr (Counter::enabled) stats_.cAddSignUs.since(t0);
+        auto& c = cAddCache_[cAddCacheNext_++ % cAddCache_.size()];
+        c.t_ = now;
+        c.pubs_ = std::move(hv);
+        c.cAdd_ = cAdd;
+        traceSent(pubs, c.pubs_);
+        return cAdd;
+    }
+
+    void traceSent(const PubVec& pubs, const std::vector<PubHash>& hv) const noexcept {
+        if (trace_) for (size_t i = 0; i < pubs.size(); ++i) trace(TraceEv::send, hv[i], pubs[i]);
+    }
+
+    // send the cAdd(s) answering a cState. Multiple cAdds go out as a paced burst.
+    void sendCAdds(std::vector<Publication>&& cAdds) {
+        stats_.cAddsOut += cAdds.size();
+        if (cAdds.size() == 1) face_.send(cAdds.front());
+        else face_.send(std::move(cAdds), cAddGap_);
+    }
+
+    static bool isCompact(const rData& cAdd) noexcept {
+        try { return cAdd.contentType() == uint8_t(tlv::ContentType_CAddCompact); } catch (const std::exception&) { }
+        return false;
+    }
+
+    // the peels_ entry for cState 'name', decoding its iblt if it's new
+    CStatePeel& peelFor(const rNameIdx& name) {
+        auto nb = name.rest();
+        for (auto& p : peels_) {
+            if (std::ranges::equal(p.name_, nb)) {
+                p.pass_ = peelPass_;
+                return p;
+            }
+        }
+        if (peels_.size() >= maxPeels) {
+            peels_.erase(std::ranges::min_element(peels_, {}, &CStatePeel::pass_));
+        }
+        auto& p = peels_.emplace_back();
+        p.name_.assign(nb.begin(), nb.end());
+        p.pass_ = peelPass_;
+        name2iblt(name, p.peer_);
+        return p;
+    }
+
+    // apply the pubs_ iblt changes since 'pc' was peeled to its have & need sets. Returns
+    // false if that isn't possible (the journal has wrapped or a set would overflow).
+    bool updatePeel(CStatePeel& pc) {
+        bool ok = pubs_.changesSince(pc.ibltGen_, [&pc](PubHash h, bool inserted) {
+                    // an insert is a pub peer may lack unless it's one they have & we needed
+                    auto [from, to] = inserted? std::tie(pc.need_, pc.have_) : std::tie(pc.have_, pc.need_);
+                    if (! from.erase(h) && ! to.push_back(h)) pc.peeled_ = false;
+                });
+        if (! ok || ! pc.peeled_) return pc.peeled_ = false;
+        pc.have_.sortUnique();
+        pc.need_.sortUnique();
+        pc.ibltGen_ = pubs_.ibltGen_;
+        return true;
+    }
+
+    // A delivery callback run by handleCState can publish, which reruns handleCStates,
+    // and the cAdds that sends erase PIT entries, possibly the one a walk of the PIT
+    // is at. So a pass requested while cStates are being handled is done after the
+    // current one finishes.
     bool handleCStates() {
+        if (handling_) {
+            rehandle_ = true;
+            return false;
+        }
         bool res{false};
-        for (const auto& n : face_.pendingInterests(collName_)) res |= handleCState(n);
+        handling_ = true;
+        do {
+            rehandle_ = false;
+            ++peelPass_;
+            // the walk covers every pending interest under our name so skip any that
+            // aren't one of our cStates (e.g., another collection's nested below ours)
+            face_.forPendingInterests(collName_, [this, &res](const rInterest& i) {
+                    if (rNameIdx n{i.name()}; validCStateName(n)) res |= handleCState(n);
+                });
+            // drop the peels of cStates that are no longer pending
+            std::erase_if(peels_, [this](const auto& p) { return p.pass_ != peelPass_; });
+            // (the class slices used to build our cStates are kept)
+            std::erase_if(slices_, [this](const auto& s) { return s.pass_ != peelPass_ && ! (s.filter_.empty() && s.cls_ != anyClass); });
+        } while (rehandle_);
+        handling_ = false;
         return res;
     }
 
@@ -454,36 +1615,125 @@ struct SyncPS {
      * @param cState   cState for which we got the cAdd
      * @param cAdd     cAdd content
      */
-    void onCAdd(const rInterest& /*cState*/, const rData& cAdd) {
+    void onCAdd(const rInterest& cState, const rData& cAdd) {
+
+        // collect the pubs we don't have then validate them (in parallel if
+        // there's a validation pool, in the background if there's a crypto pool)
+        // before adding & delivering them in order.
+        cAddPubs_.clear();
+        cAddHashes_.clear();
+        auto content = cAdd.content();
+        if (isCompact(cAdd)) {
+            // rebuild the canonical pubs (cAddExp_ holds them until the next cAdd)
+            if (! CAddCodec::decode(content.rest(), cAddExp_)) {
+                ++stats_.cAddsInvalid;
+                return;
+            }
+            content = tlvParser(cAddExp_, 0U);
+        }
+        // the cAdd's pubs are hashed together (see IBLT::hashobjs) and each hash is
+        // carried through to the pub's collection entry
+        cAddAll_.clear();
+        for (auto c : content) {
+            if (! c.isType(tlv::Data)) continue;
+            if (rData d(c); d.indexBlks().valid()) cAddAll_.emplace_back(d);
+        }
+        cAddAllHashes_.resize(cAddAll_.size());
+        IBLT<PubHash>::hashobjs(std::span<const rData>(cAddAll_), cAddAllHashes_.data());
+        const size_t npubs = cAddAll_.size();
+        for (size_t i = 0; i < npubs; ++i) {
+            const auto& d = cAddAll_[i];
+            const auto h = cAddAllHashes_[i];
+            // pubs we have or have already rejected cost one lookup
+            if (pubs_.contains(h) || rejected_.contains(h)) {
+                // print("syncps: pub dup or rejected: {}\n", d.name());
+                ++stats_.pubsDup;
+                if (relayHold_ > 0ms) heardPub(h);
+                continue;
+            }
+            // pubs whose signer is over its limit, or that came from a sender blacklisted for
+            // invalid pubs, are skipped (not rejected) so they'll be validated when they arrive
+            // in a later cAdd
+            if (pubLimiter_ && (pubLimiter_->blacklisted(cAddSrc_) || ! pubLimiter_->allow(signerOf(d)))) {
+                ++stats_.pubsLimited;
+                continue;
+            }
+            if (trace_) trace(TraceEv::receive, h, d);
+            DCT_PUB_PROBE(receive, h, d);
+            cAddPubs_.emplace_back(d);
+            cAddHashes_.emplace_back(h);
+        }
+        stats_.cAddPubs.add(npubs);
+        // (responders are told apart by where their cAdds came from since, with a keyless
+        // packet sigmgr, every cAdd has the same signer)
+        if (adaptive_) adaptive_->cAdd(cState.nonce(), cAddSrc_ != ValidateLimiter::anySigner? cAddSrc_ : signerOf(cAdd),
+                                       cAddPubs_.empty());
+        if (crypto_ && ! cAddPubs_.empty()) {
+            validatePubsAsync();
+            return;
+        }
+        if constexpr (Counter::enabled) {
+            auto t0 = std::chrono::steady_clock::now();
+            validatePubs();
+            if (! cAddPubs_.empty()) stats_.validateUs.since(t0);
+        } else {
+            validatePubs();
+        }
+        addPubs(cAddPubs_, cAddHashes_, pubOk_);
+    }
+
+    /**
+     * @brief add the validated pubs of a cAdd to the collection and deliver them
+     *
+     * @param pubs  the cAdd's new pubs
+     * @param hash  hash[i] is the hash of pubs[i]
+     * @param ok    ok[i] is non-zero if pubs[i] is unexpired and validated
+     */
+    template<typename Pubs>
+    void addPubs(const Pubs& pubs, std::span<const PubHash> hash, std::span<const uint8_t> ok) {
 
         // if publications result from handling this cAdd we don't want to
         // respond to a peer's cState until we've handled all of them.
         delivering_ = true;
         auto initpubs = publications_;
 
-        for (auto c : cAdd.content()) {
-            if (! c.isType(tlv::Data)) continue;
-            rData d(c);
-            if (! d.valid() || pubs_.contains(d)) {
-                // print("syncps: pub invalid or dup: {}\n", d.name());
-                continue;
-            }
-            if (isExpired_(d) || ! pubSigmgr_.validate(d)) {
+        for (size_t i = 0; i < pubs.size(); ++i) {
+            const rData& d = pubs[i];
+            const auto h = hash[i];
+            if (pubs_.contains(h) || rejected_.contains(h)) { ++stats_.pubsDup; continue; } // dup within this cAdd
+            // (a pub that fails validation may not be from the signer it claims so it's the
+            // sender of its cAdd that's struck)
+            if (pubLimiter_ && ! isExpired_(d) && pubLimiter_->result(ok[i]? signerOf(d) : cAddSrc_, ok[i])) ++stats_.blacklisted;
+            if (! ok[i]) {
+                ++stats_.pubsInvalid;
                 // print("pub {}: {}\n", isExpired_(d)? "expired":"failed validation", d.name());
                 // unwanted pubs have to go in our iblt or we'll keep getting them
-                ignorePub(d);
+                ignorePub(h);
+                continue;
+            }
+            // a signer over its quota doesn't get more pubs in (and they go in our iblt
+            // so peers stop offering them)
+            if (quota_ && ! quota_->admit(signerOf(d))) {
+                ++stats_.pubsOverQuota;
+                ignorePub(h);
                 continue;
             }
 
             // we don't already have this publication so add it to the
             // collection then deliver it to the longest match subscription.
-            if (addToActive(crData(d), false) == 0) {
+            if (addToActive(slabs_? slabs_->store(d, getLifetime_(d) + pubExpirationGB_) : sharedPub(d), false, h) == 0) {
                 // print("addToActive failed: {}\n", d.name());
                 continue;
             }
-            if (auto s = subscriptions_.findLM(d.name()); subscriptions_.found(s)) deliver(d, s->second);
+            ++stats_.pubsNew;
+            if (auto s = subscriptions_.findLM(d.name()); subscriptions_.found(s)) {
+                deliver(d, s->second);
+                noteDeliveryLatency(d);
+            }
             // else print("syncps::onCAdd: no subscription for {}\n", d.name());
         }
+        // the receive times were this cAdd's so they mustn't be attributed to later pubs
+        cAddRx_ = {};
 
         // We've delivered all the publications in the cAdd.  There may be
         // additional in-bound cAdds for the same cState so sending an updated
@@ -497,18 +1747,194 @@ struct SyncPS {
         sendCStateSoon();
     }
 
+    // 'f' on each active pub under 'pfx' accepted by 'keep' (see scanPubs)
+    template<typename Keep, typename F>
+    size_t scan(const rPrefix& pfx, Keep&& keep, F& f) const {
+        size_t n{};
+        pubs_.forPrefix(pfx, [this, &keep, &f, &n](PubHash h) {
+                    const auto& e = pubs_.at(h);
+                    if (! e.active() || ! keep(e.i_.asView())) return true;
+                    ++n;
+                    return scanCall(f, e.i_.asView());
+                });
+        return n;
+    }
+
+    // id of the sender of the packet being delivered for the validation limiters: its address
+    // & port (anySigner if the transport doesn't say). Unlike a key locator, a packet that
+    // hasn't been validated can't forge it.
+    thumbPrint srcId() const noexcept {
+        thumbPrint id{};
+        const auto& f = face_.rxFrom();
+        if (f.sin6_family == 0) return id;
+        std::memcpy(id.data(), &f.sin6_addr, sizeof(f.sin6_addr));
+        std::memcpy(id.data() + sizeof(f.sin6_addr), &f.sin6_port, sizeof(f.sin6_port));
+        id.back() = 1;  // (never anySigner)
+        return id;
+    }
+
+    // signer thumbprint of 'p' for the validation limiters (anySigner if it doesn't have one)
+    static thumbPrint signerOf(const rData& p) noexcept {
+        try { return p.thumbprint(); } catch (...) { return ValidateLimiter::anySigner; }
+    }
+
+    // report a pub lifecycle event (a trace callback mustn't throw into syncps)
+    void trace(TraceEv e, PubHash h, const rPub& p) const noexcept {
+        try { trace_(e, h, p); } catch (const std::exception&) { }
+    }
+
+    // record the time from a pub's creation (its timestamp) to its delivery and, if the
+    // kernel receive time of its cAdd is known, how that splits between the network
+    // (including the sender), queueing and our processing
+    void noteDeliveryLatency(const rPub& p) noexcept {
+        if constexpr (Counter::enabled) {
+            using std::chrono::microseconds, std::chrono::duration_cast;
+            try {
+                auto now = std::chrono::system_clock::now();
+                auto ts = p.name().last().toTimestamp();
+                if (auto dt = now - ts; dt.count() >= 0) stats_.deliveryUs.add(duration_cast<microseconds>(dt).count());
+                if (cAddRx_.kernel_ == decltype(cAddRx_.kernel_){}) return;
+                if (auto dt = cAddRx_.kernel_ - ts; dt.count() >= 0) stats_.netUs.add(duration_cast<microseconds>(dt).count());
+                if (auto dt = now - cAddRx_.user_; dt.count() >= 0) stats_.processUs.add(duration_cast<microseconds>(dt).count());
+            } catch (const std::exception&) { }
+        }
+    }
+
+    /**
+     * @brief set pubOk_[i] to whether cAddPubs_[i] is unexpired and validates
+     *
+     * Expiration is checked on the io thread (its callback belongs to the app) and
+     * the signature & structure checks of unexpired pubs are done as a batch
+     * (see SigMgr::validateBatch) or, if there's a validation pool, as small
+     * sub-batches spread over the pool. The pool threads only read sigmgr & cert state
+     * which can't change until the io thread resumes.
+     */
+    void validatePubs() {
+        auto n = cAddPubs_.size();
+        pubOk_.assign(n, 0);
+        for (size_t i = 0; i < n; ++i) pubOk_[i] = ! isExpired_(cAddPubs_[i]);
+        if (! validators_) {
+            pubSigmgr_.validateBatch(cAddPubs_, pubOk_);
+            return;
+        }
+        // each thread validates a sub-batch
+        static constexpr size_t chunk = 4;
+        validators_->run((n + chunk - 1) / chunk, [this, n](size_t c) {
+                auto b = c * chunk, l = std::min(n - b, chunk);
+                pubSigmgr_.validateBatch(std::span(cAddPubs_).subspan(b, l), std::span(pubOk_).subspan(b, l));
+            });
+    }
+
+    /**
+     * @brief validate cAddPubs_ using the crypto pool
+     *
+     * The cAdd is gone when onCAdd returns so its new pubs are copied and handed
+     * to the pool (expiration is checked here, on the io thread). While they're
+     * being validated the io thread carries on with other packets. Completions
+     * can arrive out of order so each cAdd waits in pendingCAdds_ until those
+     * received before it have been added then its pubs are added & delivered.
+     */
+    void validatePubsAsync() {
+        auto n = cAddPubs_.size();
+        std::vector<crData> pubs{};
+        pubs.reserve(n);
+        std::vector<uint8_t> ok(n);
+        for (size_t i = 0; i < n; ++i) {
+            pubs.emplace_back(cAddPubs_[i]);
+            ok[i] = ! isExpired_(cAddPubs_[i]);
+        }
+        auto seq = cAddSeq_++;
+        auto& pend = pendingCAdds_.emplace_back(seq);
+        pend.hashes_ = cAddHashes_;
+        if constexpr (Counter::enabled) {
+            pend.t0_ = std::chrono::steady_clock::now();
+            pend.rx_ = cAddRx_;
+        }
+        pend.src_ = cAddSrc_;
+
+        pubSigmgr_.validateAsync(*crypto_, std::move(pubs), std::move(ok),
+                [this, seq](std::vector<crData>&& pubs, std::vector<uint8_t>&& ok) {
+                    if (pendingCAdds_.empty() || seq < pendingCAdds_.front().seq_) return;
+                    auto& p = pendingCAdds_[seq - pendingCAdds_.front().seq_];
+                    p.pubs_ = std::move(pubs);
+                    p.ok_ = std::move(ok);
+                    p.done_ = true;
+                    while (! pendingCAdds_.empty() && pendingCAdds_.front().done_) {
+                        auto c = std::move(pendingCAdds_.front());
+                        pendingCAdds_.pop_front();
+                        stats_.validateUs.since(c.t0_);
+                        cAddRx_ = c.rx_;
+                        cAddSrc_ = c.src_;
+                        addPubs(c.pubs_, c.hashes_, c.ok_);
+                    }
+                });
+    }
+
+    /**
+     * @brief methods to manage the collection's on-disk snapshot
+     *
+     * Pubs are appended to the snapshot as they're added and the appends of a
+     * pass (e.g., a cAdd's pubs or a publishBatch) are written together after it.
+     * The snapshot is rewritten with just the active pubs when it gets much bigger
+     * than that. A write error (e.g., a full disk) turns the snapshot off rather
+     * than disrupting sync.
+     */
+    void snapAppend(const rData& p) {
+        if (! snap_->pending()) boost::asio::post(face_.getIoContext(), [this]{ snapFlush(); });
+        snap_->append(p);
+    }
+    void snapFlush() {
+        if (! snap_ || ! snap_->pending()) return;
+        if (! snap_->flush()) return snapOff();
+        if (snap_->size() > 2 * snapLive_ + 1024*1024) snapRewrite();
+    }
+    void snapRewrite() {
+        std::vector<rData> pv{};
+        for (const auto& [h, pe] : pubs_) if (pe.active()) pv.emplace_back(pe.i_);
+        if (! snap_->rewrite(pv)) return snapOff();
+        snapLive_ = snap_->size();
+    }
+    void snapOff() {
+        print("syncps: snapshot of {} disabled: {}\n", collName_, snap_->error());
+        snap_.reset();
+    }
+
+    /*
+     * Add the unexpired pubs loaded from the snapshot to the collection and
+     * deliver them to their subscriptions. This is done by start() since the
+     * keys needed to validate them are generally not available until then.
+     */
+    void restoreSnapshot() {
+        if (! snap_) return;
+        auto pubs = std::move(snapPubs_);
+        auto snap = std::move(snap_);   // don't re-append the restored pubs
+        auto wasDelivering = std::exchange(delivering_, true);
+        for (auto& p : pubs) {
+            if (pubs_.contains(p) || isExpired_(p) || ! pubSigmgr_.validate(p)) continue;
+            rData d{p};
+            if (addToActive(std::move(p), false) == 0) continue;
+            if (auto s = subscriptions_.findLM(d.name()); subscriptions_.found(s)) deliver(d, s->second);
+        }
+        delivering_ = wasDelivering;
+        snap_ = std::move(snap);
+        snapRewrite();
+    }
+
     /**
      * @brief Methods to manage the active publication set.
      */
 
     /*
      * @brief ignore a publication by temporarily adding it to the our iblt
-     * XXX fix to add hash to pubs_ so dups can be recognized
+     *
+     * Its hash is also held in a negative cache until it's removed from the
+     * iblt so copies that arrive from other peers are discarded without being
+     * re-checked (and aren't added to the iblt twice).
      */
-    void ignorePub(const rPub& pub) {
-        auto hash = hashPub(pub);
-        pubs_.iblt().insert(hash);
-        oneTime(pubLifetime_ + maxClockSkew, [this, hash] { pubs_.iblt().erase(hash); });
+    void ignorePub(PubHash hash) {
+        if (! rejected_.try_emplace(hash, 0).second) return;
+        pubs_.ibltInsert(hash);
+        pubEvents_.add(pubLifetime_ + maxClockSkew, {hash, PubEv::unignore});
     }
 
     /**
@@ -525,46 +1951,288 @@ struct SyncPS {
      * after 'run()' is called (the default) or if it will be called explicitly
      */
     void start() {
+        restoreSnapshot();
         face_.addToRIT(collName_,
-                       [this, ncomp = collName_.nBlks()+1](auto /*prefix*/, auto i) {
-                           // cState must have one more name component (an iblt) than the collection name
-                           if (auto n = i.name(); n.nBlks() == ncomp) handleCState(n);
+                       [this](auto /*prefix*/, auto i) {
+                           rNameIdx n{i.name()};
+                           if (! validCStateName(n)) return;
+                           if (deltas_) noteNeighbor(n);
+                           handling_ = true;
+                           handleCState(n);
+                           handling_ = false;
+                           if (rehandle_) handleCStates();
                        },
                        [this](rName) -> void { registering_ = false; sendCState(); });
     }
 
     auto& autoStart(bool yesNo) { autoStart_ = yesNo; return *this; }
 
+    /**
+     * @brief the collection's performance counters
+     *
+     * The counters can be read from any thread. 'statsStr' is a printable summary
+     * of them and of the collection's (and face's) table sizes so it has to be
+     * called from the face's thread, e.g., periodically via 'statsEvery'.
+     */
+    const auto& stats() const noexcept { return stats_; }
+    std::string statsStr() const {
+        auto s = format("{}: {}\n  pubs {} pubCbs {} rejected {}\n  face: {}", collName_, stats_.str(),
+                        pubs_.size(), pubCbs_.size(), rejected_.size(), face_.statsStr());
+        if (adaptive_) s += "\n  timing: " + adaptive_->str();
+        return s;
+    }
+    auto& statsEvery(std::chrono::milliseconds interval, ofats::any_invocable<void(const std::string&)>&& cb) {
+        face_.every(interval, [this, cb=std::move(cb)]() mutable { cb(statsStr()); });
+        return *this;
+    }
+
+    /**
+     * @brief add the memory used by the collection to 'r' (see mem_report.hpp)
+     *
+     * A pub's buffer is counted in each collection holding it (relays share them).
+     * Call from the face's thread.
+     */
+    void memUse(MemReport& r) const {
+        auto nm = format("{}", collName_);
+        size_t b = pubs_.heapBytes() + mem::vec(pubs_.iblts_);
+        for (const auto& [_, e] : pubs_) b += e.i_.size() + sizeof(crData) + 2 * mem::node;
+        r.add(nm + " pubs", pubs_.size(), b);
+        if (slabs_) r.add(nm + " open pub slabs", slabs_->open_.size(), slabs_->openBytes());
+        b = pubCbs_.heapBytes() + subscriptions_.heapBytes() + rejected_.heapBytes() +
+            mem::vec(cAddPubs_) + mem::vec(cAddHashes_) + mem::vec(cAddAll_) + mem::vec(cAddAllHashes_) +
+            mem::vec(pubOk_) + mem::vec(snapPubs_);
+        for (const auto& c : cAddCache_) b += mem::vec(c.pubs_) + c.cAdd_.size();
+        for (const auto& p : pendingCAdds_) {
+            b += mem::vec(p.pubs_) + mem::vec(p.hashes_) + mem::vec(p.ok_);
+            for (const auto& d : p.pubs_) b += d.size();
+        }
+        for (const auto& d : snapPubs_) b += d.size();
+        r.add(nm + " cbs, subs & scratch", pubCbs_.size() + subscriptions_.lt_.size() + rejected_.size(), b);
+    }
+
     /**
      * @brief start running the event manager main loop (use stop() to return)
      */
-    void run() { getDefaultIoContext().run(); }
+    void run() { face_.run(); }
 
     /**
      * @brief stop the running the event manager main loop
      */
-    void stop() { getDefaultIoContext().stop(); }
+    void stop() { face_.getIoContext().stop(); }
 
     /**
      * @brief methods to change callbacks
      */
     auto& getLifetimeCb(GetLifetimeCb&& getLifetime) { getLifetime_ = std::move(getLifetime); return *this; }
     auto& isExpiredCb(IsExpiredCb&& isExpired) { isExpired_ = std::move(isExpired); return *this; }
+    // call 'cb' at each point in a pub's life (see pub_trace.hpp). Null turns tracing off.
+    auto& traceCb(TraceCb&& cb) { trace_ = std::move(cb); return *this; }
     auto& orderPubCb(OrderPubCb&& orderPub) { orderPub_ = std::move(orderPub); return *this; }
 
+    /**
+     * @brief also answer cStates with other nodes' pubs (multi-hop delivery)
+     *
+     * Normally only the pubs this node published are sent in answer to a cState.
+     * With a non-zero 'hold' another node's pub is also sent once a peer has been
+     * lacking it for 'hold', which gives its origin and nodes nearer the peer the
+     * chance to answer first. The pub isn't resent for another 'hold' and hearing
+     * someone else send it restarts the hold so each pub gets few duplicates. About
+     * a cState lifetime suits peers that are a hop apart. 0 turns resending off.
+     */
+    auto& relayPubs(std::chrono::milliseconds hold) { relayHold_ = hold; return *this; }
+    auto& pubPriorityCb(PubPriorityCb&& pubPriority) {
+        pubPriority_ = std::move(pubPriority);
+        for (auto& [h, e] : pubs_) e.ord_ = orderKey(e.i_);
+        slices_.clear();    // (class slices depend on the priorities)
+        cState_.reset();
+        return *this;
+    }
+
     /**
      * @brief methods to change various timer values
      */
-    auto& cStateLifetime(std::chrono::milliseconds time) { cStateLifetime_ = time; return *this; }
+    auto& cStateLifetime(std::chrono::milliseconds time) { cStateLifetime_ = time; cState_.reset(); return *this; }
+
+    /**
+     * @brief adapt the response delays, the face's deferred delete window and the
+     * cState lifetime to the observed number of peers, cAdd arrival spread and RTT,
+     * keeping them within 'lim' (see adaptive_timing.hpp). cStateLifetime() sets
+     * the lifetime until the first cState is answered.
+     */
+    auto& adaptiveTiming(AdaptiveTiming::Limits lim = {}) { adaptive_ = std::make_unique<AdaptiveTiming>(lim); return *this; }
+    // the adaptive timing state (null if adaptiveTiming wasn't called)
+    const AdaptiveTiming* adaptiveStats() const noexcept { return adaptive_.get(); }
 
     auto& pubLifetime(std::chrono::milliseconds time) { pubLifetime_ = time; return *this; }
 
+    /**
+     * @brief keep the pubs that arrive from the network in slabs shared by the pubs
+     * that will be erased in the same 'epoch' rather than in a buffer per pub (see
+     * pub_slab.hpp). This keeps the heap of a long-running device from fragmenting.
+     */
+    auto& pubSlabs(std::chrono::milliseconds epoch = std::chrono::milliseconds(250)) {
+        slabs_ = std::make_unique<PubSlabs>(epoch);
+        return *this;
+    }
+
+    /**
+     * @brief don't send a cState if a peer sent one with the same iblt less than
+     * 'w' ago (it's answered by the same cAdds as ours would be). Large multicast
+     * segments then carry one copy of a collection's cState per round rather than
+     * one per member. 'w' should be well under the peers' cState lifetime.
+     */
+    auto& cStateSuppress(std::chrono::milliseconds w) { face_.suppressWindow(w); return *this; }
+
+    /**
+     * @brief answer each cState with up to 'n' cAdds sent 'gap' apart
+     *
+     * A peer that's far behind (e.g., after a partition) can then catch up in
+     * one cState round rather than one round per packet of pubs. The face's
+     * deferred delete window is extended to collect the whole burst. (Peers
+     * should use the same burst setting since the receiver's face window is
+     * what lets it accept the burst.)
+     */
+    auto& cAddBurst(uint8_t n, std::chrono::microseconds gap = 2ms) {
+        maxCAddBurst_ = n > 0? n : 1;
+        cAddGap_ = gap;
+        face_.dedWindow(std::chrono::duration_cast<std::chrono::milliseconds>(gap * (maxCAddBurst_ - 1)) + 30ms);
+        return *this;
+    }
+
+    /**
+     * @brief keep a snapshot of the collection's pubs in file 'path'
+     *
+     * If the file exists, the pubs it holds are reloaded when the collection is
+     * started (unexpired pubs that still validate are added to the collection and
+     * delivered to subscriptions as if they'd just arrived) so a restarted process
+     * doesn't have to re-pull them from its peers. Must be called before start().
+     */
+    auto& snapshot(const std::string& path) {
+        snap_ = std::make_unique<PubStore>(path);
+        snapPubs_.clear();
+        snap_->load([this](rData d){ snapPubs_.emplace_back(d); });
+        snapLive_ = snap_->size();
+        return *this;
+    }
+
+    /**
+     * @brief validate the pubs of each arriving cAdd using 'n' threads in addition
+     * to the io thread (0 validates them serially on the io thread, the default).
+     * Adding pubs to the collection and subscription callbacks are unaffected:
+     * they're done on the io thread, in cAdd order, after validation.
+     */
+    auto& validateThreads(size_t n) {
+        validators_.reset();
+        if (n > 0) validators_ = std::make_unique<WorkerPool>(n);
+        return *this;
+    }
+
+    /**
+     * @brief sign (publishAsync) and validate (arriving cAdds) pubs using the threads
+     * of 'pool' (nullptr does them on the io thread, the default). The pool can be
+     * shared by several collections as long as they use the same io_context.
+     */
+    auto& cryptoPool(std::shared_ptr<CryptoPool> pool) {
+        crypto_ = std::move(pool);
+        return *this;
+    }
+
+    /**
+     * @brief send cAdds whose pub names are delta-encoded against the previous pub's
+     * (see cadd_codec.hpp) so more pubs fit in each. Compact cAdds are always accepted
+     * but peers running an older syncps can't decode them so sending them is off
+     * by default.
+     */
+    auto& compactCAdds(bool on) {
+        compactCAdds_ = on;
+        return *this;
+    }
+
+    /**
+     * @brief on a link with a single peer (e.g., a TransportUdpA/P point-to-point link),
+     * send the changes to our iblt since one the peer has rather than the iblt
+     *
+     * Full cStates become keyframes with an id the peer acks in its cStates. Once
+     * one's acked, our cStates carry a log of the hashes added & removed since it
+     * (a few bytes in the steady state) and the peer rebuilds our iblt from its
+     * copy of the keyframe. A new keyframe is sent when the log would grow bigger
+     * than the iblt or has gone out of the journal. Logs are only sent to a peer
+     * that acks keyframes and, until the peer shows it does this, keyframes too long
+     * for an older syncps only carry an id now and then (see cStateName) so such a
+     * peer just misses the occasional cState. Since there's a single keyframe state
+     * it's not for a segment with several peers.
+     */
+    auto& neighborDeltas(bool on) {
+        deltas_ = on;
+        myKeys_ = {};
+        ackedKey_ = peerAck_ = 0;
+        peerDeltas_ = false;
+        unkeyed_ = 0;
+        peerKeys_.clear();
+        cState_.reset();
+        return *this;
+    }
+
+    /**
+     * @brief expand compressed pubs before delivering them (see pub_codec.hpp)
+     *
+     * Collections that pass pubs on (e.g., relays) mustn't set this.
+     */
+    auto& pubCodec(std::shared_ptr<PubCodec> codec) {
+        codec_ = std::move(codec);
+        return *this;
+    }
+
+    /**
+     * @brief bound the validation work done for each cAdd sender and each pub signer
+     * (see validate_limiter.hpp). cAdds or pubs over their signer's limit are dropped
+     * without being validated and signers that repeatedly fail validation are
+     * blacklisted for a while. Failures are charged to the sender's address (a cAdd's
+     * or invalid pub's key locator can be forged) so blacklisting needs a transport
+     * that reports it (see Transport::rxFrom). cAdds whose signature has no key locator
+     * (e.g., AEAD) and whose sender isn't known share one limit. The default is no limits.
+     */
+    auto& validateLimits(const ValidateLimiter::Params& p) {
+        cAddLimiter_ = std::make_unique<ValidateLimiter>(p);
+        pubLimiter_ = std::make_unique<ValidateLimiter>(p);
+        return *this;
+    }
+
+    /**
+     * @brief share the collection between its pubs' signers (see signer_quota.hpp).
+     * Pubs from a signer with p.maxActive_ active pubs are refused and, when a cAdd
+     * is filled, the signers of each priority class take turns (p.weight_ pubs each)
+     * so a busy publisher can't use all of it. The default is no quotas. Quotas need
+     * a pub sigmgr whose signatures carry the signer's key locator: with a keyless
+     * one every pub has the same 'signer' so a quota would cap the whole collection
+     * and the call is ignored (with a warning).
+     */
+    auto& signerQuota(const SignerQuota::Params& p) {
+        if (! pubSigmgr_.needsKey()) {
+            print("syncps::signerQuota: {} pubs have no signer key locator so quotas are off\n", collName_);
+            quota_.reset();
+            return *this;
+        }
+        quota_ = std::make_unique<SignerQuota>(p);
+        for (const auto& [h, e] : pubs_) if (e.active()) quota_->add(signerOf(e.i_.asView()));
+        return *this;
+    }
+
     auto& pubExpirationGB(std::chrono::milliseconds time) {
         pubExpirationGB_ = time > maxClockSkew? time : maxClockSkew;
         return *this;
     }
 };
 
+// DCTmodel and the distributors use SyncPS so building with DCT_PUBHASH64 defined
+// gives all of an app's collections 64-bit pub hashes.
+#ifdef DCT_PUBHASH64
+using SyncPS = BasicSyncPS<uint64_t>;
+#else
+using SyncPS = BasicSyncPS<uint32_t>;
+#endif
+using SyncPS64 = BasicSyncPS<uint64_t>;
+
 }  // namespace dct
 
 #endif  // SYNCPS_SYNCPS_HPP
@@ -0,0 +1,124 @@
+#ifndef SYNCPS_TOPIC_FILTER_HPP
+#define SYNCPS_TOPIC_FILTER_HPP
+#pragma once
+/*
+ * Bloom filter of a collection member's subscribed topics for its cStates
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/*
+ * A member that only subscribes to part of a collection (e.g., a leaf device)
+ * can put a Bloom filter of its subscription prefixes in its cStates. A responder
+ * then treats the cState as describing only the pubs with a name prefix in the
+ * filter: it takes the iblt difference against the slice of its collection that
+ * matches and only offers matching pubs in cAdds. False positives just send a
+ * pub the member didn't need.
+ *
+ * The filter is a power of 2 number of bytes (8 to 256) with about 16 bits per
+ * prefix. A prefix (the TLV value bytes of a name prefix) sets 'nHash' bits derived
+ * from its 64 bit FNV-1a hash so a name is tested by hashing it incrementally and
+ * probing the filter at each component boundary.
+ */
+
+namespace dct {
+
+struct TopicFilter {
+    static constexpr size_t nHash = 4;
+    static constexpr size_t minBytes = 8;
+    static constexpr size_t maxBytes = 256;
+    static constexpr size_t bitsPerPrefix = 16;
+    static constexpr uint64_t hashBasis = 0xcbf29ce484222325ull;
+
+    static constexpr uint64_t hashStep(uint64_t h, const uint8_t* b, const uint8_t* e) noexcept {
+        for (; b < e; ++b) h = (h ^ *b) * 0x100000001b3ull;
+        return h;
+    }
+    // (FNV's low bits are weak so the bit indices come from a mix of the hash)
+    static constexpr uint64_t mix(uint64_t h) noexcept {
+        h ^= h >> 33; h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ull;
+        return h ^ (h >> 33);
+    }
+    template<typename F>
+    static constexpr void bits(uint64_t h, size_t nbits, F&& f) {
+        h = mix(h);
+        uint32_t h1 = h, h2 = uint32_t(h >> 32) | 1;
+        for (size_t i = 0; i < nHash; ++i, h1 += h2) f(h1 & (nbits - 1));
+    }
+
+    // filter for 'prefixes', the TLV value bytes of each subscribed name prefix
+    template<typename Prefixes>
+    static std::vector<uint8_t> make(const Prefixes& prefixes) {
+        size_t n = std::ranges::distance(prefixes);
+        auto nbytes = std::clamp(std::bit_ceil((n * bitsPerPrefix + 7) / 8), minBytes, maxBytes);
+        std::vector<uint8_t> f(nbytes, 0);
+        for (const auto& p : prefixes) {
+            bits(hashStep(hashBasis, p.data(), p.data() + p.size()), nbytes * 8, [&f](size_t b) { f[b >> 3] |= 1u << (b & 7); });
+        }
+        return f;
+    }
+
+    // 'f' is a well formed filter (else it's ignored and every pub matches)
+    static constexpr bool valid(std::span<const uint8_t> f) noexcept {
+        return f.size() >= minBytes && f.size() <= maxBytes && std::has_single_bit(f.size());
+    }
+
+    static constexpr bool test(std::span<const uint8_t> f, uint64_t h) noexcept {
+        bool res{true};
+        bits(h, f.size() * 8, [&res, f](size_t b) { res &= (f[b >> 3] >> (b & 7)) & 1; });
+        return res;
+    }
+
+    /**
+     * @brief does name 'n' (its TLV value bytes) have a component prefix in filter 'f'?
+     *
+     * Prefixes shorter than 'skip' bytes (e.g., the collection name, which every pub
+     * has) aren't tested.
+     */
+    static constexpr bool matches(std::span<const uint8_t> f, std::span<const uint8_t> n, size_t skip = 0) noexcept {
+        uint64_t h = hashBasis;
+        for (size_t off = 0; off + 2 <= n.size(); ) {
+            size_t len = n[off + 1], hl = 2;
+            if (n[off] >= 253 || len > 253) return false;
+            if (len == 253) {
+                if (off + 4 > n.size()) return false;
+                len = size_t(n[off + 2]) << 8 | n[off + 3];
+                hl = 4;
+            }
+            auto end = off + hl + len;
+            if (end > n.size()) return false;
+            h = hashStep(h, &n[off], &n[end]);
+            off = end;
+            if (off >= skip && test(f, h)) return true;
+        }
+        return false;
+    }
+};
+
+} // namespace dct
+
+#endif  // SYNCPS_TOPIC_FILTER_HPP
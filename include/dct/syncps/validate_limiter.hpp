@@ -0,0 +1,135 @@
+#ifndef SYNCPS_VALIDATE_LIMITER_HPP
+#define SYNCPS_VALIDATE_LIMITER_HPP
+#pragma once
+/*
+ * Copyright (C) 2022 Pollere LLC
+ * Pollere authors at info@pollere.net
+ *
+ * This file is part of syncps (DCT pubsub via Collection Sync)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+
+#include <dct/sigmgrs/sigmgr_defs.hpp>
+
+namespace dct {
+
+/**
+ * @brief bounds the signature validation work done for each signer
+ *
+ * Each signer (thumbprint) has a token bucket that refills at 'rate_' tokens
+ * per second up to 'burst_'. A packet is only validated if its signer's bucket
+ * has a token, otherwise it's dropped without doing any crypto. A signer whose
+ * packets fail validation 'strikes_' times in a row is blacklisted (all its
+ * packets are dropped) for 'blacklist_'. A valid packet clears the strikes.
+ *
+ * The packets a limiter sees must carry a signer thumbprint for this to mean
+ * anything. For packets that don't (e.g., cAdds signed with a group key) the
+ * caller uses one thumbprint ('anySigner') for all of them so their total is
+ * bounded. anySigner is never struck or blacklisted since that would drop
+ * everyone's packets. Since a packet that fails validation can claim any
+ * signer, callers should record failures against something the packet can't
+ * forge (e.g., its sender's address, see SyncPS::srcId).
+ *
+ * At most 'maxSigners' signers are tracked. When that's reached the idle
+ * (full bucket, not blacklisted) ones are dropped, or an arbitrary one if none
+ * are idle.
+ */
+struct ValidateLimiter {
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t maxSigners = 4096;
+    static constexpr thumbPrint anySigner{};
+
+    struct Params {
+        double rate_{200.};                         // validations per second per signer
+        double burst_{1000.};                       // max validations in a burst
+        uint32_t strikes_{8};                       // consecutive failures before blacklisting
+        std::chrono::seconds blacklist_{60};        // how long a signer stays blacklisted
+    };
+
+  private:
+    struct Bucket {
+        double tokens_;
+        Clock::time_point last_;                    // when tokens_ was last updated
+        Clock::time_point until_{};                 // blacklisted until this time
+        uint32_t strikes_{};
+    };
+    Params p_;
+    std::unordered_map<thumbPrint,Bucket> signers_{};
+
+    Bucket& bucket(const thumbPrint& tp, Clock::time_point now) {
+        if (auto it = signers_.find(tp); it != signers_.end()) return it->second;
+        if (signers_.size() >= maxSigners) makeRoom(now);
+        return signers_.emplace(tp, Bucket{p_.burst_, now}).first->second;
+    }
+
+    void makeRoom(Clock::time_point now) {
+        std::erase_if(signers_, [this, now](const auto& kv) {
+                const auto& b = kv.second;
+                return b.until_ <= now && b.strikes_ == 0 &&
+                       b.tokens_ + p_.rate_ * std::chrono::duration<double>(now - b.last_).count() >= p_.burst_;
+            });
+        if (signers_.size() >= maxSigners) signers_.erase(signers_.begin());
+    }
+
+  public:
+    ValidateLimiter(const Params& p) : p_{p} { }
+
+    /**
+     * @brief returns true if a packet signed by 'tp' can be validated (and uses
+     * one of its tokens), false if it should be dropped.
+     */
+    bool allow(const thumbPrint& tp, Clock::time_point now = Clock::now()) {
+        auto& b = bucket(tp, now);
+        if (b.until_ > now) return false;
+        b.tokens_ = std::min(p_.burst_, b.tokens_ + p_.rate_ * std::chrono::duration<double>(now - b.last_).count());
+        b.last_ = now;
+        if (b.tokens_ < 1.) return false;
+        b.tokens_ -= 1.;
+        return true;
+    }
+
+    // record the result of validating a packet from 'tp'. Returns true if 'tp' is now blacklisted.
+    bool result(const thumbPrint& tp, bool valid, Clock::time_point now = Clock::now()) {
+        if (tp == anySigner) return false;
+        auto it = signers_.find(tp);
+        if (it == signers_.end() && valid) return false;
+        auto& b = it != signers_.end()? it->second : bucket(tp, now);
+        if (valid) {
+            b.strikes_ = 0;
+            return false;
+        }
+        if (++b.strikes_ < p_.strikes_) return false;
+        b.strikes_ = 0;
+        b.until_ = now + p_.blacklist_;
+        return true;
+    }
+
+    bool blacklisted(const thumbPrint& tp, Clock::time_point now = Clock::now()) const {
+        auto it = signers_.find(tp);
+        return it != signers_.end() && it->second.until_ > now;
+    }
+
+    const auto& params() const noexcept { return p_; }
+    auto size() const noexcept { return signers_.size(); }
+};
+
+} // namespace dct
+
+#endif  // SYNCPS_VALIDATE_LIMITER_HPP
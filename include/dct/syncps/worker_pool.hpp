@@ -0,0 +1,128 @@
+#ifndef SYNCPS_WORKER_POOL_HPP
+#define SYNCPS_WORKER_POOL_HPP
+#pragma once
+/*
+ * Copyright (C) 2022 Pollere LLC
+ * Pollere authors at info@pollere.net
+ *
+ * This file is part of syncps (DCT pubsub via Collection Sync)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dct {
+
+/**
+ * @brief fixed pool of threads for fork-join parallel loops
+ *
+ * DCT is single threaded: all packet & timer processing happens on the io
+ * thread. This pool lets the io thread farm out a batch of independent,
+ * read-only work items (e.g., signature checks of the pubs in a cAdd) then
+ * wait for them to complete. The io thread works on the batch too so a pool
+ * of N threads gives N+1 way parallelism. Nothing else runs on the io thread
+ * while a batch is in progress so the work items can safely read (but not
+ * modify) state owned by the io thread.
+ */
+struct WorkerPool {
+    using Work = std::function<void(size_t)>;
+
+    std::mutex mtx_{};
+    std::condition_variable start_{};   // signals workers a batch is ready (or to exit)
+    std::condition_variable done_{};    // signals io thread that workers have finished
+    const Work* work_{};                // work function of current batch
+    size_t nitems_{};                   // number of work items in current batch
+    std::atomic<size_t> next_{};        // next work item to be done
+    size_t busy_{};                     // workers still working on current batch
+    uint64_t batch_{};                  // batch sequence number
+    bool stop_{false};
+    std::vector<std::thread> threads_{};
+
+    explicit WorkerPool(size_t nthreads) {
+        threads_.reserve(nthreads);
+        for (size_t i = 0; i < nthreads; ++i) threads_.emplace_back([this]{ worker(); });
+    }
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    ~WorkerPool() {
+        {
+            std::lock_guard lck{mtx_};
+            stop_ = true;
+        }
+        start_.notify_all();
+        for (auto& t : threads_) t.join();
+    }
+
+    auto size() const noexcept { return threads_.size(); }
+
+    /**
+     * @brief call 'work(i)' for i in [0, n) spread over the pool and the calling
+     * thread, returning when all of the calls have completed.
+     *
+     * 'work' must not throw and must not call run() (the pool isn't reentrant).
+     */
+    void run(size_t n, const Work& work) {
+        if (n == 0) return;
+        if (threads_.empty() || n == 1) {
+            for (size_t i = 0; i < n; ++i) work(i);
+            return;
+        }
+        {
+            std::lock_guard lck{mtx_};
+            work_ = &work;
+            nitems_ = n;
+            next_.store(0, std::memory_order_relaxed);
+            busy_ = threads_.size();
+            ++batch_;
+        }
+        start_.notify_all();
+        doItems(work, n);
+        std::unique_lock lck{mtx_};
+        done_.wait(lck, [this]{ return busy_ == 0; });
+        work_ = nullptr;
+    }
+
+  private:
+    void doItems(const Work& work, size_t n) {
+        for (auto i = next_.fetch_add(1, std::memory_order_relaxed); i < n;
+             i = next_.fetch_add(1, std::memory_order_relaxed)) work(i);
+    }
+
+    void worker() {
+        uint64_t seen{};
+        std::unique_lock lck{mtx_};
+        while (true) {
+            start_.wait(lck, [this, &seen]{ return stop_ || batch_ != seen; });
+            if (stop_) return;
+            seen = batch_;
+            auto work = work_;
+            auto n = nitems_;
+            lck.unlock();
+            doItems(*work, n);
+            lck.lock();
+            if (--busy_ == 0) done_.notify_one();
+        }
+    }
+};
+
+} // namespace dct
+
+#endif // SYNCPS_WORKER_POOL_HPP
@@ -37,14 +37,13 @@ static constexpr size_t HOST_NAME_MAX = 64;  //Linux limit
 #endif
 
 inline static const std::string& sysID() noexcept {
-    static std::string sysid{};
-    if (sysid.size() == 0) {
+    static const std::string sysid = []{
         char h[HOST_NAME_MAX+1];
         if (gethostname(&h[0], sizeof(h)-1) != 0) {
             h[0] = h[1] = '?'; h[2] = 0;
         }
-        sysid = format("p{}@{}", getpid(), h);
-    }
+        return format("p{}@{}", getpid(), h);
+    }();
     return sysid;
 }
 
@@ -30,9 +30,13 @@
  *
  * This code also contains Pelle Evensen's improved 64-bit mixer, Moremur from
  * https://mostlymangling.blogspot.com/2019/12/stronger-better-morer-moremur-better.html
+ *
+ * hashN hashes several buffers at once, one per lane of a vector register, which
+ * is how a cAdd's pubs get hashed (see IBLT::hashobjs).
  */
 
 #include <stdint.h>
+#include <string.h>
 
 struct murmurHash3 {
 
@@ -50,20 +54,21 @@ struct murmurHash3 {
         return h;
     }
 
-    constexpr auto operator()(uint32_t seed, const uint8_t *data, int len) const noexcept {
-        const int nblocks = len / 4;
+    static constexpr uint32_t c1 = 0xcc9e2d51;
+    static constexpr uint32_t c2 = 0x1b873593;
 
-        uint32_t h1 = seed;
+    constexpr auto operator()(uint32_t seed, const uint8_t *data, int len) const noexcept { return finish(seed, data, len, 0); }
 
-        constexpr uint32_t c1 = 0xcc9e2d51;
-        constexpr uint32_t c2 = 0x1b873593;
+    // the hash of 'data' given 'h1', the state after its first 'nblk' 4-byte blocks
+    static constexpr uint32_t finish(uint32_t h1, const uint8_t *data, int len, int nblk) noexcept {
+        const int nblocks = len / 4;
 
         //----------
         // body
 
         const uint32_t *blocks = (const uint32_t *)(data + nblocks * 4);
 
-        for (int i = -nblocks; i; i++) {
+        for (int i = nblk - nblocks; i < 0; i++) {
             uint32_t k1 = blocks[i];
 
             k1 *= c1;
@@ -101,14 +106,55 @@ struct murmurHash3 {
         return fmix32(h1 ^ len);
     }
 
+    /*
+     * Multi-buffer hash: h[i] = operator()(seed[i], data[i], len[i]) for the 'n' (up to
+     * 'lanes') buffers. The blocks all the buffers have are mixed together in the lanes
+     * of a vector (the compiler's vector extension) then each buffer's remaining blocks
+     * and tail are finished on its own. A cAdd's pubs are usually about the same size
+     * so that's most of the work. The lanes need a vector 32-bit multiply to pay off:
+     * an AVX2 build (e.g., -mavx2 or -march=native, about 3x the scalar hash rate) or
+     * SSE4.1 on x86-64, NEON on arm. Baseline x86-64 (SSE2) runs at the scalar rate.
+     */
+    static constexpr int lanes = 8;
+    typedef uint32_t u32xN __attribute__((vector_size(lanes * sizeof(uint32_t))));
+
+    static void hashN(const uint32_t *seed, const uint8_t *const *data, const int *len, uint32_t *h, int n) noexcept {
+        // unused lanes hash a copy of the first buffer
+        const uint8_t *d[lanes];
+        int nblk = len[0] / 4;
+        u32xN h1;
+        for (int i = 0; i < lanes; i++) {
+            int j = i < n ? i : 0;
+            d[i] = data[j];
+            h1[i] = seed[j];
+            if (len[j] / 4 < nblk) nblk = len[j] / 4;
+        }
+        for (int b = 0; b < nblk * 4; b += 4) {
+            uint32_t kb[lanes];
+#pragma GCC unroll 8
+            for (int i = 0; i < lanes; i++) memcpy(&kb[i], d[i] + b, 4);
+            u32xN k1;
+            memcpy(&k1, kb, sizeof(k1));
+            k1 *= c1;
+            k1 = (k1 << 15) | (k1 >> 17);  // (rotl32, inline since vectors aren't passed to functions)
+            k1 *= c2;
+
+            h1 ^= k1;
+            h1 = (h1 << 13) | (h1 >> 19);
+            h1 = h1 * 5 + 0xe6546b64;
+        }
+        for (int i = 0; i < n; i++) h[i] = finish(h1[i], d[i], len[i], nblk);
+    }
+
     // moremur() from https://mostlymangling.blogspot.com/2019/12/stronger-better-morer-moremur-better.html
-    constexpr auto operator()(uint64_t x) const noexcept {
+    static constexpr uint64_t moremur(uint64_t x) noexcept {
         x ^= x >> 27;
         x *= uint64_t(0x3C79AC492BA7B653ull);
         x ^= x >> 33;
         x *= uint64_t(0x1C69B3F74AC4AE35ull);
         x ^= x >> 27;
-        return uint32_t(x);
+        return x;
     }
+    constexpr auto operator()(uint64_t x) const noexcept { return uint32_t(moremur(x)); }
 };
 #endif  // _MURMURHASH3_H_
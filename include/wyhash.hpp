@@ -0,0 +1,102 @@
+#ifndef _WYHASH_H_
+#define _WYHASH_H_
+/*
+ * header-only version of the 64 bit wyhash (final version 4)
+ *
+ * Copyright (C) 2022 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation; either version 2.1 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ *
+ * This code is an adaptation of Wang Yi's wyhash at https://github.com/wangyi-fudan/wyhash
+ * That code contains this rights statement:
+ *    This is free and unencumbered software released into the public domain
+ *    under The Unlicense (http://unlicense.org/)
+ *
+ * wyhash consumes 48 bytes per iteration in three independent 64x64->128 bit
+ * multiply chains so it runs several times faster than a byte-string hash like
+ * libstdc++'s std::hash<string_view> on the 100-400 byte names (cStates with
+ * IBLTs) that DCT hashes most. It's for in-memory tables (DIT, name-keyed maps).
+ * It's NOT a replacement for the murmurHash3 used by IBLT whose values are
+ * part of the sync protocol. Reads assume a little-endian machine.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+struct wyHash {
+    static constexpr uint64_t s0 = 0x2d358dccaa6c78a5ull;
+    static constexpr uint64_t s1 = 0x8bb84b93962eacc9ull;
+    static constexpr uint64_t s2 = 0x4b33a62ed433d4a3ull;
+    static constexpr uint64_t s3 = 0x4d5a2da51de1aa47ull;
+
+    // 128 bit product of a & b: low half in 'a', high half in 'b'
+    static inline void mum(uint64_t& a, uint64_t& b) noexcept {
+        __uint128_t r = a;
+        r *= b;
+        a = uint64_t(r);
+        b = uint64_t(r >> 64);
+    }
+    static inline uint64_t mix(uint64_t a, uint64_t b) noexcept { mum(a, b); return a ^ b; }
+
+    static inline uint64_t r8(const uint8_t* p) noexcept { uint64_t v; memcpy(&v, p, 8); return v; }
+    static inline uint64_t r4(const uint8_t* p) noexcept { uint32_t v; memcpy(&v, p, 4); return v; }
+    static inline uint64_t r3(const uint8_t* p, size_t k) noexcept {
+        return (uint64_t(p[0]) << 16) | (uint64_t(p[k >> 1]) << 8) | p[k - 1];
+    }
+
+    uint64_t operator()(const uint8_t* p, size_t len, uint64_t seed = 0) const noexcept {
+        seed ^= mix(seed ^ s0, s1);
+        uint64_t a, b;
+        if (len <= 16) {
+            if (len >= 4) {
+                a = (r4(p) << 32) | r4(p + ((len >> 3) << 2));
+                b = (r4(p + len - 4) << 32) | r4(p + len - 4 - ((len >> 3) << 2));
+            } else if (len > 0) {
+                a = r3(p, len);
+                b = 0;
+            } else {
+                a = b = 0;
+            }
+        } else {
+            auto i = len;
+            if (i > 48) {
+                auto see1 = seed, see2 = seed;
+                do {
+                    seed = mix(r8(p) ^ s1, r8(p + 8) ^ seed);
+                    see1 = mix(r8(p + 16) ^ s2, r8(p + 24) ^ see1);
+                    see2 = mix(r8(p + 32) ^ s3, r8(p + 40) ^ see2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                seed ^= see1 ^ see2;
+            }
+            while (i > 16) {
+                seed = mix(r8(p) ^ s1, r8(p + 8) ^ seed);
+                i -= 16;
+                p += 16;
+            }
+            a = r8(p + i - 16);
+            b = r8(p + i - 8);
+        }
+        a ^= s1;
+        b ^= seed;
+        mum(a, b);
+        return mix(a ^ s0 ^ len, b ^ s1);
+    }
+};
+#endif  // _WYHASH_H_
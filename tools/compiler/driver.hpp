@@ -24,9 +24,11 @@
 
 #include <array>
 #include <bitset>
+#include <chrono>
 #include <iostream>
 #include <set>
 #include <utility>
+#include <sys/resource.h>
 
 #include <boost/version.hpp>
 #if BOOST_VERSION < 108100
@@ -102,6 +104,23 @@ struct tagmap : public std::multimap<sComp,uint8_t> {
     }
 };
 
+// compiler statistics reported at -v (V_FULL) and above
+struct compStats {
+    using clock = std::chrono::steady_clock;
+    std::vector<std::pair<std::string,double>> phases_{}; // phase name & elapsed ms
+    size_t expCalls_{}, expHits_{};             // expand_name reference expansions & memo hits
+    size_t orCalls_{}, orHits_{};               // expand_or reference expansions & memo hits
+    size_t maxExp_{};                           // largest single expansion (names)
+
+    // run 'f', recording its elapsed time as 'phase'
+    auto timed(std::string_view phase, auto&& f) {
+        auto t0 = clock::now();
+        f();
+        phases_.emplace_back(phase, std::chrono::duration<double,std::milli>(clock::now() - t0).count());
+    }
+    void noteExp(size_t n) noexcept { if (n > maxExp_) maxExp_ = n; }
+};
+
 struct driver {
     std::set<sComp> pubs_{};                    // publications defined
     std::set<sComp> primary_{};                 // primary publications defined
@@ -134,7 +153,14 @@ struct driver {
     std::map<sComp,discrimMap> discrim_{};      // per-pub discriminators
     std::string input_{}; // The name of the file being parsed.
     std::string output_{}; // binary schema output file name
+    std::string header_{}; // generated C++ header file name
     symTab symtab_;
+
+    // expansions of definitions are memoized since the same definition is generally referenced from
+    // many names. The memos are invalidated whenever a definition is replaced (see 'redefine').
+    mutable std::map<sComp,sNameVec> expMemo_{}; // expand_name of a definition
+    mutable std::map<sComp,sNameVec> orMemo_{};  // expand_or of a definition starting with '|'
+    mutable compStats stats_{};
     int verbose_{1};
     bool printDag_{false};
 
@@ -146,6 +172,13 @@ struct driver {
     };
 
     symTab& symtab() { return symtab_; }
+
+    // replace definition 'c' with 'nm', dropping any memoized expansions that might depend on it
+    void redefine(const sComp c, sName&& nm) {
+        symtab_.replace(c, std::move(nm));
+        expMemo_.clear();
+        orMemo_.clear();
+    }
     void symtab(symTab&& s) { symtab_ = std::move(s); }
     yy::location& location() { return symtab().location(); }
     const sNameVec& chains() const { return chains_; }
@@ -155,6 +188,8 @@ struct driver {
     void input(std::string_view f) { input_ = f; }
     void output(std::string_view ofile) { output_ = ofile; }
     const std::string& output() { return output_; }
+    void header(std::string_view hfile) { header_ = hfile; }
+    const std::string& header() { return header_; }
 
     // Construct a parser symbol from a character
     auto tokFromChar(unsigned char c) {
@@ -294,14 +329,17 @@ struct driver {
         if (o2.size() == 0) return std::move(o1);
  
         sNameVec res{};
+        res.reserve(o1.size() * o2.size());
         // concatenate every piece of o1 & o2 and put the result in res
-        for (auto i : o1) {
-            for (auto j : o2) {
-                auto c = i;
+        for (const auto& i : o1) {
+            for (const auto& j : o2) {
+                auto& c = res.emplace_back();
+                c.reserve(i.size() + j.size());
+                c.insert(c.end(), i.begin(), i.end());
                 c.insert(c.end(), j.begin(), j.end());
-                res.emplace_back(c);
             }
         }
+        stats_.noteExp(res.size());
         return res;
     }
 
@@ -341,9 +379,7 @@ struct driver {
             res = append(expand_name(n, b1, e1), expand_name(n, b2, e2));
         } else if (!(n[b].isLit()) && symtab_.contains(n[b])) {
             // a defined reference - expand the definition of the ref.
-            auto ref = n[b++];
-            auto s = symtab_[ref];
-            res = expand_name(s, 0, s.size());
+            res = expand_def(n[b++]);
         } else {
             // a literal or undefined reference
             res.emplace_back(sName{n[b++]});
@@ -371,11 +407,9 @@ struct driver {
             int e2 = b2 + n[e1].id();
             b = e2;
             res = append(expand_or(n, b1, e1), expand_or(n, b2, e2));
-        } else if ((n[b].isStr()) && symtab_.contains(n[b]) && symtab_[n[b]][0].isResolve()) {
+        } else if ((n[b].isStr()) && symtab_.contains(n[b]) && symtab_.at(n[b])[0].isResolve()) {
             // definition starts with '|' - expand it.
-            auto ref = n[b++];
-            auto s = symtab_[ref];
-            res = expand_or(s, 0, s.size());
+            res = expand_or_def(n[b++]);
         } else {
             // copy everything else
             res.emplace_back(sName{n[b++]});
@@ -388,6 +422,27 @@ struct driver {
         return crossprod(std::move(res), expand_or(n, b, e));
     }
 
+    // memoized expansions of the definition of a (defined) reference
+    sNameVec expand_def(const sComp ref) const {
+        ++stats_.expCalls_;
+        if (auto m = expMemo_.find(ref); m != expMemo_.end()) {
+            ++stats_.expHits_;
+            return m->second;
+        }
+        const auto& s = symtab_.at(ref);
+        return expMemo_.emplace(ref, expand_name(s, 0, s.size())).first->second;
+    }
+
+    sNameVec expand_or_def(const sComp ref) const {
+        ++stats_.orCalls_;
+        if (auto m = orMemo_.find(ref); m != orMemo_.end()) {
+            ++stats_.orHits_;
+            return m->second;
+        }
+        const auto& s = symtab_.at(ref);
+        return orMemo_.emplace(ref, expand_or(s, 0, s.size())).first->second;
+    }
+
     sNameVec expand_name(const sName& nm) const { return expand_name(nm, 0, nm.size()); }
 
     sNameVec expand_name(const sComp comp) const {
@@ -456,7 +511,7 @@ struct driver {
         } else if (con[b].isField()) {
             // next two components are tag name & value
             auto [b1, e1, b2, e2] = termLimits(con, b, e);
-            auto tags = tags_.at(def);
+            const auto& tags = tags_.at(def);
             auto tag = con[b1];
             if (! tags.contains(tag)) {
                 symtab_.throw_error(format("error: {} has no component named {}", to_string(def), to_string(tag)));
@@ -475,9 +530,9 @@ struct driver {
                     r.insert(it, con.begin()+b2, con.begin()+e2);
                 }
                 auto rex = expand_or(r, 0, r.size());
-                r2.insert(r2.end(), rex.begin(), rex.end());
+                r2.insert(r2.end(), std::make_move_iterator(rex.begin()), std::make_move_iterator(rex.end()));
             }
-            res = r2;
+            res = std::move(r2);
             //print("f{}\n{}\n", t, to_string(res));
         } else {
             // unknown operator
@@ -506,7 +561,7 @@ struct driver {
         auto parent = parent_[def];
         if (parent != def) handleConstraints(parent);
         auto con = constraints_[def];
-        symtab_.replace(def, handleConstraints(symtab_[parent], def, con));
+        redefine(def, handleConstraints(symtab_[parent], def, con));
         conDone_.emplace(def);
     }
 
@@ -563,7 +618,7 @@ struct driver {
             if (exp.size() > cur.size()) {
                 // tags are parent's initial value - have to fix that too
                 tags_[comp] = tagmap().init(exp);
-                symtab_.replace(comp, std::move(exp));
+                redefine(comp, std::move(exp));
             }
         }
     }
@@ -815,9 +870,29 @@ struct driver {
 
     // routine run at end of input
     void finish() {
-        finishDefs();
-        finishCerts();
-        finishExpand();
+        stats_.timed("defs", [this]{ finishDefs(); });
+        stats_.timed("certs", [this]{ finishCerts(); });
+        stats_.timed("expand", [this]{ finishExpand(); });
+    }
+
+    void printStats() const {
+        print("Compile statistics:\n phase ms:");
+        double tot{};
+        for (const auto& [p, ms] : stats_.phases_) { print(" {} {:.1f}", p, ms); tot += ms; }
+        print(" (total {:.1f})\n", tot);
+        size_t nexp{}, ncomp{};
+        for (const auto& [_, nv] : certs_) {
+            nexp += nv.size();
+            for (const auto& n : nv) ncomp += n.size();
+        }
+        print(" {} definitions, {} pubs, {} certs expanded to {} names ({} components)\n",
+              symtab_.size(), pubs_.size(), certs_.size(), nexp, ncomp);
+        print(" {} signing chains, {} templates, largest expansion {} names\n",
+              chains_.size(), templates_.size(), stats_.maxExp_);
+        print(" expand memo {}/{} hits, or-expand memo {}/{} hits\n",
+              stats_.expHits_, stats_.expCalls_, stats_.orHits_, stats_.orCalls_);
+        struct rusage ru;
+        if (getrusage(RUSAGE_SELF, &ru) == 0) print(" peak RSS {} KB\n", ru.ru_maxrss);
     }
 };
 
@@ -23,7 +23,9 @@
  */
 #include <algorithm>
 #include <array>
+#include <cctype>
 #include <compare>
+#include <filesystem>
 #include <fstream>
 #include <functional>
 #include <iostream>
@@ -459,12 +461,110 @@ struct schemaOut {
         }
     }
 
+    // C++ identifier for schema string 's' (a pub's '#' is dropped and other
+    // characters that can't be in an identifier become '_')
+    static std::string ident(std::string_view s) {
+        if (s.starts_with('#')) s.remove_prefix(1);
+        std::string id{};
+        for (auto ch : s) id += std::isalnum((unsigned char)ch) || ch == '_'? ch : '_';
+        if (id.empty() || std::isdigit((unsigned char)id[0])) id.insert(0, "_");
+        return id;
+    }
+    // 's' as a C++ string literal
+    static std::string quote(std::string_view s) {
+        std::string q{"\""};
+        for (unsigned char ch : s) {
+            if (ch == '"' || ch == '\\') { q += '\\'; q += ch; }
+            else if (std::isprint(ch)) q += ch;
+            else q += format("\\{:03o}", ch);
+        }
+        return q + '"';
+    }
+    std::string genComp(const sComp c) const {
+        if (c == anon_) return "{cKind::anon}";
+        if (c.isCall()) return format("{{cKind::call, {}}}", quote(drv_.fn2str_[drv_.comp2fn(c)]));
+        if (c.isLit()) return format("{{cKind::lit, {}}}", quote(bareString(c)));
+        if (drv_.isParam(c)) return "{cKind::param}";
+        if (c.isStr()) return "{cKind::cor}";
+        print("error: unexpected token type {}\n", drv_.symtab().to_string(c));
+        abort();
+    }
+    /*
+     * Write a C++ header with each primary pub's tags and templates as constexpr
+     * tables for the builders and validators in dct/schema/compiled_schema.hpp.
+     * A pub's templates are in the order pubBldr tries them (most specific
+     * discriminator first).
+     */
+    void writeHeader() const {
+        std::ostringstream os{};
+        auto ns = ident(std::filesystem::path(drv_.header()).stem().string());
+        os << format("// {} pub builders & validators generated by schemaCompile from {}. Do not edit.\n"
+                     "#pragma once\n#include \"dct/schema/compiled_schema.hpp\"\n\nnamespace {} {{\n\n"
+                     "using dct::cschema::cKind;\n\n", ns, drv_.input(), ns);
+        int npub{};
+        for (const auto pub : drv_.pubs_) {
+            if (! drv_.isPrimary(pub)) continue;
+            ++npub;
+            const auto tags = drv_.tags_.at(pub).tags();
+            std::vector<std::string> tn{}, tq{};
+            for (const auto t : tags) {
+                tn.emplace_back(ident(bareString(t)));
+                if (tn.back() == "tag") tn.back() += '_';
+                tq.emplace_back(quote(bareString(t)));
+            }
+            os << format("struct {} {{\n"
+                         "    static constexpr std::string_view name{{{}}};\n"
+                         "    struct tag {{ enum : uint8_t {{ {} }}; }};\n"
+                         "    static constexpr std::array<std::string_view,{}> tags{{ {} }};\n"
+                         "    using Params = std::array<dct::paramVal,{}>;\n",
+                         ident(bareString(pub)), quote(bareString(pub)), fmt::join(tn, ", "), tags.size(),
+                         fmt::join(tq, ", "), tags.size());
+
+            std::vector<const discrimMap::value_type*> dv{};
+            for (const auto& d : drv_.discrim_.at(pub)) dv.emplace_back(&d);
+            std::stable_sort(dv.begin(), dv.end(), [](auto a, auto b){ return a->second.count() > b->second.count(); });
+            std::vector<std::string> tv{};
+            for (const auto d : dv) {
+                const auto& [tpcer, vals] = *d;
+                const auto& [t, par, cer] = tpcer;
+                const auto& nm = drv_.templates_[t];
+                if (nm.size() != tags.size()) {
+                    print("error: {} template {} doesn't match its tags\n", drv_.to_string(pub), drv_.to_string(nm));
+                    abort();
+                }
+                auto n = tv.size();
+                std::vector<std::string> cv{};
+                for (const auto c : nm) cv.emplace_back(genComp(c));
+                os << format("    static constexpr dct::cschema::cComp t{}_[]{{ {} }};\n", n, fmt::join(cv, ", "));
+                std::string dvals{"{}"};
+                if (vals.count()) {
+                    std::vector<std::string> vq{};
+                    vals.for_each([this,&vq](auto v){ vq.emplace_back(quote(bareString(sComp(v, sComp::fLit)))); });
+                    os << format("    static constexpr std::string_view d{}_[]{{ {} }};\n", n, fmt::join(vq, ", "));
+                    dvals = format("d{}_", n);
+                }
+                chainBM cbm{};
+                for (auto ch : cer) cbm |= 1 << chain_[ch];
+                tv.emplace_back(format("dct::cschema::cTmplt{{t{}_, {}, {}, 0x{:02x}}}", n, par, dvals, cbm));
+            }
+            os << format("    static constexpr std::array<dct::cschema::cTmplt,{}> tmplts{{\n        {}\n    }};\n}};\n\n",
+                         tv.size(), fmt::join(tv, ",\n        "));
+        }
+        os << format("}} // namespace {}\n", ns);
+        print("C++ header {} has {} pubs\n", drv_.header(), npub);
+
+        std::ofstream of(drv_.header(), std::ios::trunc);
+        of << os.str();
+        of.close();
+    }
+
     void construct()
     {
         makeStringTable();
         makeCertTable();
         makePubTable();
         writeSchema();
+        if (! drv_.header().empty()) writeHeader();
     }
 };
 
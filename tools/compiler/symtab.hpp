@@ -57,6 +57,9 @@ struct symTab
         }
         return c2n_.at(key.id());
     }
+    // definition of a key that's known to be defined (avoids operator[]'s copy)
+    const sName& at(const sComp key) const { return c2n_.at(key.id()); }
+    auto size() const noexcept { return c2n_.size(); }
     std::string bare_string(const sComp key) const {
         return comp_[key];
     }
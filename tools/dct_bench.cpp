@@ -0,0 +1,382 @@
+/*
+ *  dct_bench - time DCT's per-packet operations (sigmgrs, iblt, tlv, name matching)
+ *
+ * Copyright (C) 2022 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+/*
+ * Each benchmark is run as 'nsamples' timed batches of operations on each of
+ * 'threads' threads (each with its own copy of the benchmark's state, e.g., its
+ * own sigmgr). Anything an operation consumes (e.g., the unsigned packet for a
+ * sign) is prepared before its batch's clock starts so the times are just the
+ * operation. The per-operation time of each batch is a sample and the report
+ * gives the mean and percentiles of the samples along with the throughput of
+ * all the threads together. Output is JSON (default) or CSV so runs can be
+ * compared across releases.
+ */
+#include <getopt.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <random>
+#include <thread>
+#include "dct/format.hpp"
+#include "dct/face/lpm.hpp"
+#include "dct/schema/crpacket.hpp"
+#include "dct/sigmgrs/sigmgr_by_type.hpp"
+#include "dct/syncps/iblt.hpp"
+
+using namespace dct;
+
+static struct option opts[] {
+    {"bench", required_argument, nullptr, 'b'},
+    {"format", required_argument, nullptr, 'f'},
+    {"threads", required_argument, nullptr, 'j'},
+    {"nsamples", required_argument, nullptr, 'n'},
+    {"sizes", required_argument, nullptr, 's'},
+    {"types", required_argument, nullptr, 't'},
+    {"help", no_argument, nullptr, 'h'}
+};
+
+static auto usage(std::string_view pname) {
+    print("- usage: {} [-b groups] [-t types] [-s sizes] [-j threads] [-n nsamples] [-f json|csv]\n"
+          "  -b  comma separated benchmark groups (default sigmgr,iblt,tlv,lpm)\n"
+          "  -t  comma separated sigmgr types (default all)\n"
+          "  -s  comma separated payload sizes in bytes (default 64,256,1024)\n"
+          "  -j  comma separated thread counts (default 1)\n"
+          "  -n  timed batches per benchmark per thread (default 256)\n"
+          "  -f  output format (default json)\n", pname);
+    exit(1);
+}
+
+static std::vector<std::string> split(std::string_view s) {
+    std::vector<std::string> v{};
+    for (size_t b = 0; b <= s.size(); ) {
+        auto e = std::min(s.find(',', b), s.size());
+        if (e > b) v.emplace_back(s.substr(b, e - b));
+        b = e + 1;
+    }
+    return v;
+}
+
+// a benchmark's per-thread state: prep(i) readies the i'th operation of a batch
+// (untimed) then run(i) does it (timed)
+struct Op {
+    std::function<void(size_t)> prep{};
+    std::function<void(size_t)> run;
+};
+
+struct Bench {
+    std::string group;
+    std::string type;
+    std::string op;
+    size_t size;
+    size_t batch;                   // operations per timed sample
+    std::function<Op()> mk;         // construct a thread's state
+};
+
+struct Result {
+    const Bench& b;
+    size_t threads;
+    size_t n;                       // operations timed
+    double mean, p50, p90, p99;     // ns per operation
+    double opsPerSec;               // all threads
+};
+
+using clk = std::chrono::steady_clock;
+
+static Result run(const Bench& b, size_t nthreads, size_t nsamples) {
+    std::vector<std::vector<double>> samples(nthreads);
+    auto work = [&b, nsamples](std::vector<double>& s) {
+        auto op = b.mk();
+        s.reserve(nsamples);
+        // one untimed batch to warm up caches
+        for (size_t k = 0; k <= nsamples; ++k) {
+            if (op.prep) for (size_t i = 0; i < b.batch; ++i) op.prep(i);
+            auto t0 = clk::now();
+            for (size_t i = 0; i < b.batch; ++i) op.run(i);
+            auto t1 = clk::now();
+            if (k > 0) s.emplace_back(std::chrono::duration<double,std::nano>(t1 - t0).count() / b.batch);
+        }
+    };
+    auto t0 = clk::now();
+    if (nthreads == 1) work(samples[0]);
+    else {
+        std::vector<std::thread> th{};
+        for (auto& s : samples) th.emplace_back(work, std::ref(s));
+        for (auto& t : th) t.join();
+    }
+    auto wall = std::chrono::duration<double>(clk::now() - t0).count();
+
+    std::vector<double> all{};
+    for (const auto& s : samples) all.insert(all.end(), s.begin(), s.end());
+    std::sort(all.begin(), all.end());
+    auto q = [&all](double f) { return all[std::min(all.size() - 1, size_t(f * all.size()))]; };
+    double sum{};
+    for (auto v : all) sum += v;
+    // throughput includes the untimed prep so it's a lower bound for ops with a prep
+    auto n = all.size() * b.batch;
+    return Result{b, nthreads, n, sum / all.size(), q(.5), q(.9), q(.99), (n + nthreads * b.batch) / wall};
+}
+
+/*
+ * sigmgr benchmarks
+ */
+struct Keys {
+    keyVal pk, sk;                  // EdDSA signing pair
+    keyVal gpk, gsk;                // subscriber group pair (PPAEAD, PPSIGN)
+    keyVal aead;                    // group key (AEAD, AEADSGN, AESGCM, AESGCMSGN, BLAKE2K)
+    crData cert{crName{"/bench/KEY/1"}};
+
+    Keys() : pk(crypto_sign_PUBLICKEYBYTES), sk(crypto_sign_SECRETKEYBYTES), gpk(crypto_kx_PUBLICKEYBYTES),
+             gsk(crypto_kx_SECRETKEYBYTES), aead(crypto_aead_xchacha20poly1305_IETF_KEYBYTES) {
+        if (sodium_init() == -1) exit(EXIT_FAILURE);
+        crypto_sign_keypair(pk.data(), sk.data());
+        crypto_kx_keypair(gpk.data(), gsk.data());
+        crypto_aead_xchacha20poly1305_ietf_keygen(aead.data());
+        std::span<const uint8_t> k{pk};
+        cert.content(k);
+    }
+};
+
+static auto keyTime() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+static auto mkSigMgr(const std::string& type, const Keys& k) {
+    auto sm = std::make_unique<SigMgrAny>(sigMgrByType(type));
+    auto& s = sm->ref();
+    if (s.needsKey()) {
+        s.updateSigningKey(k.sk, k.cert);
+        s.setKeyCb([&k](rData) -> keyRef { return k.pk; });
+    }
+    if (s.subscriberGroup()) s.addKey(k.gpk, k.gsk, keyTime());
+    else if (s.groupKey()) s.addKey(k.aead, keyTime());
+    return sm;
+}
+
+static void sigmgrBenches(std::vector<Bench>& bv, const std::vector<std::string>& types,
+                          const std::vector<size_t>& sizes, const Keys& k, const std::vector<uint8_t>& rdat) {
+    static constexpr size_t batch = 8;
+    for (const auto& t : types) {
+        for (auto sz : sizes) {
+            // an unsigned pub and a signed copy of it for the validate ops
+            auto mkPub = [&rdat, sz] {
+                crData p{crName{"/bench/sigmgr/pub"}/std::chrono::system_clock::now()};
+                auto c = std::span<const uint8_t>(rdat).first(sz);
+                p.content(c);
+                return p;
+            };
+            struct St {
+                std::unique_ptr<SigMgrAny> sm;
+                crData pub, signedPub;
+                std::vector<crData> v;
+            };
+            auto mkSt = [&k, &t, mkPub] {
+                auto st = std::make_shared<St>(St{mkSigMgr(t, k), mkPub(), {}, std::vector<crData>(batch)});
+                st->signedPub = st->pub;
+                if (! st->sm->sign(st->signedPub)) throw std::runtime_error(format("{} couldn't sign", t));
+                return st;
+            };
+            bv.emplace_back(Bench{"sigmgr", t, "sign", sz, batch, [mkSt] {
+                    auto st = mkSt();
+                    return Op{[st](size_t i) { st->v[i] = st->pub; }, [st](size_t i) { st->sm->sign(st->v[i]); }};
+                }});
+            // the encrypt-only sigmgrs validate as part of decryption
+            if (auto s = mkSigMgr(t, k); ! s->ref().encryptsContent() || s->ref().needsKey()) {
+                bv.emplace_back(Bench{"sigmgr", t, "validate", sz, batch, [mkSt] {
+                        auto st = mkSt();
+                        return Op{{}, [st](size_t) { st->sm->validate(st->signedPub); }};
+                    }});
+            }
+            bv.emplace_back(Bench{"sigmgr", t, "validateDecrypt", sz, batch, [mkSt] {
+                    auto st = mkSt();
+                    return Op{[st](size_t i) { st->v[i] = st->signedPub; },
+                              [st](size_t i) { st->sm->validateDecrypt(st->v[i]); }};
+                }});
+        }
+    }
+}
+
+/*
+ * iblt benchmarks (the collection's set reconciliation)
+ */
+static void ibltBenches(std::vector<Bench>& bv) {
+    using I = IBLT<uint32_t>;
+    bv.emplace_back(Bench{"iblt", "", "insert", I::stsize, 256, [] {
+            auto t = std::make_shared<I>();
+            auto key = std::make_shared<uint32_t>(1);
+            return Op{{}, [t, key](size_t) { t->insert((*key)++); }};
+        }});
+    for (size_t nd : {4, 16, 64}) {
+        // two collections of 512 pubs differing by 'nd' pubs
+        struct St { I a, b, s; I::HashBuf have, need; St(size_t st) : a(st), b(st), s(st) {} };
+        auto mk = [nd] {
+            auto st = std::make_shared<St>(I::sizeFor(nd));
+            std::minstd_rand rg{uint32_t(nd)};
+            for (size_t i = 0; i < 512; ++i) { auto h = uint32_t(rg()); st->a.insert(h); st->b.insert(h); }
+            for (size_t i = 0; i < nd; ++i) (i & 1? st->a : st->b).insert(uint32_t(rg()));
+            return st;
+        };
+        bv.emplace_back(Bench{"iblt", "", "diffPeel", nd, 16, [mk] {
+                auto st = mk();
+                return Op{{}, [st](size_t) { st->s.assignDiff(st->a, st->b).peelInPlace(st->have, st->need); }};
+            }});
+        bv.emplace_back(Bench{"iblt", "", "rlEncode", nd, 16, [mk] {
+                auto st = mk();
+                return Op{{}, [st](size_t) { auto v = st->a.rlEncode(); (void)v; }};
+            }});
+    }
+}
+
+/*
+ * tlv benchmarks (building & parsing Data packets)
+ */
+static void tlvBenches(std::vector<Bench>& bv, const std::vector<size_t>& sizes, const std::vector<uint8_t>& rdat) {
+    for (auto sz : sizes) {
+        auto content = std::span<const uint8_t>(rdat).first(sz);
+        bv.emplace_back(Bench{"tlv", "", "build", sz, 64, [content] {
+                return Op{{}, [content](size_t) mutable {
+                        crData p{crName{"/bench/tlv/pub"}/std::chrono::system_clock::now()};
+                        p.content(content);
+                    }};
+            }});
+        bv.emplace_back(Bench{"tlv", "", "parse", sz, 64, [content] {
+                crData p{crName{"/bench/tlv/pub"}/std::chrono::system_clock::now()};
+                auto c = content;
+                p.content(c);
+                auto v = std::make_shared<std::vector<uint8_t>>(p.data(), p.data() + p.size());
+                return Op{{}, [v](size_t) {
+                        rData d{*v};
+                        if (! d.valid() || d.content().size() == 0) abort();
+                    }};
+            }});
+    }
+}
+
+/*
+ * name matching benchmarks (subscription lookup)
+ */
+static void lpmBenches(std::vector<Bench>& bv) {
+    for (size_t np : {10, 100, 1000}) {
+        struct St {
+            lpmLT<crPrefix,size_t,lpmHashed> lt{};
+            std::vector<crName> names{};
+            size_t sink{};
+        };
+        bv.emplace_back(Bench{"lpm", "", "findLM", np, 256, [np] {
+                auto st = std::make_shared<St>();
+                std::minstd_rand rg{uint32_t(np)};
+                const crName base{"/localnet/bench/pubs"};
+                auto comp = [&rg](size_t n) { return format("c{}", rg() % n); };
+                for (size_t i = 0, n = 0; n < np && i < 100 * np; ++i) {
+                    auto p = base/format("t{}", i % (np / 4 + 1));
+                    for (auto c = rg() % 4; c > 0; --c) p = std::move(p)/comp(8);
+                    if (st->lt.add(crPrefix{p}, i).second) ++n;
+                }
+                for (size_t i = 0; i < 1024; ++i) {
+                    auto n = base/format("t{}", rg() % (np / 4 + 2));
+                    for (auto c = 2 + rg() % 4; c > 0; --c) n = std::move(n)/comp(8);
+                    st->names.emplace_back(std::move(n)/std::chrono::system_clock::now());
+                }
+                return Op{{}, [st, k = size_t{}](size_t) mutable {
+                        const auto& n = st->names[k++ % st->names.size()];
+                        if (auto it = st->lt.findLM(rName{n}); st->lt.found(it)) st->sink += it->second;
+                    }};
+            }});
+    }
+}
+
+static void report(const std::vector<Result>& res, bool csv) {
+    if (csv) {
+        print("group,type,op,size,threads,n,mean_ns,p50_ns,p90_ns,p99_ns,ops_per_sec\n");
+        for (const auto& r : res) {
+            print("{},{},{},{},{},{},{:.1f},{:.1f},{:.1f},{:.1f},{:.0f}\n", r.b.group, r.b.type, r.b.op, r.b.size,
+                  r.threads, r.n, r.mean, r.p50, r.p90, r.p99, r.opsPerSec);
+        }
+        return;
+    }
+    print("[\n");
+    for (size_t i = 0; i < res.size(); ++i) {
+        const auto& r = res[i];
+        print("  {{\"group\": \"{}\", \"type\": \"{}\", \"op\": \"{}\", \"size\": {}, \"threads\": {}, \"n\": {}, "
+              "\"mean_ns\": {:.1f}, \"p50_ns\": {:.1f}, \"p90_ns\": {:.1f}, \"p99_ns\": {:.1f}, \"ops_per_sec\": {:.0f}}}{}\n",
+              r.b.group, r.b.type, r.b.op, r.b.size, r.threads, r.n, r.mean, r.p50, r.p90, r.p99, r.opsPerSec,
+              i + 1 < res.size()? "," : "");
+    }
+    print("]\n");
+}
+
+int main(int argc, char* const* argv) {
+    size_t nsamples{256};
+    std::vector<std::string> groups{"sigmgr", "iblt", "tlv", "lpm"};
+    std::vector<std::string> types{};
+    std::vector<size_t> sizes{64, 256, 1024};
+    std::vector<size_t> threads{1};
+    bool csv{false};
+
+    for (const auto& [n, t] : sigmgr_name_to_type) types.emplace_back(n);
+    std::sort(types.begin(), types.end());
+
+    auto nums = [pname = argv[0]](std::string_view s) {
+        std::vector<size_t> v{};
+        for (const auto& e : split(s)) if (auto n = std::stoul(e); n > 0) v.emplace_back(n); else usage(pname);
+        if (v.empty()) usage(pname);
+        return v;
+    };
+    for (int c; (c = getopt_long(argc, argv, "b:f:hj:n:s:t:", opts, nullptr)) != -1; ) {
+        switch (c) {
+            case 'b': groups = split(optarg); break;
+            case 'f':
+                if (std::string_view(optarg) == "csv") csv = true;
+                else if (std::string_view(optarg) != "json") usage(argv[0]);
+                break;
+            case 'j': threads = nums(optarg); break;
+            case 'n': nsamples = nums(optarg).front(); break;
+            case 's': sizes = nums(optarg); break;
+            case 't': types = split(optarg); break;
+            default: usage(argv[0]);
+        }
+    }
+
+    std::minstd_rand rg{std::random_device{}()};
+    std::vector<uint8_t> rdat(*std::max_element(sizes.begin(), sizes.end()));
+    std::generate(rdat.begin(), rdat.end(), [&rg]{ return uint8_t(rg()); });
+
+    Keys k{};
+    std::vector<Bench> bv{};
+    auto want = [&groups](std::string_view g) { return std::find(groups.begin(), groups.end(), g) != groups.end(); };
+    try {
+        if (want("sigmgr")) sigmgrBenches(bv, types, sizes, k, rdat);
+        if (want("iblt")) ibltBenches(bv);
+        if (want("tlv")) tlvBenches(bv, sizes, rdat);
+        if (want("lpm")) lpmBenches(bv);
+
+        std::vector<Result> res{};
+        for (const auto& b : bv) for (auto t : threads) res.emplace_back(run(b, t, nsamples));
+        report(res, csv);
+    } catch (const std::exception& e) {
+        print("error: {}\n", e.what());
+        exit(1);
+    }
+    exit(0);
+}
@@ -0,0 +1,265 @@
+#ifndef CAPTURE_HPP
+#define CAPTURE_HPP
+#pragma once
+/*
+ * High-rate packet capture to a ring of mmap'd pcap files, offline pcap
+ * reading and a prefix filter that works on wire bytes
+ *
+ * Copyright (C) 2023 Pollere LLC.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  This is not intended as production code.
+ */
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dct/file_to_vec.hpp"
+
+namespace dct {
+
+/*
+ * pcap file layout (microsecond timestamps). Packets are written as IPv6/UDP
+ * (LINKTYPE_IPV6) with synthesized headers holding the sender's address and
+ * port (the multicast group & DCT port as destination) so standard tools can
+ * read the capture. LINKTYPE_USER0 (raw NDN TLVs) is also accepted on input.
+ */
+struct pcapFmt {
+    static constexpr uint32_t magic = 0xa1b2c3d4;
+    static constexpr uint32_t linkIPv6 = 229;
+    static constexpr uint32_t linkUser0 = 147;
+    static constexpr size_t hdrLen = 40 + 8;    // synthesized IPv6 + UDP headers
+    static constexpr uint16_t dctPort = 56362;
+
+    struct fileHdr {
+        uint32_t magic_{magic};
+        uint16_t vmaj_{2};
+        uint16_t vmin_{4};
+        int32_t zone_{};
+        uint32_t sigfigs_{};
+        uint32_t snaplen_{65535};
+        uint32_t link_{linkIPv6};
+    };
+    struct recHdr {
+        uint32_t sec_;
+        uint32_t usec_;
+        uint32_t caplen_;
+        uint32_t len_;
+    };
+    static_assert(sizeof(fileHdr) == 24 && sizeof(recHdr) == 16);
+
+    // fill 'h' with the IPv6 & UDP headers of a 'len' byte DCT packet from 'src':'sport' to 'dst'
+    static void netHdr(uint8_t* h, const std::array<uint8_t,16>& src, uint16_t sport,
+                       const std::array<uint8_t,16>& dst, size_t len) noexcept {
+        auto ulen = uint16_t(len + 8);
+        std::memset(h, 0, hdrLen);
+        h[0] = 0x60;                            // version 6
+        h[4] = ulen >> 8; h[5] = ulen;          // payload length (UDP)
+        h[6] = 17;                              // next header: UDP
+        h[7] = 1;                               // hop limit
+        std::memcpy(h + 8, src.data(), 16);
+        std::memcpy(h + 24, dst.data(), 16);
+        h[40] = sport >> 8; h[41] = sport;
+        h[42] = dctPort >> 8; h[43] = uint8_t(dctPort);
+        h[44] = ulen >> 8; h[45] = ulen;        // (checksum left zero)
+    }
+};
+
+/*
+ * Captures packets into a ring of 'nfiles' pcap files ('base'.0, 'base'.1, ...)
+ * of at most 'fileSize' bytes each. Each file is mmap'd so a packet is written
+ * with a couple of memcpys and no syscalls. When a file fills, it's truncated
+ * to what was written (so it's a valid pcap file) and the next is started,
+ * overwriting the oldest, so the capture never uses more than
+ * nfiles * fileSize bytes of disk and the newest packets are always kept.
+ */
+struct PcapRing {
+    using Clock = std::chrono::system_clock;
+
+    std::string base_;
+    size_t fileSize_;
+    size_t nfiles_;
+    size_t cur_{};              // index of file being written
+    int fd_{-1};
+    uint8_t* map_{};
+    size_t off_{};              // write offset in current file
+    uint64_t pkts_{};
+    uint64_t bytes_{};
+    uint64_t files_{};          // files started
+
+    static auto err(const std::string& what) { return std::runtime_error(what + ": " + std::strerror(errno)); }
+
+    PcapRing(std::string_view base, size_t fileSize, size_t nfiles) :
+            base_{base}, fileSize_{std::max(fileSize, size_t(1) << 16)}, nfiles_{std::max(nfiles, size_t(1))} {
+        open(0);
+    }
+    PcapRing(const PcapRing&) = delete;
+    PcapRing& operator=(const PcapRing&) = delete;
+    ~PcapRing() { finish(); }
+
+    std::string fileName(size_t i) const { return base_ + "." + std::to_string(i); }
+
+    // write packet 'pkt' (received from 'src':'sport' at time 't')
+    void write(const uint8_t* pkt, size_t len, const std::array<uint8_t,16>& src, uint16_t sport,
+               const std::array<uint8_t,16>& dst, Clock::time_point t = Clock::now()) {
+        auto rlen = sizeof(pcapFmt::recHdr) + pcapFmt::hdrLen + len;
+        if (off_ + rlen > fileSize_) {
+            finish();
+            open((cur_ + 1) % nfiles_);
+            if (off_ + rlen > fileSize_) return;    // (can't happen with a sane file size)
+        }
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(t.time_since_epoch()).count();
+        pcapFmt::recHdr rh{uint32_t(us / 1000000), uint32_t(us % 1000000), uint32_t(pcapFmt::hdrLen + len),
+                           uint32_t(pcapFmt::hdrLen + len)};
+        std::memcpy(map_ + off_, &rh, sizeof(rh));
+        pcapFmt::netHdr(map_ + off_ + sizeof(rh), src, sport, dst, len);
+        std::memcpy(map_ + off_ + sizeof(rh) + pcapFmt::hdrLen, pkt, len);
+        off_ += rlen;
+        ++pkts_;
+        bytes_ += len;
+    }
+
+    // unmap the current file and truncate it to what's been written
+    void finish() {
+        if (map_) { ::munmap(map_, fileSize_); map_ = nullptr; }
+        if (fd_ >= 0) {
+            if (::ftruncate(fd_, off_) != 0) { }
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+  private:
+    void open(size_t i) {
+        cur_ = i;
+        auto fn = fileName(i);
+        fd_ = ::open(fn.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) throw err("can't open " + fn);
+        if (::ftruncate(fd_, fileSize_) != 0) throw err("can't size " + fn);
+        auto m = ::mmap(nullptr, fileSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (m == MAP_FAILED) throw err("can't map " + fn);
+        map_ = static_cast<uint8_t*>(m);
+        pcapFmt::fileHdr fh{};
+        std::memcpy(map_, &fh, sizeof(fh));
+        off_ = sizeof(fh);
+        ++files_;
+    }
+};
+
+/*
+ * Call 'cb(pkt, len, sport, time)' for each DCT packet in pcap file 'fn' (as
+ * written by PcapRing or any IPv6/UDP or raw TLV capture).
+ */
+template<typename CB>
+static void readPcap(const std::string& fn, CB&& cb) {
+    auto v = fileToVec(fn);
+    if (v.size() < sizeof(pcapFmt::fileHdr)) throw std::runtime_error(fn + ": not a pcap file");
+    pcapFmt::fileHdr fh;
+    std::memcpy(&fh, v.data(), sizeof(fh));
+    if (fh.magic_ != pcapFmt::magic) throw std::runtime_error(fn + ": unsupported pcap format");
+    if (fh.link_ != pcapFmt::linkIPv6 && fh.link_ != pcapFmt::linkUser0)
+        throw std::runtime_error(fn + ": unsupported pcap link type");
+    auto hl = fh.link_ == pcapFmt::linkIPv6? pcapFmt::hdrLen : 0;
+    for (size_t off = sizeof(fh); off + sizeof(pcapFmt::recHdr) <= v.size(); ) {
+        pcapFmt::recHdr rh;
+        std::memcpy(&rh, v.data() + off, sizeof(rh));
+        off += sizeof(rh);
+        if (rh.caplen_ == 0 || off + rh.caplen_ > v.size()) break;
+        const auto* p = v.data() + off;
+        off += rh.caplen_;
+        // skip anything that isn't UDP in IPv6 (without extension headers)
+        if (hl && (rh.caplen_ <= hl || (p[0] >> 4) != 6 || p[6] != 17)) continue;
+        uint16_t sport = hl? (uint16_t(p[40]) << 8) | p[41] : 0;
+        auto t = std::chrono::system_clock::time_point(std::chrono::seconds(rh.sec_) + std::chrono::microseconds(rh.usec_));
+        cb(p + hl, size_t(rh.caplen_ - hl), sport, t);
+    }
+}
+
+/*
+ * Matches packets whose name starts with a prefix by comparing wire bytes:
+ * the prefix's name components are TLV-encoded once and each packet's name
+ * TLV value is checked to start with them. Nothing is parsed or formatted per
+ * packet beyond the two outer TLV headers. Prefix components are literal
+ * strings ('/'-separated).
+ */
+struct PrefixFilter {
+    std::vector<uint8_t> comps_{};
+
+    static void putLen(std::vector<uint8_t>& v, size_t l) {
+        if (l < 253) { v.push_back(l); return; }
+        v.push_back(253);
+        v.push_back(l >> 8);
+        v.push_back(l);
+    }
+
+    PrefixFilter() = default;
+    explicit PrefixFilter(std::string_view pfx) {
+        while (pfx.size()) {
+            if (pfx.front() == '/') { pfx.remove_prefix(1); continue; }
+            auto e = pfx.find('/');
+            auto c = pfx.substr(0, e);
+            comps_.push_back(8);    // Generic name component
+            putLen(comps_, c.size());
+            comps_.insert(comps_.end(), c.begin(), c.end());
+            pfx.remove_prefix(e == pfx.npos? pfx.size() : e);
+        }
+    }
+
+    // parse a TLV type/length at 'p' (NDN variable-length numbers). Returns header size (0 if truncated).
+    static size_t tl(const uint8_t* p, size_t n, size_t& len) noexcept {
+        auto vn = [](const uint8_t* q, size_t m, size_t& v) -> size_t {
+            if (m == 0) return 0;
+            if (q[0] < 253) { v = q[0]; return 1; }
+            size_t k = q[0] == 253? 2 : q[0] == 254? 4 : 8;
+            if (m < k + 1) return 0;
+            v = 0;
+            for (size_t i = 1; i <= k; ++i) v = (v << 8) | q[i];
+            return k + 1;
+        };
+        size_t t;
+        auto a = vn(p, n, t);
+        if (a == 0) return 0;
+        auto b = vn(p + a, n - a, len);
+        return b == 0? 0 : a + b;
+    }
+
+    bool match(const uint8_t* p, size_t n) const noexcept {
+        if (comps_.empty()) return true;
+        size_t len;
+        auto h = tl(p, n, len);             // interest or data
+        if (h == 0) return false;
+        p += h; n -= h;
+        if (n == 0 || p[0] != 7) return false;
+        h = tl(p, n, len);                  // its name
+        if (h == 0 || len < comps_.size() || n < h + comps_.size()) return false;
+        return std::memcmp(p + h, comps_.data(), comps_.size()) == 0;
+    }
+};
+
+} // namespace dct
+
+#endif // CAPTURE_HPP
@@ -0,0 +1,202 @@
+/*
+ *  dctreplay - replay a packet capture into a Direct Face and its collections
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+/*
+ * Feeds the packets of one or more pcap files (e.g., the files of a 'dctwatch -w'
+ * capture ring, which are merged in time order) to a DirectFace with a SyncPS for
+ * each collection given with -c, so the face & sync hot paths can be profiled (or
+ * a regression reproduced) on a developer machine without a live multi-node setup.
+ *
+ * The face is on a simulated net (see dct/face/sim_net.hpp) whose other member is
+ * the replayer: what the face sends is counted and dropped. Packets go at the
+ * capture's timing scaled by -x (2 = twice as fast) or, with -x 0, back-to-back.
+ * Pub expiration uses a virtual clock that runs from the capture time of the
+ * first packet at the replay speed (or is the capture time of the last packet
+ * replayed with -x 0) so the captured pubs aren't all stale.
+ *
+ * Each packet is sent then the io_context handlers that are ready are run and
+ * their CPU time (thread CPU clock) is charged to the packet's type: cStates
+ * (interests), cAdds (data) or other. CPU used between packets (timers, cState
+ * & cAdd generation that's been deferred, ...) is charged to 'background'. After
+ * the last packet the run continues for -l ms so deferred work is counted.
+ *
+ * The collections use NULL sigmgrs (the capture's keys aren't available) so packet
+ * & pub signatures aren't checked and the pubs of encrypted collections aren't
+ * decrypted: the crypto itself is measured by time_signing.
+ */
+#include <getopt.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dct/format.hpp"
+#include "dct/face/direct.hpp"
+#include "dct/sigmgrs/sigmgr_null.hpp"
+#include "dct/syncps/syncps.hpp"
+#include "capture.hpp"
+
+using namespace dct;
+using Clock = std::chrono::steady_clock;
+using SysClock = std::chrono::system_clock;
+
+static struct option opts[] {
+    {"collection", required_argument, nullptr, 'c'},
+    {"speed", required_argument, nullptr, 'x'},
+    {"lifetime", required_argument, nullptr, 'L'},
+    {"linger", required_argument, nullptr, 'l'},
+    {"help", no_argument, nullptr, 'h'}
+};
+
+static auto usage(std::string_view pname) {
+    print("- usage: {} -c collection [-c collection ...] [-x speed] [-L pub lifetime ms] [-l linger ms] pcap-file ...\n", pname);
+    exit(1);
+}
+
+static std::chrono::nanoseconds cpuNow() noexcept {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+struct Stage {
+    std::string_view name_;
+    std::chrono::nanoseconds cpu_{};
+    uint64_t pkts_{};
+    uint64_t bytes_{};
+
+    template<typename F>
+    void time(F&& f) {
+        auto t0 = cpuNow();
+        f();
+        cpu_ += cpuNow() - t0;
+    }
+};
+
+struct Pkt {
+    SysClock::time_point t_;
+    std::vector<uint8_t> p_;
+};
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> colls{};
+    double speed{1.};
+    std::chrono::milliseconds lifetime{maxPubLifetime}, linger{1000};
+    for (int c; (c = getopt_long(argc, argv, "c:x:L:l:h", opts, nullptr)) != -1; ) {
+        switch (c) {
+            case 'c': colls.emplace_back(optarg); break;
+            case 'x': speed = std::stod(optarg); break;
+            case 'L': lifetime = std::chrono::milliseconds(std::stoul(optarg)); break;
+            case 'l': linger = std::chrono::milliseconds(std::stoul(optarg)); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (colls.empty() || optind >= argc || speed < 0.) usage(argv[0]);
+
+    std::vector<Pkt> pkts{};
+    try {
+        for (int i = optind; i < argc; ++i) {
+            readPcap(argv[i], [&pkts](const uint8_t* p, size_t len, uint16_t, SysClock::time_point t) {
+                    pkts.push_back({t, std::vector<uint8_t>(p, p + len)});
+                });
+        }
+    } catch (const std::exception& e) {
+        print("- error: {}\n", e.what());
+        exit(1);
+    }
+    if (pkts.empty()) { print("- no packets to replay\n"); exit(1); }
+    std::ranges::stable_sort(pkts, {}, &Pkt::t_);
+    const auto t0 = pkts.front().t_;
+
+    auto& ioc = getDefaultIoContext();
+    auto guard = boost::asio::make_work_guard(ioc);
+    auto& net = SimNet::get("dctreplay");
+    uint64_t sent{}, sentBytes{};
+    auto& pool = *new PktPool{};    // (outlives the packets still in flight at exit)
+    auto wire = net.join(ioc, pool, [&](PktRef&& b) { ++sent; sentBytes += b.size(); });
+
+    // the virtual clock (see above)
+    Clock::time_point start{};
+    SysClock::time_point last{t0};
+    auto vnow = [&]() -> SysClock::time_point {
+        if (speed == 0.) return last;
+        return t0 + std::chrono::duration_cast<SysClock::duration>((Clock::now() - start) * speed);
+    };
+
+    DirectFace face{"sim:dctreplay", ioc};
+    SigMgrNULL wsm{}, psm{};
+    uint64_t delivered{};
+    std::vector<std::unique_ptr<SyncPS>> syncs{};
+    for (const auto& c : colls) {
+        auto& s = *syncs.emplace_back(std::make_unique<SyncPS>(face, crName{c}, wsm, psm));
+        s.pubLifetime(lifetime);
+        s.isExpiredCb([&vnow, lifetime](const rPub& p) {
+                    try {
+                        auto dt = vnow() - p.name().last().toTimestamp();
+                        return dt >= lifetime + maxClockSkew || dt <= -maxClockSkew;
+                    } catch (const std::exception&) { return true; }
+                });
+        s.subscribe(crName{c}, [&delivered](const rPub&) { ++delivered; });
+    }
+    // let the collections register before the first packet
+    ioc.run_for(std::chrono::milliseconds(10));
+
+    Stage stCState{"cStates"}, stCAdd{"cAdds"}, stOther{"other pkts"}, stBkgnd{"background"};
+    start = Clock::now();
+    for (const auto& p : pkts) {
+        if (speed > 0.) {
+            auto due = start + std::chrono::duration_cast<Clock::duration>((p.t_ - t0) / speed);
+            stBkgnd.time([&] { while (Clock::now() < due) ioc.run_one_until(due); });
+        }
+        last = p.t_;
+        stBkgnd.time([&] { ioc.poll(); });
+        auto& st = p.p_.empty()? stOther : tlv(p.p_[0]) == tlv::Interest? stCState : tlv(p.p_[0]) == tlv::Data? stCAdd : stOther;
+        ++st.pkts_;
+        st.bytes_ += p.p_.size();
+        st.time([&] {
+                net.send(wire, p.p_.data(), p.p_.size());
+                ioc.poll();
+            });
+    }
+    auto replayed = Clock::now() - start;
+    stBkgnd.time([&] { ioc.run_for(linger); });
+
+    using fsecs = std::chrono::duration<double>;
+    auto span = fsecs(pkts.back().t_ - t0).count();
+    print("replayed {} packets spanning {:.3f}s in {:.3f}s (x{})\n", pkts.size(), span,
+          fsecs(replayed).count(), speed == 0.? std::string("max") : format("{}", speed));
+    std::chrono::nanoseconds total{};
+    for (const auto* s : {&stCState, &stCAdd, &stOther, &stBkgnd}) {
+        total += s->cpu_;
+        auto ms = std::chrono::duration<double,std::milli>(s->cpu_).count();
+        if (s->pkts_) print("{:>12}: {:8} pkts {:10} bytes {:10.3f}ms cpu {:8.2f}us/pkt\n", s->name_, s->pkts_, s->bytes_,
+                            ms, ms * 1e3 / s->pkts_);
+        else print("{:>12}: {:10.3f}ms cpu\n", s->name_, ms);
+    }
+    print("{:>12}: {:10.3f}ms cpu\n", "total", std::chrono::duration<double,std::milli>(total).count());
+    print("face sent {} packets ({} bytes), {} pubs delivered\n", sent, sentBytes, delivered);
+    for (const auto& s : syncs) print("{}\n", s->statsStr());
+    exit(0);
+}
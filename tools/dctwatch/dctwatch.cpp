@@ -56,6 +56,32 @@
  * (In the last example, note that the characters ^ $ \ . * + ? ( ) [ ] { } | are
  * meta-characters in ECMAScript REs and need to be escaped with \ to be matched.)
  *
+ * Formatting every packet (and regex matching its formatted name) can't keep up
+ * with a busy segment so there's also a capture mode and a cheaper filter:
+ *
+ *   -p prefix     only handle packets whose name starts with 'prefix' (literal
+ *                 '/'-separated components). This compares wire bytes so it's
+ *                 cheap enough to use when capturing.
+ *   -w file       don't print anything, just write the packets to a ring of pcap
+ *                 files file.0 ... file.<n-1> (see capture.hpp) until interrupted
+ *   -C MB         size of each capture file (default 64)
+ *   -W n          number of capture files (default 4)
+ *   -r file       print the packets in pcap file 'file' (e.g., a capture file)
+ *                 rather than listening. Can be repeated.
+ *
+ * For example, 'dctwatch -p /localnet -w /tmp/cap' captures the localnet
+ * packets and 'dctwatch -f -r /tmp/cap.0 -r /tmp/cap.1' dissects them later.
+ * dctreplay feeds a capture to a face & collections for profiling.
+ *
+ * '-s' replaces the packet printout with a table, refreshed every second, of
+ * each sync collection's activity during the last second: packets/s, bytes/s,
+ * cStates & cAdds per second and their ratio, the number of distinct cStates
+ * (iblt states, using the '-h' hash), the mean number of pubs per cAdd ('-' if
+ * the cAdds are encrypted) and the percentage of cStates that duplicate one
+ * already seen that second. A packet's collection is its name without the
+ * trailing iblt, estimator and iblt size components. Packets are counted by
+ * the raw name bytes; a collection's name is formatted the first time it's printed.
+ *
  *
  * Copyright (C) 2021-2 Pollere LLC
  *
@@ -80,12 +106,19 @@
 #include <chrono>
 #include <cmath>
 #include <iostream>
+#include <memory>
 #include <regex>
 #include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <unistd.h>
 
 #include "dct/format.hpp"
 #include "dct/sigmgrs/sigmgr.hpp"
 #include "dct/schema/rpacket.hpp"
+#include "capture.hpp"
 #include "dissect.hpp"
 #include "watcher.hpp"
 
@@ -98,6 +131,8 @@ static bool doInterest = true;
 static bool hashIBLT = false;
 static bool filtering = false;
 static std::regex filter{};
+static PrefixFilter pfilter{};
+static std::chrono::system_clock::time_point pktTime{};  // arrival time of the packet being handled
 
 static Dissect di;
 
@@ -132,7 +167,7 @@ static auto tfmt(durmilli now) {
 }
 
 static auto compactPrint(const uint8_t* d, size_t s, uint16_t sport) {
-    auto now = std::chrono::system_clock::now();
+    auto now = pktTime;
     rName n{};
     const char* ptype{};
     switch (d[0]) {
@@ -184,6 +219,7 @@ static void namePrint(const uint8_t* d, size_t s, uint16_t sport) {
 static void handlePkt(const uint8_t* d, size_t s, uint16_t sport) {
     if (!doInterest && d[0] == 5) return;
     if (!doData && d[0] == 6) return;
+    if (! pfilter.match(d, s)) return;
     if (filtering) {
         auto n = d[0] == 5?  rInterest(d, s).name() : rData(d, s).name();
         if (! std::regex_search(format("{}", n), filter)) return;
@@ -196,15 +232,136 @@ static void handlePkt(const uint8_t* d, size_t s, uint16_t sport) {
 }
 
 static void usage(const char* pname) {
-    std::cerr << "usage: " << pname << " [-f|c|n] [-d|i|a] [regex]>\n";
+    std::cerr << "usage: " << pname << " [-f|c|n|s] [-d|i|a] [-p prefix] [-w file [-C MB] [-W n] | -r file ...] [regex]>\n";
     exit(1);
 }
 
+// statistics mode: per-collection counts for the current 1 second interval
+struct CollStats {
+    std::string name{};         // printable collection name (made when first printed)
+    uint64_t pkts{};
+    uint64_t bytes{};
+    uint64_t cStates{};
+    uint64_t cAdds{};
+    uint64_t pubs{};            // pubs in the cAdds that could be looked into
+    uint64_t cAddsOpen{};       // cAdds that weren't encrypted
+    uint64_t dups{};            // cStates with the same name as one already seen
+    std::unordered_set<size_t> states{};
+};
+struct svHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+};
+static std::unordered_map<std::string,CollStats,svHash,std::equal_to<>> colls{};
+
+static bool printable(tlvParser::Blk b) {
+    for (auto c : b) if (c < 0x20 || c >= 0x7f) return false;
+    return b.size() != 0;
+}
+
+static void statsPkt(const uint8_t* d, size_t s, uint16_t) {
+    if (s == 0 || (d[0] != 5 && d[0] != 6) || (!doInterest && d[0] == 5) || (!doData && d[0] == 6)) return;
+    if (! pfilter.match(d, s)) return;
+    try {
+        rName n = d[0] == 5?  rInterest(d, s).name() : rData(d, s).name();
+        // the collection is the name up to (not including) its iblt and any trailing
+        // SequenceNum (iblt size) or binary (estimator) components
+        std::array<const uint8_t*,32> ends{};
+        size_t nc{};
+        const uint8_t* start{};
+        bool keep[32]{};
+        for (tlvParser nm{n}; ! nm.eof() && nc < ends.size(); ++nc) {
+            auto c = nm.nextBlk();
+            if (! start) start = c.data();
+            ends[nc] = c.data() + c.size();
+            keep[nc] = c.isType(tlv::Generic) && printable(c.rest());
+        }
+        if (nc < 2) return;
+        auto k = nc - 1;    // drop the iblt
+        while (k > 1 && ! keep[k - 1]) --k;
+        std::string_view key((const char*)start, ends[k - 1] - start);
+        auto cs = colls.find(key);
+        if (cs == colls.end()) cs = colls.emplace(std::string(key), CollStats{}).first;
+        auto& c = cs->second;
+        ++c.pkts;
+        c.bytes += s;
+        if (d[0] == 5) {
+            ++c.cStates;
+            if (! c.states.insert(std::hash<tlvParser>{}(n)).second) ++c.dups;
+            return;
+        }
+        ++c.cAdds;
+        auto rd = rData(d, s);
+        if (SigMgr::encryptsContent(rd.sigType())) return;
+        ++c.cAddsOpen;
+        for (const auto p : rd.content()) if (p.isType(6)) ++c.pubs;
+    } catch (const std::exception&) { }
+}
+
+// print the table for the last interval then start a new one
+static void statsPrint() {
+    static const bool tty = isatty(1);
+    if (tty) print("\033[H\033[2J");
+    auto now = std::chrono::system_clock::now();
+    print("{:%H:%M:%S}  {:>7} {:>9} {:>6} {:>6} {:>6} {:>6} {:>6} {:>5}  collection\n",
+          std::chrono::floor<std::chrono::seconds>(now), "pkt/s", "B/s", "cSt/s", "cAdd/s", "cS:cA", "states", "pub/cA", "dup%");
+    for (auto& [k, c] : colls) {
+        if (c.pkts == 0) continue;
+        if (c.name.empty()) {
+            // the key is the collection name's components without the name TLV header
+            std::vector<uint8_t> nv{7};
+            if (k.size() < 253) nv.push_back(k.size());
+            else { nv.push_back(253); nv.push_back(k.size() >> 8); nv.push_back(k.size()); }
+            nv.insert(nv.end(), k.begin(), k.end());
+            c.name = format("{}", rName(nv));
+        }
+        auto ratio = c.cAdds? format("{:.2f}", double(c.cStates) / c.cAdds) : std::string("-");
+        auto ppc = c.cAddsOpen? format("{:.1f}", double(c.pubs) / c.cAddsOpen) : std::string("-");
+        auto dup = c.cStates? 100. * c.dups / c.cStates : 0.;
+        print("          {:>7} {:>9} {:>6} {:>6} {:>6} {:>6} {:>6} {:>5.1f}  {}\n",
+              c.pkts, c.bytes, c.cStates, c.cAdds, ratio, c.states.size(), ppc, dup, c.name);
+        c = CollStats{std::move(c.name)};
+    }
+    if (! tty) print("\n");
+    std::fflush(stdout);
+}
+
+static void statsTimer(boost::asio::steady_timer& t) {
+    t.expires_after(1s);
+    t.async_wait([&t](auto ec) { if (ec) return; statsPrint(); statsTimer(t); });
+}
+
+static Watcher* capWatcher{};
+static std::unique_ptr<PcapRing> ring{};
+
+// capture mode: filter on wire bytes and stash the packet. No parsing or formatting.
+static void capturePkt(const uint8_t* d, size_t s, uint16_t sport) {
+    if (s == 0 || (!doInterest && d[0] == 5) || (!doData && d[0] == 6) || ! pfilter.match(d, s)) return;
+    const auto& aio = capWatcher->aio_;
+    ring->write(d, s, aio.sender_.address().to_v6().to_bytes(), sport, aio.listen_.address().to_v6().to_bytes());
+}
+
 int main(int argc, char* argv[])
 {
     const char* pname = argv[0];
+    std::string capFile{};
+    size_t capMB{64}, capFiles{4};
+    std::vector<std::string> readFiles{};
+    bool statsMode{false};
+    // the current flag's argument
+    auto arg = [&argc, &argv, pname]() -> std::string {
+        if (argv[0][2]) return &argv[0][2];
+        if (--argc <= 0) usage(pname);
+        return *++argv;
+    };
     while (--argc > 0 && **++argv == '-') {
         switch (argv[0][1]) {
+            case 'p': pfilter = PrefixFilter(arg()); break;
+            case 'w': capFile = arg(); break;
+            case 'C': capMB = std::stoul(arg()); break;
+            case 'W': capFiles = std::stoul(arg()); break;
+            case 'r': readFiles.emplace_back(arg()); break;
+            case 's': statsMode = true; break;
             case 'a': doData = true;  doInterest = true; break;
             case 'c': ofmt = oFmt::compact; break;
             case 'd': doData = true;  doInterest = false; break;
@@ -221,7 +378,35 @@ int main(int argc, char* argv[])
         filtering = true;
         filter = std::regex(argv[0]);
     }
-    Watcher watcher(handlePkt);
+    if (readFiles.size()) {
+        try {
+            for (const auto& f : readFiles)
+                readPcap(f, [](const uint8_t* d, size_t s, uint16_t sport, auto t) { pktTime = t; handlePkt(d, s, sport); });
+        } catch (const std::runtime_error& e) { std::cerr << "- error: " << e.what() << '\n'; exit(1); }
+        exit(0);
+    }
+    if (capFile.size()) {
+        if (filtering) std::cerr << "- regex filter ignored when capturing (use -p)\n";
+        ring = std::make_unique<PcapRing>(capFile, capMB << 20, capFiles);
+        Watcher w(capturePkt);
+        capWatcher = &w;
+        boost::asio::signal_set sigs(getDefaultIoContext(), SIGINT, SIGTERM);
+        sigs.async_wait([](auto, int) { getDefaultIoContext().stop(); });
+        w.run();
+        ring->finish();
+        print(std::cerr, "captured {} packets ({} bytes) in {} files\n", ring->pkts_, ring->bytes_, ring->files_);
+        exit(0);
+    }
+    if (statsMode) {
+        if (filtering) std::cerr << "- regex filter ignored in statistics mode (use -p)\n";
+        Watcher w(statsPkt);
+        boost::asio::steady_timer t(getDefaultIoContext());
+        statsTimer(t);
+        w.run();
+        exit(0);
+    }
+    Watcher watcher(
+        [](const uint8_t* d, size_t s, uint16_t sport) { pktTime = std::chrono::system_clock::now(); handlePkt(d, s, sport); });
 
     watcher.run();
     exit(0);
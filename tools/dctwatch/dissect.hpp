@@ -91,6 +91,7 @@ struct Dissect {
         {tlv::ContentType_Nack, {"Nack", true, cFmt::num}},
         {tlv::ContentType_Manifest, {"Manifest", true, cFmt::num}},
         {tlv::ContentType_CAdd, {"CAdd", true, cFmt::num}},
+        {tlv::ContentType_CAddCompact, {"CAddCompact", true, cFmt::num}},
         {tlv(131), {"TrustSchema", true, cFmt::num}},
         {tlv(5), {"PrefixAnn", true, cFmt::num}},
     };
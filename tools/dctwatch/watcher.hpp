@@ -49,8 +49,8 @@ struct AsIO {
     boost::asio::ip::udp::endpoint sender_; // most recent received packet's sender
     boost::asio::ip::udp::socket rsock_;
     // rcv buffer no smaller than 1500 byte MTU - 40 IPv6 - 8 UDP = 1452 payload
-    // but we hope for 9K MTU for local packets.
-    std::array<uint8_t, 8192> rcvbuf_;
+    // and big enough for a 9000 byte jumbo frame.
+    std::array<uint8_t, 9000 - 40 - 8> rcvbuf_;
     onRcv rcb_;
 
     AsIO(boost::asio::io_context& ioc) : rsock_{ioc} { }
@@ -0,0 +1,249 @@
+/*
+ * fuzz_packet - fuzz & benchmark harness for the packet receive path
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+/*
+ * Every input is handed to the code that sees raw network bytes:
+ *   face    DirectFace::rcvCb (DIT, RIT & PIT lookups, syncps's cState handler)
+ *   parse   the rInterest/rData/rName accessors and IBLT::rlDecode
+ *   sync    SyncPS::name2iblt & name2est of an Interest's name, SyncPS::onCAdd of a Data
+ * The face & syncps are on a simulated network (nothing is sent) with null sigmgrs
+ * so validation always succeeds and fuzzed pubs get as far as the collection.
+ * Exceptions thrown for malformed input are the intended way of rejecting it so
+ * they're counted, not reported. Anything else (a crash, sanitizer report or an
+ * exception escaping a noexcept) is a bug.
+ *
+ * State (DIT, PIT, collection) persists across inputs as it would on a real
+ * face so libFuzzer may need a larger -rss_limit_mb for long runs.
+ *
+ * Built two ways (see the Makefile):
+ *   fuzz_packet     (clang++ or afl-clang-fast++) runs each input in the listed
+ *                   files once (stdin if none), reproducing crashes or as an AFL
+ *                   target, or with -b times each stage over the files to check
+ *                   parsing changes for performance regressions.
+ *   fuzz_packet_lf  libFuzzer target (-DDCT_FUZZ -fsanitize=fuzzer). The collection
+ *                   name comes from env var DCT_FUZZ_COLL (default fuzz/pubs).
+ * Input files are pcap captures (e.g., from dctwatch -w) where every packet is an
+ * input, or raw files holding one packet each (libFuzzer/AFL corpus form). -g
+ * writes a seed corpus of a cState, a cAdd and a pub for the collection.
+ */
+#include <getopt.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "dct/format.hpp"
+#include "dct/face/direct.hpp"
+#include "dct/sigmgrs/sigmgr_null.hpp"
+#include "dct/syncps/syncps.hpp"
+#include "dctwatch/capture.hpp"
+
+using namespace dct;
+
+struct Harness {
+    boost::asio::io_context ioc_{};
+    SigMgrNULL wsm_{}, psm_{};
+    DirectFace face_;
+    SyncPS sync_;
+    IBLT<SyncPS::PubHash> iblt_{};
+    size_t rejects_{};      // inputs a stage rejected by throwing
+    size_t sink_{};         // accessor results (so they aren't optimized away)
+
+    Harness(const crName& coll) : face_{"sim:fuzz", ioc_}, sync_{face_, coll, wsm_, psm_} { poll(); }
+
+    // run whatever the input made ready (e.g., the sync's registration). Timers are never run.
+    void poll() { ioc_.restart(); ioc_.poll(); }
+
+    void face(const uint8_t* p, size_t n) {
+        try { face_.rcvCb(p, n); } catch (const std::exception&) { ++rejects_; }
+    }
+
+    void parse(const uint8_t* p, size_t n) {
+        if (rData d(p, n); d.valid()) {
+            try {
+                for (auto c : d.name()) sink_ += c.size();
+                for (auto c : d.content()) sink_ += c.size();
+                sink_ += d.contentType() + d.sigType() + d.signature().size() + d.thumbprint()[0];
+            } catch (const std::exception&) { ++rejects_; }
+        }
+        try {
+            rInterest i(p, n);
+            auto nm = i.name();
+            sink_ += nm.valid() + nm.nBlks() + i.nonce() + i.lifetime().count();
+        } catch (const std::exception&) { ++rejects_; }
+        try { iblt_.reset(IBLT<SyncPS::PubHash>::stsize).rlDecode({p, n}); } catch (const std::exception&) { ++rejects_; }
+    }
+
+    void sync(const uint8_t* p, size_t n) {
+        try {
+            if (tlv(p[0]) == tlv::Interest) {
+                rNameIdx nm{rInterest(p, n).name()};
+                sync_.name2iblt(nm, iblt_);
+                sink_ += sync_.name2est(nm).has_value();
+            } else if (rData d(p, n); tlv(p[0]) == tlv::Data && d.valid()) {
+                sync_.onCAdd(rInterest{}, d);
+            }
+        } catch (const std::exception&) { ++rejects_; }
+    }
+
+    void input(const uint8_t* p, size_t n) {
+        if (n == 0) return;
+        face(p, n);
+        parse(p, n);
+        sync(p, n);
+        poll();
+    }
+};
+
+static crName collection(const char* c) { return crName{c? c : "fuzz/pubs"}; }
+
+#ifdef DCT_FUZZ
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    static Harness h{collection(std::getenv("DCT_FUZZ_COLL"))};
+    h.input(data, size);
+    return 0;
+}
+
+#else // ! DCT_FUZZ
+
+static struct option opts[] {
+    {"bench", no_argument, nullptr, 'b'},
+    {"collection", required_argument, nullptr, 'c'},
+    {"gen", required_argument, nullptr, 'g'},
+    {"reps", required_argument, nullptr, 'n'},
+    {"help", no_argument, nullptr, 'h'}
+};
+
+static auto usage(std::string_view pname) {
+    print("- usage: {} [-b] [-n reps] [-c collection] [-g seed dir] [pcap|packet|dir ...]\n", pname);
+    exit(1);
+}
+
+using Corpus = std::vector<std::vector<uint8_t>>;
+
+static std::vector<uint8_t> readFile(const std::filesystem::path& p) {
+    std::ifstream is(p, std::ios::binary);
+    if (! is) throw std::runtime_error(format("can't open {}", p.string()));
+    return {std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()};
+}
+
+// add file 'p' (a pcap capture or a single packet) or the files in directory 'p' to the corpus
+static void load(Corpus& corpus, const std::filesystem::path& p) {
+    if (std::filesystem::is_directory(p)) {
+        for (const auto& e : std::filesystem::directory_iterator(p)) if (e.is_regular_file()) load(corpus, e.path());
+        return;
+    }
+    auto v = readFile(p);
+    if (uint32_t m; v.size() >= sizeof(m) && (std::memcpy(&m, v.data(), sizeof(m)), m == pcapFmt::magic)) {
+        readPcap(p.string(), [&corpus](auto pkt, auto len, auto, auto) { corpus.emplace_back(pkt, pkt + len); });
+        return;
+    }
+    corpus.emplace_back(std::move(v));
+}
+
+static void writeSeed(const std::filesystem::path& dir, std::string_view nm, std::span<const uint8_t> pkt) {
+    std::ofstream os(dir / nm, std::ios::binary|std::ios::trunc);
+    os.write((const char*)pkt.data(), pkt.size());
+}
+
+// write a cState for a collection of a few pubs, a cAdd carrying them and one of the pubs
+static void genSeeds(Harness& h, const crName& coll, const std::filesystem::path& dir) {
+    std::filesystem::create_directories(dir);
+    std::vector<crData> pubs{};
+    std::vector<uint8_t> content(64, 'x');
+    for (uint64_t k = 0; k < 4; ++k) {
+        crData d(coll/"pub"/k/std::chrono::system_clock::now());
+        d.content(content);
+        static_cast<SigMgr&>(h.psm_).sign(d);
+        pubs.emplace_back(d);
+        h.sync_.publish(std::move(d));
+    }
+    const auto& cs = h.sync_.cState(1);
+    auto cAdd = crData{rName(cs.name()), tlv::ContentType_CAdd}.content(pubs);
+    static_cast<SigMgr&>(h.wsm_).sign(cAdd);
+    writeSeed(dir, "cstate", cs.asSpan());
+    writeSeed(dir, "cadd", cAdd.asSpan());
+    writeSeed(dir, "pub", pubs[0].asSpan());
+}
+
+using nsecs = std::chrono::duration<double,std::nano>;
+
+// time 'stage' over 'reps' passes through the corpus, reporting ns/packet and MB/s
+static void bench(std::string_view nm, const Corpus& corpus, size_t reps, auto&& stage) {
+    size_t bytes{};
+    for (const auto& p : corpus) bytes += p.size();
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < reps; ++r) for (const auto& p : corpus) stage(p.data(), p.size());
+    nsecs dt = std::chrono::steady_clock::now() - t0;
+    print("{:>6}: {:8.0f} ns/pkt {:8.1f} MB/s\n", nm, dt.count() / (reps * corpus.size()), bytes * reps * 1e3 / dt.count());
+}
+
+int main(int argc, char* const* argv) {
+    bool timeit{false};
+    size_t reps{100};
+    const char* coll{};
+    const char* seeds{};
+
+    for (int c; (c = getopt_long(argc, argv, "bc:g:n:h", opts, nullptr)) != -1; ) {
+        switch (c) {
+            case 'b': timeit = true; break;
+            case 'c': coll = optarg; break;
+            case 'g': seeds = optarg; break;
+            case 'n':
+                reps = std::stoul(optarg);
+                if (reps == 0) usage(argv[0]);
+                break;
+            default: usage(argv[0]);
+        }
+    }
+    auto cn = collection(coll);
+    Harness h{cn};
+    if (seeds) {
+        genSeeds(h, cn, seeds);
+        exit(0);
+    }
+    Corpus corpus{};
+    if (optind >= argc) {
+        corpus.emplace_back(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+    }
+    for (int i = optind; i < argc; ++i) load(corpus, argv[i]);
+    std::erase_if(corpus, [](const auto& p) { return p.empty(); });
+    if (corpus.empty()) usage(argv[0]);
+
+    if (! timeit) {
+        for (const auto& p : corpus) h.input(p.data(), p.size());
+        print("{} inputs, {} rejects\n", corpus.size(), h.rejects_);
+        exit(0);
+    }
+    print("{} packets, {} reps\n", corpus.size(), reps);
+    bench("parse", corpus, reps, [&h](auto p, auto n) { h.parse(p, n); });
+    bench("sync", corpus, reps, [&h](auto p, auto n) { h.sync(p, n); });
+    bench("face", corpus, reps, [&h](auto p, auto n) { h.face(p, n); h.poll(); });
+    exit(0);
+}
+
+#endif // ! DCT_FUZZ
@@ -0,0 +1,187 @@
+/*
+ *  sync_sim - measure syncps convergence with many peers on a simulated network
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+/*
+ * Runs 'npeers' SyncPS instances in this process, each with its own face on a
+ * shared simulated network (see dct/face/sim_net.hpp) with the given loss,
+ * delay, jitter (reordering) and mtu. Each peer publishes 'npubs' pubs of
+ * 'size' content bytes, one every 'interval' ms. The run ends when every pub
+ * has reached every other peer or after 'timeout' seconds. The report gives
+ * the time to convergence (first publish to last delivery), per-pub
+ * latencies, the cStates & cAdds sent, network bytes per delivered pub and
+ * the iblt peel failure rate. With -a the peers use adaptive timing (see
+ * dct/syncps/adaptive_timing.hpp) and the timing peer 0 adapted to is shown.
+ * It measures sync itself (pubs and wire packets use NULL sigmgrs) and,
+ * since pub lifetimes come from the system clock, runs in real time.
+ */
+#include <getopt.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "dct/format.hpp"
+#include "dct/face/direct.hpp"
+#include "dct/sigmgrs/sigmgr_null.hpp"
+#include "dct/syncps/syncps.hpp"
+
+using namespace dct;
+using namespace std::literals::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+static struct option opts[] {
+    {"peers", required_argument, nullptr, 'n'},
+    {"pubs", required_argument, nullptr, 'p'},
+    {"interval", required_argument, nullptr, 'i'},
+    {"size", required_argument, nullptr, 's'},
+    {"loss", required_argument, nullptr, 'l'},
+    {"delay", required_argument, nullptr, 'd'},
+    {"jitter", required_argument, nullptr, 'j'},
+    {"mtu", required_argument, nullptr, 'm'},
+    {"lifetime", required_argument, nullptr, 'L'},
+    {"timeout", required_argument, nullptr, 't'},
+    {"adaptive", no_argument, nullptr, 'a'},
+    {"help", no_argument, nullptr, 'h'}
+};
+
+static auto usage(std::string_view pname) {
+    print("- usage: {} [-n peers] [-p pubs/peer] [-i interval ms] [-s size] [-l loss] [-d delay ms]\n"
+          "       [-j jitter ms] [-m mtu] [-L pub lifetime ms] [-t timeout s] [-a]\n", pname);
+    exit(1);
+}
+
+struct Peer {
+    DirectFace face_;
+    SyncPS sync_;
+    Peer(boost::asio::io_context& ioc, SigMgr& wsm, SigMgr& psm) :
+        face_{"sim:syncSim", ioc}, sync_{face_, crName{"syncSim"}/"wire", wsm, psm} { }
+};
+
+struct PubState {
+    Clock::time_point t0;
+    size_t need;            // peers that haven't got it yet
+};
+
+int main(int argc, char* argv[]) {
+    size_t npeers{4}, npubs{10}, size{100};
+    std::chrono::milliseconds interval{50}, lifetime{maxPubLifetime};
+    std::chrono::seconds timeout{10};
+    bool adaptive{false};
+    SimNet::Params np{};
+    np.delay = 1ms;
+    for (int c; (c = getopt_long(argc, argv, "n:p:i:s:l:d:j:m:L:t:ah", opts, nullptr)) != -1; ) {
+        switch (c) {
+            case 'n': npeers = std::stoul(optarg); break;
+            case 'p': npubs = std::stoul(optarg); break;
+            case 'i': interval = std::chrono::milliseconds(std::stoul(optarg)); break;
+            case 's': size = std::stoul(optarg); break;
+            case 'l': np.loss = std::stod(optarg); break;
+            case 'd': np.delay = std::chrono::microseconds(int64_t(std::stod(optarg) * 1e3)); break;
+            case 'j': np.jitter = std::chrono::microseconds(int64_t(std::stod(optarg) * 1e3)); break;
+            case 'm': np.mtu = std::stoul(optarg); break;
+            case 'L': lifetime = std::chrono::milliseconds(std::stoul(optarg)); break;
+            case 't': timeout = std::chrono::seconds(std::stoul(optarg)); break;
+            case 'a': adaptive = true; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (npeers < 2) usage(argv[0]);
+
+    auto& ioc = getDefaultIoContext();
+    auto& net = SimNet::get("syncSim").params(np);
+    SigMgrNULL wsm{}, psm{};
+    SigMgr& pubSigner = psm;
+    const auto pubPre = crName{"syncSim"}/"pub";
+
+    std::map<std::vector<uint8_t>,PubState> pubs{};
+    std::vector<double> lat{};      // per-pub ms from publish to its last delivery
+    size_t delivered{}, expected = npeers * npubs * (npeers - 1);
+    Clock::time_point start{}, last{};
+    auto finish = [&ioc]{ ioc.stop(); };
+
+    std::vector<std::unique_ptr<Peer>> peers{};
+    for (size_t i = 0; i < npeers; ++i) {
+        auto& p = *peers.emplace_back(std::make_unique<Peer>(ioc, wsm, psm));
+        p.sync_.pubLifetime(lifetime);
+        if (adaptive) p.sync_.adaptiveTiming();
+        p.sync_.subscribe(pubPre, [&](const rPub& pub) {
+                auto k = std::vector<uint8_t>(pub.name().asSpan().begin(), pub.name().asSpan().end());
+                auto ps = pubs.find(k);
+                if (ps == pubs.end()) return;
+                last = Clock::now();
+                ++delivered;
+                if (--ps->second.need == 0)
+                    lat.push_back(std::chrono::duration<double,std::milli>(last - ps->second.t0).count());
+                if (delivered == expected) finish();
+            });
+    }
+
+    // each peer publishes its next pub every 'interval'
+    std::vector<uint8_t> content(size, 'x');
+    std::function<void(size_t,size_t)> pub = [&](size_t i, size_t n) {
+        crData d(pubPre/uint64_t(i)/uint64_t(n)/std::chrono::system_clock::now(), content.size());
+        d.content(content);
+        pubSigner.sign(d);
+        pubs.emplace(std::vector<uint8_t>(d.name().asSpan().begin(), d.name().asSpan().end()),
+                     PubState{Clock::now(), npeers - 1});
+        peers[i]->sync_.publish(std::move(d));
+        if (n + 1 < npubs) peers[i]->face_.oneTime(interval, [&pub, i, n]{ pub(i, n + 1); });
+    };
+    // start publishing once all the peers are registered and running
+    peers[0]->face_.oneTime(100ms, [&] {
+            start = Clock::now();
+            for (size_t i = 0; i < npeers; ++i) pub(i, 0);
+        });
+    peers[0]->face_.oneTime(timeout, finish);
+    ioc.run();
+
+    uint64_t csOut{}, caOut{}, peelOk{}, peelFail{};
+    for (const auto& p : peers) {
+        const auto& s = p->sync_.stats();
+        csOut += s.cStatesOut.get();
+        caOut += s.cAddsOut.get();
+        peelOk += s.peelOk.get();
+        peelFail += s.peelFail.get();
+    }
+    std::ranges::sort(lat);
+    auto pct = [&lat](double q) { return lat.empty()? 0. : lat[std::min(lat.size() - 1, size_t(q * lat.size()))]; };
+    double mean{};
+    for (auto l : lat) mean += l;
+    if (lat.size()) mean /= lat.size();
+    const auto& ns = net.stats();
+
+    print("{} peers, {} pubs/peer of {} bytes every {}ms; loss {} delay {}us jitter {}us mtu {}\n",
+          npeers, npubs, size, interval.count(), np.loss, np.delay.count(), np.jitter.count(), np.mtu);
+    print("delivered {} of {} ({} of {} pubs everywhere)\n", delivered, expected, lat.size(), npeers * npubs);
+    print("time to convergence: {:.1f}ms\n", delivered? std::chrono::duration<double,std::milli>(last - start).count() : 0.);
+    print("pub latency ms: mean {:.1f} p50 {:.1f} p90 {:.1f} max {:.1f}\n", mean, pct(.5), pct(.9), lat.empty()? 0. : lat.back());
+    print("sent: cStates {} cAdds {} | net pkts {} bytes {} lost {} too big {}\n",
+          csOut, caOut, ns.pktsSent, ns.bytesSent, ns.lost, ns.tooBig);
+    print("bytes per delivered pub: {:.1f}\n", delivered? double(ns.bytesSent) / delivered : 0.);
+    print("peel failure rate: {:.3f} ({} of {})\n", peelOk + peelFail? double(peelFail) / (peelOk + peelFail) : 0.,
+          peelFail, peelOk + peelFail);
+    if (adaptive) print("peer 0 timing: {}\n", peers[0]->sync_.adaptiveStats()->str());
+    exit(delivered == expected? 0 : 1);
+}
@@ -1,5 +1,7 @@
 /*
- *  time_hashing <bundle> - time signing & validation of bundle's sigmgr
+ *  time_hashing - time the hashes used by DCT: ndn-ind's & DCT's murmurHash3 (IBLT::hashobj),
+ *                 its multi-buffer form (IBLT::hashobjs, checked against the scalar one),
+ *                 wyhash (names, interests & DIT) and std::hash<u8string_view> (what names used to use)
  *
  * Copyright (C) 2021-2 Pollere LLC
  *
@@ -23,8 +25,10 @@
 #include <getopt.h>
 #include <algorithm>
 #include <random>
+#include <string_view>
 #include <ndn-ind/lite/util/crypto-lite.hpp>
 #include "murmurHash3.hpp"
+#include "wyhash.hpp"
 #include "dct/format.hpp"
 
 using namespace dct;
@@ -39,21 +43,46 @@ static auto usage(std::string_view pname) {
     exit(1);
 }
 
+static volatile uint64_t sink;
+
 static auto timeSM(const auto& rdat, const auto maxsize, const auto niter) {
     //ndn::Data pub{ndn::Name("/test/sigmgr/timing/padMult32.").appendTimestamp(std::chrono::system_clock::now())};
     murmurHash3 mh{};
+    wyHash wh{};
+    std::hash<std::u8string_view> sh{};
 
+    print("size : same-mh3 ndn-mh3 mh3 same-mh3x{0} mh3x{0} wyhash std::hash (usec per hash)\n", murmurHash3::lanes);
     auto incr = maxsize / 128;
     if (incr < 1) incr = 1;
     for (auto sz = incr; sz <= maxsize; sz += incr) {
         uint32_t h1, h2;
+        uint64_t h3{}, h4{};
         auto strt = std::chrono::system_clock::now();
         for (auto i = 0u; i < niter; i++) { h1 = ndn::CryptoLite::murmurHash3(0x53a1df9a, rdat, sz); }
         auto cpy = std::chrono::system_clock::now();
         for (auto i = 0u; i < niter; i++) { h2 = mh(0x53a1df9a, rdat, sz); }
         auto fins = std::chrono::system_clock::now();
+        // 'lanes' buffers at different offsets (the pubs of a cAdd), hashed together
+        constexpr int L = murmurHash3::lanes;
+        uint32_t seed[L], hN[L];
+        const uint8_t* d[L];
+        int len[L];
+        for (int j = 0; j < L; j++) { seed[j] = 0x53a1df9a; d[j] = rdat + j * 8; len[j] = sz; }
+        auto mbs = std::chrono::system_clock::now();
+        for (auto i = 0u; i < niter / L; i++) { murmurHash3::hashN(seed, d, len, hN, L); }
+        auto mbf = std::chrono::system_clock::now();
+        bool mbOk{true};
+        for (int j = 0; j < L; j++) mbOk &= hN[j] == mh(seed[j], d[j], len[j]);
+        // the results are accumulated so the loops can't be optimized away
+        auto wys = std::chrono::system_clock::now();
+        for (auto i = 0u; i < niter; i++) { h3 += wh(rdat, sz, i); }
+        auto wyf = std::chrono::system_clock::now();
+        for (auto i = 0u; i < niter; i++) { h4 += sh({(const char8_t*)rdat, sz}); }
+        auto stdf = std::chrono::system_clock::now();
         using ticks = std::chrono::duration<double,std::ratio<1,1000000>>;
-        print("{} : {} {} {}\n", sz, h1 == h2, ticks(cpy - strt)/double(niter), ticks(fins - cpy)/double(niter));
+        sink = h3 ^ h4;
+        print("{} : {} {} {} {} {} {} {}\n", sz, h1 == h2, ticks(cpy - strt)/double(niter), ticks(fins - cpy)/double(niter),
+              mbOk, ticks(mbf - mbs)/double(niter / L * L), ticks(wyf - wys)/double(niter), ticks(stdf - wyf)/double(niter));
     }
 }
 
@@ -82,7 +111,8 @@ int main(int argc, char* const* argv) {
 
     std::random_device rd;
     m_randGen.seed(rd());
-    std::vector<uint64_t> rdat(maxsize/sizeof(uint64_t));
+    // (room for the multi-buffer hash's buffers at 8 byte offsets)
+    std::vector<uint64_t> rdat(maxsize/sizeof(uint64_t) + murmurHash3::lanes);
 
     std::generate(rdat.begin(), rdat.end(), [&m_randDist,&m_randGen]{return m_randDist(m_randGen);});
 
@@ -0,0 +1,175 @@
+/*
+ *  time_iblt - time syncps IBLT insert, difference and peel operations
+ *
+ * Copyright (C) 2022 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+#include <getopt.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include "dct/format.hpp"
+#include "dct/syncps/iblt.hpp"
+
+using namespace dct;
+
+static struct option opts[] {
+    {"niter", required_argument, nullptr, 'n'},
+    {"npubs", required_argument, nullptr, 'p'}
+};
+
+static auto usage(std::string_view pname) {
+    print("- usage: {} [-n niter] [-p npubs]\n", pname);
+    exit(1);
+}
+
+/*
+ * The original IBLT table layout & hashing (array of entries, '%' indexing
+ * and a keyCheck hash per sub-table) for comparison with the current one.
+ */
+template<size_t stsize>
+struct refIBLT {
+    static constexpr size_t nEntries = stsize * 3;
+    static constexpr size_t N_HASHCHECK{0x53a1df9a};
+    static constexpr murmurHash3 mh3{};
+    struct HashTableEntry { int32_t count; uint32_t keySum; uint32_t keyCheck; };
+    std::array<HashTableEntry,nEntries> hashTable_{};
+
+    auto hash(size_t key) const noexcept {
+        auto h = mh3(key);
+        return std::tuple{(h % stsize) * 3, ((h >> 8) % stsize) * 3 + 1, ((h >> 16) % stsize) * 3 + 2};
+    }
+    void update1(int plusOrMinus, uint32_t key, size_t idx) {
+        HashTableEntry& entry = hashTable_.at(idx);
+        entry.count += plusOrMinus;
+        entry.keySum ^= key;
+        entry.keyCheck ^= mh3(uint64_t(key) | (N_HASHCHECK << 32));
+    }
+    void insert(uint32_t key) {
+        const auto [hash0, hash1, hash2] = hash(key);
+        update1(1, key, hash0);
+        update1(1, key, hash1);
+        update1(1, key, hash2);
+    }
+    refIBLT operator-(const refIBLT& other) const {
+        refIBLT result(*this);
+        for (size_t i = 0; i < nEntries; i++) {
+            HashTableEntry& e1 = result.hashTable_.at(i);
+            const HashTableEntry& e2 = other.hashTable_.at(i);
+            e1.count -= e2.count;
+            e1.keySum ^= e2.keySum;
+            e1.keyCheck ^= e2.keyCheck;
+        }
+        return result;
+    }
+};
+
+using ticks = std::chrono::duration<double,std::ratio<1,1000000>>;
+static inline auto now() { return std::chrono::steady_clock::now(); }
+
+template<size_t stsize>
+static void timeIBLT(const std::vector<uint32_t>& keys, size_t niter) {
+    using newIBLT = IBLT<uint32_t>;
+    refIBLT<stsize> ra{}, rb{};
+    newIBLT na{stsize}, nb{stsize}, scratch{};
+
+    // inserts (the first half of the keys go in both tables, the rest in only 'a')
+    auto t0 = now();
+    for (size_t n = 0; n < niter; n++) for (auto k : keys) ra.insert(k);
+    auto t1 = now();
+    for (size_t n = 0; n < niter; n++) for (auto k : keys) na.insert(k);
+    auto t2 = now();
+    // (keep the compiler from optimizing away the insert loops)
+    volatile int32_t keep = ra.hashTable_[keys.size() % ra.nEntries].count + na.entry(0).count;
+    (void)keep;
+    auto insRef = ticks(t1 - t0).count() / double(niter * keys.size());
+    auto insNew = ticks(t2 - t1).count() / double(niter * keys.size());
+
+    ra = refIBLT<stsize>{};
+    na.reset(stsize);
+    for (size_t i = 0; i < keys.size(); i++) {
+        ra.insert(keys[i]); na.insert(keys[i]);
+        if (i < keys.size() / 2) { rb.insert(keys[i]); nb.insert(keys[i]); }
+    }
+    // check that both layouts produce the same table (i.e., are wire compatible)
+    bool same{true};
+    for (size_t i = 0; i < na.nEntries(); i++) {
+        auto e = na.entry(i);
+        const auto& r = ra.hashTable_[i];
+        same &= e.count == r.count && e.keySum == r.keySum && e.keyCheck == r.keyCheck;
+    }
+
+    // differences
+    uint32_t sink{};
+    t0 = now();
+    for (size_t n = 0; n < niter; n++) { auto d = ra - rb; sink += d.hashTable_[n % d.nEntries].keySum; }
+    t1 = now();
+    for (size_t n = 0; n < niter; n++) { scratch.assignDiff(na, nb); sink += scratch.keySum_[n % scratch.nEntries()]; }
+    t2 = now();
+    auto difRef = ticks(t1 - t0).count() / double(niter);
+    auto difNew = ticks(t2 - t1).count() / double(niter);
+
+    // peels (set-based vs allocation-free)
+    size_t npeeled{};
+    t0 = now();
+    for (size_t n = 0; n < niter; n++) npeeled += (na - nb).peel().first.size();
+    t1 = now();
+    for (size_t n = 0; n < niter; n++) {
+        newIBLT::HashBuf have, need;
+        (na - nb).peel(have, need, scratch);
+        npeeled += have.size();
+    }
+    t2 = now();
+    auto peelSet = ticks(t1 - t0).count() / double(niter);
+    auto peelBuf = ticks(t2 - t1).count() / double(niter);
+
+    print("{} : {} {:.4f} {:.4f} {:.4f} {:.4f} {:.3f} {:.3f} {}\n", stsize, same, insRef, insNew,
+          difRef, difNew, peelSet, peelBuf, (npeeled + sink) != 0);
+}
+
+int main(int argc, char* const* argv) {
+    size_t niter{1024*64};
+    size_t npubs{40};
+
+    for (int c; (c = getopt_long(argc, argv, "n:p:", opts, nullptr)) != -1; ) {
+        switch (c) {
+            case 'n':
+                niter = std::stoul(optarg);
+                if (niter <= 0) usage(argv[0]);
+                break;
+            case 'p':
+                npubs = std::stoul(optarg);
+                if (npubs <= 0) usage(argv[0]);
+                break;
+        }
+    }
+    std::minstd_rand randGen{};
+    std::random_device rd;
+    randGen.seed(rd());
+    std::vector<uint32_t> keys(npubs);
+    std::generate(keys.begin(), keys.end(), [&randGen]{ return uint32_t(randGen()); });
+
+    // times are in microseconds: insert time is per key, others are per operation
+    print("stsize : same insRef insNew diffRef diffNew peelSet peelBuf\n");
+    timeIBLT<19>(keys, niter);
+    timeIBLT<29>(keys, niter);
+    timeIBLT<37>(keys, niter);
+    exit(0);
+}
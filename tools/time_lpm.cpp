@@ -0,0 +1,111 @@
+/*
+ *  time_lpm - time longest-prefix-match lookups of the lpmLT match strategies
+ *
+ * Copyright (C) 2022 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+#include <getopt.h>
+#include <chrono>
+#include <random>
+#include "dct/format.hpp"
+#include "dct/face/lpm.hpp"
+
+using namespace dct;
+
+static struct option opts[] {
+    {"niter", required_argument, nullptr, 'n'}
+};
+
+static auto usage(std::string_view pname) {
+    print("- usage: {} [-n niter]\n", pname);
+    exit(1);
+}
+
+using ticks = std::chrono::duration<double,std::ratio<1,1000000>>;
+static inline auto now() { return std::chrono::steady_clock::now(); }
+
+/*
+ * Build 'nprefix' subscription-like topic prefixes of 2 to 5 components
+ * under a common 3 component collection prefix plus a set of pub names,
+ * most of which match one of the prefixes.
+ */
+struct testSet {
+    std::vector<crPrefix> prefixes_{};
+    std::vector<crName> names_{};
+
+    testSet(size_t nprefix, std::minstd_rand& rg) {
+        const crName base{"/localnet/hmIot/pubs"};
+        auto comp = [&rg](size_t n) { return format("c{}", rg() % n); };
+        for (size_t i = 0; prefixes_.size() < nprefix; ++i) {
+            auto p = base/format("t{}", i % (nprefix / 4 + 1));
+            for (auto n = rg() % 4; n > 0; --n) p = std::move(p)/comp(8);
+            prefixes_.emplace_back(p);
+        }
+        for (size_t i = 0; i < 1024; ++i) {
+            auto n = base/format("t{}", rg() % (nprefix / 4 + 2));
+            for (auto c = 2 + rg() % 4; c > 0; --c) n = std::move(n)/comp(8);
+            names_.emplace_back(std::move(n)/std::chrono::system_clock::now());
+        }
+    }
+};
+
+template<typename Index>
+static auto timeLM(const testSet& ts, size_t niter, std::vector<size_t>& res) {
+    lpmLT<crPrefix,size_t,Index> lt{};
+    for (size_t i = 0; i < ts.prefixes_.size(); ++i) lt.add(crPrefix{ts.prefixes_[i]}, i);
+    res.clear();
+    for (const auto& n : ts.names_) {
+        auto it = lt.findLM(rName{n});
+        res.emplace_back(lt.found(it)? it->second : ~0ul);
+    }
+    size_t sink{};
+    auto t0 = now();
+    for (size_t k = 0; k < niter; k++) {
+        for (const auto& n : ts.names_) if (auto it = lt.findLM(rName{n}); lt.found(it)) sink += it->second;
+    }
+    auto t1 = now();
+    return std::pair{ticks(t1 - t0).count() / double(niter * ts.names_.size()), sink};
+}
+
+int main(int argc, char* const* argv) {
+    size_t niter{256};
+
+    for (int c; (c = getopt_long(argc, argv, "n:", opts, nullptr)) != -1; ) {
+        switch (c) {
+            case 'n':
+                niter = std::stoul(optarg);
+                if (niter <= 0) usage(argv[0]);
+                break;
+        }
+    }
+    std::minstd_rand randGen{};
+    std::random_device rd;
+    randGen.seed(rd());
+
+    // times are in microseconds per findLM
+    print("nprefix : same bySize hashed\n");
+    for (size_t np : {10, 100, 1000}) {
+        testSet ts{np, randGen};
+        std::vector<size_t> r1{}, r2{};
+        auto [t1, s1] = timeLM<lpmBySize>(ts, niter, r1);
+        auto [t2, s2] = timeLM<lpmHashed>(ts, niter, r2);
+        print("{} : {} {:.4f} {:.4f}\n", np, r1 == r2 && s1 == s2, t1, t2);
+    }
+    exit(0);
+}
@@ -33,11 +33,13 @@ static struct option opts[] {
     {"wire", required_argument, nullptr, 'w'},
     {"type", required_argument, nullptr, 't'},
     {"niter", required_argument, nullptr, 'n'},
-    {"maxsize", required_argument, nullptr, 'm'}
+    {"maxsize", required_argument, nullptr, 'm'},
+    {"direct", no_argument, nullptr, 'd'}
 };
 
 static auto usage(std::string_view pname) {
-    print("- usage: {} [-m maxsize] [-n niter] -p bundle | -w bundle | -t type\n", pname);
+    print("- usage: {} [-d] [-m maxsize] [-n niter] -p bundle | -w bundle | -t type\n"
+          "  -d  call the sigmgr directly (via SigMgrAny::visit) rather than through SigMgr&\n", pname);
     exit(1);
 }
 
@@ -47,11 +49,14 @@ static auto makeAEADkey() {
     return key;
 }
 
-static auto timeSM(SigMgr& sm, auto rdat, const auto niter) {
-    if (sm.type() == SigMgr::stAEAD) {
+// 'SM' is SigMgr (virtual calls) or a concrete sigmgr type (direct calls) so the
+// difference of the two shows the cost of virtual dispatch
+template<typename SM>
+static auto timeSM(SM& sm, auto rdat, const auto niter) {
+    if (sm.groupKey() && ! sm.needsKey()) {
         // To handle encrypting/decrypting sigmgr which changes pubs
         // have to copy the pub in the loop and account for the copy cost.
-        sm.addKey(makeAEADkey(), std::chrono::duration_cast<std::chrono::microseconds>(
+        static_cast<SigMgr&>(sm).addKey(makeAEADkey(), std::chrono::duration_cast<std::chrono::microseconds>(
                         std::chrono::system_clock::now().time_since_epoch()).count());
     }
     auto incr = rdat.size() / 128;
@@ -63,9 +68,9 @@ static auto timeSM(SigMgr& sm, auto rdat, const auto niter) {
         auto strt = std::chrono::system_clock::now();
         for (auto i = 0u; i < niter; i++) { auto p2 = pub; p2.content(ss); }
         auto cpy = std::chrono::system_clock::now();
-        for (auto i = 0u; i < niter; i++) { auto p2 = pub; p2.content(ss); sm.sign(p2); }
+        for (auto i = 0u; i < niter; i++) { auto p2 = pub; p2.content(ss); sm.sign(p2, sm.m_sigInfo, sm.m_signingKey); }
         pub.content(ss);
-        sm.sign(pub);
+        sm.sign(pub, sm.m_sigInfo, sm.m_signingKey);
         auto fins = std::chrono::system_clock::now();
         for (auto i = 0u; i < niter; i++) { auto p2 = pub; sm.validateDecrypt(p2); }
         auto finv = std::chrono::system_clock::now();
@@ -84,8 +89,12 @@ int main(int argc, char* const* argv) {
 
     dct::DCTmodel* dm{};
     SigMgrAny* sm;
-    for (int c; (c = getopt_long(argc, argv, "n:p:s:t:w:", opts, nullptr)) != -1; ) {
+    bool direct{false};
+    for (int c; (c = getopt_long(argc, argv, "dm:n:p:s:t:w:", opts, nullptr)) != -1; ) {
         switch (c) {
+            case 'd':
+                direct = true;
+                break;
             case 'm':
                 maxsize = std::stoul(optarg);
                 if (maxsize <= 0) usage(argv[0]);
@@ -119,7 +128,9 @@ int main(int argc, char* const* argv) {
     std::generate(rdat.begin(), rdat.end(), [&m_randDist,&m_randGen]{return m_randDist(m_randGen);});
 
     try {
-        timeSM(sm->ref(), std::span{(const uint8_t*)rdat.data(), rdat.size()*sizeof(*rdat.data())}, niter);
+        std::span rs{(const uint8_t*)rdat.data(), rdat.size()*sizeof(*rdat.data())};
+        if (direct) sm->visit([&](auto& s) { timeSM(s, rs, niter); });
+        else timeSM(sm->ref(), rs, niter);
     } catch (const std::runtime_error& se) { print("error: {}\n", se.what()); }
 
     exit(0);
@@ -0,0 +1,196 @@
+/*
+ *  time_tables - time the operations of the face's tables (lpmLT, PIT and DIT)
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+/*
+ * A performance check for changes to face/lpm.hpp and face/lpm_tables.hpp.
+ * Names have the shapes the face sees:
+ *   hmIot pubs    iot1/<target>/<topic>/<trgtLoc>/<topicArgs>/<origin>/<msgID>/<sCnt>/<mts>
+ *   office pubs   office/<func>/<topic>/<loc>/<args>/<msgID>/<sCnt>/<mts>
+ *   cStates       <8 byte schema thumbprint>/<domain>/pubs/<iblt> (iblt of 'ibltSz' bytes)
+ * Subscription prefixes are the first 2 to 4 pub name components. For each
+ * table size it reports nanoseconds per operation:
+ *   lpmLT (bySize, used by the RIT, and hashed, used by the PIT): add, findLM
+ *       of pub names against subscription prefixes, findAll of a
+ *       topic prefix over a table of pub names, erase
+ *   DIT: dupInterest + add of cState interests (a ring of 'size' entries)
+ *   PIT: add, find then itoCB (timeout) of cState interests
+ */
+#include <getopt.h>
+#include <chrono>
+#include <random>
+#include "dct/format.hpp"
+#include "dct/face/lpm_tables.hpp"
+#include "dct/schema/crpacket.hpp"
+
+using namespace dct;
+
+static struct option opts[] {
+    {"niter", required_argument, nullptr, 'n'},
+    {"iblt", required_argument, nullptr, 'b'},
+    {"help", no_argument, nullptr, 'h'}
+};
+
+static auto usage(std::string_view pname) {
+    print("- usage: {} [-n niter] [-b iblt bytes]\n", pname);
+    exit(1);
+}
+
+using nsecs = std::chrono::duration<double,std::nano>;
+static inline auto now() { return std::chrono::steady_clock::now(); }
+
+static std::minstd_rand rg{};
+
+template<typename T>
+static const T& pick(const std::vector<T>& v) { return v[rg() % v.size()]; }
+
+static const std::vector<std::string> targets{"lock", "light", "hvac", "door", "camera", "sensor"};
+static const std::vector<std::string> topics{"event", "status", "command"};
+static const std::vector<std::string> locs{"all", "frontdoor", "gate", "backdoor", "room1", "room2", "room3", "hall"};
+static const std::vector<std::string> args{"on", "off", "locked", "unlocked", "report", "battery_low"};
+
+static crName iotPub() {
+    return crName{"iot1"}/pick(targets)/pick(topics)/pick(locs)/pick(args)/format("dev{}", rg() % 64)
+            /uint64_t(rg())/uint64_t(rg() & 0xffff)/std::chrono::system_clock::now();
+}
+static crName officePub() {
+    return crName{"office"}/pick(targets)/pick(topics)/pick(locs)/pick(args)
+            /uint64_t(rg())/uint64_t(rg() & 0xffff)/std::chrono::system_clock::now();
+}
+static crName cState(size_t ibltSz) {
+    std::vector<uint8_t> tp(8), iblt(ibltSz);
+    for (auto& b : tp) b = rg();
+    for (auto& b : iblt) b = rg();
+    return crName{}/std::span<const uint8_t>(tp)/"iot1"/"pubs"/std::span<const uint8_t>(iblt);
+}
+
+// the first 'n' components of 'nm'
+static crPrefix prefixOf(const crName& nm, size_t n) {
+    crName p{};
+    for (size_t i = 0; i < n; ++i) p = std::move(p)/nm.nthBlk(i).toSv();
+    return crPrefix{p};
+}
+
+struct timing {
+    double add, findLM, findAll, erase;
+};
+
+template<typename Index>
+static timing timeLT(size_t size, size_t niter) {
+    std::vector<crName> names{};
+    std::vector<crPrefix> subs{};
+    for (size_t i = 0; i < size; ++i) {
+        names.emplace_back(i & 1? officePub() : iotPub());
+        subs.emplace_back(prefixOf(names.back(), 2 + rg() % 3));
+    }
+    timing t{};
+    size_t sink{};
+    for (size_t k = 0; k < niter; ++k) {
+        lpmLT<crPrefix,size_t,Index> lt{};
+        auto t0 = now();
+        for (size_t i = 0; i < size; ++i) lt.add(crPrefix{subs[i]}, i);
+        auto t1 = now();
+        for (const auto& n : names) if (auto it = lt.findLM(rName{n}); lt.found(it)) sink += it->second;
+        auto t2 = now();
+        for (size_t i = 0; i < size; ++i) lt.erase(rPrefix(subs[i]));
+        auto t3 = now();
+        t.add += nsecs(t1 - t0).count();
+        t.findLM += nsecs(t2 - t1).count();
+        t.erase += nsecs(t3 - t2).count();
+
+        // findAll of topic prefixes over a table of pub names (like a PIT lookup of a cState's collection)
+        lpmLT<crPrefix,size_t,Index> pt{};
+        for (size_t i = 0; i < size; ++i) pt.add(crPrefix{names[i]}, i);
+        auto t4 = now();
+        for (size_t i = 0; i < size; ++i) pt.findAll(rPrefix(prefixOf(names[i], 3)), [&sink](const auto& kv){ sink += kv.second; });
+        t.findAll += nsecs(now() - t4).count();
+    }
+    auto n = double(size * niter);
+    if (sink == 0) print("(no matches)\n");
+    return {t.add / n, t.findLM / n, t.findAll / n, t.erase / n};
+}
+
+static double timeDIT(size_t size, size_t niter, size_t ibltSz) {
+    std::vector<crInterest> is{};
+    for (size_t i = 0; i < 2 * size; ++i) is.emplace_back(cState(ibltSz), std::chrono::milliseconds(2000));
+    DIT dit(size);
+    size_t dups{};
+    auto t0 = now();
+    for (size_t k = 0; k < niter; ++k) {
+        for (const auto& i : is) {
+            auto [dup, h] = dit.dupInterest(i);
+            if (dup) { ++dups; continue; }
+            dit.add(h);
+        }
+    }
+    auto t = nsecs(now() - t0).count() / double(is.size() * niter);
+    if (dups == ~0ul) print("\n");
+    return t;
+}
+
+static std::pair<double,double> timePIT(size_t size, size_t niter, size_t ibltSz) {
+    std::vector<crInterest> is{};
+    for (size_t i = 0; i < size; ++i) is.emplace_back(cState(ibltSz), std::chrono::milliseconds(2000));
+    double ta{}, tt{};
+    PktPool pool{};
+    for (size_t k = 0; k < niter; ++k) {
+        PIT pit{pool};
+        auto t0 = now();
+        for (const auto& i : is) pit.add(i);
+        auto t1 = now();
+        for (const auto& i : is) if (pit.found(pit.find(rPrefix(i.name())))) pit.itoCB(i);
+        auto t2 = now();
+        ta += nsecs(t1 - t0).count();
+        tt += nsecs(t2 - t1).count();
+    }
+    auto n = double(size * niter);
+    return {ta / n, tt / n};
+}
+
+int main(int argc, char* const* argv) {
+    size_t niter{64}, ibltSz{160};
+
+    for (int c; (c = getopt_long(argc, argv, "n:b:h", opts, nullptr)) != -1; ) {
+        switch (c) {
+            case 'n':
+                niter = std::stoul(optarg);
+                if (niter <= 0) usage(argv[0]);
+                break;
+            case 'b': ibltSz = std::stoul(optarg); break;
+            default: usage(argv[0]);
+        }
+    }
+    std::random_device rd;
+    rg.seed(rd());
+
+    // times are in nanoseconds per operation
+    print("size : lpm bySize add findLM findAll erase | lpm hashed add findLM findAll erase | DIT | PIT add timeout\n");
+    for (size_t sz : {16, 256, 4096}) {
+        auto b = timeLT<lpmBySize>(sz, niter);
+        auto h = timeLT<lpmHashed>(sz, niter);
+        auto d = timeDIT(sz, niter, ibltSz);
+        auto [pa, pt] = timePIT(sz, niter, ibltSz);
+        print("{} : {:.0f} {:.0f} {:.0f} {:.0f} | {:.0f} {:.0f} {:.0f} {:.0f} | {:.0f} | {:.0f} {:.0f}\n", sz,
+              b.add, b.findLM, b.findAll, b.erase, h.add, h.findLM, h.findAll, h.erase, d, pa, pt);
+    }
+    exit(0);
+}
@@ -0,0 +1,125 @@
+/*
+ *  trace_lat - per-topic publish to delivery latencies from syncps trace files
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+/*
+ * Reads the trace files written by dct::traceToFile() (see
+ * dct/syncps/pub_trace.hpp) on any number of nodes and correlates their
+ * events by pub hash. For each topic (the first 'ncomp' components of a pub's
+ * name) it prints latency histograms (microseconds) of:
+ *   made>publish   pub creation (its timestamp) to its local publish
+ *   made>send      creation to its first cAdd
+ *   send>receive   its first cAdd to its arrival at each other node
+ *   made>deliver   creation to delivery at each subscribing node
+ *   publish>deliver  (only if the origin's trace is present) origin publish to each delivery
+ * Times across nodes are only as good as the nodes' clock synchronization.
+ */
+#include <getopt.h>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "dct/format.hpp"
+#include "dct/face/counters.hpp"
+
+using namespace dct;
+
+static struct option opts[] {
+    {"ncomp", required_argument, nullptr, 'k'},
+    {"help", no_argument, nullptr, 'h'}
+};
+
+static auto usage(std::string_view pname) {
+    print("- usage: {} [-k topic components] trace-file ...\n", pname);
+    exit(1);
+}
+
+struct Ev {
+    std::string ev;
+    int64_t ts;     // pub creation (us)
+    int64_t t;      // event time (us)
+    std::string node;
+    std::string topic;
+};
+
+// the first 'k' components of '/'-separated name 'nm'
+static std::string topicOf(const std::string& nm, int k) {
+    size_t e = 0;
+    for (int i = 0; i < k; ++i) {
+        e = nm.find('/', e + 1);
+        if (e == nm.npos) return nm;
+    }
+    return nm.substr(0, e);
+}
+
+int main(int argc, char* argv[]) {
+    int ncomp{3};
+    for (int c; (c = getopt_long(argc, argv, "k:h", opts, nullptr)) != -1; ) {
+        switch (c) {
+            case 'k': ncomp = std::stoi(optarg); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (optind >= argc) usage(argv[0]);
+
+    std::unordered_map<std::string,std::vector<Ev>> byHash{};
+    for (int i = optind; i < argc; ++i) {
+        std::ifstream is(argv[i]);
+        if (! is) { print("- can't open {}\n", argv[i]); exit(1); }
+        for (std::string l; std::getline(is, l); ) {
+            std::istringstream ls(l);
+            Ev e{};
+            std::string h, nm;
+            if (! (ls >> e.ev >> h >> e.ts >> e.t >> e.node >> nm)) continue;
+            e.topic = topicOf(nm, ncomp);
+            byHash[h].emplace_back(std::move(e));
+        }
+    }
+
+    static constexpr const char* stage[]{"made>publish", "made>send", "send>receive", "made>deliver", "publish>deliver"};
+    std::map<std::string,std::array<Histogram,5>> hist{};
+    for (const auto& [h, evs] : byHash) {
+        int64_t pubT{-1}, sendT{-1};
+        for (const auto& e : evs) {
+            if (e.ev == "publish" && (pubT < 0 || e.t < pubT)) pubT = e.t;
+            if (e.ev == "send" && (sendT < 0 || e.t < sendT)) sendT = e.t;
+        }
+        auto& hs = hist[evs.front().topic];
+        auto add = [&hs](size_t s, int64_t dt) { if (dt >= 0) hs[s].add(dt); };
+        for (const auto& e : evs) {
+            if (e.ev == "publish") add(0, e.t - e.ts);
+            else if (e.ev == "deliver") {
+                add(3, e.t - e.ts);
+                if (pubT >= 0) add(4, e.t - pubT);
+            } else if (e.ev == "receive" && sendT >= 0) add(2, e.t - sendT);
+        }
+        if (sendT >= 0) add(1, sendT - evs.front().ts);
+    }
+    for (const auto& [t, hs] : hist) {
+        print("{}\n", t);
+        for (size_t s = 0; s < hs.size(); ++s)
+            if (hs[s].count()) print("  {:<16} {}\n", stage[s], hs[s].str());
+    }
+    exit(0);
+}
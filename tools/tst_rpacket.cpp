@@ -83,6 +83,16 @@ int main(int argc, const char* argv[]) {
             }
             print("\n");
         }
+
+        // an indexed rData must find the same blocks as one that scans for them
+        for (auto r : {r1, r2, r3, r4}) {
+            rData x{r};
+            x.indexBlks();
+            bool same = x.metainfo().data() == r.metainfo().data() && x.content().data() == r.content().data() &&
+                        x.sigInfo().data() == r.sigInfo().data() && x.signature().data() == r.signature().data() &&
+                        x.signature().size() == r.signature().size();
+            print("{} indexed {} same blocks {}\n", pname(r.name()), x.blk_[0] != 0, same);
+        }
     } catch (const std::runtime_error& se) { print("runtime error: {}\n", se.what()); }
 
     exit(0);
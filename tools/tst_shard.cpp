@@ -0,0 +1,88 @@
+/*
+ *  tst_shard - check that pub collection shards only sync with the same shard
+ *
+ * Copyright (C) 2023 Pollere LLC
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, see <https://www.gnu.org/licenses/>.
+ *  You may contact Pollere LLC at info@pollere.net.
+ *
+ *  The DCT proof-of-concept is not intended as production code.
+ *  More information on DCT is available from info@pollere.net
+ */
+
+/*
+ * Two peers on a simulated network (see dct/face/sim_net.hpp). Both have the
+ * main pub collection ("pubs"). Peer 'a' also has a shard named the way
+ * DCTmodel names them ("pubs-a") and a collection nested under the main
+ * collection's name ("pubs"/"old", how shards used to be named). Peer 'b'
+ * has neither. Each peer publishes in every collection it has. 'b's pubs
+ * must reach 'a's main collection and nothing else: 'b' must not answer the
+ * cStates of collections it doesn't have with its main collection's pubs.
+ */
+#include <string_view>
+
+#include "dct/format.hpp"
+#include "dct/face/direct.hpp"
+#include "dct/sigmgrs/sigmgr_null.hpp"
+#include "dct/syncps/syncps.hpp"
+
+using namespace dct;
+using namespace std::literals::chrono_literals;
+
+int main(int /*argc*/, char* /*argv*/[]) {
+    auto& ioc = getDefaultIoContext();
+    SimNet::get("tstShard").params({.delay = 1ms});
+    SigMgrNULL wsm{}, psm{};
+    SigMgr& pubSigner = psm;
+    const auto coll = crName{"tstShard"};
+    const auto pubPre = coll/"pub";
+    constexpr size_t npubs = 3;
+
+    DirectFace fa{"sim:tstShard", ioc}, fb{"sim:tstShard", ioc};
+    SyncPS aMain{fa, coll/"pubs", wsm, psm}, aShard{fa, coll/"pubs-a", wsm, psm}, aOld{fa, coll/"pubs"/"old", wsm, psm};
+    SyncPS bMain{fb, coll/"pubs", wsm, psm};
+
+    // count the pubs each collection gets from the other peer
+    auto counter = [](size_t& n, std::string_view from) {
+        return [&n, from](const rPub& pub) { if (pub.name()[2].toSv() == from) ++n; };
+    };
+    size_t aMainIn{}, aShardIn{}, aOldIn{}, bMainIn{};
+    aMain.subscribe(pubPre, counter(aMainIn, "b"));
+    aShard.subscribe(pubPre, counter(aShardIn, "b"));
+    aOld.subscribe(pubPre, counter(aOldIn, "b"));
+    bMain.subscribe(pubPre, counter(bMainIn, "a"));
+
+    auto publish = [&](SyncPS& s, std::string_view from) {
+        for (size_t n = 0; n < npubs; ++n) {
+            crData d(pubPre/from/uint64_t(n)/std::chrono::system_clock::now(), 1);
+            d.content(std::vector<uint8_t>{uint8_t(n)});
+            pubSigner.sign(d);
+            s.publish(std::move(d));
+        }
+    };
+    // publish once the peers are registered and running
+    fa.oneTime(100ms, [&] {
+            publish(aMain, "a");
+            publish(aShard, "a");
+            publish(aOld, "a");
+            publish(bMain, "b");
+        });
+    fa.oneTime(2s, [&ioc]{ ioc.stop(); });
+    ioc.run();
+
+    print("a main {} shard {} nested {} | b main {}\n", aMainIn, aShardIn, aOldIn, bMainIn);
+    bool ok = aMainIn == npubs && aShardIn == 0 && aOldIn == 0 && bMainIn == npubs;
+    print("{}\n", ok? "passed" : "FAILED");
+    exit(ok? 0 : 1);
+}